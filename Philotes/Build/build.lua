@@ -24,22 +24,22 @@ project "TestConsole"
   location "Projects"
   language "C++"
   files { "../test/consoleTest/**.c*","../test/consoleTest/**.h" }
-  includedirs {"../common/"}
+  includedirs {"../common/","../render","../gears"}
   kind 'ConsoleApp'
   objdir ("../obj")
   targetdir ("../bin")
-  libdirs { "../lib/" }
+  libdirs { "../lib/","../3rdLibs/cg/lib/" }
   --debugdir "../bin"
-  links { "dbghelp","dxguid","wsock32","rpcrt4","wininet","d3d9","d3dx9","dinput8","xinput" }
+  links { "dbghelp","dxguid","wsock32","rpcrt4","wininet","d3d9","d3dx9","dinput8","xinput","cg","cgD3D9" }
   configuration "Debug"
       linkoptions {"/PDB:../../bin/TestConsole_d.pdb"}
-	  links { "common_d" }
+	  links { "common_d","PhiloGears_d","PhiloRender_d" }
   configuration "Release"
-	  links { "common" }
+	  links { "common","PhiloGears","PhiloRender" }
   configuration "ReleaseSymbols"
       flags {"Symbols"}
       linkoptions {"/PDB:../../bin/TestConsole.pdb"}
-	  links { "common" }
+	  links { "common","PhiloGears_s","PhiloRender_s" }
 	  
 project "TestRender"
   location "Projects"
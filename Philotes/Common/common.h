@@ -8,7 +8,11 @@
 #include "core/defines.h"
 #include "core/types.h"
 #include "core/memorydefine.h"
+#include "core/typetraits.h"
 #include "core/debug.h"
+#include "core/memory.h"
+#include "core/poolallocator.h"
+#include "core/frameallocator.h"
 
 #include "math/mathprerequisites.h"
 #include "math/scalar.h"
@@ -22,9 +26,14 @@
 
 #include "util/string.h"
 #include "util/array.h"
+#include "util/framearray.h"
 #include "util/dictionary.h"
+#include "util/flatdictionary.h"
 #include "util/list.h"
 #include "util/hashtable.h"
+#include "util/stringatom.h"
 #include "util/colourValue.h"
 
+#include "core/jobsystem.h"
+
 #include "core/exception.h"
@@ -72,6 +72,12 @@ static const int JobMaxSliceSize = 0x3FFF;
 // size of of a chunk of the global string buffer for StringAtoms
 #define PH_GLOBAL_STRINGBUFFER_CHUNKSIZE (32 * 1024)
 
+// size of the frame heap for transient per-frame data (see core/frameallocator.h)
+#define PH_FRAME_HEAP_SIZE (4 * 1024 * 1024)
+
+// size of a cache line, lock-free queues keep indices of different threads this far apart
+#define PH_CACHE_LINE_SIZE (64)
+
 // enable/disable Nebula3 animation system log messages
 #define PH_ANIMATIONSYSTEM_VERBOSELOG (0)
 #define PH_ANIMATIONSYSTEM_FRAMEDUMP (0)
@@ -159,6 +165,19 @@ static const int JobMaxSliceSize = 0x3FFF;
 
 #define PH_LITTLE_ENDIAN
 
+// instruction set used by the math library (see math/simd.h), 0 falls back to plain scalar code
+#define PH_MATH_SIMD_NONE (0)
+#define PH_MATH_SIMD_SSE2 (1)
+#define PH_MATH_SIMD_SSE41 (2)
+#ifndef PH_MATH_SIMD
+#define PH_MATH_SIMD PH_MATH_SIMD_SSE2
+#endif
+
+// Math::Sin and Math::Cos use the polynomial approximations of math/fastMath.h instead of the C library
+#ifndef PH_MATH_FAST_TRIG
+#define PH_MATH_FAST_TRIG (0)
+#endif
+
 // VisualStudio settings
 #ifdef _MSC_VER
 #define __VC__ (1)
@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+//  frameallocator.cpp
+//  (C) 2012 PhiloLabs
+//------------------------------------------------------------------------------
+
+#include "core/frameallocator.h"
+
+#include <new>
+
+namespace Philo
+{
+
+//------------------------------------------------------------------------------
+/**
+*/
+FrameAllocator::FrameAllocator() :
+    buffer(0),
+    capacity(0),
+    heapType(Memory::DefaultHeap),
+    usedSize(0),
+    peakSize(0),
+    overflowBlocks(0)
+{
+    InitializeCriticalSection(&this->overflowLock);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+FrameAllocator::~FrameAllocator()
+{
+    if (this->IsValid())
+    {
+        this->Discard();
+    }
+    DeleteCriticalSection(&this->overflowLock);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameAllocator::Setup(SizeT size, Memory::HeapType heap)
+{
+    ph_assert(!this->IsValid());
+    ph_assert(size > 0);
+    this->capacity = (size + 15) & ~15;
+    this->heapType = heap;
+    this->usedSize = 0;
+    this->peakSize = 0;
+
+    // the heap only guarantees 8 byte alignment
+    char* mem = (char*) Memory::Alloc(this->heapType, this->capacity + 16);
+    this->buffer = (char*) (((UINT_PTR) mem + 16) & ~(UINT_PTR) 15);
+    this->buffer[-1] = (char) (this->buffer - mem);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameAllocator::Discard()
+{
+    ph_assert(this->IsValid());
+    this->FreeOverflow();
+    Memory::Free(this->heapType, this->buffer - this->buffer[-1]);
+    this->buffer = 0;
+    this->capacity = 0;
+    this->usedSize = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Sizes are rounded up to 16 bytes, which keeps every block aligned
+    without a compare-and-swap loop.
+*/
+void*
+FrameAllocator::Alloc(SizeT size)
+{
+    ph_assert(this->IsValid());
+    SizeT alignedSize = (size + 15) & ~15;
+    SizeT offset = (SizeT) InterlockedExchangeAdd(&this->usedSize, (LONG) alignedSize);
+    if (offset + alignedSize <= this->capacity)
+    {
+        return this->buffer + offset;
+    }
+    return this->AllocOverflow(alignedSize);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+FrameAllocator::AllocOverflow(SizeT size)
+{
+    OverflowBlock* block = (OverflowBlock*) Memory::Alloc(this->heapType, sizeof(OverflowBlock) + size);
+    EnterCriticalSection(&this->overflowLock);
+    block->next = this->overflowBlocks;
+    this->overflowBlocks = block;
+    LeaveCriticalSection(&this->overflowLock);
+    return block + 1;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameAllocator::FreeOverflow()
+{
+    OverflowBlock* block = this->overflowBlocks;
+    while (block)
+    {
+        OverflowBlock* next = block->next;
+        Memory::Free(this->heapType, block);
+        block = next;
+    }
+    this->overflowBlocks = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+FrameAllocator::Reset()
+{
+    if ((SizeT) this->usedSize > this->peakSize)
+    {
+        this->peakSize = (SizeT) this->usedSize;
+    }
+    this->FreeOverflow();
+    this->usedSize = 0;
+}
+
+namespace Memory
+{
+
+const FrameHeapTag FrameHeap = FrameHeapTag();
+
+static FrameAllocator* volatile GlobalFrameAllocators = 0;
+static volatile LONG GlobalFrameIndex = 0;
+
+//------------------------------------------------------------------------------
+/**
+    Both frame heaps are created together and never destroyed, like the
+    heaps behind them.
+*/
+static FrameAllocator*
+GetFrameAllocators()
+{
+    FrameAllocator* frameAllocators = GlobalFrameAllocators;
+    if (0 == frameAllocators)
+    {
+        void* mem = Alloc(DefaultHeap, 2 * sizeof(FrameAllocator));
+        FrameAllocator* newFrameAllocators = new(mem) FrameAllocator[2];
+        newFrameAllocators[0].Setup(PH_FRAME_HEAP_SIZE, DefaultHeap);
+        newFrameAllocators[1].Setup(PH_FRAME_HEAP_SIZE, DefaultHeap);
+        frameAllocators = (FrameAllocator*) InterlockedCompareExchangePointer((PVOID volatile*) &GlobalFrameAllocators, newFrameAllocators, 0);
+        if (0 == frameAllocators)
+        {
+            frameAllocators = newFrameAllocators;
+        }
+        else
+        {
+            newFrameAllocators[0].~FrameAllocator();
+            newFrameAllocators[1].~FrameAllocator();
+            Free(DefaultHeap, mem);
+        }
+    }
+    return frameAllocators;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+FrameAllocator*
+GetFrameAllocator()
+{
+    return &GetFrameAllocators()[GlobalFrameIndex & 1];
+}
+
+//------------------------------------------------------------------------------
+/**
+    The heap which becomes current holds the data of the frame before the
+    previous one, which nobody may use anymore.
+*/
+void
+SwapFrameAllocators()
+{
+    FrameAllocator* frameAllocators = GetFrameAllocators();
+    LONG frameIndex = InterlockedIncrement(&GlobalFrameIndex);
+    frameAllocators[frameIndex & 1].Reset();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+SizeT
+GetFrameIndex()
+{
+    return (SizeT) GlobalFrameIndex;
+}
+
+} // namespace Memory
+} // namespace Philo
@@ -0,0 +1,163 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class FrameAllocator
+
+    Linear allocator for transient data which lives for one frame at most.
+    Alloc() bumps an offset into a preallocated buffer, there is no Free();
+    Reset() throws everything away at once at the start of the next frame.
+    Destructors are NOT called, so only put objects into it which don't
+    own other resources.
+
+    Alloc() is lock-free and may be called from several threads. When the
+    buffer runs out, blocks are taken from the heap and released by the
+    next Reset(); GetPeakSize() tells how large the buffer should be.
+
+    The global frame heap is used through ph_new_frame(type) and
+    ph_new_frame_array(type, size), which take constructor arguments
+    like ph_new, and through FrameArray (see util/framearray.h). It is
+    double-buffered: Memory::SwapFrameAllocators(), called by the
+    application at the start of every frame, switches to the other of
+    two FrameAllocators and resets it. Data allocated during frame N thus
+    stays valid until frame N+2 starts, which lets the previous frame's
+    lists be read while the next ones are built.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+#include "core/memory.h"
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+class FrameAllocator
+{
+public:
+    /// constructor
+    FrameAllocator();
+    /// destructor
+    ~FrameAllocator();
+
+    /// allocate the buffer
+    void Setup(SizeT capacity, Memory::HeapType heapType);
+    /// free the buffer and all overflow blocks
+    void Discard();
+    /// return true if the buffer has been allocated
+    bool IsValid() const;
+
+    /// get a block, valid until the next Reset(), 16 byte aligned unless the buffer overflowed
+    void* Alloc(SizeT size);
+    /// release all blocks (must not be called while other threads allocate)
+    void Reset();
+
+    /// size of the buffer
+    SizeT GetCapacity() const;
+    /// bytes allocated since the last Reset()
+    SizeT GetUsedSize() const;
+    /// the largest GetUsedSize() seen at a Reset()
+    SizeT GetPeakSize() const;
+
+private:
+    /// block taken from the heap when the buffer is full
+    struct OverflowBlock
+    {
+        OverflowBlock* next;
+        void* padding[3];
+    };
+
+    /// allocate a block from the heap, released at Reset()
+    void* AllocOverflow(SizeT size);
+    /// release the overflow blocks
+    void FreeOverflow();
+
+    char* buffer;
+    SizeT capacity;
+    Memory::HeapType heapType;
+    volatile LONG usedSize;
+    SizeT peakSize;
+    CRITICAL_SECTION overflowLock;
+    OverflowBlock* overflowBlocks;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+FrameAllocator::IsValid() const
+{
+    return 0 != this->buffer;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+FrameAllocator::GetCapacity() const
+{
+    return this->capacity;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+FrameAllocator::GetUsedSize() const
+{
+    return (SizeT) this->usedSize;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+FrameAllocator::GetPeakSize() const
+{
+    return this->peakSize;
+}
+
+namespace Memory
+{
+/// tag type for the frame heap placement new
+struct FrameHeapTag {};
+/// pass to operator new to allocate from the global frame heap
+extern const FrameHeapTag FrameHeap;
+
+/// get the frame heap of the current frame, both are created with PH_FRAME_HEAP_SIZE bytes on first use
+FrameAllocator* GetFrameAllocator();
+/// start a new frame: switch to the other frame heap and reset it, no thread may allocate meanwhile
+void SwapFrameAllocators();
+/// number of SwapFrameAllocators() calls so far
+SizeT GetFrameIndex();
+
+} // namespace Memory
+} // namespace Philo
+
+//------------------------------------------------------------------------------
+/**
+    The matching delete operators are only called by the compiler when a
+    constructor throws, frame memory is never freed individually.
+*/
+inline void*
+operator new(size_t size, const Philo::Memory::FrameHeapTag&)
+{
+    return Philo::Memory::GetFrameAllocator()->Alloc((SizeT) size);
+}
+
+inline void*
+operator new[](size_t size, const Philo::Memory::FrameHeapTag&)
+{
+    return Philo::Memory::GetFrameAllocator()->Alloc((SizeT) size);
+}
+
+inline void
+operator delete(void*, const Philo::Memory::FrameHeapTag&)
+{
+    // empty
+}
+
+inline void
+operator delete[](void*, const Philo::Memory::FrameHeapTag&)
+{
+    // empty
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,546 @@
+//------------------------------------------------------------------------------
+//  jobsystem.cpp
+//  (C) 2012 PhiloLabs
+//------------------------------------------------------------------------------
+
+#include "core/jobsystem.h"
+#include "util/timer.h"
+
+namespace Philo
+{
+_IMPLEMENT_SINGLETON(JobSystem);
+
+//------------------------------------------------------------------------------
+/**
+    numUnfinished counts the job itself plus its unfinished children, the
+    job is finished at 0.
+*/
+struct Job
+{
+    JobFunction function;
+    void* data;
+    IndexT first;
+    SizeT count;
+    Job* parent;
+    const char* name;
+    volatile LONG numUnfinished;
+};
+
+//------------------------------------------------------------------------------
+/**
+    Chase-Lev work-stealing deque. The owner thread pushes and pops at
+    the bottom, other threads steal at the top; the only contended case
+    is the last job, which owner and thieves race for with a
+    compare-and-swap on top.
+*/
+class JobQueue
+{
+public:
+    static const SizeT Capacity = JobSystem::MaxJobsPerThread;
+
+    /// constructor
+    JobQueue() : top(0), bottom(0) { }
+
+    /// push a job at the bottom, owner thread only, returns false if full
+    bool Push(Job* job)
+    {
+        LONG b = this->bottom;
+        if (b - this->top >= Capacity)
+        {
+            return false;
+        }
+        this->jobs[b & (Capacity - 1)] = job;
+        // publish the job before the new bottom
+        MemoryBarrier();
+        this->bottom = b + 1;
+        return true;
+    }
+
+    /// pop a job from the bottom, owner thread only
+    Job* Pop()
+    {
+        LONG b = this->bottom - 1;
+        InterlockedExchange(&this->bottom, b);
+        LONG t = this->top;
+        if (t > b)
+        {
+            // empty
+            this->bottom = t;
+            return 0;
+        }
+        Job* job = this->jobs[b & (Capacity - 1)];
+        if (t != b)
+        {
+            // more than one job left, no thief can reach this one
+            return job;
+        }
+        // last job, race against the thieves
+        if (InterlockedCompareExchange(&this->top, t + 1, t) != t)
+        {
+            job = 0;
+        }
+        this->bottom = t + 1;
+        return job;
+    }
+
+    /// steal a job from the top, any thread
+    Job* Steal()
+    {
+        LONG t = this->top;
+        MemoryBarrier();
+        LONG b = this->bottom;
+        if (t >= b)
+        {
+            return 0;
+        }
+        Job* job = this->jobs[t & (Capacity - 1)];
+        if (InterlockedCompareExchange(&this->top, t + 1, t) != t)
+        {
+            // another thread got it
+            return 0;
+        }
+        return job;
+    }
+
+private:
+    volatile LONG top;
+    volatile LONG bottom;
+    Job* volatile jobs[Capacity];
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+struct JobSystem::Worker
+{
+    JobSystem* jobSystem;
+    IndexT index;
+    HANDLE thread;
+    uint32 randomSeed;
+    JobQueue queue;
+    Job jobs[MaxJobsPerThread];
+    uint32 numCreatedJobs;
+    #if PH_ENABLE_PROFILING
+    JobProfileEntry profile[MaxProfileEntriesPerThread];
+    uint32 numProfileEntries;   // since the last CollectProfile(), may exceed the ring
+    #endif
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+JobSystem::JobSystem() :
+    workers(0),
+    numWorkers(0),
+    tlsIndex(TLS_OUT_OF_INDEXES),
+    wakeSemaphore(0),
+    numSleeping(0),
+    quit(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+JobSystem::~JobSystem()
+{
+    if (this->IsValid())
+    {
+        this->Discard();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobSystem::Setup(SizeT numWorkerThreads)
+{
+    ph_assert(!this->IsValid());
+    if (numWorkerThreads < 0)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        numWorkerThreads = (SizeT) info.dwNumberOfProcessors - 1;
+        if (numWorkerThreads < 0)
+        {
+            numWorkerThreads = 0;
+        }
+    }
+    this->numWorkers = numWorkerThreads + 1;
+    this->quit = 0;
+    this->numSleeping = 0;
+    this->tlsIndex = TlsAlloc();
+    ph_assert(TLS_OUT_OF_INDEXES != this->tlsIndex);
+    this->wakeSemaphore = CreateSemaphoreA(0, 0, 0x7fffffff, 0);
+
+    this->workers = ph_new_array(Worker, this->numWorkers);
+    IndexT i;
+    for (i = 0; i < this->numWorkers; i++)
+    {
+        Worker& worker = this->workers[i];
+        worker.jobSystem = this;
+        worker.index = i;
+        worker.thread = 0;
+        worker.randomSeed = 0x9e3779b9 * (i + 1);
+        worker.numCreatedJobs = 0;
+        #if PH_ENABLE_PROFILING
+        worker.numProfileEntries = 0;
+        #endif
+        IndexT j;
+        for (j = 0; j < MaxJobsPerThread; j++)
+        {
+            worker.jobs[j].numUnfinished = 0;
+        }
+    }
+
+    // the calling thread is worker 0
+    TlsSetValue(this->tlsIndex, &this->workers[0]);
+    for (i = 1; i < this->numWorkers; i++)
+    {
+        this->workers[i].thread = CreateThread(0, 0, WorkerThreadProc, &this->workers[i], 0, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobSystem::Discard()
+{
+    ph_assert(this->IsValid());
+    InterlockedExchange(&this->quit, 1);
+    ReleaseSemaphore(this->wakeSemaphore, this->numWorkers, 0);
+    IndexT i;
+    for (i = 1; i < this->numWorkers; i++)
+    {
+        WaitForSingleObject(this->workers[i].thread, INFINITE);
+        CloseHandle(this->workers[i].thread);
+    }
+    CloseHandle(this->wakeSemaphore);
+    this->wakeSemaphore = 0;
+    TlsFree(this->tlsIndex);
+    this->tlsIndex = TLS_OUT_OF_INDEXES;
+    ph_delete_array(this->workers);
+    this->workers = 0;
+    this->numWorkers = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+JobSystem::Worker*
+JobSystem::GetCurrentWorker() const
+{
+    Worker* worker = (Worker*) TlsGetValue(this->tlsIndex);
+    ph_assert2(0 != worker, "JobSystem: jobs can only be used on job system threads!");
+    return worker;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+IndexT
+JobSystem::GetThreadIndex() const
+{
+    return this->GetCurrentWorker()->index;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Job*
+JobSystem::CreateJob(JobFunction function, void* data, IndexT first, SizeT count, const char* name)
+{
+    ph_assert(0 != function);
+    Worker* worker = this->GetCurrentWorker();
+    Job* job = &worker->jobs[worker->numCreatedJobs++ & (MaxJobsPerThread - 1)];
+    ph_assert2(0 == job->numUnfinished, "JobSystem: too many unfinished jobs, increase MaxJobsPerThread!");
+    job->function = function;
+    job->data = data;
+    job->first = first;
+    job->count = count;
+    job->parent = 0;
+    job->name = name;
+    job->numUnfinished = 1;
+    return job;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Job*
+JobSystem::CreateJob(JobFunction function, void* data, const char* name)
+{
+    return this->CreateJob(function, data, 0, 1, name);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Job*
+JobSystem::CreateChildJob(Job* parent, JobFunction function, void* data, IndexT first, SizeT count, const char* name)
+{
+    ph_assert(0 != parent);
+    ph_assert2(parent->numUnfinished > 0, "JobSystem: child added to a finished job!");
+    InterlockedIncrement(&parent->numUnfinished);
+    Job* job = this->CreateJob(function, data, first, count, name);
+    job->parent = parent;
+    return job;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Job*
+JobSystem::CreateChildJob(Job* parent, JobFunction function, void* data, const char* name)
+{
+    return this->CreateChildJob(parent, function, data, 0, 1, name);
+}
+
+//------------------------------------------------------------------------------
+/**
+    A full queue runs the job right away instead.
+*/
+void
+JobSystem::Run(Job* job)
+{
+    Worker* worker = this->GetCurrentWorker();
+    if (!worker->queue.Push(job))
+    {
+        this->Execute(worker, job);
+        return;
+    }
+    if (this->numSleeping > 0)
+    {
+        ReleaseSemaphore(this->wakeSemaphore, 1, 0);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+JobSystem::IsFinished(const Job* job) const
+{
+    return 0 == job->numUnfinished;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobSystem::Wait(const Job* job)
+{
+    Worker* worker = this->GetCurrentWorker();
+    while (!this->IsFinished(job))
+    {
+        Job* other = this->GetJob(worker);
+        if (other)
+        {
+            this->Execute(worker, other);
+        }
+        else
+        {
+            SwitchToThread();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+Job*
+JobSystem::GetJob(Worker* worker)
+{
+    Job* job = worker->queue.Pop();
+    if (0 == job && this->numWorkers > 1)
+    {
+        // xorshift, picks a random other thread to steal from
+        uint32 x = worker->randomSeed;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        worker->randomSeed = x;
+        IndexT victim = (IndexT) (x % (uint32) (this->numWorkers - 1));
+        if (victim >= worker->index)
+        {
+            victim++;
+        }
+        job = this->workers[victim].queue.Steal();
+    }
+    return job;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobSystem::Execute(Worker* worker, Job* job)
+{
+    #if PH_ENABLE_PROFILING
+    uint64 startTicks = Timer::getCurrentCounterValue();
+    #endif
+
+    job->function(job->data, job->first, job->count);
+
+    #if PH_ENABLE_PROFILING
+    JobProfileEntry& entry = worker->profile[worker->numProfileEntries++ & (MaxProfileEntriesPerThread - 1)];
+    entry.name = job->name ? job->name : "unnamed";
+    entry.threadIndex = worker->index;
+    entry.startTicks = startTicks;
+    entry.endTicks = Timer::getCurrentCounterValue();
+    #endif
+
+    this->Finish(job);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+JobSystem::Finish(Job* job)
+{
+    Job* parent = job->parent;
+    if (0 == InterlockedDecrement(&job->numUnfinished) && parent)
+    {
+        this->Finish(parent);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Spins for a while when out of work, then sleeps until Run() queues
+    something new. A thread may wake up without finding the job, it just
+    goes to sleep again.
+*/
+void
+JobSystem::WorkerLoop(Worker* worker)
+{
+    const IndexT numSpins = 64;
+    IndexT spins = 0;
+    while (0 == this->quit)
+    {
+        Job* job = this->GetJob(worker);
+        if (job)
+        {
+            this->Execute(worker, job);
+            spins = 0;
+        }
+        else if (++spins < numSpins)
+        {
+            SwitchToThread();
+        }
+        else
+        {
+            // look again after announcing the sleep, a job queued in
+            // between didn't wake anybody
+            InterlockedIncrement(&this->numSleeping);
+            job = this->GetJob(worker);
+            if (0 == job)
+            {
+                WaitForSingleObject(this->wakeSemaphore, INFINITE);
+            }
+            InterlockedDecrement(&this->numSleeping);
+            if (job)
+            {
+                this->Execute(worker, job);
+            }
+            spins = 0;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+DWORD WINAPI
+JobSystem::WorkerThreadProc(LPVOID param)
+{
+    Worker* worker = (Worker*) param;
+    TlsSetValue(worker->jobSystem->tlsIndex, worker);
+    worker->jobSystem->WorkerLoop(worker);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+EmptyJob(void*, IndexT, SizeT)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+    Splits the range into about four pieces per thread, so threads which
+    finish early can steal the rest. Without Setup() the function is
+    called once for the whole range.
+*/
+void
+JobSystem::ParallelFor(SizeT count, JobFunction function, void* data, SizeT grainSize, const char* name)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    if (!this->IsValid())
+    {
+        function(data, 0, count);
+        return;
+    }
+    if (grainSize <= 0)
+    {
+        grainSize = count / (this->numWorkers * 4);
+    }
+    // stay well below the number of jobs a thread can have alive
+    SizeT minGrainSize = count / (MaxJobsPerThread / 2) + 1;
+    if (grainSize < minGrainSize)
+    {
+        grainSize = minGrainSize;
+    }
+
+    Job* root = this->CreateJob(EmptyJob, 0, name);
+    IndexT first;
+    for (first = 0; first < count; first += grainSize)
+    {
+        SizeT num = (first + grainSize <= count) ? grainSize : (count - first);
+        Job* job = this->CreateChildJob(root, function, data, first, num, name);
+        this->Run(job);
+    }
+    this->Run(root);
+    this->Wait(root);
+}
+
+#if PH_ENABLE_PROFILING
+//------------------------------------------------------------------------------
+/**
+    Clear() keeps the capacity of entries, passing the same array every
+    frame doesn't allocate once it has grown to fit.
+*/
+void
+JobSystem::CollectProfile(Array<JobProfileEntry>& entries)
+{
+    entries.Clear();
+    IndexT i;
+    for (i = 0; i < this->numWorkers; i++)
+    {
+        Worker& worker = this->workers[i];
+        uint32 first = 0;
+        if (worker.numProfileEntries > MaxProfileEntriesPerThread)
+        {
+            first = worker.numProfileEntries - MaxProfileEntriesPerThread;
+        }
+        uint32 e;
+        for (e = first; e < worker.numProfileEntries; e++)
+        {
+            entries.Append(worker.profile[e & (MaxProfileEntriesPerThread - 1)]);
+        }
+        worker.numProfileEntries = 0;
+    }
+}
+#endif
+
+} // namespace Philo
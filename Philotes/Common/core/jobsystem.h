@@ -0,0 +1,192 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class JobSystem
+
+    Work-stealing job scheduler. Setup() starts one worker thread per
+    additional core; the thread which called Setup() takes part as
+    thread 0. Every thread owns a queue of runnable jobs: it pushes and
+    pops jobs at one end of its own queue without locks, idle threads
+    steal from the other end of a random other queue.
+
+    A job is a function with a data pointer and an index range. Jobs
+    created with CreateChildJob() count as unfinished parts of their
+    parent, the parent is finished when its own function and all its
+    children are done; waiting for a parent waits for the whole tree.
+    Wait() doesn't block: the waiting thread runs queued jobs until the
+    job it waits for is finished.
+
+    Jobs are taken from a ring per thread and are recycled after
+    MaxJobsPerThread further jobs were created by the same thread, a job
+    must be finished by then. Jobs can only be created and run on the
+    threads of the job system.
+
+    With PH_ENABLE_PROFILING every job records its start and end in
+    Timer counter ticks together with its name and thread, into a fixed
+    ring of MaxProfileEntriesPerThread records per thread. Call
+    CollectProfile() once per frame, it hands out the records since the
+    last call, the newest ones if a thread ran more jobs than fit.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+#include "core/singleton.h"
+#include "util/array.h"
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+/// job function, called with the job's data and the index range to process
+typedef void (*JobFunction)(void* data, IndexT first, SizeT count);
+
+struct Job;
+
+#if PH_ENABLE_PROFILING
+/// one executed job, times are Timer counter values
+struct JobProfileEntry
+{
+    const char* name;
+    IndexT threadIndex;
+    uint64 startTicks;
+    uint64 endTicks;
+};
+#endif
+
+class JobSystem : public Singleton<JobSystem>
+{
+public:
+    _DECLARE_SINGLETON(JobSystem);
+
+    /// max number of jobs a thread can have alive at the same time, must be a power of 2
+    static const SizeT MaxJobsPerThread = 4096;
+    #if PH_ENABLE_PROFILING
+    /// number of profile records kept per thread between two CollectProfile() calls, must be a power of 2
+    static const SizeT MaxProfileEntriesPerThread = 1024;
+    #endif
+
+    /// constructor
+    JobSystem();
+    /// destructor
+    ~JobSystem();
+
+    /// start the worker threads, 0 workers runs everything on the calling thread, -1 uses one per additional core
+    void Setup(SizeT numWorkers = -1);
+    /// stop the worker threads, no jobs may be running
+    void Discard();
+    /// return true if set up
+    bool IsValid() const;
+
+    /// number of threads executing jobs, including the one which called Setup()
+    SizeT GetNumThreads() const;
+    /// index of the calling thread, 0 for the thread which called Setup()
+    IndexT GetThreadIndex() const;
+
+    /// create a job, call Run() to start it
+    Job* CreateJob(JobFunction function, void* data, const char* name = 0);
+    /// create a job which processes an index range
+    Job* CreateJob(JobFunction function, void* data, IndexT first, SizeT count, const char* name = 0);
+    /// create a job which the parent waits for, the parent must not be finished yet
+    Job* CreateChildJob(Job* parent, JobFunction function, void* data, const char* name = 0);
+    /// create a child job which processes an index range
+    Job* CreateChildJob(Job* parent, JobFunction function, void* data, IndexT first, SizeT count, const char* name = 0);
+    /// queue a job for execution
+    void Run(Job* job);
+    /// run other jobs until a job and all its children are finished
+    void Wait(const Job* job);
+    /// return true if a job and all its children are finished
+    bool IsFinished(const Job* job) const;
+
+    /// call function on [0, count) split into pieces of at least grainSize, returns when all are done
+    void ParallelFor(SizeT count, JobFunction function, void* data, SizeT grainSize = 0, const char* name = 0);
+    /// call function on every element of an array in parallel, returns when all are done
+    template<class TYPE> void ParallelFor(Array<TYPE>& array, void (*function)(TYPE& element, void* data), void* data, SizeT grainSize = 0, const char* name = 0);
+
+    #if PH_ENABLE_PROFILING
+    /// move the profile records since the last call of all threads into entries, call once per frame while no jobs are running
+    void CollectProfile(Array<JobProfileEntry>& entries);
+    #endif
+
+private:
+    struct Worker;
+
+    /// parameters of the array ParallelFor()
+    template<class TYPE> struct ArrayForData
+    {
+        Array<TYPE>* array;
+        void (*function)(TYPE& element, void* data);
+        void* data;
+    };
+    /// calls the array ParallelFor() function on a range of elements
+    template<class TYPE> static void ArrayForJob(void* data, IndexT first, SizeT count);
+
+    /// the worker of the calling thread
+    Worker* GetCurrentWorker() const;
+    /// take a job from the own queue or steal one
+    Job* GetJob(Worker* worker);
+    /// run a job and finish it
+    void Execute(Worker* worker, Job* job);
+    /// mark one part of a job as done, finishes the parent with the job
+    void Finish(Job* job);
+    /// worker thread main loop
+    void WorkerLoop(Worker* worker);
+    /// worker thread entry
+    static DWORD WINAPI WorkerThreadProc(LPVOID param);
+
+    Worker* workers;
+    SizeT numWorkers;           // including thread 0
+    DWORD tlsIndex;
+    HANDLE wakeSemaphore;
+    volatile LONG numSleeping;
+    volatile LONG quit;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+JobSystem::IsValid() const
+{
+    return 0 != this->workers;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+JobSystem::GetNumThreads() const
+{
+    return this->numWorkers;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+JobSystem::ArrayForJob(void* data, IndexT first, SizeT count)
+{
+    ArrayForData<TYPE>* forData = (ArrayForData<TYPE>*) data;
+    Array<TYPE>& array = *forData->array;
+    IndexT i;
+    for (i = first; i < first + count; i++)
+    {
+        forData->function(array[i], forData->data);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    The parameters live on the stack, ParallelFor() only returns when all
+    jobs are done.
+*/
+template<class TYPE> void
+JobSystem::ParallelFor(Array<TYPE>& array, void (*function)(TYPE& element, void* data), void* data, SizeT grainSize, const char* name)
+{
+    ArrayForData<TYPE> forData;
+    forData.array = &array;
+    forData.function = function;
+    forData.data = data;
+    this->ParallelFor(array.Size(), &ArrayForJob<TYPE>, &forData, grainSize, name);
+}
+
+} // namespace Philo
+//------------------------------------------------------------------------------
@@ -0,0 +1,537 @@
+//------------------------------------------------------------------------------
+//  memory.cpp
+//  (C) 2012 PhiloLabs
+//------------------------------------------------------------------------------
+
+#include "core/memory.h"
+#if PH_MEMORY_STATS
+#include "util/string.h"
+#endif
+
+namespace Philo
+{
+namespace Memory
+{
+
+static HANDLE volatile Heaps[NumHeapTypes] = { 0 };
+
+static const char* HeapNames[NumHeapTypes] =
+{
+    "DefaultHeap",
+    "RenderHeap",
+    "GearsHeap",
+    "UtilHeap",
+};
+
+//------------------------------------------------------------------------------
+/**
+    Heaps are created on first use, objects with static storage may
+    allocate before any setup code runs. Threads racing to create the
+    same heap keep whichever was published first.
+*/
+static HANDLE
+GetHeap(HeapType heapType)
+{
+    ph_assert(heapType < NumHeapTypes);
+    HANDLE heap = Heaps[heapType];
+    if (0 == heap)
+    {
+        HANDLE newHeap;
+        if (DefaultHeap == heapType)
+        {
+            newHeap = GetProcessHeap();
+        }
+        else
+        {
+            newHeap = HeapCreate(0, 0, 0);
+            ph_assert(0 != newHeap);
+
+            // enable the low fragmentation front end
+            ULONG heapFragValue = 2;
+            HeapSetInformation(newHeap, HeapCompatibilityInformation, &heapFragValue, sizeof(heapFragValue));
+        }
+        heap = (HANDLE) InterlockedCompareExchangePointer((PVOID volatile*) &Heaps[heapType], newHeap, 0);
+        if (0 == heap)
+        {
+            heap = newHeap;
+        }
+        else if (DefaultHeap != heapType)
+        {
+            HeapDestroy(newHeap);
+        }
+    }
+    return heap;
+}
+
+#if PH_MEMORY_STATS
+//------------------------------------------------------------------------------
+/**
+    Every tracked block starts with this header, the caller gets the
+    memory behind it. The header is padded to 32 bytes so the caller's
+    memory keeps the heap's alignment.
+*/
+struct AllocHeader
+{
+    AllocHeader* prev;
+    AllocHeader* next;
+    const char* file;
+    int line;
+    SizeT size;
+};
+static const SizeT AllocHeaderSize = 32;
+
+/// the live blocks and counters of a heap, zero initialized
+struct HeapTracker
+{
+    volatile LONG lock;
+    AllocHeader* first;
+    HeapStats stats;
+};
+static HeapTracker Trackers[NumHeapTypes];
+
+/// the live blocks of one call site
+struct SiteEntry
+{
+    const char* file;
+    int line;
+    SizeT count;
+    SizeT bytes;
+};
+
+//------------------------------------------------------------------------------
+/**
+    A spin lock needs no setup, so allocations from static initializers
+    are tracked as well. It is never held while allocating.
+*/
+static void
+LockTracker(HeapTracker& tracker)
+{
+    while (0 != InterlockedExchange(&tracker.lock, 1))
+    {
+        SwitchToThread();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+UnlockTracker(HeapTracker& tracker)
+{
+    InterlockedExchange(&tracker.lock, 0);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void*
+TrackBlock(HeapType heapType, void* block, SizeT size, const char* file, int line)
+{
+    AllocHeader* header = (AllocHeader*) block;
+    header->prev = 0;
+    header->file = file;
+    header->line = line;
+    header->size = size;
+
+    HeapTracker& tracker = Trackers[heapType];
+    LockTracker(tracker);
+    header->next = tracker.first;
+    if (tracker.first)
+    {
+        tracker.first->prev = header;
+    }
+    tracker.first = header;
+    tracker.stats.liveBytes += size;
+    if (tracker.stats.liveBytes > tracker.stats.peakBytes)
+    {
+        tracker.stats.peakBytes = tracker.stats.liveBytes;
+    }
+    tracker.stats.liveAllocs++;
+    tracker.stats.totalAllocs++;
+    tracker.stats.frameAllocs++;
+    UnlockTracker(tracker);
+
+    return ((char*) block) + AllocHeaderSize;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Unlinks the block of a pointer returned by TrackBlock(), returns the
+    block.
+*/
+static AllocHeader*
+UntrackBlock(HeapType heapType, void* ptr)
+{
+    AllocHeader* header = (AllocHeader*) (((char*) ptr) - AllocHeaderSize);
+
+    HeapTracker& tracker = Trackers[heapType];
+    LockTracker(tracker);
+    if (header->prev)
+    {
+        header->prev->next = header->next;
+    }
+    else
+    {
+        ph_assert2(tracker.first == header, "Memory::Free(): block freed to the wrong heap!");
+        tracker.first = header->next;
+    }
+    if (header->next)
+    {
+        header->next->prev = header->prev;
+    }
+    tracker.stats.liveBytes -= header->size;
+    tracker.stats.liveAllocs--;
+    UnlockTracker(tracker);
+
+    return header;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Sums up the live blocks of a heap by call site. The table comes
+    straight from the process heap, so building it doesn't touch the
+    tracked heaps. Release it with HeapFree(GetProcessHeap(), ...).
+*/
+static SiteEntry*
+CollectSites(HeapType heapType, SizeT& numSites)
+{
+    HeapTracker& tracker = Trackers[heapType];
+    LockTracker(tracker);
+
+    SizeT capacity = 16;
+    while (capacity < tracker.stats.liveAllocs * 2)
+    {
+        capacity <<= 1;
+    }
+    SiteEntry* sites = (SiteEntry*) HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, capacity * sizeof(SiteEntry));
+    if (0 == sites)
+    {
+        UnlockTracker(tracker);
+        numSites = 0;
+        return 0;
+    }
+
+    AllocHeader* header;
+    for (header = tracker.first; 0 != header; header = header->next)
+    {
+        const char* file = header->file ? header->file : "unknown";
+        SizeT index = (((SizeT) (UINT_PTR) file >> 4) ^ (header->line * 31)) & (capacity - 1);
+        for (;;)
+        {
+            SiteEntry& entry = sites[index];
+            if (0 == entry.file)
+            {
+                entry.file = file;
+                entry.line = header->line;
+            }
+            if (entry.line == header->line && (entry.file == file || 0 == strcmp(entry.file, file)))
+            {
+                entry.count++;
+                entry.bytes += header->size;
+                break;
+            }
+            index = (index + 1) & (capacity - 1);
+        }
+    }
+    UnlockTracker(tracker);
+
+    // move the used entries to the front
+    numSites = 0;
+    IndexT i;
+    for (i = 0; i < capacity; i++)
+    {
+        if (0 != sites[i].file)
+        {
+            sites[numSites++] = sites[i];
+        }
+    }
+    return sites;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+AppendJsonString(String& json, const char* str)
+{
+    json.Append("\"");
+    const char* c;
+    for (c = str; *c; c++)
+    {
+        if ('\\' == *c || '"' == *c)
+        {
+            json.AppendRange("\\", 1);
+        }
+        json.AppendRange(c, 1);
+    }
+    json.Append("\"");
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+static void
+AppendJsonValue(String& json, const char* name, SizeT value, bool comma = true)
+{
+    json.Append("\"");
+    json.Append(name);
+    json.Append("\":");
+    json.AppendInt(value);
+    if (comma)
+    {
+        json.Append(",");
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+Alloc(HeapType heapType, SizeT size, const char* file, int line)
+{
+    void* block = HeapAlloc(GetHeap(heapType), 0, size + AllocHeaderSize);
+    if (0 == block)
+    {
+        ph_error("Memory::Alloc(): out of memory in %s (%d bytes) at %s(%d)!\n", HeapNames[heapType], size, file ? file : "unknown", line);
+        return 0;
+    }
+    return TrackBlock(heapType, block, size, file, line);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+Alloc(HeapType heapType, SizeT size)
+{
+    return Alloc(heapType, size, 0, 0);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+Free(HeapType heapType, void* ptr)
+{
+    if (0 != ptr)
+    {
+        AllocHeader* header = UntrackBlock(heapType, ptr);
+        HeapFree(GetHeap(heapType), 0, header);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    The block keeps the call site of its first allocation. If it can't
+    grow, the old block stays valid and tracked and 0 is returned.
+*/
+void*
+Realloc(HeapType heapType, void* ptr, SizeT size)
+{
+    if (0 == ptr)
+    {
+        return Alloc(heapType, size);
+    }
+    AllocHeader* header = UntrackBlock(heapType, ptr);
+    const char* file = header->file;
+    int line = header->line;
+    SizeT oldSize = header->size;
+    void* block = HeapReAlloc(GetHeap(heapType), 0, header, size + AllocHeaderSize);
+    if (0 == block)
+    {
+        ph_error("Memory::Realloc(): out of memory in %s (%d bytes)!\n", HeapNames[heapType], size);
+        TrackBlock(heapType, header, oldSize, file, line);
+        return 0;
+    }
+    return TrackBlock(heapType, block, size, file, line);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+HeapStats
+GetHeapStats(HeapType heapType)
+{
+    ph_assert(heapType < NumHeapTypes);
+    HeapTracker& tracker = Trackers[heapType];
+    LockTracker(tracker);
+    HeapStats stats = tracker.stats;
+    UnlockTracker(tracker);
+    return stats;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Call once per frame, before the frame's work starts.
+*/
+void
+NewFrame()
+{
+    IndexT i;
+    for (i = 0; i < NumHeapTypes; i++)
+    {
+        HeapTracker& tracker = Trackers[i];
+        LockTracker(tracker);
+        tracker.stats.lastFrameAllocs = tracker.stats.frameAllocs;
+        tracker.stats.frameAllocs = 0;
+        UnlockTracker(tracker);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Blocks without a call site belong to the allocator internals and to
+    objects which live until the process ends (pools, the string atom
+    table), they are not reported. Lines are printed as "file(line):" so
+    the IDE can jump to them.
+*/
+SizeT
+DumpLeaks()
+{
+    SizeT numLeaks = 0;
+    IndexT heapIndex;
+    for (heapIndex = 0; heapIndex < NumHeapTypes; heapIndex++)
+    {
+        SizeT numSites = 0;
+        SiteEntry* sites = CollectSites((HeapType) heapIndex, numSites);
+        IndexT i;
+        for (i = 0; i < numSites; i++)
+        {
+            if (0 != sites[i].line)
+            {
+                ph_printf("%s(%d): %d blocks, %d bytes still allocated in %s\n",
+                    sites[i].file, sites[i].line, sites[i].count, sites[i].bytes, HeapNames[heapIndex]);
+                numLeaks += sites[i].count;
+            }
+        }
+        if (sites)
+        {
+            HeapFree(GetProcessHeap(), 0, sites);
+        }
+    }
+    if (numLeaks > 0)
+    {
+        ph_printf("Memory::DumpLeaks(): %d blocks still allocated.\n", numLeaks);
+    }
+    return numLeaks;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Format:
+    {"heaps":[{"name":"RenderHeap","liveBytes":0,"peakBytes":0,
+      "liveAllocs":0,"totalAllocs":0,"frameAllocs":0,"lastFrameAllocs":0,
+      "sites":[{"file":"...","line":0,"count":0,"bytes":0},...]},...]}
+
+    The snapshot itself allocates from the Util heap while it is written,
+    its counters may be slightly ahead of the ones in the snapshot.
+*/
+void
+GetJsonSnapshot(String& json)
+{
+    json.Clear();
+    json.Append("{\"heaps\":[");
+    IndexT heapIndex;
+    for (heapIndex = 0; heapIndex < NumHeapTypes; heapIndex++)
+    {
+        HeapStats stats = GetHeapStats((HeapType) heapIndex);
+        SizeT numSites = 0;
+        SiteEntry* sites = CollectSites((HeapType) heapIndex, numSites);
+
+        if (heapIndex > 0)
+        {
+            json.Append(",");
+        }
+        json.Append("{\"name\":");
+        AppendJsonString(json, HeapNames[heapIndex]);
+        json.Append(",");
+        AppendJsonValue(json, "liveBytes", stats.liveBytes);
+        AppendJsonValue(json, "peakBytes", stats.peakBytes);
+        AppendJsonValue(json, "liveAllocs", stats.liveAllocs);
+        AppendJsonValue(json, "totalAllocs", stats.totalAllocs);
+        AppendJsonValue(json, "frameAllocs", stats.frameAllocs);
+        AppendJsonValue(json, "lastFrameAllocs", stats.lastFrameAllocs);
+        json.Append("\"sites\":[");
+        IndexT i;
+        for (i = 0; i < numSites; i++)
+        {
+            if (i > 0)
+            {
+                json.Append(",");
+            }
+            json.Append("{\"file\":");
+            AppendJsonString(json, sites[i].file);
+            json.Append(",");
+            AppendJsonValue(json, "line", sites[i].line);
+            AppendJsonValue(json, "count", sites[i].count);
+            AppendJsonValue(json, "bytes", sites[i].bytes, false);
+            json.Append("}");
+        }
+        json.Append("]}");
+
+        if (sites)
+        {
+            HeapFree(GetProcessHeap(), 0, sites);
+        }
+    }
+    json.Append("]}");
+}
+
+#else
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+Alloc(HeapType heapType, SizeT size)
+{
+    void* ptr = HeapAlloc(GetHeap(heapType), 0, size);
+    if (0 == ptr)
+    {
+        ph_error("Memory::Alloc(): out of memory in %s (%d bytes)!\n", HeapNames[heapType], size);
+    }
+    return ptr;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+Free(HeapType heapType, void* ptr)
+{
+    if (0 != ptr)
+    {
+        HeapFree(GetHeap(heapType), 0, ptr);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+Realloc(HeapType heapType, void* ptr, SizeT size)
+{
+    if (0 == ptr)
+    {
+        return Alloc(heapType, size);
+    }
+    void* newPtr = HeapReAlloc(GetHeap(heapType), 0, ptr, size);
+    if (0 == newPtr)
+    {
+        ph_error("Memory::Realloc(): out of memory in %s (%d bytes)!\n", HeapNames[heapType], size);
+    }
+    return newPtr;
+}
+#endif
+
+//------------------------------------------------------------------------------
+/**
+*/
+const char*
+GetHeapName(HeapType heapType)
+{
+    ph_assert(heapType < NumHeapTypes);
+    return HeapNames[heapType];
+}
+
+} // namespace Memory
+} // namespace Philo
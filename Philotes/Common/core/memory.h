@@ -0,0 +1,154 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file core/memory.h
+
+    Subsystem heaps behind the ph_new/ph_delete macros.
+
+    Every subsystem allocates from its own private Win32 heap with the
+    low fragmentation front end enabled, so render, asset and utility
+    allocations don't fragment each other or the process heap. Classes
+    select their heap by putting PH_DECLARE_HEAP_ALLOC(heapType) into
+    their declaration; ph_new/ph_delete (including the array forms) then
+    go through that heap without any change at the call site. Raw memory
+    is allocated with Memory::Alloc()/Memory::Free().
+
+    Small, frequently created objects use a PoolAllocator instead (see
+    core/poolallocator.h), transient per-frame data the FrameAllocator
+    (see core/frameallocator.h).
+
+    With PH_MEMORY_STATS enabled every heap block carries a small header
+    with its size and the file and line of the ph_new/ph_malloc call
+    which created it. The heaps keep live and peak byte counts and
+    allocation counts per frame, DumpLeaks() lists the blocks still alive
+    by call site and GetJsonSnapshot() writes everything as JSON. Objects
+    of classes without a heap declaration stay on the CRT heap and are
+    not tracked. With PH_MEMORY_STATS disabled none of this is compiled.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/config.h"
+#include "core/types.h"
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+class String;
+
+namespace Memory
+{
+enum HeapType
+{
+    DefaultHeap = 0,    // the process heap, for everything not assigned elsewhere
+    RenderHeap,         // scene nodes and render objects
+    GearsHeap,          // assets and mesh data
+    UtilHeap,           // string data and utility containers
+
+    NumHeapTypes
+};
+
+/// allocate a block of memory from the given heap
+void* Alloc(HeapType heapType, SizeT size);
+/// free a block of memory allocated from the given heap
+void Free(HeapType heapType, void* ptr);
+/// resize a block of memory, keeps its content
+void* Realloc(HeapType heapType, void* ptr, SizeT size);
+/// return the name of a heap
+const char* GetHeapName(HeapType heapType);
+
+#if PH_MEMORY_STATS
+/// the source location of an allocation
+struct AllocSite
+{
+    AllocSite(const char* f, int l) : file(f), line(l) {}
+    const char* file;
+    int line;
+};
+
+/// counters of a heap
+struct HeapStats
+{
+    SizeT liveBytes;        // bytes in blocks currently allocated
+    SizeT peakBytes;        // highest liveBytes so far
+    SizeT liveAllocs;       // blocks currently allocated
+    SizeT totalAllocs;      // heap calls since startup
+    SizeT frameAllocs;      // heap calls since NewFrame()
+    SizeT lastFrameAllocs;  // heap calls during the previous frame
+};
+
+/// allocate a block of memory and remember where it was allocated
+void* Alloc(HeapType heapType, SizeT size, const char* file, int line);
+/// get the counters of a heap
+HeapStats GetHeapStats(HeapType heapType);
+/// start counting the allocations of a new frame
+void NewFrame();
+/// print the blocks with a known call site which are still allocated, returns their number
+SizeT DumpLeaks();
+/// write the counters and the live blocks by call site as a JSON object
+void GetJsonSnapshot(String& json);
+#endif
+
+} // namespace Memory
+} // namespace Philo
+
+//------------------------------------------------------------------------------
+/**
+    The ph_new operators which record the call site, see memorydefine.h.
+*/
+#if PH_MEMORY_STATS
+#define PH_HEAP_ALLOC_SITE_OPERATORS(heapType) \
+    static void* operator new(size_t size, const Philo::Memory::AllocSite& site) { return Philo::Memory::Alloc(heapType, (SizeT) size, site.file, site.line); } \
+    static void* operator new[](size_t size, const Philo::Memory::AllocSite& site) { return Philo::Memory::Alloc(heapType, (SizeT) size, site.file, site.line); } \
+    static void operator delete(void* ptr, const Philo::Memory::AllocSite&) { Philo::Memory::Free(heapType, ptr); } \
+    static void operator delete[](void* ptr, const Philo::Memory::AllocSite&) { Philo::Memory::Free(heapType, ptr); }
+#else
+#define PH_HEAP_ALLOC_SITE_OPERATORS(heapType)
+#endif
+
+//------------------------------------------------------------------------------
+/**
+    Put into a class declaration to allocate its objects from a subsystem
+    heap. Derived classes inherit the heap unless they declare their own.
+*/
+#define PH_DECLARE_HEAP_ALLOC(heapType) \
+public: \
+    PH_HEAP_ALLOC_SITE_OPERATORS(heapType) \
+    static void* operator new(size_t size) { return Philo::Memory::Alloc(heapType, (SizeT) size); } \
+    static void* operator new[](size_t size) { return Philo::Memory::Alloc(heapType, (SizeT) size); } \
+    static void* operator new(size_t, void* place) { return place; } \
+    static void operator delete(void* ptr) { Philo::Memory::Free(heapType, ptr); } \
+    static void operator delete[](void* ptr) { Philo::Memory::Free(heapType, ptr); } \
+    static void operator delete(void*, void*) { } \
+private:
+
+#if PH_MEMORY_STATS
+//------------------------------------------------------------------------------
+/**
+    ph_new of a class without a heap declaration, the object stays on the
+    CRT heap and is not tracked.
+*/
+inline void*
+operator new(size_t size, const Philo::Memory::AllocSite&)
+{
+    return ::operator new(size);
+}
+
+inline void*
+operator new[](size_t size, const Philo::Memory::AllocSite&)
+{
+    return ::operator new[](size);
+}
+
+inline void
+operator delete(void* ptr, const Philo::Memory::AllocSite&)
+{
+    ::operator delete(ptr);
+}
+
+inline void
+operator delete[](void* ptr, const Philo::Memory::AllocSite&)
+{
+    ::operator delete[](ptr);
+}
+#endif
+//------------------------------------------------------------------------------
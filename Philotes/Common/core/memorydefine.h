@@ -1,6 +1,19 @@
 #pragma once
 
+#if PH_MEMORY_STATS
+// record the call site of every allocation (see core/memory.h)
+#define ph_new(type) new(Philo::Memory::AllocSite(__FILE__, __LINE__)) type
+#define ph_new_array(type, size) new(Philo::Memory::AllocSite(__FILE__, __LINE__)) type[size]
+#define ph_malloc(heapType, size) Philo::Memory::Alloc(heapType, size, __FILE__, __LINE__)
+#else
 #define ph_new(type) new type
 #define ph_new_array(type, size) new type[size]
+#define ph_malloc(heapType, size) Philo::Memory::Alloc(heapType, size)
+#endif
 #define ph_delete(ptr) delete ptr
 #define ph_delete_array(ptr) delete[] ptr
+#define ph_free(heapType, ptr) Philo::Memory::Free(heapType, ptr)
+
+// transient objects for the current frame, never deleted (see core/frameallocator.h)
+#define ph_new_frame(type) new(Philo::Memory::FrameHeap) type
+#define ph_new_frame_array(type, size) new(Philo::Memory::FrameHeap) type[size]
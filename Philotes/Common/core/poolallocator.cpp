@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+//  poolallocator.cpp
+//  (C) 2012 PhiloLabs
+//------------------------------------------------------------------------------
+
+#include "core/poolallocator.h"
+
+#include <new>
+
+namespace Philo
+{
+
+//------------------------------------------------------------------------------
+/**
+    Blocks are rounded up to pointer alignment and must at least hold the
+    free list link.
+*/
+PoolAllocator::PoolAllocator(SizeT size, SizeT numBlocksPerPage, Memory::HeapType heap) :
+    blockSize(0),
+    blocksPerPage(numBlocksPerPage),
+    heapType(heap),
+    freeList(0),
+    pages(0),
+    numPages(0),
+    numAllocatedBlocks(0)
+{
+    ph_assert(size > 0);
+    ph_assert(numBlocksPerPage > 0);
+    const SizeT align = sizeof(void*);
+    this->blockSize = (size < (SizeT) sizeof(FreeBlock)) ? (SizeT) sizeof(FreeBlock) : size;
+    this->blockSize = (this->blockSize + align - 1) & ~(align - 1);
+    InitializeCriticalSection(&this->lock);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PoolAllocator::~PoolAllocator()
+{
+    ph_assert2(0 == this->numAllocatedBlocks, "PoolAllocator: blocks still in use!");
+    Page* page = this->pages;
+    while (page)
+    {
+        Page* next = page->next;
+        Memory::Free(this->heapType, page);
+        page = next;
+    }
+    this->pages = 0;
+    this->freeList = 0;
+    DeleteCriticalSection(&this->lock);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+PoolAllocator*
+PoolAllocator::Acquire(PoolAllocator* volatile* pool, SizeT blockSize, SizeT blocksPerPage, Memory::HeapType heapType)
+{
+    PoolAllocator* result = *pool;
+    if (0 == result)
+    {
+        void* mem = Memory::Alloc(heapType, sizeof(PoolAllocator));
+        PoolAllocator* newPool = new(mem) PoolAllocator(blockSize, blocksPerPage, heapType);
+        result = (PoolAllocator*) InterlockedCompareExchangePointer((PVOID volatile*) pool, newPool, 0);
+        if (0 == result)
+        {
+            result = newPool;
+        }
+        else
+        {
+            newPool->~PoolAllocator();
+            Memory::Free(heapType, mem);
+        }
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The page header is padded to two pointers, so blocks keep the heap's
+    alignment.
+*/
+void
+PoolAllocator::AllocPage()
+{
+    char* mem = (char*) Memory::Alloc(this->heapType, sizeof(Page) + this->blockSize * this->blocksPerPage);
+    Page* page = (Page*) mem;
+    page->next = this->pages;
+    this->pages = page;
+    this->numPages++;
+
+    // link the blocks front to back, so they are handed out in address order
+    char* blocks = mem + sizeof(Page);
+    IndexT i;
+    for (i = this->blocksPerPage - 1; i >= 0; i--)
+    {
+        FreeBlock* block = (FreeBlock*) (blocks + i * this->blockSize);
+        block->next = this->freeList;
+        this->freeList = block;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void*
+PoolAllocator::Alloc()
+{
+    EnterCriticalSection(&this->lock);
+    if (0 == this->freeList)
+    {
+        this->AllocPage();
+    }
+    FreeBlock* block = this->freeList;
+    this->freeList = block->next;
+    this->numAllocatedBlocks++;
+    LeaveCriticalSection(&this->lock);
+    return block;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+PoolAllocator::Free(void* ptr)
+{
+    if (0 != ptr)
+    {
+        EnterCriticalSection(&this->lock);
+        ph_assert(this->numAllocatedBlocks > 0);
+        FreeBlock* block = (FreeBlock*) ptr;
+        block->next = this->freeList;
+        this->freeList = block;
+        this->numAllocatedBlocks--;
+        LeaveCriticalSection(&this->lock);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+bool
+PoolAllocator::Contains(const void* ptr) const
+{
+    const char* addr = (const char*) ptr;
+    const Page* page;
+    for (page = this->pages; 0 != page; page = page->next)
+    {
+        const char* blocks = ((const char*) page) + sizeof(Page);
+        if (addr >= blocks && addr < blocks + this->blockSize * this->blocksPerPage)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace Philo
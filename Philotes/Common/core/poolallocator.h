@@ -0,0 +1,158 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class PoolAllocator
+
+    Fixed size block allocator for small objects which are created and
+    destroyed often. Blocks are carved out of pages taken from a
+    subsystem heap, freed blocks go onto a free list and are handed out
+    again, so after warm-up creating an object costs no heap call at all
+    and the objects of one class stay packed together in a few pages.
+    Pages are only returned to the heap when the pool is destroyed.
+
+    Classes use a pool by putting PH_DECLARE_POOL_ALLOC(type, heapType,
+    blocksPerPage) into their declaration and PH_IMPLEMENT_POOL_ALLOC(type)
+    into their source file. Objects of derived classes with a different
+    size, and arrays, fall back to the heap.
+
+    Alloc() and Free() are thread-safe.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+#include "core/memory.h"
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+class PoolAllocator
+{
+public:
+    /// constructor
+    PoolAllocator(SizeT blockSize, SizeT blocksPerPage, Memory::HeapType heapType);
+    /// destructor, returns all pages to the heap
+    ~PoolAllocator();
+
+    /// get a block
+    void* Alloc();
+    /// return a block
+    void Free(void* ptr);
+    /// return true if a block belongs to this pool (slow, walks all pages)
+    bool Contains(const void* ptr) const;
+
+    /// size of a block in bytes
+    SizeT GetBlockSize() const;
+    /// number of blocks currently handed out
+    SizeT GetNumAllocatedBlocks() const;
+    /// number of pages taken from the heap
+    SizeT GetNumPages() const;
+
+    /// return the pool in *pool, create it if it doesn't exist yet (thread-safe)
+    static PoolAllocator* Acquire(PoolAllocator* volatile* pool, SizeT blockSize, SizeT blocksPerPage, Memory::HeapType heapType);
+
+private:
+    /// a free block, links to the next free one
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+    /// a page of blocks, followed by the blocks
+    struct Page
+    {
+        Page* next;
+        void* padding;
+    };
+
+    /// take a new page from the heap and put its blocks onto the free list
+    void AllocPage();
+
+    SizeT blockSize;
+    SizeT blocksPerPage;
+    Memory::HeapType heapType;
+    CRITICAL_SECTION lock;
+    FreeBlock* freeList;
+    Page* pages;
+    SizeT numPages;
+    SizeT numAllocatedBlocks;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+PoolAllocator::GetBlockSize() const
+{
+    return this->blockSize;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+PoolAllocator::GetNumAllocatedBlocks() const
+{
+    return this->numAllocatedBlocks;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+PoolAllocator::GetNumPages() const
+{
+    return this->numPages;
+}
+
+} // namespace Philo
+
+//------------------------------------------------------------------------------
+/**
+    Put into a class declaration to allocate its objects from a pool. The
+    pool is created on first use and never destroyed, so objects may be
+    created and destroyed by static initializers and destructors.
+*/
+#if PH_MEMORY_STATS
+#define PH_POOL_ALLOC_SITE_OPERATORS(type, heapType) \
+    static void* operator new(size_t size, const Philo::Memory::AllocSite& site) \
+    { \
+        return (sizeof(type) == size) ? GetObjectPool()->Alloc() : Philo::Memory::Alloc(heapType, (SizeT) size, site.file, site.line); \
+    } \
+    static void* operator new[](size_t size, const Philo::Memory::AllocSite& site) { return Philo::Memory::Alloc(heapType, (SizeT) size, site.file, site.line); } \
+    static void operator delete(void* ptr, const Philo::Memory::AllocSite&) \
+    { \
+        if (GetObjectPool()->Contains(ptr)) GetObjectPool()->Free(ptr); \
+        else Philo::Memory::Free(heapType, ptr); \
+    } \
+    static void operator delete[](void* ptr, const Philo::Memory::AllocSite&) { Philo::Memory::Free(heapType, ptr); }
+#else
+#define PH_POOL_ALLOC_SITE_OPERATORS(type, heapType)
+#endif
+
+#define PH_DECLARE_POOL_ALLOC(type, heapType, blocksPerPage) \
+private: \
+    static Philo::PoolAllocator* volatile objectPool; \
+    static Philo::PoolAllocator* GetObjectPool() \
+    { \
+        Philo::PoolAllocator* pool = objectPool; \
+        return pool ? pool : Philo::PoolAllocator::Acquire(&objectPool, sizeof(type), blocksPerPage, heapType); \
+    } \
+public: \
+    PH_POOL_ALLOC_SITE_OPERATORS(type, heapType) \
+    static void* operator new(size_t size) \
+    { \
+        return (sizeof(type) == size) ? GetObjectPool()->Alloc() : Philo::Memory::Alloc(heapType, (SizeT) size); \
+    } \
+    static void* operator new[](size_t size) { return Philo::Memory::Alloc(heapType, (SizeT) size); } \
+    static void* operator new(size_t, void* place) { return place; } \
+    static void operator delete(void* ptr, size_t size) \
+    { \
+        if (sizeof(type) == size) GetObjectPool()->Free(ptr); \
+        else Philo::Memory::Free(heapType, ptr); \
+    } \
+    static void operator delete[](void* ptr) { Philo::Memory::Free(heapType, ptr); } \
+    static void operator delete(void*, void*) { } \
+private:
+
+#define PH_IMPLEMENT_POOL_ALLOC(type) \
+Philo::PoolAllocator* volatile type::objectPool = 0;
+//------------------------------------------------------------------------------
@@ -0,0 +1,108 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class TypeTraits
+
+    Compile time properties of element types, used by the container
+    classes to pick faster ways of moving elements around.
+
+    IsTriviallyCopyable: the type may be copied and relocated with
+    memcpy/memmove instead of element wise assignment. True for the
+    built-in types and pointers, other types opt in with
+    PH_DECLARE_TRIVIALLY_COPYABLE(type) at global scope.
+
+    HasSwap: the type has a cheap "void Swap(TYPE& rhs)" method which
+    exchanges contents without copying them (typically by swapping heap
+    pointers). Containers then relocate elements by swapping instead of
+    copy assignment, the pre-C++11 stand-in for move semantics. Types opt
+    in with PH_DECLARE_HAS_SWAP(type).
+
+    (C) 2012 PhiloLabs
+*/
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+template<class TYPE> struct TypeTraits
+{
+    enum { IsTriviallyCopyable = false };
+    enum { HasSwap = false };
+};
+
+template<class TYPE> struct TypeTraits<TYPE*>
+{
+    enum { IsTriviallyCopyable = true };
+    enum { HasSwap = false };
+};
+
+//------------------------------------------------------------------------------
+/**
+    Moves the content of one element into another, the source is left in a
+    valid but unspecified state.
+*/
+template<bool HASSWAP> struct ElementMover
+{
+    template<class TYPE> static void Move(TYPE& to, TYPE& from)
+    {
+        to = from;
+    }
+};
+
+template<> struct ElementMover<true>
+{
+    template<class TYPE> static void Move(TYPE& to, TYPE& from)
+    {
+        to.Swap(from);
+    }
+};
+
+//------------------------------------------------------------------------------
+/**
+    Compile time check for containers which only work with trivially
+    copyable elements: sizeof(RequireTriviallyCopyable<...>) doesn't
+    compile for other types, since only the true case is defined.
+*/
+template<bool TRIVIALLYCOPYABLE> struct RequireTriviallyCopyable;
+template<> struct RequireTriviallyCopyable<true>
+{
+    enum { Value = true };
+};
+
+} // namespace Philo
+
+//------------------------------------------------------------------------------
+#define PH_DECLARE_TRIVIALLY_COPYABLE(type) \
+namespace Philo \
+{ \
+template<> struct TypeTraits<type> \
+{ \
+    enum { IsTriviallyCopyable = true }; \
+    enum { HasSwap = false }; \
+}; \
+}
+
+#define PH_DECLARE_HAS_SWAP(type) \
+namespace Philo \
+{ \
+template<> struct TypeTraits<type> \
+{ \
+    enum { IsTriviallyCopyable = false }; \
+    enum { HasSwap = true }; \
+}; \
+}
+
+PH_DECLARE_TRIVIALLY_COPYABLE(bool)
+PH_DECLARE_TRIVIALLY_COPYABLE(char)
+PH_DECLARE_TRIVIALLY_COPYABLE(signed char)
+PH_DECLARE_TRIVIALLY_COPYABLE(unsigned char)
+PH_DECLARE_TRIVIALLY_COPYABLE(short)
+PH_DECLARE_TRIVIALLY_COPYABLE(unsigned short)
+PH_DECLARE_TRIVIALLY_COPYABLE(int)
+PH_DECLARE_TRIVIALLY_COPYABLE(unsigned int)
+PH_DECLARE_TRIVIALLY_COPYABLE(long)
+PH_DECLARE_TRIVIALLY_COPYABLE(unsigned long)
+PH_DECLARE_TRIVIALLY_COPYABLE(__int64)
+PH_DECLARE_TRIVIALLY_COPYABLE(unsigned __int64)
+PH_DECLARE_TRIVIALLY_COPYABLE(float)
+PH_DECLARE_TRIVIALLY_COPYABLE(double)
+//------------------------------------------------------------------------------
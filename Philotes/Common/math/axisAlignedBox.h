@@ -411,6 +411,11 @@ namespace Philo {
 			if( mExtent != EXTENT_FINITE )
 				return;
 
+#if PH_MATH_SIMD
+			scalar newMin[4], newMax[4];
+			Simd::TransformBox(newMin, newMax, matrix[0], &mMinimum.x, &mMaximum.x);
+			setExtents(Vector3(newMin[0], newMin[1], newMin[2]), Vector3(newMax[0], newMax[1], newMax[2]));
+#else
 			Vector3 oldMin, oldMax, currentCorner;
 
 			// Getting the old values so that we can use the existing merge method.
@@ -459,6 +464,7 @@ namespace Philo {
 			// max min min
 			currentCorner.z = oldMin.z;
 			merge( matrix * currentCorner ); 
+#endif
 		}
 
 		/** Transforms the box according to the affine matrix supplied.
@@ -483,6 +489,14 @@ namespace Philo {
 			Vector3 centre = getCenter();
 			Vector3 halfSize = getHalfSize();
 
+#if PH_MATH_SIMD
+			__m128 newCentre = Simd::Transform(m[0], _mm_setr_ps(centre.x, centre.y, centre.z, 1.0f));
+			__m128 newHalfSize = Simd::TransformAbs(m[0], _mm_setr_ps(halfSize.x, halfSize.y, halfSize.z, 0.0f));
+			scalar newMin[4], newMax[4];
+			Simd::Store(newMin, _mm_sub_ps(newCentre, newHalfSize));
+			Simd::Store(newMax, _mm_add_ps(newCentre, newHalfSize));
+			setExtents(Vector3(newMin[0], newMin[1], newMin[2]), Vector3(newMax[0], newMax[1], newMax[2]));
+#else
 			Vector3 newCentre = m.transformAffine(centre);
 			Vector3 newHalfSize(
 				fabs(m[0][0]) * halfSize.x + fabs(m[0][1]) * halfSize.y + fabs(m[0][2]) * halfSize.z, 
@@ -490,6 +504,7 @@ namespace Philo {
 				fabs(m[2][0]) * halfSize.x + fabs(m[2][1]) * halfSize.y + fabs(m[2][2]) * halfSize.z);
 
 			setExtents(newCentre - newHalfSize, newCentre + newHalfSize);
+#endif
 		}
 
 		/** Sets the box to a 'null' value i.e. not a box.
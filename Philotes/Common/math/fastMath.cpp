@@ -0,0 +1,14 @@
+
+
+#include "fastMath.h"
+
+namespace Philo
+{
+	const scalar FastMath::PI = 3.14159265358979f;
+	const scalar FastMath::HALF_PI = 1.57079632679490f;
+	const scalar FastMath::TWO_OVER_PI = 0.636619772367581f;
+	const scalar FastMath::SQRT_TWO = 1.41421356237310f;
+	const scalar FastMath::PIO2_1 = 1.5703125f;
+	const scalar FastMath::PIO2_2 = 4.837512969970703125e-4f;
+	const scalar FastMath::PIO2_3 = 7.54978995489188216e-8f;
+}
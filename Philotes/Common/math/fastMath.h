@@ -0,0 +1,362 @@
+#pragma once
+
+#include "core/config.h"
+#include "scalar.h"
+#include "simd.h"
+
+namespace Philo
+{
+
+	/** Polynomial approximations of transcendental functions, in a scalar version
+		and, with PH_MATH_SIMD, a version which works on 4 values at once.
+	@remarks
+		Both versions use the same range reduction and the same polynomials and
+		need nothing but basic arithmetic, so they give the same results on every
+		platform and compiler. The maximum errors against the double precision
+		C library, measured over the given range:
+	@par
+		Sin, Cos	absolute 8e-8 for |x| <= 8192, grows with |x| beyond
+		ATan2		absolute 3e-7 radians
+		ACos		absolute 3e-7 radians, x is clamped to [-1, 1]
+		RSqrt		relative 2.6e-7 (exact 1 / sqrt without PH_MATH_SIMD), x > 0
+		Exp2		relative 2.5e-7, x is clamped to [-126, 127]
+		Log2		absolute 6e-7 for x in [1e-3, 1e4], less than 1 ulp of the
+					result; x must be a positive normal number
+	@par
+		Math::Sin and Math::Cos use Sin and Cos when PH_MATH_FAST_TRIG is set in
+		core/config.h.
+	*/
+	class FastMath
+	{
+	public:
+		static inline scalar Sin(scalar x)
+		{
+			int q = roundToInt(x * TWO_OVER_PI);
+			scalar r = reduceHalfPi(x, (scalar)q);
+			scalar s = (q & 1) ? cosPoly(r) : sinPoly(r);
+			return (q & 2) ? -s : s;
+		}
+
+		static inline scalar Cos(scalar x)
+		{
+			int q = roundToInt(x * TWO_OVER_PI);
+			scalar r = reduceHalfPi(x, (scalar)q);
+			scalar c = (q & 1) ? sinPoly(r) : cosPoly(r);
+			return ((q + 1) & 2) ? -c : c;
+		}
+
+		static inline scalar ATan2(scalar y, scalar x)
+		{
+			scalar ax = fabs(x);
+			scalar ay = fabs(y);
+			scalar mn = ax < ay ? ax : ay;
+			scalar mx = ax < ay ? ay : ax;
+			scalar r = atanPoly(mx > 0.0f ? mn / mx : 0.0f);
+			if (ay > ax)
+				r = HALF_PI - r;
+			if (signBit(x))
+				r = PI - r;
+			return signBit(y) ? -r : r;
+		}
+
+		static inline scalar ACos(scalar x)
+		{
+			x = x < -1.0f ? -1.0f : (x > 1.0f ? 1.0f : x);
+			scalar a = fabs(x);
+			if (a > 0.5f)
+			{
+				// acos(a) = 2 asin(sqrt((1 - a) / 2))
+				scalar z = 0.5f * (1.0f - a);
+				scalar p = 2.0f * asinPoly(sqrt(z), z);
+				return x > 0.0f ? p : PI - p;
+			}
+			scalar p = asinPoly(a, a * a);
+			return x < 0.0f ? HALF_PI + p : HALF_PI - p;
+		}
+
+		static inline scalar RSqrt(scalar x)
+		{
+#if PH_MATH_SIMD
+			__m128 v = _mm_set_ss(x);
+			return _mm_cvtss_f32(rsqrtNewton(v, _mm_rsqrt_ss(v)));
+#else
+			return 1.0f / sqrt(x);
+#endif
+		}
+
+		static inline scalar Exp2(scalar x)
+		{
+			x = x < -126.0f ? -126.0f : (x > 127.0f ? 127.0f : x);
+			int i = roundToInt(x);
+			FloatBits scale;
+			scale.i = (uint32)(i + 127) << 23;
+			return exp2Poly(x - (scalar)i) * scale.f;
+		}
+
+		static inline scalar Log2(scalar x)
+		{
+			FloatBits bits;
+			bits.f = x;
+			scalar e = (scalar)((int)((bits.i >> 23) & 0xff) - 127);
+			bits.i = (bits.i & 0x007fffff) | 0x3f800000;
+			scalar m = bits.f;
+			if (m > SQRT_TWO)
+			{
+				m *= 0.5f;
+				e += 1.0f;
+			}
+			return e + log2Poly((m - 1.0f) / (m + 1.0f));
+		}
+
+#if PH_MATH_SIMD
+		static inline __m128 Sin(__m128 x)
+		{
+			__m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+			__m128 r = reduceHalfPi(x, _mm_cvtepi32_ps(q));
+			__m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+			__m128 s = select(odd, cosPoly(r), sinPoly(r));
+			return _mm_xor_ps(s, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30)));
+		}
+
+		static inline __m128 Cos(__m128 x)
+		{
+			__m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+			__m128 r = reduceHalfPi(x, _mm_cvtepi32_ps(q));
+			__m128 odd = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+			__m128 c = select(odd, sinPoly(r), cosPoly(r));
+			__m128i q1 = _mm_add_epi32(q, _mm_set1_epi32(1));
+			return _mm_xor_ps(c, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q1, _mm_set1_epi32(2)), 30)));
+		}
+
+		static inline __m128 ATan2(__m128 y, __m128 x)
+		{
+			__m128 ax = abs(x);
+			__m128 ay = abs(y);
+			__m128 mn = _mm_min_ps(ax, ay);
+			__m128 mx = _mm_max_ps(ax, ay);
+			__m128 valid = _mm_cmpgt_ps(mx, _mm_setzero_ps());
+			__m128 r = atanPoly(_mm_and_ps(valid, _mm_div_ps(mn, mx)));
+			r = select(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(HALF_PI), r), r);
+			r = select(signMask(x), _mm_sub_ps(_mm_set1_ps(PI), r), r);
+			return _mm_xor_ps(r, _mm_and_ps(y, _mm_set1_ps(-0.0f)));
+		}
+
+		static inline __m128 ACos(__m128 x)
+		{
+			x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+			__m128 a = abs(x);
+			__m128 big = _mm_cmpgt_ps(a, _mm_set1_ps(0.5f));
+			__m128 zBig = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_sub_ps(_mm_set1_ps(1.0f), a));
+			__m128 t = select(big, _mm_sqrt_ps(zBig), a);
+			__m128 p = asinPoly(t, select(big, zBig, _mm_mul_ps(a, a)));
+			// |x| > 0.5: 2 p or pi - 2 p, otherwise pi / 2 -+ p
+			__m128 p2 = _mm_add_ps(p, p);
+			__m128 rBig = select(_mm_cmpgt_ps(x, _mm_setzero_ps()), p2, _mm_sub_ps(_mm_set1_ps(PI), p2));
+			__m128 rSmall = _mm_sub_ps(_mm_set1_ps(HALF_PI), _mm_xor_ps(p, _mm_and_ps(x, _mm_set1_ps(-0.0f))));
+			return select(big, rBig, rSmall);
+		}
+
+		static inline __m128 RSqrt(__m128 x)
+		{
+			return rsqrtNewton(x, _mm_rsqrt_ps(x));
+		}
+
+		static inline __m128 Exp2(__m128 x)
+		{
+			x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.0f));
+			__m128i i = _mm_cvtps_epi32(x);
+			__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23));
+			return _mm_mul_ps(exp2Poly(_mm_sub_ps(x, _mm_cvtepi32_ps(i))), scale);
+		}
+
+		static inline __m128 Log2(__m128 x)
+		{
+			__m128i bits = _mm_castps_si128(x);
+			__m128i exponent = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(127));
+			__m128 e = _mm_cvtepi32_ps(exponent);
+			__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+			__m128 above = _mm_cmpgt_ps(m, _mm_set1_ps(SQRT_TWO));
+			m = select(above, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+			e = _mm_add_ps(e, _mm_and_ps(above, _mm_set1_ps(1.0f)));
+			__m128 one = _mm_set1_ps(1.0f);
+			return _mm_add_ps(e, log2Poly(_mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one))));
+		}
+#endif
+
+	private:
+		union FloatBits
+		{
+			scalar f;
+			uint32 i;
+		};
+
+		static const scalar PI;
+		static const scalar HALF_PI;
+		static const scalar TWO_OVER_PI;
+		static const scalar SQRT_TWO;
+		// pi / 2 split in 3 parts, the first two have few enough bits to be multiplied exactly
+		static const scalar PIO2_1;
+		static const scalar PIO2_2;
+		static const scalar PIO2_3;
+
+		/// nearest integer with halves to even, as _mm_cvtps_epi32 rounds in the default mode
+		static inline int roundToInt(scalar x)
+		{
+			scalar f = floor(x);
+			int i = (int)f;
+			scalar d = x - f;
+			if (d > 0.5f || (d == 0.5f && (i & 1)))
+				i++;
+			return i;
+		}
+
+		static inline bool signBit(scalar x)
+		{
+			FloatBits bits;
+			bits.f = x;
+			return (bits.i >> 31) != 0;
+		}
+
+		/// x - q pi / 2, in [-pi / 4, pi / 4] for the nearest q
+		static inline scalar reduceHalfPi(scalar x, scalar q)
+		{
+			return ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+		}
+
+		/// sin(r) for |r| <= pi / 4
+		static inline scalar sinPoly(scalar r)
+		{
+			scalar z = r * r;
+			return ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+		}
+
+		/// cos(r) for |r| <= pi / 4
+		static inline scalar cosPoly(scalar r)
+		{
+			scalar z = r * r;
+			return ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+		}
+
+		/// atan(a) for a in [0, 1]
+		static inline scalar atanPoly(scalar a)
+		{
+			scalar base = 0.0f;
+			if (a > 0.41421356f)
+			{
+				// atan(a) = pi / 4 + atan((a - 1) / (a + 1))
+				a = (a - 1.0f) / (a + 1.0f);
+				base = 0.25f * PI;
+			}
+			scalar z = a * a;
+			return (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * a + a + base;
+		}
+
+		/// asin(t) for t in [0, 0.5], z = t * t
+		static inline scalar asinPoly(scalar t, scalar z)
+		{
+			return ((((4.2163199048e-2f * z + 2.4181311049e-2f) * z + 4.5470025998e-2f) * z + 7.4953002686e-2f) * z + 1.6666752422e-1f) * z * t + t;
+		}
+
+		/// 2^f for f in [-0.5, 0.5], Taylor series to f^6
+		static inline scalar exp2Poly(scalar f)
+		{
+			return ((((((1.5403530393e-4f * f + 1.3333558146e-3f) * f + 9.6181291076e-3f) * f + 5.5504108665e-2f) * f
+				+ 2.4022650696e-1f) * f + 6.9314718056e-1f) * f) + 1.0f;
+		}
+
+		/// log2((1 + t) / (1 - t)) for |t| <= 0.1716, atanh series to t^7
+		static inline scalar log2Poly(scalar t)
+		{
+			scalar z = t * t;
+			return (((4.1219858311e-1f * z + 5.7707801636e-1f) * z + 9.6179669393e-1f) * z + 2.8853900818f) * t;
+		}
+
+#if PH_MATH_SIMD
+		static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+
+		static inline __m128 abs(__m128 v)
+		{
+			return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+		}
+
+		/// all bits set where the sign bit of v is set
+		static inline __m128 signMask(__m128 v)
+		{
+			return _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(v), 31));
+		}
+
+		/// one Newton-Raphson step on the 12 bit rsqrt estimate y
+		static inline __m128 rsqrtNewton(__m128 x, __m128 y)
+		{
+			__m128 xyy = _mm_mul_ps(_mm_mul_ps(x, y), y);
+			return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), xyy));
+		}
+
+		static inline __m128 reduceHalfPi(__m128 x, __m128 q)
+		{
+			x = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PIO2_1)));
+			x = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PIO2_2)));
+			return _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PIO2_3)));
+		}
+
+		static inline __m128 poly(__m128 z, scalar c0, scalar c1, scalar c2)
+		{
+			return _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(c0), z), _mm_set1_ps(c1)), z), _mm_set1_ps(c2));
+		}
+
+		static inline __m128 sinPoly(__m128 r)
+		{
+			__m128 z = _mm_mul_ps(r, r);
+			__m128 p = poly(z, -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f);
+			return _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), r), r);
+		}
+
+		static inline __m128 cosPoly(__m128 r)
+		{
+			__m128 z = _mm_mul_ps(r, r);
+			__m128 p = poly(z, 2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f);
+			p = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(p, z), z), _mm_mul_ps(_mm_set1_ps(0.5f), z));
+			return _mm_add_ps(p, _mm_set1_ps(1.0f));
+		}
+
+		static inline __m128 atanPoly(__m128 a)
+		{
+			__m128 reduce = _mm_cmpgt_ps(a, _mm_set1_ps(0.41421356f));
+			__m128 one = _mm_set1_ps(1.0f);
+			a = select(reduce, _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one)), a);
+			__m128 base = _mm_and_ps(reduce, _mm_set1_ps(0.25f * PI));
+			__m128 z = _mm_mul_ps(a, a);
+			__m128 p = _mm_sub_ps(_mm_mul_ps(poly(z, 8.05374449538e-2f, -1.38776856032e-1f, 1.99777106478e-1f), z), _mm_set1_ps(3.33329491539e-1f));
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), a), a), base);
+		}
+
+		static inline __m128 asinPoly(__m128 t, __m128 z)
+		{
+			__m128 p = poly(z, 4.2163199048e-2f, 2.4181311049e-2f, 4.5470025998e-2f);
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(7.4953002686e-2f));
+			p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(1.6666752422e-1f));
+			return _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), t), t);
+		}
+
+		static inline __m128 exp2Poly(__m128 f)
+		{
+			__m128 p = poly(f, 1.5403530393e-4f, 1.3333558146e-3f, 9.6181291076e-3f);
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.5504108665e-2f));
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.4022650696e-1f));
+			p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.9314718056e-1f));
+			return _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+		}
+
+		static inline __m128 log2Poly(__m128 t)
+		{
+			__m128 z = _mm_mul_ps(t, t);
+			__m128 p = poly(z, 4.1219858311e-1f, 5.7707801636e-1f, 9.6179669393e-1f);
+			return _mm_mul_ps(_mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(2.8853900818f)), t);
+		}
+#endif
+	};
+
+}
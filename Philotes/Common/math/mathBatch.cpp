@@ -0,0 +1,327 @@
+
+
+#include "mathBatch.h"
+
+namespace Philo
+{
+	namespace
+	{
+		inline const scalar* elementAt(const Vector3* base, size_t stride, size_t index)
+		{
+			return (const scalar*)((const char*)base + stride * index);
+		}
+
+		inline scalar* elementAt(Vector3* base, size_t stride, size_t index)
+		{
+			return (scalar*)((char*)base + stride * index);
+		}
+
+		/// the upper 3x4 of a row-major matrix times (x, y, z, point ? 1 : 0)
+		inline void transformScalar(const scalar* m, const scalar* v, scalar* out, bool point)
+		{
+			scalar x = v[0], y = v[1], z = v[2];
+			out[0] = m[0] * x + m[1] * y + m[2]  * z;
+			out[1] = m[4] * x + m[5] * y + m[6]  * z;
+			out[2] = m[8] * x + m[9] * y + m[10] * z;
+			if (point)
+			{
+				out[0] += m[3];
+				out[1] += m[7];
+				out[2] += m[11];
+			}
+		}
+
+#if PH_MATH_SIMD
+		/// the upper 3x4 of a matrix with every element broadcast, for 4 vectors in SoA form
+		struct SoaMatrix
+		{
+			__m128 e[3][4];
+
+			explicit SoaMatrix(const scalar* m)
+			{
+				for (int row = 0; row < 3; ++row)
+					for (int col = 0; col < 4; ++col)
+						e[row][col] = _mm_set1_ps(m[row * 4 + col]);
+			}
+		};
+
+		/// the columns of a matrix, for one vector at a time
+		struct ColumnMatrix
+		{
+			__m128 c[4];
+
+			explicit ColumnMatrix(const scalar* m)
+			{
+				c[0] = Simd::Load(m);
+				c[1] = Simd::Load(m + 4);
+				c[2] = Simd::Load(m + 8);
+				c[3] = Simd::Load(m + 12);
+				_MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+			}
+		};
+
+		inline void transformSoa(const SoaMatrix& m, __m128& x, __m128& y, __m128& z, bool point)
+		{
+			__m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.e[0][0], x), _mm_mul_ps(m.e[0][1], y)), _mm_mul_ps(m.e[0][2], z));
+			__m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.e[1][0], x), _mm_mul_ps(m.e[1][1], y)), _mm_mul_ps(m.e[1][2], z));
+			__m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m.e[2][0], x), _mm_mul_ps(m.e[2][1], y)), _mm_mul_ps(m.e[2][2], z));
+			if (point)
+			{
+				rx = _mm_add_ps(rx, m.e[0][3]);
+				ry = _mm_add_ps(ry, m.e[1][3]);
+				rz = _mm_add_ps(rz, m.e[2][3]);
+			}
+			x = rx;
+			y = ry;
+			z = rz;
+		}
+
+		inline __m128 transformColumns(const ColumnMatrix& m, __m128 v, bool point)
+		{
+			__m128 r = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(m.c[0], PH_SIMD_SWIZZLE(v, 0, 0, 0, 0)), _mm_mul_ps(m.c[1], PH_SIMD_SWIZZLE(v, 1, 1, 1, 1))),
+				_mm_mul_ps(m.c[2], PH_SIMD_SWIZZLE(v, 2, 2, 2, 2)));
+			return point ? _mm_add_ps(r, m.c[3]) : r;
+		}
+
+		/** Loads 4 packed Vector3 (12 scalars) as x, y and z of 4 vectors.
+		*/
+		inline void loadPacked4(const scalar* p, __m128& x, __m128& y, __m128& z)
+		{
+			__m128 a = Simd::Load(p);		// x0 y0 z0 x1
+			__m128 b = Simd::Load(p + 4);	// y1 z1 x2 y2
+			__m128 c = Simd::Load(p + 8);	// z2 x3 y3 z3
+			__m128 t0 = PH_SIMD_SHUFFLE(b, c, 2, 3, 0, 1);		// x2 y2 z2 x3
+			__m128 t1 = PH_SIMD_SHUFFLE(a, b, 1, 2, 0, 1);		// y0 z0 y1 z1
+			__m128 t2 = PH_SIMD_SHUFFLE(t0, c, 1, 2, 2, 3);	// y2 z2 y3 z3
+			x = PH_SIMD_SHUFFLE(a, t0, 0, 3, 0, 3);
+			y = PH_SIMD_SHUFFLE(t1, t2, 0, 2, 0, 2);
+			z = PH_SIMD_SHUFFLE(t1, t2, 1, 3, 1, 3);
+		}
+
+		/** Stores x, y and z of 4 vectors as 4 packed Vector3.
+		*/
+		inline void storePacked4(scalar* p, __m128 x, __m128 y, __m128 z)
+		{
+			__m128 xy01 = _mm_unpacklo_ps(x, y);	// x0 y0 x1 y1
+			__m128 zx01 = _mm_unpacklo_ps(z, x);	// z0 x0 z1 x1
+			__m128 yz01 = _mm_unpacklo_ps(y, z);	// y0 z0 y1 z1
+			__m128 xy23 = _mm_unpackhi_ps(x, y);	// x2 y2 x3 y3
+			__m128 zx23 = _mm_unpackhi_ps(z, x);	// z2 x2 z3 x3
+			__m128 yz23 = _mm_unpackhi_ps(y, z);	// y2 z2 y3 z3
+			Simd::Store(p,     PH_SIMD_SHUFFLE(xy01, zx01, 0, 1, 0, 3));
+			Simd::Store(p + 4, PH_SIMD_SHUFFLE(yz01, xy23, 2, 3, 0, 1));
+			Simd::Store(p + 8, PH_SIMD_SHUFFLE(zx23, yz23, 0, 3, 2, 3));
+		}
+#endif
+
+		void transformArray(const Matrix4& xform, const Vector3* src, Vector3* dst, size_t count,
+			size_t srcStride, size_t dstStride, bool point)
+		{
+			const scalar* m = xform[0];
+			size_t i = 0;
+#if PH_MATH_SIMD
+			if (srcStride == sizeof(Vector3) && dstStride == sizeof(Vector3))
+			{
+				SoaMatrix soa(m);
+				const scalar* s = &src->x;
+				scalar* d = &dst->x;
+				for (; i + 4 <= count; i += 4, s += 12, d += 12)
+				{
+					__m128 x, y, z;
+					loadPacked4(s, x, y, z);
+					transformSoa(soa, x, y, z, point);
+					storePacked4(d, x, y, z);
+				}
+			}
+			ColumnMatrix columns(m);
+			for (; i < count; ++i)
+			{
+				__m128 v = Simd::LoadVector3(elementAt(src, srcStride, i));
+				Simd::StoreVector3(elementAt(dst, dstStride, i), transformColumns(columns, v, point));
+			}
+#else
+			for (; i < count; ++i)
+			{
+				transformScalar(m, elementAt(src, srcStride, i), elementAt(dst, dstStride, i), point);
+			}
+#endif
+		}
+
+		void transformArraySoa(const Matrix4& xform, const scalar* srcX, const scalar* srcY, const scalar* srcZ,
+			scalar* dstX, scalar* dstY, scalar* dstZ, size_t count, bool point)
+		{
+			const scalar* m = xform[0];
+			size_t i = 0;
+#if PH_MATH_SIMD
+			SoaMatrix soa(m);
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 x = Simd::Load(srcX + i);
+				__m128 y = Simd::Load(srcY + i);
+				__m128 z = Simd::Load(srcZ + i);
+				transformSoa(soa, x, y, z, point);
+				Simd::Store(dstX + i, x);
+				Simd::Store(dstY + i, y);
+				Simd::Store(dstZ + i, z);
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				scalar v[3] = { srcX[i], srcY[i], srcZ[i] };
+				scalar r[3];
+				transformScalar(m, v, r, point);
+				dstX[i] = r[0];
+				dstY[i] = r[1];
+				dstZ[i] = r[2];
+			}
+		}
+	}
+
+	//-----------------------------------------------------------------------
+	void MathBatch::transformPoints(const Matrix4& xform, const Vector3* src, Vector3* dst, size_t count,
+		size_t srcStride, size_t dstStride)
+	{
+		ph_assert(xform.isAffine());
+		transformArray(xform, src, dst, count, srcStride, dstStride, true);
+	}
+	//-----------------------------------------------------------------------
+	void MathBatch::transformNormals(const Matrix4& xform, const Vector3* src, Vector3* dst, size_t count,
+		size_t srcStride, size_t dstStride)
+	{
+		transformArray(xform, src, dst, count, srcStride, dstStride, false);
+	}
+	//-----------------------------------------------------------------------
+	void MathBatch::transformPoints(const Matrix4& xform, const scalar* srcX, const scalar* srcY, const scalar* srcZ,
+		scalar* dstX, scalar* dstY, scalar* dstZ, size_t count)
+	{
+		ph_assert(xform.isAffine());
+		transformArraySoa(xform, srcX, srcY, srcZ, dstX, dstY, dstZ, count, true);
+	}
+	//-----------------------------------------------------------------------
+	void MathBatch::transformNormals(const Matrix4& xform, const scalar* srcX, const scalar* srcY, const scalar* srcZ,
+		scalar* dstX, scalar* dstY, scalar* dstZ, size_t count)
+	{
+		transformArraySoa(xform, srcX, srcY, srcZ, dstX, dstY, dstZ, count, false);
+	}
+	//-----------------------------------------------------------------------
+	void MathBatch::normalise(Vector3* vectors, size_t count, size_t stride)
+	{
+		size_t i = 0;
+#if PH_MATH_SIMD
+		if (stride == sizeof(Vector3))
+		{
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 minLength = _mm_set1_ps(1e-08f);
+			scalar* p = &vectors->x;
+			for (; i + 4 <= count; i += 4, p += 12)
+			{
+				__m128 x, y, z;
+				loadPacked4(p, x, y, z);
+				__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+				// zero-sized vectors are scaled by 1
+				__m128 valid = _mm_cmpgt_ps(length, minLength);
+				__m128 invLength = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(one, length)), _mm_andnot_ps(valid, one));
+				storePacked4(p, _mm_mul_ps(x, invLength), _mm_mul_ps(y, invLength), _mm_mul_ps(z, invLength));
+			}
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			((Vector3*)elementAt(vectors, stride, i))->normalise();
+		}
+	}
+	//-----------------------------------------------------------------------
+	AxisAlignedBox MathBatch::computeBounds(const Vector3* points, size_t count, size_t stride)
+	{
+		AxisAlignedBox box;
+		if (count == 0)
+			return box;
+
+		Vector3 vmin, vmax;
+#if PH_MATH_SIMD
+		__m128 first = Simd::LoadVector3(&points->x);
+		__m128 resultMin = first;
+		__m128 resultMax = first;
+		size_t i = 1;
+		if (stride == sizeof(Vector3) && count >= 4)
+		{
+			__m128 minX, minY, minZ;
+			loadPacked4(&points->x, minX, minY, minZ);
+			__m128 maxX = minX, maxY = minY, maxZ = minZ;
+			const scalar* p = &points->x + 12;
+			for (i = 4; i + 4 <= count; i += 4, p += 12)
+			{
+				__m128 x, y, z;
+				loadPacked4(p, x, y, z);
+				minX = _mm_min_ps(minX, x);
+				minY = _mm_min_ps(minY, y);
+				minZ = _mm_min_ps(minZ, z);
+				maxX = _mm_max_ps(maxX, x);
+				maxY = _mm_max_ps(maxY, y);
+				maxZ = _mm_max_ps(maxZ, z);
+			}
+			// back to 4 vectors of x, y, z and reduce them
+			__m128 minW = _mm_setzero_ps();
+			__m128 maxW = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(minX, minY, minZ, minW);
+			_MM_TRANSPOSE4_PS(maxX, maxY, maxZ, maxW);
+			resultMin = _mm_min_ps(_mm_min_ps(minX, minY), _mm_min_ps(minZ, minW));
+			resultMax = _mm_max_ps(_mm_max_ps(maxX, maxY), _mm_max_ps(maxZ, maxW));
+		}
+		for (; i < count; ++i)
+		{
+			__m128 v = Simd::LoadVector3(elementAt(points, stride, i));
+			resultMin = _mm_min_ps(resultMin, v);
+			resultMax = _mm_max_ps(resultMax, v);
+		}
+		Simd::StoreVector3(&vmin.x, resultMin);
+		Simd::StoreVector3(&vmax.x, resultMax);
+#else
+		vmin = vmax = *points;
+		for (size_t i = 1; i < count; ++i)
+		{
+			const Vector3& p = *(const Vector3*)elementAt(points, stride, i);
+			vmin.makeFloor(p);
+			vmax.makeCeil(p);
+		}
+#endif
+		box.setExtents(vmin, vmax);
+		return box;
+	}
+	//-----------------------------------------------------------------------
+	void MathBatch::transformBoxes(const Matrix4& xform, const AxisAlignedBox* src, AxisAlignedBox* dst, size_t count)
+	{
+		ph_assert(xform.isAffine());
+#if PH_MATH_SIMD
+		ColumnMatrix columns(xform[0]);
+		ColumnMatrix absColumns(columns);
+		for (int col = 0; col < 3; ++col)
+			absColumns.c[col] = Simd::Abs(columns.c[col]);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!src[i].isFinite())
+			{
+				dst[i] = src[i];
+				continue;
+			}
+			__m128 vmin = Simd::LoadVector3(&src[i].getMinimum().x);
+			__m128 vmax = Simd::LoadVector3(&src[i].getMaximum().x);
+			__m128 centre = transformColumns(columns, _mm_mul_ps(_mm_add_ps(vmax, vmin), half), true);
+			__m128 halfSize = transformColumns(absColumns, _mm_mul_ps(_mm_sub_ps(vmax, vmin), half), false);
+			Vector3 newMin, newMax;
+			Simd::StoreVector3(&newMin.x, _mm_sub_ps(centre, halfSize));
+			Simd::StoreVector3(&newMax.x, _mm_add_ps(centre, halfSize));
+			dst[i].setExtents(newMin, newMax);
+		}
+#else
+		for (size_t i = 0; i < count; ++i)
+		{
+			dst[i] = src[i];
+			dst[i].transformAffine(xform);
+		}
+#endif
+	}
+}
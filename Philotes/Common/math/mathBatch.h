@@ -0,0 +1,63 @@
+#pragma once
+
+#include "mathprerequisites.h"
+#include "vector3.h"
+#include "matrix4.h"
+#include "axisAlignedBox.h"
+
+namespace Philo
+{
+
+	/** Kernels which apply one operation to a whole array of vectors or boxes.
+	@remarks
+		The matrix and the constants are set up once per call instead of once
+		per element, and with PH_MATH_SIMD the arrays are processed with SSE,
+		4 vectors at a time where the layout allows it.
+	@par
+		Vectors are given either as an array of Vector3 (AoS) with an optional
+		stride in bytes, so that the position or normal of a vertex struct or
+		of a locked vertex buffer can be used directly, or as 3 separate arrays
+		of x, y and z (SoA). Packed Vector3 arrays (stride == sizeof(Vector3))
+		and SoA arrays take the fastest path. Source and destination may be
+		the same array.
+	*/
+	class _PhiloCommonExport MathBatch
+	{
+	public:
+		/** Transforms points by an affine matrix, dst[i] = xform.transformAffine(src[i]).
+		*/
+		static void transformPoints(const Matrix4& xform, const Vector3* src, Vector3* dst, size_t count,
+			size_t srcStride = sizeof(Vector3), size_t dstStride = sizeof(Vector3));
+
+		/** Transforms directions by the upper 3x3 of a matrix, the translation is ignored.
+		@note
+			Normals need the inverse transpose of the matrix if it scales non-uniformly.
+			The results are not normalised, see normalise().
+		*/
+		static void transformNormals(const Matrix4& xform, const Vector3* src, Vector3* dst, size_t count,
+			size_t srcStride = sizeof(Vector3), size_t dstStride = sizeof(Vector3));
+
+		/** SoA version of transformPoints(), x, y and z are separate arrays.
+		*/
+		static void transformPoints(const Matrix4& xform, const scalar* srcX, const scalar* srcY, const scalar* srcZ,
+			scalar* dstX, scalar* dstY, scalar* dstZ, size_t count);
+
+		/** SoA version of transformNormals(), x, y and z are separate arrays.
+		*/
+		static void transformNormals(const Matrix4& xform, const scalar* srcX, const scalar* srcY, const scalar* srcZ,
+			scalar* dstX, scalar* dstY, scalar* dstZ, size_t count);
+
+		/** Normalises vectors like Vector3::normalise(), zero-sized vectors are left unchanged.
+		*/
+		static void normalise(Vector3* vectors, size_t count, size_t stride = sizeof(Vector3));
+
+		/** Returns the smallest box containing the points, a null box if count is 0.
+		*/
+		static AxisAlignedBox computeBounds(const Vector3* points, size_t count, size_t stride = sizeof(Vector3));
+
+		/** Transforms boxes by an affine matrix, dst[i] = src[i].transformAffine(xform).
+		*/
+		static void transformBoxes(const Matrix4& xform, const AxisAlignedBox* src, AxisAlignedBox* dst, size_t count);
+	};
+
+}
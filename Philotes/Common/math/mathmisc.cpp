@@ -2,7 +2,6 @@
 
 
 #include "mathmisc.h"
-#include "asm_math.h"
 #include "vector2.h"
 #include "vector3.h"
 #include "vector4.h"
@@ -146,12 +145,12 @@ namespace Philo
 	//-----------------------------------------------------------------------
 	scalar Math::InvSqrt(scalar fValue)
 	{
-		return scalar(asm_rsq(fValue));
+		return scalar(1.0f / sqrt(fValue));
 	}
     //-----------------------------------------------------------------------
     scalar Math::UnitRandom ()
     {
-        return asm_rand() / asm_rand_max();
+        return scalar(rand()) / scalar(RAND_MAX);
     }
     
     //-----------------------------------------------------------------------
@@ -3,6 +3,7 @@
 
 #include "mathprerequisites.h"
 #include "scalar.h"
+#include "fastMath.h"
 #include <vector>
 #include <iostream>
 #include <list>
@@ -366,12 +367,16 @@ namespace Philo
 
 		static inline scalar Cos (const Radian& fValue, bool useTables = false) 
 		{
-			return (!useTables) ? scalar(cos(fValue.valueRadians())) : SinTable(fValue.valueRadians() + HALF_PI);
+			return Cos(fValue.valueRadians(), useTables);
 		}
 
 		static inline scalar Cos (scalar fValue, bool useTables = false) 
 		{
+#if PH_MATH_FAST_TRIG
+			return (!useTables) ? FastMath::Cos(fValue) : SinTable(fValue + HALF_PI);
+#else
 			return (!useTables) ? scalar(cos(fValue)) : SinTable(fValue + HALF_PI);
+#endif
 		}
 
 		static inline scalar Exp (scalar fValue) { return scalar(exp(fValue)); }
@@ -399,11 +404,15 @@ namespace Philo
 		}
 
 		static inline scalar Sin (const Radian& fValue, bool useTables = false) {
-			return (!useTables) ? scalar(sin(fValue.valueRadians())) : SinTable(fValue.valueRadians());
+			return Sin(fValue.valueRadians(), useTables);
 		}
 
 		static inline scalar Sin (scalar fValue, bool useTables = false) {
+#if PH_MATH_FAST_TRIG
+			return (!useTables) ? FastMath::Sin(fValue) : SinTable(fValue);
+#else
 			return (!useTables) ? scalar(sin(fValue)) : SinTable(fValue);
+#endif
 		}
 
 		static inline scalar Sqr (scalar fValue) { return fValue*fValue; }
@@ -242,4 +242,6 @@ namespace Philo
     };
 	/** @} */
 	/** @} */
-}
\ No newline at end of file
+}
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::Matrix3)
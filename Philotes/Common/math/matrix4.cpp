@@ -75,6 +75,11 @@ namespace Philo
     //-----------------------------------------------------------------------
     Matrix4 Matrix4::inverse() const
     {
+#if PH_MATH_SIMD
+        Matrix4 r;
+        Simd::MatrixInverse(r._m, _m);
+        return r;
+#else
         scalar m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
         scalar m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
         scalar m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
@@ -133,6 +138,7 @@ namespace Philo
             d10, d11, d12, d13,
             d20, d21, d22, d23,
             d30, d31, d32, d33);
+#endif
     }
     //-----------------------------------------------------------------------
     Matrix4 Matrix4::inverseAffine(void) const
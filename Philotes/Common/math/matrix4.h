@@ -7,6 +7,7 @@
 #include "matrix3.h"
 #include "vector4.h"
 #include "plane.h"
+#include "simd.h"
 
 namespace Philo
 {
@@ -110,6 +111,9 @@ namespace Philo
 		inline Matrix4 concatenate(const Matrix4 &m2) const
 		{
 			Matrix4 r;
+#if PH_MATH_SIMD
+			Simd::MatrixMultiply(r._m, _m, m2._m);
+#else
 			r.m[0][0] = m[0][0] * m2.m[0][0] + m[0][1] * m2.m[1][0] + m[0][2] * m2.m[2][0] + m[0][3] * m2.m[3][0];
 			r.m[0][1] = m[0][0] * m2.m[0][1] + m[0][1] * m2.m[1][1] + m[0][2] * m2.m[2][1] + m[0][3] * m2.m[3][1];
 			r.m[0][2] = m[0][0] * m2.m[0][2] + m[0][1] * m2.m[1][2] + m[0][2] * m2.m[2][2] + m[0][3] * m2.m[3][2];
@@ -129,6 +133,7 @@ namespace Philo
 			r.m[3][1] = m[3][0] * m2.m[0][1] + m[3][1] * m2.m[1][1] + m[3][2] * m2.m[2][1] + m[3][3] * m2.m[3][1];
 			r.m[3][2] = m[3][0] * m2.m[0][2] + m[3][1] * m2.m[1][2] + m[3][2] * m2.m[2][2] + m[3][3] * m2.m[3][2];
 			r.m[3][3] = m[3][0] * m2.m[0][3] + m[3][1] * m2.m[1][3] + m[3][2] * m2.m[2][3] + m[3][3] * m2.m[3][3];
+#endif
 
 			return r;
 		}
@@ -174,6 +179,12 @@ namespace Philo
 		*/
 		inline Vector3 operator * ( const Vector3 &v ) const
 		{
+#if PH_MATH_SIMD
+			scalar t[4];
+			Simd::Store(t, Simd::Transform(_m, _mm_setr_ps(v.x, v.y, v.z, 1.0f)));
+			scalar fInvW = 1.0f / t[3];
+			return Vector3(t[0] * fInvW, t[1] * fInvW, t[2] * fInvW);
+#else
 			Vector3 r;
 
 			scalar fInvW = 1.0f / ( m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3] );
@@ -183,15 +194,22 @@ namespace Philo
 			r.z = ( m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3] ) * fInvW;
 
 			return r;
+#endif
 		}
 		inline Vector4 operator * (const Vector4& v) const
 		{
+#if PH_MATH_SIMD
+			Vector4 r;
+			Simd::Store(&r.x, Simd::Transform(_m, Simd::Load(&v.x)));
+			return r;
+#else
 			return Vector4(
 				m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3] * v.w, 
 				m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3] * v.w,
 				m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3] * v.w,
 				m[3][0] * v.x + m[3][1] * v.y + m[3][2] * v.z + m[3][3] * v.w
 				);
+#endif
 		}
 		inline Plane operator * (const Plane& p) const
 		{
@@ -559,6 +577,12 @@ namespace Philo
 		{
 			ph_assert(isAffine() && m2.isAffine());
 
+#if PH_MATH_SIMD
+			// the last rows are (0, 0, 0, 1), the full product gives the same
+			Matrix4 r;
+			Simd::MatrixMultiply(r._m, _m, m2._m);
+			return r;
+#else
 			return Matrix4(
 				m[0][0] * m2.m[0][0] + m[0][1] * m2.m[1][0] + m[0][2] * m2.m[2][0],
 				m[0][0] * m2.m[0][1] + m[0][1] * m2.m[1][1] + m[0][2] * m2.m[2][1],
@@ -576,6 +600,7 @@ namespace Philo
 				m[2][0] * m2.m[0][3] + m[2][1] * m2.m[1][3] + m[2][2] * m2.m[2][3] + m[2][3],
 
 				0, 0, 0, 1);
+#endif
 		}
 
 		/** 3-D Vector transformation specially for an affine matrix.
@@ -589,10 +614,16 @@ namespace Philo
 		{
 			ph_assert(isAffine());
 
+#if PH_MATH_SIMD
+			scalar t[4];
+			Simd::Store(t, Simd::Transform(_m, _mm_setr_ps(v.x, v.y, v.z, 1.0f)));
+			return Vector3(t[0], t[1], t[2]);
+#else
 			return Vector3(
 				m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3], 
 				m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3],
 				m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3]);
+#endif
 		}
 
 		/** 4-D Vector transformation specially for an affine matrix.
@@ -603,11 +634,18 @@ namespace Philo
 		{
 			ph_assert(isAffine());
 
+#if PH_MATH_SIMD
+			Vector4 r;
+			Simd::Store(&r.x, Simd::Transform(_m, Simd::Load(&v.x)));
+			r.w = v.w;
+			return r;
+#else
 			return Vector4(
 				m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z + m[0][3] * v.w, 
 				m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z + m[1][3] * v.w,
 				m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z + m[2][3] * v.w,
 				v.w);
+#endif
 		}
 	};
 
@@ -617,14 +655,22 @@ namespace Philo
 	*/
 	inline Vector4 operator * (const Vector4& v, const Matrix4& mat)
 	{
+#if PH_MATH_SIMD
+		Vector4 r;
+		Simd::Store(&r.x, Simd::TransformRow(Simd::Load(&v.x), mat[0]));
+		return r;
+#else
 		return Vector4(
 			v.x*mat[0][0] + v.y*mat[1][0] + v.z*mat[2][0] + v.w*mat[3][0],
 			v.x*mat[0][1] + v.y*mat[1][1] + v.z*mat[2][1] + v.w*mat[3][1],
 			v.x*mat[0][2] + v.y*mat[1][2] + v.z*mat[2][2] + v.w*mat[3][2],
 			v.x*mat[0][3] + v.y*mat[1][3] + v.z*mat[2][3] + v.w*mat[3][3]
 		);
+#endif
 	}
 	/** @} */
 	/** @} */
 
-}
\ No newline at end of file
+}
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::Matrix4)
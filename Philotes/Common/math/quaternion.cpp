@@ -2,6 +2,7 @@
 #include "quaternion.h"
 #include "vector3.h"
 #include "matrix3.h"
+#include "simd.h"
 
 namespace Philo
 {
@@ -244,6 +245,11 @@ namespace Philo
 		// NOTE:  Multiplication is not generally commutative, so in most
 		// cases p*q != q*p.
 
+#if PH_MATH_SIMD
+		Quaternion r;
+		Simd::QuaternionMultiply(&r.w, &w, &rkQ.w);
+		return r;
+#else
 		return Quaternion
 			(
 			w * rkQ.w - x * rkQ.x - y * rkQ.y - z * rkQ.z,
@@ -251,6 +257,7 @@ namespace Philo
 			w * rkQ.y + y * rkQ.w + z * rkQ.x - x * rkQ.z,
 			w * rkQ.z + z * rkQ.w + x * rkQ.y - y * rkQ.x
 			);
+#endif
 	}
 	//-----------------------------------------------------------------------
 	Quaternion Quaternion::operator* (scalar fScalar) const
@@ -218,4 +218,6 @@ namespace Philo
 
     };
 
-}
\ No newline at end of file
+}
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::Quaternion)
@@ -0,0 +1,311 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @file math/simd.h
+
+    SSE kernels behind Matrix4, Quaternion and AxisAlignedBox. PH_MATH_SIMD
+    in core/config.h selects the instruction set at compile time:
+    PH_MATH_SIMD_SSE2 works on every x86/x64 CPU the engine runs on,
+    PH_MATH_SIMD_SSE41 uses dot product instructions where they help,
+    PH_MATH_SIMD_NONE compiles the classes' original scalar code only.
+
+    The kernels work directly on the scalar members of the math classes
+    with unaligned loads and stores, so the classes keep their layout and
+    public interface. A Matrix4 is 4 rows of 4 scalars, a Quaternion is
+    w, x, y, z.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/config.h"
+#include "scalar.h"
+
+#include <float.h>
+
+#if PH_MATH_SIMD >= PH_MATH_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#if PH_MATH_SIMD >= PH_MATH_SIMD_SSE41
+#include <smmintrin.h>
+#endif
+
+#if PH_MATH_SIMD
+//------------------------------------------------------------------------------
+namespace Philo
+{
+namespace Simd
+{
+/// shuffle of a single register, lanes given from first to last
+#define PH_SIMD_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+/// lanes x, y of a and z, w of b
+#define PH_SIMD_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline __m128
+Load(const scalar* p)
+{
+    return _mm_loadu_ps(p);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+Store(scalar* p, __m128 v)
+{
+    _mm_storeu_ps(p, v);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline __m128
+Abs(__m128 v)
+{
+    return _mm_and_ps(v, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Loads x, y, z into the first 3 lanes and 0 into w, never reads past
+    the 3 scalars.
+*/
+inline __m128
+LoadVector3(const scalar* p)
+{
+    __m128 xy = _mm_castpd_ps(_mm_load_sd((const double*) p));
+    return _mm_movelh_ps(xy, _mm_load_ss(p + 2));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Stores the first 3 lanes, never writes past the 3 scalars.
+*/
+inline void
+StoreVector3(scalar* p, __m128 v)
+{
+    _mm_storel_pi((__m64*) p, v);
+    _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Dot products of the 4 rows of a matrix with v, the matrix times the
+    column vector v.
+*/
+inline __m128
+Transform(const scalar* m, __m128 v)
+{
+    #if PH_MATH_SIMD >= PH_MATH_SIMD_SSE41
+    __m128 x = _mm_dp_ps(Load(m), v, 0xf1);
+    __m128 y = _mm_dp_ps(Load(m + 4), v, 0xf2);
+    __m128 z = _mm_dp_ps(Load(m + 8), v, 0xf4);
+    __m128 w = _mm_dp_ps(Load(m + 12), v, 0xf8);
+    return _mm_or_ps(_mm_or_ps(x, y), _mm_or_ps(z, w));
+    #else
+    __m128 r0 = _mm_mul_ps(Load(m), v);
+    __m128 r1 = _mm_mul_ps(Load(m + 4), v);
+    __m128 r2 = _mm_mul_ps(Load(m + 8), v);
+    __m128 r3 = _mm_mul_ps(Load(m + 12), v);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    return _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3));
+    #endif
+}
+
+//------------------------------------------------------------------------------
+/**
+    Dot products of the absolute values of the 4 matrix rows with v.
+*/
+inline __m128
+TransformAbs(const scalar* m, __m128 v)
+{
+    __m128 r0 = _mm_mul_ps(Abs(Load(m)), v);
+    __m128 r1 = _mm_mul_ps(Abs(Load(m + 4)), v);
+    __m128 r2 = _mm_mul_ps(Abs(Load(m + 8)), v);
+    __m128 r3 = _mm_mul_ps(Abs(Load(m + 12)), v);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    return _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3));
+}
+
+//------------------------------------------------------------------------------
+/**
+    The row vector v times a matrix, the sum of the matrix rows weighted
+    by the components of v.
+*/
+inline __m128
+TransformRow(__m128 v, const scalar* m)
+{
+    __m128 r = _mm_mul_ps(PH_SIMD_SWIZZLE(v, 0, 0, 0, 0), Load(m));
+    r = _mm_add_ps(r, _mm_mul_ps(PH_SIMD_SWIZZLE(v, 1, 1, 1, 1), Load(m + 4)));
+    r = _mm_add_ps(r, _mm_mul_ps(PH_SIMD_SWIZZLE(v, 2, 2, 2, 2), Load(m + 8)));
+    r = _mm_add_ps(r, _mm_mul_ps(PH_SIMD_SWIZZLE(v, 3, 3, 3, 3), Load(m + 12)));
+    return r;
+}
+
+//------------------------------------------------------------------------------
+/**
+    out = a * b, every row of out is a row of a times b. out may be a or b.
+*/
+inline void
+MatrixMultiply(scalar* out, const scalar* a, const scalar* b)
+{
+    __m128 r0 = TransformRow(Load(a), b);
+    __m128 r1 = TransformRow(Load(a + 4), b);
+    __m128 r2 = TransformRow(Load(a + 8), b);
+    __m128 r3 = TransformRow(Load(a + 12), b);
+    Store(out, r0);
+    Store(out + 4, r1);
+    Store(out + 8, r2);
+    Store(out + 12, r3);
+}
+
+//------------------------------------------------------------------------------
+/**
+    2x2 matrix product a * b, the matrices stored as (m00, m01, m10, m11).
+*/
+inline __m128
+Mat2Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, PH_SIMD_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(PH_SIMD_SWIZZLE(a, 1, 0, 3, 2), PH_SIMD_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+//------------------------------------------------------------------------------
+/**
+    2x2 matrix product adjugate(a) * b.
+*/
+inline __m128
+Mat2AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(PH_SIMD_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(PH_SIMD_SWIZZLE(a, 1, 1, 2, 2), PH_SIMD_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+//------------------------------------------------------------------------------
+/**
+    2x2 matrix product a * adjugate(b).
+*/
+inline __m128
+Mat2MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, PH_SIMD_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(PH_SIMD_SWIZZLE(a, 1, 0, 3, 2), PH_SIMD_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+//------------------------------------------------------------------------------
+/**
+    General inverse by splitting the matrix into 2x2 blocks
+    | A B |
+    | C D |
+    and inverting through their adjugates. Same result as the cofactor
+    expansion of Matrix4::inverse() up to rounding. out may be m.
+*/
+inline void
+MatrixInverse(scalar* out, const scalar* m)
+{
+    __m128 row0 = Load(m);
+    __m128 row1 = Load(m + 4);
+    __m128 row2 = Load(m + 8);
+    __m128 row3 = Load(m + 12);
+
+    __m128 A = _mm_movelh_ps(row0, row1);
+    __m128 B = _mm_movehl_ps(row1, row0);
+    __m128 C = _mm_movelh_ps(row2, row3);
+    __m128 D = _mm_movehl_ps(row3, row2);
+
+    // determinants of the blocks as (|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(PH_SIMD_SHUFFLE(row0, row2, 0, 2, 0, 2), PH_SIMD_SHUFFLE(row1, row3, 1, 3, 1, 3)),
+        _mm_mul_ps(PH_SIMD_SHUFFLE(row0, row2, 1, 3, 1, 3), PH_SIMD_SHUFFLE(row1, row3, 0, 2, 0, 2)));
+    __m128 detA = PH_SIMD_SWIZZLE(detSub, 0, 0, 0, 0);
+    __m128 detB = PH_SIMD_SWIZZLE(detSub, 1, 1, 1, 1);
+    __m128 detC = PH_SIMD_SWIZZLE(detSub, 2, 2, 2, 2);
+    __m128 detD = PH_SIMD_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    __m128 D_C = Mat2AdjMul(D, C);
+    __m128 A_B = Mat2AdjMul(A, B);
+    // adjugates of the blocks of the inverse times |M|
+    __m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, D_C));
+    __m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, A_B));
+    __m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, A_B));
+    __m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - trace(A#B * D#C)
+    __m128 tr = _mm_mul_ps(A_B, PH_SIMD_SWIZZLE(D_C, 0, 2, 1, 3));
+    tr = _mm_add_ps(tr, PH_SIMD_SWIZZLE(tr, 2, 3, 0, 1));
+    tr = _mm_add_ps(tr, PH_SIMD_SWIZZLE(tr, 1, 0, 3, 2));
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X_ = _mm_mul_ps(X_, rDetM);
+    Y_ = _mm_mul_ps(Y_, rDetM);
+    Z_ = _mm_mul_ps(Z_, rDetM);
+    W_ = _mm_mul_ps(W_, rDetM);
+
+    // undo the adjugates while putting the blocks back into rows
+    Store(out, PH_SIMD_SHUFFLE(X_, Y_, 3, 1, 3, 1));
+    Store(out + 4, PH_SIMD_SHUFFLE(X_, Y_, 2, 0, 2, 0));
+    Store(out + 8, PH_SIMD_SHUFFLE(Z_, W_, 3, 1, 3, 1));
+    Store(out + 12, PH_SIMD_SHUFFLE(Z_, W_, 2, 0, 2, 0));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Hamilton product of two quaternions stored as (w, x, y, z).
+*/
+inline void
+QuaternionMultiply(scalar* out, const scalar* a, const scalar* b)
+{
+    __m128 q1 = Load(a);
+    __m128 q2 = Load(b);
+    const __m128 signX = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+    const __m128 signY = _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f);
+    const __m128 signZ = _mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f);
+
+    __m128 r = _mm_mul_ps(PH_SIMD_SWIZZLE(q1, 0, 0, 0, 0), q2);
+    r = _mm_add_ps(r, _mm_mul_ps(PH_SIMD_SWIZZLE(q1, 1, 1, 1, 1), _mm_mul_ps(PH_SIMD_SWIZZLE(q2, 1, 0, 3, 2), signX)));
+    r = _mm_add_ps(r, _mm_mul_ps(PH_SIMD_SWIZZLE(q1, 2, 2, 2, 2), _mm_mul_ps(PH_SIMD_SWIZZLE(q2, 2, 3, 0, 1), signY)));
+    r = _mm_add_ps(r, _mm_mul_ps(PH_SIMD_SWIZZLE(q1, 3, 3, 3, 3), _mm_mul_ps(PH_SIMD_SWIZZLE(q2, 3, 2, 1, 0), signZ)));
+    Store(out, r);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Bounds of the 8 corners of the box [minimum, maximum] transformed by
+    the matrix m and projected back to w = 1. The corners are sums of one
+    of two scaled matrix columns per axis plus the translation column, so
+    each one costs three adds and a divide. minimum and maximum point to 3
+    scalars, outMin and outMax receive 4.
+*/
+inline void
+TransformBox(scalar* outMin, scalar* outMax, const scalar* m, const scalar* minimum, const scalar* maximum)
+{
+    __m128 c0 = Load(m);
+    __m128 c1 = Load(m + 4);
+    __m128 c2 = Load(m + 8);
+    __m128 c3 = Load(m + 12);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    __m128 x[2] = { _mm_mul_ps(c0, _mm_set1_ps(minimum[0])), _mm_mul_ps(c0, _mm_set1_ps(maximum[0])) };
+    __m128 y[2] = { _mm_mul_ps(c1, _mm_set1_ps(minimum[1])), _mm_mul_ps(c1, _mm_set1_ps(maximum[1])) };
+    __m128 z[2] = { _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(minimum[2])), c3), _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(maximum[2])), c3) };
+
+    __m128 resultMin = _mm_set1_ps(FLT_MAX);
+    __m128 resultMax = _mm_set1_ps(-FLT_MAX);
+    int i;
+    for (i = 0; i < 8; i++)
+    {
+        __m128 p = _mm_add_ps(_mm_add_ps(x[i & 1], y[(i >> 1) & 1]), z[i >> 2]);
+        p = _mm_div_ps(p, PH_SIMD_SWIZZLE(p, 3, 3, 3, 3));
+        resultMin = _mm_min_ps(resultMin, p);
+        resultMax = _mm_max_ps(resultMax, p);
+    }
+    Store(outMin, resultMin);
+    Store(outMax, resultMax);
+}
+
+} // namespace Simd
+} // namespace Philo
+#endif
+//------------------------------------------------------------------------------
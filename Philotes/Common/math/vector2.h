@@ -530,3 +530,4 @@ namespace Philo
 
 }
 
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::Vector2)
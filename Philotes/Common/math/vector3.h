@@ -750,4 +750,6 @@ public:
     }
 };
 
-}
\ No newline at end of file
+}
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::Vector3)
@@ -376,3 +376,4 @@ namespace Philo
 
 }
 
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::Vector4)
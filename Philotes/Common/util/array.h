@@ -22,6 +22,15 @@
     std::sort (one of the very few exceptions where the STL is used in
     Nebula3).
 
+    Elements are relocated according to TypeTraits: trivially copyable
+    types are moved with memcpy/memmove when the array grows or elements
+    are inserted and erased, types with a Swap() method (String, Array)
+    are swapped into place instead of being copied. Swap() exchanges the
+    contents of two arrays in constant time, and AppendDefault() appends
+    an element to be filled in place instead of copying a filled one.
+    All slots up to the capacity are constructed when the buffer is
+    allocated, so these assign a default value, they don't construct.
+
     One should generally be careful with costly copy operators, the Array
     class (and the other container classes using Array) may do some heavy
     element shuffling in some situations (especially when sorting and erasing
@@ -59,6 +68,7 @@
 
 
 #include "core/types.h"
+#include "core/typetraits.h"
 #include "util/fast_hash.h"
 
 //------------------------------------------------------------------------------
@@ -96,6 +106,12 @@ public:
     void Append(const TYPE& elm);
     /// append the contents of an array to this array
     void AppendArray(const Array<TYPE>& rhs);
+    /// append a default element and return it, to be filled in place
+    TYPE& AppendDefault();
+    /// insert a default element before element at index and return it, to be filled in place
+    TYPE& InsertDefault(IndexT index);
+    /// exchange contents with another array without copying elements
+    void Swap(Array<TYPE>& rhs);
     /// increase capacity to fit N more elements into the array
     void Reserve(SizeT num);
 	/// Added by Li
@@ -166,6 +182,10 @@ private:
     void GrowTo(SizeT newCapacity);
     /// move elements, grows array if needed
     void Move(IndexT fromIndex, IndexT toIndex);
+    /// copy elements into already constructed elements
+    static void CopyRange(TYPE* to, const TYPE* from, SizeT num);
+    /// move elements into already constructed elements, the sources are left unspecified
+    static void RelocateRange(TYPE* to, TYPE* from, SizeT num);
 
     static const SizeT MinGrowSize = 16;
     static const SizeT MaxGrowSize = 65536; // FIXME: big grow size needed for mesh tools
@@ -255,10 +275,53 @@ Array<TYPE>::Copy(const Array<TYPE>& src)
     if (this->capacity > 0)
     {
         this->elements = ph_new_array(TYPE, this->capacity);
+        CopyRange(this->elements, src.elements, this->size);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+Array<TYPE>::CopyRange(TYPE* to, const TYPE* from, SizeT num)
+{
+    if (TypeTraits<TYPE>::IsTriviallyCopyable)
+    {
+        if (num > 0)
+        {
+            memcpy(to, from, num * sizeof(TYPE));
+        }
+    }
+    else
+    {
         IndexT i;
-        for (i = 0; i < this->size; i++)
+        for (i = 0; i < num; i++)
         {
-            this->elements[i] = src.elements[i];
+            to[i] = from[i];
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    The ranges must not overlap.
+*/
+template<class TYPE> void
+Array<TYPE>::RelocateRange(TYPE* to, TYPE* from, SizeT num)
+{
+    if (TypeTraits<TYPE>::IsTriviallyCopyable)
+    {
+        if (num > 0)
+        {
+            memcpy(to, from, num * sizeof(TYPE));
+        }
+    }
+    else
+    {
+        IndexT i;
+        for (i = 0; i < num; i++)
+        {
+            ElementMover<TypeTraits<TYPE>::HasSwap>::Move(to[i], from[i]);
         }
     }
 }
@@ -342,13 +405,10 @@ Array<TYPE>::operator=(const Array<TYPE>& rhs)
         {
             // source array fits into our capacity, copy in place
             ph_assert(0 != this->elements);
-            IndexT i;
-            for (i = 0; i < rhs.size; i++)
-            {
-                this->elements[i] = rhs.elements[i];
-            }
+            CopyRange(this->elements, rhs.elements, rhs.size);
 
             // properly destroy remaining original elements
+            IndexT i = rhs.size;
             for (; i < this->size; i++)
             {
                 this->Destroy(&(this->elements[i]));
@@ -374,12 +434,8 @@ Array<TYPE>::GrowTo(SizeT newCapacity)
     TYPE* newArray = ph_new_array(TYPE, newCapacity);
     if (this->elements)
     {
-        // copy over contents
-        IndexT i;
-        for (i = 0; i < this->size; i++)
-        {
-            newArray[i] = this->elements[i];
-        }
+        // move over contents, the old elements are discarded anyway
+        RelocateRange(newArray, this->elements, this->size);
 
         // discard old array and update contents
         ph_delete_array(this->elements);
@@ -449,13 +505,17 @@ Array<TYPE>::Move(IndexT fromIndex, IndexT toIndex)
         this->Grow();
     }
 
-    if (fromIndex > toIndex)
+    if (TypeTraits<TYPE>::IsTriviallyCopyable)
+    {
+        memmove(this->elements + toIndex, this->elements + fromIndex, num * sizeof(TYPE));
+    }
+    else if (fromIndex > toIndex)
     {
         // this is a backward move
         IndexT i;
         for (i = 0; i < num; i++)
         {
-            this->elements[toIndex + i] = this->elements[fromIndex + i];
+            ElementMover<TypeTraits<TYPE>::HasSwap>::Move(this->elements[toIndex + i], this->elements[fromIndex + i]);
         }
 
         // destroy remaining elements
@@ -470,7 +530,7 @@ Array<TYPE>::Move(IndexT fromIndex, IndexT toIndex)
         int i;  // NOTE: this must remain signed for the following loop to work!!!
         for (i = num - 1; i >= 0; --i)
         {
-            this->elements[toIndex + i] = this->elements[fromIndex + i];
+            ElementMover<TypeTraits<TYPE>::HasSwap>::Move(this->elements[toIndex + i], this->elements[fromIndex + i]);
         }
 
         // destroy freed elements
@@ -507,12 +567,82 @@ Array<TYPE>::Append(const TYPE& elm)
 template<class TYPE> void
 Array<TYPE>::AppendArray(const Array<TYPE>& rhs)
 {
-    IndexT i;
     SizeT num = rhs.Size();
-    for (i = 0; i < num; i++)
+    if (num > 0)
     {
-        this->Append(rhs[i]);
+        if (this->size + num > this->capacity)
+        {
+            // grow geometrically, repeated appends must not reallocate every time
+            SizeT newCapacity = this->capacity << 1;
+            if (newCapacity < this->size + num)
+            {
+                newCapacity = this->size + num;
+            }
+            this->GrowTo(newCapacity);
+        }
+        CopyRange(this->elements + this->size, rhs.elements, num);
+        this->size += num;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Slots past the end may still hold erased elements, the returned
+    element is reset to a default value.
+*/
+template<class TYPE> TYPE&
+Array<TYPE>::AppendDefault()
+{
+    if (this->size == this->capacity)
+    {
+        this->Grow();
+    }
+    #if PH_BOUNDSCHECKS
+    ph_assert(this->elements);
+    #endif
+    TYPE& elm = this->elements[this->size++];
+    elm = TYPE();
+    return elm;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> TYPE&
+Array<TYPE>::InsertDefault(IndexT index)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(index <= this->size);
+    #endif
+    if (index == this->size)
+    {
+        return this->AppendDefault();
     }
+    this->Move(index, index + 1);
+    this->elements[index] = TYPE();
+    return this->elements[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+    Also serves as a cheap move: swapping with an empty array takes over
+    the buffer of rhs and leaves rhs empty.
+*/
+template<class TYPE> void
+Array<TYPE>::Swap(Array<TYPE>& rhs)
+{
+    SizeT tmpGrow = this->grow;
+    SizeT tmpCapacity = this->capacity;
+    SizeT tmpSize = this->size;
+    TYPE* tmpElements = this->elements;
+    this->grow = rhs.grow;
+    this->capacity = rhs.capacity;
+    this->size = rhs.size;
+    this->elements = rhs.elements;
+    rhs.grow = tmpGrow;
+    rhs.capacity = tmpCapacity;
+    rhs.size = tmpSize;
+    rhs.elements = tmpElements;
 }
 
 //------------------------------------------------------------------------------
@@ -554,11 +684,12 @@ Array<TYPE>::Resize(SizeT num)
 	} 
 	else
 	{
-		for (IndexT i = this->size; i != num; --i)
+		// the buffer owns the elements, shrinking must not run their destructors
+		for (IndexT i = num; i < this->size; ++i)
 		{
-			(this->elements + i)->~TYPE();
-			--(this->size);
+			this->Destroy(&(this->elements[i]));
 		}
+		this->size = num;
 	}
 }
 
@@ -692,7 +823,7 @@ Array<TYPE>::EraseIndexSwap(IndexT index)
     IndexT lastElementIndex = this->size - 1;
     if (index < lastElementIndex)
     {
-        this->elements[index] = this->elements[lastElementIndex];
+        ElementMover<TypeTraits<TYPE>::HasSwap>::Move(this->elements[index], this->elements[lastElementIndex]);
     }
     this->Destroy(&(this->elements[lastElementIndex]));
     this->size--;
@@ -1107,5 +1238,15 @@ Array<TYPE>::GetFastHashCode()
 	return ret;
 }
 
+//------------------------------------------------------------------------------
+/**
+    Arrays relocate by swapping their buffers.
+*/
+template<class TYPE> struct TypeTraits<Array<TYPE> >
+{
+    enum { IsTriviallyCopyable = false };
+    enum { HasSwap = true };
+};
+
 } // namespace Philo
 //------------------------------------------------------------------------------
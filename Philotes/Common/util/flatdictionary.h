@@ -0,0 +1,736 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class FlatDictionary
+
+    A Dictionary variant which keeps keys and values in two separate
+    sorted arrays instead of one array of KeyValuePairs. Searches only
+    touch the key array, so more keys fit into each cache line, and
+    inserting moves keys and values separately.
+
+    The interface matches Dictionary, except that there is no
+    KeyValuePairAtIndex(), the pairs don't exist in memory.
+
+    Bulk inserts (BeginBulkAdd()/EndBulkAdd()) sort an index permutation
+    and reorder both arrays once at the end. Integer keys are sorted with
+    an LSD radix sort, which is stable and linear, other keys use the
+    STL sort.
+
+    With EYTZINGER set the dictionary additionally keeps a copy of the
+    keys in breadth first (Eytzinger) order: node k has its children at
+    2k and 2k+1, so the first levels of every search share the same few
+    cache lines and the search loop has no unpredictable branch. The
+    layout is built in EndBulkAdd() and BuildSearchLayout(); single
+    Add() and Erase() calls make it stale, and searches fall back to
+    the binary search until it is rebuilt. This suits read-mostly maps
+    with small keys that are filled in bulk.
+
+    (C) 2012 PhiloLabs
+*/
+
+#include "util/array.h"
+#include "util/keyvaluepair.h"
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+//------------------------------------------------------------------------------
+/**
+    Maps key types which can be radix sorted to unsigned bits with the
+    same ordering. Other types report IsRadix = false.
+*/
+template<class TYPE> struct FlatDictionaryRadixKey
+{
+    enum { IsRadix = false };
+    typedef uint32 Bits;
+    static Bits ToBits(const TYPE&) { return 0; }
+};
+template<> struct FlatDictionaryRadixKey<uint16>
+{
+    enum { IsRadix = true };
+    typedef uint16 Bits;
+    static Bits ToBits(uint16 key) { return key; }
+};
+template<> struct FlatDictionaryRadixKey<int16>
+{
+    enum { IsRadix = true };
+    typedef uint16 Bits;
+    static Bits ToBits(int16 key) { return uint16(key) ^ 0x8000; }
+};
+template<> struct FlatDictionaryRadixKey<uint32>
+{
+    enum { IsRadix = true };
+    typedef uint32 Bits;
+    static Bits ToBits(uint32 key) { return key; }
+};
+template<> struct FlatDictionaryRadixKey<int32>
+{
+    enum { IsRadix = true };
+    typedef uint32 Bits;
+    static Bits ToBits(int32 key) { return uint32(key) ^ 0x80000000; }
+};
+template<> struct FlatDictionaryRadixKey<uint64>
+{
+    enum { IsRadix = true };
+    typedef uint64 Bits;
+    static Bits ToBits(uint64 key) { return key; }
+};
+template<> struct FlatDictionaryRadixKey<int64>
+{
+    enum { IsRadix = true };
+    typedef uint64 Bits;
+    static Bits ToBits(int64 key) { return uint64(key) ^ (uint64(1) << 63); }
+};
+
+//------------------------------------------------------------------------------
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER = false> class FlatDictionary
+{
+public:
+    /// default constructor
+    FlatDictionary();
+    /// copy constructor
+    FlatDictionary(const FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>& rhs);
+    /// assignment operator
+    void operator=(const FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>& rhs);
+    /// read/write [] operator, creates the element if key doesn't exist
+    VALUETYPE& operator[](const KEYTYPE& key);
+    /// read-only [] operator
+    const VALUETYPE& operator[](const KEYTYPE& key) const;
+    /// return number of key/value pairs in the dictionary
+    SizeT Size() const;
+    /// clear the dictionary
+    void Clear();
+    /// return true if empty
+    bool IsEmpty() const;
+    /// reserve space (useful if number of elements is known beforehand)
+    void Reserve(SizeT numElements);
+    /// begin a bulk insert (arrays will be sorted at End)
+    void BeginBulkAdd();
+    /// add a key/value pair
+    void Add(const KeyValuePair<KEYTYPE, VALUETYPE>& kvp);
+    /// add a key and associated value
+    void Add(const KEYTYPE& key, const VALUETYPE& value);
+    /// end a bulk insert (this will sort the internal arrays)
+    void EndBulkAdd();
+    /// erase a key-value element
+    void Erase(const KEYTYPE& key);
+    /// erase a key-value element at index
+    void EraseAtIndex(IndexT index);
+    /// find index of key/value pair (InvalidIndex if doesn't exist)
+    IndexT FindIndex(const KEYTYPE& key) const;
+    /// return true if key exists in the array
+    bool Contains(const KEYTYPE& key) const;
+    /// get a key at given index
+    const KEYTYPE& KeyAtIndex(IndexT index) const;
+    /// access to value at given index
+    VALUETYPE& ValueAtIndex(IndexT index);
+    /// get a value at given index
+    const VALUETYPE& ValueAtIndex(IndexT index) const;
+    /// get all keys as an Array
+    const Array<KEYTYPE>& KeysAsArray() const;
+    /// get all values as an Array
+    const Array<VALUETYPE>& ValuesAsArray() const;
+    /// (re)build the Eytzinger search layout, no-op without EYTZINGER
+    void BuildSearchLayout();
+    /// return true if searches currently use the Eytzinger layout
+    bool HasSearchLayout() const;
+
+protected:
+    /// index of the first key not less than key
+    IndexT LowerBound(const KEYTYPE& key) const;
+    /// index of the first key greater than key
+    IndexT UpperBound(const KEYTYPE& key) const;
+    /// lower bound through the Eytzinger layout
+    IndexT LowerBoundEytzinger(const KEYTYPE& key) const;
+    /// fill the Eytzinger subtree at node from the sorted keys starting at index, returns the next index
+    IndexT FillEytzinger(IndexT index, IndexT node);
+    /// sorted order of the keys as a permutation
+    void SortPermutation(Array<IndexT>& order) const;
+    /// radix sort order by key
+    void RadixSortPermutation(Array<IndexT>& order) const;
+    /// make the search layout stale after a modification
+    void InvalidateSearchLayout();
+
+    /// compares keys through the permutation for the STL sort
+    struct IndexLess
+    {
+        IndexLess(const Array<KEYTYPE>& k) : keys(k) {}
+        bool operator()(IndexT a, IndexT b) const { return this->keys[a] < this->keys[b]; }
+        const Array<KEYTYPE>& keys;
+    };
+
+    /// key bits and original index, what the radix sort moves around
+    struct RadixItem
+    {
+        typename FlatDictionaryRadixKey<KEYTYPE>::Bits bits;
+        IndexT index;
+    };
+
+    Array<KEYTYPE> keys;
+    Array<VALUETYPE> values;
+    Array<KEYTYPE> layoutKeys;      // 1-based Eytzinger order, only with EYTZINGER
+    Array<IndexT> layoutIndices;    // sorted index of each layout node
+    bool layoutValid;
+    bool inBulkInsert;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER>
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::FlatDictionary() :
+    layoutValid(false),
+    inBulkInsert(false)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER>
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::FlatDictionary(const FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>& rhs) :
+    keys(rhs.keys),
+    values(rhs.values),
+    layoutKeys(rhs.layoutKeys),
+    layoutIndices(rhs.layoutIndices),
+    layoutValid(rhs.layoutValid),
+    inBulkInsert(false)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!rhs.inBulkInsert);
+    #endif
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::operator=(const FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>& rhs)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    ph_assert(!rhs.inBulkInsert);
+    #endif
+    this->keys = rhs.keys;
+    this->values = rhs.values;
+    this->layoutKeys = rhs.layoutKeys;
+    this->layoutIndices = rhs.layoutIndices;
+    this->layoutValid = rhs.layoutValid;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Clear()
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    this->keys.Clear();
+    this->values.Clear();
+    this->InvalidateSearchLayout();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> SizeT
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Size() const
+{
+    return this->keys.Size();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> bool
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::IsEmpty() const
+{
+    return (0 == this->keys.Size());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Reserve(SizeT numElements)
+{
+    this->keys.Reserve(numElements);
+    this->values.Reserve(numElements);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::BeginBulkAdd()
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    this->inBulkInsert = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Add(const KEYTYPE& key, const VALUETYPE& value)
+{
+    if (this->inBulkInsert)
+    {
+        this->keys.Append(key);
+        this->values.Append(value);
+    }
+    else
+    {
+        IndexT index = this->UpperBound(key);
+        this->keys.Insert(index, key);
+        this->values.Insert(index, value);
+        this->InvalidateSearchLayout();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Add(const KeyValuePair<KEYTYPE, VALUETYPE>& kvp)
+{
+    this->Add(kvp.Key(), kvp.Value());
+}
+
+//------------------------------------------------------------------------------
+/**
+    Sorts a permutation instead of the pairs, then reorders keys and
+    values in one pass each.
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::EndBulkAdd()
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(this->inBulkInsert);
+    #endif
+    this->inBulkInsert = false;
+
+    SizeT num = this->keys.Size();
+    if (num > 1)
+    {
+        Array<IndexT> order;
+        this->SortPermutation(order);
+
+        Array<KEYTYPE> sortedKeys;
+        Array<VALUETYPE> sortedValues;
+        sortedKeys.Reserve(num);
+        sortedValues.Reserve(num);
+        IndexT i;
+        for (i = 0; i < num; i++)
+        {
+            sortedKeys.Append(this->keys[order[i]]);
+            sortedValues.Append(this->values[order[i]]);
+        }
+        this->keys.Swap(sortedKeys);
+        this->values.Swap(sortedValues);
+    }
+    this->BuildSearchLayout();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::SortPermutation(Array<IndexT>& order) const
+{
+    if (FlatDictionaryRadixKey<KEYTYPE>::IsRadix)
+    {
+        this->RadixSortPermutation(order);
+    }
+    else
+    {
+        SizeT num = this->keys.Size();
+        order.Reserve(num);
+        IndexT i;
+        for (i = 0; i < num; i++)
+        {
+            order.Append(i);
+        }
+        std::sort(order.Begin(), order.End(), IndexLess(this->keys));
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    LSD radix sort over 8 bit digits. All digit histograms are counted in
+    one pass up front, digits where every key falls into the same bucket
+    are skipped, which makes small key ranges cheap.
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::RadixSortPermutation(Array<IndexT>& order) const
+{
+    typedef typename FlatDictionaryRadixKey<KEYTYPE>::Bits Bits;
+    typedef RadixItem Item;
+    const SizeT numDigits = sizeof(Bits);
+
+    SizeT num = this->keys.Size();
+    Array<Item> buffers[2];
+    buffers[0].Reserve(num);
+    buffers[1].Resize(num);
+
+    uint32 counts[sizeof(Bits)][256];
+    memset(counts, 0, sizeof(counts));
+    IndexT i;
+    for (i = 0; i < num; i++)
+    {
+        Item item;
+        item.bits = FlatDictionaryRadixKey<KEYTYPE>::ToBits(this->keys[i]);
+        item.index = i;
+        buffers[0].Append(item);
+
+        IndexT digit;
+        for (digit = 0; digit < numDigits; digit++)
+        {
+            counts[digit][(item.bits >> (digit * 8)) & 0xff]++;
+        }
+    }
+
+    IndexT src = 0;
+    IndexT digit;
+    for (digit = 0; digit < numDigits; digit++)
+    {
+        uint32* count = counts[digit];
+        Bits firstDigit = (buffers[src][0].bits >> (digit * 8)) & 0xff;
+        if (count[firstDigit] == uint32(num))
+        {
+            continue;
+        }
+
+        uint32 offsets[256];
+        uint32 sum = 0;
+        IndexT b;
+        for (b = 0; b < 256; b++)
+        {
+            offsets[b] = sum;
+            sum += count[b];
+        }
+
+        const Array<Item>& from = buffers[src];
+        Array<Item>& to = buffers[src ^ 1];
+        for (i = 0; i < num; i++)
+        {
+            to[offsets[(from[i].bits >> (digit * 8)) & 0xff]++] = from[i];
+        }
+        src ^= 1;
+    }
+
+    order.Reserve(num);
+    for (i = 0; i < num; i++)
+    {
+        order.Append(buffers[src][i].index);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Erase(const KEYTYPE& key)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    IndexT eraseIndex = this->FindIndex(key);
+    #if PH_BOUNDSCHECKS
+    ph_assert(InvalidIndex != eraseIndex);
+    #endif
+    this->EraseAtIndex(eraseIndex);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::EraseAtIndex(IndexT index)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    this->keys.EraseIndex(index);
+    this->values.EraseIndex(index);
+    this->InvalidateSearchLayout();
+}
+
+//------------------------------------------------------------------------------
+/**
+    The searches read the key arrays through plain pointers, every index
+    is in range by construction and the bounds checked operator[] would
+    cost more than the comparison.
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> IndexT
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::LowerBound(const KEYTYPE& key) const
+{
+    const KEYTYPE* sorted = this->keys.Begin();
+    IndexT first = 0;
+    SizeT len = this->keys.Size();
+    while (len > 0)
+    {
+        SizeT half = len >> 1;
+        if (sorted[first + half] < key)
+        {
+            first += half + 1;
+            len -= half + 1;
+        }
+        else
+        {
+            len = half;
+        }
+    }
+    return first;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> IndexT
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::UpperBound(const KEYTYPE& key) const
+{
+    const KEYTYPE* sorted = this->keys.Begin();
+    IndexT first = 0;
+    SizeT len = this->keys.Size();
+    while (len > 0)
+    {
+        SizeT half = len >> 1;
+        if (!(key < sorted[first + half]))
+        {
+            first += half + 1;
+            len -= half + 1;
+        }
+        else
+        {
+            len = half;
+        }
+    }
+    return first;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Descends to a leaf, going right whenever the node is less than the key;
+    the comparison result is the index arithmetic, not a branch. The last
+    node where the search went left is the lower bound: strip the trailing
+    right turns (1 bits) and the left turn itself.
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> IndexT
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::LowerBoundEytzinger(const KEYTYPE& key) const
+{
+    const KEYTYPE* layout = this->layoutKeys.Begin();
+    SizeT num = this->keys.Size();
+    IndexT node = 1;
+    while (node <= num)
+    {
+        node = 2 * node + (layout[node] < key ? 1 : 0);
+    }
+    while (node & 1)
+    {
+        node >>= 1;
+    }
+    node >>= 1;
+    return (0 == node) ? num : this->layoutIndices[node];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> IndexT
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::FindIndex(const KEYTYPE& key) const
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    IndexT index;
+    if (EYTZINGER && this->layoutValid)
+    {
+        index = this->LowerBoundEytzinger(key);
+    }
+    else
+    {
+        index = this->LowerBound(key);
+    }
+    if (index < this->keys.Size() && !(key < this->keys[index]))
+    {
+        return index;
+    }
+    return InvalidIndex;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> bool
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::Contains(const KEYTYPE& key) const
+{
+    return (InvalidIndex != this->FindIndex(key));
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> const KEYTYPE&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::KeyAtIndex(IndexT index) const
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    return this->keys[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> VALUETYPE&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::ValueAtIndex(IndexT index)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    return this->values[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> const VALUETYPE&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::ValueAtIndex(IndexT index) const
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    return this->values[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+    Like Dictionary, a missing key is created with a default value.
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> VALUETYPE&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::operator[](const KEYTYPE& key)
+{
+    if (this->inBulkInsert)
+    {
+        this->keys.Append(key);
+        this->values.Append(VALUETYPE());
+        return this->values.Back();
+    }
+    IndexT index = this->FindIndex(key);
+    if (InvalidIndex == index)
+    {
+        index = this->UpperBound(key);
+        this->keys.Insert(index, key);
+        this->values.Insert(index, VALUETYPE());
+        this->InvalidateSearchLayout();
+    }
+    return this->values[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> const VALUETYPE&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::operator[](const KEYTYPE& key) const
+{
+    IndexT index = this->FindIndex(key);
+    #if PH_BOUNDSCHECKS
+    ph_assert(InvalidIndex != index);
+    #endif
+    return this->values[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> const Array<KEYTYPE>&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::KeysAsArray() const
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    return this->keys;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> const Array<VALUETYPE>&
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::ValuesAsArray() const
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    return this->values;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::InvalidateSearchLayout()
+{
+    this->layoutValid = false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> bool
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::HasSearchLayout() const
+{
+    return EYTZINGER && this->layoutValid;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> void
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::BuildSearchLayout()
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(!this->inBulkInsert);
+    #endif
+    if (!EYTZINGER || this->layoutValid)
+    {
+        return;
+    }
+    SizeT num = this->keys.Size();
+    this->layoutKeys.Clear();
+    this->layoutIndices.Clear();
+    if (num > 0)
+    {
+        // slot 0 is unused so the children of node k are 2k and 2k+1
+        this->layoutKeys.Resize(num + 1);
+        this->layoutIndices.Resize(num + 1);
+        this->FillEytzinger(0, 1);
+    }
+    this->layoutValid = true;
+}
+
+//------------------------------------------------------------------------------
+/**
+    In-order walk of the implicit tree, which visits the nodes in key order.
+*/
+template<class KEYTYPE, class VALUETYPE, bool EYTZINGER> IndexT
+FlatDictionary<KEYTYPE, VALUETYPE, EYTZINGER>::FillEytzinger(IndexT index, IndexT node)
+{
+    if (node <= this->keys.Size())
+    {
+        index = this->FillEytzinger(index, 2 * node);
+        this->layoutKeys[node] = this->keys[index];
+        this->layoutIndices[node] = index;
+        index = this->FillEytzinger(index + 1, 2 * node + 1);
+    }
+    return index;
+}
+
+} // namespace Philo
+//------------------------------------------------------------------------------
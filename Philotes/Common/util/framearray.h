@@ -0,0 +1,309 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class FrameArray
+
+    A growable array which keeps its elements in the global frame heap
+    (see core/frameallocator.h) instead of the regular heap. It has the
+    part of the Array interface which per-frame lists need: appending,
+    indexing, iterating and Reset().
+
+    Growing copies the elements to a new, larger block and abandons the
+    old one, the frame heap gets everything back at once when it is
+    reset. Elements are copied with memcpy and never destroyed, so only
+    trivially copyable types are allowed (see core/typetraits.h), other
+    types don't compile.
+
+    The content stays valid until the frame after the one in which it was
+    appended ends. Reset() empties the array; the block is reused if it
+    was allocated in the current frame, otherwise the next Append()
+    allocates a new one from the current frame heap, as large as the
+    previous block. Lists which are filled every frame should therefore be
+    Reset() once per frame, they then grow only when they get longer.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+#include "core/typetraits.h"
+#include "core/frameallocator.h"
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+template<class TYPE> class FrameArray
+{
+public:
+    /// define iterator
+    typedef TYPE* Iterator;
+
+    /// constructor
+    FrameArray();
+    /// copy constructor, the copy lives in the current frame
+    FrameArray(const FrameArray<TYPE>& rhs);
+    /// assignment operator, the copy lives in the current frame
+    void operator=(const FrameArray<TYPE>& rhs);
+    /// [] operator
+    TYPE& operator[](IndexT index) const;
+
+    /// append element to end of array
+    void Append(const TYPE& elm);
+    /// make room for at least num elements
+    void Reserve(SizeT num);
+    /// get number of elements in array
+    SizeT Size() const;
+    /// get overall allocated size of array in number of elements
+    SizeT Capacity() const;
+    /// return true if array empty
+    bool IsEmpty() const;
+    /// return reference to first element
+    TYPE& Front() const;
+    /// return reference to last element
+    TYPE& Back() const;
+    /// remove element at index, fill gap by swapping in last element
+    void EraseIndexSwap(IndexT index);
+    /// empty the array, keeps the block if it belongs to the current frame
+    void Reset();
+    /// same as Reset(), destructors are never called
+    void Clear();
+    /// return iterator to beginning of array
+    Iterator Begin() const;
+    /// return iterator to end of array
+    Iterator End() const;
+
+private:
+    /// move the elements to a block of at least the given capacity in the current frame
+    void Grow(SizeT newCapacity);
+
+    /// elements are copied with memcpy and never destroyed
+    enum { ElementsAreTriviallyCopyable = sizeof(RequireTriviallyCopyable<TypeTraits<TYPE>::IsTriviallyCopyable>) };
+
+    TYPE* elements;
+    SizeT size;
+    SizeT capacity;
+    SizeT frameIndex;       // frame in which elements was allocated
+    SizeT capacityHint;     // capacity before the last Reset() dropped the block
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+FrameArray<TYPE>::FrameArray() :
+    elements(0),
+    size(0),
+    capacity(0),
+    frameIndex(0),
+    capacityHint(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+FrameArray<TYPE>::FrameArray(const FrameArray<TYPE>& rhs) :
+    elements(0),
+    size(0),
+    capacity(0),
+    frameIndex(0),
+    capacityHint(0)
+{
+    *this = rhs;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+FrameArray<TYPE>::operator=(const FrameArray<TYPE>& rhs)
+{
+    if (this != &rhs)
+    {
+        this->Reset();
+        this->Reserve(rhs.size);
+        if (rhs.size > 0)
+        {
+            #if PH_BOUNDSCHECKS
+            ph_assert(Memory::GetFrameIndex() - rhs.frameIndex <= 1);
+            #endif
+            memcpy(this->elements, rhs.elements, rhs.size * sizeof(TYPE));
+        }
+        this->size = rhs.size;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    A factor of 2 keeps the abandoned blocks at less than the final one.
+*/
+template<class TYPE> void
+FrameArray<TYPE>::Grow(SizeT newCapacity)
+{
+    if (newCapacity < this->capacityHint)
+    {
+        newCapacity = this->capacityHint;
+    }
+    if (newCapacity < 16)
+    {
+        newCapacity = 16;
+    }
+    TYPE* newElements = (TYPE*) Memory::GetFrameAllocator()->Alloc(newCapacity * sizeof(TYPE));
+    if (this->size > 0)
+    {
+        // the old block must not have been reset yet
+        #if PH_BOUNDSCHECKS
+        ph_assert(Memory::GetFrameIndex() - this->frameIndex <= 1);
+        #endif
+        memcpy(newElements, this->elements, this->size * sizeof(TYPE));
+    }
+    this->elements = newElements;
+    this->capacity = newCapacity;
+    this->frameIndex = Memory::GetFrameIndex();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> TYPE&
+FrameArray<TYPE>::operator[](IndexT index) const
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(this->elements && (index >= 0) && (index < this->size));
+    ph_assert(Memory::GetFrameIndex() - this->frameIndex <= 1);
+    #endif
+    return this->elements[index];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+FrameArray<TYPE>::Append(const TYPE& elm)
+{
+    if (this->size == this->capacity)
+    {
+        this->Grow(this->capacity * 2);
+    }
+    #if PH_BOUNDSCHECKS
+    ph_assert(Memory::GetFrameIndex() - this->frameIndex <= 1);
+    #endif
+    this->elements[this->size++] = elm;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+FrameArray<TYPE>::Reserve(SizeT num)
+{
+    if (num > this->capacity)
+    {
+        this->Grow(num);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+FrameArray<TYPE>::Size() const
+{
+    return this->size;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+FrameArray<TYPE>::Capacity() const
+{
+    return this->capacity;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+FrameArray<TYPE>::IsEmpty() const
+{
+    return 0 == this->size;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> TYPE&
+FrameArray<TYPE>::Front() const
+{
+    return (*this)[0];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> TYPE&
+FrameArray<TYPE>::Back() const
+{
+    return (*this)[this->size - 1];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+FrameArray<TYPE>::EraseIndexSwap(IndexT index)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(this->elements && (index >= 0) && (index < this->size));
+    #endif
+    this->elements[index] = this->elements[--this->size];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+FrameArray<TYPE>::Reset()
+{
+    this->size = 0;
+    if (this->frameIndex != Memory::GetFrameIndex())
+    {
+        if (this->capacity > 0)
+        {
+            this->capacityHint = this->capacity;
+        }
+        this->elements = 0;
+        this->capacity = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+FrameArray<TYPE>::Clear()
+{
+    this->Reset();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> typename FrameArray<TYPE>::Iterator
+FrameArray<TYPE>::Begin() const
+{
+    return this->elements;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> typename FrameArray<TYPE>::Iterator
+FrameArray<TYPE>::End() const
+{
+    return this->elements + this->size;
+}
+
+} // namespace Philo
+//------------------------------------------------------------------------------
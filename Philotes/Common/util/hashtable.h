@@ -2,28 +2,34 @@
 //------------------------------------------------------------------------------
 /**
     @class HashTable
-    
+
     Organizes key/value pairs by a hash code. Looks very similar
     to a Dictionary, but may provide better search times (up to O(1))
     by computing a (ideally unique) hash code on the key and using that as an
     index into an array. The flipside is that the key class must provide
     a hash code and the memory footprint may be larger then Dictionary.
-    
-    The default capacity is 128. Matching the capacity against the number
-    of expected elements in the hash table is one key to get optimal 
-    insertion and search times, the other is to provide a good (and fast) 
-    hash code computation which produces as few collissions as possible 
-    for the key type.
 
     The key class must implement the following method in order to
-    work with the HashTable:    
+    work with the HashTable:
     IndexT HashCode() const;
 
     The String class implements this method as an example.
-    Internally the hash table is implemented as a fixed array
-    of sorted arrays. The fixed array is indexed by the hash code
-    of the key, the sorted arrays contain all values with identical
-    keys.
+    Internally the hash table is a single open addressing array with
+    robin hood insertion: an element that is further away from its home
+    slot than the element it meets takes that slot, which keeps probe
+    sequences short and lets a search stop early. Erased elements are
+    removed by shifting their successors back, so no tombstones are left.
+
+    The table doubles its capacity whenever it gets 7/8 full, so the
+    capacity given to the constructor is only a hint to avoid rehashing.
+    Probing never wraps around, the slot array has a tail of extra slots
+    instead; this way erasing through an iterator never moves an element
+    the iteration has already passed.
+
+    With CACHEHASH the mixed hash code of each element is stored next to
+    it, which saves the key comparison for most mismatches and the
+    HashCode() calls when growing. Turn it off for keys that are cheap to
+    hash and compare (integers) to save the memory.
 
     (C) 2006 Radon Labs GmbH
 */
@@ -33,20 +39,17 @@
 
 	д˵ԼغЧʲ
 
-	CapacityĬ128(2,000,000)ǵHashTable(SizeT capacity)죬Ҫű磻
-
 	Added by Li
 	(C) 2012 PhiloLabs
 */
 
-#include "util/fixedarray.h"
 #include "util/array.h"
 #include "util/keyvaluepair.h"
 
 //------------------------------------------------------------------------------
 namespace Philo
 {
-template<class KEYTYPE, class VALUETYPE> class HashTable
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH = true> class HashTable
 {
 public:
 	class Iterator;
@@ -54,22 +57,26 @@ public:
 
     /// default constructor
     HashTable();
-    /// constructor with capacity
+    /// constructor with the number of elements to make room for
     HashTable(SizeT capacity);
     /// copy constructor
-    HashTable(const HashTable<KEYTYPE, VALUETYPE>& rhs);
+    HashTable(const HashTable<KEYTYPE, VALUETYPE, CACHEHASH>& rhs);
+    /// destructor
+    ~HashTable();
     /// assignment operator
-    void operator=(const HashTable<KEYTYPE, VALUETYPE>& rhs);
+    void operator=(const HashTable<KEYTYPE, VALUETYPE, CACHEHASH>& rhs);
     /// read/write [] operator, assertion if key not found
     VALUETYPE& operator[](const KEYTYPE& key) const;
     /// return current number of values in the hashtable
 	SizeT Size() const{return this->size;}
-    /// return fixed-size capacity of the hash table
-	SizeT Capacity() const{return this->hashArray.Size();}
+    /// return current capacity of the hash table, grows automatically
+	SizeT Capacity() const{return this->capacity;}
     /// clear the hashtable
     void Clear();
     /// return true if empty
     bool IsEmpty() const;
+    /// make room for at least the given number of elements without growing
+    void Reserve(SizeT num);
     /// add a key/value pair object to the hash table
     void Add(const KeyValuePair<KEYTYPE, VALUETYPE>& kvp);
     /// add a key and associated value
@@ -99,7 +106,7 @@ public:
 		/// default constructor
 		Iterator();
 		/// constructor
-		Iterator(FixedArray<Array<KeyValuePair<KEYTYPE, VALUETYPE> > >* hashArr, int idx1, int idx2);
+		Iterator(HashTable<KEYTYPE, VALUETYPE, CACHEHASH>* table, IndexT slot);
 		/// copy constructor
 		Iterator(const Iterator& rhs);
 		/// assignment operator
@@ -118,112 +125,256 @@ public:
 		KeyValuePair<KEYTYPE, VALUETYPE>& operator*() const;
 
 	private:
-		friend class HashTable<KEYTYPE, VALUETYPE>;
+		friend class HashTable<KEYTYPE, VALUETYPE, CACHEHASH>;
 
-		void set_begin();
-		void set_end();
-		bool is_end();
-
-		FixedArray<Array<KeyValuePair<KEYTYPE, VALUETYPE> > >* hash_array_ptr;
-		int idx_1;
-		int idx_2;
+		HashTable<KEYTYPE, VALUETYPE, CACHEHASH>* table_ptr;
+		IndexT slot;
 	};
 
 private:
-    FixedArray<Array<KeyValuePair<KEYTYPE, VALUETYPE> > > hashArray;
-    int size;
+    friend class Iterator;
+
+    /// smallest capacity allocated on first use
+    static const SizeT MinCapacity = 16;
+
+    /// scramble the key's hash code so the low bits used for the home slot are well distributed
+    static uint32 MixHash(const KEYTYPE& key);
+    /// longest probe sequence allowed for a capacity before the table grows
+    static SizeT ComputeMaxProbe(SizeT capacity);
+    /// return slot of key, InvalidIndex if not found
+    IndexT FindSlot(const KEYTYPE& key) const;
+    /// robin hood insert, false if some element would exceed maxProbe, kvp and hash then hold that element
+    bool InsertSlot(KeyValueType& kvp, uint32& hash);
+    /// insert an element known not to be in the table, growing as needed
+    void InsertGrow(const KeyValueType& kvp, uint32 hash);
+    /// remove the element in a slot and shift its successors back
+    void EraseSlot(IndexT slot);
+    /// move all elements into a table of the given size
+    void Rehash(SizeT newCapacity, SizeT newMaxProbe);
+    /// release the slot arrays
+    void Delete();
+    /// copy the slot arrays of another table
+    void Copy(const HashTable<KEYTYPE, VALUETYPE, CACHEHASH>& rhs);
+    /// first occupied slot at or after the given one, NumSlots() if none
+    IndexT NextSlot(IndexT slot) const;
+    /// total number of slots including the tail
+    SizeT NumSlots() const;
+
+    KeyValueType* slots;
+    uint16* distances;          // probe distance + 1 per slot, 0 marks an empty slot
+    uint32* hashes;             // mixed hash code per slot, only with CACHEHASH
+    SizeT capacity;             // power of two, the home slot range
+    SizeT maxProbe;             // length of the tail
+    SizeT size;
 };
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
-HashTable<KEYTYPE, VALUETYPE>::HashTable() :
-    hashArray(128),
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::HashTable() :
+    slots(0),
+    distances(0),
+    hashes(0),
+    capacity(0),
+    maxProbe(0),
+    size(0)
+{
+    // empty, the slots are allocated on the first Add()
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::HashTable(SizeT capacity) :
+    slots(0),
+    distances(0),
+    hashes(0),
+    capacity(0),
+    maxProbe(0),
     size(0)
 {
-    // empty
+    this->Reserve(capacity);
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
-HashTable<KEYTYPE, VALUETYPE>::HashTable(SizeT capacity) :
-    hashArray(capacity),
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::HashTable(const HashTable<KEYTYPE, VALUETYPE, CACHEHASH>& rhs) :
+    slots(0),
+    distances(0),
+    hashes(0),
+    capacity(0),
+    maxProbe(0),
     size(0)
 {
-    // empty
+    this->Copy(rhs);
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
-HashTable<KEYTYPE, VALUETYPE>::HashTable(const HashTable<KEYTYPE, VALUETYPE>& rhs) :
-    hashArray(rhs.hashArray),
-    size(rhs.size)
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::~HashTable()
 {
-    // empty
+    this->Delete();
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 void
-HashTable<KEYTYPE, VALUETYPE>::operator=(const HashTable<KEYTYPE, VALUETYPE>& rhs)
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::operator=(const HashTable<KEYTYPE, VALUETYPE, CACHEHASH>& rhs)
 {
     if (this != &rhs)
     {
-        this->hashArray = rhs.hashArray;
-        this->size = rhs.size;
+        this->Delete();
+        this->Copy(rhs);
     }
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
-VALUETYPE&
-HashTable<KEYTYPE, VALUETYPE>::operator[](const KEYTYPE& key) const
-{
-    // get hash code from key, trim to capacity
-    IndexT hashIndex = key.HashCode() % this->hashArray.Size();
-    const Array<KeyValuePair<KEYTYPE, VALUETYPE> >& hashElements = this->hashArray[hashIndex];
-    int numHashElements = hashElements.Size();
-    #if PH_BOUNDSCHECKS    
-    ph_assert(0 != numHashElements); // element with key doesn't exist
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+void
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Delete()
+{
+    if (this->slots)
+    {
+        ph_delete_array(this->slots);
+        ph_delete_array(this->distances);
+        if (CACHEHASH)
+        {
+            ph_delete_array(this->hashes);
+        }
+    }
+    this->slots = 0;
+    this->distances = 0;
+    this->hashes = 0;
+    this->capacity = 0;
+    this->maxProbe = 0;
+    this->size = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+void
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Copy(const HashTable<KEYTYPE, VALUETYPE, CACHEHASH>& rhs)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 == this->slots);
     #endif
-    if (1 == numHashElements)
+    if (rhs.slots)
     {
-        // no hash collissions, just return the only existing element
-        return hashElements[0].Value();
+        this->capacity = rhs.capacity;
+        this->maxProbe = rhs.maxProbe;
+        this->size = rhs.size;
+
+        SizeT num = rhs.NumSlots();
+        this->slots = ph_new_array(KeyValueType, num);
+        this->distances = ph_new_array(uint16, num);
+        if (CACHEHASH)
+        {
+            this->hashes = ph_new_array(uint32, num);
+        }
+        IndexT i;
+        for (i = 0; i < num; i++)
+        {
+            this->distances[i] = rhs.distances[i];
+            if (0 != rhs.distances[i])
+            {
+                this->slots[i] = rhs.slots[i];
+                if (CACHEHASH)
+                {
+                    this->hashes[i] = rhs.hashes[i];
+                }
+            }
+        }
     }
-    else
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+inline SizeT
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::NumSlots() const
+{
+    return this->capacity + this->maxProbe;
+}
+
+//------------------------------------------------------------------------------
+/**
+    A murmur3 style finalizer, HashCode() implementations are often weak
+    in their low bits which are exactly the ones a power of two table uses.
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+inline uint32
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::MixHash(const KEYTYPE& key)
+{
+    uint32 h = (uint32)key.HashCode();
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Robin hood probe lengths grow with the log of the capacity, twice that
+    is only reached by degenerate hash codes.
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+SizeT
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::ComputeMaxProbe(SizeT capacity)
+{
+    SizeT log2 = 0;
+    while ((1 << log2) < capacity)
     {
-        // here's a hash collision, find the right key
-        // with a binary search
-        IndexT hashElementIndex = hashElements.BinarySearchIndex(key);
-        #if PH_BOUNDSCHECKS
-        ph_assert(InvalidIndex != hashElementIndex);
-        #endif
-        return hashElements[hashElementIndex].Value();
+        log2++;
     }
+    return 2 * log2 + 8;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+VALUETYPE&
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::operator[](const KEYTYPE& key) const
+{
+    IndexT slot = this->FindSlot(key);
+    #if PH_BOUNDSCHECKS
+    ph_assert(InvalidIndex != slot); // element with key doesn't exist
+    #endif
+    return this->slots[slot].Value();
+}
+
+//------------------------------------------------------------------------------
+/**
+    Keeps the allocated slots.
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 void
-HashTable<KEYTYPE, VALUETYPE>::Clear()
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Clear()
 {
     IndexT i;
-    SizeT num = this->hashArray.Size();
+    SizeT num = this->NumSlots();
     for (i = 0; i < num; ++i)
     {
-        this->hashArray[i].Clear();
+        if (0 != this->distances[i])
+        {
+            this->slots[i] = KeyValueType();
+            this->distances[i] = 0;
+        }
     }
     this->size = 0;
 }
@@ -231,9 +382,9 @@ HashTable<KEYTYPE, VALUETYPE>::Clear()
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 bool
-HashTable<KEYTYPE, VALUETYPE>::IsEmpty() const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::IsEmpty() const
 {
     return (0 == this->size);
 }
@@ -241,24 +392,187 @@ HashTable<KEYTYPE, VALUETYPE>::IsEmpty() const
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 void
-HashTable<KEYTYPE, VALUETYPE>::Add(const KeyValuePair<KEYTYPE, VALUETYPE>& kvp)
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Reserve(SizeT num)
+{
+    SizeT newCapacity = MinCapacity;
+    while (newCapacity * 7 < num * 8)
+    {
+        newCapacity <<= 1;
+    }
+    if (newCapacity > this->capacity)
+    {
+        this->Rehash(newCapacity, ComputeMaxProbe(newCapacity));
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Builds new slot arrays and reinserts every element. Should a probe
+    sequence still get too long the tail is doubled and the rehash starts
+    over from the old arrays, which are untouched until the end.
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+void
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Rehash(SizeT newCapacity, SizeT newMaxProbe)
+{
+    KeyValueType* oldSlots = this->slots;
+    uint16* oldDistances = this->distances;
+    uint32* oldHashes = this->hashes;
+    SizeT oldNumSlots = this->NumSlots();
+
+    bool done = false;
+    while (!done)
+    {
+        #if PH_BOUNDSCHECKS
+        ph_assert(newMaxProbe < 0xffff);
+        #endif
+        this->capacity = newCapacity;
+        this->maxProbe = newMaxProbe;
+        SizeT num = this->NumSlots();
+        this->slots = ph_new_array(KeyValueType, num);
+        this->distances = ph_new_array(uint16, num);
+        this->hashes = CACHEHASH ? ph_new_array(uint32, num) : 0;
+        memset(this->distances, 0, num * sizeof(uint16));
+
+        done = true;
+        IndexT i;
+        for (i = 0; i < oldNumSlots && done; i++)
+        {
+            if (0 != oldDistances[i])
+            {
+                KeyValueType kvp(oldSlots[i]);
+                uint32 hash = CACHEHASH ? oldHashes[i] : MixHash(kvp.Key());
+                done = this->InsertSlot(kvp, hash);
+            }
+        }
+        if (!done)
+        {
+            ph_delete_array(this->slots);
+            ph_delete_array(this->distances);
+            if (CACHEHASH)
+            {
+                ph_delete_array(this->hashes);
+            }
+            newMaxProbe *= 2;
+        }
+    }
+
+    if (oldSlots)
+    {
+        ph_delete_array(oldSlots);
+        ph_delete_array(oldDistances);
+        if (CACHEHASH)
+        {
+            ph_delete_array(oldHashes);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    Walks from the home slot, swapping the carried element with any element
+    that sits closer to its own home. On failure the element that could not
+    be placed is handed back in kvp and hash, everything else is in the table.
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+bool
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::InsertSlot(KeyValueType& kvp, uint32& hash)
+{
+    IndexT slot = hash & (this->capacity - 1);
+    uint16 dist = 1;
+    while (dist <= this->maxProbe)
+    {
+        uint16 slotDist = this->distances[slot];
+        if (0 == slotDist)
+        {
+            this->slots[slot] = kvp;
+            this->distances[slot] = dist;
+            if (CACHEHASH)
+            {
+                this->hashes[slot] = hash;
+            }
+            return true;
+        }
+        if (slotDist < dist)
+        {
+            // take the slot from the richer element and carry that one on
+            KeyValueType tmp(this->slots[slot]);
+            this->slots[slot] = kvp;
+            kvp = tmp;
+            this->distances[slot] = dist;
+            dist = slotDist;
+            if (CACHEHASH)
+            {
+                uint32 tmpHash = this->hashes[slot];
+                this->hashes[slot] = hash;
+                hash = tmpHash;
+            }
+            else
+            {
+                hash = MixHash(kvp.Key());
+            }
+        }
+        slot++;
+        dist++;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+void
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::InsertGrow(const KeyValueType& kvp, uint32 hash)
+{
+    if (0 == this->capacity || (this->size + 1) * 8 > this->capacity * 7)
+    {
+        SizeT newCapacity = MinCapacity;
+        if (this->capacity > 0)
+        {
+            newCapacity = this->capacity * 2;
+        }
+        this->Rehash(newCapacity, ComputeMaxProbe(newCapacity));
+    }
+
+    KeyValueType carry(kvp);
+    while (!this->InsertSlot(carry, hash))
+    {
+        // a long probe sequence at low load means clustered hash codes,
+        // doubling the capacity would not help as much as a longer tail
+        if (this->size * 2 > this->capacity)
+        {
+            this->Rehash(this->capacity * 2, ComputeMaxProbe(this->capacity * 2));
+        }
+        else
+        {
+            this->Rehash(this->capacity, this->maxProbe * 2);
+        }
+    }
+    this->size++;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+void
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Add(const KeyValuePair<KEYTYPE, VALUETYPE>& kvp)
 {
     #if PH_BOUNDSCHECKS
     ph_assert(!this->Contains(kvp.Key()));
     #endif
-    IndexT hashIndex = kvp.Key().HashCode() % this->hashArray.Size();
-    this->hashArray[hashIndex].InsertSorted(kvp);
-    this->size++;
+    this->InsertGrow(kvp, MixHash(kvp.Key()));
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 void
-HashTable<KEYTYPE, VALUETYPE>::Add(const KEYTYPE& key, const VALUETYPE& value)
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Add(const KEYTYPE& key, const VALUETYPE& value)
 {
     KeyValuePair<KEYTYPE, VALUETYPE> kvp(key, value);
     this->Add(kvp);
@@ -266,79 +580,132 @@ HashTable<KEYTYPE, VALUETYPE>::Add(const KEYTYPE& key, const VALUETYPE& value)
 
 //------------------------------------------------------------------------------
 /**
+    A search can stop as soon as it meets an element closer to its home
+    than the key would be, the insertion would have displaced it.
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+IndexT
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::FindSlot(const KEYTYPE& key) const
+{
+    if (0 == this->size)
+    {
+        return InvalidIndex;
+    }
+    uint32 hash = MixHash(key);
+    IndexT slot = hash & (this->capacity - 1);
+    uint16 dist = 1;
+    while (this->distances[slot] >= dist)
+    {
+        if (this->distances[slot] == dist &&
+            (!CACHEHASH || this->hashes[slot] == hash) &&
+            this->slots[slot].Key() == key)
+        {
+            return slot;
+        }
+        slot++;
+        dist++;
+    }
+    return InvalidIndex;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Backward shift deletion: the following elements that are not in their
+    home slot move back by one, so only slots after the erased one change.
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+void
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::EraseSlot(IndexT slot)
+{
+    SizeT num = this->NumSlots();
+    IndexT next = slot + 1;
+    while (next < num && this->distances[next] > 1)
+    {
+        this->slots[slot] = this->slots[next];
+        this->distances[slot] = this->distances[next] - 1;
+        if (CACHEHASH)
+        {
+            this->hashes[slot] = this->hashes[next];
+        }
+        slot = next++;
+    }
+    this->slots[slot] = KeyValueType();
+    this->distances[slot] = 0;
+    this->size--;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 void
-HashTable<KEYTYPE, VALUETYPE>::Erase(const KEYTYPE& key)
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Erase(const KEYTYPE& key)
 {
     #if PH_BOUNDSCHECKS
     ph_assert(this->size > 0);
     #endif
-    IndexT hashIndex = key.HashCode() % this->hashArray.Size();
-    Array<KeyValuePair<KEYTYPE, VALUETYPE> >& hashElements = this->hashArray[hashIndex];
-    IndexT hashElementIndex = hashElements.BinarySearchIndex(key);
+    IndexT slot = this->FindSlot(key);
     #if PH_BOUNDSCHECKS
-    ph_assert(InvalidIndex != hashElementIndex); // key doesn't exist
+    ph_assert(InvalidIndex != slot); // key doesn't exist
     #endif
-    hashElements.EraseIndex(hashElementIndex);
-    this->size--;
+    this->EraseSlot(slot);
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 bool
-HashTable<KEYTYPE, VALUETYPE>::Contains(const KEYTYPE& key) const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Contains(const KEYTYPE& key) const
 {
-    if (this->size > 0)
-    {
-        IndexT hashIndex = key.HashCode() % this->hashArray.Size();
-        Array<KeyValuePair<KEYTYPE, VALUETYPE> >& hashElements = this->hashArray[hashIndex];
-        IndexT hashElementIndex = hashElements.BinarySearchIndex(key);
-        return (InvalidIndex != hashElementIndex);
-    }
-    else
-    {
-        return false;
-    }
+    return (InvalidIndex != this->FindSlot(key));
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 Array<KeyValuePair<KEYTYPE, VALUETYPE> >
-HashTable<KEYTYPE, VALUETYPE>::Content() const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Content() const
 {
     Array<KeyValuePair<KEYTYPE, VALUETYPE> > result(this->size, 8);//Ԥsizeby Li
-    int num = this->hashArray.Size();
-    for (int i = 0; i < num; i++)
+    SizeT num = this->NumSlots();
+    for (IndexT i = 0; i < num; i++)
     {
-        if (this->hashArray[i].Size() > 0)
+        if (0 != this->distances[i])
         {
-            result.AppendArray(this->hashArray[i]);
+            result.Append(this->slots[i]);
         }
     }
     return result;
 }
 
+//------------------------------------------------------------------------------
+/**
+*/
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+IndexT
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::NextSlot(IndexT slot) const
+{
+    SizeT num = this->NumSlots();
+    while (slot < num && 0 == this->distances[slot])
+    {
+        slot++;
+    }
+    return slot;
+}
+
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 KeyValuePair<KEYTYPE, VALUETYPE>*
-HashTable<KEYTYPE, VALUETYPE>::FindKV(const KEYTYPE& key)
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::FindKV(const KEYTYPE& key)
 {
-	if (this->size < 0)
-		return NULL;
-
-	IndexT hashIndex = key.HashCode() % this->hashArray.Size();
-	Array<KeyValuePair<KEYTYPE, VALUETYPE> >& hashElements = this->hashArray[hashIndex];
-	IndexT hashElementIndex = hashElements.BinarySearchIndex(key);
-	if (InvalidIndex != hashElementIndex)
-		return &(hashElements[hashElementIndex]);
+	IndexT slot = this->FindSlot(key);
+	if (InvalidIndex != slot)
+		return &(this->slots[slot]);
 
 	return NULL;
 }
@@ -346,18 +713,13 @@ HashTable<KEYTYPE, VALUETYPE>::FindKV(const KEYTYPE& key)
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-typename HashTable<KEYTYPE, VALUETYPE>::Iterator
-HashTable<KEYTYPE, VALUETYPE>::Find(const KEYTYPE& key)
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+typename HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Find(const KEYTYPE& key)
 {
-	if (this->size < 0)
-		return this->End();
-
-	IndexT hashIndex = key.HashCode() % this->hashArray.Size();
-	Array<KeyValuePair<KEYTYPE, VALUETYPE> >& hashElements = this->hashArray[hashIndex];
-	IndexT hashElementIndex = hashElements.BinarySearchIndex(key);
-	if (InvalidIndex != hashElementIndex)
-		return Iterator(&(this->hashArray), hashIndex, hashElementIndex); 
+	IndexT slot = this->FindSlot(key);
+	if (InvalidIndex != slot)
+		return Iterator(this, slot);
 
 	return this->End();
 }
@@ -366,57 +728,51 @@ HashTable<KEYTYPE, VALUETYPE>::Find(const KEYTYPE& key)
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-typename HashTable<KEYTYPE, VALUETYPE>::Iterator
-HashTable<KEYTYPE, VALUETYPE>::Begin()
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+typename HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Begin()
 {
-	for (int i = 0; i < this->hashArray.Size(); ++i)
-	{
-		for (int j = 0; j < this->hashArray[i].Size(); ++j)
-		{
-			return Iterator(&(this->hashArray), i, j); 
-		}
-	}
-
-	return Iterator(&(this->hashArray), this->hashArray.Size(), 0); 
+	return Iterator(this, this->NextSlot(0));
 }
 
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-typename HashTable<KEYTYPE, VALUETYPE>::Iterator
-HashTable<KEYTYPE, VALUETYPE>::End()
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+typename HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::End()
 {
-	return Iterator(&(this->hashArray), this->hashArray.Size(), 0); 
+	return Iterator(this, this->NumSlots());
 }
 
 //------------------------------------------------------------------------------
 /**
 	Added by Li
+
+	The erased slot is refilled by the next element of its probe sequence
+	if there is one, all other shifted elements are still ahead of the
+	iterator too, so it simply stays or moves on to the next occupied slot.
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 void
-HashTable<KEYTYPE, VALUETYPE>::Erase(Iterator& iter)
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Erase(Iterator& iter)
 {
-	int idx1 = iter.idx_1;
-	int idx2 = iter.idx_2;
-	--iter;
-	this->hashArray[idx1].EraseIndex(idx2);
-	++iter;
-	--(this->size);
+	#if PH_BOUNDSCHECKS
+	ph_assert(iter.table_ptr == this && 0 != this->distances[iter.slot]);
+	#endif
+	this->EraseSlot(iter.slot);
+	iter.slot = this->NextSlot(iter.slot);
 }
 
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-HashTable<KEYTYPE, VALUETYPE>::Iterator::Iterator() :
-hash_array_ptr(0),
-idx_1(0),
-idx_2(0)
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::Iterator() :
+table_ptr(0),
+slot(0)
 {
 	// empty
 }
@@ -425,11 +781,10 @@ idx_2(0)
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-HashTable<KEYTYPE, VALUETYPE>::Iterator::Iterator(FixedArray<Array<KeyValuePair<KEYTYPE, VALUETYPE> > >* hashArr, int idx1, int idx2) :
-hash_array_ptr(hashArr),
-idx_1(idx1),
-idx_2(idx2)
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::Iterator(HashTable<KEYTYPE, VALUETYPE, CACHEHASH>* table, IndexT slot) :
+table_ptr(table),
+slot(slot)
 {
 	// empty
 }
@@ -438,72 +793,26 @@ idx_2(idx2)
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-HashTable<KEYTYPE, VALUETYPE>::Iterator::Iterator(const Iterator& rhs) :
-hash_array_ptr(rhs.hash_array_ptr),
-idx_1(rhs.idx_1),
-idx_2(rhs.idx_2)
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::Iterator(const Iterator& rhs) :
+table_ptr(rhs.table_ptr),
+slot(rhs.slot)
 {
 	// empty
 }
 
-//------------------------------------------------------------------------------
-/**
-Added by Li
-*/
-template<class KEYTYPE, class VALUETYPE>
-inline void
-HashTable<KEYTYPE, VALUETYPE>::Iterator::set_begin()
-{
-	for (int i = 0; i < (*this->hash_array_ptr).Size(); ++i)
-	{
-		for (int j = 0; j < (*this->hash_array_ptr)[i].Size(); ++j)
-		{
-			this->idx_1 = i;
-			this->idx_2 = j;
-			return;
-		}
-	}
-
-	set_end();
-}
-
-//------------------------------------------------------------------------------
-/**
-Added by Li
-*/
-template<class KEYTYPE, class VALUETYPE>
-inline void
-HashTable<KEYTYPE, VALUETYPE>::Iterator::set_end()
-{
-	this->idx_1 = (*this->hash_array_ptr).Size();
-	this->idx_2 = 0;
-}
-
-//------------------------------------------------------------------------------
-/**
-Added by Li
-*/
-template<class KEYTYPE, class VALUETYPE>
-inline bool
-HashTable<KEYTYPE, VALUETYPE>::Iterator::is_end()
-{
-	return (this->idx_1 == (*this->hash_array_ptr).Size() && this->idx_2 == 0);
-}
-
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-const typename HashTable<KEYTYPE, VALUETYPE>::Iterator&
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator=(const Iterator& rhs)
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+const typename HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator&
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator=(const Iterator& rhs)
 {
 	if (&rhs != this)
 	{
-		this->hash_array_ptr = rhs.hash_array_ptr;
-		this->idx_1 = rhs.idx_1;
-		this->idx_2 = rhs.idx_2;
+		this->table_ptr = rhs.table_ptr;
+		this->slot = rhs.slot;
 	}
 	return *this;
 }
@@ -512,61 +821,40 @@ HashTable<KEYTYPE, VALUETYPE>::Iterator::operator=(const Iterator& rhs)
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 bool
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator==(const Iterator& rhs) const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator==(const Iterator& rhs) const
 {
-	return (this->hash_array_ptr == rhs.hash_array_ptr &&
-				this->idx_1 == rhs.idx_1 && this->idx_2 == rhs.idx_2 );
+	return (this->table_ptr == rhs.table_ptr && this->slot == rhs.slot);
 }
 
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 bool
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator!=(const Iterator& rhs) const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator!=(const Iterator& rhs) const
 {
-	return (this->hash_array_ptr != rhs.hash_array_ptr ||
-		this->idx_1 != rhs.idx_1 || this->idx_2 != rhs.idx_2 );
+	return (this->table_ptr != rhs.table_ptr || this->slot != rhs.slot);
 }
 
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-const typename HashTable<KEYTYPE, VALUETYPE>::Iterator&
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator++()
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+const typename HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator&
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator++()
 {
-	#if PH_BOUNDSCHECKS    
-		ph_assert(0 != this->hash_array_ptr);
+	#if PH_BOUNDSCHECKS
+		ph_assert(0 != this->table_ptr);
 	#endif
 
-	if ( is_end() )
-		set_begin();
-
-	if ( (*(this->hash_array_ptr))[this->idx_1].Size() - 1 > this->idx_2 )
-	{
-		++(this->idx_2);
-		return *this; 
-	}
+	if (this->slot >= this->table_ptr->NumSlots())
+		this->slot = this->table_ptr->NextSlot(0);
 	else
-	{
-		int i, j;
-		for ( i = this->idx_1 + 1; i < this->hash_array_ptr->Size(); ++i )
-		{
-			for ( j = 0; j < (*(this->hash_array_ptr))[i].Size(); ++j )
-			{
-				this->idx_1 = i;
-				this->idx_2 = j;
-				return *this; 
-			}
-		}
-	}
-
-	set_end();
+		this->slot = this->table_ptr->NextSlot(this->slot + 1);
 	return *this;
 }
 
@@ -574,34 +862,25 @@ HashTable<KEYTYPE, VALUETYPE>::Iterator::operator++()
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
-const typename HashTable<KEYTYPE, VALUETYPE>::Iterator&
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator--()
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
+const typename HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator&
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator--()
 {
-#if PH_BOUNDSCHECKS    
-	ph_assert(0 != this->hash_array_ptr);
+#if PH_BOUNDSCHECKS
+	ph_assert(0 != this->table_ptr);
 #endif
 
-	if (this->idx_2 > 0)
-	{
-		--(this->idx_2);
-		return *this; 
-	}
-	else
+	IndexT i;
+	for (i = this->slot - 1; i >= 0; --i)
 	{
-		int i, j;
-		for ( i = this->idx_1 - 1; i >=0 ; --i )
+		if (0 != this->table_ptr->distances[i])
 		{
-			for ( j = (*(this->hash_array_ptr))[i].Size() - 1; j >=0; --j )
-			{
-				this->idx_1 = i;
-				this->idx_2 = j;
-				return *this; 
-			}
+			this->slot = i;
+			return *this;
 		}
 	}
 
-	set_end();
+	this->slot = this->table_ptr->NumSlots();
 	return *this;
 }
 
@@ -609,28 +888,28 @@ HashTable<KEYTYPE, VALUETYPE>::Iterator::operator--()
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 KeyValuePair<KEYTYPE, VALUETYPE>*
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator->() const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator->() const
 {
 	#if PH_BOUNDSCHECKS
-		ph_assert(this->hash_array_ptr);
+		ph_assert(this->table_ptr && this->slot < this->table_ptr->NumSlots());
 	#endif
-	return &((*(this->hash_array_ptr))[this->idx_1][this->idx_2]);
+	return &(this->table_ptr->slots[this->slot]);
 }
 
 //------------------------------------------------------------------------------
 /**
 	Added by Li
 */
-template<class KEYTYPE, class VALUETYPE>
+template<class KEYTYPE, class VALUETYPE, bool CACHEHASH>
 KeyValuePair<KEYTYPE, VALUETYPE>&
-HashTable<KEYTYPE, VALUETYPE>::Iterator::operator*() const
+HashTable<KEYTYPE, VALUETYPE, CACHEHASH>::Iterator::operator*() const
 {
 	#if PH_BOUNDSCHECKS
-		ph_assert(this->hash_array_ptr);
+		ph_assert(this->table_ptr && this->slot < this->table_ptr->NumSlots());
 	#endif
-	return (*(this->hash_array_ptr))[this->idx_1][this->idx_2];
+	return this->table_ptr->slots[this->slot];
 }
 
 } // namespace Philo
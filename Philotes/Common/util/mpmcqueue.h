@@ -0,0 +1,361 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class MpmcQueue
+
+    A bounded lock-free queue which any number of threads may push to and
+    pop from at the same time (Dmitry Vyukov's bounded MPMC queue). The
+    capacity is a power of 2 and is fixed by SetCapacity(), which must be
+    called before any thread uses the queue.
+
+    Every slot carries a sequence number which tells whether it is free
+    for the push of a given position or holds the element for the pop of
+    a given position. A thread claims a position with one compare-and-swap
+    on the shared push or pop index, then copies the element and publishes
+    the slot by advancing its sequence number. TryPush() and TryPop() fail
+    instead of waiting when the queue is full or empty.
+
+    PushBatch() and PopBatch() claim a whole range of positions with a
+    single compare-and-swap. They only claim the run of slots which are
+    ready for them: a slot another thread is still copying into or out of
+    ends the batch, so a batch never waits for a preempted thread and
+    may move fewer elements than TryPush()/TryPop() would find room for.
+
+    The push and pop indices are padded by a full cache line on both
+    sides, the queue itself needn't be cache line aligned.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+
+#include <intrin.h>
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+template<class TYPE> class MpmcQueue
+{
+public:
+    /// default constructor
+    MpmcQueue();
+    /// constructor with capacity
+    MpmcQueue(SizeT capacity);
+    /// destructor
+    ~MpmcQueue();
+
+    /// set capacity, rounded up to a power of 2, discards the content, no other thread may use the queue
+    void SetCapacity(SizeT capacity);
+    /// get capacity
+    SizeT Capacity() const;
+    /// number of elements, only a snapshot while other threads are working
+    SizeT Size() const;
+    /// return true if empty, only a snapshot while other threads are working
+    bool IsEmpty() const;
+
+    /// add an element, returns false if the queue is full
+    bool TryPush(const TYPE& elm);
+    /// add up to num elements, returns the number added
+    SizeT PushBatch(const TYPE* elms, SizeT num);
+    /// remove the oldest element, returns false if the queue is empty
+    bool TryPop(TYPE& outElm);
+    /// remove up to maxNum elements, returns the number removed
+    SizeT PopBatch(TYPE* outElms, SizeT maxNum);
+
+private:
+    /// not copyable
+    MpmcQueue(const MpmcQueue<TYPE>&);
+    /// not assignable
+    void operator=(const MpmcQueue<TYPE>&);
+    /// claim the run of up to num ready slots from an index, seqOffset is 0 for pushes and 1 for pops
+    SizeT Claim(volatile LONG* index, LONG seqOffset, SizeT num, LONG& outFirst);
+
+    struct Cell
+    {
+        volatile LONG sequence;
+        TYPE data;
+    };
+
+    char leadingPad[PH_CACHE_LINE_SIZE];
+    volatile LONG pushIndex;
+    char pushPad[PH_CACHE_LINE_SIZE];
+    volatile LONG popIndex;
+    char popPad[PH_CACHE_LINE_SIZE];
+    Cell* cells;
+    SizeT capacity;
+    LONG mask;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+MpmcQueue<TYPE>::MpmcQueue() :
+    pushIndex(0),
+    popIndex(0),
+    cells(0),
+    capacity(0),
+    mask(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+MpmcQueue<TYPE>::MpmcQueue(SizeT c) :
+    pushIndex(0),
+    popIndex(0),
+    cells(0),
+    capacity(0),
+    mask(0)
+{
+    this->SetCapacity(c);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+MpmcQueue<TYPE>::~MpmcQueue()
+{
+    if (0 != this->cells)
+    {
+        ph_delete_array(this->cells);
+        this->cells = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+MpmcQueue<TYPE>::SetCapacity(SizeT c)
+{
+    ph_assert(c > 0);
+    if (0 != this->cells)
+    {
+        ph_delete_array(this->cells);
+    }
+    SizeT roundedCapacity = 1;
+    while (roundedCapacity < c)
+    {
+        roundedCapacity <<= 1;
+    }
+    this->capacity = roundedCapacity;
+    this->mask = roundedCapacity - 1;
+    this->cells = ph_new_array(Cell, roundedCapacity);
+    IndexT i;
+    for (i = 0; i < roundedCapacity; i++)
+    {
+        this->cells[i].sequence = i;
+    }
+    this->pushIndex = 0;
+    this->popIndex = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+MpmcQueue<TYPE>::Capacity() const
+{
+    return this->capacity;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+MpmcQueue<TYPE>::Size() const
+{
+    SizeT size = (SizeT) (this->pushIndex - this->popIndex);
+    return size < 0 ? 0 : size;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+MpmcQueue<TYPE>::IsEmpty() const
+{
+    return 0 == this->Size();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+MpmcQueue<TYPE>::TryPush(const TYPE& elm)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->cells);
+    #endif
+    LONG pos = this->pushIndex;
+    Cell* cell;
+    for (;;)
+    {
+        cell = &this->cells[pos & this->mask];
+        LONG diff = cell->sequence - pos;
+        if (0 == diff)
+        {
+            LONG prevPos = InterlockedCompareExchange(&this->pushIndex, pos + 1, pos);
+            if (prevPos == pos)
+            {
+                break;
+            }
+            pos = prevPos;
+        }
+        else if (diff < 0)
+        {
+            // the slot still holds the element from the previous round
+            return false;
+        }
+        else
+        {
+            pos = this->pushIndex;
+        }
+    }
+    cell->data = elm;
+    _ReadWriteBarrier();
+    cell->sequence = pos + 1;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+MpmcQueue<TYPE>::TryPop(TYPE& outElm)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->cells);
+    #endif
+    LONG pos = this->popIndex;
+    Cell* cell;
+    for (;;)
+    {
+        cell = &this->cells[pos & this->mask];
+        LONG diff = cell->sequence - (pos + 1);
+        if (0 == diff)
+        {
+            LONG prevPos = InterlockedCompareExchange(&this->popIndex, pos + 1, pos);
+            if (prevPos == pos)
+            {
+                break;
+            }
+            pos = prevPos;
+        }
+        else if (diff < 0)
+        {
+            // the slot hasn't been written yet
+            return false;
+        }
+        else
+        {
+            pos = this->popIndex;
+        }
+    }
+    outElm = cell->data;
+    _ReadWriteBarrier();
+    cell->sequence = pos + this->mask + 1;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Claims positions [first, first + numClaimed) of index. A slot is ready
+    for position pos when its sequence is pos + seqOffset; only the thread
+    which claims pos may change it after that, so slots seen ready stay
+    ready until the compare-and-swap either claims them or fails because
+    another thread claimed pos first.
+*/
+template<class TYPE> SizeT
+MpmcQueue<TYPE>::Claim(volatile LONG* index, LONG seqOffset, SizeT num, LONG& outFirst)
+{
+    LONG pos = *index;
+    for (;;)
+    {
+        LONG diff = this->cells[pos & this->mask].sequence - (pos + seqOffset);
+        if (diff < 0)
+        {
+            // full for pushes, empty for pops
+            return 0;
+        }
+        if (diff > 0)
+        {
+            // another thread claimed pos meanwhile
+            pos = *index;
+            continue;
+        }
+        SizeT numReady = 1;
+        while (numReady < num && this->cells[(pos + numReady) & this->mask].sequence == pos + numReady + seqOffset)
+        {
+            numReady++;
+        }
+        LONG prevPos = InterlockedCompareExchange(index, pos + numReady, pos);
+        if (prevPos == pos)
+        {
+            outFirst = pos;
+            return numReady;
+        }
+        pos = prevPos;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+MpmcQueue<TYPE>::PushBatch(const TYPE* elms, SizeT num)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->cells);
+    #endif
+    if (num <= 0)
+    {
+        return 0;
+    }
+    LONG first;
+    SizeT numClaimed = this->Claim(&this->pushIndex, 0, num, first);
+    IndexT i;
+    for (i = 0; i < numClaimed; i++)
+    {
+        LONG pos = first + i;
+        Cell* cell = &this->cells[pos & this->mask];
+        cell->data = elms[i];
+        _ReadWriteBarrier();
+        cell->sequence = pos + 1;
+    }
+    return numClaimed;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+MpmcQueue<TYPE>::PopBatch(TYPE* outElms, SizeT maxNum)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->cells);
+    #endif
+    if (maxNum <= 0)
+    {
+        return 0;
+    }
+    LONG first;
+    SizeT numClaimed = this->Claim(&this->popIndex, 1, maxNum, first);
+    IndexT i;
+    for (i = 0; i < numClaimed; i++)
+    {
+        LONG pos = first + i;
+        Cell* cell = &this->cells[pos & this->mask];
+        outElms[i] = cell->data;
+        _ReadWriteBarrier();
+        cell->sequence = pos + this->mask + 1;
+    }
+    return numClaimed;
+}
+
+} // namespace Philo
+//------------------------------------------------------------------------------
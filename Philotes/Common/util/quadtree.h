@@ -4,14 +4,39 @@
     @class QuadTree
     @ingroup Util
 
-    A simple quad tree. QuadTree elements are template nodes and
-    are inserted and removed from a quadtree by bounding box.
+    A loose quad tree over the x/z plane. Elements of TYPE are inserted
+    with a bounding box and can be moved and removed through the handle
+    Insert() returns.
+
+    The nodes are not objects but indices: level L has (2^L)^2 nodes,
+    stored after the nodes of the levels above it and ordered by the
+    Morton code of their column and row (the bits of both interleaved),
+    so the 4 children of a node are adjacent and GetNodeIndex() is a
+    direct computation. Per node the tree only keeps the head of the
+    list of its elements and the number of elements in the node and
+    below, which lets queries skip empty subtrees.
+
+    The tree is loose: every node's bounds are its cell enlarged to twice
+    its size in x and z. An element goes to the deepest level whose cells
+    are at least as large as its box, into the cell which contains the
+    center of the box, where it lies inside the node's loose bounds.
+    Finding the node therefore needs nothing but the box, and moving an
+    element which stays in its node costs no list operation. Elements
+    whose center lies outside the tree, or whose height exceeds the
+    tree's, stay in the root node and are tested by every query. The
+    bounding boxes of the elements must be finite.
+
+    Queries append the matching elements in Morton order. The batched
+    versions answer up to 32 queries with a single traversal, each node
+    is tested only against the queries which still partially overlap it,
+    and nodes completely inside a query are taken without testing their
+    elements.
 
     (C) 2007 RadonLabs GmbH
 */
-#include "util/fixedarray.h"
-#include "math/bbox.h"
-#include "math/float4.h"
+#include "util/array.h"
+#include "math/axisAlignedBox.h"
+#include "math/planeBoundedVolume.h"
 
 namespace Philo
 {
@@ -19,76 +44,124 @@ namespace Philo
 template<class TYPE> class QuadTree
 {
 public:
-    class Node;    
+    /// maximum depth, every level has 4 times the nodes of the one above
+    static const uchar MaxDepth = 12;
+    /// number of queries a batched query answers per traversal
+    static const SizeT MaxBatchSize = 32;
 
     /// constructor
     QuadTree();
     /// destructor
     ~QuadTree();
-    /// initialize quad tree
-    void Setup(const Math::bbox& box, uchar depth);
+    /// initialize quad tree, removes all elements
+    void Setup(const AxisAlignedBox& box, uchar depth);
+    /// remove all elements
+    void Clear();
     /// get the top level bounding box
-    const Math::bbox& GetBoundingBox() const;
+    const AxisAlignedBox& GetBoundingBox() const;
     /// get the tree depth
     uchar GetDepth() const;
-    /// compute number of nodes in a level, including its children
+    /// compute number of nodes in the levels above a level, which is the index of the level's first node
     SizeT GetNumNodes(uchar level) const;
-    /// compute linear chunk index from level, col and row
+    /// compute linear node index from level, col and row
     IndexT GetNodeIndex(uchar level, ushort col, ushort row) const;
     /// get overall number of nodes in the tree
     SizeT GetNumNodesInTree() const;
-    /// get pointer to node by index
-    const Node& GetNodeByIndex(IndexT i) const;
-    /// read/write access to node
-    Node& NodeByIndex(IndexT i);
-    /// recursively find the smallest child node which contains the bounding box
-    Node* FindContainmentNode(const Math::bbox& box);
-
-    /// node in quad tree
-    class Node
+    /// compute level, col and row of a node
+    void GetNodeAddress(IndexT nodeIndex, uchar& level, ushort& col, ushort& row) const;
+    /// compute the cell of a node
+    AxisAlignedBox GetNodeBoundingBox(IndexT nodeIndex) const;
+    /// compute the loose bounds of a node, which contain all its elements
+    AxisAlignedBox GetNodeLooseBoundingBox(IndexT nodeIndex) const;
+    /// find the node an element with the bounding box belongs to
+    IndexT FindContainmentNode(const AxisAlignedBox& box) const;
+
+    /// insert an element, returns its handle
+    IndexT Insert(const TYPE& element, const AxisAlignedBox& box);
+    /// remove an element
+    void Remove(IndexT handle);
+    /// change the bounding box of an element
+    void Move(IndexT handle, const AxisAlignedBox& box);
+    /// get an element
+    const TYPE& GetElement(IndexT handle) const;
+    /// get the node an element is in
+    IndexT GetElementNode(IndexT handle) const;
+    /// get number of elements in the tree
+    SizeT GetNumElements() const;
+    /// get number of elements in a node and the nodes below it
+    SizeT GetNumElementsInSubtree(IndexT nodeIndex) const;
+
+    /// append the elements whose bounding box intersects a box
+    void FindIntersecting(const AxisAlignedBox& box, Array<TYPE>& result) const;
+    /// append the elements whose bounding box intersects a convex volume, e.g. a frustum
+    void FindIntersecting(const PlaneBoundedVolume& volume, Array<TYPE>& result) const;
+    /// batched box queries, results[i] gets the elements intersecting boxes[i]
+    void FindIntersecting(const AxisAlignedBox* boxes, SizeT numBoxes, Array<TYPE>* results) const;
+    /// batched convex volume queries, results[i] gets the elements intersecting volumes[i]
+    void FindIntersecting(const PlaneBoundedVolume* volumes, SizeT numVolumes, Array<TYPE>* results) const;
+
+private:
+    /// bounding box and list links of an element
+    struct ElementInfo
     {
-    public:
-        /// constructor
-        Node();
-        /// destructor
-        ~Node();
-        /// recursively initialize the node
-        void Setup(QuadTree<TYPE>* tree, uchar _level, ushort _col, ushort _row);
-        /// get the node's level
-        char Level() const;
-        /// get the node's column
-        ushort Column() const;
-        /// get the node's row
-        ushort Row() const;
-        /// compute the node's bounding box
-        const Math::bbox& GetBoundingBox() const;
-        /// recursively find the smallest child node which contains the bounding box
-        Node* FindContainmentNode(const Math::bbox& box);
-        /// set data element associated with node
-        void SetElement(const TYPE& elm);
-        /// get data element
-        const TYPE& GetElement() const;
-        /// get child at index
-        Node* GetChildAt(IndexT i);
-
-    private:
-        friend class QuadTree;
-
-        Node* children[4];
-        char level;
-        ushort col;
-        ushort row;
-        Math::bbox box;
-        TYPE element;
+        Vector3 minimum;
+        Vector3 maximum;
+        IndexT node;        // InvalidIndex for free handles
+        IndexT prev;
+        IndexT next;
     };
 
-private:
-    friend class Node;
+    /// result of testing a box against a query
+    enum Overlap
+    {
+        Outside,
+        Partial,
+        Inside
+    };
+
+    /// box query of Collect()
+    struct BoxTest
+    {
+        Vector3 minimum;
+        Vector3 maximum;
+
+        void Setup(const AxisAlignedBox& box);
+        Overlap Classify(const Vector3& center, const Vector3& halfSize) const;
+    };
+
+    /// convex volume query of Collect()
+    struct VolumeTest
+    {
+        const Plane* planes;
+        SizeT numPlanes;
+        Plane::Side outside;
+
+        void Setup(const PlaneBoundedVolume& volume);
+        Overlap Classify(const Vector3& center, const Vector3& halfSize) const;
+    };
+
+    /// answer up to MaxBatchSize queries with one traversal
+    template<class TEST> void Collect(const TEST* tests, SizeT numTests, Array<TYPE>* results) const;
+    /// append an element to the list of a node
+    void Link(IndexT handle, IndexT nodeIndex);
+    /// remove an element from the list of its node
+    void Unlink(IndexT handle);
+    /// compute the cell size of a level
+    Vector3 GetCellSize(uchar level) const;
+    /// interleave the bits of col and row
+    static uint Morton(ushort col, ushort row);
+    /// split a Morton code into col and row
+    static void InverseMorton(uint code, ushort& col, ushort& row);
 
     uchar treeDepth;
-    Math::bbox boundingBox;                  // global bounding box
-    Math::vector baseNodeSize;               // base chunk bounding box
-    FixedArray<Node> nodeArray;
+    AxisAlignedBox boundingBox;                 // global bounding box
+    Vector3 baseNodeSize;                       // cell size of the deepest level
+    Array<IndexT> nodeFirstElements;            // per node, InvalidIndex if empty
+    Array<SizeT> nodeNumElements;               // per node, including the nodes below
+    Array<TYPE> elements;
+    Array<ElementInfo> elementInfos;
+    Array<IndexT> freeHandles;
+    SizeT numElements;
 };
 
 //------------------------------------------------------------------------------
@@ -98,7 +171,8 @@ private:
 template<class TYPE>
 QuadTree<TYPE>::QuadTree() :
     treeDepth(0),
-    baseNodeSize(0.0f, 0.0f, 0.0f)
+    baseNodeSize(0.0f, 0.0f, 0.0f),
+    numElements(0)
 {
     // empty
 }
@@ -113,40 +187,45 @@ QuadTree<TYPE>::~QuadTree()
     // empty
 }
 
-
-
 //------------------------------------------------------------------------------
 /**
     Initialize the quad tree.
 */
 template<class TYPE> void
-QuadTree<TYPE>::Setup(const Math::bbox& box, uchar depth)
+QuadTree<TYPE>::Setup(const AxisAlignedBox& box, uchar depth)
 {
-    #if PH_BOUNDSCHECKS    
-    ph_assert(depth > 0);
+    #if PH_BOUNDSCHECKS
+    ph_assert((depth > 0) && (depth <= MaxDepth));
+    ph_assert(box.isFinite());
     #endif
 
     this->treeDepth = depth;
     this->boundingBox = box;
 
     int baseDimension = 1 << (this->treeDepth - 1);
-    this->baseNodeSize.set(this->boundingBox.size().x() / baseDimension,
-                           this->boundingBox.size().y(),                                                                          
-                           this->boundingBox.size().z() / baseDimension);
+    const Vector3 size = this->boundingBox.getSize();
+    this->baseNodeSize = Vector3(size.x / baseDimension, size.y, size.z / baseDimension);
 
     SizeT numNodes = this->GetNumNodes(this->treeDepth);
-    this->nodeArray.SetSize(numNodes);
-    this->nodeArray[0].Setup(this, 0, 0, 0);
+    this->nodeFirstElements.Clear();
+    this->nodeFirstElements.Fill(0, numNodes, InvalidIndex);
+    this->nodeNumElements.Clear();
+    this->nodeNumElements.Fill(0, numNodes, 0);
+
+    this->elements.Clear();
+    this->elementInfos.Clear();
+    this->freeHandles.Clear();
+    this->numElements = 0;
+}
 
-    // make sure all nodes have been initialized
-    #if PH_BOUNDSCHECKS
-    int i;
-    int num = this->nodeArray.Size();
-    for (i = 0; i < num; i++)
-    {
-        ph_assert(this->nodeArray[i].Level() >= 0);
-    }
-    #endif
+//------------------------------------------------------------------------------
+/**
+    Remove all elements, the tree keeps its bounding box and depth.
+*/
+template<class TYPE> void
+QuadTree<TYPE>::Clear()
+{
+    this->Setup(this->boundingBox, this->treeDepth);
 }
 
 //------------------------------------------------------------------------------
@@ -163,7 +242,7 @@ QuadTree<TYPE>::GetDepth() const
 /**
     Returns top level bounding box of quad tree.
 */
-template<class TYPE> const Math::bbox&
+template<class TYPE> const AxisAlignedBox&
 QuadTree<TYPE>::GetBoundingBox() const
 {
     return this->boundingBox;
@@ -171,7 +250,7 @@ QuadTree<TYPE>::GetBoundingBox() const
 
 //------------------------------------------------------------------------------
 /**
-    Computes number of nodes in a level, including its child nodes.
+    Computes the number of nodes in the levels above a level, 1 + 4 + 16 + ...
 */
 template<class TYPE> SizeT
 QuadTree<TYPE>::GetNumNodes(uchar level) const
@@ -186,227 +265,616 @@ QuadTree<TYPE>::GetNumNodes(uchar level) const
 template<class TYPE> SizeT
 QuadTree<TYPE>::GetNumNodesInTree() const
 {
-    return this->nodeArray.Size();
+    return this->nodeNumElements.Size();
 }
 
 //------------------------------------------------------------------------------
 /**
-    Computes a linear chunk index for a chunk address consisting of 
-    level, col and row.
+    Computes a linear node index for a node address consisting of
+    level, col and row. The nodes of a level are in Morton order, the
+    children of node (level, col, row) are the 4 nodes starting at
+    GetNodeIndex(level + 1, 2 * col, 2 * row).
 */
 template<class TYPE> IndexT
 QuadTree<TYPE>::GetNodeIndex(uchar level, ushort col, ushort row) const
 {
     #if PH_BOUNDSCHECKS
-    ph_assert((col >= 0) && (col < (1 << level)));
-    ph_assert((row >= 0) && (row < (1 << level)));
+    ph_assert(col < (1 << level));
+    ph_assert(row < (1 << level));
     #endif
-    return this->GetNumNodes(level) + (row << level) + col;
+    return this->GetNumNodes(level) + Morton(col, row);
 }
 
 //------------------------------------------------------------------------------
 /**
-    Find the biggest quad tree which completely contains the provided
-    bounding box.
+    Computes the address of a node from its linear index.
 */
-template<class TYPE> typename QuadTree<TYPE>::Node*
-QuadTree<TYPE>::FindContainmentNode(const Math::bbox& checkBox)
+template<class TYPE> void
+QuadTree<TYPE>::GetNodeAddress(IndexT nodeIndex, uchar& level, ushort& col, ushort& row) const
 {
-    return this->nodeArray[0].FindContainmentNode(checkBox);
+    #if PH_BOUNDSCHECKS
+    ph_assert((nodeIndex >= 0) && (nodeIndex < this->GetNumNodesInTree()));
+    #endif
+    level = 0;
+    while (nodeIndex >= (IndexT)this->GetNumNodes(level + 1))
+    {
+        level++;
+    }
+    InverseMorton(nodeIndex - this->GetNumNodes(level), col, row);
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class TYPE>
-QuadTree<TYPE>::Node::Node() :
-    level(-1),
-    col(0),
-    row(0)
+template<class TYPE> Vector3
+QuadTree<TYPE>::GetCellSize(uchar level) const
+{
+    float levelFactor = float(1 << (this->treeDepth - 1 - level));
+    return Vector3(this->baseNodeSize.x * levelFactor, this->baseNodeSize.y, this->baseNodeSize.z * levelFactor);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Computes the cell of a node, it spans the full height of the tree.
+*/
+template<class TYPE> AxisAlignedBox
+QuadTree<TYPE>::GetNodeBoundingBox(IndexT nodeIndex) const
 {
-    int i;
-    for (i = 0; i < 4; i++)
+    uchar level;
+    ushort col, row;
+    this->GetNodeAddress(nodeIndex, level, col, row);
+
+    const Vector3 cellSize = this->GetCellSize(level);
+    const Vector3& treeMin = this->boundingBox.getMinimum();
+    Vector3 minimum(treeMin.x + col * cellSize.x, treeMin.y, treeMin.z + row * cellSize.z);
+    return AxisAlignedBox(minimum, minimum + cellSize);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Computes the loose bounds of a node, its cell enlarged by half a
+    cell on each side in x and z. The root's elements may lie anywhere.
+*/
+template<class TYPE> AxisAlignedBox
+QuadTree<TYPE>::GetNodeLooseBoundingBox(IndexT nodeIndex) const
+{
+    if (0 == nodeIndex)
     {
-        this->children[i] = 0;
+        return AxisAlignedBox(AxisAlignedBox::EXTENT_INFINITE);
     }
+    AxisAlignedBox box = this->GetNodeBoundingBox(nodeIndex);
+    Vector3 half = box.getHalfSize();
+    half.y = 0.0f;
+    box.setExtents(box.getMinimum() - half, box.getMaximum() + half);
+    return box;
 }
 
 //------------------------------------------------------------------------------
 /**
+    Finds the node an element with the given bounding box belongs to:
+    the deepest level whose cells are at least as large as the box, and
+    there the cell containing the center of the box.
 */
-template<class TYPE>
-QuadTree<TYPE>::Node::~Node()
+template<class TYPE> IndexT
+QuadTree<TYPE>::FindContainmentNode(const AxisAlignedBox& box) const
 {
-    // empty
+    #if PH_BOUNDSCHECKS
+    ph_assert(box.isFinite());
+    #endif
+
+    const Vector3& treeMin = this->boundingBox.getMinimum();
+    const Vector3& treeMax = this->boundingBox.getMaximum();
+    const Vector3& boxMin = box.getMinimum();
+    const Vector3& boxMax = box.getMaximum();
+    const Vector3 center = box.getCenter();
+    if ((center.x < treeMin.x) || (center.x > treeMax.x) ||
+        (center.z < treeMin.z) || (center.z > treeMax.z) ||
+        (boxMin.y < treeMin.y) || (boxMax.y > treeMax.y))
+    {
+        return 0;
+    }
+
+    const Vector3 size = boxMax - boxMin;
+    uchar level = this->treeDepth - 1;
+    Vector3 cellSize = this->baseNodeSize;
+    while ((level > 0) && ((size.x > cellSize.x) || (size.z > cellSize.z)))
+    {
+        level--;
+        cellSize.x *= 2.0f;
+        cellSize.z *= 2.0f;
+    }
+    if (0 == level)
+    {
+        return 0;
+    }
+
+    const int dimension = 1 << level;
+    int col = int((center.x - treeMin.x) / cellSize.x);
+    int row = int((center.z - treeMin.z) / cellSize.z);
+    col = (col < 0) ? 0 : ((col >= dimension) ? dimension - 1 : col);
+    row = (row < 0) ? 0 : ((row >= dimension) ? dimension - 1 : row);
+    return this->GetNodeIndex(level, ushort(col), ushort(row));
+}
+
+//------------------------------------------------------------------------------
+/**
+    Insert an element, the returned handle stays valid until the
+    element is removed.
+*/
+template<class TYPE> IndexT
+QuadTree<TYPE>::Insert(const TYPE& element, const AxisAlignedBox& box)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(this->treeDepth > 0);
+    #endif
+
+    IndexT handle;
+    if (!this->freeHandles.IsEmpty())
+    {
+        handle = this->freeHandles.Back();
+        this->freeHandles.PopBack();
+        this->elements[handle] = element;
+    }
+    else
+    {
+        handle = this->elements.Size();
+        this->elements.Append(element);
+        this->elementInfos.Append(ElementInfo());
+    }
+
+    ElementInfo& info = this->elementInfos[handle];
+    info.minimum = box.getMinimum();
+    info.maximum = box.getMaximum();
+    this->Link(handle, this->FindContainmentNode(box));
+    this->numElements++;
+    return handle;
 }
 
 //------------------------------------------------------------------------------
 /**
-    Recursively initialize a quad tree node.
 */
 template<class TYPE> void
-QuadTree<TYPE>::Node::Setup(QuadTree* tree, uchar _level, ushort _col, ushort _row)
+QuadTree<TYPE>::Remove(IndexT handle)
 {
     #if PH_BOUNDSCHECKS
-    ph_assert(tree);
-    ph_assert(this->level == -1);
-    ph_assert(_col < (1 << _level));
-    ph_assert(_row < (1 << _level));
+    ph_assert(InvalidIndex != this->elementInfos[handle].node);
     #endif
+    this->Unlink(handle);
+    this->elements[handle] = TYPE();
+    this->freeHandles.Append(handle);
+    this->numElements--;
+}
 
-    // store address
-    this->level = _level;
-    this->col   = _col;
-    this->row   = _row;
-
-    // update my bounding box
-    float levelFactor = float(1 << (tree->treeDepth - 1 - this->level));
-    static Math::vector center;
-    static Math::vector extent;
-    const Math::vector& baseSize = tree->baseNodeSize;
-    const Math::bbox& treeBox = tree->boundingBox;
-    Math::vector treeSize = treeBox.size();
-    Math::vector treeCenter = treeBox.center();
-
-    center.set(treeCenter.x() + (((this->col + 0.5f) * levelFactor * baseSize.x()) - (treeSize.x() * 0.5f)),
-               treeCenter.y(),
-               treeCenter.z() + (((this->row + 0.5f) * levelFactor * baseSize.z()) - (treeSize.z() * 0.5f)));
-
-    extent.set(levelFactor * baseSize.x() * 0.5f,
-               treeBox.extents().y(),
-               levelFactor * baseSize.z() * 0.5f );
-
-    this->box.set(center, extent);
-
-    // recurse into children
-    uchar childLevel = this->level + 1;
-    if (childLevel < tree->treeDepth)
+//------------------------------------------------------------------------------
+/**
+    Change the bounding box of an element, it only changes lists if it
+    belongs to another node now.
+*/
+template<class TYPE> void
+QuadTree<TYPE>::Move(IndexT handle, const AxisAlignedBox& box)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(InvalidIndex != this->elementInfos[handle].node);
+    #endif
+    ElementInfo& info = this->elementInfos[handle];
+    info.minimum = box.getMinimum();
+    info.maximum = box.getMaximum();
+
+    IndexT nodeIndex = this->FindContainmentNode(box);
+    if (nodeIndex != info.node)
     {
-        ushort i;
-        for (i = 0; i < 4; i++)
-        {
-            ushort childCol = 2 * this->col + (i & 1);
-            ushort childRow = 2 * this->row + ((i & 2) >> 1);
-            IndexT childIndex = tree->GetNodeIndex(childLevel, childCol, childRow);
-            this->children[i] = &(tree->nodeArray[childIndex]);
-            this->children[i]->Setup(tree, childLevel, childCol, childRow);
-        }
+        this->Unlink(handle);
+        this->Link(handle, nodeIndex);
     }
 }
 
 //------------------------------------------------------------------------------
 /**
-    This finds the smallest child node which completely contains the
-    given bounding box. Calls itself recursively.
 */
-template<class TYPE> typename QuadTree<TYPE>::Node*
-QuadTree<TYPE>::Node::FindContainmentNode(const Math::bbox& checkBox)
+template<class TYPE> const TYPE&
+QuadTree<TYPE>::GetElement(IndexT handle) const
+{
+    return this->elements[handle];
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> IndexT
+QuadTree<TYPE>::GetElementNode(IndexT handle) const
+{
+    return this->elementInfos[handle].node;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+QuadTree<TYPE>::GetNumElements() const
+{
+    return this->numElements;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+QuadTree<TYPE>::GetNumElementsInSubtree(IndexT nodeIndex) const
 {
-    if (this->box.contains(checkBox))
+    return this->nodeNumElements[nodeIndex];
+}
+
+//------------------------------------------------------------------------------
+/**
+    Push an element to the front of the list of a node and count it in
+    the node and its ancestors.
+*/
+template<class TYPE> void
+QuadTree<TYPE>::Link(IndexT handle, IndexT nodeIndex)
+{
+    ElementInfo& info = this->elementInfos[handle];
+    info.node = nodeIndex;
+    info.prev = InvalidIndex;
+    info.next = this->nodeFirstElements[nodeIndex];
+    if (InvalidIndex != info.next)
     {
-        // recurse into children
-        if (this->children[0] != 0)
+        this->elementInfos[info.next].prev = handle;
+    }
+    this->nodeFirstElements[nodeIndex] = handle;
+
+    uchar level;
+    ushort col, row;
+    this->GetNodeAddress(nodeIndex, level, col, row);
+    uint code = Morton(col, row);
+    for (;;)
+    {
+        this->nodeNumElements[this->GetNumNodes(level) + code]++;
+        if (0 == level)
         {
-            int i;
-            for (i = 0; i < 4; i++)
-            {
-                Node* containNode = this->children[i]->FindContainmentNode(checkBox);
-                if (containNode)
-                {
-                    return containNode;
-                }
-            }
+            break;
         }
+        level--;
+        code >>= 2;
+    }
+}
 
-        // not contained in children, but still contained in this
-        return this;
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+QuadTree<TYPE>::Unlink(IndexT handle)
+{
+    ElementInfo& info = this->elementInfos[handle];
+    if (InvalidIndex != info.prev)
+    {
+        this->elementInfos[info.prev].next = info.next;
     }
     else
     {
-        // not contained in this, break recursion
-        return 0;
+        this->nodeFirstElements[info.node] = info.next;
     }
+    if (InvalidIndex != info.next)
+    {
+        this->elementInfos[info.next].prev = info.prev;
+    }
+
+    uchar level;
+    ushort col, row;
+    this->GetNodeAddress(info.node, level, col, row);
+    uint code = Morton(col, row);
+    for (;;)
+    {
+        this->nodeNumElements[this->GetNumNodes(level) + code]--;
+        if (0 == level)
+        {
+            break;
+        }
+        level--;
+        code >>= 2;
+    }
+
+    info.node = InvalidIndex;
+    info.prev = InvalidIndex;
+    info.next = InvalidIndex;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class TYPE> const typename QuadTree<TYPE>::Node&
-QuadTree<TYPE>::GetNodeByIndex(IndexT index) const
+template<class TYPE> void
+QuadTree<TYPE>::FindIntersecting(const AxisAlignedBox& box, Array<TYPE>& result) const
 {
-    return this->nodeArray[index];
+    if (box.isNull())
+    {
+        return;
+    }
+    BoxTest test;
+    test.Setup(box.isInfinite() ? AxisAlignedBox(Vector3(-Math::POS_INFINITY), Vector3(Math::POS_INFINITY)) : box);
+    this->Collect(&test, 1, &result);
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class TYPE> typename QuadTree<TYPE>::Node&
-QuadTree<TYPE>::NodeByIndex(IndexT index)
+template<class TYPE> void
+QuadTree<TYPE>::FindIntersecting(const PlaneBoundedVolume& volume, Array<TYPE>& result) const
 {
-    return this->nodeArray[index];
+    VolumeTest test;
+    test.Setup(volume);
+    this->Collect(&test, 1, &result);
 }
 
 //------------------------------------------------------------------------------
 /**
+    Batched box queries, the boxes must not be null.
 */
-template<class TYPE> const Math::bbox&
-QuadTree<TYPE>::Node::GetBoundingBox() const
+template<class TYPE> void
+QuadTree<TYPE>::FindIntersecting(const AxisAlignedBox* boxes, SizeT numBoxes, Array<TYPE>* results) const
 {
-    return this->box;
+    BoxTest tests[MaxBatchSize];
+    IndexT first;
+    for (first = 0; first < numBoxes; first += MaxBatchSize)
+    {
+        SizeT num = (numBoxes - first < MaxBatchSize) ? numBoxes - first : MaxBatchSize;
+        IndexT i;
+        for (i = 0; i < num; i++)
+        {
+            #if PH_BOUNDSCHECKS
+            ph_assert(!boxes[first + i].isNull());
+            #endif
+            tests[i].Setup(boxes[first + i]);
+        }
+        this->Collect(tests, num, results + first);
+    }
 }
 
 //------------------------------------------------------------------------------
 /**
+    Batched convex volume queries.
 */
-template<class TYPE> char
-QuadTree<TYPE>::Node::Level() const
+template<class TYPE> void
+QuadTree<TYPE>::FindIntersecting(const PlaneBoundedVolume* volumes, SizeT numVolumes, Array<TYPE>* results) const
 {
-    return this->level;
+    VolumeTest tests[MaxBatchSize];
+    IndexT first;
+    for (first = 0; first < numVolumes; first += MaxBatchSize)
+    {
+        SizeT num = (numVolumes - first < MaxBatchSize) ? numVolumes - first : MaxBatchSize;
+        IndexT i;
+        for (i = 0; i < num; i++)
+        {
+            tests[i].Setup(volumes[first + i]);
+        }
+        this->Collect(tests, num, results + first);
+    }
 }
 
 //------------------------------------------------------------------------------
 /**
+    Walks the tree once for up to MaxBatchSize queries. Every node on the
+    stack carries two masks, the queries which partially overlap it and
+    still have to be tested, and the queries which contain it and take
+    its elements untested. A node is skipped when both are empty or no
+    element lies in or below it. Children are pushed in reverse so that
+    the results come out in Morton order.
 */
-template<class TYPE> ushort
-QuadTree<TYPE>::Node::Column() const
+template<class TYPE> template<class TEST> void
+QuadTree<TYPE>::Collect(const TEST* tests, SizeT numTests, Array<TYPE>* results) const
 {
-    return this->col;
+    #if PH_BOUNDSCHECKS
+    ph_assert(numTests <= MaxBatchSize);
+    #endif
+    if ((0 == numTests) || (0 == this->treeDepth) || (0 == this->nodeNumElements[0]))
+    {
+        return;
+    }
+
+    struct Entry
+    {
+        uchar level;
+        uint code;
+        uint partial;
+        uint inside;
+    };
+    // depth first, at most 3 siblings per level wait on the stack
+    Entry stack[3 * MaxDepth + 1];
+    SizeT stackSize = 0;
+
+    Entry root;
+    root.level = 0;
+    root.code = 0;
+    root.partial = (numTests == 32) ? 0xffffffff : ((1u << numTests) - 1);
+    root.inside = 0;
+    stack[stackSize++] = root;
+
+    const Vector3& treeMin = this->boundingBox.getMinimum();
+    const Vector3 treeCenter = this->boundingBox.getCenter();
+    const Vector3 treeHalfSize = this->boundingBox.getHalfSize();
+
+    while (stackSize > 0)
+    {
+        Entry entry = stack[--stackSize];
+        uint partial = entry.partial;
+        uint inside = entry.inside;
+
+        // the root's elements may lie anywhere, all others in the loose bounds
+        if (entry.level > 0)
+        {
+            ushort col, row;
+            InverseMorton(entry.code, col, row);
+            const Vector3 cellSize = this->GetCellSize(entry.level);
+            const Vector3 center(treeMin.x + (col + 0.5f) * cellSize.x, treeCenter.y, treeMin.z + (row + 0.5f) * cellSize.z);
+            const Vector3 looseHalfSize(cellSize.x, treeHalfSize.y, cellSize.z);
+
+            IndexT q;
+            for (q = 0; q < numTests; q++)
+            {
+                uint bit = 1u << q;
+                if (0 == (partial & bit))
+                {
+                    continue;
+                }
+                Overlap overlap = tests[q].Classify(center, looseHalfSize);
+                if (Outside == overlap)
+                {
+                    partial &= ~bit;
+                }
+                else if (Inside == overlap)
+                {
+                    partial &= ~bit;
+                    inside |= bit;
+                }
+            }
+            if (0 == (partial | inside))
+            {
+                continue;
+            }
+        }
+
+        const IndexT nodeIndex = this->GetNumNodes(entry.level) + entry.code;
+        IndexT handle;
+        for (handle = this->nodeFirstElements[nodeIndex]; InvalidIndex != handle; handle = this->elementInfos[handle].next)
+        {
+            const ElementInfo& info = this->elementInfos[handle];
+            const Vector3 center = (info.minimum + info.maximum) * 0.5f;
+            const Vector3 halfSize = (info.maximum - info.minimum) * 0.5f;
+
+            IndexT q;
+            for (q = 0; q < numTests; q++)
+            {
+                uint bit = 1u << q;
+                if ((inside & bit) || ((partial & bit) && (Outside != tests[q].Classify(center, halfSize))))
+                {
+                    results[q].Append(this->elements[handle]);
+                }
+            }
+        }
+
+        uchar childLevel = entry.level + 1;
+        if (childLevel < this->treeDepth)
+        {
+            IndexT firstChild = this->GetNumNodes(childLevel) + (entry.code << 2);
+            int i;
+            for (i = 3; i >= 0; i--)
+            {
+                if (this->nodeNumElements[firstChild + i] > 0)
+                {
+                    Entry child;
+                    child.level = childLevel;
+                    child.code = (entry.code << 2) + i;
+                    child.partial = partial;
+                    child.inside = inside;
+                    stack[stackSize++] = child;
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+QuadTree<TYPE>::BoxTest::Setup(const AxisAlignedBox& box)
+{
+    this->minimum = box.getMinimum();
+    this->maximum = box.getMaximum();
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class TYPE> ushort
-QuadTree<TYPE>::Node::Row() const
+template<class TYPE> typename QuadTree<TYPE>::Overlap
+QuadTree<TYPE>::BoxTest::Classify(const Vector3& center, const Vector3& halfSize) const
 {
-    return this->row;
+    const Vector3 boxMin = center - halfSize;
+    const Vector3 boxMax = center + halfSize;
+    if ((boxMax.x < this->minimum.x) || (boxMax.y < this->minimum.y) || (boxMax.z < this->minimum.z) ||
+        (boxMin.x > this->maximum.x) || (boxMin.y > this->maximum.y) || (boxMin.z > this->maximum.z))
+    {
+        return Outside;
+    }
+    if ((boxMin.x >= this->minimum.x) && (boxMin.y >= this->minimum.y) && (boxMin.z >= this->minimum.z) &&
+        (boxMax.x <= this->maximum.x) && (boxMax.y <= this->maximum.y) && (boxMax.z <= this->maximum.z))
+    {
+        return Inside;
+    }
+    return Partial;
 }
 
 //------------------------------------------------------------------------------
 /**
+    The volume must outlive the query, its planes are not copied.
 */
 template<class TYPE> void
-QuadTree<TYPE>::Node::SetElement(const TYPE& elm)
+QuadTree<TYPE>::VolumeTest::Setup(const PlaneBoundedVolume& volume)
 {
-    this->element = elm;
+    this->planes = volume.planes.empty() ? 0 : &volume.planes[0];
+    this->numPlanes = (SizeT)volume.planes.size();
+    this->outside = volume.outside;
 }
 
 //------------------------------------------------------------------------------
 /**
 */
-template<class TYPE> const TYPE&
-QuadTree<TYPE>::Node::GetElement() const
+template<class TYPE> typename QuadTree<TYPE>::Overlap
+QuadTree<TYPE>::VolumeTest::Classify(const Vector3& center, const Vector3& halfSize) const
 {
-    return this->element;
+    Overlap overlap = Inside;
+    IndexT i;
+    for (i = 0; i < this->numPlanes; i++)
+    {
+        Plane::Side side = this->planes[i].getSide(center, halfSize);
+        if (side == this->outside)
+        {
+            return Outside;
+        }
+        if (Plane::BOTH_SIDE == side)
+        {
+            overlap = Partial;
+        }
+    }
+    return overlap;
 }
 
 //------------------------------------------------------------------------------
 /**
+    Interleaves the bits of col (even bits) and row (odd bits).
 */
-template<class TYPE> typename QuadTree<TYPE>::Node*
-QuadTree<TYPE>::Node::GetChildAt(IndexT i)
+template<class TYPE> uint
+QuadTree<TYPE>::Morton(ushort col, ushort row)
+{
+    uint x = col;
+    uint y = row;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    y = (y | (y << 8)) & 0x00ff00ff;
+    y = (y | (y << 4)) & 0x0f0f0f0f;
+    y = (y | (y << 2)) & 0x33333333;
+    y = (y | (y << 1)) & 0x55555555;
+    return x | (y << 1);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+QuadTree<TYPE>::InverseMorton(uint code, ushort& col, ushort& row)
 {
-    return this->children[i];
+    uint x = code & 0x55555555;
+    uint y = (code >> 1) & 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0f0f0f0f;
+    x = (x | (x >> 4)) & 0x00ff00ff;
+    x = (x | (x >> 8)) & 0x0000ffff;
+    y = (y | (y >> 1)) & 0x33333333;
+    y = (y | (y >> 2)) & 0x0f0f0f0f;
+    y = (y | (y >> 4)) & 0x00ff00ff;
+    y = (y | (y >> 8)) & 0x0000ffff;
+    col = ushort(x);
+    row = ushort(y);
 }
 } // namespace Philo
 //------------------------------------------------------------------------------
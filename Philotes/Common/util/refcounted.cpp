@@ -0,0 +1,143 @@
+//------------------------------------------------------------------------------
+//  refcounted.cpp
+//  (C) 2012 PhiloLabs
+//------------------------------------------------------------------------------
+
+#include "util/refcounted.h"
+
+namespace Philo
+{
+
+//------------------------------------------------------------------------------
+/**
+*/
+RefCounted::~RefCounted()
+{
+    ph_assert(0 == this->refCount);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Only called by holders of a strong reference, so the object can't be
+    destroyed meanwhile. Two threads may race to create the block, the
+    loser deletes its own.
+*/
+WeakRefBlock*
+RefCounted::GetWeakRefBlock()
+{
+    WeakRefBlock* block = this->weakRefBlock;
+    if (0 == block)
+    {
+        WeakRefBlock* newBlock = ph_new(WeakRefBlock)(this);
+        block = (WeakRefBlock*) InterlockedCompareExchangePointer((PVOID volatile*) &this->weakRefBlock, newBlock, 0);
+        if (0 == block)
+        {
+            block = newBlock;
+        }
+        else
+        {
+            ph_delete(newBlock);
+        }
+    }
+    return block;
+}
+
+//------------------------------------------------------------------------------
+/**
+    The count is 0 and no WeakRefBlock::Lock() can raise it again, but one
+    may still be looking at the object until the block is detached.
+*/
+void
+RefCounted::Destroy()
+{
+    WeakRefBlock* block = this->weakRefBlock;
+    if (0 != block)
+    {
+        this->weakRefBlock = 0;
+        block->Detach();
+    }
+    ph_delete(this);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+WeakRefBlock::WeakRefBlock(RefCounted* obj) :
+    refCount(1),
+    spinLock(0),
+    object(obj)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+WeakRefBlock::AddRef()
+{
+    InterlockedIncrement(&this->refCount);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+WeakRefBlock::Release()
+{
+    if (0 == InterlockedDecrement(&this->refCount))
+    {
+        ph_delete(this);
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+    The object's count is only raised while it is above 0, the lock keeps
+    Detach() and with it the deletion of the object waiting meanwhile.
+*/
+RefCounted*
+WeakRefBlock::Lock()
+{
+    while (0 != InterlockedExchange(&this->spinLock, 1))
+    {
+        YieldProcessor();
+    }
+    RefCounted* obj = this->object;
+    if (0 != obj)
+    {
+        LONG count = obj->refCount;
+        while (count > 0)
+        {
+            LONG prevCount = InterlockedCompareExchange(&obj->refCount, count + 1, count);
+            if (prevCount == count)
+            {
+                break;
+            }
+            count = prevCount;
+        }
+        if (count <= 0)
+        {
+            obj = 0;
+        }
+    }
+    InterlockedExchange(&this->spinLock, 0);
+    return obj;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+WeakRefBlock::Detach()
+{
+    while (0 != InterlockedExchange(&this->spinLock, 1))
+    {
+        YieldProcessor();
+    }
+    this->object = 0;
+    InterlockedExchange(&this->spinLock, 0);
+    this->Release();
+}
+
+} // namespace Philo
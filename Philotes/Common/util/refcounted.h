@@ -0,0 +1,371 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class RefCounted
+
+    Base class for objects which keep their own reference count. The
+    count starts at 0 and is changed with interlocked operations, so
+    references may be added and released on any thread; the object
+    deletes itself when the last reference is released. Use RefPtr to
+    hold references, it has the same interface as SharedPtr but needs no
+    separate count block.
+
+    Weak references go through a WeakRefBlock which the object only
+    creates when the first WeakRefPtr to it is made. Adding and releasing
+    strong references never touches the block, only the release of the
+    last reference checks whether there is one to detach.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+
+#include <utility>
+#include <functional>
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+class WeakRefBlock;
+
+class RefCounted
+{
+public:
+    /// constructor
+    RefCounted();
+    /// copy constructor, the copy starts without references
+    RefCounted(const RefCounted& rhs);
+    /// assignment operator, keeps the references of both sides
+    void operator=(const RefCounted& rhs);
+
+    /// add a reference
+    void AddRef();
+    /// release a reference, deletes the object with the last one
+    void Release();
+    /// get the current number of references
+    int GetRefCount() const;
+    /// get the weak reference block of the object, created on first use
+    WeakRefBlock* GetWeakRefBlock();
+
+protected:
+    /// destructor, only called by Release()
+    virtual ~RefCounted();
+
+private:
+    friend class WeakRefBlock;
+
+    /// detach the weak reference block and delete the object
+    void Destroy();
+
+    volatile LONG refCount;
+    WeakRefBlock* volatile weakRefBlock;
+};
+
+//------------------------------------------------------------------------------
+/**
+    @class WeakRefBlock
+
+    Shared by the weak references to a RefCounted object, outlives the
+    object until the last weak reference is gone.
+*/
+class WeakRefBlock
+{
+    PH_DECLARE_HEAP_ALLOC(Memory::UtilHeap)
+
+public:
+    /// constructor
+    WeakRefBlock(RefCounted* object);
+
+    /// add a weak reference
+    void AddRef();
+    /// release a weak reference, deletes the block with the last one
+    void Release();
+    /// add a strong reference to the object and return it, 0 if the object is gone
+    RefCounted* Lock();
+    /// return true if the object is gone
+    bool IsExpired() const;
+
+private:
+    friend class RefCounted;
+
+    /// forget the object, called while it is destroyed
+    void Detach();
+
+    volatile LONG refCount;     // weak references, plus one while the object is alive
+    volatile LONG spinLock;     // held while the object is locked or detached
+    RefCounted* object;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+RefCounted::RefCounted() :
+    refCount(0),
+    weakRefBlock(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+RefCounted::RefCounted(const RefCounted&) :
+    refCount(0),
+    weakRefBlock(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+RefCounted::operator=(const RefCounted&)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+RefCounted::AddRef()
+{
+    InterlockedIncrement(&this->refCount);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+RefCounted::Release()
+{
+    ph_assert(this->refCount > 0);
+    if (0 == InterlockedDecrement(&this->refCount))
+    {
+        this->Destroy();
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline int
+RefCounted::GetRefCount() const
+{
+    return this->refCount;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+WeakRefBlock::IsExpired() const
+{
+    return 0 == this->object;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Reference to a RefCounted object with the interface of SharedPtr.
+*/
+template<class T> class RefPtr
+{
+protected:
+	T* pRep;
+public:
+
+	RefPtr() : pRep(0)
+	{
+	}
+
+	template< class Y>
+	explicit RefPtr(Y* rep)
+		: pRep(rep)
+	{
+		if (pRep)
+		{
+			pRep->AddRef();
+		}
+	}
+	RefPtr(const RefPtr& r)
+		: pRep(r.pRep)
+	{
+		if (pRep)
+		{
+			pRep->AddRef();
+		}
+	}
+	RefPtr& operator=(const RefPtr& r) {
+		if (pRep == r.pRep)
+			return *this;
+		RefPtr<T> tmp(r);
+		swap(tmp);
+		return *this;
+	}
+
+	template< class Y>
+	RefPtr(const RefPtr<Y>& r)
+		: pRep(r.getPointer())
+	{
+		if (pRep)
+		{
+			pRep->AddRef();
+		}
+	}
+	template< class Y>
+	RefPtr& operator=(const RefPtr<Y>& r) {
+		if (pRep == r.getPointer())
+			return *this;
+		RefPtr<T> tmp(r);
+		swap(tmp);
+		return *this;
+	}
+	~RefPtr() {
+		if (pRep)
+		{
+			pRep->Release();
+		}
+	}
+
+	inline T& operator*() const { ph_assert(pRep); return *pRep; }
+	inline T* operator->() const { ph_assert(pRep); return pRep; }
+	inline T* get() const { return pRep; }
+
+	/** Binds rep to the RefPtr.
+		@remarks
+			Assumes that the RefPtr is uninitialised!
+	*/
+	void bind(T* rep)
+	{
+		ph_assert(!pRep);
+		pRep = rep;
+		if (pRep)
+		{
+			pRep->AddRef();
+		}
+	}
+
+	inline bool unique() const
+	{
+		ph_assert(pRep);
+		return pRep->GetRefCount() == 1;
+	}
+
+	inline unsigned int useCount() const
+	{
+		ph_assert(pRep);
+		return (unsigned int)pRep->GetRefCount();
+	}
+
+	inline T* getPointer() const { return pRep; }
+
+	inline bool isNull(void) const { return pRep == 0; }
+
+	inline void setNull(void) {
+		if (pRep)
+		{
+			pRep->Release();
+			pRep = 0;
+		}
+	}
+
+	void swap(RefPtr<T> &other)
+	{
+		std::swap(pRep, other.pRep);
+	}
+
+private:
+	template<class Y> friend class WeakRefPtr;
+};
+
+template<class T, class U> inline bool operator==(RefPtr<T> const& a, RefPtr<U> const& b)
+{
+	return a.get() == b.get();
+}
+
+template<class T, class U> inline bool operator!=(RefPtr<T> const& a, RefPtr<U> const& b)
+{
+	return a.get() != b.get();
+}
+
+template<class T, class U> inline bool operator<(RefPtr<T> const& a, RefPtr<U> const& b)
+{
+	return std::less<const void*>()(a.get(), b.get());
+}
+
+//------------------------------------------------------------------------------
+/**
+    Weak reference to a RefCounted object, doesn't keep the object alive.
+    lock() returns a RefPtr to the object, or a null RefPtr once the last
+    strong reference is gone.
+*/
+template<class T> class WeakRefPtr
+{
+protected:
+	WeakRefBlock* pBlock;
+public:
+
+	WeakRefPtr() : pBlock(0)
+	{
+	}
+
+	template< class Y>
+	WeakRefPtr(const RefPtr<Y>& r)
+		: pBlock(0)
+	{
+		T* rep = r.getPointer();
+		if (rep)
+		{
+			pBlock = rep->GetWeakRefBlock();
+			pBlock->AddRef();
+		}
+	}
+	WeakRefPtr(const WeakRefPtr& r)
+		: pBlock(r.pBlock)
+	{
+		if (pBlock)
+		{
+			pBlock->AddRef();
+		}
+	}
+	WeakRefPtr& operator=(const WeakRefPtr& r) {
+		if (pBlock == r.pBlock)
+			return *this;
+		WeakRefPtr<T> tmp(r);
+		std::swap(pBlock, tmp.pBlock);
+		return *this;
+	}
+	~WeakRefPtr() {
+		if (pBlock)
+		{
+			pBlock->Release();
+		}
+	}
+
+	/// strong reference to the object, null if it is gone
+	RefPtr<T> lock() const
+	{
+		RefPtr<T> result;
+		if (pBlock)
+		{
+			// Lock() already added the reference the RefPtr takes over
+			result.pRep = static_cast<T*>(pBlock->Lock());
+		}
+		return result;
+	}
+
+	inline bool expired() const { return !pBlock || pBlock->IsExpired(); }
+
+	inline void setNull(void) {
+		if (pBlock)
+		{
+			pBlock->Release();
+			pBlock = 0;
+		}
+	}
+};
+
+} // namespace Philo
+//------------------------------------------------------------------------------
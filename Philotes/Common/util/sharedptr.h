@@ -2,14 +2,23 @@
 #pragma once
 
 #include <utility>
+#include <functional>
 
 namespace Philo 
 {
+	/** Reference counted pointer to an object which knows nothing about it.
+		@remarks
+			The use count lives in a separate block and is changed with
+			interlocked operations, so copies of the same SharedPtr may be
+			made and released on different threads. Objects which derive from
+			RefCounted should use RefPtr instead (see util/refcounted.h), which
+			keeps the count in the object and needs no extra allocation.
+	*/
 	template<class T> class SharedPtr
 	{
 	protected:
 		T* pRep;
-		unsigned int* pUseCount;
+		volatile LONG* pUseCount;
 	public:
 		
 		SharedPtr() : pRep(0), pUseCount(0)
@@ -19,7 +28,7 @@ namespace Philo
         template< class Y>
 		explicit SharedPtr(Y* rep) 
 			: pRep(rep)
-			, pUseCount(rep ? new unsigned int(1) : 0)
+			, pUseCount(rep ? newUseCount() : 0)
 		{
 		}
 		SharedPtr(const SharedPtr& r)
@@ -32,7 +41,7 @@ namespace Philo
 
 			if(pUseCount)
 			{
-				++(*pUseCount); 
+				InterlockedIncrement(pUseCount);
 			}
 		}
 		SharedPtr& operator=(const SharedPtr& r) {
@@ -55,7 +64,7 @@ namespace Philo
 			// Handle zero pointer gracefully to manage STL containers
 			if(pUseCount)
 			{
-				++(*pUseCount);
+				InterlockedIncrement(pUseCount);
 			}
 		}
 		template< class Y>
@@ -84,7 +93,7 @@ namespace Philo
 		void bind(T* rep) 
 		{
 			ph_assert(!pRep && !pUseCount);
-			pUseCount = new unsigned int(1);
+			pUseCount = newUseCount();
 			pRep = rep;
 		}
 
@@ -97,10 +106,10 @@ namespace Philo
 		inline unsigned int useCount() const 
 		{ 
 			ph_assert(pUseCount); 
-			return *pUseCount; 
+			return (unsigned int)*pUseCount; 
 		}
 
-		inline unsigned int* useCountPointer() const { return pUseCount; }
+		inline volatile LONG* useCountPointer() const { return pUseCount; }
 
 		inline T* getPointer() const { return pRep; }
 		
@@ -126,7 +135,7 @@ namespace Philo
              */
 			if (pUseCount)
 			{
-				if (--(*pUseCount) == 0) 
+				if (InterlockedDecrement(pUseCount) == 0) 
 				{
 					destroyThis = true;
 				}
@@ -139,9 +148,16 @@ namespace Philo
         virtual void destroy(void)
         {
 			delete pRep;
-			delete pUseCount;
+			ph_free(Memory::UtilHeap, (void*)pUseCount);
         }
 
+		static volatile LONG* newUseCount(void)
+		{
+			volatile LONG* useCount = (volatile LONG*)ph_malloc(Memory::UtilHeap, sizeof(LONG));
+			*useCount = 1;
+			return useCount;
+		}
+
 		virtual void swap(SharedPtr<T> &other) 
 		{
 			std::swap(pRep, other.pRep);
@@ -165,4 +181,3 @@ namespace Philo
 	}
 }
 
-#endif
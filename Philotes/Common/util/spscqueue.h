@@ -0,0 +1,309 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class SpscQueue
+
+    A bounded lock-free queue between exactly one producer thread and
+    exactly one consumer thread. The capacity is a power of 2 and is fixed
+    by SetCapacity(), which must be called before any thread uses the
+    queue. TryPush() fails if the queue is full, TryPop() if it is empty;
+    neither ever blocks. PushBatch() and PopBatch() move several elements
+    with a single index update.
+
+    The write index is only written by the producer, the read index only
+    by the consumer, and both sit on their own cache line together with a
+    copy of the other side's index which is only refreshed when the queue
+    looks full or empty. The queue itself isn't cache line aligned, so
+    every group is followed by a full line of padding and the producer's
+    group is also preceded by one: whatever the alignment, neither index
+    shares a line with the other one or with data around the queue. Elements are published by a volatile store after
+    the element was copied, which is enough on x86 and x64 where stores
+    are not reordered with older stores and loads not with older loads.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+
+#include <intrin.h>
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+template<class TYPE> class SpscQueue
+{
+public:
+    /// default constructor
+    SpscQueue();
+    /// constructor with capacity
+    SpscQueue(SizeT capacity);
+    /// destructor
+    ~SpscQueue();
+
+    /// set capacity, rounded up to a power of 2, discards the content
+    void SetCapacity(SizeT capacity);
+    /// get capacity
+    SizeT Capacity() const;
+    /// number of elements, only a snapshot while the other thread is working
+    SizeT Size() const;
+    /// return true if empty, only a snapshot while the other thread is working
+    bool IsEmpty() const;
+
+    /// producer: add an element, returns false if the queue is full
+    bool TryPush(const TYPE& elm);
+    /// producer: add up to num elements, returns the number added
+    SizeT PushBatch(const TYPE* elms, SizeT num);
+    /// consumer: remove the oldest element, returns false if the queue is empty
+    bool TryPop(TYPE& outElm);
+    /// consumer: remove up to maxNum elements, returns the number removed
+    SizeT PopBatch(TYPE* outElms, SizeT maxNum);
+
+private:
+    /// not copyable
+    SpscQueue(const SpscQueue<TYPE>&);
+    /// not assignable
+    void operator=(const SpscQueue<TYPE>&);
+    /// number of free slots as seen by the producer
+    SizeT FreeSlots();
+    /// number of used slots as seen by the consumer
+    SizeT UsedSlots();
+
+    char leadingPad[PH_CACHE_LINE_SIZE];
+    // producer side
+    volatile LONG writeIndex;
+    LONG cachedReadIndex;
+    char producerPad[PH_CACHE_LINE_SIZE];
+    // consumer side
+    volatile LONG readIndex;
+    LONG cachedWriteIndex;
+    char consumerPad[PH_CACHE_LINE_SIZE];
+    // shared, read-only after SetCapacity()
+    TYPE* elements;
+    SizeT capacity;
+    LONG mask;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+SpscQueue<TYPE>::SpscQueue() :
+    writeIndex(0),
+    cachedReadIndex(0),
+    readIndex(0),
+    cachedWriteIndex(0),
+    elements(0),
+    capacity(0),
+    mask(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+SpscQueue<TYPE>::SpscQueue(SizeT c) :
+    writeIndex(0),
+    cachedReadIndex(0),
+    readIndex(0),
+    cachedWriteIndex(0),
+    elements(0),
+    capacity(0),
+    mask(0)
+{
+    this->SetCapacity(c);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE>
+SpscQueue<TYPE>::~SpscQueue()
+{
+    if (0 != this->elements)
+    {
+        ph_delete_array(this->elements);
+        this->elements = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> void
+SpscQueue<TYPE>::SetCapacity(SizeT c)
+{
+    ph_assert(c > 0);
+    if (0 != this->elements)
+    {
+        ph_delete_array(this->elements);
+    }
+    SizeT roundedCapacity = 1;
+    while (roundedCapacity < c)
+    {
+        roundedCapacity <<= 1;
+    }
+    this->capacity = roundedCapacity;
+    this->mask = roundedCapacity - 1;
+    this->elements = ph_new_array(TYPE, roundedCapacity);
+    this->writeIndex = 0;
+    this->cachedReadIndex = 0;
+    this->readIndex = 0;
+    this->cachedWriteIndex = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+SpscQueue<TYPE>::Capacity() const
+{
+    return this->capacity;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+SpscQueue<TYPE>::Size() const
+{
+    return (SizeT) (this->writeIndex - this->readIndex);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+SpscQueue<TYPE>::IsEmpty() const
+{
+    return this->writeIndex == this->readIndex;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Only reads the consumer's index when the cached copy says the queue
+    is full.
+*/
+template<class TYPE> SizeT
+SpscQueue<TYPE>::FreeSlots()
+{
+    SizeT numFree = this->capacity - (SizeT) (this->writeIndex - this->cachedReadIndex);
+    if (0 == numFree)
+    {
+        this->cachedReadIndex = this->readIndex;
+        _ReadWriteBarrier();
+        numFree = this->capacity - (SizeT) (this->writeIndex - this->cachedReadIndex);
+    }
+    return numFree;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Only reads the producer's index when the cached copy says the queue
+    is empty.
+*/
+template<class TYPE> SizeT
+SpscQueue<TYPE>::UsedSlots()
+{
+    SizeT numUsed = (SizeT) (this->cachedWriteIndex - this->readIndex);
+    if (0 == numUsed)
+    {
+        this->cachedWriteIndex = this->writeIndex;
+        _ReadWriteBarrier();
+        numUsed = (SizeT) (this->cachedWriteIndex - this->readIndex);
+    }
+    return numUsed;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+SpscQueue<TYPE>::TryPush(const TYPE& elm)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->elements);
+    #endif
+    if (0 == this->FreeSlots())
+    {
+        return false;
+    }
+    LONG index = this->writeIndex;
+    this->elements[index & this->mask] = elm;
+    _ReadWriteBarrier();
+    this->writeIndex = index + 1;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+SpscQueue<TYPE>::PushBatch(const TYPE* elms, SizeT num)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->elements);
+    #endif
+    SizeT numFree = this->FreeSlots();
+    if (num > numFree)
+    {
+        num = numFree;
+    }
+    LONG index = this->writeIndex;
+    IndexT i;
+    for (i = 0; i < num; i++)
+    {
+        this->elements[(index + i) & this->mask] = elms[i];
+    }
+    _ReadWriteBarrier();
+    this->writeIndex = index + num;
+    return num;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> bool
+SpscQueue<TYPE>::TryPop(TYPE& outElm)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->elements);
+    #endif
+    if (0 == this->UsedSlots())
+    {
+        return false;
+    }
+    LONG index = this->readIndex;
+    outElm = this->elements[index & this->mask];
+    _ReadWriteBarrier();
+    this->readIndex = index + 1;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+template<class TYPE> SizeT
+SpscQueue<TYPE>::PopBatch(TYPE* outElms, SizeT maxNum)
+{
+    #if PH_BOUNDSCHECKS
+    ph_assert(0 != this->elements);
+    #endif
+    SizeT num = this->UsedSlots();
+    if (num > maxNum)
+    {
+        num = maxNum;
+    }
+    LONG index = this->readIndex;
+    IndexT i;
+    for (i = 0; i < num; i++)
+    {
+        outElms[i] = this->elements[(index + i) & this->mask];
+    }
+    _ReadWriteBarrier();
+    this->readIndex = index + num;
+    return num;
+}
+
+} // namespace Philo
+//------------------------------------------------------------------------------
@@ -32,6 +32,7 @@
 #pragma once
 
 #include "core/types.h"
+#include "core/memory.h"
 #include "util/array.h"
 #include "util/dictionary.h"
 
@@ -64,6 +65,8 @@ public:
     void operator=(const String& rhs);
     void operator=(const char* cStr);
     void operator +=(const String& rhs);
+    /// exchange contents without copying heap buffers (used by the containers to relocate strings)
+    void Swap(String& rhs);
 
 	char operator[](IndexT i) const;
 	char& operator[](IndexT i);
@@ -313,13 +316,39 @@ String::String() :
     this->localBuffer[0] = 0;
 }
 
+//------------------------------------------------------------------------------
+/**
+    The local buffer never holds more than LocalStringSize characters,
+    so only that much has to be exchanged.
+*/
+inline void
+String::Swap(String& rhs)
+{
+    char tmpLocal[LocalStringSize];
+    memcpy(tmpLocal, this->localBuffer, LocalStringSize);
+    memcpy(this->localBuffer, rhs.localBuffer, LocalStringSize);
+    memcpy(rhs.localBuffer, tmpLocal, LocalStringSize);
+
+    char* tmpHeap = this->heapBuffer;
+    this->heapBuffer = rhs.heapBuffer;
+    rhs.heapBuffer = tmpHeap;
+
+    SizeT tmpLen = this->strLen;
+    this->strLen = rhs.strLen;
+    rhs.strLen = tmpLen;
+
+    SizeT tmpSize = this->heapBufferSize;
+    this->heapBufferSize = rhs.heapBufferSize;
+    rhs.heapBufferSize = tmpSize;
+}
+
 //------------------------------------------------------------------------------
 inline void
 String::Delete()
 {
     if (this->heapBuffer)
     {
-        free((void*) this->heapBuffer);
+        Memory::Free(Memory::UtilHeap, (void*) this->heapBuffer);
         this->heapBuffer = 0;
     }
     this->localBuffer[0] = 0;
@@ -347,12 +376,12 @@ String::Alloc(SizeT newSize)
     // free old buffer
     if (this->heapBuffer)
     {
-        free((void*) this->heapBuffer);
+        Memory::Free(Memory::UtilHeap, (void*) this->heapBuffer);
         this->heapBuffer = 0;
     }
 
     // allocate new buffer
-    this->heapBuffer = (char*) malloc (newSize);
+    this->heapBuffer = (char*) Memory::Alloc(Memory::UtilHeap, newSize);
     this->heapBufferSize = newSize;
     this->localBuffer[0] = 0;
 }
@@ -368,7 +397,7 @@ String::Realloc(SizeT newSize)
     ph_assert(newSize > this->heapBufferSize);
 
     // allocate a new buffer
-    char* newBuffer = (char*) malloc (newSize);
+    char* newBuffer = (char*) Memory::Alloc(Memory::UtilHeap, newSize);
 
     // copy existing contents there...
     if (this->strLen > 0)
@@ -381,7 +410,7 @@ String::Realloc(SizeT newSize)
     // assign new buffer
     if (this->heapBuffer)
     {
-        free ((void*) this->heapBuffer);
+        Memory::Free(Memory::UtilHeap, (void*) this->heapBuffer);
         this->heapBuffer = 0;
     }
     this->localBuffer[0] = 0;
@@ -1210,3 +1239,5 @@ operator >= (const String& a, const String& b)
 } // namespace Philo
 //------------------------------------------------------------------------------
 
+PH_DECLARE_HAS_SWAP(Philo::String)
+
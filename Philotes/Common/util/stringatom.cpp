@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------------
+//  stringatom.cpp
+//  (C) 2012 PhiloLabs
+//------------------------------------------------------------------------------
+
+#include "util/stringatom.h"
+
+#include <string.h>
+
+namespace Philo
+{
+
+GlobalStringAtomTable* volatile GlobalStringAtomTable::instance = 0;
+
+//------------------------------------------------------------------------------
+/**
+*/
+GlobalStringAtomTable::GlobalStringAtomTable() :
+    slots(0),
+    numStrings(0)
+{
+    InitializeCriticalSection(&this->lock);
+    this->stringBuffer.Setup(PH_GLOBAL_STRINGBUFFER_CHUNKSIZE);
+    this->slots = AllocSlots(1024);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+GlobalStringAtomTable::~GlobalStringAtomTable()
+{
+    Slots* cur = this->slots;
+    while (cur)
+    {
+        Slots* next = cur->retired;
+        Memory::Free(Memory::UtilHeap, cur);
+        cur = next;
+    }
+    this->slots = 0;
+    DeleteCriticalSection(&this->lock);
+}
+
+//------------------------------------------------------------------------------
+/**
+    Static objects may create atoms before any other code runs, so the
+    table can't be a static object itself. Threads racing to create it
+    build their own and keep whichever was published first. The table is
+    never destroyed, atoms stay valid until the process ends.
+*/
+GlobalStringAtomTable*
+GlobalStringAtomTable::Instance()
+{
+    GlobalStringAtomTable* table = instance;
+    if (0 == table)
+    {
+        GlobalStringAtomTable* newTable = ph_new(GlobalStringAtomTable);
+        table = (GlobalStringAtomTable*) InterlockedCompareExchangePointer((PVOID volatile*) &instance, newTable, 0);
+        if (0 == table)
+        {
+            table = newTable;
+        }
+        else
+        {
+            ph_delete(newTable);
+        }
+    }
+    return table;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Same function as String::HashCode().
+*/
+uint32
+GlobalStringAtomTable::ComputeHash(const char* str, SizeT length)
+{
+    IndexT hash = 0;
+    IndexT i;
+    for (i = 0; i < length; i++)
+    {
+        hash += str[i];
+        hash += hash << 10;
+        hash ^= hash >>  6;
+    }
+    hash += hash << 3;
+    hash ^= hash >> 11;
+    hash += hash << 15;
+    hash &= ~(1<<31);
+    return (uint32) hash;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+GlobalStringAtomTable::Slots*
+GlobalStringAtomTable::AllocSlots(SizeT capacity)
+{
+    SizeT bytes = sizeof(Slots) + (capacity - 1) * sizeof(const char*);
+    Slots* newSlots = (Slots*) Memory::Alloc(Memory::UtilHeap, bytes);
+    memset(newSlots, 0, bytes);
+    newSlots->capacity = capacity;
+    return newSlots;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Linear probing, the header comparison rejects almost all other strings
+    before their characters are touched.
+*/
+const char*
+GlobalStringAtomTable::Find(const Slots* slots, const char* str, SizeT length, uint32 hash)
+{
+    uint32 mask = slots->capacity - 1;
+    uint32 index = hash & mask;
+    for (;;)
+    {
+        const char* entry = slots->entries[index];
+        if (0 == entry)
+        {
+            return 0;
+        }
+        const StringAtom::Header* header = ((const StringAtom::Header*) entry) - 1;
+        if (header->hash == hash && header->length == (uint32) length && 0 == memcmp(entry, str, length))
+        {
+            return entry;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+void
+GlobalStringAtomTable::Insert(Slots* slots, const char* content, uint32 hash)
+{
+    uint32 mask = slots->capacity - 1;
+    uint32 index = hash & mask;
+    while (0 != slots->entries[index])
+    {
+        index = (index + 1) & mask;
+    }
+    // the string is complete in memory before other threads can see the pointer
+    InterlockedExchangePointer((PVOID volatile*) &slots->entries[index], (PVOID) content);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+const char*
+GlobalStringAtomTable::Intern(const char* str, SizeT length, uint32 hash)
+{
+    // fast path: the string is already interned
+    const char* result = Find(this->slots, str, length, hash);
+    if (0 != result)
+    {
+        return result;
+    }
+
+    EnterCriticalSection(&this->lock);
+
+    // another thread may have added it in the meantime
+    result = Find(this->slots, str, length, hash);
+    if (0 == result)
+    {
+        if ((this->numStrings + 1) * 4 > this->slots->capacity * 3)
+        {
+            // build the larger array completely before publishing it
+            Slots* oldSlots = this->slots;
+            Slots* newSlots = AllocSlots(oldSlots->capacity * 2);
+            IndexT i;
+            for (i = 0; i < oldSlots->capacity; i++)
+            {
+                const char* entry = oldSlots->entries[i];
+                if (0 != entry)
+                {
+                    Insert(newSlots, entry, (((const StringAtom::Header*) entry) - 1)->hash);
+                }
+            }
+            newSlots->retired = oldSlots;
+            InterlockedExchangePointer((PVOID volatile*) &this->slots, (PVOID) newSlots);
+        }
+
+        char* mem = this->stringBuffer.Alloc(sizeof(StringAtom::Header) + length + 1);
+        StringAtom::Header* header = (StringAtom::Header*) mem;
+        header->hash = hash;
+        header->length = (uint32) length;
+        char* content = mem + sizeof(StringAtom::Header);
+        memcpy(content, str, length);
+        content[length] = 0;
+
+        Insert(this->slots, content, hash);
+        this->numStrings++;
+        result = content;
+    }
+
+    LeaveCriticalSection(&this->lock);
+    return result;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+SizeT
+GlobalStringAtomTable::GetNumStrings() const
+{
+    return this->numStrings;
+}
+
+} // namespace Philo
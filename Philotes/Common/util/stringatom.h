@@ -0,0 +1,359 @@
+#pragma once
+//------------------------------------------------------------------------------
+/**
+    @class StringAtom
+
+    A StringAtom is a pointer to a unique, interned copy of a string in
+    the GlobalStringAtomTable. Two atoms with the same content always
+    point to the same memory, so comparing atoms is a pointer compare and
+    copying an atom copies a pointer.
+
+    Each interned string carries its length and hash code in a small
+    header in front of the characters, HashCode() and Length() don't
+    look at the characters at all. HashCode() returns the same value as
+    String::HashCode() for the same content.
+
+    The less-than operator compares addresses, not characters: it is a
+    consistent order for sorted containers, but not an alphabetical one.
+
+    Creating an atom from a string is a hash table lookup, which is
+    lock-free when the string has been interned before. Interned
+    strings are never freed.
+
+    (C) 2012 PhiloLabs
+*/
+#include "core/types.h"
+#include "util/string.h"
+#include "util/stringbuffer.h"
+
+//------------------------------------------------------------------------------
+namespace Philo
+{
+class StringAtom
+{
+public:
+    /// default constructor, an invalid atom
+    StringAtom();
+    /// copy constructor
+    StringAtom(const StringAtom& rhs);
+    /// construct from char ptr
+    StringAtom(const char* str);
+    /// construct from string object
+    StringAtom(const String& str);
+
+    /// assignment
+    void operator=(const StringAtom& rhs);
+    /// assignment from char ptr
+    void operator=(const char* str);
+    /// assignment from string object
+    void operator=(const String& str);
+
+    /// equality operator
+    bool operator==(const StringAtom& rhs) const;
+    /// inequality operator
+    bool operator!=(const StringAtom& rhs) const;
+    /// address order, see class description
+    bool operator<(const StringAtom& rhs) const;
+    /// address order, see class description
+    bool operator>(const StringAtom& rhs) const;
+    /// equality with char ptr (slow, compares characters)
+    bool operator==(const char* rhs) const;
+    /// inequality with char ptr (slow, compares characters)
+    bool operator!=(const char* rhs) const;
+
+    /// clear content (becomes invalid)
+    void Clear();
+    /// return true if valid (contains a non-empty string)
+    bool IsValid() const;
+    /// get contained string as char ptr, empty string if invalid
+    const char* Value() const;
+    /// get containted string as string object (SLOW!!!)
+    String AsString() const;
+    /// length of the string
+    SizeT Length() const;
+    /// cached hash code of the string
+    IndexT HashCode() const;
+
+private:
+    /// header in front of every interned string
+    struct Header
+    {
+        uint32 hash;
+        uint32 length;
+    };
+    friend class GlobalStringAtomTable;
+
+    /// intern the string and point to it
+    void Setup(const char* str, SizeT length);
+    /// access the header of the content
+    const Header* GetHeader() const;
+
+    const char* content;
+};
+
+//------------------------------------------------------------------------------
+/**
+    @class GlobalStringAtomTable
+
+    The process wide table of interned strings behind StringAtom.
+
+    Lookups read an open addressing array of string pointers without
+    taking a lock. Strings are only added under a critical section:
+    the characters and header are written to the StringBuffer arena
+    first and the pointer is published into its slot afterwards, so a
+    reader sees either nothing or a complete string. When the array
+    fills up, a larger copy is built and published; the old arrays are
+    kept alive since other threads may still be reading them.
+*/
+class GlobalStringAtomTable
+{
+public:
+    /// get the table, created on first use
+    static GlobalStringAtomTable* Instance();
+
+    /// return the interned copy of a string with the given length and hash
+    const char* Intern(const char* str, SizeT length, uint32 hash);
+    /// number of interned strings
+    SizeT GetNumStrings() const;
+    /// compute the hash code of a string, same as String::HashCode()
+    static uint32 ComputeHash(const char* str, SizeT length);
+
+private:
+    /// open addressing array of string pointers
+    struct Slots
+    {
+        SizeT capacity;
+        Slots* retired;                     // the arrays this one replaced
+        const char* volatile entries[1];    // capacity entries, 0 if empty
+    };
+
+    /// constructor
+    GlobalStringAtomTable();
+    /// destructor
+    ~GlobalStringAtomTable();
+    /// lock-free lookup, 0 if not found
+    static const char* Find(const Slots* slots, const char* str, SizeT length, uint32 hash);
+    /// allocate an empty slot array
+    static Slots* AllocSlots(SizeT capacity);
+    /// insert a string which is known to be missing, caller holds the lock
+    static void Insert(Slots* slots, const char* content, uint32 hash);
+
+    static GlobalStringAtomTable* volatile instance;
+
+    Slots* volatile slots;
+    CRITICAL_SECTION lock;
+    StringBuffer stringBuffer;
+    SizeT numStrings;
+};
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+StringAtom::StringAtom() :
+    content(0)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+StringAtom::StringAtom(const StringAtom& rhs) :
+    content(rhs.content)
+{
+    // empty
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+StringAtom::StringAtom(const char* str) :
+    content(0)
+{
+    if (0 != str)
+    {
+        this->Setup(str, (SizeT) strlen(str));
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline
+StringAtom::StringAtom(const String& str) :
+    content(0)
+{
+    this->Setup(str.AsCharPtr(), str.Length());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+StringAtom::operator=(const StringAtom& rhs)
+{
+    this->content = rhs.content;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+StringAtom::operator=(const char* str)
+{
+    this->content = 0;
+    if (0 != str)
+    {
+        this->Setup(str, (SizeT) strlen(str));
+    }
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+StringAtom::operator=(const String& str)
+{
+    this->content = 0;
+    this->Setup(str.AsCharPtr(), str.Length());
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::operator==(const StringAtom& rhs) const
+{
+    return this->content == rhs.content;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::operator!=(const StringAtom& rhs) const
+{
+    return this->content != rhs.content;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::operator<(const StringAtom& rhs) const
+{
+    return this->content < rhs.content;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::operator>(const StringAtom& rhs) const
+{
+    return this->content > rhs.content;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::operator==(const char* rhs) const
+{
+    return 0 == strcmp(this->Value(), rhs ? rhs : "");
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::operator!=(const char* rhs) const
+{
+    return !(*this == rhs);
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline void
+StringAtom::Clear()
+{
+    this->content = 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline bool
+StringAtom::IsValid() const
+{
+    return 0 != this->content;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const char*
+StringAtom::Value() const
+{
+    return this->content ? this->content : "";
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline String
+StringAtom::AsString() const
+{
+    return this->content ? String(this->content, this->Length()) : String();
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline const StringAtom::Header*
+StringAtom::GetHeader() const
+{
+    return ((const Header*) this->content) - 1;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline SizeT
+StringAtom::Length() const
+{
+    return this->content ? (SizeT) this->GetHeader()->length : 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+*/
+inline IndexT
+StringAtom::HashCode() const
+{
+    return this->content ? (IndexT) this->GetHeader()->hash : 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Empty strings stay invalid atoms, like the default constructed one.
+*/
+inline void
+StringAtom::Setup(const char* str, SizeT length)
+{
+    if (length > 0)
+    {
+        uint32 hash = GlobalStringAtomTable::ComputeHash(str, length);
+        this->content = GlobalStringAtomTable::Instance()->Intern(str, length, hash);
+    }
+}
+
+} // namespace Philo
+//------------------------------------------------------------------------------
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::StringAtom)
+//------------------------------------------------------------------------------
@@ -54,7 +54,7 @@ StringBuffer::Discard()
     IndexT i;
     for (i = 0; i < this->chunks.Size(); i++)
     {
-		free(chunks[i]);
+		Memory::Free(Memory::UtilHeap, this->chunks[i]);
         this->chunks[i] = 0;
     }
     this->chunks.Clear();
@@ -68,7 +68,7 @@ StringBuffer::Discard()
 void
 StringBuffer::AllocNewChunk()
 {
-	char* newChunk = (char*) malloc (this->chunkSize);
+	char* newChunk = (char*) Memory::Alloc(Memory::UtilHeap, this->chunkSize);
     this->chunks.Append(newChunk);
     this->curPointer = newChunk;
 }
@@ -82,26 +82,41 @@ const char*
 StringBuffer::AddString(const char* str)
 {
     ph_assert(0 != str);
+
+    // copy string into string buffer
+    char* dstPointer = this->Alloc(strlen(str) + 1);
+    strcpy(dstPointer, str);
+    return dstPointer;
+}
+
+//------------------------------------------------------------------------------
+/**
+    Reserves size bytes at the end of the string buffer. Used by the
+    StringAtom table, which stores a small header in front of each string.
+*/
+char*
+StringBuffer::Alloc(SizeT size)
+{
     ph_assert(this->IsValid());
 
-    // get string length, must be less then chunk size
-    SizeT strLength = strlen(str) + 1;
-    ph_assert(strLength < this->chunkSize);
+    // must be less then chunk size
+    ph_assert(size + 3 < this->chunkSize);
+
+    // align start to 4 bytes, chunks come from the heap and are aligned already
+    this->curPointer = (char*) ((((size_t)this->curPointer) + 3) & ~((size_t)3));
 
     // check if a new buffer must be allocated
-    if ((this->curPointer + strLength) >= (this->chunks.Back() + this->chunkSize))
+    if ((this->curPointer + size) >= (this->chunks.Back() + this->chunkSize))
     {
         #if PH_ENABLE_GLOBAL_STRINGBUFFER_GROWTH
         this->AllocNewChunk();
         #else
-        ph_error("String buffer full when adding string '%s' (string buffer growth is disabled)!\n", str);
+        ph_error("String buffer full when allocating %d bytes (string buffer growth is disabled)!\n", size);
         #endif
     }
 
-    // copy string into string buffer
     char* dstPointer = this->curPointer;
-    strcpy(dstPointer, str);
-    this->curPointer += strLength;
+    this->curPointer += size;
     return dstPointer;
 }
 
@@ -42,6 +42,8 @@ public:
 
     /// add a string to the end of the string buffer, return pointer to string
     const char* AddString(const char* str);
+    /// reserve raw bytes at the end of the string buffer, 4-byte aligned
+    char* Alloc(SizeT size);
     /// DEBUG: return next string in string buffer
     const char* NextString(const char* prev);
     /// DEBUG: get number of allocated chunks
@@ -41,6 +41,8 @@ GearApplication::GearApplication(const GearCommandLine &cmdline, const char *ass
 	m_renderer     = 0;
 	m_sceneSize    = 1.0f;
 	m_assetManager = 0;
+	m_jobSystem    = 0;
+	m_sceneManager = 0;
 	m_timeCounter  = 0;
 
 	m_inputManager = 0;
@@ -50,9 +52,10 @@ GearApplication::GearApplication(const GearCommandLine &cmdline, const char *ass
 
 GearApplication::~GearApplication(void)
 {
-	ph_delete(m_sceneManager);
+	ph_assert2(!m_sceneManager, "Scene Manager was not released prior to window closure.");
 	ph_assert2(!m_renderer, "Render was not released prior to window closure.");
 	ph_assert2(!m_assetManager, "Asset Manager was not released prior to window closure.");
+	ph_assert2(!m_jobSystem, "Job System was not released prior to window closure.");
 }
 
 void GearApplication::onOpen( void )
@@ -72,9 +75,17 @@ void GearApplication::onOpen( void )
 
 	m_timeCounter = m_time.getCurrentCounterValue();
 
+	// ̣߳߳Ϊ0ִ̲߳
+	m_jobSystem = ph_new(JobSystem);
+	m_jobSystem->Setup();
+
 	m_assetManager = new GearAssetManager();
 	m_assetManager->addSearchPath(m_assetPathPrefix);
 	m_assetManager->addSearchPath(rendererdir);
+	m_assetManager->enableHotReload(m_assetPathPrefix);
+#if RENDERER_TEXTURE_STREAMING_BUDGET
+	m_assetManager->enableTextureStreaming(RENDERER_TEXTURE_STREAMING_BUDGET);
+#endif
 
 	m_sceneManager = ph_new(RenderSceneManager);
 
@@ -89,11 +100,23 @@ bool GearApplication::onClose( void )
 
 	shutdownInput();
 
+	// the scene goes before the resources it uses, and before the leak dump.
+	ph_delete(m_sceneManager);
+	m_sceneManager = 0;
+
 	DELETESINGLE(m_assetManager);
 	SAFE_RELEASE(m_renderer);
 
+	m_jobSystem->Discard();
+	ph_delete(m_jobSystem);
+	m_jobSystem = 0;
+
 	GearPlatformUtil::getSingleton()->postRenderRelease();
 
+#if PH_MEMORY_STATS
+	Memory::DumpLeaks();
+#endif
+
 	return true;
 }
 
@@ -105,9 +128,20 @@ void GearApplication::onDraw( void )
 	ph_assert(dtime >= 0);
 	if(dtime > 0)
 	{
+		// л֡ʱڴ棬֡
+		Memory::SwapFrameAllocators();
+#if PH_MEMORY_STATS
+		Memory::NewFrame();
+#endif
+#if PH_ENABLE_PROFILING
+		m_jobSystem->CollectProfile(m_jobProfile);
+#endif
+
 		// 
 		captureInput();
 
+		m_assetManager->update();
+
 		onTickPreRender(dtime);
 		
 		if(m_renderer)
@@ -21,6 +21,11 @@ public:
 
 	Render*						getRender(void)									{ return m_renderer; }
 	GearAssetManager*			getAssetManager(void)							{ return m_assetManager; }
+	JobSystem*					getJobSystem(void)								{ return m_jobSystem; }
+#if PH_ENABLE_PROFILING
+	// the jobs run during the last frame
+	const Array<JobProfileEntry>&	getJobProfile(void)						const	{ return m_jobProfile; }
+#endif
 	inline const char*			getAssetPathPrefix(void)				const	{ return m_assetPathPrefix; }
 
 	virtual	void				onInit(void)					= 0;
@@ -59,6 +64,12 @@ protected:
 
 	GearAssetManager*			m_assetManager;
 
+	JobSystem*					m_jobSystem;
+
+#if PH_ENABLE_PROFILING
+	Array<JobProfileEntry>		m_jobProfile;
+#endif
+
 	GearInputManager*			m_inputManager;
 
 	GearKeyboard*				m_keyboard;
@@ -1,5 +1,6 @@
 
 #include "gearsAsset.h"
+#include "gearsFileWatcher.h"
 
 _NAMESPACE_BEGIN
 
@@ -14,5 +15,14 @@ GearAsset::~GearAsset(void)
 {
 }
 
+void GearAsset::addDependency(const String& file)
+{
+	String path = GearFileWatcher::normalizePath(file);
+	if(m_dependencies.FindIndex(path) == InvalidIndex)
+	{
+		m_dependencies.Append(path);
+	}
+}
+
 
 _NAMESPACE_END
\ No newline at end of file
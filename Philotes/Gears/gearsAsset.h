@@ -6,6 +6,7 @@ _NAMESPACE_BEGIN
 class GearAsset
 {
 	friend class GearAssetManager;
+	PH_DECLARE_HEAP_ALLOC(Memory::GearsHeap)
 
 public:
 
@@ -33,7 +34,25 @@ public:
 
 	Type			getType(void) const { return m_type; }
 
-	const String&	getPath(void) const { return m_path; }
+	const StringAtom&	getPath(void) const { return m_path; }
+
+	// the file the asset was loaded from, normalized (see GearFileWatcher::normalizePath).
+	const String&	getFullPath(void) const { return m_fullPath; }
+
+	// files that cause a reload of the asset when they change.
+	const StringArray&	getDependencies(void) const { return m_dependencies; }
+
+	// reloads the asset from the file in place, pointers handed out before stay valid.
+	virtual bool	reload(FILE &file) { return false; }
+
+	// called after another asset has been reloaded, lets holders pick up its new resources.
+	virtual void	onAssetReloaded(const GearAsset &asset) {}
+
+protected:
+
+	void			addDependency(const String& file);
+
+	void			clearDependencies(void) { m_dependencies.Clear(); }
 
 private:
 
@@ -43,7 +62,11 @@ private:
 
 	const Type		m_type;
 
-	String			m_path;
+	StringAtom		m_path;
+
+	String			m_fullPath;
+
+	StringArray		m_dependencies;
 
 	uint32      	m_numUsers;
 };
@@ -3,9 +3,14 @@
 #include "gearsAssetManager.h"
 #include "gearsTextureAsset.h"
 #include "gearsMaterialAsset.h"
+#include "gearsFileWatcher.h"
+#include "gearsTextureStreamer.h"
+#include "gearsTextureBaker.h"
+#include "gearsApplication.h"
 
 #include "render.h"
 #include "renderConfig.h"
+#include "renderShaderCache.h"
 
 #define RAPIDXML_NO_EXCEPTIONS
 #include <rapidxml.hpp>
@@ -24,12 +29,133 @@ _IMPLEMENT_SINGLETON(GearAssetManager);
 
 GearAssetManager::GearAssetManager()
 {
+	m_fileWatcher     = 0;
+	m_textureStreamer = 0;
 }
 
 GearAssetManager::~GearAssetManager(void)
 {
 	ph_assert(m_assets.Size() == 0);
 	clearSearchPaths();
+	delete m_fileWatcher;
+	delete m_textureStreamer;
+}
+
+bool GearAssetManager::enableHotReload(const String& dir)
+{
+	if(!m_fileWatcher)
+	{
+		m_fileWatcher = new GearFileWatcher();
+		// baked textures are written by the reload of their source, watching them would reload the texture twice.
+		m_fileWatcher->addIgnoredSuffix(GearTextureBaker::getBakedPath(".tga"));
+	}
+	return m_fileWatcher->addDirectory(dir);
+}
+
+bool GearAssetManager::enableTextureStreaming(uint32 budget, uint32 startSize)
+{
+	if(m_textureStreamer)
+	{
+		m_textureStreamer->setBudget(budget);
+		return true;
+	}
+	GearTextureAsset::setStreamingStartSize(startSize);
+	m_textureStreamer = new GearTextureStreamer(budget);
+
+	// textures loaded so far hold all their levels, the budget evicts what isn't needed.
+	for(SizeT i=0; i<m_assets.Size(); i++)
+	{
+		if(m_assets[i]->getType() == GearAsset::ASSET_TEXTURE)
+		{
+			m_textureStreamer->addTexture(*static_cast<GearTextureAsset*>(m_assets[i]));
+		}
+	}
+	return true;
+}
+
+void GearAssetManager::notifyAssetReloaded(GearAsset &asset)
+{
+	for(SizeT a=0; a<m_assets.Size(); a++)
+	{
+		if(m_assets[a] != &asset) m_assets[a]->onAssetReloaded(asset);
+	}
+}
+
+void GearAssetManager::update(void)
+{
+	if(m_textureStreamer)
+	{
+		Array<GearTextureAsset*> streamed;
+		m_textureStreamer->update(streamed);
+		for(SizeT i=0; i<streamed.Size(); i++)
+		{
+			notifyAssetReloaded(*streamed[i]);
+		}
+	}
+
+	if(!m_fileWatcher) return;
+
+	StringArray changedFiles;
+	m_fileWatcher->poll(changedFiles);
+	if(changedFiles.IsEmpty()) return;
+
+	// textures before materials so that materials reloaded in the same pass pick up the new textures.
+	AssetArray toReload;
+	for(uint32 pass=0; pass<2; pass++)
+	{
+		for(SizeT i=0; i<m_assets.Size(); i++)
+		{
+			GearAsset *asset = m_assets[i];
+			if((asset->getType() == GearAsset::ASSET_MATERIAL) != (pass == 1)) continue;
+
+			bool changed = GearFileWatcher::isChanged(changedFiles, asset->getFullPath());
+			for(SizeT d=0; !changed && d<asset->getDependencies().Size(); d++)
+			{
+				changed = GearFileWatcher::isChanged(changedFiles, asset->getDependencies()[d]);
+			}
+			if(changed) toReload.Append(asset);
+		}
+	}
+
+	bool shaderCacheInvalidated = false;
+	for(SizeT i=0; i<toReload.Size(); i++)
+	{
+		GearAsset &asset = *toReload[i];
+		if(asset.getType() == GearAsset::ASSET_MATERIAL && !shaderCacheInvalidated)
+		{
+			GearApplication::getApp()->getRender()->getShaderCache()->invalidate();
+			shaderCacheInvalidated = true;
+		}
+		if(reloadAsset(asset))
+		{
+			notifyAssetReloaded(asset);
+		}
+	}
+}
+
+bool GearAssetManager::reloadAsset(GearAsset &asset)
+{
+	// baked textures depend on their source image, bring the baked file up to date first.
+	GearTextureAsset *texture = asset.getType() == GearAsset::ASSET_TEXTURE ? static_cast<GearTextureAsset*>(&asset) : 0;
+	if(texture && texture->getDependencies().Size() && !GearTextureBaker::bakeIfStale(texture->getDependencies()[0], asset.getFullPath()))
+	{
+		return false;
+	}
+
+	FILE *file = 0;
+	fopen_s(&file, asset.getFullPath().c_str(), "rb");
+	if(!file) return false;
+
+	// the file may have a different size or level count, the streamer starts over with it.
+	if(texture && m_textureStreamer) m_textureStreamer->removeTexture(*texture);
+	bool ok = asset.reload(*file);
+	if(texture && m_textureStreamer) m_textureStreamer->addTexture(*texture);
+	fclose(file);
+
+	char msg[1024];
+	sprintf_s(msg, sizeof(msg), "%s asset: %s\n", ok ? "Reloaded" : "Failed to reload", asset.getPath().Value());
+	RENDERER_OUTPUT_MESSAGE(GearApplication::getApp()->getRender(), msg);
+	return ok;
 }
 
 GearAsset *GearAssetManager::getAsset(const String& path, GearAsset::Type type)
@@ -90,19 +216,10 @@ void GearAssetManager::clearSearchPaths()
 	m_searchPaths.Reset();
 }
 
-GearAsset *GearAssetManager::findAsset(const String& path)
+GearAsset *GearAssetManager::findAsset(const StringAtom& path)
 {
-	GearAsset *asset = 0;
-	uint32 numAssets = (uint32)m_assets.Size();
-	for(uint32 i=0; i<numAssets; i++)
-	{
-		if(m_assets[i]->getPath() == path)
-		{
-			asset = m_assets[i];
-			break;
-		}
-	}
-	return asset;
+	KeyValuePair<StringAtom, GearAsset*> *entry = m_assetsByPath.FindKV(path);
+	return entry ? entry->Value() : 0;
 }
 
 GearAsset *GearAssetManager::loadAsset(const String& path)
@@ -113,6 +230,7 @@ GearAsset *GearAssetManager::loadAsset(const String& path)
 	if(!extension.IsEmpty())
 	{
 		FILE *file = 0;
+		String filePath;
 		const uint32 numSearchPaths = (uint32)m_searchPaths.Size();
 		for(uint32 i=0; i<numSearchPaths; i++)
 		{
@@ -121,21 +239,57 @@ GearAsset *GearAssetManager::loadAsset(const String& path)
 			strncpy_s(fullPath, 512, prefix, 512);
 			strncat_s(fullPath, 512, path.c_str(),   512);
 			fopen_s(&file, fullPath, "rb");
-			if(file) break;
+			if(file)
+			{
+				filePath = fullPath;
+				break;
+			}
 		}
 
 		if(!file)
+		{
 			fopen_s(&file, path.c_str(), "rb");
+			filePath = path;
+		}
 
 		ph_assert(file);
 
 		if(file)
 		{
+			String assetFilePath = filePath;
 			if(extension == "xml")      asset = loadXMLAsset(*file, path);
 			else if(extension == "dds") asset = loadTextureAsset(*file, path, GearTextureAsset::DDS);
-			else if(extension == "tga") asset = loadTextureAsset(*file, path, GearTextureAsset::TGA);
+			else if(extension == "tga")
+			{
+#ifdef RENDERER_ENABLE_TGA_BAKE
+				// load the block compressed copy, the tga stays a dependency so edits rebake it.
+				const String bakedPath = GearTextureBaker::getBakedPath(filePath);
+				FILE *bakedFile = 0;
+				if(GearTextureBaker::bakeIfStale(filePath, bakedPath))
+				{
+					fopen_s(&bakedFile, bakedPath.c_str(), "rb");
+				}
+				if(bakedFile)
+				{
+					asset = loadTextureAsset(*bakedFile, path, GearTextureAsset::DDS);
+					fclose(bakedFile);
+					if(asset)
+					{
+						assetFilePath = bakedPath;
+						asset->addDependency(GearFileWatcher::normalizePath(filePath));
+					}
+				}
+				if(!asset)
+#endif
+				asset = loadTextureAsset(*file, path, GearTextureAsset::TGA);
+			}
 
 			fclose(file);
+
+			if(asset)
+			{
+				asset->m_fullPath = GearFileWatcher::normalizePath(assetFilePath);
+			}
 		}
 		else
 		{
@@ -149,7 +303,7 @@ GearAsset *GearAssetManager::loadAsset(const String& path)
 			{
 				sprintf_s(msg, sizeof(msg), "Could not find material: %s, loading default material: %s", 
 					path, SAM_DEFAULT_MATERIAL);
-				RENDERER_OUTPUT_MESSAGE(&m_renderer, msg);
+				RENDERER_OUTPUT_MESSAGE(GearApplication::getApp()->getRender(), msg);
 
 				return loadAsset(SAM_DEFAULT_MATERIAL);  // Try to use the default asset
 			}
@@ -157,7 +311,7 @@ GearAsset *GearAssetManager::loadAsset(const String& path)
 			{
 				sprintf_s(msg, sizeof(msg), "Could not find texture: %s, loading default texture: %s", 
 					path, SAM_DEFAULT_TEXTURE);
-				RENDERER_OUTPUT_MESSAGE(&m_renderer, msg);
+				RENDERER_OUTPUT_MESSAGE(GearApplication::getApp()->getRender(), msg);
 
 				return loadAsset(SAM_DEFAULT_TEXTURE);  // Try to use the default asset
 			}
@@ -172,6 +326,11 @@ GearAsset *GearAssetManager::loadAsset(const String& path)
 	if(asset)
 	{
 		m_assets.Append(asset);
+		m_assetsByPath.Add(asset->getPath(), asset);
+		if(m_textureStreamer && asset->getType() == GearAsset::ASSET_TEXTURE)
+		{
+			m_textureStreamer->addTexture(*static_cast<GearTextureAsset*>(asset));
+		}
 	}
 	return asset;
 }
@@ -193,6 +352,11 @@ void GearAssetManager::releaseAsset(GearAsset &asset)
 	{
 		m_assets[found] = m_assets.Back();
 		m_assets.PopBack();
+		m_assetsByPath.Erase(asset.getPath());
+		if(m_textureStreamer && asset.getType() == GearAsset::ASSET_TEXTURE)
+		{
+			m_textureStreamer->removeTexture(static_cast<GearTextureAsset&>(asset));
+		}
 		asset.release();
 	}
 }
@@ -24,6 +24,18 @@ class GearAssetManager : public Singleton<GearAssetManager>
 
 		void         	clearSearchPaths(void);
 
+		// watches the directory tree and reloads loaded assets in place when their files change.
+		bool			enableHotReload(const String& dir);
+
+		// loads DDS textures at a coarse level from now on and streams finer levels as they become visible,
+		// keeping all streamed textures within budget bytes.
+		bool			enableTextureStreaming(uint32 budget, uint32 startSize = 64);
+
+		GearTextureStreamer* getTextureStreamer(void) { return m_textureStreamer; }
+
+		// picks up file changes and streamed textures, call once per frame.
+		void			update(void);
+
 		FILE*		 	findFile(const String& path);
 
 		const String&	findPath(const String& path);
@@ -43,11 +55,16 @@ class GearAssetManager : public Singleton<GearAssetManager>
 		static bool 	searchForPath(const char* path, char* buffer, int bufferSize, int maxRecursion);
 	
 	protected:
-		GearAsset*		findAsset(const String& path);
+		GearAsset*		findAsset(const StringAtom& path);
 
 		GearAsset*		loadAsset(const String& path);
 
 		void			releaseAsset(GearAsset &asset);
+
+		bool			reloadAsset(GearAsset &asset);
+
+		// lets the other assets refer to the new data of an asset that was reloaded or streamed.
+		void			notifyAssetReloaded(GearAsset &asset);
 		
 		GearAsset*		loadXMLAsset(FILE &file, const String& path);
 
@@ -61,6 +78,13 @@ class GearAssetManager : public Singleton<GearAssetManager>
 		StringArray		m_searchPaths;
 
 		AssetArray		m_assets;
+
+		// the same assets by path, the atoms carry their hash.
+		HashTable<StringAtom, GearAsset*, false>	m_assetsByPath;
+
+		GearFileWatcher*	m_fileWatcher;
+
+		GearTextureStreamer* m_textureStreamer;
 };
 
 _NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,531 @@
+
+#include "gearsBlockCompressor.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define GEAR_BC_SSE2 1
+#include <emmintrin.h>
+#else
+#define GEAR_BC_SSE2 0
+#endif
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	// endpoint pairs that reproduce a single 8 bit value best through the 2/3 interpolant.
+	uint8			s_match5[256][2];
+	uint8			s_match6[256][2];
+
+	inline int mul8bit(int a, int b)
+	{
+		int t = a*b + 128;
+		return (t + (t >> 8)) >> 8;
+	}
+
+	inline int lerp13(int a, int b)
+	{
+		return (2*a + b) / 3;
+	}
+
+	inline int clampInt(float v, int lo, int hi)
+	{
+		int i = (int)v;
+		return i < lo ? lo : (i > hi ? hi : i);
+	}
+
+	inline uint16 pack565(const uint8 *c)
+	{
+		return (uint16)((mul8bit(c[0], 31) << 11) | (mul8bit(c[1], 63) << 5) | mul8bit(c[2], 31));
+	}
+
+	inline void unpack565(uint16 c, uint8 *out)
+	{
+		const int r = (c >> 11) & 31;
+		const int g = (c >> 5)  & 63;
+		const int b =  c        & 31;
+		out[0] = (uint8)((r << 3) | (r >> 2));
+		out[1] = (uint8)((g << 2) | (g >> 4));
+		out[2] = (uint8)((b << 3) | (b >> 2));
+		out[3] = 0;
+	}
+
+	void buildMatchTable(uint8 (*table)[2], int bits)
+	{
+		const int size = 1 << bits;
+		for(int i=0; i<256; i++)
+		{
+			int bestErr = 0x7fffffff;
+			for(int mn=0; mn<size; mn++)
+			{
+				for(int mx=0; mx<size; mx++)
+				{
+					const int mine = bits == 5 ? (mn << 3) | (mn >> 2) : (mn << 2) | (mn >> 4);
+					const int maxe = bits == 5 ? (mx << 3) | (mx >> 2) : (mx << 2) | (mx >> 4);
+					// decoders may interpolate with a few percent of error, so prefer close endpoints.
+					int err = abs(lerp13(maxe, mine) - i) * 100 + abs(maxe - mine) * 3;
+					if(err < bestErr)
+					{
+						table[i][0] = (uint8)mx;
+						table[i][1] = (uint8)mn;
+						bestErr = err;
+					}
+				}
+			}
+		}
+	}
+
+	// the tables are built during static initialization, before any thread can encode a block.
+	struct MatchTableInit
+	{
+		MatchTableInit(void)
+		{
+			buildMatchTable(s_match5, 5);
+			buildMatchTable(s_match6, 6);
+		}
+	};
+	MatchTableInit	s_matchTableInit;
+
+	void evalColors(uint8 *colors, uint16 c0, uint16 c1)
+	{
+		unpack565(c0, colors+0);
+		unpack565(c1, colors+4);
+		for(int ch=0; ch<3; ch++)
+		{
+			colors[8+ch]  = (uint8)lerp13(colors[ch], colors[4+ch]);
+			colors[12+ch] = (uint8)lerp13(colors[4+ch], colors[ch]);
+		}
+		colors[11] = colors[15] = 0;
+	}
+
+	// picks the nearest of the four palette entries for every pixel, returns the 2 bit indices.
+#if GEAR_BC_SSE2
+	uint32 matchColors(const uint8 *block, const uint8 *colors, uint32 &error)
+	{
+		const __m128i zero     = _mm_setzero_si128();
+		const __m128i rgbMask  = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		__m128i palette[4];
+		for(int c=0; c<4; c++)
+		{
+			const uint8 *p = colors + c*4;
+			palette[c] = _mm_set_epi16(0, p[2], p[1], p[0], 0, p[2], p[1], p[0]);
+		}
+
+		uint32 mask = 0;
+		error = 0;
+		for(int i=0; i<16; i+=4)
+		{
+			const __m128i pixels = _mm_loadu_si128((const __m128i*)(block + i*4));
+			const __m128i lo = _mm_and_si128(_mm_unpacklo_epi8(pixels, zero), rgbMask);
+			const __m128i hi = _mm_and_si128(_mm_unpackhi_epi8(pixels, zero), rgbMask);
+
+			__m128i best      = _mm_set1_epi32(0x7fffffff);
+			__m128i bestIndex = zero;
+			for(int c=0; c<4; c++)
+			{
+				__m128i dl = _mm_sub_epi16(lo, palette[c]);
+				__m128i dh = _mm_sub_epi16(hi, palette[c]);
+				dl = _mm_madd_epi16(dl, dl);
+				dh = _mm_madd_epi16(dh, dh);
+				// each pixel left two partial sums, fold them.
+				dl = _mm_shuffle_epi32(dl, _MM_SHUFFLE(3,1,2,0));
+				dh = _mm_shuffle_epi32(dh, _MM_SHUFFLE(3,1,2,0));
+				dl = _mm_add_epi32(dl, _mm_srli_si128(dl, 8));
+				dh = _mm_add_epi32(dh, _mm_srli_si128(dh, 8));
+				const __m128i dist = _mm_unpacklo_epi64(dl, dh);
+
+				const __m128i less = _mm_cmplt_epi32(dist, best);
+				best      = _mm_or_si128(_mm_and_si128(less, dist), _mm_andnot_si128(less, best));
+				bestIndex = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(c)), _mm_andnot_si128(less, bestIndex));
+			}
+
+			int32 index[4], dist[4];
+			_mm_storeu_si128((__m128i*)index, bestIndex);
+			_mm_storeu_si128((__m128i*)dist,  best);
+			for(int k=0; k<4; k++)
+			{
+				mask  |= (uint32)index[k] << (2*(i+k));
+				error += (uint32)dist[k];
+			}
+		}
+		return mask;
+	}
+#else
+	uint32 matchColors(const uint8 *block, const uint8 *colors, uint32 &error)
+	{
+		uint32 mask = 0;
+		error = 0;
+		for(int i=0; i<16; i++)
+		{
+			const uint8 *p = block + i*4;
+			int best = 0x7fffffff, bestIndex = 0;
+			for(int c=0; c<4; c++)
+			{
+				const int dr = p[0] - colors[c*4+0];
+				const int dg = p[1] - colors[c*4+1];
+				const int db = p[2] - colors[c*4+2];
+				const int dist = dr*dr + dg*dg + db*db;
+				if(dist < best)
+				{
+					best      = dist;
+					bestIndex = c;
+				}
+			}
+			mask  |= (uint32)bestIndex << (2*i);
+			error += (uint32)best;
+		}
+		return mask;
+	}
+#endif
+
+	// endpoints from the extremes of the block along its principal axis.
+	void optimizeColors(const uint8 *block, uint16 &max16, uint16 &min16)
+	{
+		int mu[3], mn[3], mx[3];
+		for(int ch=0; ch<3; ch++)
+		{
+			int sum = block[ch];
+			mn[ch] = mx[ch] = block[ch];
+			for(int i=1; i<16; i++)
+			{
+				const int v = block[i*4+ch];
+				sum += v;
+				if(v < mn[ch]) mn[ch] = v;
+				if(v > mx[ch]) mx[ch] = v;
+			}
+			mu[ch] = (sum + 8) >> 4;
+		}
+
+		int cov[6] = { 0, 0, 0, 0, 0, 0 };
+		for(int i=0; i<16; i++)
+		{
+			const int r = block[i*4+0] - mu[0];
+			const int g = block[i*4+1] - mu[1];
+			const int b = block[i*4+2] - mu[2];
+			cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+			cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+		}
+		float covf[6];
+		for(int i=0; i<6; i++) covf[i] = cov[i] / 255.0f;
+
+		// power iteration, seeded with the bounding box diagonal.
+		float vfr = (float)(mx[0] - mn[0]);
+		float vfg = (float)(mx[1] - mn[1]);
+		float vfb = (float)(mx[2] - mn[2]);
+		for(int iter=0; iter<4; iter++)
+		{
+			const float r = vfr*covf[0] + vfg*covf[1] + vfb*covf[2];
+			const float g = vfr*covf[1] + vfg*covf[3] + vfb*covf[4];
+			const float b = vfr*covf[2] + vfg*covf[4] + vfb*covf[5];
+			vfr = r; vfg = g; vfb = b;
+		}
+
+		float magn = fabs(vfr);
+		if(fabs(vfg) > magn) magn = fabs(vfg);
+		if(fabs(vfb) > magn) magn = fabs(vfb);
+
+		int vr, vg, vb;
+		if(magn < 4.0f)
+		{
+			// hardly any variance, use luminance.
+			vr = 299; vg = 587; vb = 114;
+		}
+		else
+		{
+			magn = 512.0f / magn;
+			vr = (int)(vfr * magn);
+			vg = (int)(vfg * magn);
+			vb = (int)(vfb * magn);
+		}
+
+		int minDot = 0x7fffffff, maxDot = -0x7fffffff;
+		const uint8 *minp = block, *maxp = block;
+		for(int i=0; i<16; i++)
+		{
+			const uint8 *p = block + i*4;
+			const int dot = p[0]*vr + p[1]*vg + p[2]*vb;
+			if(dot < minDot) { minDot = dot; minp = p; }
+			if(dot > maxDot) { maxDot = dot; maxp = p; }
+		}
+		max16 = pack565(maxp);
+		min16 = pack565(minp);
+	}
+
+	// least squares endpoints for the given indices, returns whether they changed.
+	bool refineColors(const uint8 *block, uint16 &max16, uint16 &min16, uint32 mask)
+	{
+		static const int w1Tab[4] = { 3, 0, 2, 1 };
+		// alpha*alpha, beta*beta and alpha*beta of each index packed into one int.
+		static const int prods[4] = { 0x090000, 0x000900, 0x040102, 0x010402 };
+
+		const uint16 oldMin = min16;
+		const uint16 oldMax = max16;
+
+		if((mask ^ (mask << 2)) < 4)
+		{
+			// all pixels share one index, the system is singular; match the average color instead.
+			int r = 8, g = 8, b = 8;
+			for(int i=0; i<16; i++)
+			{
+				r += block[i*4+0];
+				g += block[i*4+1];
+				b += block[i*4+2];
+			}
+			r >>= 4; g >>= 4; b >>= 4;
+			max16 = (uint16)((s_match5[r][0] << 11) | (s_match6[g][0] << 5) | s_match5[b][0]);
+			min16 = (uint16)((s_match5[r][1] << 11) | (s_match6[g][1] << 5) | s_match5[b][1]);
+		}
+		else
+		{
+			int at1r = 0, at1g = 0, at1b = 0;
+			int at2r = 0, at2g = 0, at2b = 0;
+			int akku = 0;
+			uint32 cm = mask;
+			for(int i=0; i<16; i++, cm>>=2)
+			{
+				const int step = cm & 3;
+				const int w1   = w1Tab[step];
+				const int r = block[i*4+0];
+				const int g = block[i*4+1];
+				const int b = block[i*4+2];
+				akku += prods[step];
+				at1r += w1*r; at1g += w1*g; at1b += w1*b;
+				at2r += r;    at2g += g;    at2b += b;
+			}
+			at2r = 3*at2r - at1r;
+			at2g = 3*at2g - at1g;
+			at2b = 3*at2b - at1b;
+
+			const int xx = akku >> 16;
+			const int yy = (akku >> 8) & 0xff;
+			const int xy = akku & 0xff;
+
+			const float frb = 3.0f * 31.0f / 255.0f / (xx*yy - xy*xy);
+			const float fg  = frb * 63.0f / 31.0f;
+
+			max16 = (uint16)((clampInt((at1r*yy - at2r*xy)*frb + 0.5f, 0, 31) << 11) |
+							 (clampInt((at1g*yy - at2g*xy)*fg  + 0.5f, 0, 63) << 5)  |
+							  clampInt((at1b*yy - at2b*xy)*frb + 0.5f, 0, 31));
+			min16 = (uint16)((clampInt((at2r*xx - at1r*xy)*frb + 0.5f, 0, 31) << 11) |
+							 (clampInt((at2g*xx - at1g*xy)*fg  + 0.5f, 0, 63) << 5)  |
+							  clampInt((at2b*xx - at1b*xy)*frb + 0.5f, 0, 31));
+		}
+		return oldMin != min16 || oldMax != max16;
+	}
+
+	void encodeColorBlock(const uint8 *block, uint8 *dest)
+	{
+		uint16 max16, min16;
+		uint32 mask;
+
+		bool solid = true;
+		for(int i=1; i<16 && solid; i++)
+		{
+			solid = block[i*4+0] == block[0] && block[i*4+1] == block[1] && block[i*4+2] == block[2];
+		}
+
+		if(solid)
+		{
+			max16 = (uint16)((s_match5[block[0]][0] << 11) | (s_match6[block[1]][0] << 5) | s_match5[block[2]][0]);
+			min16 = (uint16)((s_match5[block[0]][1] << 11) | (s_match6[block[1]][1] << 5) | s_match5[block[2]][1]);
+			mask  = 0xaaaaaaaa;
+		}
+		else
+		{
+			uint8 colors[16];
+			uint32 error = 0;
+			optimizeColors(block, max16, min16);
+			if(max16 != min16)
+			{
+				evalColors(colors, max16, min16);
+				mask = matchColors(block, colors, error);
+			}
+			else
+			{
+				mask  = 0;
+				error = 0xffffffff;
+			}
+
+			// refine while it keeps improving, the first fit is kept if the solve makes things worse.
+			for(int iter=0; iter<2; iter++)
+			{
+				uint16 refinedMax = max16, refinedMin = min16;
+				if(!refineColors(block, refinedMax, refinedMin, mask) || refinedMax == refinedMin) break;
+
+				uint32 refinedError = 0;
+				evalColors(colors, refinedMax, refinedMin);
+				const uint32 refinedMask = matchColors(block, colors, refinedError);
+				if(refinedError >= error) break;
+
+				max16 = refinedMax;
+				min16 = refinedMin;
+				mask  = refinedMask;
+				error = refinedError;
+			}
+		}
+
+		// four color mode needs the first endpoint to be the larger one.
+		if(max16 < min16)
+		{
+			uint16 t = min16; min16 = max16; max16 = t;
+			mask ^= 0x55555555;
+		}
+		else if(max16 == min16)
+		{
+			mask = 0;
+		}
+
+		dest[0] = (uint8)(max16);
+		dest[1] = (uint8)(max16 >> 8);
+		dest[2] = (uint8)(min16);
+		dest[3] = (uint8)(min16 >> 8);
+		dest[4] = (uint8)(mask);
+		dest[5] = (uint8)(mask >> 8);
+		dest[6] = (uint8)(mask >> 16);
+		dest[7] = (uint8)(mask >> 24);
+	}
+
+	void encodeAlphaBlock(const uint8 *block, uint8 *dest)
+	{
+		int mn = 255, mx = 0;
+		for(int i=0; i<16; i++)
+		{
+			const int a = block[i*4+3];
+			if(a < mn) mn = a;
+			if(a > mx) mx = a;
+		}
+		dest[0] = (uint8)mx;
+		dest[1] = (uint8)mn;
+
+		// eight step ramp from max (index 0) over the six interpolants (2..7) to min (index 1).
+		uint64 bits = 0;
+		if(mx > mn)
+		{
+			const int range = mx - mn;
+			for(int i=0; i<16; i++)
+			{
+				const int step  = ((mx - block[i*4+3]) * 7 + range/2) / range;
+				const int index = step == 0 ? 0 : (step == 7 ? 1 : step + 1);
+				bits |= (uint64)index << (3*i);
+			}
+		}
+		for(int i=0; i<6; i++)
+		{
+			dest[2+i] = (uint8)(bits >> (8*i));
+		}
+	}
+
+	struct CompressJob
+	{
+		const uint8*			src;
+		uint32					width;
+		uint32					height;
+		uint32					pitch;
+		RenderTexture2D::Format	format;
+		uint8*					dest;
+		uint32					firstRow;	// block rows
+		uint32					lastRow;
+	};
+
+	void compressRows(const CompressJob &job)
+	{
+		const uint32 blockSize  = RenderTexture2D::getFormatBlockSize(job.format);
+		const uint32 blocksWide = RenderTexture2D::getFormatNumBlocks(job.width, job.format);
+
+		uint8 block[64];
+		for(uint32 by=job.firstRow; by<job.lastRow; by++)
+		{
+			uint8 *dest = job.dest + by * blocksWide * blockSize;
+			for(uint32 bx=0; bx<blocksWide; bx++)
+			{
+				// blocks hanging over the edge repeat the last row and column.
+				for(uint32 y=0; y<4; y++)
+				{
+					const uint32 sy = by*4+y < job.height ? by*4+y : job.height-1;
+					const uint8 *row = job.src + sy * job.pitch;
+					for(uint32 x=0; x<4; x++)
+					{
+						const uint32 sx = bx*4+x < job.width ? bx*4+x : job.width-1;
+						const uint8 *p = row + sx*4;
+						uint8 *q = block + (y*4+x)*4;
+						q[0] = p[2]; q[1] = p[1]; q[2] = p[0]; q[3] = p[3];
+					}
+				}
+				if(job.format == RenderTexture2D::FORMAT_DXT1) GearBlockCompressor::encodeBC1(block, dest);
+				else                                            GearBlockCompressor::encodeBC3(block, dest);
+				dest += blockSize;
+			}
+		}
+	}
+
+	DWORD WINAPI compressThread(LPVOID param)
+	{
+		compressRows(*(const CompressJob*)param);
+		return 0;
+	}
+}
+
+void GearBlockCompressor::encodeBC1(const uint8 *block, uint8 *dest)
+{
+	encodeColorBlock(block, dest);
+}
+
+void GearBlockCompressor::encodeBC3(const uint8 *block, uint8 *dest)
+{
+	encodeAlphaBlock(block, dest);
+	encodeColorBlock(block, dest+8);
+}
+
+bool GearBlockCompressor::compressImage(const uint8 *bgra, uint32 width, uint32 height, uint32 pitch,
+										RenderTexture2D::Format format, uint8 *dest, uint32 numThreads)
+{
+	ph_assert2(format == RenderTexture2D::FORMAT_DXT1 || format == RenderTexture2D::FORMAT_DXT5, "Unsupported block format.");
+	if(format != RenderTexture2D::FORMAT_DXT1 && format != RenderTexture2D::FORMAT_DXT5) return false;
+	if(!bgra || !dest || !width || !height) return false;
+
+	const uint32 numRows = RenderTexture2D::getFormatNumBlocks(height, format);
+	if(!numThreads) numThreads = getNumCores();
+	if(numThreads > numRows) numThreads = numRows;
+	if(numThreads > MAXIMUM_WAIT_OBJECTS) numThreads = MAXIMUM_WAIT_OBJECTS;
+
+	Array<CompressJob> jobs;
+	jobs.Reserve(numThreads);
+	for(uint32 i=0; i<numThreads; i++)
+	{
+		CompressJob job;
+		job.src      = bgra;
+		job.width    = width;
+		job.height   = height;
+		job.pitch    = pitch;
+		job.format   = format;
+		job.dest     = dest;
+		job.firstRow = numRows *  i    / numThreads;
+		job.lastRow  = numRows * (i+1) / numThreads;
+		jobs.Append(job);
+	}
+
+	// the calling thread takes the first slice itself.
+	Array<HANDLE> threads;
+	for(uint32 i=1; i<numThreads; i++)
+	{
+		HANDLE thread = CreateThread(0, 0, compressThread, &jobs[i], 0, 0);
+		if(thread) threads.Append(thread);
+		else       compressRows(jobs[i]);
+	}
+	compressRows(jobs[0]);
+
+	if(!threads.IsEmpty())
+	{
+		WaitForMultipleObjects((DWORD)threads.Size(), &threads[0], TRUE, INFINITE);
+		for(IndexT i=0; i<threads.Size(); i++) CloseHandle(threads[i]);
+	}
+	return true;
+}
+
+uint32 GearBlockCompressor::getNumCores(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? (uint32)info.dwNumberOfProcessors : 1;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,30 @@
+
+#pragma once
+
+#include "renderTexture2D.h"
+
+_NAMESPACE_BEGIN
+
+// CPU encoder for the DXT1 (BC1) and DXT5 (BC3) formats.
+// Colors are fitted along the principal axis of each block and refined with a least squares
+// solve over the chosen indices; the block with the smallest error wins. Index selection uses
+// SSE2 where the compiler targets it.
+class GearBlockCompressor
+{
+public:
+
+	// block is 16 pixels in R,G,B,A byte order, row major. writes 8 bytes.
+	static void		encodeBC1(const uint8 *block, uint8 *dest);
+
+	// writes 16 bytes, the alpha block followed by a BC1 color block.
+	static void		encodeBC3(const uint8 *block, uint8 *dest);
+
+	// compresses a B8G8R8A8 image into rows of blocks as laid out in DDS files.
+	// block rows are spread over numThreads threads, 0 uses one per core.
+	static bool		compressImage(const uint8 *bgra, uint32 width, uint32 height, uint32 pitch,
+								  RenderTexture2D::Format format, uint8 *dest, uint32 numThreads = 0);
+
+	static uint32	getNumCores(void);
+};
+
+_NAMESPACE_END
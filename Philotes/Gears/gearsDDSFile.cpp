@@ -0,0 +1,379 @@
+
+#include "gearsDDSFile.h"
+
+#include <io.h>
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	const uint32 DDS_MAGIC			= 0x20534444; // "DDS "
+
+	const uint32 DDSF_CAPS			= 0x00000001;
+	const uint32 DDSF_HEIGHT		= 0x00000002;
+	const uint32 DDSF_WIDTH			= 0x00000004;
+	const uint32 DDSF_PITCH			= 0x00000008;
+	const uint32 DDSF_PIXELFORMAT	= 0x00001000;
+	const uint32 DDSF_LINEARSIZE	= 0x00080000;
+	const uint32 DDSF_MIPMAPCOUNT	= 0x00020000;
+	const uint32 DDSF_ALPHA			= 0x00000002;
+	const uint32 DDSF_FOURCC		= 0x00000004;
+	const uint32 DDSF_RGB			= 0x00000040;
+	const uint32 DDSF_RGBA			= 0x00000041;
+	const uint32 DDSF_LUMINANCE		= 0x00020000;
+	const uint32 DDSF_CUBEMAP		= 0x00000200;
+	const uint32 DDSF_VOLUME		= 0x00200000;
+
+	const uint32 DDSF_COMPLEX		= 0x00000008;
+	const uint32 DDSF_TEXTURE		= 0x00001000;
+	const uint32 DDSF_MIPMAP		= 0x00400000;
+
+	const uint32 FOURCC_DXT1		= 0x31545844;
+	const uint32 FOURCC_DXT3		= 0x33545844;
+	const uint32 FOURCC_DXT5		= 0x35545844;
+
+	// larger than any texture the device accepts, rejects headers with garbage sizes.
+	const uint32 DDS_MAX_DIMENSION	= 16384;
+
+	struct DDSPixelFormat
+	{
+		uint32	size;
+		uint32	flags;
+		uint32	fourCC;
+		uint32	rgbBitCount;
+		uint32	rBitMask;
+		uint32	gBitMask;
+		uint32	bBitMask;
+		uint32	aBitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32			size;
+		uint32			flags;
+		uint32			height;
+		uint32			width;
+		uint32			pitchOrLinearSize;
+		uint32			depth;
+		uint32			mipMapCount;
+		uint32			reserved1[11];
+		DDSPixelFormat	pixelFormat;
+		uint32			caps1;
+		uint32			caps2;
+		uint32			reserved2[3];
+	};
+}
+
+GearDDSFile::GearDDSFile(void)
+{
+	m_mapping	= 0;
+	m_data		= 0;
+	m_buffer	= 0;
+	m_size		= 0;
+	m_format	= RenderTexture2D::NUM_FORMATS;
+	m_width		= 0;
+	m_height	= 0;
+	m_numLevels	= 0;
+	m_numFaces	= 0;
+}
+
+GearDDSFile::~GearDDSFile(void)
+{
+	close();
+}
+
+bool GearDDSFile::open(FILE &file)
+{
+	close();
+
+	HANDLE fileHandle = (HANDLE)_get_osfhandle(_fileno(&file));
+	if(fileHandle != INVALID_HANDLE_VALUE && mapHandle(fileHandle))
+	{
+		return parse();
+	}
+
+	fseek(&file, 0, SEEK_END);
+	long fileLen = ftell(&file);
+	fseek(&file, 0, SEEK_SET);
+	if(fileLen <= 0) return false;
+
+	m_buffer = ph_new_array(uint8, fileLen);
+	m_data   = m_buffer;
+	m_size   = (uint32)fread(m_buffer, 1, fileLen, &file);
+	if(m_size != (uint32)fileLen)
+	{
+		close();
+		return false;
+	}
+	return parse();
+}
+
+bool GearDDSFile::open(const String& path)
+{
+	close();
+
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if(fileHandle == INVALID_HANDLE_VALUE) return false;
+
+	// the mapping keeps its own reference to the file.
+	bool ok = mapHandle(fileHandle);
+	CloseHandle(fileHandle);
+	return ok && parse();
+}
+
+void GearDDSFile::close(void)
+{
+	if(m_mapping)
+	{
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+	}
+	if(m_buffer)
+	{
+		ph_delete_array(m_buffer);
+	}
+	m_mapping	= 0;
+	m_data		= 0;
+	m_buffer	= 0;
+	m_size		= 0;
+	m_numLevels	= 0;
+	m_numFaces	= 0;
+	m_surfaces.Clear();
+}
+
+bool GearDDSFile::mapHandle(HANDLE fileHandle)
+{
+	DWORD sizeHigh = 0;
+	DWORD sizeLow  = GetFileSize(fileHandle, &sizeHigh);
+	if(sizeLow == INVALID_FILE_SIZE || sizeHigh != 0 || sizeLow == 0) return false;
+
+	m_mapping = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	if(!m_mapping) return false;
+
+	m_data = (const uint8*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!m_data)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = 0;
+		return false;
+	}
+	m_size = sizeLow;
+	return true;
+}
+
+bool GearDDSFile::parse(void)
+{
+	if(m_size < sizeof(uint32) + sizeof(DDSHeader) || *(const uint32*)m_data != DDS_MAGIC)
+	{
+		close();
+		return false;
+	}
+
+	const DDSHeader &header = *(const DDSHeader*)(m_data + sizeof(uint32));
+	const DDSPixelFormat &pf = header.pixelFormat;
+
+	m_format = RenderTexture2D::NUM_FORMATS;
+	if(pf.flags & DDSF_FOURCC)
+	{
+		switch(pf.fourCC)
+		{
+		case FOURCC_DXT1: m_format = RenderTexture2D::FORMAT_DXT1; break;
+		case FOURCC_DXT3: m_format = RenderTexture2D::FORMAT_DXT3; break;
+		case FOURCC_DXT5: m_format = RenderTexture2D::FORMAT_DXT5; break;
+		}
+	}
+	else if((pf.flags == DDSF_RGBA || pf.flags == DDSF_RGB) && pf.rgbBitCount == 32)
+	{
+		m_format = RenderTexture2D::FORMAT_B8G8R8A8;
+	}
+	else if(pf.rgbBitCount == 8)
+	{
+		m_format = (pf.flags & DDSF_LUMINANCE) || !pf.aBitMask ? RenderTexture2D::FORMAT_L8 : RenderTexture2D::FORMAT_A8;
+	}
+
+	// volume textures and formats the renderer can't sample are rejected.
+	if(m_format == RenderTexture2D::NUM_FORMATS || ((header.caps2 & DDSF_VOLUME) && header.depth > 1))
+	{
+		close();
+		return false;
+	}
+
+	m_width		= header.width;
+	m_height	= header.height;
+	m_numLevels	= ((header.flags & DDSF_MIPMAPCOUNT) && header.mipMapCount) ? header.mipMapCount : 1;
+	m_numFaces	= (header.caps2 & DDSF_CUBEMAP) ? 6 : 1;
+	if(!m_width || !m_height || m_width > DDS_MAX_DIMENSION || m_height > DDS_MAX_DIMENSION)
+	{
+		close();
+		return false;
+	}
+
+	// no more levels than down to 1x1.
+	uint32 maxLevels = 1;
+	for(uint32 dimension = m_width > m_height ? m_width : m_height; dimension > 1; dimension >>= 1)
+	{
+		maxLevels++;
+	}
+	if(m_numLevels > maxLevels)
+	{
+		m_numLevels = maxLevels;
+	}
+
+	const uint32 blockSize = RenderTexture2D::getFormatBlockSize(m_format);
+	uint32 offset = sizeof(uint32) + sizeof(DDSHeader);
+	m_surfaces.Reserve(m_numFaces * m_numLevels);
+	for(uint32 face=0; face<m_numFaces; face++)
+	{
+		for(uint32 level=0; level<m_numLevels; level++)
+		{
+			Surface surface;
+			surface.width	= RenderTexture2D::getLevelDimension(m_width,  level);
+			surface.height	= RenderTexture2D::getLevelDimension(m_height, level);
+			surface.rowSize	= RenderTexture2D::getFormatNumBlocks(surface.width, m_format) * blockSize;
+			surface.numRows	= RenderTexture2D::getFormatNumBlocks(surface.height, m_format);
+			surface.size	= surface.rowSize * surface.numRows;
+			surface.data	= m_data + offset;
+			if(surface.size > m_size - offset)
+			{
+				// truncated file, keep the levels that are complete.
+				if(face == 0 && level > 0)
+				{
+					m_numLevels = level;
+					m_numFaces  = 1;
+					return true;
+				}
+				close();
+				return false;
+			}
+			offset += surface.size;
+			m_surfaces.Append(surface);
+		}
+	}
+	return true;
+}
+
+const GearDDSFile::Surface& GearDDSFile::getSurface(uint32 face, uint32 level) const
+{
+	ph_assert(face < m_numFaces && level < m_numLevels);
+	return m_surfaces[face * m_numLevels + level];
+}
+
+bool GearDDSFile::upload(RenderTexture2D &texture, uint32 firstLevel) const
+{
+	bool ok = true;
+	for(uint32 level=firstLevel; level<m_numLevels && level-firstLevel<texture.getNumLevels(); level++)
+	{
+		ok = uploadLevel(texture, level-firstLevel, 0, level) && ok;
+	}
+	return ok;
+}
+
+bool GearDDSFile::uploadLevel(RenderTexture2D &texture, uint32 textureLevel, uint32 face, uint32 level) const
+{
+	return uploadSurface(texture, textureLevel, getSurface(face, level));
+}
+
+bool GearDDSFile::uploadSurface(RenderTexture2D &texture, uint32 textureLevel, const Surface &surface)
+{
+	uint32 pitch = 0;
+	uint8 *dst = (uint8*)texture.lockLevel(textureLevel, pitch);
+	ph_assert(dst);
+	if(!dst) return false;
+
+	ph_assert(surface.rowSize <= pitch);
+	if(pitch == surface.rowSize)
+	{
+		memcpy(dst, surface.data, surface.size);
+	}
+	else
+	{
+		const uint8 *src = surface.data;
+		for(uint32 row=0; row<surface.numRows; row++)
+		{
+			memcpy(dst, src, surface.rowSize);
+			dst += pitch;
+			src += surface.rowSize;
+		}
+	}
+	texture.unlockLevel(textureLevel);
+	return true;
+}
+
+bool GearDDSFile::write(const String& path, RenderTexture2D::Format format, const Array<Surface> &levels)
+{
+	if(levels.IsEmpty()) return false;
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(header));
+	header.size					= sizeof(DDSHeader);
+	header.flags				= DDSF_CAPS|DDSF_HEIGHT|DDSF_WIDTH|DDSF_PIXELFORMAT;
+	header.width				= levels[0].width;
+	header.height				= levels[0].height;
+	// compressed formats store the size of the top level, the others the bytes of one row of pixels.
+	if(RenderTexture2D::isCompressedFormat(format))
+	{
+		header.flags			   |= DDSF_LINEARSIZE;
+		header.pitchOrLinearSize	= levels[0].size;
+	}
+	else
+	{
+		header.flags			   |= DDSF_PITCH;
+		header.pitchOrLinearSize	= levels[0].width * RenderTexture2D::getFormatBlockSize(format);
+	}
+	header.caps1				= DDSF_TEXTURE;
+	if(levels.Size() > 1)
+	{
+		header.flags		|= DDSF_MIPMAPCOUNT;
+		header.mipMapCount	 = (uint32)levels.Size();
+		header.caps1		|= DDSF_COMPLEX|DDSF_MIPMAP;
+	}
+
+	DDSPixelFormat &pf = header.pixelFormat;
+	pf.size = sizeof(DDSPixelFormat);
+	switch(format)
+	{
+	case RenderTexture2D::FORMAT_DXT1: pf.flags = DDSF_FOURCC; pf.fourCC = FOURCC_DXT1; break;
+	case RenderTexture2D::FORMAT_DXT3: pf.flags = DDSF_FOURCC; pf.fourCC = FOURCC_DXT3; break;
+	case RenderTexture2D::FORMAT_DXT5: pf.flags = DDSF_FOURCC; pf.fourCC = FOURCC_DXT5; break;
+	case RenderTexture2D::FORMAT_B8G8R8A8:
+		pf.flags		= DDSF_RGBA;
+		pf.rgbBitCount	= 32;
+		pf.rBitMask		= 0x00ff0000;
+		pf.gBitMask		= 0x0000ff00;
+		pf.bBitMask		= 0x000000ff;
+		pf.aBitMask		= 0xff000000;
+		break;
+	case RenderTexture2D::FORMAT_L8: pf.flags = DDSF_LUMINANCE; pf.rgbBitCount = 8; pf.rBitMask = 0xff; break;
+	case RenderTexture2D::FORMAT_A8: pf.flags = DDSF_ALPHA;     pf.rgbBitCount = 8; pf.aBitMask = 0xff; break;
+	default:
+		ph_assert2(0, "Format can't be stored in a DDS file.");
+		return false;
+	}
+
+	// write next to the target and swap it in, readers never see a partial file.
+	String tempPath = path;
+	tempPath.Append(".tmp");
+	FILE *file = fopen(tempPath.c_str(), "wb");
+	if(!file) return false;
+
+	bool ok = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, file) == 1;
+	ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+	for(IndexT i=0; ok && i<levels.Size(); i++)
+	{
+		ok = fwrite(levels[i].data, 1, levels[i].size, file) == levels[i].size;
+	}
+	fclose(file);
+
+	if(ok)
+	{
+		remove(path.c_str());
+		ok = rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+	if(!ok)
+	{
+		remove(tempPath.c_str());
+	}
+	return ok;
+}
+
+_NAMESPACE_END
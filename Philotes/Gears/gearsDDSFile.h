@@ -0,0 +1,94 @@
+
+#pragma once
+
+#include "renderTexture2D.h"
+
+_NAMESPACE_BEGIN
+
+// Read-only view of a DDS file. The file is memory mapped and the header is parsed in place,
+// surfaces point straight into the mapped pages so nothing is copied until the upload.
+class GearDDSFile
+{
+public:
+
+	struct Surface
+	{
+		const uint8*	data;
+		uint32			size;		// bytes of the whole surface
+		uint32			width;		// in pixels
+		uint32			height;
+		uint32			rowSize;	// bytes of one row of blocks (or pixels for uncompressed formats)
+		uint32			numRows;
+	};
+
+public:
+
+	GearDDSFile(void);
+
+	~GearDDSFile(void);
+
+	// maps the file behind the stream, falls back to reading it into memory if mapping isn't possible.
+	bool						open(FILE &file);
+
+	bool						open(const String& path);
+
+	void						close(void);
+
+	bool						isOpen(void) const			{ return m_data != 0; }
+
+	RenderTexture2D::Format		getFormat(void) const		{ return m_format; }
+
+	uint32						getWidth(void) const		{ return m_width; }
+
+	uint32						getHeight(void) const		{ return m_height; }
+
+	uint32						getNumLevels(void) const	{ return m_numLevels; }
+
+	uint32						getNumFaces(void) const		{ return m_numFaces; }
+
+	const Surface&				getSurface(uint32 face, uint32 level) const;
+
+	// copies levels [firstLevel, getNumLevels()) of face 0 into the texture, starting at its level 0.
+	bool						upload(RenderTexture2D &texture, uint32 firstLevel) const;
+
+	// copies a single surface into a locked level of the texture.
+	bool						uploadLevel(RenderTexture2D &texture, uint32 textureLevel, uint32 face, uint32 level) const;
+
+	// copies a surface that may live outside of any file, e.g. one staged by the texture streamer.
+	static bool					uploadSurface(RenderTexture2D &texture, uint32 textureLevel, const Surface &surface);
+
+	// writes a 2D texture with the given mip chain, levels[0] being the top level.
+	static bool					write(const String& path, RenderTexture2D::Format format, const Array<Surface> &levels);
+
+private:
+
+	bool						mapHandle(HANDLE fileHandle);
+
+	bool						parse(void);
+
+	GearDDSFile &operator=(const GearDDSFile&) { return *this; }
+
+private:
+
+	HANDLE						m_mapping;
+
+	const uint8*				m_data;
+
+	uint8*						m_buffer;		// only used when the file couldn't be mapped
+
+	uint32						m_size;
+
+	RenderTexture2D::Format		m_format;
+
+	uint32						m_width;
+
+	uint32						m_height;
+
+	uint32						m_numLevels;
+
+	uint32						m_numFaces;
+
+	Array<Surface>				m_surfaces;		// face major
+};
+
+_NAMESPACE_END
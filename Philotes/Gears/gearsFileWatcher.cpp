@@ -0,0 +1,190 @@
+
+#include "gearsFileWatcher.h"
+
+_NAMESPACE_BEGIN
+
+// a change is reported after the file has not been touched for this many milliseconds.
+static const DWORD FILE_WATCH_SETTLE_TIME = 250;
+
+GearFileWatcher::GearFileWatcher(void)
+{
+}
+
+GearFileWatcher::~GearFileWatcher(void)
+{
+	removeAll();
+}
+
+bool GearFileWatcher::addDirectory(const String& dir)
+{
+	Watch *watch = new Watch;
+	watch->dir    = normalizePath(dir);
+	watch->handle = CreateFileA(dir.c_str(), FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, 0, OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OVERLAPPED, 0);
+	memset(&watch->overlapped, 0, sizeof(watch->overlapped));
+	watch->reading = false;
+
+	if(watch->handle == INVALID_HANDLE_VALUE || !issueRead(*watch))
+	{
+		if(watch->handle != INVALID_HANDLE_VALUE) CloseHandle(watch->handle);
+		delete watch;
+		return false;
+	}
+
+	if(watch->dir.IsValid() && watch->dir[watch->dir.Length()-1] != '/')
+	{
+		watch->dir.Append("/");
+	}
+	m_watches.Append(watch);
+	return true;
+}
+
+void GearFileWatcher::removeAll(void)
+{
+	for(IndexT i=0; i<m_watches.Size(); i++)
+	{
+		Watch *watch = m_watches[i];
+		CancelIo(watch->handle);
+		CloseHandle(watch->handle);
+		delete watch;
+	}
+	m_watches.Clear();
+	m_pending.Clear();
+}
+
+void GearFileWatcher::poll(StringArray& changedFiles)
+{
+	for(IndexT i=0; i<m_watches.Size(); i++)
+	{
+		Watch &watch = *m_watches[i];
+		if(!watch.reading)
+		{
+			// the last read could not be issued, whatever changed in between is lost
+			if(issueRead(watch)) rescan(watch, "reading again");
+			continue;
+		}
+
+		DWORD numBytes = 0;
+		if(GetOverlappedResult(watch.handle, &watch.overlapped, &numBytes, FALSE))
+		{
+			readChanges(watch, numBytes);
+		}
+		else if(GetLastError() == ERROR_IO_INCOMPLETE)
+		{
+			continue;
+		}
+		else
+		{
+			rescan(watch, "read failed");
+		}
+		if(!issueRead(watch)) rescan(watch, "could not read");
+	}
+
+	const DWORD now = GetTickCount();
+	for(IndexT i=m_pending.Size()-1; i>=0; i--)
+	{
+		if(now - m_pending.ValueAtIndex(i) >= FILE_WATCH_SETTLE_TIME)
+		{
+			changedFiles.Append(m_pending.KeyAtIndex(i));
+			m_pending.EraseAtIndex(i);
+		}
+	}
+}
+
+bool GearFileWatcher::issueRead(Watch& watch)
+{
+	const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_FILE_NAME|FILE_NOTIFY_CHANGE_SIZE;
+	watch.reading = ReadDirectoryChangesW(watch.handle, watch.buffer, sizeof(watch.buffer), TRUE,
+		filter, 0, &watch.overlapped, 0) ? true : false;
+	return watch.reading;
+}
+
+void GearFileWatcher::readChanges(Watch& watch, DWORD numBytes)
+{
+	// zero bytes means the buffer overflowed and the individual changes are lost.
+	if(numBytes == 0)
+	{
+		rescan(watch, "buffer overflowed");
+		return;
+	}
+
+	const DWORD now = GetTickCount();
+
+	const uint8 *cursor = (const uint8*)watch.buffer;
+	for(;;)
+	{
+		const FILE_NOTIFY_INFORMATION &info = *(const FILE_NOTIFY_INFORMATION*)cursor;
+		if(info.Action != FILE_ACTION_REMOVED && info.Action != FILE_ACTION_RENAMED_OLD_NAME)
+		{
+			char name[MAX_PATH];
+			int len = WideCharToMultiByte(CP_ACP, 0, info.FileName, (int)(info.FileNameLength/sizeof(WCHAR)),
+				name, MAX_PATH-1, 0, 0);
+			if(len > 0)
+			{
+				name[len] = 0;
+				String path = watch.dir;
+				path.Append(name);
+				path.ConvertBackslashes();
+				path.ToLower();
+
+				bool ignored = false;
+				for(IndexT i=0; !ignored && i<m_ignoredSuffixes.Size(); i++)
+				{
+					ignored = String::EndsWith(path, m_ignoredSuffixes[i]);
+				}
+				if(!ignored) markChanged(path, now);
+			}
+		}
+		if(info.NextEntryOffset == 0) break;
+		cursor += info.NextEntryOffset;
+	}
+}
+
+void GearFileWatcher::rescan(Watch& watch, const char* reason)
+{
+	// the whole directory is reported so that everything below it gets checked.
+	ph_printf("File watcher lost changes in %s (%s), rescanning it\n", watch.dir.c_str(), reason);
+	markChanged(watch.dir, GetTickCount());
+}
+
+void GearFileWatcher::addIgnoredSuffix(const String& suffix)
+{
+	String lower = suffix;
+	lower.ToLower();
+	if(m_ignoredSuffixes.FindIndex(lower) == InvalidIndex) m_ignoredSuffixes.Append(lower);
+}
+
+void GearFileWatcher::markChanged(const String& path, DWORD now)
+{
+	IndexT index = m_pending.FindIndex(path);
+	if(index == InvalidIndex) m_pending.Add(path, now);
+	else                      m_pending.ValueAtIndex(index) = now;
+}
+
+bool GearFileWatcher::isChanged(const StringArray& changedFiles, const String& path)
+{
+	for(IndexT i=0; i<changedFiles.Size(); i++)
+	{
+		const String &changed = changedFiles[i];
+		if(changed == path) return true;
+		if(changed.Length() > 0 && changed[changed.Length()-1] == '/' &&
+		   !strncmp(changed.c_str(), path.c_str(), changed.Length()))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+String GearFileWatcher::normalizePath(const String& path)
+{
+	char fullPath[MAX_PATH];
+	DWORD len = GetFullPathNameA(path.c_str(), MAX_PATH, fullPath, 0);
+	String result = (len > 0 && len < MAX_PATH) ? String(fullPath) : path;
+	result.ConvertBackslashes();
+	result.ToLower();
+	return result;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,66 @@
+
+#pragma once
+
+_NAMESPACE_BEGIN
+
+// Watches directory trees for modified files without blocking the caller.
+// Changes are reported once a file has been quiet for a short while, so editors that
+// save in several steps (truncate, write, rename) produce a single notification.
+class GearFileWatcher
+{
+public:
+
+	GearFileWatcher(void);
+
+	~GearFileWatcher(void);
+
+	// starts watching the directory and all its sub directories.
+	bool				addDirectory(const String& dir);
+
+	void				removeAll(void);
+
+	// files whose name ends in suffix are never reported, e.g. files the application generates itself.
+	void				addIgnoredSuffix(const String& suffix);
+
+	// collects the files that changed since the last call, as normalized full paths.
+	// a directory, ending in '/', is reported when its changes were lost and anything below it may have changed.
+	void				poll(StringArray& changedFiles);
+
+	// true if path is one of the changed files or lies below one of the changed directories.
+	static bool			isChanged(const StringArray& changedFiles, const String& path);
+
+	// full path, forward slashes, lower case; used to compare paths from different sources.
+	static String		normalizePath(const String& path);
+
+private:
+
+	struct Watch
+	{
+		String			dir;
+		HANDLE			handle;
+		OVERLAPPED		overlapped;
+		bool			reading;		// a read is pending on overlapped
+		DWORD			buffer[4096];
+	};
+
+	bool				issueRead(Watch& watch);
+
+	void				readChanges(Watch& watch, DWORD numBytes);
+
+	// the changes of the watch are lost, its whole directory is reported.
+	void				rescan(Watch& watch, const char* reason);
+
+	void				markChanged(const String& path, DWORD now);
+
+	GearFileWatcher &operator=(const GearFileWatcher&) { return *this; }
+
+private:
+
+	Array<Watch*>				m_watches;
+
+	Dictionary<String, DWORD>	m_pending;		// path -> tick of the last change
+
+	StringArray					m_ignoredSuffixes;	// lower case
+};
+
+_NAMESPACE_END
@@ -46,15 +46,8 @@ static void readFloats(const char *str, float *floats, unsigned int numFloats)
 
 //////////////////////////////////////////////////////////////////////////
 
-GearMaterialAsset::GearMaterialAsset(GearAssetManager &assetManager, rapidxml::xml_node<char> &xmlroot, const String& path) :
-	GearAsset(ASSET_MATERIAL, path),
-m_assetManager(assetManager)
+static void parseMaterialDesc(rapidxml::xml_node<char> &xmlroot, RenderMaterialDesc &matdesc, std::vector<const char*> &vertexShaderPaths)
 {
-	std::vector<const char*> vertexShaderPaths;
-
-	Render &renderer = *GearApplication::getApp()->getRender();
-
-	RenderMaterialDesc matdesc;
 	const char *materialTypeName = getXMLAttribute(xmlroot, "type");
 	if(materialTypeName && !strcmp(materialTypeName, "lit"))
 	{
@@ -112,6 +105,20 @@ m_assetManager(assetManager)
 			}
 		}
 	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+GearMaterialAsset::GearMaterialAsset(GearAssetManager &assetManager, rapidxml::xml_node<char> &xmlroot, const String& path) :
+	GearAsset(ASSET_MATERIAL, path),
+m_assetManager(assetManager)
+{
+	std::vector<const char*> vertexShaderPaths;
+
+	Render &renderer = *GearApplication::getApp()->getRender();
+
+	RenderMaterialDesc matdesc;
+	parseMaterialDesc(xmlroot, matdesc, vertexShaderPaths);
 
 	for (size_t materialIndex = 0; materialIndex < vertexShaderPaths.size(); materialIndex++)
 	{
@@ -130,68 +137,171 @@ m_assetManager(assetManager)
 		ph_assert(materialStruct.m_material);
 		if(materialStruct.m_material)
 		{
-			rapidxml::xml_node<char> *varsnode = xmlroot.first_node("variables");
-			if(varsnode)
+			loadVariables(xmlroot, materialStruct);
+
+			m_vertexShaders.Append(materialStruct);
+		}
+	}
+
+	collectShaderDependencies();
+}
+
+void GearMaterialAsset::loadVariables(rapidxml::xml_node<char> &xmlroot, MaterialStruct &materialStruct)
+{
+	rapidxml::xml_node<char> *varsnode = xmlroot.first_node("variables");
+	if(varsnode)
+	{
+		if(!materialStruct.m_materialInstance)
+		{
+			materialStruct.m_materialInstance = new RenderMaterialInstance(*materialStruct.m_material);
+		}
+		for(rapidxml::xml_node<char> *child=varsnode->first_node(); child; child=child->next_sibling())
+		{
+			const char *nodename = child->name();
+			const char *varname  = getXMLAttribute(*child, "name");
+			const char *value    = child->value();
+
+			if(!strcmp(nodename, "float"))
+			{
+				float f = (float)atof(value);
+				const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT);
+				ph_assert(var);
+				if(var) materialStruct.m_materialInstance->writeData(*var, &f);
+			}
+			else if(!strcmp(nodename, "float2"))
+			{
+				float f[2];
+				readFloats(value, f, 2);
+				const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT2);
+				ph_assert(var);
+				if(var) materialStruct.m_materialInstance->writeData(*var, f);
+			}
+			else if(!strcmp(nodename, "float3"))
 			{
-				materialStruct.m_materialInstance = new RenderMaterialInstance(*materialStruct.m_material);
-				for(rapidxml::xml_node<char> *child=varsnode->first_node(); child; child=child->next_sibling())
+				float f[3];
+				readFloats(value, f, 3);
+				const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT3);
+				ph_assert(var);
+				if(var) materialStruct.m_materialInstance->writeData(*var, f);
+			}
+			else if(!strcmp(nodename, "float4"))
+			{
+				float f[4];
+				readFloats(value, f, 4);
+				const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT4);
+				ph_assert(var);
+				if(var) materialStruct.m_materialInstance->writeData(*var, f);
+			}
+			else if(!strcmp(nodename, "sampler2D"))
+			{
+				GearTextureAsset *textureAsset = static_cast<GearTextureAsset*>(m_assetManager.getAsset(value, ASSET_TEXTURE));
+				ph_assert(textureAsset);
+				if(textureAsset)
 				{
-					const char *nodename = child->name();
-					const char *varname  = getXMLAttribute(*child, "name");
-					const char *value    = child->value();
-
-					if(!strcmp(nodename, "float"))
+					m_assets.Append(textureAsset);
+					const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_SAMPLER2D);
+					ph_assert(var);
+					if(var)
 					{
-						float f = (float)atof(value);
-						const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT);
-						ph_assert(var);
-						if(var) materialStruct.m_materialInstance->writeData(*var, &f);
-					}
-					else if(!strcmp(nodename, "float2"))
-					{
-						float f[2];
-						readFloats(value, f, 2);
-						const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT2);
-						ph_assert(var);
-						if(var) materialStruct.m_materialInstance->writeData(*var, f);
-					}
-					else if(!strcmp(nodename, "float3"))
-					{
-						float f[3];
-						readFloats(value, f, 3);
-						const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT3);
-						ph_assert(var);
-						if(var) materialStruct.m_materialInstance->writeData(*var, f);
-					}
-					else if(!strcmp(nodename, "float4"))
-					{
-						float f[4];
-						readFloats(value, f, 4);
-						const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_FLOAT4);
-						ph_assert(var);
-						if(var) materialStruct.m_materialInstance->writeData(*var, f);
-					}
-					else if(!strcmp(nodename, "sampler2D"))
-					{
-						GearTextureAsset *textureAsset = static_cast<GearTextureAsset*>(assetManager.getAsset(value, ASSET_TEXTURE));
-						ph_assert(textureAsset);
-						if(textureAsset)
-						{
-							m_assets.Append(textureAsset);
-							const RenderMaterial::Variable *var = materialStruct.m_materialInstance->findVariable(varname, RenderMaterial::VARIABLE_SAMPLER2D);
-							ph_assert(var);
-							if(var)
-							{
- 								RenderTexture2D *texture = textureAsset->getTexture();
-								materialStruct.m_materialInstance->writeData(*var, &texture);
-							}
-						}
+ 						RenderTexture2D *texture = textureAsset->getTexture();
+						materialStruct.m_materialInstance->writeData(*var, &texture);
+
+						SamplerBinding binding;
+						binding.m_instance = materialStruct.m_materialInstance;
+						binding.m_variable = var;
+						binding.m_texture  = textureAsset;
+						m_samplers.Append(binding);
 					}
+				}
+			}
+
+		}
+	}
+}
+
+void GearMaterialAsset::collectShaderDependencies(void)
+{
+	clearDependencies();
+	for(SizeT index = 0; index < m_vertexShaders.Size(); index++)
+	{
+		const StringArray &files = m_vertexShaders[index].m_material->getShaderDependencies();
+		for(SizeT i = 0; i < files.Size(); i++)
+		{
+			addDependency(files[i]);
+		}
+	}
+}
+
+bool GearMaterialAsset::reload(FILE &file)
+{
+	fseek(&file, 0, SEEK_END);
+	size_t filelen = ftell(&file);
+	fseek(&file, 0, SEEK_SET);
+	char *filedata = new char[filelen+1];
+	filelen = fread(filedata, 1, filelen, &file);
+	filedata[filelen] = 0;
+
+	bool ok = false;
+	rapidxml::xml_document<char>* xmldoc = new rapidxml::xml_document<char>;
+	xmldoc->parse<0>(filedata);
+	rapidxml::xml_node<char> *rootnode = xmldoc->first_node();
+	if(rootnode && !strcmp(rootnode->name(), "material"))
+	{
+		std::vector<const char*> vertexShaderPaths;
+		RenderMaterialDesc matdesc;
+		parseMaterialDesc(*rootnode, matdesc, vertexShaderPaths);
+
+		// keep the old textures referenced until the new ones are acquired, unchanged ones are not reloaded.
+		AssetArray oldAssets = m_assets;
+		m_assets.Clear();
+		m_samplers.Clear();
 
+		Render &renderer = *GearApplication::getApp()->getRender();
+		ok = true;
+		for(size_t materialIndex = 0; materialIndex < vertexShaderPaths.size(); materialIndex++)
+		{
+			matdesc.vertexShaderPath = vertexShaderPaths[materialIndex];
+			if(materialIndex < (size_t)m_vertexShaders.Size())
+			{
+				MaterialStruct &materialStruct = m_vertexShaders[(IndexT)materialIndex];
+				ok = materialStruct.m_material->reload(matdesc) && ok;
+				loadVariables(*rootnode, materialStruct);
+			}
+			else
+			{
+				MaterialStruct materialStruct;
+				materialStruct.m_materialInstance = NULL;
+				materialStruct.m_maxBones = strstr(vertexShaderPaths[materialIndex], "skeletalmesh") ? RENDERER_MAX_BONES : 0;
+				materialStruct.m_material = renderer.createMaterial(matdesc);
+				if(materialStruct.m_material)
+				{
+					loadVariables(*rootnode, materialStruct);
+					m_vertexShaders.Append(materialStruct);
 				}
 			}
+		}
+		// vertex shaders removed from the file stay alive, their materials may still be referenced.
 
-			m_vertexShaders.Append(materialStruct);
+		for(SizeT i = 0; i < oldAssets.Size(); i++)
+		{
+			m_assetManager.returnAsset(*oldAssets[i]);
+		}
+		collectShaderDependencies();
+	}
+	delete xmldoc;
+	delete [] filedata;
+	return ok;
+}
+
+void GearMaterialAsset::onAssetReloaded(const GearAsset &asset)
+{
+	for(SizeT i = 0; i < m_samplers.Size(); i++)
+	{
+		const SamplerBinding &binding = m_samplers[i];
+		if(binding.m_texture == &asset)
+		{
+			RenderTexture2D *texture = binding.m_texture->getTexture();
+			binding.m_instance->writeData(*binding.m_variable, &texture);
 		}
 	}
 }
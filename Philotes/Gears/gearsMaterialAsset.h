@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gearsAsset.h"
+#include "renderMaterial.h"
 
 namespace rapidxml
 {
@@ -41,9 +42,11 @@ public:
 
 	static GearMaterialAsset*	getPrefabAsset(PrefabMaterial type);
 
-private:
+	virtual bool				reload(FILE &file);
 
-	GearAssetManager			&m_assetManager;
+	virtual void				onAssetReloaded(const GearAsset &asset);
+
+private:
 
 	struct MaterialStruct
 	{
@@ -52,9 +55,27 @@ private:
 		unsigned int			m_maxBones;
 	};
 
+	// a sampler variable and the texture asset written into it.
+	struct SamplerBinding
+	{
+		RenderMaterialInstance			*m_instance;
+		const RenderMaterial::Variable	*m_variable;
+		GearTextureAsset				*m_texture;
+	};
+
+	void						loadVariables(rapidxml::xml_node<char> &xmlroot, MaterialStruct &materialStruct);
+
+	void						collectShaderDependencies(void);
+
+private:
+
+	GearAssetManager			&m_assetManager;
+
 	Array<MaterialStruct>		m_vertexShaders;
 
 	Array<GearAsset*>			m_assets;
+
+	Array<SamplerBinding>		m_samplers;
 };
 
 _NAMESPACE_END
\ No newline at end of file
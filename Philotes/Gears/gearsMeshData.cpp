@@ -3,6 +3,8 @@
 
 _NAMESPACE_BEGIN
 
+PH_IMPLEMENT_POOL_ALLOC(MeshAnimTrack)
+
 MeshVertex::MeshVertex( void )
 {
 	mPos	= Vector3::ZERO;
@@ -45,6 +45,8 @@ enum MeshSerializeFormat
 
 class MeshVertex 
 {
+	PH_DECLARE_HEAP_ALLOC(Memory::GearsHeap)
+
 public:
 	MeshVertex(void);
 
@@ -190,6 +192,8 @@ public:
 
 class MeshAnimPose 
 {
+	PH_DECLARE_HEAP_ALLOC(Memory::GearsHeap)
+
 public:
 	MeshAnimPose(void);
 
@@ -210,6 +214,8 @@ public:
 
 class MeshAnimTrack 
 {
+	PH_DECLARE_POOL_ALLOC(MeshAnimTrack, Memory::GearsHeap, 64)
+
 public:
 
 	MeshAnimTrack(void);
@@ -1,5 +1,6 @@
 
 #include "gearsMeshSerial.h"
+#include "math/mathBatch.h"
 
 _NAMESPACE_BEGIN
 
@@ -26,7 +27,7 @@ GearsMeshBuilder::GearsMeshBuilder( MeshImportApplicationResource *appResource )
 
 GearsMeshBuilder::~GearsMeshBuilder( void )
 {
-	free(mMeshes);
+	ph_free(Memory::GearsHeap, mMeshes);
 	GearMeshVector::Iterator i;
 	for (i=mMyMeshes.Begin(); i!=mMyMeshes.End(); ++i)
 	{
@@ -46,7 +47,7 @@ GearsMeshBuilder::~GearsMeshBuilder( void )
 				delete []ma->mPose;
 				delete ma;
 			}
-			free(a->mTracks);
+			ph_free(Memory::GearsHeap, a->mTracks);
 			delete a;
 		}
 	}
@@ -109,8 +110,8 @@ void GearsMeshBuilder::gather( void )
 	mMeshCount = (uint32)mMyMeshes.Size();
 	if ( mMeshCount )
 	{
-		free(mMeshes);
-		mMeshes    = (Mesh **)malloc(sizeof(Mesh *)*mMeshCount);
+		ph_free(Memory::GearsHeap, mMeshes);
+		mMeshes    = (Mesh **)ph_malloc(Memory::GearsHeap, sizeof(Mesh *)*mMeshCount);
 		Mesh **dst = mMeshes;
 		GearMeshVector::Iterator i;
 		for (i=mMyMeshes.Begin(); i!=mMyMeshes.End(); ++i)
@@ -249,9 +250,11 @@ void GearsMeshBuilder::importIndexedTriangleList( const char *_meshName, const c
 {
 	_materialName = getMaterialName(_materialName);
 	getCurrentMesh(_meshName);
-	for (uint32 i=0; i<vcount; i++)
+	if ( vcount > 0 )
 	{
-		mAABB.setVector( vertices[i].mPos );
+		AxisAlignedBox bounds = MathBatch::computeBounds(&vertices[0].mPos, vcount, sizeof(MeshVertex));
+		mAABB.setVector( bounds.getMinimum() );
+		mAABB.setVector( bounds.getMaximum() );
 	}
 	mCurrentMesh->importIndexedTriangleList(_materialName,vertexFlags,vcount,vertices,tcount,indices);
 }
@@ -264,7 +267,7 @@ void GearsMeshBuilder::importAnimation( const MeshAnimation &animation )
 	a->mFrameCount = animation.mFrameCount;
 	a->mDuration = animation.mDuration;
 	a->mDtime = animation.mDtime;
-	a->mTracks = (MeshAnimTrack **)malloc(sizeof(MeshAnimTrack *)*a->mTrackCount);
+	a->mTracks = (MeshAnimTrack **)ph_malloc(Memory::GearsHeap, sizeof(MeshAnimTrack *)*a->mTrackCount);
 	for (int32 i=0; i<a->mTrackCount; i++)
 	{
 		const MeshAnimTrack &src =*animation.mTracks[i];
@@ -25,6 +25,8 @@ class GearCommandLine;
 class GearTextureAsset;
 class GearMaterialAsset;
 class GearPlatformUtil;
+class GearFileWatcher;
+class GearTextureStreamer;
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -6,18 +6,32 @@
 #include "renderTexture2DDesc.h"
 
 // ֱ֧DDSTGAʽ
-#include "nv_dds.h"
+#include "gearsDDSFile.h"
 #include "targa.h"
 
 _NAMESPACE_BEGIN
 
+uint32 GearTextureAsset::m_sMipSkip = 0;
+
+uint32 GearTextureAsset::m_sStreamingStartSize = 0;
+
 
 GearTextureAsset::GearTextureAsset(FILE &file, const String& path, Type texType) :
 GearAsset(ASSET_TEXTURE, path)
 {
-	m_texture = 0;
+	m_texture       = 0;
+	m_texType       = texType;
+	m_firstLevel    = 0;
+	m_numFileLevels = 0;
+	m_fileWidth     = 0;
+	m_fileHeight    = 0;
+
+	load(file);
+}
 
-	switch(texType)
+void GearTextureAsset::load(FILE &file)
+{
+	switch(m_texType)
 	{
 	case DDS: loadDDS(file); break;
 	case TGA: loadTGA(file); break;
@@ -25,79 +39,91 @@ GearAsset(ASSET_TEXTURE, path)
 	}
 }
 
+bool GearTextureAsset::reload(FILE &file)
+{
+	// build the new texture first, a broken file keeps the old one alive.
+	RenderTexture2D *oldTexture = m_texture;
+	m_texture = 0;
+	load(file);
+	if(!m_texture)
+	{
+		m_texture = oldTexture;
+		return false;
+	}
+	if(oldTexture) oldTexture->release();
+	return true;
+}
+
 GearTextureAsset::~GearTextureAsset(void)
 {
 	if(m_texture) m_texture->release();
 }
 
+void GearTextureAsset::setMipSkip(uint32 count)
+{
+	m_sMipSkip = count;
+}
+
+void GearTextureAsset::setStreamingStartSize(uint32 maxDimension)
+{
+	m_sStreamingStartSize = maxDimension;
+}
+
+uint32 GearTextureAsset::getMinLevel(uint32 numFileLevels)
+{
+	// drop the finest levels but always keep the smallest one.
+	return m_sMipSkip < numFileLevels ? m_sMipSkip : numFileLevels-1;
+}
+
+uint32 GearTextureAsset::getStartLevel(uint32 width, uint32 height, uint32 numFileLevels)
+{
+	uint32 level = getMinLevel(numFileLevels);
+	if(m_sStreamingStartSize)
+	{
+		while(level+1 < numFileLevels &&
+			(RenderTexture2D::getLevelDimension(width, level)  > m_sStreamingStartSize ||
+			 RenderTexture2D::getLevelDimension(height, level) > m_sStreamingStartSize))
+		{
+			level++;
+		}
+	}
+	return level;
+}
+
+void GearTextureAsset::setTexture(RenderTexture2D *texture, uint32 firstLevel)
+{
+	ph_assert(texture);
+	if(m_texture) m_texture->release();
+	m_texture    = texture;
+	m_firstLevel = firstLevel;
+}
+
 void GearTextureAsset::loadDDS(FILE &file) 
 {
-	nv_dds::CDDSImage ddsimage;
-	bool ok = ddsimage.load(&file, false);
+	GearDDSFile ddsfile;
+	bool ok = ddsfile.open(file);
 	ph_assert(ok);
 	if(ok)
 	{
+		const uint32 skip = getStartLevel(ddsfile.getWidth(), ddsfile.getHeight(), ddsfile.getNumLevels());
+		const GearDDSFile::Surface &top = ddsfile.getSurface(0, skip);
+
 		RenderTexture2DDesc tdesc;
-		nv_dds::TextureFormat ddsformat = ddsimage.get_format();
-		switch(ddsformat)
-		{
-		case nv_dds::TextureBGRA: tdesc.format = RenderTexture2D::FORMAT_B8G8R8A8;	break;
-		case nv_dds::TextureDXT1: tdesc.format = RenderTexture2D::FORMAT_DXT1;		break;
-		case nv_dds::TextureDXT3: tdesc.format = RenderTexture2D::FORMAT_DXT3;		break;
-		case nv_dds::TextureDXT5: tdesc.format = RenderTexture2D::FORMAT_DXT5;		break;
-		case nv_dds::TextureLuminance: tdesc.format = RenderTexture2D::FORMAT_L8;	break;
-		}
-		tdesc.width     = ddsimage.get_width();
-		tdesc.height    = ddsimage.get_height();
-		tdesc.numLevels = ddsimage.get_num_mipmaps()+1;
+		tdesc.format    = ddsfile.getFormat();
+		tdesc.width     = top.width;
+		tdesc.height    = top.height;
+		tdesc.numLevels = ddsfile.getNumLevels() - skip;
 
 		ph_assert(tdesc.isValid());
 		m_texture = GearApplication::getApp()->getRender()->createTexture2D(tdesc);
 		ph_assert(m_texture);
 		if(m_texture)
 		{
-			uint32 pitch  = 0;
-			void *buffer = m_texture->lockLevel(0, pitch);
-			ph_assert(buffer);
-			if(buffer)
-			{
-				uint8       *levelDst    = (uint8*)buffer;
-				const uint8 *levelSrc    = (uint8*)(unsigned char*)ddsimage;
-				const uint32 levelWidth  = m_texture->getWidthInBlocks();
-				const uint32 levelHeight = m_texture->getHeightInBlocks();
-				const uint32 rowSrcSize  = levelWidth * m_texture->getBlockSize();
-				ph_assert(rowSrcSize <= pitch);
-				for(uint32 row=0; row<levelHeight; row++)
-				{
-					memcpy(levelDst, levelSrc, rowSrcSize);
-					levelDst += pitch;
-					levelSrc += rowSrcSize;
-				}
-			}
-			m_texture->unlockLevel(0);
-
-			for(uint32 i=1; i<tdesc.numLevels; i++)
-			{
-				void *buffer = m_texture->lockLevel(i, pitch);
-				ph_assert(buffer);
-				if(buffer && pitch )
-				{
-					const nv_dds::CSurface &surface = ddsimage.get_mipmap(i-1);
-					uint8       *levelDst    = (uint8*)buffer;
-					const uint8 *levelSrc    = (uint8*)(unsigned char*)surface;
-					const uint32 levelWidth  = RenderTexture2D::getFormatNumBlocks(surface.get_width(),  m_texture->getFormat());
-					const uint32 levelHeight = RenderTexture2D::getFormatNumBlocks(surface.get_height(), m_texture->getFormat());
-					const uint32 rowSrcSize  = levelWidth * m_texture->getBlockSize();
-					ph_assert(rowSrcSize <= pitch);
-					for(uint32 row=0; row<levelHeight; row++)
-					{
-						memcpy(levelDst, levelSrc, rowSrcSize);
-						levelDst += pitch;
-						levelSrc += rowSrcSize;
-					}
-				}
-				m_texture->unlockLevel(i);
-			}
+			ddsfile.upload(*m_texture, skip);
+			m_firstLevel    = skip;
+			m_numFileLevels = ddsfile.getNumLevels();
+			m_fileWidth     = ddsfile.getWidth();
+			m_fileHeight    = ddsfile.getHeight();
 		}
 	}
 }
@@ -8,6 +8,7 @@ _NAMESPACE_BEGIN
 class GearTextureAsset : public GearAsset
 {
 	friend class GearAssetManager;
+	friend class GearTextureStreamer;
 
 public:
 	
@@ -29,13 +30,61 @@ public:
 public:
 	virtual bool isOk(void) const;
 
+	virtual bool reload(FILE &file);
+
+	// number of finest mip levels dropped when loading DDS files, a global quality/memory bias.
+	static void setMipSkip(uint32 count);
+
+	static uint32 getMipSkip(void) { return m_sMipSkip; }
+
+	// DDS files are loaded with their top level at most this large and refined by the streamer, 0 loads all levels.
+	static void setStreamingStartSize(uint32 maxDimension);
+
+	static uint32 getStreamingStartSize(void) { return m_sStreamingStartSize; }
+
+	// coarsest level that is ever resident, honoring the mip skip.
+	static uint32 getMinLevel(uint32 numFileLevels);
+
+	// level a streamed texture is loaded at.
+	static uint32 getStartLevel(uint32 width, uint32 height, uint32 numFileLevels);
+
+	// mip level of the file the texture's level 0 corresponds to.
+	uint32 getFirstLevel(void) const { return m_firstLevel; }
+
+	uint32 getNumFileLevels(void) const { return m_numFileLevels; }
+
+	uint32 getFileWidth(void) const { return m_fileWidth; }
+
+	uint32 getFileHeight(void) const { return m_fileHeight; }
+
+	bool isStreamable(void) const { return m_texType == DDS && m_numFileLevels > 1; }
+
 private:
 
+	// takes ownership of a texture that holds the file levels starting at firstLevel.
+	void setTexture(RenderTexture2D *texture, uint32 firstLevel);
+
+	void load(FILE &file);
+
 	void loadDDS(FILE &file);
 
 	void loadTGA(FILE &file);
 
 	RenderTexture2D *m_texture;
+
+	Type			m_texType;
+
+	uint32			m_firstLevel;
+
+	uint32			m_numFileLevels;
+
+	uint32			m_fileWidth;
+
+	uint32			m_fileHeight;
+
+	static uint32	m_sMipSkip;
+
+	static uint32	m_sStreamingStartSize;
 };
 
 
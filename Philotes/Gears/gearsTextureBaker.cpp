@@ -0,0 +1,293 @@
+
+#include "gearsTextureBaker.h"
+#include "gearsBlockCompressor.h"
+#include "gearsDDSFile.h"
+
+#include "targa.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	// kaiser windowed sinc, the settings offline tools use for mip generation.
+	const float KAISER_WIDTH = 3.0f;
+	const float KAISER_ALPHA = 4.0f;
+
+	float besselI0(float x)
+	{
+		float sum = 1.0f, term = 1.0f;
+		const float halfX = x * 0.5f;
+		for(int k=1; k<32; k++)
+		{
+			term *= halfX / k;
+			const float t2 = term * term;
+			sum += t2;
+			if(t2 < sum * 1e-7f) break;
+		}
+		return sum;
+	}
+
+	float kaiserFilter(float t)
+	{
+		if(t <= -KAISER_WIDTH || t >= KAISER_WIDTH) return 0.0f;
+		const float sinc = t == 0.0f ? 1.0f : sinf(Math::PI * t) / (Math::PI * t);
+		const float r    = t / KAISER_WIDTH;
+		return sinc * besselI0(KAISER_ALPHA * sqrtf(1.0f - r*r)) / besselI0(KAISER_ALPHA);
+	}
+
+	// taps of one output sample along an axis.
+	struct Kernel
+	{
+		int				first;
+		Array<float>	weights;
+	};
+
+	void buildKernels(uint32 srcLen, uint32 dstLen, Array<Kernel> &kernels)
+	{
+		const float scale   = (float)srcLen / (float)dstLen;
+		const float support = KAISER_WIDTH * scale;
+		const int   numTaps = (int)ceilf(2.0f * support) + 1;
+
+		kernels.Resize(dstLen);
+		for(uint32 x=0; x<dstLen; x++)
+		{
+			Kernel &kernel = kernels[x];
+			const float center = (x + 0.5f) * scale;
+			kernel.first = (int)floorf(center - support);
+			kernel.weights.Resize(numTaps);
+
+			float sum = 0.0f;
+			for(int k=0; k<numTaps; k++)
+			{
+				const float t = ((kernel.first + k) + 0.5f - center) / scale;
+				kernel.weights[k] = kaiserFilter(t);
+				sum += kernel.weights[k];
+			}
+			for(int k=0; k<numTaps; k++)
+			{
+				kernel.weights[k] /= sum;
+			}
+		}
+	}
+
+	inline uint32 clampIndex(int i, uint32 len)
+	{
+		return i < 0 ? 0 : ((uint32)i >= len ? len-1 : (uint32)i);
+	}
+
+	inline uint8 toByte(float v)
+	{
+		v += 0.5f;
+		return v <= 0.0f ? 0 : (v >= 255.0f ? 255 : (uint8)v);
+	}
+
+	void downsampleKaiser(const uint8 *src, uint32 width, uint32 height, uint8 *dest, uint32 destWidth, uint32 destHeight)
+	{
+		Array<Kernel> kernelsX, kernelsY;
+		buildKernels(width,  destWidth,  kernelsX);
+		buildKernels(height, destHeight, kernelsY);
+
+		// horizontal pass into floats, the kaiser lobes go negative so the intermediate isn't clamped.
+		Array<float> temp;
+		temp.Resize(destWidth * height * 4);
+		for(uint32 y=0; y<height; y++)
+		{
+			const uint8 *row = src + y * width * 4;
+			float *out = &temp[y * destWidth * 4];
+			for(uint32 x=0; x<destWidth; x++)
+			{
+				const Kernel &kernel = kernelsX[x];
+				float acc[4] = { 0, 0, 0, 0 };
+				for(IndexT k=0; k<kernel.weights.Size(); k++)
+				{
+					const uint8 *p = row + clampIndex(kernel.first + k, width) * 4;
+					const float w  = kernel.weights[k];
+					acc[0] += p[0] * w; acc[1] += p[1] * w; acc[2] += p[2] * w; acc[3] += p[3] * w;
+				}
+				out[x*4+0] = acc[0]; out[x*4+1] = acc[1]; out[x*4+2] = acc[2]; out[x*4+3] = acc[3];
+			}
+		}
+
+		for(uint32 y=0; y<destHeight; y++)
+		{
+			const Kernel &kernel = kernelsY[y];
+			uint8 *out = dest + y * destWidth * 4;
+			for(uint32 x=0; x<destWidth; x++)
+			{
+				float acc[4] = { 0, 0, 0, 0 };
+				for(IndexT k=0; k<kernel.weights.Size(); k++)
+				{
+					const float *p = &temp[(clampIndex(kernel.first + k, height) * destWidth + x) * 4];
+					const float w  = kernel.weights[k];
+					acc[0] += p[0] * w; acc[1] += p[1] * w; acc[2] += p[2] * w; acc[3] += p[3] * w;
+				}
+				out[x*4+0] = toByte(acc[0]); out[x*4+1] = toByte(acc[1]); out[x*4+2] = toByte(acc[2]); out[x*4+3] = toByte(acc[3]);
+			}
+		}
+	}
+
+	void downsampleBox(const uint8 *src, uint32 width, uint32 height, uint8 *dest, uint32 destWidth, uint32 destHeight)
+	{
+		for(uint32 y=0; y<destHeight; y++)
+		{
+			const uint8 *row0 = src + clampIndex(y*2,   height) * width * 4;
+			const uint8 *row1 = src + clampIndex(y*2+1, height) * width * 4;
+			uint8 *out = dest + y * destWidth * 4;
+			for(uint32 x=0; x<destWidth; x++)
+			{
+				const uint32 x0 = clampIndex(x*2,   width) * 4;
+				const uint32 x1 = clampIndex(x*2+1, width) * 4;
+				for(uint32 c=0; c<4; c++)
+				{
+					out[x*4+c] = (uint8)((row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) >> 2);
+				}
+			}
+		}
+	}
+}
+
+GearTextureBaker::Options::Options(void)
+{
+	format       = RenderTexture2D::NUM_FORMATS;
+	mipFilter    = MIP_FILTER_KAISER;
+	generateMips = true;
+	numThreads   = 0;
+}
+
+String GearTextureBaker::getBakedPath(const String& sourcePath)
+{
+	String path = sourcePath;
+	path.Append(".dds");
+	return path;
+}
+
+bool GearTextureBaker::isUpToDate(const String& sourcePath, const String& bakedPath)
+{
+	struct stat sourceStat, bakedStat;
+	if(stat(bakedPath.c_str(), &bakedStat) != 0)   return false;
+	// without a source there is nothing to rebuild from.
+	if(stat(sourcePath.c_str(), &sourceStat) != 0) return true;
+	return bakedStat.st_mtime >= sourceStat.st_mtime;
+}
+
+bool GearTextureBaker::bakeIfStale(const String& sourcePath, const String& bakedPath, const Options& options)
+{
+	if(isUpToDate(sourcePath, bakedPath)) return true;
+
+	FILE *file = fopen(sourcePath.c_str(), "rb");
+	if(!file) return false;
+	bool ok = bakeTGA(*file, bakedPath, options);
+	fclose(file);
+	return ok;
+}
+
+bool GearTextureBaker::bakeTGA(FILE &file, const String& bakedPath, const Options& options)
+{
+#ifdef RENDERER_ENABLE_TGA_SUPPORT
+	tga_image image;
+	memset(&image, 0, sizeof(image));
+	bool ok = tga_read_from_FILE(&image, &file) == TGA_NOERR;
+
+	// same orientation the uncompressed path uploads.
+	ok = ok && tga_convert_depth(&image, 32) == TGA_NOERR;
+	ok = ok && tga_flip_vert(&image) == TGA_NOERR;
+	ok = ok && bake(image.image_data, image.width, image.height, bakedPath, options);
+
+	tga_free_buffers(&image);
+	return ok;
+#else
+	return false;
+#endif
+}
+
+bool GearTextureBaker::bake(const uint8 *bgra, uint32 width, uint32 height, const String& bakedPath, const Options& options)
+{
+	if(!bgra || !width || !height) return false;
+
+	RenderTexture2D::Format format = options.format;
+	if(format == RenderTexture2D::NUM_FORMATS)
+	{
+		format = RenderTexture2D::FORMAT_DXT1;
+		for(uint32 i=0; i<width*height; i++)
+		{
+			if(bgra[i*4+3] != 0xff)
+			{
+				format = RenderTexture2D::FORMAT_DXT5;
+				break;
+			}
+		}
+	}
+	if(format != RenderTexture2D::FORMAT_DXT1 && format != RenderTexture2D::FORMAT_DXT5) return false;
+
+	uint32 numLevels = 1;
+	if(options.generateMips)
+	{
+		const uint32 size = width > height ? width : height;
+		while((size >> numLevels) > 0) numLevels++;
+	}
+
+	// one buffer for all levels, the surfaces point into it once it's filled.
+	Array<uint32> offsets;
+	uint32 totalSize = 0;
+	for(uint32 level=0; level<numLevels; level++)
+	{
+		offsets.Append(totalSize);
+		totalSize += RenderTexture2D::computeImageByteSize(
+			RenderTexture2D::getLevelDimension(width, level), RenderTexture2D::getLevelDimension(height, level), format);
+	}
+	Array<uint8> data;
+	data.Resize(totalSize);
+
+	Array<uint8> mips[2];
+	const uint8 *image = bgra;
+	uint32 imageWidth  = width;
+	uint32 imageHeight = height;
+
+	Array<GearDDSFile::Surface> levels;
+	for(uint32 level=0; level<numLevels; level++)
+	{
+		if(level > 0)
+		{
+			// always filter from the previous level, each pass only ever halves.
+			Array<uint8> &next = mips[level & 1];
+			uint32 nextWidth = 0, nextHeight = 0;
+			downsample(image, imageWidth, imageHeight, options.mipFilter, next, nextWidth, nextHeight);
+			image       = &next[0];
+			imageWidth  = nextWidth;
+			imageHeight = nextHeight;
+		}
+
+		GearDDSFile::Surface surface;
+		surface.width   = imageWidth;
+		surface.height  = imageHeight;
+		surface.rowSize = RenderTexture2D::getFormatNumBlocks(imageWidth, format) * RenderTexture2D::getFormatBlockSize(format);
+		surface.numRows = RenderTexture2D::getFormatNumBlocks(imageHeight, format);
+		surface.size    = surface.rowSize * surface.numRows;
+		surface.data    = &data[offsets[level]];
+
+		if(!GearBlockCompressor::compressImage(image, imageWidth, imageHeight, imageWidth*4, format,
+			&data[offsets[level]], options.numThreads))
+		{
+			return false;
+		}
+		levels.Append(surface);
+	}
+
+	return GearDDSFile::write(bakedPath, format, levels);
+}
+
+void GearTextureBaker::downsample(const uint8 *bgra, uint32 width, uint32 height, MipFilter filter,
+								  Array<uint8> &dest, uint32 &destWidth, uint32 &destHeight)
+{
+	destWidth  = RenderTexture2D::getLevelDimension(width,  1);
+	destHeight = RenderTexture2D::getLevelDimension(height, 1);
+	dest.Resize(destWidth * destHeight * 4);
+
+	if(filter == MIP_FILTER_KAISER) downsampleKaiser(bgra, width, height, &dest[0], destWidth, destHeight);
+	else                            downsampleBox(bgra, width, height, &dest[0], destWidth, destHeight);
+}
+
+_NAMESPACE_END
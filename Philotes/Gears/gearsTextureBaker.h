@@ -0,0 +1,56 @@
+
+#pragma once
+
+#include "renderTexture2D.h"
+
+_NAMESPACE_BEGIN
+
+// Turns uncompressed source images into block compressed DDS files with a full mip chain,
+// which the regular DDS loading (and streaming) path then consumes.
+class GearTextureBaker
+{
+public:
+
+	enum MipFilter
+	{
+		MIP_FILTER_BOX,
+		MIP_FILTER_KAISER,
+	};
+
+	struct Options
+	{
+		Options(void);
+
+		// DXT1 or DXT5, NUM_FORMATS picks DXT5 for images with alpha and DXT1 otherwise.
+		RenderTexture2D::Format	format;
+
+		MipFilter				mipFilter;
+
+		bool					generateMips;
+
+		// 0 uses one thread per core.
+		uint32					numThreads;
+	};
+
+public:
+
+	// the baked copy of a source image lives next to it, "foo.tga" becomes "foo.tga.dds".
+	static String		getBakedPath(const String& sourcePath);
+
+	// whether the baked file exists and is at least as new as the source.
+	static bool			isUpToDate(const String& sourcePath, const String& bakedPath);
+
+	// rebuilds the baked file from the TGA source if it's missing or older.
+	static bool			bakeIfStale(const String& sourcePath, const String& bakedPath, const Options& options = Options());
+
+	static bool			bakeTGA(FILE &file, const String& bakedPath, const Options& options = Options());
+
+	// bakes a B8G8R8A8 image.
+	static bool			bake(const uint8 *bgra, uint32 width, uint32 height, const String& bakedPath, const Options& options = Options());
+
+	// halves the image (down to 1) into dest, dest is resized to fit.
+	static void			downsample(const uint8 *bgra, uint32 width, uint32 height, MipFilter filter,
+								   Array<uint8> &dest, uint32 &destWidth, uint32 &destHeight);
+};
+
+_NAMESPACE_END
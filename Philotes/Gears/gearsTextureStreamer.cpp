@@ -0,0 +1,411 @@
+
+#include "gearsTextureStreamer.h"
+#include "gearsTextureAsset.h"
+#include "gearsApplication.h"
+#include "render.h"
+#include "renderTexture2DDesc.h"
+#include "util/timer.h"
+
+#include <algorithm>
+
+_NAMESPACE_BEGIN
+
+// a texture nobody looked at for this many frames falls back to its start level when memory is needed.
+static const uint32 TEXTURE_STREAM_UNSEEN_FRAMES = 120;
+
+// reads in flight at once, keeps the queue short so priorities stay fresh.
+static const uint32 TEXTURE_STREAM_MAX_REQUESTS  = 4;
+
+// slots of the queues to and from the worker, reads of removed textures don't count as in flight.
+static const uint32 TEXTURE_STREAM_QUEUE_SIZE    = 64;
+
+// frames to wait after a read that could not be applied, the hot reload starts the texture over sooner if the file changed.
+static const uint32 TEXTURE_STREAM_RETRY_FRAMES  = 300;
+
+struct TextureStreamPriorityGreater
+{
+	template<class T>
+	bool operator()(const T *a, const T *b) const { return a->priority > b->priority; }
+};
+
+GearTextureStreamer::GearTextureStreamer(uint32 budget)
+{
+	m_nextId        = 1;
+	m_frame         = 0;
+	m_budget        = budget;
+	m_residentBytes = 0;
+	m_pendingBytes  = 0;
+	m_numReads      = 0;
+	m_readBytes     = 0;
+	m_readSeconds   = 0;
+	m_quit          = 0;
+
+	m_queued.SetCapacity(TEXTURE_STREAM_QUEUE_SIZE);
+	m_finished.SetCapacity(TEXTURE_STREAM_QUEUE_SIZE);
+	m_wakeEvent = CreateEventA(0, FALSE, FALSE, 0);
+	m_thread    = CreateThread(0, 0, workerMain, this, 0, 0);
+	ph_assert(m_wakeEvent && m_thread);
+}
+
+GearTextureStreamer::~GearTextureStreamer(void)
+{
+	InterlockedExchange(&m_quit, 1);
+	if(m_thread)
+	{
+		SetEvent(m_wakeEvent);
+		WaitForSingleObject(m_thread, INFINITE);
+		CloseHandle(m_thread);
+	}
+	if(m_wakeEvent) CloseHandle(m_wakeEvent);
+
+	Request *request = 0;
+	while(m_queued.TryPop(request))   delete request;
+	while(m_finished.TryPop(request)) delete request;
+}
+
+void GearTextureStreamer::addTexture(GearTextureAsset &asset)
+{
+	if(!asset.isStreamable() || !asset.getTexture() || findEntry(asset) != InvalidIndex) return;
+
+	Entry entry;
+	entry.asset         = &asset;
+	entry.id            = m_nextId++;
+	entry.wantedLevel   = asset.getFirstLevel();
+	entry.priority      = 0;
+	entry.lastSeenFrame = m_frame;
+	entry.retryFrame    = m_frame;
+	entry.pending       = false;
+	m_entries.Append(entry);
+
+	m_residentBytes += asset.getTexture()->getByteSize();
+}
+
+void GearTextureStreamer::removeTexture(GearTextureAsset &asset)
+{
+	// a read still in flight is dropped when it comes back because its id is gone.
+	IndexT index = findEntry(asset);
+	if(index == InvalidIndex) return;
+
+	if(asset.getTexture()) m_residentBytes -= asset.getTexture()->getByteSize();
+	m_entries.EraseIndexSwap(index);
+}
+
+void GearTextureStreamer::update(Array<GearTextureAsset*> &changedAssets)
+{
+	m_frame++;
+
+	Request *finished[TEXTURE_STREAM_QUEUE_SIZE];
+	const SizeT numFinished = m_finished.PopBatch(finished, TEXTURE_STREAM_QUEUE_SIZE);
+	for(IndexT i=0; i<numFinished; i++)
+	{
+		applyRequest(*finished[i], changedAssets);
+		delete finished[i];
+	}
+
+	// the screen sizes were noted while the last frame was drawn.
+	Array<Entry*> byPriority;
+	byPriority.Reserve(m_entries.Size());
+	for(IndexT i=0; i<m_entries.Size(); i++)
+	{
+		Entry &entry = m_entries[i];
+		RenderTexture2D *texture = entry.asset->getTexture();
+		const scalar screenSize = texture->getScreenSize();
+		texture->resetScreenSize();
+
+		if(screenSize > 0)
+		{
+			entry.priority      = screenSize;
+			entry.lastSeenFrame = m_frame;
+		}
+		else if(m_frame - entry.lastSeenFrame > TEXTURE_STREAM_UNSEEN_FRAMES)
+		{
+			entry.priority = 0;
+		}
+		entry.wantedLevel = computeWantedLevel(entry);
+		byPriority.Append(&entry);
+	}
+	std::sort(byPriority.Begin(), byPriority.End(), TextureStreamPriorityGreater());
+
+	// the budget may have shrunk or textures may have been added at their start level.
+	makeRoom(0, 0, byPriority, changedAssets);
+
+	uint32 numInFlight = 0;
+	for(IndexT i=0; i<m_entries.Size(); i++)
+	{
+		if(m_entries[i].pending) numInFlight++;
+	}
+
+	for(IndexT i=0; i<byPriority.Size() && numInFlight<TEXTURE_STREAM_MAX_REQUESTS; i++)
+	{
+		Entry &entry = *byPriority[i];
+		GearTextureAsset &asset = *entry.asset;
+		if(entry.pending || entry.priority <= 0 || entry.wantedLevel >= asset.getFirstLevel() || m_frame < entry.retryFrame) continue;
+
+		// reads of removed textures may still fill the queue.
+		if(m_queued.Size() >= m_queued.Capacity()) break;
+
+		const uint32 cost = computeByteSize(asset, entry.wantedLevel) - asset.getTexture()->getByteSize();
+		if(!makeRoom(cost, &entry, byPriority, changedAssets)) continue;
+
+		Request *request    = new Request;
+		request->id         = entry.id;
+		request->path       = asset.getFullPath();
+		request->firstLevel = entry.wantedLevel;
+		request->reserved   = cost;
+		request->ok         = false;
+		request->seconds    = 0;
+
+		entry.pending   = true;
+		m_pendingBytes += cost;
+		numInFlight++;
+
+		m_queued.TryPush(request);
+		SetEvent(m_wakeEvent);
+	}
+}
+
+DWORD WINAPI GearTextureStreamer::workerMain(LPVOID param)
+{
+	GearTextureStreamer &streamer = *(GearTextureStreamer*)param;
+	for(;;)
+	{
+		WaitForSingleObject(streamer.m_wakeEvent, INFINITE);
+		for(;;)
+		{
+			if(streamer.m_quit) return 0;
+
+			Request *request = 0;
+			if(!streamer.m_queued.TryPop(request)) break;
+
+			streamer.processRequest(*request);
+
+			// the main thread empties the queue every frame.
+			while(!streamer.m_finished.TryPush(request))
+			{
+				if(streamer.m_quit)
+				{
+					delete request;
+					return 0;
+				}
+				Sleep(1);
+			}
+		}
+	}
+}
+
+void GearTextureStreamer::processRequest(Request &request)
+{
+	// runs on the worker, only touches the request.
+	Timer timer;
+	request.ok      = readLevels(request.path, request.firstLevel, request.data, request.levels, request.format);
+	request.seconds = timer.getElapsedSeconds();
+}
+
+bool GearTextureStreamer::readLevels(const String& path, uint32 firstLevel, Array<uint8> &data,
+	Array<GearDDSFile::Surface> &levels, RenderTexture2D::Format &format)
+{
+	data.Clear();
+	levels.Clear();
+
+	GearDDSFile file;
+	if(!file.open(path) || firstLevel >= file.getNumLevels()) return false;
+
+	uint32 total = 0;
+	for(uint32 level=firstLevel; level<file.getNumLevels(); level++)
+	{
+		total += file.getSurface(0, level).size;
+	}
+	data.Resize(total);
+
+	uint32 offset = 0;
+	for(uint32 level=firstLevel; level<file.getNumLevels(); level++)
+	{
+		GearDDSFile::Surface surface = file.getSurface(0, level);
+		memcpy(&data[offset], surface.data, surface.size);
+		surface.data = &data[offset];
+		offset += surface.size;
+		levels.Append(surface);
+	}
+	format = file.getFormat();
+	return true;
+}
+
+void GearTextureStreamer::applyRequest(Request &request, Array<GearTextureAsset*> &changedAssets)
+{
+	m_pendingBytes -= request.reserved;
+	if(request.ok)
+	{
+		m_numReads++;
+		m_readBytes   += request.data.Size();
+		m_readSeconds += request.seconds;
+	}
+
+	Entry *entry = findEntry(request.id);
+	if(!entry) return;
+	entry->pending = false;
+
+	GearTextureAsset &asset = *entry->asset;
+	RenderTexture2D *oldTexture = asset.getTexture();
+
+	// the levels got resident some other way meanwhile, nothing to retry.
+	if(request.firstLevel >= asset.getFirstLevel()) return;
+
+	// the file no longer matches what was loaded, the hot reload will pick it up.
+	// don't read it again every frame until then.
+	if(!request.ok || request.format != oldTexture->getFormat() ||
+	   request.levels.Size() != (SizeT)(asset.getNumFileLevels() - request.firstLevel))
+	{
+		entry->retryFrame = m_frame + TEXTURE_STREAM_RETRY_FRAMES;
+		return;
+	}
+
+	RenderTexture2DDesc desc;
+	desc.format      = oldTexture->getFormat();
+	desc.filter      = oldTexture->getFilter();
+	desc.addressingU = oldTexture->getAddressingU();
+	desc.addressingV = oldTexture->getAddressingV();
+	desc.width       = request.levels[0].width;
+	desc.height      = request.levels[0].height;
+	desc.numLevels   = (uint32)request.levels.Size();
+	ph_assert(desc.isValid());
+
+	RenderTexture2D *texture = GearApplication::getApp()->getRender()->createTexture2D(desc);
+	if(!texture)
+	{
+		entry->retryFrame = m_frame + TEXTURE_STREAM_RETRY_FRAMES;
+		return;
+	}
+
+	for(uint32 level=0; level<desc.numLevels; level++)
+	{
+		GearDDSFile::uploadSurface(*texture, level, request.levels[level]);
+	}
+
+	m_residentBytes += texture->getByteSize();
+	m_residentBytes -= oldTexture->getByteSize();
+	asset.setTexture(texture, request.firstLevel);
+	if(changedAssets.FindIndex(&asset) == InvalidIndex) changedAssets.Append(&asset);
+}
+
+GearTextureStreamer::Entry *GearTextureStreamer::findEntry(uint32 id)
+{
+	for(IndexT i=0; i<m_entries.Size(); i++)
+	{
+		if(m_entries[i].id == id) return &m_entries[i];
+	}
+	return 0;
+}
+
+IndexT GearTextureStreamer::findEntry(const GearTextureAsset &asset) const
+{
+	for(IndexT i=0; i<m_entries.Size(); i++)
+	{
+		if(m_entries[i].asset == &asset) return i;
+	}
+	return InvalidIndex;
+}
+
+uint32 GearTextureStreamer::computeWantedLevel(const Entry &entry) const
+{
+	const GearTextureAsset &asset = *entry.asset;
+	const uint32 numLevels  = asset.getNumFileLevels();
+	const uint32 startLevel = GearTextureAsset::getStartLevel(asset.getFileWidth(), asset.getFileHeight(), numLevels);
+	if(entry.priority <= 0) return startLevel;
+
+	// the coarsest level that still has about one texel per pixel along the longer side.
+	const uint32 size = asset.getFileWidth() > asset.getFileHeight() ? asset.getFileWidth() : asset.getFileHeight();
+	uint32 level = GearTextureAsset::getMinLevel(numLevels);
+	while(level+1 < numLevels && (scalar)RenderTexture2D::getLevelDimension(size, level+1) >= entry.priority)
+	{
+		level++;
+	}
+	return level;
+}
+
+bool GearTextureStreamer::makeRoom(uint32 bytes, const Entry *requester, Array<Entry*> &byPriority, Array<GearTextureAsset*> &changedAssets)
+{
+	for(IndexT i=byPriority.Size()-1; i>=0 && m_residentBytes + m_pendingBytes + bytes > m_budget; i--)
+	{
+		Entry &victim = *byPriority[i];
+		if(requester && (&victim == requester || victim.priority >= requester->priority)) break;
+		if(victim.pending) continue;
+
+		GearTextureAsset &asset = *victim.asset;
+		const uint32 coarsest = asset.getNumFileLevels() - 1;
+
+		// levels finer than wanted are free to go, a more important texture may also take one level that is wanted.
+		uint32 level = asset.getFirstLevel();
+		if(victim.wantedLevel > level)     level = victim.wantedLevel;
+		else if(requester && level < coarsest) level++;
+
+		if(level != asset.getFirstLevel() && dropLevels(victim, level))
+		{
+			if(changedAssets.FindIndex(&asset) == InvalidIndex) changedAssets.Append(&asset);
+		}
+	}
+	return m_residentBytes + m_pendingBytes + bytes <= m_budget;
+}
+
+bool GearTextureStreamer::dropLevels(Entry &entry, uint32 level)
+{
+	GearTextureAsset &asset = *entry.asset;
+	RenderTexture2D *oldTexture = asset.getTexture();
+	ph_assert(level > asset.getFirstLevel());
+	const uint32 delta = level - asset.getFirstLevel();
+	if(delta >= oldTexture->getNumLevels()) return false;
+
+	RenderTexture2DDesc desc;
+	desc.format      = oldTexture->getFormat();
+	desc.filter      = oldTexture->getFilter();
+	desc.addressingU = oldTexture->getAddressingU();
+	desc.addressingV = oldTexture->getAddressingV();
+	desc.width       = RenderTexture2D::getLevelDimension(oldTexture->getWidth(),  delta);
+	desc.height      = RenderTexture2D::getLevelDimension(oldTexture->getHeight(), delta);
+	desc.numLevels   = oldTexture->getNumLevels() - delta;
+	ph_assert(desc.isValid());
+
+	RenderTexture2D *texture = GearApplication::getApp()->getRender()->createTexture2D(desc);
+	if(!texture) return false;
+
+	// the coarse levels are already resident, copy them over instead of going back to disk.
+	const uint32 blockSize = RenderTexture2D::getFormatBlockSize(desc.format);
+	for(uint32 i=0; i<desc.numLevels; i++)
+	{
+		uint32 srcPitch = 0, dstPitch = 0;
+		const uint8 *src = (const uint8*)oldTexture->lockLevel(i+delta, srcPitch);
+		uint8       *dst = (uint8*)texture->lockLevel(i, dstPitch);
+		if(src && dst)
+		{
+			const uint32 levelWidth  = RenderTexture2D::getLevelDimension(desc.width,  i);
+			const uint32 levelHeight = RenderTexture2D::getLevelDimension(desc.height, i);
+			const uint32 rowSize     = RenderTexture2D::getFormatNumBlocks(levelWidth, desc.format) * blockSize;
+			const uint32 numRows     = RenderTexture2D::getFormatNumBlocks(levelHeight, desc.format);
+			for(uint32 row=0; row<numRows; row++)
+			{
+				memcpy(dst + row*dstPitch, src + row*srcPitch, rowSize);
+			}
+		}
+		if(src) oldTexture->unlockLevel(i+delta);
+		if(dst) texture->unlockLevel(i);
+	}
+
+	m_residentBytes += texture->getByteSize();
+	m_residentBytes -= oldTexture->getByteSize();
+	asset.setTexture(texture, level);
+	return true;
+}
+
+uint32 GearTextureStreamer::computeByteSize(GearTextureAsset &asset, uint32 firstLevel)
+{
+	const RenderTexture2D::Format format = asset.getTexture()->getFormat();
+	uint32 size = 0;
+	for(uint32 level=firstLevel; level<asset.getNumFileLevels(); level++)
+	{
+		size += RenderTexture2D::computeImageByteSize(
+			RenderTexture2D::getLevelDimension(asset.getFileWidth(),  level),
+			RenderTexture2D::getLevelDimension(asset.getFileHeight(), level), format);
+	}
+	return size;
+}
+
+_NAMESPACE_END
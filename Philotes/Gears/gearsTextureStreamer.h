@@ -0,0 +1,131 @@
+
+#pragma once
+
+#include "gearsDDSFile.h"
+#include "util/spscqueue.h"
+
+_NAMESPACE_BEGIN
+
+class GearTextureAsset;
+
+// Keeps only the mip levels of DDS textures that are actually visible resident.
+// Textures start at a coarse level; every frame the screen size noted on each texture decides
+// which level it wants, finer levels are read from disk on a worker thread and swapped in on the
+// main thread. The sum of all streamed textures is held under a budget by dropping the finest
+// levels of the least visible textures first.
+class GearTextureStreamer
+{
+public:
+
+	GearTextureStreamer(uint32 budget);
+
+	~GearTextureStreamer(void);
+
+	void				setBudget(uint32 budget)		{ m_budget = budget; }
+
+	uint32				getBudget(void) const			{ return m_budget; }
+
+	// bytes of all streamed textures, including upgrades that are still in flight.
+	uint32				getResidentBytes(void) const	{ return m_residentBytes + m_pendingBytes; }
+
+	// reads the worker finished, their bytes and the seconds it spent on them, for the throughput.
+	uint32				getNumReads(void) const			{ return m_numReads; }
+
+	uint64				getReadBytes(void) const		{ return m_readBytes; }
+
+	double				getReadSeconds(void) const		{ return m_readSeconds; }
+
+	void				addTexture(GearTextureAsset &asset);
+
+	void				removeTexture(GearTextureAsset &asset);
+
+	// applies finished reads and issues new ones, call once per frame.
+	// assets whose texture object got replaced are appended to changedAssets.
+	void				update(Array<GearTextureAsset*> &changedAssets);
+
+	// what the worker does for a request: copies levels [firstLevel, last] of the file into data, levels point into data.
+	static bool			readLevels(const String& path, uint32 firstLevel, Array<uint8> &data,
+							Array<GearDDSFile::Surface> &levels, RenderTexture2D::Format &format);
+
+private:
+
+	struct Entry
+	{
+		GearTextureAsset*	asset;
+		uint32				id;
+		uint32				wantedLevel;
+		scalar				priority;		// screen size in pixels, 0 when not seen recently
+		uint32				lastSeenFrame;
+		uint32				retryFrame;		// no reads before this frame, set when one could not be applied
+		bool				pending;
+	};
+
+	struct Request
+	{
+		uint32							id;
+		String							path;
+		uint32							firstLevel;
+		uint32							reserved;	// bytes held back from the budget until the request is applied
+		RenderTexture2D::Format			format;
+		bool							ok;
+		double							seconds;	// spent reading on the worker
+		Array<uint8>					data;
+		Array<GearDDSFile::Surface>		levels;		// point into data
+	};
+
+	static DWORD WINAPI	workerMain(LPVOID param);
+
+	void				processRequest(Request &request);
+
+	void				applyRequest(Request &request, Array<GearTextureAsset*> &changedAssets);
+
+	Entry*				findEntry(uint32 id);
+
+	IndexT				findEntry(const GearTextureAsset &asset) const;
+
+	uint32				computeWantedLevel(const Entry &entry) const;
+
+	// drops levels of textures less important than the requester until bytes more fit, returns whether they do.
+	// without a requester only levels finer than wanted are dropped.
+	bool				makeRoom(uint32 bytes, const Entry *requester, Array<Entry*> &byPriority, Array<GearTextureAsset*> &changedAssets);
+
+	// rebuilds the texture with only the levels from the given one down, reusing the resident data.
+	bool				dropLevels(Entry &entry, uint32 level);
+
+	static uint32		computeByteSize(GearTextureAsset &asset, uint32 firstLevel);
+
+	GearTextureStreamer &operator=(const GearTextureStreamer&) { return *this; }
+
+private:
+
+	Array<Entry>		m_entries;
+
+	uint32				m_nextId;
+
+	uint32				m_frame;
+
+	uint32				m_budget;
+
+	uint32				m_residentBytes;
+
+	uint32				m_pendingBytes;
+
+	uint32				m_numReads;
+
+	uint64				m_readBytes;
+
+	double				m_readSeconds;
+
+	// main thread to worker and back, each with one producer and one consumer.
+	SpscQueue<Request*>	m_queued;
+
+	SpscQueue<Request*>	m_finished;
+
+	HANDLE				m_wakeEvent;
+
+	HANDLE				m_thread;
+
+	volatile LONG		m_quit;
+};
+
+_NAMESPACE_END
@@ -535,7 +535,7 @@ public:
 					delete []t->mPose;
 					delete t;
 				}
-				free(mAnimation->mTracks);
+				ph_free(Memory::GearsHeap, mAnimation->mTracks);
 				delete mAnimation;
 				mAnimation = 0;
 			}
@@ -631,7 +631,7 @@ public:
 						mAnimation->mFrameCount = framecount;
 						mAnimation->mDuration = duration;
 						mAnimation->mDtime = dtime;
-						mAnimation->mTracks = (MeshAnimTrack **)malloc(sizeof(MeshAnimTrack *)*mAnimation->mTrackCount);
+						mAnimation->mTracks = (MeshAnimTrack **)ph_malloc(Memory::GearsHeap, sizeof(MeshAnimTrack *)*mAnimation->mTrackCount);
 						for (int32 i=0; i<mAnimation->mTrackCount; i++)
 						{
 							MeshAnimTrack *track = ph_new(MeshAnimTrack);
@@ -1045,12 +1045,12 @@ public:
 
 	virtual void *  fastxml_malloc(uint32 size)
 	{
-		return malloc(size);
+		return ph_malloc(Memory::GearsHeap, size);
 	}
 
 	virtual void	fastxml_free(void *mem) 
 	{
-		free(mem);
+		ph_free(Memory::GearsHeap, mem);
 	}
 
 	virtual bool processClose(const char *element,uint32 depth,bool &isError)	  // process the 'close' indicator for a previously encountered element
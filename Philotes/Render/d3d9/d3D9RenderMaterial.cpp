@@ -4,6 +4,7 @@
 #if defined(RENDERER_ENABLE_DIRECT3D9)
 
 #include <renderMaterialDesc.h>
+#include <renderShaderCache.h>
 #include "D3D9RenderTexture2D.h"
 #include <stdio.h>
 
@@ -27,6 +28,37 @@ D3D9RenderMaterial::ShaderConstants::~ShaderConstants(void)
 	if(table) table->Release();
 }
 
+void D3D9RenderMaterial::ShaderConstants::reset(void)
+{
+	if(table) table->Release();
+	memset(this, 0, sizeof(*this));
+}
+
+void D3D9RenderMaterial::ShaderConstants::swap(ShaderConstants &other)
+{
+	char temp[sizeof(ShaderConstants)];
+	memcpy(temp,   this,   sizeof(temp));
+	memcpy(this,   &other, sizeof(temp));
+	memcpy(&other, temp,   sizeof(temp));
+}
+
+D3D9RenderMaterial::ShaderSet::ShaderSet(void)
+{
+	vertexShader          = 0;
+	instancedVertexShader = 0;
+	memset(fragmentPrograms, 0, sizeof(fragmentPrograms));
+}
+
+D3D9RenderMaterial::ShaderSet::~ShaderSet(void)
+{
+	if(vertexShader)          vertexShader->Release();
+	if(instancedVertexShader) instancedVertexShader->Release();
+	for(uint32 i=0; i<NUM_PASSES; i++)
+	{
+		if(fragmentPrograms[i]) fragmentPrograms[i]->Release();
+	}
+}
+
 static D3DXHANDLE getShaderConstantByName(ID3DXConstantTable &table, const char *name)
 {
 	D3DXHANDLE found = 0;
@@ -219,6 +251,12 @@ D3D9RenderMaterial::D3D9Variable::~D3D9Variable(void)
 	
 }
 
+void D3D9RenderMaterial::D3D9Variable::clearHandles(void)
+{
+	m_vertexHandle = 0;
+	memset(m_fragmentHandles, 0, sizeof(m_fragmentHandles));
+}
+
 void D3D9RenderMaterial::D3D9Variable::addVertexHandle(ID3DXConstantTable &table, D3DXHANDLE handle)
 {
 	m_vertexHandle = handle;
@@ -253,6 +291,10 @@ static void processCompileErrors(LPD3DXBUFFER errors)
 
 class D3D9ShaderIncluder : public ID3DXInclude
 {
+	public:
+		// dependencies, if given, receives the full path of every file that gets included.
+		D3D9ShaderIncluder(Array<String> *dependencies=0) : m_dependencies(dependencies) {}
+
 	private:
 #if defined(RENDERER_XBOX360)
 		STDMETHOD(Open)(THIS_ D3DXINCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID *data, UINT *dataSize,LPSTR pFullPath, DWORD cbFullPath)
@@ -287,6 +329,10 @@ class D3D9ShaderIncluder : public ID3DXInclude
 				}
 				fclose(file);
 				result = D3D_OK;
+				if(m_dependencies)
+				{
+					m_dependencies->Append(String(fullpath));
+				}
 			}
 			ph_assert2(result == D3D_OK, "Failed to include shader header.");
 			return result;
@@ -297,17 +343,199 @@ class D3D9ShaderIncluder : public ID3DXInclude
 			delete [] ((char*)data);
 			return D3D_OK;
 		}
+
+	private:
+		Array<String> *m_dependencies;
 };
 
+static void buildShaderMacros(const Array<ShaderDefines> &defines, Array<D3DXMACRO> &macros)
+{
+	macros.Resize(defines.Size()+1);
+	for(SizeT d=0; d<defines.Size(); d++)
+	{
+		macros[d].Name       = defines[d].define.c_str();
+		macros[d].Definition = defines[d].value.c_str();
+	}
+	macros[defines.Size()].Name       = 0;
+	macros[defines.Size()].Definition = 0;
+}
+
+// compiles permutations for the shader cache through D3DX.
+class D3D9ShaderCompiler : public RenderShaderCompiler
+{
+	public:
+		D3D9ShaderCompiler(D3D9Render::D3DXInterface &d3dx) : m_d3dx(d3dx) {}
+
+		virtual bool preprocessShader(const RenderShaderKey &key, Array<char> &outSource, Array<String> &outDependencies)
+		{
+			Array<D3DXMACRO> macros;
+			buildShaderMacros(key.defines, macros);
+			D3D9ShaderIncluder includer(&outDependencies);
+
+			LPD3DXBUFFER text   = 0;
+			LPD3DXBUFFER errors = 0;
+			HRESULT result = m_d3dx.PreprocessShaderFromFileA(key.sourcePath.c_str(), &macros[0], &includer, &text, &errors);
+			bool ok = result == D3D_OK && text;
+			if(ok)
+			{
+				outSource.Resize((SizeT)text->GetBufferSize());
+				if(outSource.Size() > 0)
+				{
+					memcpy(&outSource[0], text->GetBufferPointer(), outSource.Size());
+				}
+				outDependencies.Append(key.sourcePath);
+			}
+			if(text)   text->Release();
+			if(errors) errors->Release();
+			return ok;
+		}
+
+		virtual bool compileShader(const RenderShaderKey &key, Array<uint8> &outBlob)
+		{
+			Array<D3DXMACRO> macros;
+			buildShaderMacros(key.defines, macros);
+			D3D9ShaderIncluder includer;
+
+			LPD3DXBUFFER shader = 0;
+			LPD3DXBUFFER errors = 0;
+			HRESULT result = m_d3dx.CompileShaderFromFileA(key.sourcePath.c_str(), &macros[0], &includer,
+				key.entry.c_str(), key.profile.c_str(), key.flags, &shader, &errors, 0);
+			processCompileErrors(errors);
+			bool ok = result == D3D_OK && shader && shader->GetBufferSize() > 0;
+			if(ok)
+			{
+				outBlob.Resize((SizeT)shader->GetBufferSize());
+				memcpy(&outBlob[0], shader->GetBufferPointer(), outBlob.Size());
+			}
+			if(shader) shader->Release();
+			if(errors) errors->Release();
+			return ok;
+		}
+
+	private:
+		D3D9ShaderCompiler &operator=(const D3D9ShaderCompiler&) { return *this; }
+
+	private:
+		D3D9Render::D3DXInterface &m_d3dx;
+};
+
+bool D3D9RenderMaterial::loadShader(const RenderShaderKey &key, Array<uint8> &blob, ShaderConstants &constants, Array<String> &dependencies)
+{
+	D3D9ShaderCompiler compiler(m_renderer.getD3DX());
+	Array<String> keyDependencies;
+	bool ok = m_renderer.getShaderCache()->fetch(key, compiler, blob, &keyDependencies);
+	if(ok)
+	{
+		HRESULT result = m_renderer.getD3DX().GetShaderConstantTable((const DWORD*)&blob[0], &constants.table);
+		ok = result == D3D_OK;
+	}
+	for(IndexT i=0; i<keyDependencies.Size(); i++)
+	{
+		if(dependencies.FindIndex(keyDependencies[i]) == InvalidIndex)
+		{
+			dependencies.Append(keyDependencies[i]);
+		}
+	}
+	return ok;
+}
+
 D3D9RenderMaterial::D3D9RenderMaterial(D3D9Render &renderer, const RenderMaterialDesc &desc) :
 	RenderMaterial(desc),
 	m_renderer(renderer)
 {
-	m_d3dAlphaTestFunc      = D3DCMP_ALWAYS;
 	m_vertexShader          = 0;
 	m_instancedVertexShader = 0;
 	memset(m_fragmentPrograms, 0, sizeof(m_fragmentPrograms));
-	
+
+	loadRenderStates();
+
+	// a material is created with whatever compiled, the failed programs stay NULL.
+	ShaderSet shaders;
+	bool ok = compileShaders(desc, shaders);
+	ph_assert2(ok || !m_renderer.getD3DDevice(), "Failed to compile Shader.");
+	swapShaders(shaders);
+}
+
+bool D3D9RenderMaterial::reload(const RenderMaterialDesc &desc)
+{
+	// compiled aside, a broken shader leaves the material as it was.
+	ShaderSet shaders;
+	if(!compileShaders(desc, shaders))
+	{
+		return false;
+	}
+	applyDesc(desc);
+	loadRenderStates();
+	swapShaders(shaders);
+	return true;
+}
+
+void D3D9RenderMaterial::releaseShaders(void)
+{
+	if(m_vertexShader)          m_vertexShader->Release();
+	if(m_instancedVertexShader) m_instancedVertexShader->Release();
+	m_vertexShader          = 0;
+	m_instancedVertexShader = 0;
+	for(uint32 i=0; i<NUM_PASSES; i++)
+	{
+		if(m_fragmentPrograms[i]) m_fragmentPrograms[i]->Release();
+		m_fragmentPrograms[i] = 0;
+		m_fragmentConstants[i].reset();
+	}
+	m_vertexConstants.reset();
+	m_instancedVertexConstants.reset();
+	m_shaderDependencies.Clear();
+}
+
+void D3D9RenderMaterial::swapShaders(ShaderSet &shaders)
+{
+	IDirect3DVertexShader9 *vertexShader = m_vertexShader;
+	m_vertexShader = shaders.vertexShader;
+	shaders.vertexShader = vertexShader;
+
+	IDirect3DVertexShader9 *instancedVertexShader = m_instancedVertexShader;
+	m_instancedVertexShader = shaders.instancedVertexShader;
+	shaders.instancedVertexShader = instancedVertexShader;
+
+	m_vertexConstants.swap(shaders.vertexConstants);
+	m_instancedVertexConstants.swap(shaders.instancedVertexConstants);
+	for(uint32 i=0; i<NUM_PASSES; i++)
+	{
+		IDirect3DPixelShader9 *fragmentProgram = m_fragmentPrograms[i];
+		m_fragmentPrograms[i] = shaders.fragmentPrograms[i];
+		shaders.fragmentPrograms[i] = fragmentProgram;
+
+		m_fragmentConstants[i].swap(shaders.fragmentConstants[i]);
+	}
+	m_shaderDependencies.Clear();
+	m_shaderDependencies.AppendArray(shaders.dependencies);
+
+	// variables keep their offsets, only their handles into the new tables change.
+	for(IndexT i=0; i<m_variables.Size(); i++)
+	{
+		static_cast<D3D9Variable*>(m_variables[i])->clearHandles();
+	}
+	if(m_vertexShader && m_vertexConstants.table)
+	{
+		loadCustomConstants(*m_vertexConstants.table, NUM_PASSES);
+	}
+	if(m_instancedVertexShader && m_instancedVertexConstants.table)
+	{
+		loadCustomConstants(*m_instancedVertexConstants.table, NUM_PASSES);
+	}
+	for(uint32 i=0; i<NUM_PASSES; i++)
+	{
+		if(m_fragmentPrograms[i] && m_fragmentConstants[i].table)
+		{
+			loadCustomConstants(*m_fragmentConstants[i].table, (Pass)i);
+		}
+	}
+}
+
+void D3D9RenderMaterial::loadRenderStates(void)
+{
+	m_d3dAlphaTestFunc = D3DCMP_ALWAYS;
+
 	AlphaTestFunc alphaTestFunc = getAlphaTestFunc();
 	switch(alphaTestFunc)
 	{
@@ -324,180 +552,95 @@ D3D9RenderMaterial::D3D9RenderMaterial(D3D9Render &renderer, const RenderMateria
 	
 	m_d3dSrcBlendFunc = getD3DBlendFunc(getSrcBlendFunc());
 	m_d3dDstBlendFunc = getD3DBlendFunc(getDstBlendFunc());
-	
+}
+
+bool D3D9RenderMaterial::compileShaders(const RenderMaterialDesc &desc, ShaderSet &shaders)
+{
+	bool ok = false;
 	D3D9Render::D3DXInterface &d3dx      = m_renderer.getD3DX();
 	IDirect3DDevice9 *d3dDevice = m_renderer.getD3DDevice();
 	if(d3dDevice)
 	{
-		D3D9ShaderIncluder shaderIncluder;
-		
-		const char *vertexEntry      = "vmain";
-		const char *vertexProfile    = d3dx.GetVertexShaderProfile(d3dDevice);
-		const char *vertexShaderPath = desc.vertexShaderPath;
-		const DWORD vertexFlags      = D3DXSHADER_PACKMATRIX_COLUMNMAJOR|D3DXSHADER_DEBUG;
-
-		Array<ShaderDefines> defines;
-		ShaderDefines def;
-		def.define	= "RENDERER_VERTEX";
-		def.value	= "1";
-		defines.Append(def);
-		defines.AppendArray(desc.extraDefines);
-		D3DXMACRO* vertexDefines = new D3DXMACRO[defines.Size()+1];
-		for (SizeT d = 0; d<defines.Size(); d++)
-		{
-			vertexDefines[d].Name = &defines[d].define[0];
-			vertexDefines[d].Definition = &defines[d].value[0];
-		}
-		vertexDefines[defines.Size()].Name = 0;
-		vertexDefines[defines.Size()].Definition = 0;
-
-		LPD3DXBUFFER        vshader = 0;
-		LPD3DXBUFFER        verrors = 0;
-		HRESULT result = d3dx.CompileShaderFromFileA(vertexShaderPath, vertexDefines, &shaderIncluder, 
-			vertexEntry, vertexProfile, vertexFlags, &vshader, &verrors, &m_vertexConstants.table);
-		processCompileErrors(verrors);
-		ph_assert2(result == D3D_OK && vshader, "Failed to compile Vertex Shader.");
-		if(result == D3D_OK && vshader)
-		{
-			result = d3dDevice->CreateVertexShader((const DWORD*)vshader->GetBufferPointer(), &m_vertexShader);
-			ph_assert2(result == D3D_OK && m_vertexShader, "Failed to load Vertex Shader.");
-			if(result == D3D_OK && m_vertexShader)
-			{
-				m_vertexConstants.loadConstants();
-				if(m_vertexConstants.table)
-				{
-					loadCustomConstants(*m_vertexConstants.table, NUM_PASSES);
-				}
-			}
-		}
-		if(vshader) 
+	#if defined(RENDERER_DEBUG)
+		const DWORD shaderFlags = D3DXSHADER_PACKMATRIX_COLUMNMAJOR|D3DXSHADER_DEBUG;
+	#else
+		const DWORD shaderFlags = D3DXSHADER_PACKMATRIX_COLUMNMAJOR;
+	#endif
+
+		RenderShaderKey vertexKey;
+		vertexKey.sourcePath = desc.vertexShaderPath;
+		vertexKey.entry      = "vmain";
+		vertexKey.profile    = d3dx.GetVertexShaderProfile(d3dDevice);
+		vertexKey.flags      = shaderFlags;
+		vertexKey.defines.Append(ShaderDefines("RENDERER_VERTEX","1"));
+		vertexKey.defines.AppendArray(desc.extraDefines);
+
+		Array<uint8> blob;
+		ok = true;
+		if(loadShader(vertexKey, blob, shaders.vertexConstants, shaders.dependencies) &&
+		   d3dDevice->CreateVertexShader((const DWORD*)&blob[0], &shaders.vertexShader) == D3D_OK && shaders.vertexShader)
 		{
-			vshader->Release();
+			shaders.vertexConstants.loadConstants();
 		}
-		if(verrors) 
+		else
 		{
-			verrors->Release();
+			ok = false;
 		}
 
-		Array<ShaderDefines> dins;
-		dins.Append(ShaderDefines("RENDERER_VERTEX","1"));
-		dins.Append(ShaderDefines("PX_WINDOWS","1"));
+		RenderShaderKey instancedKey = vertexKey;
+		instancedKey.defines.Clear();
+		instancedKey.defines.Append(ShaderDefines("RENDERER_VERTEX","1"));
+		instancedKey.defines.Append(ShaderDefines("PX_WINDOWS","1"));
 #if RENDERER_INSTANCING
-		dins.Append(ShaderDefines("RENDERER_INSTANCED","1"));
+		instancedKey.defines.Append(ShaderDefines("RENDERER_INSTANCED","1"));
 #else
-		dins.Append(ShaderDefines("RENDERER_INSTANCED","0"));
+		instancedKey.defines.Append(ShaderDefines("RENDERER_INSTANCED","0"));
 #endif
-		dins.AppendArray(desc.extraDefines);
+		instancedKey.defines.AppendArray(desc.extraDefines);
 
-		D3DXMACRO* vertexDefinesInstanced = new D3DXMACRO[dins.Size()+1];
-		for (SizeT d = 0; d<dins.Size(); d++)
-		{
-			vertexDefinesInstanced[d].Name = &dins[d].define[0];
-			vertexDefinesInstanced[d].Definition = &dins[d].value[0];
-		}
-		vertexDefinesInstanced[dins.Size()].Name = 0;
-		vertexDefinesInstanced[dins.Size()].Definition = 0;
-
-		vshader = 0;
-		verrors = 0;
-		result = d3dx.CompileShaderFromFileA(vertexShaderPath, vertexDefinesInstanced,
-			&shaderIncluder, vertexEntry, vertexProfile, vertexFlags, &vshader, &verrors, &m_instancedVertexConstants.table);
-		processCompileErrors(verrors);
-		ph_assert2(result == D3D_OK && vshader, "Failed to compile Vertex Shader.");
-		if(result == D3D_OK && vshader)
-		{
-			result = d3dDevice->CreateVertexShader((const DWORD*)vshader->GetBufferPointer(), &m_instancedVertexShader);
-			ph_assert2(result == D3D_OK && m_vertexShader, "Failed to load Vertex Shader.");
-			if(result == D3D_OK && m_vertexShader)
-			{
-				m_instancedVertexConstants.loadConstants();
-				if(m_instancedVertexConstants.table)
-				{
-					loadCustomConstants(*m_instancedVertexConstants.table, NUM_PASSES);
-				}
-			}
-		}
-		if(vshader)
+		if(loadShader(instancedKey, blob, shaders.instancedVertexConstants, shaders.dependencies) &&
+		   d3dDevice->CreateVertexShader((const DWORD*)&blob[0], &shaders.instancedVertexShader) == D3D_OK && shaders.instancedVertexShader)
 		{
-			vshader->Release();
+			shaders.instancedVertexConstants.loadConstants();
 		}
-		if(verrors)
+		else
 		{
-			verrors->Release();
+			ok = false;
 		}
-
-		delete []vertexDefines;
-		delete []vertexDefinesInstanced;
 		
-		const char *fragmentEntry      = "fmain";
-		const char *fragmentProfile    = d3dx.GetPixelShaderProfile(d3dDevice);
-		const char *fragmentShaderPath = desc.fragmentShaderPath;
-		const DWORD fragmentFlags      = D3DXSHADER_PACKMATRIX_COLUMNMAJOR|D3DXSHADER_DEBUG;
+		RenderShaderKey fragmentKey;
+		fragmentKey.sourcePath = desc.fragmentShaderPath;
+		fragmentKey.entry      = "fmain";
+		fragmentKey.profile    = d3dx.GetPixelShaderProfile(d3dDevice);
+		fragmentKey.flags      = shaderFlags;
 		for(uint32 i=0; i<NUM_PASSES; i++)
 		{
-			Array<ShaderDefines> defines;
-			ShaderDefines def;
-			def.define	= "RENDERER_VERTEX";
-			def.value	= "1";
-			defines.Append(ShaderDefines("RENDERER_FRAGMENT","1"));
-			defines.Append(ShaderDefines(getPassName((Pass)i),"1"));
-			defines.Append(ShaderDefines("ENABLE_VFACE","1"));
-			defines.Append(ShaderDefines("ENABLE_VFACE_SCALE","1"));
-			defines.Append(ShaderDefines("WIN32","1"));
-			defines.Append(ShaderDefines("ENABLE_SHADOWS","1"));
-			defines.AppendArray(desc.extraDefines);
-			D3DXMACRO* fragmentDefines = new D3DXMACRO[defines.Size()+1];
-			for (SizeT d = 0; d<defines.Size(); d++)
+			fragmentKey.defines.Clear();
+			fragmentKey.defines.Append(ShaderDefines("RENDERER_FRAGMENT","1"));
+			fragmentKey.defines.Append(ShaderDefines(getPassName((Pass)i),"1"));
+			fragmentKey.defines.Append(ShaderDefines("ENABLE_VFACE","1"));
+			fragmentKey.defines.Append(ShaderDefines("ENABLE_VFACE_SCALE","1"));
+			fragmentKey.defines.Append(ShaderDefines("WIN32","1"));
+			fragmentKey.defines.Append(ShaderDefines("ENABLE_SHADOWS","1"));
+			fragmentKey.defines.AppendArray(desc.extraDefines);
+
+			if(loadShader(fragmentKey, blob, shaders.fragmentConstants[i], shaders.dependencies) &&
+			   d3dDevice->CreatePixelShader((const DWORD*)&blob[0], &shaders.fragmentPrograms[i]) == D3D_OK && shaders.fragmentPrograms[i])
 			{
-				fragmentDefines[d].Name = &defines[d].define[0];
-				fragmentDefines[d].Definition = &defines[d].value[0];
+				shaders.fragmentConstants[i].loadConstants();
 			}
-			fragmentDefines[defines.Size()].Name = 0;
-			fragmentDefines[defines.Size()].Definition = 0;
-
-			LPD3DXBUFFER fshader = 0;
-			LPD3DXBUFFER ferrors = 0;
-			result = d3dx.CompileShaderFromFileA(fragmentShaderPath, fragmentDefines,
-				&shaderIncluder, fragmentEntry, fragmentProfile, fragmentFlags, &fshader, &ferrors, &m_fragmentConstants[i].table);
-			processCompileErrors(ferrors);
-			ph_assert2(result == D3D_OK && fshader, "Failed to compile Fragment Shader.");
-			if(result == D3D_OK && vshader)
+			else
 			{
-				result = d3dDevice->CreatePixelShader((const DWORD*)fshader->GetBufferPointer(), &m_fragmentPrograms[i]);
-				ph_assert2(result == D3D_OK && m_fragmentPrograms[i], "Failed to load Fragment Shader.");
-				if(result == D3D_OK && m_fragmentPrograms[i])
-				{
-					m_fragmentConstants[i].loadConstants();
-					if(m_fragmentConstants[i].table)
-					{
-						loadCustomConstants(*m_fragmentConstants[i].table, (Pass)i);
-					}
-				}
-			}
-			if(fshader) 
-			{
-				fshader->Release();
-			}
-			if(ferrors) 
-			{
-				ferrors->Release();
+				ok = false;
 			}
 		}
 	}
+	return ok;
 }
 
 D3D9RenderMaterial::~D3D9RenderMaterial(void)
 {
-	if(m_vertexShader)          m_vertexShader->Release();
-	if(m_instancedVertexShader) m_instancedVertexShader->Release();
-	for(uint32 i=0; i<NUM_PASSES; i++)
-	{
-		IDirect3DPixelShader9 *fp = m_fragmentPrograms[i];
-		if(fp) 
-		{
-			fp->Release();
-		}
-	}
+	releaseShaders();
 }
 
 void D3D9RenderMaterial::bind(RenderMaterial::Pass pass, RenderMaterialInstance *materialInstance, bool instanced) const
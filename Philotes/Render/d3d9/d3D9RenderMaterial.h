@@ -19,8 +19,18 @@ class D3D9RenderMaterial : public RenderMaterial
 		D3D9RenderMaterial(D3D9Render &renderer, const RenderMaterialDesc &desc);
 		virtual ~D3D9RenderMaterial(void);
 		virtual void setModelMatrix(const scalar *matrix);
+		virtual bool reload(const RenderMaterialDesc &desc);
 		
 	private:
+		class ShaderSet;
+
+		// compiles every program of the description into shaders, returns false if any of them failed.
+		bool compileShaders(const RenderMaterialDesc &desc, ShaderSet &shaders);
+		// exchanges the material's programs with shaders and rebuilds the variable handles from the new tables.
+		void swapShaders(ShaderSet &shaders);
+		void loadRenderStates(void);
+		void releaseShaders(void);
+
 		virtual void bind(RenderMaterial::Pass pass, RenderMaterialInstance *materialInstance, bool instanced) const;
 		virtual void bindMeshState(bool instanced) const;
 		virtual void unbind(void) const;
@@ -29,6 +39,11 @@ class D3D9RenderMaterial : public RenderMaterial
 		void loadCustomConstants(ID3DXConstantTable &table, Pass pass);
 	
 	private:
+		class ShaderConstants;
+
+		// fetches the permutation through the render's shader cache and builds its constant table.
+		bool loadShader(const RenderShaderKey &key, Array<uint8> &blob, ShaderConstants &constants, Array<String> &dependencies);
+
 		class ShaderConstants
 		{
 			public:
@@ -68,10 +83,38 @@ class D3D9RenderMaterial : public RenderMaterial
 				~ShaderConstants(void);
 				
 				void loadConstants(void);
+
+				// releases the constant table and clears all handles.
+				void reset(void);
+
+				void swap(ShaderConstants &other);
 				
 				void bindEnvironment(IDirect3DDevice9 &d3dDevice, const D3D9Render::ShaderEnvironment &shaderEnv) const;
 		};
 		
+		// the programs of a material, reload() compiles into one aside and swaps it in only if it is complete.
+		class ShaderSet
+		{
+			public:
+				IDirect3DVertexShader9 *vertexShader;
+				IDirect3DVertexShader9 *instancedVertexShader;
+				IDirect3DPixelShader9  *fragmentPrograms[NUM_PASSES];
+				
+				ShaderConstants         vertexConstants;
+				ShaderConstants         instancedVertexConstants;
+				ShaderConstants         fragmentConstants[NUM_PASSES];
+				
+				Array<String>           dependencies;
+			
+			public:
+				ShaderSet(void);
+				// releases the programs it still holds.
+				~ShaderSet(void);
+			
+			private:
+				ShaderSet &operator=(const ShaderSet&) { return *this; }
+		};
+		
 		class D3D9Variable : public Variable
 		{
 			friend class D3D9RenderMaterial;
@@ -81,6 +124,7 @@ class D3D9RenderMaterial : public RenderMaterial
 				
 				void addVertexHandle(ID3DXConstantTable &table, D3DXHANDLE handle);
 				void addFragmentHandle(ID3DXConstantTable &table, D3DXHANDLE handle, Pass pass);
+				void clearHandles(void);
 			
 			private:
 				D3D9Variable &operator=(const D3D9Variable&) { return *this; }
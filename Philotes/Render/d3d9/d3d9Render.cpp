@@ -91,6 +91,8 @@ D3D9Render::D3DXInterface::D3DXInterface(void)
 		    ph_assert2(m_##_name, "Unable to find D3DX9 Function " #_name " in " D3DX_DLL ".");
 		
 		FIND_D3DX_FUNCTION(D3DXCompileShaderFromFileA)
+		FIND_D3DX_FUNCTION(D3DXPreprocessShaderFromFileA)
+		FIND_D3DX_FUNCTION(D3DXGetShaderConstantTable)
 		FIND_D3DX_FUNCTION(D3DXGetVertexShaderProfile)
 		FIND_D3DX_FUNCTION(D3DXGetPixelShaderProfile)
 		
@@ -124,6 +126,21 @@ HRESULT D3D9Render::D3DXInterface::CompileShaderFromFileA(LPCSTR srcFile, CONST
 
 }
 
+HRESULT D3D9Render::D3DXInterface::PreprocessShaderFromFileA(LPCSTR srcFile, CONST D3DXMACRO *defines, LPD3DXINCLUDE include,
+															LPD3DXBUFFER *shaderText, LPD3DXBUFFER *errorMsgs)
+{
+	HRESULT result = D3DERR_NOTAVAILABLE;
+	CALL_D3DX_FUNCTION(D3DXPreprocessShaderFromFileA, (srcFile, defines, include, shaderText, errorMsgs));
+	return result;
+}
+
+HRESULT D3D9Render::D3DXInterface::GetShaderConstantTable(CONST DWORD *function, LPD3DXCONSTANTTABLE *constantTable)
+{
+	HRESULT result = D3DERR_NOTAVAILABLE;
+	CALL_D3DX_FUNCTION(D3DXGetShaderConstantTable, (function, constantTable));
+	return result;
+}
+
 LPCSTR D3D9Render::D3DXInterface::GetVertexShaderProfile(LPDIRECT3DDEVICE9 device)
 {
 
@@ -46,6 +46,8 @@ class D3D9Render : public Render
 			
 			public:
 				HRESULT CompileShaderFromFileA(LPCSTR srcFile, CONST D3DXMACRO *defines, LPD3DXINCLUDE include, LPCSTR functionName, LPCSTR profile, DWORD flags, LPD3DXBUFFER *shader, LPD3DXBUFFER *errorMsgs, LPD3DXCONSTANTTABLE *constantTable);
+				HRESULT PreprocessShaderFromFileA(LPCSTR srcFile, CONST D3DXMACRO *defines, LPD3DXINCLUDE include, LPD3DXBUFFER *shaderText, LPD3DXBUFFER *errorMsgs);
+				HRESULT GetShaderConstantTable(CONST DWORD *function, LPD3DXCONSTANTTABLE *constantTable);
 				LPCSTR  GetVertexShaderProfile(LPDIRECT3DDEVICE9 device);
 				LPCSTR  GetPixelShaderProfile(LPDIRECT3DDEVICE9 device);
 				
@@ -58,6 +60,8 @@ class D3D9Render : public Render
 				    LP##_name m_##_name;
 				
 				DEFINE_D3DX_FUNCTION(D3DXCompileShaderFromFileA, HRESULT, (LPCSTR, CONST D3DXMACRO*, LPD3DXINCLUDE, LPCSTR, LPCSTR, DWORD, LPD3DXBUFFER*, LPD3DXBUFFER*, LPD3DXCONSTANTTABLE *))
+				DEFINE_D3DX_FUNCTION(D3DXPreprocessShaderFromFileA, HRESULT, (LPCSTR, CONST D3DXMACRO*, LPD3DXINCLUDE, LPD3DXBUFFER*, LPD3DXBUFFER*))
+				DEFINE_D3DX_FUNCTION(D3DXGetShaderConstantTable, HRESULT, (CONST DWORD*, LPD3DXCONSTANTTABLE*))
 				DEFINE_D3DX_FUNCTION(D3DXGetVertexShaderProfile, LPCSTR, (LPDIRECT3DDEVICE9));
 				DEFINE_D3DX_FUNCTION(D3DXGetPixelShaderProfile,  LPCSTR, (LPDIRECT3DDEVICE9));
 				
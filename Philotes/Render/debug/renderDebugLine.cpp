@@ -13,6 +13,8 @@
 #include "renderMaterialInstance.h"
 #include "renderTransform.h"
 
+#include "math/mathBatch.h"
+
 _NAMESPACE_BEGIN
 
 RenderLineElement::RenderLineElement() : 
@@ -177,18 +179,33 @@ void RenderLineElement::checkUnlock( void )
 	}
 }
 
-void RenderLineElement::addPoint( const Vector3 &p, const Colour &color )
+void RenderLineElement::addPoints( const Matrix4 *xform, const Vector3 *points, uint32 numPoints, const Colour &color )
 {
-	ph_assert(m_maxVerts > m_numVerts);
+	ph_assert(m_maxVerts >= m_numVerts + numPoints);
 	{
 		checkLock();
 		if(m_lockedPositions && m_lockedColors)
 		{
-			memcpy(((uint8*)m_lockedPositions) + (m_positionStride*m_numVerts), &p,     sizeof(Vector3));
+			Vector3 *positions = (Vector3*)(((uint8*)m_lockedPositions) + (m_positionStride*m_numVerts));
+			if(xform)
+			{
+				MathBatch::transformPoints(*xform, points, positions, numPoints, sizeof(Vector3), m_positionStride);
+			}
+			else
+			{
+				for(uint32 i=0; i<numPoints; i++)
+				{
+					memcpy(((uint8*)positions) + (m_positionStride*i), &points[i], sizeof(Vector3));
+				}
+			}
 
 			uint32 c = color.getAsARGB();
-			memcpy(((uint8*)m_lockedColors)    + (m_colorStride*m_numVerts),    &c,		sizeof(uint32));
-			m_numVerts++;
+			uint8 *colors = ((uint8*)m_lockedColors) + (m_colorStride*m_numVerts);
+			for(uint32 i=0; i<numPoints; i++)
+			{
+				memcpy(colors + (m_colorStride*i), &c, sizeof(uint32));
+			}
+			m_numVerts += numPoints;
 		}
 	}
 }
@@ -206,10 +223,24 @@ bool RenderLineElement::preQueuedToRender()
 
 void RenderLineElement::addLine( const Vector3 &p0,const Vector3 &p1,const Colour& color )
 {
-	checkResizeLine(m_numVerts+2);
+	const Vector3 points[2] = { p0, p1 };
+	addLines(points,2,color);
+}
+
+void RenderLineElement::addLines( const Vector3 *points,uint32 numPoints,const Colour& color )
+{
+	ph_assert((numPoints & 1) == 0);
+	checkResizeLine(m_numVerts+numPoints);
+
+	addPoints(0,points,numPoints,color);
+}
+
+void RenderLineElement::addLines( const Matrix4 &xform,const Vector3 *points,uint32 numPoints,const Colour& color )
+{
+	ph_assert((numPoints & 1) == 0);
+	checkResizeLine(m_numVerts+numPoints);
 
-	addPoint(p0,color);
-	addPoint(p1,color);
+	addPoints(&xform,points,numPoints,color);
 }
 
 Philo::scalar RenderLineElement::getBoundingRadius( void ) const
@@ -19,6 +19,10 @@ public:
 public:
 
 	void addLine(const Vector3 &p0,const Vector3 &p1,const Colour& color);
+
+	void addLines(const Vector3 *points,uint32 numPoints,const Colour& color);
+
+	void addLines(const Matrix4 &xform,const Vector3 *points,uint32 numPoints,const Colour& color);
 	
 	void checkResizeLine(uint32 maxVerts);
 
@@ -42,7 +46,7 @@ private:
 
 	void checkUnlock(void);
 
-	void addPoint(const Vector3 &p, const Colour &color);
+	void addPoints(const Matrix4 *xform, const Vector3 *points, uint32 numPoints, const Colour &color);
 
 protected:
 
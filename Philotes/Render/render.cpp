@@ -7,6 +7,7 @@
 #include "renderMaterialInstance.h"
 #include "renderTarget.h"
 #include "renderLight.h"
+#include "renderShaderCache.h"
 
 #include <algorithm>
 
@@ -51,6 +52,10 @@ Render::Render(DriverType driver) :
 	setAmbientColor(Colour(0.25f,0.25f,0.25f,1));
     setClearColor(Colour(0.52f,0.6f,0.7f,1));
 	strncpy_s(m_deviceName, sizeof(m_deviceName), "UNKNOWN", sizeof(m_deviceName));
+
+	String cacheDir(gShadersDir);
+	cacheDir.Append("cache/");
+	m_shaderCache = new RenderShaderCache(cacheDir.c_str());
 }
 
 void Render::setVertexBufferDeferredUnlocking( bool enabled )
@@ -65,6 +70,7 @@ bool Render::getVertexBufferDeferredUnlocking() const
 
 Render::~Render(void)
 {
+	delete m_shaderCache;
 }
 
 void Render::release(void)
@@ -199,7 +205,7 @@ void Render::setClearColor(const Colour &clearColor)
 	m_clearColor   = clearColor;
 }
 
-void Render::renderMeshes(Array<RenderElement*> & meshes, RenderMaterial::Pass pass)
+void Render::renderMeshes(FrameArray<RenderElement*> & meshes, RenderMaterial::Pass pass)
 {
 	RENDERER_PERFZONE(Render_renderMeshes);
 	
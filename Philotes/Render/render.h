@@ -80,6 +80,9 @@ class Render
         // sets the clear color.
 		void setClearColor(const Colour &clearColor);
         Colour& getClearColor() { return m_clearColor; }
+
+		// compiled shader blobs shared by all materials.
+		RenderShaderCache *getShaderCache(void) { return m_shaderCache; }
 		
 public:
 		// clears the offscreen buffers.
@@ -110,7 +113,7 @@ public:
 		virtual void convertProjectionMatrix(const Matrix4& matrix,Matrix4& dest) = 0;
 	
 	private:
-		void renderMeshes(Array<RenderElement*> & meshes, RenderMaterial::Pass pass);
+		void renderMeshes(FrameArray<RenderElement*> & meshes, RenderMaterial::Pass pass);
 		void renderDeferredLights(void);
 	
 	private:
@@ -132,13 +135,16 @@ public:
 	private:
 		const DriverType					m_driver;
 		
-		Array<RenderElement*>				m_visibleLitMeshes;
-		Array<RenderElement*>				m_visibleUnlitMeshes;
-		Array<RenderLight*>					m_visibleLights;
+		// per-frame lists, kept in the frame heap.
+		FrameArray<RenderElement*>			m_visibleLitMeshes;
+		FrameArray<RenderElement*>			m_visibleUnlitMeshes;
+		FrameArray<RenderLight*>			m_visibleLights;
 		
 		Colour								m_ambientColor;
 		Colour								m_clearColor;
 
+		RenderShaderCache*					m_shaderCache;
+
     protected:
 		bool								m_deferredVBUnlock;
 		scalar								m_pixelCenterOffset;
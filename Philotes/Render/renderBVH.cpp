@@ -0,0 +1,870 @@
+#include "renderBVH.h"
+#include "renderTransformElement.h"
+#include "renderFrustum.h"
+#include "math/simd.h"
+
+#include <algorithm>
+#include <float.h>
+
+_NAMESPACE_BEGIN
+
+const RenderBVH::Handle RenderBVH::INVALID_HANDLE;
+
+namespace
+{
+	enum Overlap
+	{
+		OUTSIDE,
+		PARTIAL,
+		INSIDE
+	};
+
+	const int BIN_COUNT = 16;
+
+	// һڵĿڲһ
+	const scalar TRAVERSAL_COST = 1.0f;
+
+	// һ룬ֻõ֮
+	inline scalar surfaceArea(const scalar* minimum, const scalar* maximum)
+	{
+		const scalar dx = maximum[0] - minimum[0];
+		const scalar dy = maximum[1] - minimum[1];
+		const scalar dz = maximum[2] - minimum[2];
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	inline void clearBounds(scalar* minimum, scalar* maximum)
+	{
+		for (int a = 0; a < 3; ++a)
+		{
+			minimum[a] = FLT_MAX;
+			maximum[a] = -FLT_MAX;
+		}
+		minimum[3] = 0;
+		maximum[3] = 0;
+	}
+
+	inline void growBounds(scalar* minimum, scalar* maximum, const scalar* otherMin, const scalar* otherMax)
+	{
+		for (int a = 0; a < 3; ++a)
+		{
+			minimum[a] = Math::Min(minimum[a], otherMin[a]);
+			maximum[a] = Math::Max(maximum[a], otherMax[a]);
+		}
+	}
+
+	// axis˫ģmin + maxڵͰ
+	inline int binIndex(const scalar* minimum, const scalar* maximum, int axis, scalar origin, scalar scale)
+	{
+		const int bin = (int)((minimum[axis] + maximum[axis] - origin) * scale);
+		return bin < 0 ? 0 : (bin >= BIN_COUNT ? BIN_COUNT - 1 : bin);
+	}
+
+	struct Bin
+	{
+		scalar		minimum[4];
+		scalar		maximum[4];
+		SizeT		count;
+	};
+
+	// ѯõĲԣminimummaximumĺӷ󽻣
+	// Ϊ4scalarwΪ0
+
+	/// ͹壬ƽ水4һΪnx, ny, nz, dָڲ
+	struct VolumeTest
+	{
+		enum
+		{
+			MAX_PLANES = 16
+		};
+
+		VolumeTest(const RenderFrustum* frustum)
+		{
+			// ԶԶü治õκ
+			init(frustum->getFrustumPlanes(), 6, false, frustum->getFarClipDistance() == 0 ? FRUSTUM_PLANE_FAR : -1);
+		}
+
+		VolumeTest(const PlaneBoundedVolume& volume)
+		{
+			init(volume.planes.empty() ? NULL : &volume.planes[0], (SizeT)volume.planes.size(),
+				volume.outside == Plane::POSITIVE_SIDE, -1);
+		}
+
+		void init(const Plane* planes, SizeT numPlanes, bool flip, IndexT skip)
+		{
+			SizeT n = 0;
+			for (IndexT i = 0; i < numPlanes; ++i)
+			{
+				if (i == skip)
+				{
+					continue;
+				}
+				ph_assert(n < MAX_PLANES);
+
+				const scalar sign = flip ? -1.0f : 1.0f;
+				scalar* group = &soa[n / 4][0][0];
+				group[n % 4] = planes[i].normal.x * sign;
+				group[4 + n % 4] = planes[i].normal.y * sign;
+				group[8 + n % 4] = planes[i].normal.z * sign;
+				group[12 + n % 4] = planes[i].d * sign;
+				++n;
+			}
+
+			// õƽ棬кӶڲ
+			numGroups = (n + 3) / 4;
+			for (; n < numGroups * 4; ++n)
+			{
+				scalar* group = &soa[n / 4][0][0];
+				group[n % 4] = 0;
+				group[4 + n % 4] = 0;
+				group[8 + n % 4] = 0;
+				group[12 + n % 4] = 1.0f;
+			}
+		}
+
+		Overlap classify(const scalar* minimum, const scalar* maximum) const
+		{
+			// ƽľͶӰ뾶ʱƽ֮⣬
+			// ȫÿƽڲʱ
+#if PH_MATH_SIMD
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 boxMin = Simd::Load(minimum);
+			const __m128 boxMax = Simd::Load(maximum);
+			const __m128 center = _mm_mul_ps(_mm_add_ps(boxMax, boxMin), half);
+			const __m128 halfSize = _mm_mul_ps(_mm_sub_ps(boxMax, boxMin), half);
+			const __m128 cx = PH_SIMD_SWIZZLE(center, 0, 0, 0, 0);
+			const __m128 cy = PH_SIMD_SWIZZLE(center, 1, 1, 1, 1);
+			const __m128 cz = PH_SIMD_SWIZZLE(center, 2, 2, 2, 2);
+			const __m128 hx = PH_SIMD_SWIZZLE(halfSize, 0, 0, 0, 0);
+			const __m128 hy = PH_SIMD_SWIZZLE(halfSize, 1, 1, 1, 1);
+			const __m128 hz = PH_SIMD_SWIZZLE(halfSize, 2, 2, 2, 2);
+
+			int partial = 0;
+			for (SizeT g = 0; g < numGroups; ++g)
+			{
+				const __m128 nx = Simd::Load(soa[g][0]);
+				const __m128 ny = Simd::Load(soa[g][1]);
+				const __m128 nz = Simd::Load(soa[g][2]);
+				const __m128 d = Simd::Load(soa[g][3]);
+
+				__m128 distance = _mm_add_ps(_mm_mul_ps(nx, cx), d);
+				distance = _mm_add_ps(distance, _mm_mul_ps(ny, cy));
+				distance = _mm_add_ps(distance, _mm_mul_ps(nz, cz));
+				__m128 radius = _mm_mul_ps(Simd::Abs(nx), hx);
+				radius = _mm_add_ps(radius, _mm_mul_ps(Simd::Abs(ny), hy));
+				radius = _mm_add_ps(radius, _mm_mul_ps(Simd::Abs(nz), hz));
+
+				if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero)))
+				{
+					return OUTSIDE;
+				}
+				partial |= _mm_movemask_ps(_mm_cmple_ps(_mm_sub_ps(distance, radius), zero));
+			}
+			return partial ? PARTIAL : INSIDE;
+#else
+			scalar center[3], halfSize[3];
+			for (int a = 0; a < 3; ++a)
+			{
+				center[a] = (maximum[a] + minimum[a]) * 0.5f;
+				halfSize[a] = (maximum[a] - minimum[a]) * 0.5f;
+			}
+
+			Overlap overlap = INSIDE;
+			for (SizeT g = 0; g < numGroups; ++g)
+			{
+				for (int p = 0; p < 4; ++p)
+				{
+					const scalar nx = soa[g][0][p];
+					const scalar ny = soa[g][1][p];
+					const scalar nz = soa[g][2][p];
+					const scalar distance = nx * center[0] + ny * center[1] + nz * center[2] + soa[g][3][p];
+					const scalar radius = Math::Abs(nx) * halfSize[0] + Math::Abs(ny) * halfSize[1] + Math::Abs(nz) * halfSize[2];
+					if (distance + radius < 0)
+					{
+						return OUTSIDE;
+					}
+					if (distance - radius <= 0)
+					{
+						overlap = PARTIAL;
+					}
+				}
+			}
+			return overlap;
+#endif
+		}
+
+		scalar soa[MAX_PLANES / 4][4][4];
+		SizeT numGroups;
+	};
+
+	/// slabԣΪ0ķɼСֵͨ0
+	struct RayTest
+	{
+		RayTest(const Ray& ray)
+		{
+			const Vector3& rayOrigin = ray.getOrigin();
+			const Vector3& direction = ray.getDirection();
+			origin[0] = rayOrigin.x;
+			origin[1] = rayOrigin.y;
+			origin[2] = rayOrigin.z;
+			origin[3] = 0;
+			invDirection[0] = 1.0f / (Math::Abs(direction.x) < 1e-20f ? 1e-20f : direction.x);
+			invDirection[1] = 1.0f / (Math::Abs(direction.y) < 1e-20f ? 1e-20f : direction.y);
+			invDirection[2] = 1.0f / (Math::Abs(direction.z) < 1e-20f ? 1e-20f : direction.z);
+			invDirection[3] = 0;
+		}
+
+		/// ߽ӵľ룬ںʱΪ0δлlimit֮Žʱfalse
+		bool intersects(const scalar* minimum, const scalar* maximum, scalar limit, scalar& distance) const
+		{
+#if PH_MATH_SIMD
+			const __m128 o = Simd::Load(origin);
+			const __m128 inv = Simd::Load(invDirection);
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(Simd::Load(minimum), o), inv);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(Simd::Load(maximum), o), inv);
+
+			// wΪ0nearwͨ0ʼfarwͨlimitΪֹ
+			__m128 tNear = _mm_min_ps(t0, t1);
+			__m128 tFar = _mm_max_ps(t0, t1);
+			tFar = _mm_or_ps(_mm_and_ps(tFar, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0))), _mm_setr_ps(0, 0, 0, limit));
+
+			tNear = _mm_max_ps(tNear, PH_SIMD_SWIZZLE(tNear, 2, 3, 0, 1));
+			tNear = _mm_max_ps(tNear, PH_SIMD_SWIZZLE(tNear, 1, 0, 3, 2));
+			tFar = _mm_min_ps(tFar, PH_SIMD_SWIZZLE(tFar, 2, 3, 0, 1));
+			tFar = _mm_min_ps(tFar, PH_SIMD_SWIZZLE(tFar, 1, 0, 3, 2));
+			if (!_mm_comile_ss(tNear, tFar))
+			{
+				return false;
+			}
+			distance = _mm_cvtss_f32(tNear);
+			return true;
+#else
+			scalar tNear = 0;
+			scalar tFar = limit;
+			for (int a = 0; a < 3; ++a)
+			{
+				const scalar t0 = (minimum[a] - origin[a]) * invDirection[a];
+				const scalar t1 = (maximum[a] - origin[a]) * invDirection[a];
+				tNear = Math::Max(tNear, Math::Min(t0, t1));
+				tFar = Math::Min(tFar, Math::Max(t0, t1));
+			}
+			if (tNear > tFar)
+			{
+				return false;
+			}
+			distance = tNear;
+			return true;
+#endif
+		}
+
+		scalar origin[4];
+		scalar invDirection[4];
+	};
+}
+
+RenderBVH::RenderBVH()
+	:m_root(InvalidIndex),
+	m_numItems(0),
+	m_numDynamic(0),
+	m_structureDirty(false)
+{
+}
+
+RenderBVH::~RenderBVH()
+{
+	for (IndexT i = 0; i < m_items.Size(); ++i)
+	{
+		if (m_items[i].element)
+		{
+			m_items[i].element->_notifyBVH(NULL, INVALID_HANDLE);
+		}
+	}
+}
+
+RenderBVH::Handle RenderBVH::add( RenderTransformElement* element, bool dynamic )
+{
+	// ֻһУϲĲѯظ
+	ph_assert(element && !element->getBVH() && !element->getOctree());
+
+	Handle handle;
+	if (!m_freeHandles.IsEmpty())
+	{
+		handle = m_freeHandles.Back();
+		m_freeHandles.PopBack();
+	}
+	else
+	{
+		handle = (Handle)m_items.Size();
+		m_items.Append(Item());
+	}
+
+	// Χrebuild()ȡ
+	Item& item = m_items[handle];
+	item.element = element;
+	clearBounds(item.minimum, item.maximum);
+	item.extent = AxisAlignedBox::EXTENT_NULL;
+	item.dynamic = dynamic;
+
+	++m_numItems;
+	if (dynamic)
+	{
+		++m_numDynamic;
+	}
+	m_structureDirty = true;
+
+	element->_notifyBVH(this, handle);
+	return handle;
+}
+
+void RenderBVH::remove( Handle handle )
+{
+	Item& item = m_items[handle];
+	ph_assert(item.element);
+
+	item.element->_notifyBVH(NULL, INVALID_HANDLE);
+	item.element = NULL;
+
+	--m_numItems;
+	if (item.dynamic)
+	{
+		--m_numDynamic;
+	}
+
+	// ؽ֮ǰҶӻѯʱ
+	m_removedHandles.Append(handle);
+	m_structureDirty = true;
+}
+
+void RenderBVH::update()
+{
+	bool moved = false;
+	if (!m_structureDirty && m_numDynamic > 0)
+	{
+		for (IndexT i = 0; i < m_items.Size(); ++i)
+		{
+			Item& item = m_items[i];
+			if (!item.element || !item.dynamic)
+			{
+				continue;
+			}
+
+			const uint8 extent = item.extent;
+			if (readBounds(item))
+			{
+				moved = true;
+				// յĺ޴İΧз
+				if (item.extent != extent)
+				{
+					m_structureDirty = true;
+				}
+			}
+		}
+	}
+
+	if (m_structureDirty)
+	{
+		rebuild();
+	}
+	else if (moved)
+	{
+		refitNode(m_root);
+		m_root = rebuildDegraded(m_root);
+	}
+}
+
+void RenderBVH::rebuild()
+{
+	m_freeHandles.AppendArray(m_removedHandles);
+	m_removedHandles.Clear();
+
+	m_nodes.Clear();
+	m_freeNodes.Clear();
+	m_primitives.Clear();
+	m_unbounded.Clear();
+
+	for (IndexT i = 0; i < m_items.Size(); ++i)
+	{
+		Item& item = m_items[i];
+		if (!item.element)
+		{
+			continue;
+		}
+
+		readBounds(item);
+		if (item.extent == AxisAlignedBox::EXTENT_FINITE)
+		{
+			m_primitives.Append((Handle)i);
+		}
+		else if (item.extent == AxisAlignedBox::EXTENT_INFINITE)
+		{
+			m_unbounded.Append((Handle)i);
+		}
+	}
+
+	m_root = m_primitives.IsEmpty() ? InvalidIndex : buildNode(0, m_primitives.Size());
+	m_structureDirty = false;
+}
+
+void RenderBVH::findVisible( const RenderFrustum* frustum, Array<RenderTransformElement*>& result ) const
+{
+	collectUnbounded(result);
+	if (m_root != InvalidIndex)
+	{
+		collect(VolumeTest(frustum), m_root, false, result);
+	}
+}
+
+void RenderBVH::findIntersecting( const PlaneBoundedVolume& volume, Array<RenderTransformElement*>& result ) const
+{
+	collectUnbounded(result);
+	if (m_root != InvalidIndex)
+	{
+		collect(VolumeTest(volume), m_root, false, result);
+	}
+}
+
+void RenderBVH::findIntersecting( const Ray& ray, Array<RayHit>& result, bool sortByDistance /*= true*/ ) const
+{
+	SizeT first = result.Size();
+	for (IndexT i = 0; i < m_unbounded.Size(); ++i)
+	{
+		const Item& item = m_items[m_unbounded[i]];
+		if (item.element)
+		{
+			RayHit rayHit;
+			rayHit.element = item.element;
+			rayHit.distance = 0;
+			result.Append(rayHit);
+		}
+	}
+	if (m_root != InvalidIndex)
+	{
+		collect(RayTest(ray), m_root, result);
+	}
+
+	if (sortByDistance && result.Size() - first > 1)
+	{
+		std::sort(result.Begin() + first, result.End());
+	}
+}
+
+bool RenderBVH::findNearest( const Ray& ray, RayHit& hit ) const
+{
+	hit.element = NULL;
+	hit.distance = FLT_MAX;
+	if (m_root == InvalidIndex)
+	{
+		return false;
+	}
+
+	const RayTest test(ray);
+	const Node& root = m_nodes[m_root];
+	scalar distance;
+	return test.intersects(root.minimum, root.maximum, hit.distance, distance) && collectNearest(test, m_root, hit);
+}
+
+scalar RenderBVH::getCost() const
+{
+	if (m_root == InvalidIndex)
+	{
+		return 0;
+	}
+
+	const Node& root = m_nodes[m_root];
+	const scalar rootArea = surfaceArea(root.minimum, root.maximum);
+	return rootArea > 0 ? getSubtreeArea(m_root) / rootArea : (scalar)getNumNodes();
+}
+
+template<class TEST>
+void RenderBVH::collect( const TEST& test, IndexT nodeIndex, bool inside, Array<RenderTransformElement*>& result ) const
+{
+	const Node& node = m_nodes[nodeIndex];
+
+	if (!inside)
+	{
+		Overlap overlap = test.classify(node.minimum, node.maximum);
+		if (overlap == OUTSIDE)
+		{
+			return;
+		}
+		inside = overlap == INSIDE;
+	}
+
+	// ڵµm_primitivesеһΣȫڲѯΧڵĽڵȡ
+	if (inside || node.children[0] == InvalidIndex)
+	{
+		for (IndexT i = node.first; i < node.first + node.count; ++i)
+		{
+			const Item& item = m_items[m_primitives[i]];
+			if (item.element && (inside || test.classify(item.minimum, item.maximum) != OUTSIDE))
+			{
+				result.Append(item.element);
+			}
+		}
+		return;
+	}
+
+	collect(test, node.children[0], false, result);
+	collect(test, node.children[1], false, result);
+}
+
+template<class TEST>
+void RenderBVH::collect( const TEST& ray, IndexT nodeIndex, Array<RayHit>& result ) const
+{
+	const Node& node = m_nodes[nodeIndex];
+
+	scalar distance;
+	if (!ray.intersects(node.minimum, node.maximum, FLT_MAX, distance))
+	{
+		return;
+	}
+
+	if (node.children[0] != InvalidIndex)
+	{
+		collect(ray, node.children[0], result);
+		collect(ray, node.children[1], result);
+		return;
+	}
+
+	for (IndexT i = node.first; i < node.first + node.count; ++i)
+	{
+		const Item& item = m_items[m_primitives[i]];
+		if (item.element && ray.intersects(item.minimum, item.maximum, FLT_MAX, distance))
+		{
+			RayHit rayHit;
+			rayHit.element = item.element;
+			rayHit.distance = distance;
+			result.Append(rayHit);
+		}
+	}
+}
+
+template<class TEST>
+bool RenderBVH::collectNearest( const TEST& ray, IndexT nodeIndex, RayHit& hit ) const
+{
+	const Node& node = m_nodes[nodeIndex];
+
+	if (node.children[0] == InvalidIndex)
+	{
+		bool found = false;
+		for (IndexT i = node.first; i < node.first + node.count; ++i)
+		{
+			const Item& item = m_items[m_primitives[i]];
+			scalar distance;
+			if (item.element && ray.intersects(item.minimum, item.maximum, hit.distance, distance))
+			{
+				hit.element = item.element;
+				hit.distance = distance;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	scalar distances[2];
+	bool hits[2];
+	for (int c = 0; c < 2; ++c)
+	{
+		const Node& child = m_nodes[node.children[c]];
+		hits[c] = ray.intersects(child.minimum, child.maximum, hit.distance, distances[c]);
+	}
+
+	// ȷʽϽӽڵ㣬еĽһط
+	const int nearer = hits[1] && (!hits[0] || distances[1] < distances[0]) ? 1 : 0;
+	bool found = false;
+	for (int i = 0; i < 2; ++i)
+	{
+		const int c = nearer ^ i;
+		if (hits[c] && distances[c] <= hit.distance)
+		{
+			found = collectNearest(ray, node.children[c], hit) || found;
+		}
+	}
+	return found;
+}
+
+void RenderBVH::collectUnbounded( Array<RenderTransformElement*>& result ) const
+{
+	for (IndexT i = 0; i < m_unbounded.Size(); ++i)
+	{
+		const Item& item = m_items[m_unbounded[i]];
+		if (item.element)
+		{
+			result.Append(item.element);
+		}
+	}
+}
+
+bool RenderBVH::readBounds( Item& item )
+{
+	// RenderTransform::_updateBounds()
+	const AxisAlignedBox& bounds = item.element->isAttached() ? item.element->getWorldBoundingBox() : AxisAlignedBox::BOX_NULL;
+	if (bounds.isNull() || bounds.isInfinite())
+	{
+		const uint8 extent = bounds.isNull() ? AxisAlignedBox::EXTENT_NULL : AxisAlignedBox::EXTENT_INFINITE;
+		const bool changed = item.extent != extent;
+		item.extent = extent;
+		return changed;
+	}
+
+	const Vector3& minimum = bounds.getMinimum();
+	const Vector3& maximum = bounds.getMaximum();
+	const bool changed = item.extent != AxisAlignedBox::EXTENT_FINITE ||
+		item.minimum[0] != minimum.x || item.minimum[1] != minimum.y || item.minimum[2] != minimum.z ||
+		item.maximum[0] != maximum.x || item.maximum[1] != maximum.y || item.maximum[2] != maximum.z;
+
+	item.extent = AxisAlignedBox::EXTENT_FINITE;
+	item.minimum[0] = minimum.x;
+	item.minimum[1] = minimum.y;
+	item.minimum[2] = minimum.z;
+	item.maximum[0] = maximum.x;
+	item.maximum[1] = maximum.y;
+	item.maximum[2] = maximum.z;
+	return changed;
+}
+
+IndexT RenderBVH::buildNode( IndexT first, SizeT count )
+{
+	scalar minimum[4], maximum[4];
+	scalar centroidMin[4], centroidMax[4];
+	clearBounds(minimum, maximum);
+	clearBounds(centroidMin, centroidMax);
+	bool hasDynamic = false;
+	for (IndexT i = first; i < first + count; ++i)
+	{
+		const Item& item = m_items[m_primitives[i]];
+		growBounds(minimum, maximum, item.minimum, item.maximum);
+
+		// ȡ˫min + max
+		scalar centroid[3];
+		for (int a = 0; a < 3; ++a)
+		{
+			centroid[a] = item.minimum[a] + item.maximum[a];
+		}
+		growBounds(centroidMin, centroidMax, centroid, centroid);
+		hasDynamic |= item.dynamic;
+	}
+
+	const IndexT nodeIndex = createNode();
+	{
+		Node& node = m_nodes[nodeIndex];
+		for (int a = 0; a < 4; ++a)
+		{
+			node.minimum[a] = minimum[a];
+			node.maximum[a] = maximum[a];
+		}
+		node.first = first;
+		node.count = count;
+		node.buildArea = surfaceArea(minimum, maximum);
+		node.hasDynamic = hasDynamic;
+	}
+
+	if (count <= RENDERER_BVH_LEAF_SIZE)
+	{
+		return nodeIndex;
+	}
+
+	// ͰSAHڵţҶΪ area * countָΪ
+	// area * TRAVERSAL_COST + area(left) * count(left) + area(right) * count(right)
+	const scalar area = surfaceArea(minimum, maximum);
+	int bestAxis = -1;
+	int bestSplit = 0;
+	scalar bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const scalar extent = centroidMax[axis] - centroidMin[axis];
+		if (extent <= 0)
+		{
+			continue;
+		}
+		const scalar scale = BIN_COUNT / extent;
+
+		Bin bins[BIN_COUNT];
+		for (int b = 0; b < BIN_COUNT; ++b)
+		{
+			clearBounds(bins[b].minimum, bins[b].maximum);
+			bins[b].count = 0;
+		}
+		for (IndexT i = first; i < first + count; ++i)
+		{
+			const Item& item = m_items[m_primitives[i]];
+			Bin& bin = bins[binIndex(item.minimum, item.maximum, axis, centroidMin[axis], scale)];
+			growBounds(bin.minimum, bin.maximum, item.minimum, item.maximum);
+			++bin.count;
+		}
+
+		// ָλssµͰֵߣȴۼҲ
+		scalar rightArea[BIN_COUNT];
+		SizeT rightCount[BIN_COUNT];
+		scalar sideMin[4], sideMax[4];
+		clearBounds(sideMin, sideMax);
+		SizeT sideCount = 0;
+		for (int s = BIN_COUNT - 1; s > 0; --s)
+		{
+			growBounds(sideMin, sideMax, bins[s].minimum, bins[s].maximum);
+			sideCount += bins[s].count;
+			rightArea[s] = sideCount ? surfaceArea(sideMin, sideMax) : 0;
+			rightCount[s] = sideCount;
+		}
+
+		clearBounds(sideMin, sideMax);
+		sideCount = 0;
+		for (int s = 1; s < BIN_COUNT; ++s)
+		{
+			growBounds(sideMin, sideMax, bins[s - 1].minimum, bins[s - 1].maximum);
+			sideCount += bins[s - 1].count;
+			if (sideCount == 0 || rightCount[s] == 0)
+			{
+				continue;
+			}
+
+			const scalar cost = area * TRAVERSAL_COST + surfaceArea(sideMin, sideMax) * sideCount + rightArea[s] * rightCount[s];
+			if (cost < bestCost)
+			{
+				bestAxis = axis;
+				bestSplit = s;
+				bestCost = cost;
+			}
+		}
+	}
+
+	// ҶӼʹSAHҲҪָ
+	if ((bestAxis < 0 || bestCost >= area * count) && count <= RENDERER_BVH_MAX_LEAF_SIZE)
+	{
+		return nodeIndex;
+	}
+
+	IndexT middle;
+	if (bestAxis >= 0)
+	{
+		const scalar scale = BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		IndexT left = first;
+		IndexT right = first + count - 1;
+		while (left <= right)
+		{
+			const Item& item = m_items[m_primitives[left]];
+			if (binIndex(item.minimum, item.maximum, bestAxis, centroidMin[bestAxis], scale) < bestSplit)
+			{
+				++left;
+			}
+			else
+			{
+				std::swap(m_primitives[left], m_primitives[right]);
+				--right;
+			}
+		}
+		middle = left;
+	}
+	else
+	{
+		// غϣֳ뼴
+		middle = first + count / 2;
+	}
+
+	const IndexT leftChild = buildNode(first, middle - first);
+	const IndexT rightChild = buildNode(middle, first + count - middle);
+
+	// createNode()ƶm_nodes
+	Node& node = m_nodes[nodeIndex];
+	node.children[0] = leftChild;
+	node.children[1] = rightChild;
+	return nodeIndex;
+}
+
+void RenderBVH::refitNode( IndexT nodeIndex )
+{
+	Node& node = m_nodes[nodeIndex];
+	if (!node.hasDynamic)
+	{
+		return;
+	}
+
+	clearBounds(node.minimum, node.maximum);
+	if (node.children[0] == InvalidIndex)
+	{
+		for (IndexT i = node.first; i < node.first + node.count; ++i)
+		{
+			const Item& item = m_items[m_primitives[i]];
+			growBounds(node.minimum, node.maximum, item.minimum, item.maximum);
+		}
+		return;
+	}
+
+	for (int c = 0; c < 2; ++c)
+	{
+		const Node& child = m_nodes[node.children[c]];
+		refitNode(node.children[c]);
+		growBounds(node.minimum, node.maximum, child.minimum, child.maximum);
+	}
+}
+
+IndexT RenderBVH::rebuildDegraded( IndexT nodeIndex )
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (!node.hasDynamic || node.children[0] == InvalidIndex)
+	{
+		return nodeIndex;
+	}
+
+	// m_primitivesеķΧͰΧУֻڵ
+	if (surfaceArea(node.minimum, node.maximum) > RENDERER_BVH_REBUILD_RATIO * node.buildArea)
+	{
+		const IndexT first = node.first;
+		const SizeT count = node.count;
+		releaseNode(nodeIndex);
+		return buildNode(first, count);
+	}
+
+	const IndexT left = node.children[0];
+	const IndexT right = node.children[1];
+	const IndexT newLeft = rebuildDegraded(left);
+	const IndexT newRight = rebuildDegraded(right);
+	m_nodes[nodeIndex].children[0] = newLeft;
+	m_nodes[nodeIndex].children[1] = newRight;
+	return nodeIndex;
+}
+
+scalar RenderBVH::getSubtreeArea( IndexT nodeIndex ) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	scalar area = surfaceArea(node.minimum, node.maximum);
+	if (node.children[0] != InvalidIndex)
+	{
+		area += getSubtreeArea(node.children[0]) + getSubtreeArea(node.children[1]);
+	}
+	return area;
+}
+
+IndexT RenderBVH::createNode()
+{
+	IndexT nodeIndex;
+	if (!m_freeNodes.IsEmpty())
+	{
+		nodeIndex = m_freeNodes.Back();
+		m_freeNodes.PopBack();
+	}
+	else
+	{
+		nodeIndex = m_nodes.Size();
+		m_nodes.Append(Node());
+	}
+
+	Node& node = m_nodes[nodeIndex];
+	node.children[0] = InvalidIndex;
+	node.children[1] = InvalidIndex;
+	return nodeIndex;
+}
+
+void RenderBVH::releaseNode( IndexT nodeIndex )
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (node.children[0] != InvalidIndex)
+	{
+		releaseNode(node.children[0]);
+		releaseNode(node.children[1]);
+	}
+	m_freeNodes.Append(nodeIndex);
+}
+
+_NAMESPACE_END
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "renderOctree.h"
+#include "math/planeBoundedVolume.h"
+
+_NAMESPACE_BEGIN
+
+/** Bounding volume hierarchy over the world bounds of RenderTransformElements.
+@remarks
+	The tree is built top down with the surface area heuristic, the
+	centroids of the elements are sorted into 16 bins per axis and the
+	cheapest split between two bins is taken, or a leaf if splitting costs
+	more than testing the elements. Adding or removing elements rebuilds
+	the whole tree at the next update(), which suits static geometry.
+@par
+	Dynamic elements are read again by every update() and the bounds of
+	the tree are refitted bottom up. Refitting keeps the tree valid but
+	not good: when the surface area of a subtree has grown to more than
+	RENDERER_BVH_REBUILD_RATIO times its area when it was built, that
+	subtree alone is built again, a degraded root rebuilds everything.
+@par
+	With PH_MATH_SIMD the nodes are tested with SSE: a ray is a single
+	slab test over x, y and z, a volume is tested against 4 planes at a
+	time. Nodes completely inside a volume are taken without testing
+	their elements.
+@par
+	A scene only puts elements flagged with RenderTransformElement::setStatic()
+	in here, as static elements, all others go to the octree. Elements are not
+	static by default, so the BVH of a scene stays empty until the application
+	marks its fixed geometry as static. Dynamic elements, add(element, true),
+	are for a RenderBVH used on its own.
+*/
+class RenderBVH
+{
+	PH_DECLARE_HEAP_ALLOC(Memory::RenderHeap)
+
+public:
+
+	typedef uint32 Handle;
+
+	static const Handle INVALID_HANDLE = 0xffffffff;
+
+	typedef RenderOctree::RayHit RayHit;
+
+	RenderBVH();
+
+	~RenderBVH();
+
+public:
+
+	/** Adds an element, it is part of the tree after the next update().
+	@remarks
+		The bounds of static elements are read once, when the tree is built.
+		The element keeps its handle, see RenderTransformElement::getBVH(),
+		and removes itself when it is destroyed.
+	*/
+	Handle					add(RenderTransformElement* element, bool dynamic);
+
+	void					remove(Handle handle);
+
+	/** Rebuilds the tree if elements were added or removed, otherwise refits the dynamic elements. */
+	void					update();
+
+	/** Builds the whole tree from the current bounds of all elements. */
+	void					rebuild();
+
+	/** Finds the elements inside or intersecting a frustum. */
+	void					findVisible(const RenderFrustum* frustum, Array<RenderTransformElement*>& result) const;
+
+	/** Finds the elements inside or intersecting a convex volume, e.g. RenderCamera::getCameraToViewportBoxVolume(). */
+	void					findIntersecting(const PlaneBoundedVolume& volume, Array<RenderTransformElement*>& result) const;
+
+	/** Finds the elements whose bounds a ray hits, sorted by distance if requested. */
+	void					findIntersecting(const Ray& ray, Array<RayHit>& result, bool sortByDistance = true) const;
+
+	/** Finds the element whose bounds the ray hits first, returns false if there is none.
+	@remarks
+		Elements with infinite bounds are hit at distance 0 by every ray,
+		they are left out here.
+	*/
+	bool					findNearest(const Ray& ray, RayHit& hit) const;
+
+	RenderTransformElement*	getElement(Handle handle) const { return m_items[handle].element; }
+
+	SizeT					size() const { return m_numItems; }
+
+	/** Returns the number of nodes in use. */
+	SizeT					getNumNodes() const { return m_nodes.Size() - m_freeNodes.Size(); }
+
+	/** Returns the expected cost of a query relative to testing the root, the sum of node areas over the root area. */
+	scalar					getCost() const;
+
+protected:
+
+	struct Node
+	{
+		scalar		minimum[4];			// x, y, z, 0 for unaligned SSE loads
+		scalar		maximum[4];
+		IndexT		children[2];		// InvalidIndex for leaves
+		IndexT		first;				// the range of m_primitives below the node
+		SizeT		count;
+		scalar		buildArea;			// surface area when the subtree was built
+		bool		hasDynamic;			// refit() skips subtrees of static elements
+	};
+
+	struct Item
+	{
+		RenderTransformElement*	element;	// NULL for free handles
+		scalar		minimum[4];
+		scalar		maximum[4];
+		uint8		extent;				// AxisAlignedBox::Extent
+		bool		dynamic;
+	};
+
+	/// reads the current world bounds of an element, returns true if they changed
+	bool					readBounds(Item& item);
+
+	/// builds a subtree over m_primitives [first, first + count)
+	IndexT					buildNode(IndexT first, SizeT count);
+
+	/// recomputes the bounds of a subtree from its elements
+	void					refitNode(IndexT node);
+
+	/// rebuilds the topmost degraded subtrees, returns the new index of node
+	IndexT					rebuildDegraded(IndexT node);
+
+	scalar					getSubtreeArea(IndexT node) const;
+
+	IndexT					createNode();
+
+	void					releaseNode(IndexT node);
+
+	template<class TEST>
+	void					collect(const TEST& test, IndexT node, bool inside, Array<RenderTransformElement*>& result) const;
+
+	template<class TEST>
+	void					collect(const TEST& ray, IndexT node, Array<RayHit>& result) const;
+
+	/// visits the nearer child first and skips nodes farther than hit
+	template<class TEST>
+	bool					collectNearest(const TEST& ray, IndexT node, RayHit& hit) const;
+
+	void					collectUnbounded(Array<RenderTransformElement*>& result) const;
+
+protected:
+
+	Array<Node>				m_nodes;
+
+	Array<IndexT>			m_freeNodes;
+
+	IndexT					m_root;
+
+	Array<Item>				m_items;
+
+	Array<Handle>			m_freeHandles;
+
+	/// handles removed since the last build, the tree may still refer to them
+	Array<Handle>			m_removedHandles;
+
+	/// handles of the elements with finite bounds in the order of the leaves
+	Array<Handle>			m_primitives;
+
+	/// handles of the elements with infinite bounds, every query finds them
+	Array<Handle>			m_unbounded;
+
+	SizeT					m_numItems;
+
+	SizeT					m_numDynamic;
+
+	bool					m_structureDirty;
+};
+
+_NAMESPACE_END
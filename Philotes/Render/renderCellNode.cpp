@@ -4,28 +4,203 @@
 #include "renderElement.h"
 #include "render.h"
 #include "renderTransformElement.h"
+#include "renderMaterialInstance.h"
+#include "renderCamera.h"
 #include "gearsApplication.h"
+#include "core/jobsystem.h"
 
 _NAMESPACE_BEGIN
 
+// ɼ壺ռʱȼ£̰֮߳˳Ⱦ
+struct CellVisibleEntry
+{
+	RenderElement*	element;
+	scalar			screenSize;
+};
+
+// һռĳCellһӽڵ
+struct CellVisibilityTask
+{
+	RenderCellNode*	cell;
+	IndexT			firstChild;
+	SizeT			numChildren;
+
+	// дڵ߳бΧ
+	IndexT			thread;
+	IndexT			firstEntry;
+	SizeT			numEntries;
+};
+
+_NAMESPACE_END
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::CellVisibleEntry)
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::CellVisibilityTask)
+
+_NAMESPACE_BEGIN
+
+// the camera values computeScreenSize() needs, read once per frame so that the jobs don't touch the camera.
+class ScreenSizeContext
+{
+public:
+
+	ScreenSizeContext(const RenderCamera* camera, uint32 viewportHeight)
+		: m_hasCamera(camera != NULL), m_orthographic(false), m_viewportHeight((scalar)viewportHeight),
+		m_orthoWindowHeight(1), m_nearClipDistance(0), m_halfFov(1)
+	{
+		if(!camera) return;
+
+		m_orthographic = camera->getProjectionType() == PT_ORTHOGRAPHIC;
+		if(m_orthographic)
+		{
+			m_orthoWindowHeight = camera->getOrthoWindowHeight();
+		}
+		else
+		{
+			m_position = camera->getDerivedPosition();
+			m_nearClipDistance = camera->getNearClipDistance();
+			m_halfFov = Math::Tan(camera->getFOVy() * 0.5f);
+		}
+	}
+
+	// projected diameter of the bounding sphere in pixels, feeds the texture streamer.
+	scalar computeScreenSize(const Sphere& bounds) const
+	{
+		if(!m_hasCamera) return m_viewportHeight;
+
+		if(m_orthographic)
+		{
+			return 2 * bounds.getRadius() / m_orthoWindowHeight * m_viewportHeight;
+		}
+
+		scalar distance = m_position.distance(bounds.getCenter());
+		if(distance < m_nearClipDistance) distance = m_nearClipDistance;
+		return bounds.getRadius() / (distance * m_halfFov) * m_viewportHeight;
+	}
+
+private:
+
+	bool m_hasCamera;
+
+	bool m_orthographic;
+
+	scalar m_viewportHeight;
+
+	scalar m_orthoWindowHeight;
+
+	Vector3 m_position;
+
+	scalar m_nearClipDistance;
+
+	scalar m_halfFov;
+};
+
+// ȾУΪĻߴ
+class RenderMeshQueue : public RenderVisibleQueue
+{
+public:
+
+	RenderMeshQueue(Render& render) : m_render(render) {}
+
+	virtual void queueVisible(RenderElement& rend, scalar screenSize)
+	{
+		if(rend.getMaterialInstance())
+		{
+			rend.getMaterialInstance()->noteScreenSize(screenSize);
+		}
+		m_render.queueMeshForRender(rend);
+	}
+
+private:
+
+	RenderMeshQueue &operator=(const RenderMeshQueue&) { return *this; }
+
+	Render& m_render;
+};
+
 class SimpleRenderVisitor : public RenderVisitor
 {
+public:
+
+	SimpleRenderVisitor(RenderVisibleQueue& queue) : m_queue(queue), m_screenSize(0), m_numVisited(0) {}
+
+	virtual void visit(RenderElement* rend,Any* pAny = 0)
+	{
+		m_queue.queueVisible(*rend, m_screenSize);
+		++m_numVisited;
+	}
+
+	void setScreenSize(scalar screenSize) { m_screenSize = screenSize; }
+
+	SizeT getNumVisited() const { return m_numVisited; }
+
+private:
+
+	SimpleRenderVisitor &operator=(const SimpleRenderVisitor&) { return *this; }
+
+	RenderVisibleQueue& m_queue;
+
+	scalar m_screenSize;
+
+	SizeT m_numVisited;
+};
+
+// ռãֻ¼Ⱦ
+class CollectRenderVisitor : public RenderVisitor
+{
+public:
+
+	CollectRenderVisitor(FrameArray<CellVisibleEntry>& entries) : m_entries(entries), m_screenSize(0) {}
+
 	virtual void visit(RenderElement* rend,Any* pAny = 0)
 	{
-		GearApplication::getApp()->getRender()->queueMeshForRender(*rend);
+		CellVisibleEntry entry;
+		entry.element = rend;
+		entry.screenSize = m_screenSize;
+		m_entries.Append(entry);
+	}
+
+	void setScreenSize(scalar screenSize) { m_screenSize = screenSize; }
+
+private:
+
+	CollectRenderVisitor &operator=(const CollectRenderVisitor&) { return *this; }
+
+	FrameArray<CellVisibleEntry>& m_entries;
+
+	scalar m_screenSize;
+};
+
+template<class VISITOR>
+static void visitAttachedObjects(const ScreenSizeContext& context, RenderTransform* tn, VISITOR& visitor)
+{
+	// TODO : Ч
+	size_t at = tn->numAttachedObjects();
+	for (size_t i=0; i<at; i++)
+	{
+		RenderTransformElement* obj = tn->getAttachedObject(i);
+		visitor.setScreenSize(context.computeScreenSize(obj->getWorldBoundingSphere()));
+		obj->visitRenderElement(&visitor);
 	}
+}
+
+// collectVisibleJob()Ĳ
+struct CellVisibilityJobData
+{
+	const ScreenSizeContext*		context;
+	CellVisibilityTask*				tasks;
+	FrameArray<CellVisibleEntry>*	lists;		// ÿ߳һ
 };
 
 //////////////////////////////////////////////////////////////////////////
 
 RenderCellNode::RenderCellNode(RenderSceneManager* sm)
-	:RenderNode(),m_sceneManager(sm)
+	:RenderNode(),m_sceneManager(sm),m_updateJob(NULL),m_updateParentChanged(false)
 {
 	mNodeType = NT_CULL_CELL;
 }
 
 RenderCellNode::RenderCellNode(RenderSceneManager* sm, const String& name )
-	:RenderNode(name),m_sceneManager(sm)
+	:RenderNode(name),m_sceneManager(sm),m_updateJob(NULL),m_updateParentChanged(false)
 {
 	mNodeType = NT_CULL_CELL;
 }
@@ -49,12 +224,18 @@ void RenderCellNode::_updateBounds( void )
 {
 	m_worldAABB.setNull();
 
-	ChildNodeIterator it, itend;
-	itend = mChildren.end();
-	for (it = mChildren.begin(); it != itend; ++it)
+	for (IndexT i = 0; i < mChildren.Size(); ++i)
 	{
-		RenderTransform* child = static_cast<RenderTransform*>(it->second);
-		m_worldAABB.merge(child->_updateBounds());
+		RenderNode* child = mChildren[i];
+		if (child->getNodeType() == NT_CULL_CELL)
+		{
+			// updated by its own _update()
+			m_worldAABB.merge(static_cast<RenderCellNode*>(child)->_getWorldAABB());
+		}
+		else
+		{
+			m_worldAABB.merge(static_cast<RenderTransform*>(child)->_updateBoundsRecursive());
+		}
 	}
 }
 
@@ -69,6 +250,104 @@ const AxisAlignedBox& RenderCellNode::_getWorldAABB( void ) const
 	return m_worldAABB;
 }
 
+void RenderCellNode::_updateParallel( JobSystem* jobSystem )
+{
+	if (mHierarchy)
+	{
+		// derived once here, the jobs only read it
+		mHierarchy->update();
+	}
+
+	m_updateParentChanged = false;
+	m_updateJob = jobSystem->CreateJob(&RenderCellNode::updateSubtreeJob, this, "RenderCellNode::_updateParallel");
+	jobSystem->Run(m_updateJob);
+	jobSystem->Wait(m_updateJob);
+	m_updateJob = NULL;
+
+	_mergeBounds();
+}
+
+void RenderCellNode::updateSubtreeJob( void* data, IndexT first, SizeT count )
+{
+	RenderCellNode* cell = static_cast<RenderCellNode*>(data);
+	cell->_updateSubtree(JobSystem::getSingleton(), cell->m_updateJob, cell->m_updateParentChanged);
+}
+
+void RenderCellNode::_updateSubtree( JobSystem* jobSystem, Job* job, bool parentHasChanged )
+{
+	// same steps as RenderNode::_update(true, parentHasChanged), except for the child cells
+	mParentNotified = false;
+
+	bool allChildren = true;
+	bool childParentHasChanged = false;
+	if (!mHierarchy)
+	{
+		if (mNeedParentUpdate || parentHasChanged)
+		{
+			_updateFromParent();
+		}
+		allChildren = mNeedChildUpdate || parentHasChanged;
+		childParentHasChanged = allChildren;
+	}
+
+	ChildUpdateSet::iterator selected = mChildrenToUpdate.begin();
+	IndexT i = 0;
+	while (allChildren ? i < mChildren.Size() : selected != mChildrenToUpdate.end())
+	{
+		RenderNode* child = allChildren ? mChildren[i++] : *selected++;
+		if (child->getNodeType() == NT_CULL_CELL)
+		{
+			RenderCellNode* cell = static_cast<RenderCellNode*>(child);
+			if (cell->mChildren.Size() >= RENDERER_PARALLEL_UPDATE_MIN_CHILDREN)
+			{
+				// our transform is derived, the subtree can go
+				cell->m_updateParentChanged = childParentHasChanged;
+				cell->m_updateJob = jobSystem->CreateChildJob(job, &RenderCellNode::updateSubtreeJob, cell, "RenderCellNode::_updateSubtree");
+				jobSystem->Run(cell->m_updateJob);
+			}
+			else
+			{
+				cell->_updateSubtree(jobSystem, job, childParentHasChanged);
+			}
+		}
+		else
+		{
+			child->_update(true, childParentHasChanged);
+		}
+	}
+	mChildrenToUpdate.clear();
+	mNeedChildUpdate = false;
+
+	// the transforms below this cell belong to this job, their bounds can be derived here
+	for (i = 0; i < mChildren.Size(); ++i)
+	{
+		if (mChildren[i]->getNodeType() != NT_CULL_CELL)
+		{
+			static_cast<RenderTransform*>(mChildren[i])->_updateBoundsRecursive();
+		}
+	}
+}
+
+void RenderCellNode::_mergeBounds( void )
+{
+	m_worldAABB.setNull();
+
+	for (IndexT i = 0; i < mChildren.Size(); ++i)
+	{
+		RenderNode* child = mChildren[i];
+		if (child->getNodeType() == NT_CULL_CELL)
+		{
+			RenderCellNode* cell = static_cast<RenderCellNode*>(child);
+			cell->_mergeBounds();
+			m_worldAABB.merge(cell->m_worldAABB);
+		}
+		else
+		{
+			m_worldAABB.merge(static_cast<RenderTransform*>(child)->_getWorldAABB());
+		}
+	}
+}
+
 RenderTransform* RenderCellNode::createChildTransformNode( const Vector3& translate /*= Vector3::ZERO*/,
 														  const Quaternion& rotate /*= Quaternion::IDENTITY */ )
 {
@@ -81,27 +360,174 @@ RenderTransform* RenderCellNode::createChildTransformNode( const String& name, c
 	return static_cast<RenderTransform*>(this->createChild(name,translate, rotate));
 }
 
-void RenderCellNode::tickVisible( const RenderCamera* camera )
+void RenderCellNode::tickVisible( const RenderCamera* camera, RenderVisibilityStats* stats /*= NULL*/ )
+{
+	Render* render = GearApplication::getApp()->getRender();
+	uint32 viewportWidth = 0, viewportHeight = 0;
+	render->getWindowSize(viewportWidth, viewportHeight);
+
+	RenderMeshQueue queue(*render);
+	tickVisible(camera, viewportHeight, queue, stats);
+}
+
+void RenderCellNode::tickVisible( const RenderCamera* camera, uint32 viewportHeight, RenderVisibleQueue& queue, RenderVisibilityStats* stats /*= NULL*/ )
+{
+	Timer timer;
+
+	// one visitor for the whole cell tree.
+	ScreenSizeContext context(camera, viewportHeight);
+	SimpleRenderVisitor sv(queue);
+	tickVisible(context, sv);
+
+	if (stats)
+	{
+		// collecting and queueing are one pass here
+		stats->collectTime = timer.getElapsedSeconds();
+		stats->mergeTime = 0;
+		stats->numTasks = 0;
+		stats->numVisible = sv.getNumVisited();
+	}
+}
+
+void RenderCellNode::tickVisible( const ScreenSizeContext& context, SimpleRenderVisitor& sv )
 {
-	ChildNodeIterator it;
-	ChildNodeIterator itend = mChildren.end();
-	for (it = mChildren.begin(); it!=itend; ++it)
+	for (IndexT c = 0; c < mChildren.Size(); ++c)
 	{
-		if(it->second->getNodeType() == NT_TRANSFORM)
+		RenderNode* child = mChildren[c];
+		if(child->getNodeType() == NT_TRANSFORM)
+		{
+			visitAttachedObjects(context, static_cast<RenderTransform*>(child), sv);
+		}
+		else if (child->getNodeType() == NT_CULL_CELL)
 		{
-			RenderTransform* tn = static_cast<RenderTransform*>(it->second);
-			// TODO : Ч
-			size_t at = tn->numAttachedObjects();
-			for (size_t i=0; i<at; i++)
+			RenderCellNode* cn = static_cast<RenderCellNode*>(child);
+			cn->tickVisible(context, sv);
+		}
+	}
+}
+
+void RenderCellNode::tickVisibleParallel( const RenderCamera* camera, JobSystem* jobSystem, RenderVisibilityStats* stats /*= NULL*/ )
+{
+	Render* render = GearApplication::getApp()->getRender();
+	uint32 viewportWidth = 0, viewportHeight = 0;
+	render->getWindowSize(viewportWidth, viewportHeight);
+
+	RenderMeshQueue queue(*render);
+	tickVisibleParallel(camera, viewportHeight, jobSystem, queue, stats);
+}
+
+void RenderCellNode::tickVisibleParallel( const RenderCamera* camera, uint32 viewportHeight, JobSystem* jobSystem, RenderVisibleQueue& queue, RenderVisibilityStats* stats /*= NULL*/ )
+{
+	Timer timer;
+
+	// ȡһΣвٷ
+	ScreenSizeContext context(camera, viewportHeight);
+
+	FrameArray<CellVisibilityTask> tasks;
+	_buildVisibilityTasks(tasks);
+
+	// ÿ߳һб֮䲻Ҫͬ
+	const SizeT numThreads = jobSystem->GetNumThreads();
+	FrameArray<CellVisibleEntry>* lists = ph_new_frame_array(FrameArray<CellVisibleEntry>, numThreads);
+
+	if (!tasks.IsEmpty())
+	{
+		CellVisibilityJobData jobData;
+		jobData.context = &context;
+		jobData.tasks = tasks.Begin();
+		jobData.lists = lists;
+		jobSystem->ParallelFor(tasks.Size(), &RenderCellNode::collectVisibleJob, &jobData, 1, "RenderCellNode::tickVisibleParallel");
+	}
+	const Timer::Second collectTime = timer.getElapsedSeconds();
+
+	// ˳ϲtickVisible()˳һ
+	SizeT numVisible = 0;
+	for (IndexT t = 0; t < tasks.Size(); ++t)
+	{
+		const CellVisibilityTask& task = tasks[t];
+		const FrameArray<CellVisibleEntry>& list = lists[task.thread];
+		for (IndexT e = task.firstEntry; e < task.firstEntry + task.numEntries; ++e)
+		{
+			queue.queueVisible(*list[e].element, list[e].screenSize);
+		}
+		numVisible += task.numEntries;
+	}
+
+	if (stats)
+	{
+		stats->collectTime = collectTime;
+		stats->mergeTime = timer.getElapsedSeconds();
+		stats->numTasks = tasks.Size();
+		stats->numVisible = numVisible;
+	}
+}
+
+void RenderCellNode::collectVisibleJob( void* data, IndexT first, SizeT count )
+{
+	CellVisibilityJobData* jobData = static_cast<CellVisibilityJobData*>(data);
+	const IndexT thread = JobSystem::getSingleton()->GetThreadIndex();
+	FrameArray<CellVisibleEntry>& list = jobData->lists[thread];
+
+	for (IndexT i = first; i < first + count; ++i)
+	{
+		CellVisibilityTask& task = jobData->tasks[i];
+		task.thread = thread;
+		task.firstEntry = list.Size();
+		task.cell->_collectVisible(*jobData->context, task.firstChild, task.numChildren, list);
+		task.numEntries = list.Size() - task.firstEntry;
+	}
+}
+
+void RenderCellNode::_buildVisibilityTasks( FrameArray<CellVisibilityTask>& tasks )
+{
+	CellVisibilityTask task;
+	task.cell = this;
+	task.firstChild = 0;
+	task.numChildren = 0;
+	task.thread = 0;
+	task.firstEntry = 0;
+	task.numEntries = 0;
+
+	for (IndexT c = 0; c < mChildren.Size(); ++c)
+	{
+		if (mChildren[c]->getNodeType() == NT_CULL_CELL)
+		{
+			// Cellǰ֮䣬ֱ˳
+			if (task.numChildren > 0)
 			{
-				SimpleRenderVisitor sv;
-				tn->getAttachedObject(i)->visitRenderElement(&sv);
+				tasks.Append(task);
+				task.numChildren = 0;
 			}
+			static_cast<RenderCellNode*>(mChildren[c])->_buildVisibilityTasks(tasks);
 		}
-		else if (it->second->getNodeType() == NT_CULL_CELL)
+		else
+		{
+			if (task.numChildren == 0)
+			{
+				task.firstChild = c;
+			}
+			if (++task.numChildren == RENDERER_VISIBILITY_TASK_CHILDREN)
+			{
+				tasks.Append(task);
+				task.numChildren = 0;
+			}
+		}
+	}
+
+	if (task.numChildren > 0)
+	{
+		tasks.Append(task);
+	}
+}
+
+void RenderCellNode::_collectVisible( const ScreenSizeContext& context, IndexT first, SizeT count, FrameArray<CellVisibleEntry>& entries )
+{
+	CollectRenderVisitor visitor(entries);
+	for (IndexT c = first; c < first + count; ++c)
+	{
+		if (mChildren[c]->getNodeType() == NT_TRANSFORM)
 		{
-			RenderCellNode* cn = static_cast<RenderCellNode*>(it->second);
-			cn->tickVisible(camera);
+			visitAttachedObjects(context, static_cast<RenderTransform*>(mChildren[c]), visitor);
 		}
 	}
 }
@@ -3,11 +3,41 @@
 
 #include "renderNode.h"
 #include "math/axisAlignedBox.h"
+#include "util/timer.h"
 
 /// СüԪڴ˻Ͻвü
 
 _NAMESPACE_BEGIN
 
+class SimpleRenderVisitor;
+class ScreenSizeContext;
+class JobSystem;
+struct Job;
+struct CellVisibilityTask;
+struct CellVisibleEntry;
+
+/// ɼռ׶εĺʱ룩
+struct RenderVisibilityStats
+{
+	RenderVisibilityStats() : updateTime(0), collectTime(0), mergeTime(0), numTasks(0), numVisible(0) {}
+
+	Timer::Second	updateTime;		// ³ͼ
+	Timer::Second	collectTime;	// ռɼ壬ʱΪȴȫʱ
+	Timer::Second	mergeTime;		// ˳Ⱦ
+	SizeT			numTasks;		// ռʱΪ0
+	SizeT			numVisible;		// Ⱦе
+};
+
+/// տɼ壬˳
+class RenderVisibleQueue
+{
+public:
+
+	virtual ~RenderVisibleQueue() {}
+
+	virtual void queueVisible(RenderElement& rend, scalar screenSize) = 0;
+};
+
 class RenderCellNode : public RenderNode
 {
 public:
@@ -26,6 +56,16 @@ public:
 
 	virtual const AxisAlignedBox& _getWorldAABB(void) const;
 
+	/** Same as _update(true, false), with the subtrees of large child cells updated as jobs.
+	@remarks
+		A child cell with at least RENDERER_PARALLEL_UPDATE_MIN_CHILDREN children is
+		dispatched as a job once the transform of its parent is derived, smaller ones are
+		updated by the job of their parent. The bounds of the transforms are derived by the
+		jobs, the bounds of the cells are merged afterwards on the calling thread, in child
+		order. Node listeners are called from the jobs and must not change the scene graph.
+	*/
+	virtual void _updateParallel(JobSystem* jobSystem);
+
 	virtual RenderTransform* createChildTransformNode(
 		const Vector3& translate = Vector3::ZERO, 
 		const Quaternion& rotate = Quaternion::IDENTITY );
@@ -41,10 +81,49 @@ public:
 
 	RenderSceneManager* getCreator(){return m_sceneManager;}
 
-	virtual void tickVisible(const RenderCamera* camera);
+	virtual void tickVisible(const RenderCamera* camera, RenderVisibilityStats* stats = NULL);
+
+	/** Same as tickVisible(camera, stats), the visible elements go to queue instead of the render queue. */
+	void tickVisible(const RenderCamera* camera, uint32 viewportHeight, RenderVisibleQueue& queue, RenderVisibilityStats* stats = NULL);
+
+	/** Same as tickVisible(), with the children split into tasks which collect their visible elements in parallel.
+	@remarks
+		Each task is a run of at most RENDERER_VISIBILITY_TASK_CHILDREN consecutive transform
+		children of one cell, the tasks are listed in the order tickVisible() visits the tree.
+		A task appends to the list of the thread it runs on and remembers where its elements
+		went, the lists are then queued on the calling thread task by task, so the render
+		queue gets the same elements in the same order as with tickVisible().
+	*/
+	virtual void tickVisibleParallel(const RenderCamera* camera, JobSystem* jobSystem, RenderVisibilityStats* stats = NULL);
+
+	/** Same as tickVisibleParallel(camera, jobSystem, stats), the visible elements go to queue instead of the render queue. */
+	void tickVisibleParallel(const RenderCamera* camera, uint32 viewportHeight, JobSystem* jobSystem, RenderVisibleQueue& queue, RenderVisibilityStats* stats = NULL);
 
 protected:
 
+	void tickVisible(const ScreenSizeContext& context, SimpleRenderVisitor& sv);
+
+	/// appends the tasks of this cell and of its child cells in visiting order
+	void _buildVisibilityTasks(FrameArray<CellVisibilityTask>& tasks);
+
+	/// appends the visible elements of the transform children [first, first + count)
+	void _collectVisible(const ScreenSizeContext& context, IndexT first, SizeT count, FrameArray<CellVisibleEntry>& entries);
+
+	static void collectVisibleJob(void* data, IndexT first, SizeT count);
+
+	/// the part of _updateParallel() which runs in a job, child cell jobs are created as children of job
+	void _updateSubtree(JobSystem* jobSystem, Job* job, bool parentHasChanged);
+
+	/// merges the bounds of the children into m_worldAABB, child cells first
+	void _mergeBounds(void);
+
+	static void updateSubtreeJob(void* data, IndexT first, SizeT count);
+
+	// _updateParallel() state of a cell which runs as its own job
+	Job* m_updateJob;
+
+	bool m_updateParentChanged;
+
 	AxisAlignedBox m_worldAABB;
 
 	RenderSceneManager* m_sceneManager;
@@ -18,6 +18,34 @@ extern char gShadersDir[];
 // If turned on, asserts get compiled in as print statements in release mode.
 #define RENDERER_ENABLE_CHECKED_RELEASE 0
 
+// bytes all streamed DDS textures may occupy, 0 loads every level up front.
+#define RENDERER_TEXTURE_STREAMING_BUDGET (64*1024*1024)
+
+// derive the scene graph's transforms level by level from flat arrays (see renderTransformHierarchy.h)
+// instead of recursing node by node.
+#define RENDERER_FLAT_TRANSFORMS 0
+
+// update the scene graph with the job system, cells with at least this many children get a job of their own.
+#define RENDERER_PARALLEL_SCENE_UPDATE 1
+#define RENDERER_PARALLEL_UPDATE_MIN_CHILDREN 64
+
+// collect the visible elements and cull the terrain with the job system, a task handles at most this many transforms.
+#define RENDERER_PARALLEL_VISIBILITY 1
+#define RENDERER_VISIBILITY_TASK_CHILDREN 64
+// the terrain quadtree is split this many levels below the root, into up to 4^levels tasks.
+#define RENDERER_TERRAIN_CULL_LEVELS 2
+
+// bounds and depth of the scene manager's loose octree (see renderOctree.h), a flat one only splits x and z.
+#define RENDERER_OCTREE_WORLD_SIZE 8192.0f
+#define RENDERER_OCTREE_MAX_DEPTH 6
+#define RENDERER_OCTREE_FLAT 0
+
+// the scene manager's BVH (see renderBVH.h) makes leaves of this many elements or less, and of at most the max
+// size when splitting does not pay off. A refitted subtree grown past the ratio times its built area is rebuilt.
+#define RENDERER_BVH_LEAF_SIZE 4
+#define RENDERER_BVH_MAX_LEAF_SIZE 16
+#define RENDERER_BVH_REBUILD_RATIO 1.5f
+
 // maximum number of bones per-drawcall allowed.
 #define RENDERER_MAX_BONES 60
 
@@ -41,6 +69,7 @@ extern char gShadersDir[];
 #define RENDERER_ENABLE_CG
 #define RENDERER_ENABLE_NVPERFHUD
 #define RENDERER_ENABLE_TGA_SUPPORT
+#define RENDERER_ENABLE_TGA_BAKE	// tga textures are loaded from block compressed dds copies baked next to them
 
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
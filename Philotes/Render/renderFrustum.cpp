@@ -3,6 +3,7 @@
 #include "renderNode.h"
 #include "math/sphere.h"
 #include "math/planeBoundedVolume.h"
+#include "math/mathBatch.h"
 
 #include "render.h"
 #include "gearsApplication.h"
@@ -483,7 +484,8 @@ void RenderFrustum::updateFrustumImpl(void) const
 		} // ortho            
 	} // !mCustomProjMatrix
 
-	Render* renderSystem = GearApplication::getApp()->getRender();
+	GearApplication* app = GearApplication::getApp();
+	Render* renderSystem = app ? app->getRender() : NULL;
 	if (renderSystem)
 	{
 		renderSystem->convertProjectionMatrix(mProjMatrix, mProjMatrixRS);
@@ -714,15 +716,16 @@ void RenderFrustum::updateWorldSpaceCornersImpl(void) const
 	scalar farTop = nearTop * radio;
 
 	// near
-	mWorldSpaceCorners[0] = eyeToWorld.transformAffine(Vector3(nearRight, nearTop,    -mNearDist));
-	mWorldSpaceCorners[1] = eyeToWorld.transformAffine(Vector3(nearLeft,  nearTop,    -mNearDist));
-	mWorldSpaceCorners[2] = eyeToWorld.transformAffine(Vector3(nearLeft,  nearBottom, -mNearDist));
-	mWorldSpaceCorners[3] = eyeToWorld.transformAffine(Vector3(nearRight, nearBottom, -mNearDist));
+	mWorldSpaceCorners[0] = Vector3(nearRight, nearTop,    -mNearDist);
+	mWorldSpaceCorners[1] = Vector3(nearLeft,  nearTop,    -mNearDist);
+	mWorldSpaceCorners[2] = Vector3(nearLeft,  nearBottom, -mNearDist);
+	mWorldSpaceCorners[3] = Vector3(nearRight, nearBottom, -mNearDist);
 	// far
-	mWorldSpaceCorners[4] = eyeToWorld.transformAffine(Vector3(farRight,  farTop,     -farDist));
-	mWorldSpaceCorners[5] = eyeToWorld.transformAffine(Vector3(farLeft,   farTop,     -farDist));
-	mWorldSpaceCorners[6] = eyeToWorld.transformAffine(Vector3(farLeft,   farBottom,  -farDist));
-	mWorldSpaceCorners[7] = eyeToWorld.transformAffine(Vector3(farRight,  farBottom,  -farDist));
+	mWorldSpaceCorners[4] = Vector3(farRight,  farTop,     -farDist);
+	mWorldSpaceCorners[5] = Vector3(farLeft,   farTop,     -farDist);
+	mWorldSpaceCorners[6] = Vector3(farLeft,   farBottom,  -farDist);
+	mWorldSpaceCorners[7] = Vector3(farRight,  farBottom,  -farDist);
+	MathBatch::transformPoints(eyeToWorld, mWorldSpaceCorners, mWorldSpaceCorners, 8);
 
 
 	mRecalcWorldSpaceCorners = false;
@@ -23,6 +23,12 @@ static uint32 getVariableTypeSize(RenderMaterial::VariableType type)
 RenderMaterial::Variable::Variable(const String& name, VariableType type, uint32 offset)
 {
 	m_name		= name;
+	m_nameAtom	= name;
+	m_unprefixedAtom = m_nameAtom;
+	if(!name.IsEmpty() && name[0] == '$')
+	{
+		m_unprefixedAtom = name.SubString(1);
+	}
 	m_type		= type;
 	m_offset	= offset;
 }
@@ -74,18 +80,23 @@ const char *RenderMaterial::getPassName(Pass pass)
 	return passName;
 }
 
-RenderMaterial::RenderMaterial(const RenderMaterialDesc &desc) :
-	m_type(desc.type),
-	m_alphaTestFunc(desc.alphaTestFunc),
-	m_srcBlendFunc(desc.srcBlendFunc),
-	m_dstBlendFunc(desc.dstBlendFunc)
+RenderMaterial::RenderMaterial(const RenderMaterialDesc &desc)
 {
-	m_alphaTestRef			= desc.alphaTestRef;
-	m_blending				= desc.blending;
+	applyDesc(desc);
 	m_variableBufferSize	= 0;
 	m_cullMode				= CLOCKWISE;
 }
 
+void RenderMaterial::applyDesc(const RenderMaterialDesc &desc)
+{
+	m_type					= desc.type;
+	m_alphaTestFunc			= desc.alphaTestFunc;
+	m_alphaTestRef			= desc.alphaTestRef;
+	m_blending				= desc.blending;
+	m_srcBlendFunc			= desc.srcBlendFunc;
+	m_dstBlendFunc			= desc.dstBlendFunc;
+}
+
 RenderMaterial::~RenderMaterial(void)
 {
 	uint32 numVariables = (uint32)m_variables.Size();
@@ -99,6 +110,8 @@ void RenderMaterial::bind(RenderMaterial::Pass pass, RenderMaterialInstance *mat
 {
 	if(materialInstance)
 	{
+		// the material may have gained variables since the instance was created.
+		materialInstance->syncDataSize();
 		uint32 numVariables = (uint32)m_variables.Size();
 		for(uint32 i=0; i<numVariables; i++)
 		{
@@ -103,12 +103,17 @@ public:
 
 	public:
 		const String&	getName(void) const;
+		// ֵԭӣԼȥ$ǰ׺ԭӣұʱֻȽָ
+		const StringAtom&	getNameAtom(void) const			{ return m_nameAtom; }
+		const StringAtom&	getUnprefixedAtom(void) const	{ return m_unprefixedAtom; }
 		VariableType	getType(void) const;
 		uint32			getDataOffset(void) const;
 		uint32			getDataSize(void) const;
 
 	private:
 		String			m_name;
+		StringAtom		m_nameAtom;
+		StringAtom		m_unprefixedAtom;
 		VariableType	m_type;
 		uint32			m_offset;
 	};
@@ -127,6 +132,13 @@ protected:
 public:
 	void release(void) { delete this; }
 
+	// rebuilds the material from the description in place, variables and instances stay valid.
+	// returns false if the backend can't reload, the material is then left untouched.
+	virtual bool reload(const RenderMaterialDesc &desc) { return false; }
+
+	// every shader source file (including headers) the material was compiled from.
+	const Array<String>&			getShaderDependencies(void)			const { return m_shaderDependencies; }
+
 	__forceinline	Type			getType(void)						const { return m_type; }
 	__forceinline	AlphaTestFunc	getAlphaTestFunc(void)				const { return m_alphaTestFunc; }
 	__forceinline	float			getAlphaTestRef(void)				const { return m_alphaTestRef; }
@@ -139,6 +151,8 @@ public:
 	__forceinline	void			setCullMode(CullMode val) { m_cullMode = val; }
 
 protected:
+	void applyDesc(const RenderMaterialDesc &desc);
+
 	virtual void bind(RenderMaterial::Pass pass, RenderMaterialInstance *materialInstance, bool instanced) const;
 	virtual void bindMeshState(bool instanced) const = 0;
 	virtual void unbind(void) const = 0;
@@ -147,19 +161,21 @@ protected:
 	RenderMaterial &operator=(const RenderMaterial&) { return *this; }
 
 protected:
-	const Type          m_type;
+	Type				m_type;
 
-	const AlphaTestFunc m_alphaTestFunc;
+	AlphaTestFunc		m_alphaTestFunc;
 	float               m_alphaTestRef;
 
 	bool                m_blending;
-	const BlendFunc     m_srcBlendFunc;
-	const BlendFunc     m_dstBlendFunc;
+	BlendFunc			m_srcBlendFunc;
+	BlendFunc			m_dstBlendFunc;
 
 	CullMode			m_cullMode;
 
 	Array<Variable*>	m_variables;
 	uint32				m_variableBufferSize;
+
+	Array<String>		m_shaderDependencies;
 };
 
 _NAMESPACE_END
@@ -1,6 +1,7 @@
 
 #include <renderMaterialInstance.h>
 #include <renderMaterial.h>
+#include <renderTexture2D.h>
 
 _NAMESPACE_BEGIN
 
@@ -8,11 +9,24 @@ RenderMaterialInstance::RenderMaterialInstance(RenderMaterial &material) :
 	m_material(material)
 {
 	m_data = 0;
+	m_dataSize = 0;
+	syncDataSize();
+}
+
+void RenderMaterialInstance::syncDataSize(void)
+{
 	uint32 dataSize = m_material.getMaterialInstanceDataSize();
-	if(dataSize > 0)
+	if(dataSize > m_dataSize)
 	{
-		m_data = new uint8[dataSize];
-		memset(m_data, 0, dataSize);
+		uint8 *data = new uint8[dataSize];
+		memset(data, 0, dataSize);
+		if(m_data)
+		{
+			memcpy(data, m_data, m_dataSize);
+			delete[] m_data;
+		}
+		m_data     = data;
+		m_dataSize = dataSize;
 	}
 }
 
@@ -24,7 +38,7 @@ RenderMaterialInstance::~RenderMaterialInstance(void)
 	}
 }
 
-const RenderMaterial::Variable *RenderMaterialInstance::findVariable(const String& name, RenderMaterial::VariableType varType)
+const RenderMaterial::Variable *RenderMaterialInstance::findVariable(const StringAtom& name, RenderMaterial::VariableType varType)
 {
 	RenderMaterial::Variable *var = 0;
 	uint32 numVariables = (uint32)m_material.m_variables.Size();
@@ -32,21 +46,12 @@ const RenderMaterial::Variable *RenderMaterialInstance::findVariable(const Strin
 	for(uint32 i=0; i<numVariables; i++)
 	{
 		RenderMaterial::Variable &v = *m_material.m_variables[i];
-		if (v.getName() == name)
+		// ֿԴ$ǰ׺ҲԲ
+		if (v.getNameAtom() == name || v.getUnprefixedAtom() == name)
 		{
 			var = &v;
 			break;
 		}
-		else if(!v.getName().IsEmpty() && v.getName()[0] == '$')
-		{
-			// $ǰ׺
-			String sub = v.getName().SubString(1);
-			if (sub == name)
-			{
-				var = &v;
-				break;
-			}
-		}
 	}
 	if(var && var->getType() != varType)
 	{
@@ -57,18 +62,39 @@ const RenderMaterial::Variable *RenderMaterialInstance::findVariable(const Strin
 
 void RenderMaterialInstance::writeData(const RenderMaterial::Variable &var, const void *data)
 {
+	syncDataSize();
 	if(m_data && data)
 	{
 		memcpy(m_data+var.getDataOffset(), data, var.getDataSize());
 	}
 }
 
+void RenderMaterialInstance::noteScreenSize(scalar pixels)
+{
+	if(!m_data) return;
+	const uint32 numVariables = (uint32)m_material.m_variables.Size();
+	for(uint32 i=0; i<numVariables; i++)
+	{
+		const RenderMaterial::Variable &var = *m_material.m_variables[i];
+		if(var.getType() == RenderMaterial::VARIABLE_SAMPLER2D && var.getDataOffset() + sizeof(RenderTexture2D*) <= m_dataSize)
+		{
+			RenderTexture2D *texture = *(RenderTexture2D**)(m_data + var.getDataOffset());
+			if(texture) texture->noteScreenSize(pixels);
+		}
+	}
+}
+
 RenderMaterialInstance &RenderMaterialInstance::operator=(const RenderMaterialInstance &b)
 {
 	ph_assert(&m_material == &b.m_material);
 	if(&m_material == &b.m_material)
 	{
-		memcpy(m_data, b.m_data, m_material.getMaterialInstanceDataSize());
+		syncDataSize();
+		const uint32 copySize = m_dataSize < b.m_dataSize ? m_dataSize : b.m_dataSize;
+		if(copySize > 0)
+		{
+			memcpy(m_data, b.m_data, copySize);
+		}
 	}
 	return *this;
 }
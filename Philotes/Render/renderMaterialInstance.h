@@ -18,17 +18,25 @@ class RenderMaterialInstance
 		
 		RenderMaterial &getMaterial(void) { return m_material; }
 		
-		const RenderMaterial::Variable* findVariable(const String& name, RenderMaterial::VariableType varType);
+		const RenderMaterial::Variable* findVariable(const StringAtom& name, RenderMaterial::VariableType varType);
 		
 		void writeData(const RenderMaterial::Variable &var, const void *data);
+
+		// forwards the on-screen size of a mesh using this instance to all bound textures.
+		void noteScreenSize(scalar pixels);
 	
 		RenderMaterialInstance &operator=(const RenderMaterialInstance&);
 		
 	private:
 
+		// grows the data buffer after the material was reloaded with more variables.
+		void				syncDataSize(void);
+
 		RenderMaterial&		m_material;
 
 		uint8*				m_data;
+
+		uint32				m_dataSize;
 		
 };
 
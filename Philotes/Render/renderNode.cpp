@@ -3,11 +3,11 @@
 
 _NAMESPACE_BEGIN
 
-NameGenerator				RenderNode::msNameGenerator("nd_");
 RenderNode::QueuedUpdates	RenderNode::msQueuedUpdates;
 
 RenderNode::RenderNode()
 	:mParent(0),
+	mChildIndex(InvalidIndex),
 	mNeedParentUpdate(false),
 	mNeedChildUpdate(false),
 	mParentNotified(false),
@@ -25,10 +25,10 @@ RenderNode::RenderNode()
 	mInitialScale(Vector3::UNIT_SCALE),
 	mCachedTransformOutOfDate(true),
 	mListener(0),
-	mNodeType(NT_UNKNOW)
+	mNodeType(NT_UNKNOW),
+	mHierarchy(0),
+	mHierarchyHandle(RenderTransformHierarchy::INVALID_HANDLE)
 {
-	mName = msNameGenerator.generate();
-
 	needUpdate();
 
 }
@@ -36,6 +36,7 @@ RenderNode::RenderNode()
 RenderNode::RenderNode(const String& name)
 	:
 	mParent(0),
+	mChildIndex(InvalidIndex),
 	mNeedParentUpdate(false),
 	mNeedChildUpdate(false),
 	mParentNotified(false),
@@ -54,7 +55,9 @@ RenderNode::RenderNode(const String& name)
 	mInitialScale(Vector3::UNIT_SCALE),
 	mCachedTransformOutOfDate(true),
 	mListener(0),
-	mNodeType(NT_UNKNOW)
+	mNodeType(NT_UNKNOW),
+	mHierarchy(0),
+	mHierarchyHandle(RenderTransformHierarchy::INVALID_HANDLE)
 {
 	needUpdate();
 }
@@ -73,6 +76,8 @@ RenderNode::~RenderNode()
 	if(mParent)
 		mParent->removeChild(this);
 
+	_setTransformHierarchy(NULL);
+
 	if (mQueuedForUpdate)
 	{
 		// Erase from queued updates
@@ -101,6 +106,24 @@ void RenderNode::setParent(RenderNode* parent)
 	bool different = (parent != mParent);
 
 	mParent = parent;
+
+	// Follow the parent into or out of its transform hierarchy
+	RenderTransformHierarchy* hierarchy = parent ? parent->mHierarchy : NULL;
+	if (hierarchy != mHierarchy)
+	{
+		_setTransformHierarchy(hierarchy);
+	}
+	else if (mHierarchy)
+	{
+		mHierarchy->setParent(mHierarchyHandle, parent->mHierarchyHandle);
+	}
+
+	// The elements below follow into the scene index of the new cell, or out of it
+	if (different)
+	{
+		_updateSceneIndex();
+	}
+
 	// Request update from parent
 	mParentNotified = false ;
 	needUpdate();
@@ -118,6 +141,16 @@ void RenderNode::setParent(RenderNode* parent)
 //-----------------------------------------------------------------------
 const Matrix4& RenderNode::_getFullTransform(void) const
 {
+	if (mHierarchy)
+	{
+		if (!mHierarchy->isDirty())
+		{
+			return mHierarchy->getFullTransform(mHierarchyHandle);
+		}
+		// an ancestor may have changed, the cached matrix can not be trusted
+		mCachedTransformOutOfDate = true;
+	}
+
 	if (mCachedTransformOutOfDate)
 	{
 		// Use derived values
@@ -135,6 +168,23 @@ void RenderNode::_update(bool updateChildren, bool parentHasChanged)
 	// always clear information about parent notification
 	mParentNotified = false ;
 
+	if (mHierarchy)
+	{
+		// The transforms of the whole hierarchy are derived in one go, the
+		// traversal only remains for subclasses which update more than that
+		mHierarchy->update();
+		if (updateChildren)
+		{
+			ChildNodeIterator it, itend;
+			itend = mChildren.End();
+			for (it = mChildren.Begin(); it != itend; ++it)
+			{
+				(*it)->_update(true, false);
+			}
+		}
+		return;
+	}
+
 	// Short circuit the off case
 	if (!updateChildren && !mNeedParentUpdate && !mNeedChildUpdate && !parentHasChanged )
 	{
@@ -153,10 +203,10 @@ void RenderNode::_update(bool updateChildren, bool parentHasChanged)
 	{
 
 		ChildNodeIterator it, itend;
-		itend = mChildren.end();
-		for (it = mChildren.begin(); it != itend; ++it)
+		itend = mChildren.End();
+		for (it = mChildren.Begin(); it != itend; ++it)
 		{
-			RenderNode* child = it->second;
+			RenderNode* child = *it;
 			child->_update(true, true);
 		}
 		mChildrenToUpdate.clear();
@@ -182,6 +232,12 @@ void RenderNode::_update(bool updateChildren, bool parentHasChanged)
 //-----------------------------------------------------------------------
 void RenderNode::_updateFromParent(void) const
 {
+	if (mHierarchy)
+	{
+		_updateFromHierarchy();
+		return;
+	}
+
 	updateFromParentImpl();
 
 	// Call listener (note, this method only called if there's something to do)
@@ -266,45 +322,72 @@ void RenderNode::addChild(RenderNode* child)
 	if (child->mParent)
 	{
 		PH_EXCEPT(ERR_RENDER,
-			"RenderNode '" + child->getName() + "' already was a child of '" +
-			child->mParent->getName() + "'.");
+			"RenderNode '" + child->getName().AsString() + "' already was a child of '" +
+			child->mParent->getName().AsString() + "'.");
+	}
+
+	if (child->mName.IsValid())
+	{
+		if (mChildrenByName.Contains(child->mName))
+		{
+			PH_EXCEPT(ERR_RENDER,
+				"Child node named " + child->mName.AsString() + " already exists in '" +
+				mName.AsString() + "'.");
+		}
+		mChildrenByName.Add(child->mName, mChildren.Size());
 	}
 
-	mChildren.insert(std::make_pair(child->getName(), child));
+	child->mChildIndex = mChildren.Size();
+	mChildren.Append(child);
 	child->setParent(this);
 
 }
 //-----------------------------------------------------------------------
 unsigned short RenderNode::numChildren(void) const
 {
-	return static_cast< unsigned short >( mChildren.size() );
+	return static_cast< unsigned short >( mChildren.Size() );
 }
 //-----------------------------------------------------------------------
 RenderNode* RenderNode::getChild(unsigned short index)
 {
-	if( index < mChildren.size() )
-	{
-		ChildNodeMap::iterator i = mChildren.begin();
-		while (index--) ++i;
-		return i->second;
-	}
+	if( index < mChildren.Size() )
+		return mChildren[index];
 	else
 		return NULL;
 }
 //-----------------------------------------------------------------------
+void RenderNode::eraseChild(IndexT index)
+{
+	RenderNode* child = mChildren[index];
+	cancelUpdate(child);
+
+	if (child->mName.IsValid())
+	{
+		mChildrenByName.Erase(child->mName);
+	}
+	mChildren.EraseIndexSwap(index);
+	if (index < mChildren.Size())
+	{
+		// the last child took the place of the removed one
+		RenderNode* moved = mChildren[index];
+		moved->mChildIndex = index;
+		if (moved->mName.IsValid())
+		{
+			mChildrenByName[moved->mName] = index;
+		}
+	}
+
+	child->mChildIndex = InvalidIndex;
+	child->setParent(NULL);
+}
+//-----------------------------------------------------------------------
 RenderNode* RenderNode::removeChild(unsigned short index)
 {
 	RenderNode* ret;
-	if (index < mChildren.size())
+	if (index < mChildren.Size())
 	{
-		ChildNodeMap::iterator i = mChildren.begin();
-		while (index--) ++i;
-		ret = i->second;
-		
-		cancelUpdate(ret);
-
-		mChildren.erase(i);
-		ret->setParent(NULL);
+		ret = mChildren[index];
+		eraseChild(index);
 		return ret;
 	}
 	else
@@ -318,14 +401,10 @@ RenderNode* RenderNode::removeChild(RenderNode* child)
 {
 	if (child)
 	{
-		ChildNodeMap::iterator i = mChildren.find(child->getName());
-
-		if (i != mChildren.end() && i->second == child)
+		if (child->mParent == this)
 		{
-			cancelUpdate(child);
-
-			mChildren.erase(i);
-			child->setParent(NULL);
+			ph_assert(mChildren[child->mChildIndex] == child);
+			eraseChild(child->mChildIndex);
 		}
 	}
 	return child;
@@ -506,7 +585,7 @@ void RenderNode::_setDerivedOrientation( const Quaternion& q )
 //-----------------------------------------------------------------------
 const Quaternion & RenderNode::_getDerivedOrientation(void) const
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -515,7 +594,7 @@ const Quaternion & RenderNode::_getDerivedOrientation(void) const
 //-----------------------------------------------------------------------
 const Vector3 & RenderNode::_getDerivedPosition(void) const
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -524,7 +603,7 @@ const Vector3 & RenderNode::_getDerivedPosition(void) const
 //-----------------------------------------------------------------------
 const Vector3 & RenderNode::_getDerivedScale(void) const
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -533,7 +612,7 @@ const Vector3 & RenderNode::_getDerivedScale(void) const
 //-----------------------------------------------------------------------
 Vector3 RenderNode::convertWorldToLocalPosition( const Vector3 &worldPos )
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -542,7 +621,7 @@ Vector3 RenderNode::convertWorldToLocalPosition( const Vector3 &worldPos )
 //-----------------------------------------------------------------------
 Vector3 RenderNode::convertLocalToWorldPosition( const Vector3 &localPos )
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -551,7 +630,7 @@ Vector3 RenderNode::convertLocalToWorldPosition( const Vector3 &localPos )
 //-----------------------------------------------------------------------
 Quaternion RenderNode::convertWorldToLocalOrientation( const Quaternion &worldOrientation )
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -560,7 +639,7 @@ Quaternion RenderNode::convertWorldToLocalOrientation( const Quaternion &worldOr
 //-----------------------------------------------------------------------
 Quaternion RenderNode::convertLocalToWorldOrientation( const Quaternion &localOrientation )
 {
-	if (mNeedParentUpdate)
+	if (mNeedParentUpdate || mHierarchy)
 	{
 		_updateFromParent();
 	}
@@ -570,13 +649,15 @@ Quaternion RenderNode::convertLocalToWorldOrientation( const Quaternion &localOr
 //-----------------------------------------------------------------------
 void RenderNode::removeAllChildren(void)
 {
-	ChildNodeMap::iterator i, iend;
-	iend = mChildren.end();
-	for (i = mChildren.begin(); i != iend; ++i)
+	ChildNodeIterator i, iend;
+	iend = mChildren.End();
+	for (i = mChildren.Begin(); i != iend; ++i)
 	{
-		i->second->setParent(0);
+		(*i)->mChildIndex = InvalidIndex;
+		(*i)->setParent(0);
 	}
-	mChildren.clear();
+	mChildren.Clear();
+	mChildrenByName.Clear();
 	mChildrenToUpdate.clear();
 }
 //-----------------------------------------------------------------------
@@ -635,7 +716,7 @@ void RenderNode::scale(scalar x, scalar y, scalar z)
 
 }
 //-----------------------------------------------------------------------
-const String& RenderNode::getName(void) const
+const StringAtom& RenderNode::getName(void) const
 {
 	return mName;
 }
@@ -674,31 +755,27 @@ const Vector3& RenderNode::getInitialScale(void) const
 //-----------------------------------------------------------------------
 RenderNode* RenderNode::getChild(const String& name)
 {
-	ChildNodeMap::iterator i = mChildren.find(name);
+	KeyValuePair<StringAtom, IndexT>* i = mChildrenByName.FindKV(name);
 
-	if (i == mChildren.end())
+	if (!i)
 	{
 		PH_EXCEPT(ERR_RENDER, "Child node named " + name + " does not exist.");
 	}
-	return i->second;
+	return mChildren[i->Value()];
 
 }
 //-----------------------------------------------------------------------
 RenderNode* RenderNode::removeChild(const String& name)
 {
-	ChildNodeMap::iterator i = mChildren.find(name);
+	KeyValuePair<StringAtom, IndexT>* i = mChildrenByName.FindKV(name);
 
-	if (i == mChildren.end())
+	if (!i)
 	{
 		PH_EXCEPT(ERR_RENDER, "Child node named " + name + " does not exist.");
 	}
 
-	RenderNode* ret = i->second;
-	// Cancel any pending update
-	cancelUpdate(ret);
-
-	mChildren.erase(i);
-	ret->setParent(NULL);
+	RenderNode* ret = mChildren[i->Value()];
+	eraseChild(i->Value());
 
 	return ret;
 }
@@ -713,6 +790,13 @@ RenderNode* RenderNode::removeChild(const String& name)
 //-----------------------------------------------------------------------
 void RenderNode::needUpdate(bool forceParentUpdate)
 {
+	if (mHierarchy)
+	{
+		mHierarchy->setLocalTransform(mHierarchyHandle, mPosition, mOrientation, mScale);
+		mHierarchy->setInherit(mHierarchyHandle, mInheritOrientation, mInheritScale);
+		mCachedTransformOutOfDate = true;
+		return;
+	}
 
 	mNeedParentUpdate = true;
 	mNeedChildUpdate = true;
@@ -759,6 +843,66 @@ void RenderNode::cancelUpdate(RenderNode* child)
 	}
 }
 //-----------------------------------------------------------------------
+void RenderNode::_setTransformHierarchy(RenderTransformHierarchy* hierarchy)
+{
+	if (hierarchy == mHierarchy)
+	{
+		return;
+	}
+
+	ChildNodeIterator it, itend;
+	itend = mChildren.End();
+
+	if (mHierarchy)
+	{
+		// children first, a transform is only destroyed once it has no children
+		for (it = mChildren.Begin(); it != itend; ++it)
+		{
+			(*it)->_setTransformHierarchy(NULL);
+		}
+		mHierarchy->destroyTransform(mHierarchyHandle);
+		mHierarchy = NULL;
+		mHierarchyHandle = RenderTransformHierarchy::INVALID_HANDLE;
+
+		// back to deriving the transform per node
+		mParentNotified = false;
+		needUpdate();
+	}
+
+	if (hierarchy)
+	{
+		RenderTransformHierarchy::Handle parentHandle = RenderTransformHierarchy::INVALID_HANDLE;
+		if (mParent && mParent->mHierarchy == hierarchy)
+		{
+			parentHandle = mParent->mHierarchyHandle;
+		}
+		mHierarchy = hierarchy;
+		mHierarchyHandle = hierarchy->createTransform(parentHandle);
+		mChildrenToUpdate.clear();
+		needUpdate();
+
+		for (it = mChildren.Begin(); it != itend; ++it)
+		{
+			(*it)->_setTransformHierarchy(hierarchy);
+		}
+	}
+}
+//-----------------------------------------------------------------------
+void RenderNode::_updateSceneIndex(void)
+{
+	ChildNodeIterator it, itend;
+	itend = mChildren.End();
+	for (it = mChildren.Begin(); it != itend; ++it)
+	{
+		(*it)->_updateSceneIndex();
+	}
+}
+//-----------------------------------------------------------------------
+void RenderNode::_updateFromHierarchy(void) const
+{
+	mHierarchy->getDerivedTransform(mHierarchyHandle, mDerivedPosition, mDerivedOrientation, mDerivedScale);
+}
+//-----------------------------------------------------------------------
 void RenderNode::queueNeedUpdate(RenderNode* n)
 {
 	// Don't queue the node more than once
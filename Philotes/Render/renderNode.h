@@ -2,8 +2,8 @@
 #pragma once
 
 #include "renderUtil.h"
+#include "renderTransformHierarchy.h"
 #include <set>
-#include <map>
 
 _NAMESPACE_BEGIN
 
@@ -17,6 +17,8 @@ enum NodeType
 
 class RenderNode
 {
+	PH_DECLARE_HEAP_ALLOC(Memory::RenderHeap)
+
 	 public:
         /** Enumeration denoting the spaces which a transform can be relative to.
         */
@@ -30,8 +32,9 @@ class RenderNode
             TS_WORLD
         };
 
-		typedef std::map<String, RenderNode*>	ChildNodeMap;
-		typedef ChildNodeMap::iterator		ChildNodeIterator;
+		typedef Array<RenderNode*>				ChildNodeArray;
+		typedef ChildNodeArray::Iterator		ChildNodeIterator;
+		typedef HashTable<StringAtom, IndexT>	ChildNameMap;
 
 		/** Listener which gets called back on Node events.
 		*/
@@ -59,8 +62,12 @@ class RenderNode
     protected:
         /// Pointer to parent node
         RenderNode* mParent;
-        /// Collection of pointers to direct children; hashmap for efficiency
-        ChildNodeMap mChildren;
+        /// Direct children, contiguous; removing a child moves the last one into its place
+        ChildNodeArray mChildren;
+        /// Index of every named child in mChildren, stays empty (and unallocated) while all children are anonymous
+        ChildNameMap mChildrenByName;
+        /// Index of this node in the mChildren of its parent
+        IndexT mChildIndex;
 
 		typedef std::set<RenderNode*> ChildUpdateSet;
         /// List of children which need updating, used if self is not out of date but children are
@@ -74,14 +81,11 @@ class RenderNode
         /// Flag indicating that the node has been queued for update
         mutable bool mQueuedForUpdate;
 
-        /// Friendly name of this node, can be automatically generated if you don't care
-        String mName;
+        /// Friendly name of this node, invalid for anonymous nodes
+        StringAtom mName;
 
 		NodeType mNodeType;
 
-        /// Incremented count for next name extension
-        static NameGenerator msNameGenerator;
-
         /// Stores the orientation of the node relative to it's parent.
         Quaternion mOrientation;
 
@@ -100,6 +104,9 @@ class RenderNode
         /// Only available internally - notification of parent.
         virtual void setParent(RenderNode* parent);
 
+        /// Detaches the child at the given index, filling the gap with the last child.
+        void eraseChild(IndexT index);
+
         /** Cached combined orientation.
             @par
                 This member is the orientation derived by combining the
@@ -167,10 +174,22 @@ class RenderNode
 		typedef Array<RenderNode*> QueuedUpdates;
 		static QueuedUpdates msQueuedUpdates;
 
+		/** Flat storage which holds the transforms of this node, NULL if the node updates itself.
+		@remarks
+			While the node is part of a RenderTransformHierarchy the setters push the
+			local transform to it and the derived getters read from it, the per node
+			update flags and the nodeUpdated listener callback are not used.
+		*/
+		RenderTransformHierarchy* mHierarchy;
+		RenderTransformHierarchy::Handle mHierarchyHandle;
+
+		/** Copies the derived transform from the hierarchy into the cached members. */
+		void _updateFromHierarchy(void) const;
+
     public:
         /** Constructor, should only be called by parent, not directly.
         @remarks
-            Generates a name.
+            The node is anonymous, its parent can not look it up by name.
         */
         RenderNode();
         /** Constructor, should only be called by parent, not directly.
@@ -182,7 +201,7 @@ class RenderNode
         virtual ~RenderNode();  
 
         /** Returns the name of the node. */
-        const String& getName(void) const;
+        const StringAtom& getName(void) const;
 
         /** Gets this node's parent (NULL if this is the root).
         */
@@ -466,11 +485,13 @@ class RenderNode
 
 		virtual SizeT getChildrenNum() const
 		{
-			return mChildren.size();
+			return mChildren.Size();
 		}
 
         /** Adds a (precreated) child scene node to this node. If it is attached to another node,
             it must be detached first.
+        @remarks
+            Named children must have names which are unique among the children of this node.
         @param child The Node which is to become a child node of this one
         */
         virtual void addChild(RenderNode* child);
@@ -482,6 +503,7 @@ class RenderNode
         /** Gets a pointer to a child node.
         @remarks
             There is an alternate getChild method which returns a named child.
+            Removing a child moves the last child to its index.
         */
         virtual RenderNode* getChild(unsigned short index);    
 
@@ -518,6 +540,20 @@ class RenderNode
         virtual void removeAllChildren(void);
 
 		NodeType	getNodeType() const {return mNodeType;}
+
+		/** Moves this node and its subtree into a flat transform hierarchy, NULL moves them out again.
+		@remarks
+			Children which are added later join the hierarchy of their parent, nodes which are
+			detached from their parent leave it.
+		*/
+		void _setTransformHierarchy(RenderTransformHierarchy* hierarchy);
+
+		RenderTransformHierarchy* _getTransformHierarchy(void) const { return mHierarchy; }
+
+		/** Enters the attached elements of this node and its subtree anew into the scene index
+			of the cell they are under now, called whenever the node changes its parent.
+		*/
+		virtual void _updateSceneIndex(void);
 		
 		/** Sets the final world position of the node directly.
 		@remarks 
@@ -0,0 +1,619 @@
+#include "renderOctree.h"
+#include "renderTransformElement.h"
+#include "renderFrustum.h"
+
+#include <algorithm>
+
+_NAMESPACE_BEGIN
+
+const RenderOctree::Handle RenderOctree::INVALID_HANDLE;
+
+const IndexT RenderOctree::ROOT;
+
+namespace
+{
+	enum Overlap
+	{
+		OUTSIDE,
+		PARTIAL,
+		INSIDE
+	};
+
+	// the tests of collect(), classify a box given by center and half size
+
+	struct FrustumTest
+	{
+		FrustumTest(const RenderFrustum* frustum)
+			:planes(frustum->getFrustumPlanes()),
+			// an infinite far plane culls nothing
+			infiniteFar(frustum->getFarClipDistance() == 0)
+		{
+		}
+
+		Overlap classify(const Vector3& center, const Vector3& halfSize) const
+		{
+			Overlap overlap = INSIDE;
+			for (int plane = 0; plane < 6; ++plane)
+			{
+				if (plane == FRUSTUM_PLANE_FAR && infiniteFar)
+				{
+					continue;
+				}
+
+				Plane::Side side = planes[plane].getSide(center, halfSize);
+				if (side == Plane::NEGATIVE_SIDE)
+				{
+					return OUTSIDE;
+				}
+				if (side == Plane::BOTH_SIDE)
+				{
+					overlap = PARTIAL;
+				}
+			}
+			return overlap;
+		}
+
+		const Plane* planes;
+		bool infiniteFar;
+	};
+
+	struct SphereTest
+	{
+		SphereTest(const Sphere& sphere)
+			:center(sphere.getCenter()), radiusSquared(sphere.getRadius() * sphere.getRadius())
+		{
+		}
+
+		Overlap classify(const Vector3& boxCenter, const Vector3& halfSize) const
+		{
+			Vector3 offset = center - boxCenter;
+			offset.x = Math::Abs(offset.x);
+			offset.y = Math::Abs(offset.y);
+			offset.z = Math::Abs(offset.z);
+
+			// nearest point of the box
+			Vector3 nearest(Math::Max(offset.x - halfSize.x, 0.0f),
+				Math::Max(offset.y - halfSize.y, 0.0f),
+				Math::Max(offset.z - halfSize.z, 0.0f));
+			if (nearest.squaredLength() > radiusSquared)
+			{
+				return OUTSIDE;
+			}
+			// farthest corner of the box
+			return (offset + halfSize).squaredLength() <= radiusSquared ? INSIDE : PARTIAL;
+		}
+
+		Vector3 center;
+		scalar radiusSquared;
+	};
+
+	struct BoxTest
+	{
+		BoxTest(const AxisAlignedBox& box)
+			:minimum(box.getMinimum()), maximum(box.getMaximum())
+		{
+		}
+
+		Overlap classify(const Vector3& center, const Vector3& halfSize) const
+		{
+			Vector3 boxMin = center - halfSize;
+			Vector3 boxMax = center + halfSize;
+			if (boxMax.x < minimum.x || boxMax.y < minimum.y || boxMax.z < minimum.z ||
+				boxMin.x > maximum.x || boxMin.y > maximum.y || boxMin.z > maximum.z)
+			{
+				return OUTSIDE;
+			}
+			if (boxMin.x >= minimum.x && boxMin.y >= minimum.y && boxMin.z >= minimum.z &&
+				boxMax.x <= maximum.x && boxMax.y <= maximum.y && boxMax.z <= maximum.z)
+			{
+				return INSIDE;
+			}
+			return PARTIAL;
+		}
+
+		Vector3 minimum;
+		Vector3 maximum;
+	};
+
+	struct VolumeTest
+	{
+		VolumeTest(const PlaneBoundedVolume& volume)
+			:volume(volume)
+		{
+		}
+
+		Overlap classify(const Vector3& center, const Vector3& halfSize) const
+		{
+			Overlap overlap = INSIDE;
+			for (PlaneBoundedVolume::PlaneList::const_iterator it = volume.planes.begin(); it != volume.planes.end(); ++it)
+			{
+				Plane::Side side = it->getSide(center, halfSize);
+				if (side == volume.outside)
+				{
+					return OUTSIDE;
+				}
+				if (side == Plane::BOTH_SIDE)
+				{
+					overlap = PARTIAL;
+				}
+			}
+			return overlap;
+		}
+
+		const PlaneBoundedVolume& volume;
+	};
+}
+
+RenderOctree::RenderOctree( const AxisAlignedBox& worldBounds, uint16 maxDepth, bool flat /*= false*/ )
+	:m_worldBounds(worldBounds),
+	m_maxDepth(maxDepth),
+	m_flat(flat),
+	m_numItems(0)
+{
+	ph_assert(worldBounds.isFinite());
+
+	createNode(InvalidIndex, worldBounds.getCenter(), worldBounds.getHalfSize());
+}
+
+RenderOctree::~RenderOctree()
+{
+	for (IndexT i = 0; i < m_items.Size(); ++i)
+	{
+		if (m_items[i].element)
+		{
+			m_items[i].element->_notifyOctree(NULL, INVALID_HANDLE);
+		}
+	}
+}
+
+RenderOctree::Handle RenderOctree::add( RenderTransformElement* element )
+{
+	// ֻһУѯϲʱظ
+	ph_assert(element && !element->getOctree() && !element->getBVH());
+
+	Handle handle;
+	if (!m_freeHandles.IsEmpty())
+	{
+		handle = m_freeHandles.Back();
+		m_freeHandles.PopBack();
+	}
+	else
+	{
+		handle = (Handle)m_items.Size();
+		m_items.Append(Item());
+	}
+
+	Item& item = m_items[handle];
+	item.element = element;
+	item.node = InvalidIndex;
+	item.prev = INVALID_HANDLE;
+	item.next = INVALID_HANDLE;
+	setBounds(item, element->isAttached() ? element->getWorldBoundingBox() : AxisAlignedBox::BOX_NULL);
+
+	link(handle, placeItem(item));
+	++m_numItems;
+
+	element->_notifyOctree(this, handle);
+	return handle;
+}
+
+void RenderOctree::remove( Handle handle )
+{
+	Item& item = m_items[handle];
+	ph_assert(item.element);
+
+	unlink(handle);
+	item.element->_notifyOctree(NULL, INVALID_HANDLE);
+	item.element = NULL;
+
+	m_freeHandles.Append(handle);
+	--m_numItems;
+}
+
+void RenderOctree::move( Handle handle, const AxisAlignedBox& bounds )
+{
+	Item& item = m_items[handle];
+	ph_assert(item.element);
+
+	setBounds(item, bounds);
+	if (!isPlacedIn(item, item.node))
+	{
+		unlink(handle);
+		link(handle, placeItem(m_items[handle]));
+	}
+}
+
+void RenderOctree::update()
+{
+	for (IndexT i = 0; i < m_items.Size(); ++i)
+	{
+		const Item& item = m_items[i];
+		if (!item.element)
+		{
+			continue;
+		}
+
+		// derived by RenderTransform::_updateBounds()
+		const AxisAlignedBox& bounds = item.element->isAttached() ? item.element->getWorldBoundingBox() : AxisAlignedBox::BOX_NULL;
+		if (!hasBounds(item, bounds))
+		{
+			move((Handle)i, bounds);
+		}
+	}
+}
+
+void RenderOctree::findVisible( const RenderFrustum* frustum, Array<RenderTransformElement*>& result ) const
+{
+	collect(FrustumTest(frustum), ROOT, false, result);
+}
+
+void RenderOctree::findIntersecting( const Sphere& sphere, Array<RenderTransformElement*>& result ) const
+{
+	collect(SphereTest(sphere), ROOT, false, result);
+}
+
+void RenderOctree::findIntersecting( const AxisAlignedBox& box, Array<RenderTransformElement*>& result ) const
+{
+	if (box.isNull())
+	{
+		return;
+	}
+	if (box.isInfinite())
+	{
+		collect(BoxTest(m_worldBounds), ROOT, true, result);
+		return;
+	}
+	collect(BoxTest(box), ROOT, false, result);
+}
+
+void RenderOctree::findIntersecting( const PlaneBoundedVolume& volume, Array<RenderTransformElement*>& result ) const
+{
+	collect(VolumeTest(volume), ROOT, false, result);
+}
+
+void RenderOctree::findIntersecting( const Ray& ray, Array<RayHit>& result, bool sortByDistance /*= true*/ ) const
+{
+	SizeT first = result.Size();
+	collect(ray, ROOT, result);
+
+	if (sortByDistance && result.Size() - first > 1)
+	{
+		std::sort(result.Begin() + first, result.End());
+	}
+}
+
+template<class TEST>
+void RenderOctree::collect( const TEST& test, IndexT nodeIndex, bool inside, Array<RenderTransformElement*>& result ) const
+{
+	const Node& node = m_nodes[nodeIndex];
+
+	// the root also holds the elements outside the world, its bounds say nothing
+	if (!inside && nodeIndex != ROOT)
+	{
+		Overlap overlap = test.classify(node.center, node.halfSize * 2);
+		if (overlap == OUTSIDE)
+		{
+			return;
+		}
+		inside = overlap == INSIDE;
+	}
+
+	for (Handle h = node.firstItem; h != INVALID_HANDLE; h = m_items[h].next)
+	{
+		const Item& item = m_items[h];
+		if (item.extent == AxisAlignedBox::EXTENT_NULL)
+		{
+			continue;
+		}
+		if (inside || item.extent == AxisAlignedBox::EXTENT_INFINITE ||
+			test.classify((item.minimum + item.maximum) * 0.5f, (item.maximum - item.minimum) * 0.5f) != OUTSIDE)
+		{
+			result.Append(item.element);
+		}
+	}
+
+	for (int c = 0; c < 8; ++c)
+	{
+		IndexT child = node.children[c];
+		if (child != InvalidIndex)
+		{
+			collect(test, child, inside, result);
+		}
+	}
+}
+
+void RenderOctree::collect( const Ray& ray, IndexT nodeIndex, Array<RayHit>& result ) const
+{
+	const Node& node = m_nodes[nodeIndex];
+
+	if (nodeIndex != ROOT)
+	{
+		Vector3 looseHalfSize = node.halfSize * 2;
+		if (!Math::intersects(ray, AxisAlignedBox(node.center - looseHalfSize, node.center + looseHalfSize)).first)
+		{
+			return;
+		}
+	}
+
+	for (Handle h = node.firstItem; h != INVALID_HANDLE; h = m_items[h].next)
+	{
+		const Item& item = m_items[h];
+		if (item.extent == AxisAlignedBox::EXTENT_NULL)
+		{
+			continue;
+		}
+
+		std::pair<bool, scalar> hit = item.extent == AxisAlignedBox::EXTENT_INFINITE ?
+			std::pair<bool, scalar>(true, 0) :
+			Math::intersects(ray, AxisAlignedBox(item.minimum, item.maximum));
+		if (hit.first)
+		{
+			RayHit rayHit;
+			rayHit.element = item.element;
+			rayHit.distance = hit.second;
+			result.Append(rayHit);
+		}
+	}
+
+	for (int c = 0; c < 8; ++c)
+	{
+		IndexT child = node.children[c];
+		if (child != InvalidIndex)
+		{
+			collect(ray, child, result);
+		}
+	}
+}
+
+Vector3 RenderOctree::getChildHalfSize( const Node& node ) const
+{
+	return Vector3(node.halfSize.x * 0.5f, m_flat ? node.halfSize.y : node.halfSize.y * 0.5f, node.halfSize.z * 0.5f);
+}
+
+IndexT RenderOctree::placeItem( const Item& item )
+{
+	if (item.extent != AxisAlignedBox::EXTENT_FINITE)
+	{
+		return ROOT;
+	}
+
+	const Vector3 center = (item.minimum + item.maximum) * 0.5f;
+	const Vector3 halfSize = (item.maximum - item.minimum) * 0.5f;
+	const Vector3& worldMin = m_worldBounds.getMinimum();
+	const Vector3& worldMax = m_worldBounds.getMaximum();
+	if (center.x < worldMin.x || center.y < worldMin.y || center.z < worldMin.z ||
+		center.x > worldMax.x || center.y > worldMax.y || center.z > worldMax.z)
+	{
+		return ROOT;
+	}
+
+	IndexT nodeIndex = ROOT;
+	for (uint16 depth = 0; depth < m_maxDepth; ++depth)
+	{
+		const Node& node = m_nodes[nodeIndex];
+		const Vector3 childHalfSize = getChildHalfSize(node);
+		if (halfSize.x > childHalfSize.x || halfSize.y > childHalfSize.y || halfSize.z > childHalfSize.z)
+		{
+			break;
+		}
+
+		int c = 0;
+		Vector3 childCenter = node.center;
+		if (center.x >= node.center.x)
+		{
+			c |= 1;
+			childCenter.x += childHalfSize.x;
+		}
+		else
+		{
+			childCenter.x -= childHalfSize.x;
+		}
+		if (center.z >= node.center.z)
+		{
+			c |= 2;
+			childCenter.z += childHalfSize.z;
+		}
+		else
+		{
+			childCenter.z -= childHalfSize.z;
+		}
+		if (!m_flat)
+		{
+			if (center.y >= node.center.y)
+			{
+				c |= 4;
+				childCenter.y += childHalfSize.y;
+			}
+			else
+			{
+				childCenter.y -= childHalfSize.y;
+			}
+		}
+
+		IndexT child = node.children[c];
+		if (child == InvalidIndex)
+		{
+			// node is invalidated by createNode()
+			child = createNode(nodeIndex, childCenter, childHalfSize);
+			m_nodes[nodeIndex].children[c] = child;
+		}
+		nodeIndex = child;
+	}
+	return nodeIndex;
+}
+
+bool RenderOctree::isPlacedIn( const Item& item, IndexT nodeIndex ) const
+{
+	if (item.extent != AxisAlignedBox::EXTENT_FINITE)
+	{
+		return nodeIndex == ROOT;
+	}
+
+	const Node& node = m_nodes[nodeIndex];
+	const Vector3 center = (item.minimum + item.maximum) * 0.5f;
+	const Vector3 halfSize = (item.maximum - item.minimum) * 0.5f;
+
+	const Vector3 childHalfSize = getChildHalfSize(node);
+	const bool tooLargeForChild = node.depth == m_maxDepth ||
+		halfSize.x > childHalfSize.x || halfSize.y > childHalfSize.y || halfSize.z > childHalfSize.z;
+
+	if (nodeIndex == ROOT)
+	{
+		return tooLargeForChild || !m_worldBounds.contains(center);
+	}
+
+	// the center in the cell, the cells of a level share their borders and
+	// placeItem() picks the upper one, an element on a border is simply placed again
+	const Vector3 offset = center - node.center;
+	if (Math::Abs(offset.x) >= node.halfSize.x || Math::Abs(offset.z) >= node.halfSize.z ||
+		(m_flat ? Math::Abs(offset.y) > node.halfSize.y : Math::Abs(offset.y) >= node.halfSize.y))
+	{
+		return false;
+	}
+	// small enough for the node but not for a child
+	if (halfSize.x > node.halfSize.x || halfSize.y > node.halfSize.y || halfSize.z > node.halfSize.z)
+	{
+		return false;
+	}
+	return tooLargeForChild;
+}
+
+void RenderOctree::setBounds( Item& item, const AxisAlignedBox& bounds )
+{
+	if (bounds.isNull())
+	{
+		item.extent = AxisAlignedBox::EXTENT_NULL;
+	}
+	else if (bounds.isInfinite())
+	{
+		item.extent = AxisAlignedBox::EXTENT_INFINITE;
+	}
+	else
+	{
+		item.extent = AxisAlignedBox::EXTENT_FINITE;
+		item.minimum = bounds.getMinimum();
+		item.maximum = bounds.getMaximum();
+	}
+}
+
+bool RenderOctree::hasBounds( const Item& item, const AxisAlignedBox& bounds ) const
+{
+	if (bounds.isNull())
+	{
+		return item.extent == AxisAlignedBox::EXTENT_NULL;
+	}
+	if (bounds.isInfinite())
+	{
+		return item.extent == AxisAlignedBox::EXTENT_INFINITE;
+	}
+	return item.extent == AxisAlignedBox::EXTENT_FINITE &&
+		item.minimum == bounds.getMinimum() && item.maximum == bounds.getMaximum();
+}
+
+void RenderOctree::link( Handle handle, IndexT nodeIndex )
+{
+	Item& item = m_items[handle];
+	Node& node = m_nodes[nodeIndex];
+
+	item.node = nodeIndex;
+	item.prev = INVALID_HANDLE;
+	item.next = node.firstItem;
+	if (node.firstItem != INVALID_HANDLE)
+	{
+		m_items[node.firstItem].prev = handle;
+	}
+	node.firstItem = handle;
+
+	for (IndexT n = nodeIndex; n != InvalidIndex; n = m_nodes[n].parent)
+	{
+		++m_nodes[n].numSubtreeItems;
+	}
+}
+
+void RenderOctree::unlink( Handle handle )
+{
+	Item& item = m_items[handle];
+	Node& node = m_nodes[item.node];
+
+	if (item.prev != INVALID_HANDLE)
+	{
+		m_items[item.prev].next = item.next;
+	}
+	else
+	{
+		node.firstItem = item.next;
+	}
+	if (item.next != INVALID_HANDLE)
+	{
+		m_items[item.next].prev = item.prev;
+	}
+
+	// the empty nodes are a path from the node up, release the topmost one
+	IndexT empty = InvalidIndex;
+	for (IndexT n = item.node; n != InvalidIndex; n = m_nodes[n].parent)
+	{
+		if (--m_nodes[n].numSubtreeItems == 0 && n != ROOT)
+		{
+			empty = n;
+		}
+	}
+	if (empty != InvalidIndex)
+	{
+		Node& parent = m_nodes[m_nodes[empty].parent];
+		for (int c = 0; c < 8; ++c)
+		{
+			if (parent.children[c] == empty)
+			{
+				parent.children[c] = InvalidIndex;
+			}
+		}
+		releaseNode(empty);
+	}
+
+	item.node = InvalidIndex;
+	item.prev = INVALID_HANDLE;
+	item.next = INVALID_HANDLE;
+}
+
+IndexT RenderOctree::createNode( IndexT parent, const Vector3& center, const Vector3& halfSize )
+{
+	IndexT nodeIndex;
+	if (!m_freeNodes.IsEmpty())
+	{
+		nodeIndex = m_freeNodes.Back();
+		m_freeNodes.PopBack();
+	}
+	else
+	{
+		nodeIndex = m_nodes.Size();
+		m_nodes.Append(Node());
+	}
+
+	Node& node = m_nodes[nodeIndex];
+	node.center = center;
+	node.halfSize = halfSize;
+	node.parent = parent;
+	for (int c = 0; c < 8; ++c)
+	{
+		node.children[c] = InvalidIndex;
+	}
+	node.depth = parent == InvalidIndex ? 0 : m_nodes[parent].depth + 1;
+	node.firstItem = INVALID_HANDLE;
+	node.numSubtreeItems = 0;
+	return nodeIndex;
+}
+
+void RenderOctree::releaseNode( IndexT nodeIndex )
+{
+	for (int c = 0; c < 8; ++c)
+	{
+		IndexT child = m_nodes[nodeIndex].children[c];
+		if (child != InvalidIndex)
+		{
+			releaseNode(child);
+		}
+	}
+	m_freeNodes.Append(nodeIndex);
+}
+
+_NAMESPACE_END
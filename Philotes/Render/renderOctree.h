@@ -0,0 +1,174 @@
+#pragma once
+
+#include "math/axisAlignedBox.h"
+#include "math/sphere.h"
+#include "math/ray.h"
+#include "math/planeBoundedVolume.h"
+
+_NAMESPACE_BEGIN
+
+/** Loose octree over the world bounds of RenderTransformElements.
+@remarks
+	Every node has a cell, the node's box of the regular subdivision, and
+	loose bounds twice as large around the same center. An element is kept
+	in the deepest node whose cell contains the center of its bounds and
+	whose cells are at least as large as its bounds, which puts it inside
+	the loose bounds of that node. The node follows from the size and the
+	position of the bounds alone, so moving an element never needs to look
+	at other elements, and an element which stays in its node is not moved
+	at all.
+@par
+	Elements whose center lies outside the world bounds, and elements with
+	infinite bounds, stay in the root, whose elements are always tested. A
+	flat tree does not split the height: every node spans the height of
+	the world and has 4 children instead of 8, a loose quadtree for mostly
+	flat worlds.
+@par
+	Queries append the elements whose bounds overlap the query, the
+	elements of nodes which lie completely inside the query are appended
+	without testing them one by one.
+*/
+class RenderOctree
+{
+	PH_DECLARE_HEAP_ALLOC(Memory::RenderHeap)
+
+public:
+
+	typedef uint32 Handle;
+
+	static const Handle INVALID_HANDLE = 0xffffffff;
+
+	/// an element hit by a ray, at distance along the ray
+	struct RayHit
+	{
+		RenderTransformElement*	element;
+		scalar					distance;
+
+		bool operator<(const RayHit& rhs) const { return distance < rhs.distance; }
+	};
+
+	RenderOctree(const AxisAlignedBox& worldBounds, uint16 maxDepth, bool flat = false);
+
+	~RenderOctree();
+
+public:
+
+	/** Adds an element with its current world bounding box.
+	@remarks
+		The element keeps its handle, see RenderTransformElement::getOctree(),
+		and removes itself when it is destroyed.
+	*/
+	Handle					add(RenderTransformElement* element);
+
+	void					remove(Handle handle);
+
+	/** Moves an element to the node of new bounds, cheap if it stays in its node. */
+	void					move(Handle handle, const AxisAlignedBox& bounds);
+
+	/** Moves every element whose world bounding box changed, call after the scene graph update.
+	@remarks
+		Detached elements get null bounds, no query finds them.
+	*/
+	void					update();
+
+	/** Finds the elements inside or intersecting a frustum. */
+	void					findVisible(const RenderFrustum* frustum, Array<RenderTransformElement*>& result) const;
+
+	/** Finds the elements whose bounds intersect a sphere. */
+	void					findIntersecting(const Sphere& sphere, Array<RenderTransformElement*>& result) const;
+
+	/** Finds the elements whose bounds intersect a box. */
+	void					findIntersecting(const AxisAlignedBox& box, Array<RenderTransformElement*>& result) const;
+
+	/** Finds the elements inside or intersecting a convex volume, e.g. RenderCamera::getCameraToViewportBoxVolume(). */
+	void					findIntersecting(const PlaneBoundedVolume& volume, Array<RenderTransformElement*>& result) const;
+
+	/** Finds the elements whose bounds a ray hits, sorted by distance if requested. */
+	void					findIntersecting(const Ray& ray, Array<RayHit>& result, bool sortByDistance = true) const;
+
+	RenderTransformElement*	getElement(Handle handle) const { return m_items[handle].element; }
+
+	const AxisAlignedBox&	getWorldBounds() const { return m_worldBounds; }
+
+	uint16					getMaxDepth() const { return m_maxDepth; }
+
+	bool					isFlat() const { return m_flat; }
+
+	SizeT					size() const { return m_numItems; }
+
+	/** Returns the number of nodes in use, nodes without elements below them are released. */
+	SizeT					getNumNodes() const { return m_nodes.Size() - m_freeNodes.Size(); }
+
+protected:
+
+	static const IndexT		ROOT = 0;
+
+	struct Node
+	{
+		Vector3		center;
+		Vector3		halfSize;			// of the cell, the loose bounds are twice as large
+		IndexT		parent;
+		IndexT		children[8];		// InvalidIndex if absent, only 4 are used by a flat tree
+		uint16		depth;
+		Handle		firstItem;			// list of the elements in the node
+		SizeT		numSubtreeItems;	// elements in the node and below it
+	};
+
+	struct Item
+	{
+		RenderTransformElement*	element;	// NULL for free handles
+		Vector3		minimum;
+		Vector3		maximum;
+		uint8		extent;				// AxisAlignedBox::Extent
+		IndexT		node;
+		Handle		prev;
+		Handle		next;
+	};
+
+	/// returns the node an element with the bounds of item belongs to, creating the nodes on the way
+	IndexT					placeItem(const Item& item);
+
+	/// returns true if placeItem() would return node
+	bool					isPlacedIn(const Item& item, IndexT node) const;
+
+	/// the half size of the cells of the children of node
+	Vector3					getChildHalfSize(const Node& node) const;
+
+	void					setBounds(Item& item, const AxisAlignedBox& bounds);
+
+	bool					hasBounds(const Item& item, const AxisAlignedBox& bounds) const;
+
+	void					link(Handle handle, IndexT node);
+
+	/// removes an item from its node and releases the nodes left empty
+	void					unlink(Handle handle);
+
+	IndexT					createNode(IndexT parent, const Vector3& center, const Vector3& halfSize);
+
+	void					releaseNode(IndexT node);
+
+	template<class TEST>
+	void					collect(const TEST& test, IndexT node, bool inside, Array<RenderTransformElement*>& result) const;
+
+	void					collect(const Ray& ray, IndexT node, Array<RayHit>& result) const;
+
+protected:
+
+	AxisAlignedBox			m_worldBounds;
+
+	uint16					m_maxDepth;
+
+	bool					m_flat;
+
+	Array<Node>				m_nodes;
+
+	Array<IndexT>			m_freeNodes;
+
+	Array<Item>				m_items;
+
+	Array<Handle>			m_freeHandles;
+
+	SizeT					m_numItems;
+};
+
+_NAMESPACE_END
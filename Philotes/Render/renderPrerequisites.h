@@ -13,6 +13,9 @@ class RenderCellNode;
 class RenderNode;
 class RenderTransform;
 class RenderTransformElement;
+class RenderTransformHierarchy;
+class RenderOctree;
+class RenderBVH;
 class RenderGridElement;
 class RenderLineElement;
 class RenderWindow;
@@ -43,5 +46,8 @@ class RenderModel;
 class RenderLight;
 class RenderLightDesc;
 class RenderVisitor;
+class RenderShaderKey;
+class RenderShaderCompiler;
+class RenderShaderCache;
 
 _NAMESPACE_END
\ No newline at end of file
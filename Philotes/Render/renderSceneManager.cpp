@@ -3,22 +3,54 @@
 #include "gearsApplication.h"
 #include "renderCamera.h"
 #include "renderCellNode.h"
+#include "renderTransformHierarchy.h"
+#include "core/jobsystem.h"
+
+#include <algorithm>
 
 _NAMESPACE_BEGIN
 
 RenderSceneManager::RenderSceneManager()
+	:m_cellNameGenerator("cn_")
 {
-	m_renderer = GearApplication::getApp()->getRender();
+	// ûӦóʱУֻ
+	GearApplication* app = GearApplication::getApp();
+	m_renderer = app ? app->getRender() : NULL;
 	m_camera = ph_new(RenderCamera)("main_cam");
 	m_camera->setNearClipDistance(0.1f);
 	m_camera->setFarClipDistance(10000.0f);
 
 	m_rootNode = NULL;
+
+#if RENDERER_FLAT_TRANSFORMS
+	m_transformHierarchy = ph_new(RenderTransformHierarchy);
+#else
+	m_transformHierarchy = NULL;
+#endif
+
+	const scalar halfSize = RENDERER_OCTREE_WORLD_SIZE * 0.5f;
+	m_octree = ph_new(RenderOctree)(AxisAlignedBox(-halfSize, -halfSize, -halfSize, halfSize, halfSize, halfSize),
+		RENDERER_OCTREE_MAX_DEPTH, RENDERER_OCTREE_FLAT != 0);
+
+	m_bvh = ph_new(RenderBVH);
 }
 
 RenderSceneManager::~RenderSceneManager()
 {
+	ph_delete(m_bvh);
+
+	ph_delete(m_octree);
+
 	ph_delete(m_camera);
+
+	if (m_transformHierarchy)
+	{
+		if (m_rootNode)
+		{
+			m_rootNode->_setTransformHierarchy(NULL);
+		}
+		ph_delete(m_transformHierarchy);
+	}
 }
 
 void RenderSceneManager::tickVisible( const RenderCamera* camera )
@@ -27,36 +59,83 @@ void RenderSceneManager::tickVisible( const RenderCamera* camera )
 	getRootCellNode();
 	if (m_rootNode)
 	{
-		m_rootNode->tickVisible(camera);
+		Timer timer;
+		updateSceneGraph();
+		m_octree->update();
+		m_bvh->update();
+		m_visibilityStats.updateTime = timer.getElapsedSeconds();
+
+#if RENDERER_PARALLEL_VISIBILITY
+		JobSystem* jobSystem = GearApplication::getApp()->getJobSystem();
+		if (jobSystem && jobSystem->IsValid() && jobSystem->GetNumThreads() > 1)
+		{
+			m_rootNode->tickVisibleParallel(camera, jobSystem, &m_visibilityStats);
+			return;
+		}
+#endif
+		m_rootNode->tickVisible(camera, &m_visibilityStats);
 	}
 }
 
+void RenderSceneManager::updateSceneGraph()
+{
+	// нڵ任ͰΧ
+#if RENDERER_PARALLEL_SCENE_UPDATE
+	JobSystem* jobSystem = GearApplication::getApp()->getJobSystem();
+	if (jobSystem && jobSystem->IsValid())
+	{
+		m_rootNode->_updateParallel(jobSystem);
+		return;
+	}
+#endif
+	// ƽ任㼶ڸڵ_updateһԸ
+	m_rootNode->_update(true, false);
+}
+
+void RenderSceneManager::pickObjects( scalar screenX, scalar screenY, Array<RenderOctree::RayHit>& hits ) const
+{
+	const Ray ray = m_camera->getCameraToViewportRay(screenX, screenY);
+	SizeT first = hits.Size();
+	m_octree->findIntersecting(ray, hits, false);
+	m_bvh->findIntersecting(ray, hits, false);
+	std::sort(hits.Begin() + first, hits.End());
+}
+
+void RenderSceneManager::selectObjects( scalar left, scalar top, scalar right, scalar bottom, Array<RenderTransformElement*>& result ) const
+{
+	const PlaneBoundedVolume volume = m_camera->getCameraToViewportBoxVolume(left, top, right, bottom);
+	m_octree->findIntersecting(volume, result);
+	m_bvh->findIntersecting(volume, result);
+}
+
 RenderCellNode* RenderSceneManager::getRootCellNode()
 {
 	if (!m_rootNode)
 	{
 		m_rootNode = _createCellNodeImpl("_root_cn");
+		if (m_transformHierarchy)
+		{
+			m_rootNode->_setTransformHierarchy(m_transformHierarchy);
+		}
 	}
 	return m_rootNode;
 }
 
 RenderCellNode* RenderSceneManager::createCellNode( const String& name )
 {
-	if (m_cells.Contains(name))
+	StringAtom atom(name);
+	if (m_cells.Contains(atom))
 	{
 		PH_EXCEPT(ERR_RENDER,"A cell node with the name " + name + " already exists");
 	}
 	RenderCellNode* cn = _createCellNodeImpl(name);
-	m_cells[name] = cn;
+	m_cells[atom] = cn;
 	return cn;
 }
 
 RenderCellNode* RenderSceneManager::createCellNode()
 {
-	RenderCellNode* cn = _createCellNodeImpl();
-	ph_assert(!m_cells.Contains(cn->getName()));
-	m_cells[cn->getName()] = cn;
-	return cn;
+	return createCellNode(m_cellNameGenerator.generate());
 }
 
 RenderCellNode* RenderSceneManager::_createCellNodeImpl( const String& name )
@@ -69,7 +148,7 @@ RenderCellNode* RenderSceneManager::_createCellNodeImpl()
 	return ph_new(RenderCellNode(this));
 }
 
-void RenderSceneManager::destroyCellNode( const String& name )
+void RenderSceneManager::destroyCellNode( const StringAtom& name )
 {
 	IndexT i = m_cells.FindIndex(name);
 	if (i == InvalidIndex)
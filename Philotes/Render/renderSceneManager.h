@@ -1,6 +1,11 @@
 
 #pragma once
 
+#include "renderUtil.h"
+#include "renderCellNode.h"
+#include "renderOctree.h"
+#include "renderBVH.h"
+
 _NAMESPACE_BEGIN
 
 class RenderSceneManager
@@ -18,17 +23,33 @@ public:
 
 	RenderCamera* getCamera(){return m_camera;}
 
+	// Χɢ˲ҵϵķǾ̬Զ룬ÿ֡ڳͼºƶ
+	RenderOctree* getOctree(){return m_octree;}
+
+	// ΧİΧΣҵϡRenderTransformElement::setStaticΪ̬Զ룻
+	// ĬϲǾ̬ģӦòʱΪ
+	RenderBVH* getBVH(){return m_bvh;}
+
+	// ʰȡĻ꣨0~1壬ÿֻһУظ
+	void pickObjects(scalar screenX, scalar screenY, Array<RenderOctree::RayHit>& hits) const;
+
+	// ѡĻΣ0~1ڵ
+	void selectObjects(scalar left, scalar top, scalar right, scalar bottom, Array<RenderTransformElement*>& result) const;
+
+	// һtickVisibleĸ׶κʱ
+	const RenderVisibilityStats& getVisibilityStats() const {return m_visibilityStats;}
+
 	RenderCellNode* getRootCellNode();
 
 	virtual RenderCellNode* createCellNode(const String& name);
 
 	virtual RenderCellNode* createCellNode();
 
-	virtual void destroyCellNode(const String& name);
+	virtual void destroyCellNode(const StringAtom& name);
 
 	virtual void destroyCellNode(RenderCellNode* node);
 
-	typedef Dictionary<String,RenderCellNode*> CellMap;
+	typedef FlatDictionary<StringAtom,RenderCellNode*> CellMap;
 
 protected:
 
@@ -36,6 +57,9 @@ protected:
 
 	virtual RenderCellNode* _createCellNodeImpl();
 
+	// ÿ֡ɼԼ֮ǰ³ͼ
+	virtual void updateSceneGraph();
+
 protected:
 
 	Render* m_renderer;
@@ -44,7 +68,19 @@ protected:
 
 	RenderCellNode* m_rootNode;
 
+	// ƽ任㼶RENDERER_FLAT_TRANSFORMSرʱΪNULL
+	RenderTransformHierarchy* m_transformHierarchy;
+
+	RenderOctree* m_octree;
+
+	RenderBVH* m_bvh;
+
 	CellMap m_cells;
+
+	// ڵҲֵǼǣ
+	NameGenerator m_cellNameGenerator;
+
+	RenderVisibilityStats m_visibilityStats;
 };
 
 _NAMESPACE_END
\ No newline at end of file
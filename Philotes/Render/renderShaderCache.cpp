@@ -0,0 +1,311 @@
+
+#include <renderShaderCache.h>
+#include "util/fast_hash.h"
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+_NAMESPACE_BEGIN
+
+// bump whenever the record layout changes, old records are then simply recompiled.
+static const uint32 SHADER_CACHE_MAGIC   = 0x43534850; // "PHSC"
+static const uint32 SHADER_CACHE_VERSION = 1;
+
+/*******************
+* RenderShaderKey *
+*******************/
+
+RenderShaderKey::RenderShaderKey(void)
+{
+	flags = 0;
+}
+
+String RenderShaderKey::getDescription(void) const
+{
+	String desc;
+	desc.Format("%s|%s|%s|%08x", sourcePath.c_str(), entry.c_str(), profile.c_str(), flags);
+	for(IndexT i=0; i<defines.Size(); i++)
+	{
+		desc.Append("|");
+		desc.Append(defines[i].define);
+		desc.Append("=");
+		desc.Append(defines[i].value);
+	}
+	return desc;
+}
+
+/*********************
+* RenderShaderCache *
+*********************/
+
+static bool writeU32(FILE *file, uint32 v)
+{
+	return fwrite(&v, sizeof(v), 1, file) == 1;
+}
+
+static bool writeU64(FILE *file, uint64 v)
+{
+	return fwrite(&v, sizeof(v), 1, file) == 1;
+}
+
+static bool writeString(FILE *file, const String &s)
+{
+	uint32 len = (uint32)s.Length();
+	return writeU32(file, len) && (len == 0 || fwrite(s.c_str(), 1, len, file) == len);
+}
+
+static bool readU32(FILE *file, uint32 &v)
+{
+	return fread(&v, sizeof(v), 1, file) == 1;
+}
+
+static bool readU64(FILE *file, uint64 &v)
+{
+	return fread(&v, sizeof(v), 1, file) == 1;
+}
+
+static bool readString(FILE *file, String &s)
+{
+	uint32 len = 0;
+	if(!readU32(file, len) || len > 4096) return false;
+	char buf[4097];
+	if(len && fread(buf, 1, len, file) != len) return false;
+	s.Set(buf, (SizeT)len);
+	return true;
+}
+
+RenderShaderCache::RenderShaderCache(const char *cacheDir) :
+	m_cacheDir(cacheDir),
+	m_enabled(true),
+	m_numHits(0),
+	m_numCompiles(0)
+{
+	m_cacheDir.ConvertBackslashes();
+	if(m_cacheDir.IsValid() && m_cacheDir[m_cacheDir.Length()-1] != '/')
+	{
+		m_cacheDir.Append("/");
+	}
+	createDirectory(m_cacheDir);
+}
+
+RenderShaderCache::~RenderShaderCache(void)
+{
+}
+
+void RenderShaderCache::invalidate(void)
+{
+	m_resident.Clear();
+}
+
+void RenderShaderCache::copyDependencyPaths(const Record &record, Array<String> *outDependencies)
+{
+	if(outDependencies)
+	{
+		outDependencies->Clear();
+		for(IndexT i=0; i<record.dependencies.Size(); i++)
+		{
+			outDependencies->Append(record.dependencies[i].path);
+		}
+	}
+}
+
+bool RenderShaderCache::fetch(const RenderShaderKey &key, RenderShaderCompiler &compiler, Array<uint8> &outBlob, Array<String> *outDependencies)
+{
+	if(!m_enabled)
+	{
+		Array<char> source;
+		if(outDependencies)
+		{
+			outDependencies->Clear();
+			compiler.preprocessShader(key, source, *outDependencies);
+		}
+		m_numCompiles++;
+		return compiler.compileShader(key, outBlob);
+	}
+
+	const String description = key.getDescription();
+	IndexT resident = m_resident.FindIndex(description);
+	if(resident != InvalidIndex)
+	{
+		const Record &record = m_resident.ValueAtIndex(resident);
+		outBlob = record.blob;
+		copyDependencyPaths(record, outDependencies);
+		m_numHits++;
+		return true;
+	}
+
+	const uint32 keyHash    = FastHash::ComputeHash(description.c_str(), description.Length());
+	const String recordPath = getRecordPath(keyHash);
+
+	Record record;
+	bool haveRecord = readRecord(recordPath, record) && record.description == description;
+
+	// fast path: nothing the permutation depends on has been touched since it was stored.
+	if(haveRecord && isUpToDate(record))
+	{
+		outBlob = record.blob;
+		copyDependencyPaths(record, outDependencies);
+		m_resident.Add(description, record);
+		m_numHits++;
+		return true;
+	}
+
+	// something changed on disk, expand the source and see whether the compiler would get different input.
+	Array<char>   source;
+	Array<String> dependencies;
+	if(!compiler.preprocessShader(key, source, dependencies))
+	{
+		if(outDependencies)
+		{
+			*outDependencies = dependencies;
+		}
+		m_numCompiles++;
+		return compiler.compileShader(key, outBlob);
+	}
+	const uint32 sourceHash = source.Size() ? FastHash::ComputeHash(&source[0], source.Size()) : 0;
+
+	bool reused = haveRecord && record.sourceHash == sourceHash && record.sourceSize == (uint32)source.Size();
+	if(!reused)
+	{
+		record.blob.Clear();
+		if(!compiler.compileShader(key, record.blob))
+		{
+			return false;
+		}
+		m_numCompiles++;
+	}
+	else
+	{
+		m_numHits++;
+	}
+
+	record.description = description;
+	record.sourceHash  = sourceHash;
+	record.sourceSize  = (uint32)source.Size();
+	record.dependencies.Clear();
+	for(IndexT i=0; i<dependencies.Size(); i++)
+	{
+		Dependency dep;
+		dep.path = dependencies[i];
+		if(stampDependency(dep))
+		{
+			record.dependencies.Append(dep);
+		}
+	}
+	writeRecord(recordPath, record);
+
+	outBlob = record.blob;
+	copyDependencyPaths(record, outDependencies);
+	m_resident.Add(description, record);
+	return true;
+}
+
+String RenderShaderCache::getRecordPath(uint32 keyHash) const
+{
+	String path;
+	path.Format("%s%08x.psc", m_cacheDir.c_str(), keyHash);
+	return path;
+}
+
+bool RenderShaderCache::readRecord(const String &path, Record &record) const
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if(!file) return false;
+
+	bool ok = true;
+	uint32 magic = 0, version = 0, numDeps = 0, blobSize = 0;
+	ok = ok && readU32(file, magic)   && magic   == SHADER_CACHE_MAGIC;
+	ok = ok && readU32(file, version) && version == SHADER_CACHE_VERSION;
+	ok = ok && readString(file, record.description);
+	ok = ok && readU32(file, record.sourceHash);
+	ok = ok && readU32(file, record.sourceSize);
+	ok = ok && readU32(file, numDeps);
+	for(uint32 i=0; ok && i<numDeps; i++)
+	{
+		Dependency dep;
+		ok = readString(file, dep.path) && readU32(file, dep.size) && readU64(file, dep.time);
+		if(ok) record.dependencies.Append(dep);
+	}
+	ok = ok && readU32(file, blobSize) && blobSize > 0;
+	if(ok)
+	{
+		record.blob.Resize(blobSize);
+		ok = fread(&record.blob[0], 1, blobSize, file) == blobSize;
+	}
+	fclose(file);
+	return ok;
+}
+
+bool RenderShaderCache::writeRecord(const String &path, const Record &record) const
+{
+	// write to a temporary file first so a crash never leaves a truncated record behind.
+	String tempPath = path;
+	tempPath.Append(".tmp");
+	FILE *file = fopen(tempPath.c_str(), "wb");
+	if(!file) return false;
+
+	bool ok = writeU32(file, SHADER_CACHE_MAGIC) && writeU32(file, SHADER_CACHE_VERSION);
+	ok = ok && writeString(file, record.description);
+	ok = ok && writeU32(file, record.sourceHash) && writeU32(file, record.sourceSize);
+	ok = ok && writeU32(file, (uint32)record.dependencies.Size());
+	for(IndexT i=0; ok && i<record.dependencies.Size(); i++)
+	{
+		const Dependency &dep = record.dependencies[i];
+		ok = writeString(file, dep.path) && writeU32(file, dep.size) && writeU64(file, dep.time);
+	}
+	ok = ok && writeU32(file, (uint32)record.blob.Size());
+	ok = ok && record.blob.Size() > 0 && fwrite(&record.blob[0], 1, record.blob.Size(), file) == (size_t)record.blob.Size();
+	fclose(file);
+
+	if(ok)
+	{
+		remove(path.c_str());
+		ok = rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+	if(!ok)
+	{
+		remove(tempPath.c_str());
+	}
+	return ok;
+}
+
+bool RenderShaderCache::stampDependency(Dependency &dep)
+{
+	struct stat st;
+	if(stat(dep.path.c_str(), &st) != 0) return false;
+	dep.size = (uint32)st.st_size;
+	dep.time = (uint64)st.st_mtime;
+	return true;
+}
+
+bool RenderShaderCache::isUpToDate(const Record &record)
+{
+	if(record.dependencies.IsEmpty()) return false;
+	for(IndexT i=0; i<record.dependencies.Size(); i++)
+	{
+		Dependency current;
+		current.path = record.dependencies[i].path;
+		if(!stampDependency(current))                   return false;
+		if(current.size != record.dependencies[i].size) return false;
+		if(current.time != record.dependencies[i].time) return false;
+	}
+	return true;
+}
+
+void RenderShaderCache::createDirectory(const String &dir)
+{
+#if defined(RENDERER_WINDOWS)
+	// create each level of the path, existing directories are silently skipped.
+	for(IndexT i=0; i<dir.Length(); i++)
+	{
+		if(dir[i] == '/' && i > 0 && dir[i-1] != ':')
+		{
+			String sub = dir.SubString(0, i);
+			CreateDirectoryA(sub.c_str(), 0);
+		}
+	}
+#endif
+}
+
+_NAMESPACE_END
@@ -0,0 +1,104 @@
+
+#ifndef RENDERER_SHADER_CACHE_H
+#define RENDERER_SHADER_CACHE_H
+
+#include <renderMaterialDesc.h>
+
+_NAMESPACE_BEGIN
+
+// describes one shader permutation: source file, entry point, target profile, compile flags and defines.
+class RenderShaderKey
+{
+public:
+	RenderShaderKey(void);
+
+	// builds the textual description the cache is keyed on (defines are kept in declaration order).
+	String					getDescription(void) const;
+
+public:
+	String					sourcePath;
+	String					entry;
+	String					profile;
+	uint32					flags;
+	Array<ShaderDefines>	defines;
+};
+
+// implemented by the backend, the cache calls into it only when the stored blob can't be reused.
+class RenderShaderCompiler
+{
+public:
+	virtual ~RenderShaderCompiler(void) {}
+
+	// runs the preprocessor over the permutation and reports every file it read (including the source itself).
+	virtual bool preprocessShader(const RenderShaderKey &key, Array<char> &outSource, Array<String> &outDependencies) = 0;
+
+	// compiles the permutation into a backend specific blob.
+	virtual bool compileShader(const RenderShaderKey &key, Array<uint8> &outBlob) = 0;
+};
+
+// Stores compiled shader blobs on disk, one record per permutation.
+// A record stays valid while the size/time stamps of all its dependencies are unchanged; when they
+// differ the source is preprocessed again and the blob is only rebuilt if the expanded text changed.
+class RenderShaderCache
+{
+public:
+	RenderShaderCache(const char *cacheDir);
+	~RenderShaderCache(void);
+
+	// returns the compiled blob for the permutation, compiling through the backend when needed.
+	// outDependencies, if given, receives every file the permutation was built from.
+	bool					fetch(const RenderShaderKey &key, RenderShaderCompiler &compiler, Array<uint8> &outBlob, Array<String> *outDependencies=0);
+
+	// forgets the blobs validated during this session, the next fetch re-checks the dependencies on disk.
+	void					invalidate(void);
+
+	// enables/disables the cache, when disabled every fetch compiles.
+	void					setEnabled(bool enabled)	{ m_enabled = enabled; }
+	bool					isEnabled(void) const		{ return m_enabled; }
+
+	const String&			getCacheDir(void) const		{ return m_cacheDir; }
+
+	// statistics since startup.
+	uint32					getNumHits(void) const		{ return m_numHits; }
+	uint32					getNumCompiles(void) const	{ return m_numCompiles; }
+
+private:
+	struct Dependency
+	{
+		String				path;
+		uint32				size;
+		uint64				time;
+	};
+
+	struct Record
+	{
+		String				description;
+		uint32				sourceHash;
+		uint32				sourceSize;
+		Array<Dependency>	dependencies;
+		Array<uint8>		blob;
+	};
+
+	String					getRecordPath(uint32 keyHash) const;
+	bool					readRecord(const String &path, Record &record) const;
+	bool					writeRecord(const String &path, const Record &record) const;
+
+	static bool				stampDependency(Dependency &dep);
+	static bool				isUpToDate(const Record &record);
+	static void				copyDependencyPaths(const Record &record, Array<String> *outDependencies);
+	static void				createDirectory(const String &dir);
+
+private:
+	RenderShaderCache &operator=(const RenderShaderCache&) { return *this; }
+
+private:
+	String								m_cacheDir;
+	bool								m_enabled;
+	Dictionary<String, Record>			m_resident;	// records already validated this session
+	uint32								m_numHits;
+	uint32								m_numCompiles;
+};
+
+_NAMESPACE_END
+
+#endif
@@ -96,6 +96,7 @@ RenderTexture2D::RenderTexture2D(const RenderTexture2DDesc &desc)
 	m_width       = desc.width;
 	m_height      = desc.height;
 	m_numLevels   = desc.numLevels;
+	m_screenSize  = 0;
 }
 
 RenderTexture2D::~RenderTexture2D(void)
@@ -118,6 +119,16 @@ uint32 RenderTexture2D::getBlockSize(void) const
 	return getFormatBlockSize(getFormat());
 }
 
+uint32 RenderTexture2D::getByteSize(void) const
+{
+	uint32 size = 0;
+	for(uint32 level=0; level<m_numLevels; level++)
+	{
+		size += computeImageByteSize(getLevelDimension(m_width, level), getLevelDimension(m_height, level), m_format);
+	}
+	return size;
+}
+
 void RenderTexture2D::setFilter( Filter ft )
 {
 	m_filter = ft;
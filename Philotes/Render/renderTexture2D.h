@@ -78,6 +78,15 @@ class RenderTexture2D
 		uint32      	getWidthInBlocks(void)  const;
 		uint32      	getHeightInBlocks(void) const;
 		uint32      	getBlockSize(void)      const;
+
+		// bytes of all levels.
+		uint32			getByteSize(void)       const;
+
+		// largest on-screen size in pixels of anything sampling the texture since the last reset,
+		// used by the texture streamer to pick the mip levels that need to be resident.
+		void			noteScreenSize(scalar pixels) { if(pixels > m_screenSize) m_screenSize = pixels; }
+		scalar			getScreenSize(void)  const { return m_screenSize; }
+		void			resetScreenSize(void)      { m_screenSize = 0; }
 		
 	public:
 		virtual void*	lockLevel(uint32 level, uint32 &pitch) = 0;
@@ -95,6 +104,7 @@ class RenderTexture2D
 		uint32      m_width;
 		uint32      m_height;
 		uint32      m_numLevels;
+		scalar		m_screenSize;
 };
 
 _NAMESPACE_END
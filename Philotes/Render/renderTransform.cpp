@@ -4,6 +4,8 @@
 
 _NAMESPACE_BEGIN
 
+PH_IMPLEMENT_POOL_ALLOC(RenderTransform)
+
 RenderTransform::RenderTransform()
 	:RenderNode()
 {
@@ -166,6 +168,20 @@ void RenderTransform::detachAllObjects( void )
 	needUpdate();
 }
 
+void RenderTransform::_updateSceneIndex( void )
+{
+	ObjectMap::Iterator itr;
+	RenderTransformElement* ret;
+	for ( itr = mObjectsByName.Begin(); itr != mObjectsByName.End(); ++itr )
+	{
+		ret = itr->Value();
+		ret->_removeFromSceneIndex();
+		ret->_addToSceneIndex();
+	}
+
+	RenderNode::_updateSceneIndex();
+}
+
 const AxisAlignedBox& RenderTransform::_updateBounds()
 {
 	mWorldAABB.setNull();
@@ -178,14 +194,22 @@ const AxisAlignedBox& RenderTransform::_updateBounds()
 		mWorldAABB.merge(ret->getWorldBoundingBox(true));
 	}
 
-	ChildNodeMap::iterator child;
-	for (child = mChildren.begin(); child != mChildren.end(); ++child)
+	for (IndexT i = 0; i < mChildren.Size(); ++i)
 	{
-		RenderTransform* sceneChild = static_cast<RenderTransform*>(child->second);
+		RenderTransform* sceneChild = static_cast<RenderTransform*>(mChildren[i]);
 		mWorldAABB.merge(sceneChild->mWorldAABB);
 	}
 
 	return mWorldAABB;
 }
 
+const AxisAlignedBox& RenderTransform::_updateBoundsRecursive()
+{
+	for (IndexT i = 0; i < mChildren.Size(); ++i)
+	{
+		static_cast<RenderTransform*>(mChildren[i])->_updateBoundsRecursive();
+	}
+	return _updateBounds();
+}
+
 _NAMESPACE_END
\ No newline at end of file
@@ -11,6 +11,9 @@ _NAMESPACE_BEGIN
 
 class RenderTransform : public RenderNode
 {
+	// 任ڵࡢƵʹö
+	PH_DECLARE_POOL_ALLOC(RenderTransform, Memory::RenderHeap, 256)
+
 public:
 
 	RenderTransform();
@@ -47,8 +50,16 @@ public:
 
     virtual void					detachAllObjects(void);
 
+	/** Re-enters the attached objects into the scene index, then the subtree. */
+	virtual void					_updateSceneIndex(void);
+
 	const AxisAlignedBox&			_updateBounds();
 
+	/** Derives the bounds of the child transforms first, then the own ones. */
+	const AxisAlignedBox&			_updateBoundsRecursive();
+
+	const AxisAlignedBox&			_getWorldAABB() const { return mWorldAABB; }
+
 protected:
 
 	ObjectMap						mObjectsByName;
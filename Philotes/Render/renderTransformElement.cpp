@@ -1,23 +1,37 @@
 
 #include "renderTransformElement.h"
 #include "renderNode.h"
+#include "renderOctree.h"
+#include "renderBVH.h"
+#include "renderCellNode.h"
+#include "renderSceneManager.h"
 
 _NAMESPACE_BEGIN
 
 RenderTransformElement::RenderTransformElement()
 {
 	m_parentNode = NULL;
+	m_static = false;
+	m_octree = NULL;
+	m_octreeHandle = RenderOctree::INVALID_HANDLE;
+	m_bvh = NULL;
+	m_bvhHandle = RenderBVH::INVALID_HANDLE;
 }
 
 RenderTransformElement::RenderTransformElement( const String& name )
 {
 	m_parentNode = NULL;
 	m_name = name;
+	m_static = false;
+	m_octree = NULL;
+	m_octreeHandle = RenderOctree::INVALID_HANDLE;
+	m_bvh = NULL;
+	m_bvhHandle = RenderBVH::INVALID_HANDLE;
 }
 
 RenderTransformElement::~RenderTransformElement()
 {
-
+	_removeFromSceneIndex();
 }
 
 const Matrix4& RenderTransformElement::getTransform( void ) const
@@ -35,6 +49,76 @@ const Matrix4& RenderTransformElement::getTransform( void ) const
 void RenderTransformElement::_notifyAttached( RenderNode* parent )
 {
 	m_parentNode = parent;
+
+	_removeFromSceneIndex();
+	if (parent)
+	{
+		_addToSceneIndex();
+	}
+}
+
+void RenderTransformElement::setStatic( bool isStatic )
+{
+	if (m_static == isStatic)
+	{
+		return;
+	}
+	m_static = isStatic;
+
+	// һ
+	if (m_octree || m_bvh)
+	{
+		_removeFromSceneIndex();
+		_addToSceneIndex();
+	}
+}
+
+void RenderTransformElement::_addToSceneIndex()
+{
+	// ҵڵĵԪڵ㣬ڳı任ڵϵ岻
+	RenderNode* node = m_parentNode;
+	while (node && node->getNodeType() != NT_CULL_CELL)
+	{
+		node = node->getParent();
+	}
+	RenderSceneManager* sm = node ? static_cast<RenderCellNode*>(node)->getCreator() : NULL;
+	if (!sm)
+	{
+		return;
+	}
+
+	if (m_static)
+	{
+		sm->getBVH()->add(this, false);
+	}
+	else
+	{
+		sm->getOctree()->add(this);
+	}
+}
+
+void RenderTransformElement::_removeFromSceneIndex()
+{
+	if (m_octree)
+	{
+		m_octree->remove(m_octreeHandle);
+	}
+	if (m_bvh)
+	{
+		m_bvh->remove(m_bvhHandle);
+	}
+}
+
+void RenderTransformElement::_notifyOctree( RenderOctree* octree, uint32 handle )
+{
+	m_octree = octree;
+	m_octreeHandle = handle;
+}
+
+void RenderTransformElement::_notifyBVH( RenderBVH* bvh, uint32 handle )
+{
+	m_bvh = bvh;
+	m_bvhHandle = handle;
 }
 
 const Sphere& RenderTransformElement::getWorldBoundingSphere( bool derive /*= false*/ ) const
@@ -30,6 +30,11 @@ public:
 
 	bool							isAttached()const {return m_parentNode!=NULL;}
 
+	/// ̬ҵϺΧΣ֮ƶ˲ĬϲǾ̬
+	void							setStatic(bool isStatic);
+
+	bool							isStatic() const { return m_static; }
+
 	virtual const AxisAlignedBox&	getBoundingBox(void) const = 0;
 
 	virtual scalar					getBoundingRadius(void) const = 0;
@@ -38,15 +43,44 @@ public:
 
 	virtual const Sphere&			getWorldBoundingSphere(bool derive = false) const;
 
+	/// ڵİ˲RenderOctree
+	void							_notifyOctree(RenderOctree* octree, uint32 handle);
+
+	RenderOctree*					getOctree() const { return m_octree; }
+
+	uint32							getOctreeHandle() const { return m_octreeHandle; }
+
+	/// ڵİΧΣRenderBVH
+	void							_notifyBVH(RenderBVH* bvh, uint32 handle);
+
+	RenderBVH*						getBVH() const { return m_bvh; }
+
+	uint32							getBVHHandle() const { return m_bvhHandle; }
+
+	/// m_staticڳİ˲ΧΣֻһڽڵ㻻˸ڵʱɽڵ
+	void							_addToSceneIndex();
+
+	void							_removeFromSceneIndex();
+
 protected:
 
 	RenderNode*						m_parentNode;
 
 	String							m_name;
 
+	bool							m_static;
+
 	mutable AxisAlignedBox			mWorldAABB;
 	
 	mutable Sphere					mWorldBoundingSphere;
+
+	RenderOctree*					m_octree;
+
+	uint32							m_octreeHandle;
+
+	RenderBVH*						m_bvh;
+
+	uint32							m_bvhHandle;
 };
 
 _NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,543 @@
+#include "renderTransformHierarchy.h"
+#include "math/simd.h"
+
+_NAMESPACE_BEGIN
+
+const RenderTransformHierarchy::Handle RenderTransformHierarchy::INVALID_HANDLE;
+
+#if PH_MATH_SIMD
+namespace
+{
+	inline __m128 gather(const Array<scalar>& s, const IndexT* slots)
+	{
+		return _mm_setr_ps(s[slots[0]], s[slots[1]], s[slots[2]], s[slots[3]]);
+	}
+
+	inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+}
+#endif
+
+RenderTransformHierarchy::RenderTransformHierarchy()
+	:m_structureDirty(false),
+	m_transformsDirty(false)
+{
+}
+
+RenderTransformHierarchy::~RenderTransformHierarchy()
+{
+}
+
+RenderTransformHierarchy::Handle RenderTransformHierarchy::createTransform( Handle parent )
+{
+	ph_assert(parent == INVALID_HANDLE || m_handleSlots[parent] != InvalidIndex);
+
+	Handle handle;
+	if (!m_freeHandles.IsEmpty())
+	{
+		handle = m_freeHandles.Back();
+		m_freeHandles.PopBack();
+	}
+	else
+	{
+		handle = (Handle)m_handleSlots.Size();
+		m_handleSlots.Append(InvalidIndex);
+		m_parents.Append(INVALID_HANDLE);
+		m_childCounts.Append(0);
+	}
+
+	// new transforms go to the end, sortByDepth() moves them to their level
+	IndexT slot = m_slotHandles.Size();
+	m_slotHandles.Append(handle);
+	m_parentSlots.Append(InvalidIndex);
+	m_worldMatrices.Append(Matrix4::IDENTITY);
+	for (int s = 0; s < NUM_STREAMS; ++s)
+	{
+		m_streams[s].Append(0.0f);
+	}
+	m_handleSlots[handle] = slot;
+	m_parents[handle] = parent;
+	m_childCounts[handle] = 0;
+	if (parent != INVALID_HANDLE)
+	{
+		++m_childCounts[parent];
+	}
+
+	setInherit(handle, true, true);
+	setLocalTransform(handle, Vector3::ZERO, Quaternion::IDENTITY, Vector3::UNIT_SCALE);
+
+	m_structureDirty = true;
+	return handle;
+}
+
+void RenderTransformHierarchy::destroyTransform( Handle handle )
+{
+	IndexT slot = m_handleSlots[handle];
+	ph_assert(slot != InvalidIndex);
+	ph_assert2(m_childCounts[handle] == 0, "RenderTransformHierarchy::destroyTransform: the transform still has children");
+
+	Handle parent = m_parents[handle];
+	if (parent != INVALID_HANDLE)
+	{
+		--m_childCounts[parent];
+	}
+
+	// fill the gap with the last slot, the order is restored by the next update()
+	IndexT last = m_slotHandles.Size() - 1;
+	if (slot != last)
+	{
+		m_handleSlots[m_slotHandles[last]] = slot;
+	}
+	m_slotHandles.EraseIndexSwap(slot);
+	m_parentSlots.EraseIndexSwap(slot);
+	m_worldMatrices.EraseIndexSwap(slot);
+	for (int s = 0; s < NUM_STREAMS; ++s)
+	{
+		m_streams[s].EraseIndexSwap(slot);
+	}
+
+	m_handleSlots[handle] = InvalidIndex;
+	m_parents[handle] = INVALID_HANDLE;
+	m_freeHandles.Append(handle);
+
+	m_structureDirty = true;
+	m_transformsDirty = true;
+}
+
+void RenderTransformHierarchy::setParent( Handle handle, Handle parent )
+{
+	ph_assert(m_handleSlots[handle] != InvalidIndex);
+	if (m_parents[handle] == parent)
+	{
+		return;
+	}
+
+#if PH_BOUNDSCHECKS
+	for (Handle h = parent; h != INVALID_HANDLE; h = m_parents[h])
+	{
+		ph_assert2(h != handle, "RenderTransformHierarchy::setParent: a transform can not be its own ancestor");
+	}
+#endif
+
+	if (m_parents[handle] != INVALID_HANDLE)
+	{
+		--m_childCounts[m_parents[handle]];
+	}
+	m_parents[handle] = parent;
+	if (parent != INVALID_HANDLE)
+	{
+		++m_childCounts[parent];
+	}
+
+	m_structureDirty = true;
+	m_transformsDirty = true;
+}
+
+RenderTransformHierarchy::Handle RenderTransformHierarchy::getParent( Handle handle ) const
+{
+	return m_parents[handle];
+}
+
+void RenderTransformHierarchy::setLocalTransform( Handle handle, const Vector3& position, const Quaternion& orientation, const Vector3& scale )
+{
+	IndexT slot = m_handleSlots[handle];
+	ph_assert(slot != InvalidIndex);
+
+	m_streams[LOCAL_POSITION_X][slot] = position.x;
+	m_streams[LOCAL_POSITION_Y][slot] = position.y;
+	m_streams[LOCAL_POSITION_Z][slot] = position.z;
+	m_streams[LOCAL_ORIENTATION_W][slot] = orientation.w;
+	m_streams[LOCAL_ORIENTATION_X][slot] = orientation.x;
+	m_streams[LOCAL_ORIENTATION_Y][slot] = orientation.y;
+	m_streams[LOCAL_ORIENTATION_Z][slot] = orientation.z;
+	m_streams[LOCAL_SCALE_X][slot] = scale.x;
+	m_streams[LOCAL_SCALE_Y][slot] = scale.y;
+	m_streams[LOCAL_SCALE_Z][slot] = scale.z;
+
+	m_transformsDirty = true;
+}
+
+void RenderTransformHierarchy::setInherit( Handle handle, bool inheritOrientation, bool inheritScale )
+{
+	IndexT slot = m_handleSlots[handle];
+	ph_assert(slot != InvalidIndex);
+
+	m_streams[INHERIT_ORIENTATION][slot] = inheritOrientation ? 1.0f : 0.0f;
+	m_streams[INHERIT_SCALE][slot] = inheritScale ? 1.0f : 0.0f;
+
+	m_transformsDirty = true;
+}
+
+void RenderTransformHierarchy::update()
+{
+	if (m_structureDirty)
+	{
+		sortByDepth();
+		m_structureDirty = false;
+	}
+	if (!m_transformsDirty)
+	{
+		return;
+	}
+
+	if (!m_slotHandles.IsEmpty())
+	{
+		// roots take their local transform as it is
+		SizeT numRoots = m_levelStarts[1];
+		for (int s = LOCAL_POSITION_X; s <= LOCAL_SCALE_Z; ++s)
+		{
+			memcpy(&m_streams[s + WORLD_POSITION_X][0], &m_streams[s][0], numRoots * sizeof(scalar));
+		}
+
+		for (IndexT level = 1; level < (IndexT)getNumLevels(); ++level)
+		{
+			updateLevel(m_levelStarts[level], m_levelStarts[level + 1]);
+		}
+
+		updateMatrices();
+	}
+
+	m_transformsDirty = false;
+}
+
+void RenderTransformHierarchy::getDerivedTransform( Handle handle, Vector3& position, Quaternion& orientation, Vector3& scale ) const
+{
+	if (m_transformsDirty)
+	{
+		composeTransform(handle, position, orientation, scale);
+		return;
+	}
+
+	IndexT slot = m_handleSlots[handle];
+	ph_assert(slot != InvalidIndex);
+
+	position.x = stream(WORLD_POSITION_X, slot);
+	position.y = stream(WORLD_POSITION_Y, slot);
+	position.z = stream(WORLD_POSITION_Z, slot);
+	orientation.w = stream(WORLD_ORIENTATION_W, slot);
+	orientation.x = stream(WORLD_ORIENTATION_X, slot);
+	orientation.y = stream(WORLD_ORIENTATION_Y, slot);
+	orientation.z = stream(WORLD_ORIENTATION_Z, slot);
+	scale.x = stream(WORLD_SCALE_X, slot);
+	scale.y = stream(WORLD_SCALE_Y, slot);
+	scale.z = stream(WORLD_SCALE_Z, slot);
+}
+
+const Matrix4& RenderTransformHierarchy::getFullTransform( Handle handle ) const
+{
+	ph_assert2(!m_transformsDirty, "RenderTransformHierarchy::getFullTransform: update() has to be called first");
+
+	IndexT slot = m_handleSlots[handle];
+	ph_assert(slot != InvalidIndex);
+	return m_worldMatrices[slot];
+}
+
+void RenderTransformHierarchy::sortByDepth()
+{
+	SizeT num = m_slotHandles.Size();
+	m_levelStarts.Clear();
+	if (num == 0)
+	{
+		return;
+	}
+
+	// depth of every handle, found by walking up to the first ancestor whose depth is known
+	m_depths.Clear();
+	m_depths.Fill(0, m_handleSlots.Size(), InvalidIndex);
+	for (IndexT slot = 0; slot < num; ++slot)
+	{
+		Handle h = m_slotHandles[slot];
+		while (h != INVALID_HANDLE && m_depths[h] == InvalidIndex)
+		{
+			m_stack.Append(h);
+			h = m_parents[h];
+		}
+		IndexT depth = (h == INVALID_HANDLE) ? -1 : m_depths[h];
+		while (!m_stack.IsEmpty())
+		{
+			m_depths[m_stack.Back()] = ++depth;
+			m_stack.PopBack();
+		}
+	}
+
+	// counting sort, stable so that siblings keep their order
+	for (IndexT slot = 0; slot < num; ++slot)
+	{
+		IndexT depth = m_depths[m_slotHandles[slot]];
+		while (m_levelStarts.Size() <= depth + 1)
+		{
+			m_levelStarts.Append(0);
+		}
+		++m_levelStarts[depth + 1];
+	}
+	for (IndexT level = 1; level < m_levelStarts.Size(); ++level)
+	{
+		m_levelStarts[level] += m_levelStarts[level - 1];
+	}
+
+	m_newSlots.Clear();
+	m_newSlots.Fill(0, num, InvalidIndex);
+	for (IndexT slot = 0; slot < num; ++slot)
+	{
+		// m_levelStarts[level] runs up to the end of the level and is moved back below
+		m_newSlots[slot] = m_levelStarts[m_depths[m_slotHandles[slot]]]++;
+	}
+	for (IndexT level = m_levelStarts.Size() - 1; level > 0; --level)
+	{
+		m_levelStarts[level] = m_levelStarts[level - 1];
+	}
+	m_levelStarts[0] = 0;
+
+	// permute the local streams, the world streams and matrices are recomputed anyway
+	m_scratch.Clear();
+	m_scratch.Fill(0, num, 0.0f);
+	for (int s = 0; s < WORLD_POSITION_X; ++s)
+	{
+		for (IndexT slot = 0; slot < num; ++slot)
+		{
+			m_scratch[m_newSlots[slot]] = m_streams[s][slot];
+		}
+		m_streams[s].Swap(m_scratch);
+	}
+	for (IndexT slot = 0; slot < num; ++slot)
+	{
+		m_handleSlots[m_slotHandles[slot]] = m_newSlots[slot];
+	}
+	for (IndexT handle = 0; handle < m_handleSlots.Size(); ++handle)
+	{
+		IndexT slot = m_handleSlots[handle];
+		if (slot != InvalidIndex)
+		{
+			m_slotHandles[slot] = (Handle)handle;
+			Handle parent = m_parents[handle];
+			m_parentSlots[slot] = (parent == INVALID_HANDLE) ? InvalidIndex : m_handleSlots[parent];
+		}
+	}
+
+	m_transformsDirty = true;
+}
+
+void RenderTransformHierarchy::updateLevel( IndexT first, IndexT end )
+{
+	IndexT slot = first;
+
+#if PH_MATH_SIMD
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	for (; slot + 4 <= end; slot += 4)
+	{
+		const IndexT* parents = &m_parentSlots[slot];
+
+		__m128 ppx = gather(m_streams[WORLD_POSITION_X], parents);
+		__m128 ppy = gather(m_streams[WORLD_POSITION_Y], parents);
+		__m128 ppz = gather(m_streams[WORLD_POSITION_Z], parents);
+		__m128 pqw = gather(m_streams[WORLD_ORIENTATION_W], parents);
+		__m128 pqx = gather(m_streams[WORLD_ORIENTATION_X], parents);
+		__m128 pqy = gather(m_streams[WORLD_ORIENTATION_Y], parents);
+		__m128 pqz = gather(m_streams[WORLD_ORIENTATION_Z], parents);
+		__m128 psx = gather(m_streams[WORLD_SCALE_X], parents);
+		__m128 psy = gather(m_streams[WORLD_SCALE_Y], parents);
+		__m128 psz = gather(m_streams[WORLD_SCALE_Z], parents);
+
+		__m128 lpx = Simd::Load(&m_streams[LOCAL_POSITION_X][slot]);
+		__m128 lpy = Simd::Load(&m_streams[LOCAL_POSITION_Y][slot]);
+		__m128 lpz = Simd::Load(&m_streams[LOCAL_POSITION_Z][slot]);
+		__m128 lqw = Simd::Load(&m_streams[LOCAL_ORIENTATION_W][slot]);
+		__m128 lqx = Simd::Load(&m_streams[LOCAL_ORIENTATION_X][slot]);
+		__m128 lqy = Simd::Load(&m_streams[LOCAL_ORIENTATION_Y][slot]);
+		__m128 lqz = Simd::Load(&m_streams[LOCAL_ORIENTATION_Z][slot]);
+		__m128 lsx = Simd::Load(&m_streams[LOCAL_SCALE_X][slot]);
+		__m128 lsy = Simd::Load(&m_streams[LOCAL_SCALE_Y][slot]);
+		__m128 lsz = Simd::Load(&m_streams[LOCAL_SCALE_Z][slot]);
+		__m128 inheritOrientation = _mm_cmpneq_ps(Simd::Load(&m_streams[INHERIT_ORIENTATION][slot]), zero);
+		__m128 inheritScale = _mm_cmpneq_ps(Simd::Load(&m_streams[INHERIT_SCALE][slot]), zero);
+
+		// orientation = parent * local, same order of operations as Quaternion::operator*
+		__m128 qw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(pqw, lqw), _mm_mul_ps(pqx, lqx)), _mm_mul_ps(pqy, lqy)), _mm_mul_ps(pqz, lqz));
+		__m128 qx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pqw, lqx), _mm_mul_ps(pqx, lqw)), _mm_mul_ps(pqy, lqz)), _mm_mul_ps(pqz, lqy));
+		__m128 qy = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pqw, lqy), _mm_mul_ps(pqy, lqw)), _mm_mul_ps(pqz, lqx)), _mm_mul_ps(pqx, lqz));
+		__m128 qz = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pqw, lqz), _mm_mul_ps(pqz, lqw)), _mm_mul_ps(pqx, lqy)), _mm_mul_ps(pqy, lqx));
+		Simd::Store(&m_streams[WORLD_ORIENTATION_W][slot], select(inheritOrientation, qw, lqw));
+		Simd::Store(&m_streams[WORLD_ORIENTATION_X][slot], select(inheritOrientation, qx, lqx));
+		Simd::Store(&m_streams[WORLD_ORIENTATION_Y][slot], select(inheritOrientation, qy, lqy));
+		Simd::Store(&m_streams[WORLD_ORIENTATION_Z][slot], select(inheritOrientation, qz, lqz));
+
+		// scale = parent * local
+		Simd::Store(&m_streams[WORLD_SCALE_X][slot], select(inheritScale, _mm_mul_ps(psx, lsx), lsx));
+		Simd::Store(&m_streams[WORLD_SCALE_Y][slot], select(inheritScale, _mm_mul_ps(psy, lsy), lsy));
+		Simd::Store(&m_streams[WORLD_SCALE_Z][slot], select(inheritScale, _mm_mul_ps(psz, lsz), lsz));
+
+		// position = parent orientation * (parent scale * local) + parent position,
+		// same order of operations as Quaternion::operator*(const Vector3&)
+		__m128 vx = _mm_mul_ps(psx, lpx);
+		__m128 vy = _mm_mul_ps(psy, lpy);
+		__m128 vz = _mm_mul_ps(psz, lpz);
+		__m128 uvx = _mm_sub_ps(_mm_mul_ps(pqy, vz), _mm_mul_ps(pqz, vy));
+		__m128 uvy = _mm_sub_ps(_mm_mul_ps(pqz, vx), _mm_mul_ps(pqx, vz));
+		__m128 uvz = _mm_sub_ps(_mm_mul_ps(pqx, vy), _mm_mul_ps(pqy, vx));
+		__m128 uuvx = _mm_sub_ps(_mm_mul_ps(pqy, uvz), _mm_mul_ps(pqz, uvy));
+		__m128 uuvy = _mm_sub_ps(_mm_mul_ps(pqz, uvx), _mm_mul_ps(pqx, uvz));
+		__m128 uuvz = _mm_sub_ps(_mm_mul_ps(pqx, uvy), _mm_mul_ps(pqy, uvx));
+		__m128 w2 = _mm_mul_ps(two, pqw);
+		uvx = _mm_mul_ps(uvx, w2);
+		uvy = _mm_mul_ps(uvy, w2);
+		uvz = _mm_mul_ps(uvz, w2);
+		uuvx = _mm_mul_ps(uuvx, two);
+		uuvy = _mm_mul_ps(uuvy, two);
+		uuvz = _mm_mul_ps(uuvz, two);
+		Simd::Store(&m_streams[WORLD_POSITION_X][slot], _mm_add_ps(_mm_add_ps(_mm_add_ps(vx, uvx), uuvx), ppx));
+		Simd::Store(&m_streams[WORLD_POSITION_Y][slot], _mm_add_ps(_mm_add_ps(_mm_add_ps(vy, uvy), uuvy), ppy));
+		Simd::Store(&m_streams[WORLD_POSITION_Z][slot], _mm_add_ps(_mm_add_ps(_mm_add_ps(vz, uvz), uuvz), ppz));
+	}
+#endif
+
+	for (; slot < end; ++slot)
+	{
+		updateSlot(slot);
+	}
+}
+
+void RenderTransformHierarchy::updateSlot( IndexT slot )
+{
+	IndexT parent = m_parentSlots[slot];
+
+	Vector3 parentPosition(stream(WORLD_POSITION_X, parent), stream(WORLD_POSITION_Y, parent), stream(WORLD_POSITION_Z, parent));
+	Quaternion parentOrientation(stream(WORLD_ORIENTATION_W, parent), stream(WORLD_ORIENTATION_X, parent),
+		stream(WORLD_ORIENTATION_Y, parent), stream(WORLD_ORIENTATION_Z, parent));
+	Vector3 parentScale(stream(WORLD_SCALE_X, parent), stream(WORLD_SCALE_Y, parent), stream(WORLD_SCALE_Z, parent));
+
+	Vector3 position(stream(LOCAL_POSITION_X, slot), stream(LOCAL_POSITION_Y, slot), stream(LOCAL_POSITION_Z, slot));
+	Quaternion orientation(stream(LOCAL_ORIENTATION_W, slot), stream(LOCAL_ORIENTATION_X, slot),
+		stream(LOCAL_ORIENTATION_Y, slot), stream(LOCAL_ORIENTATION_Z, slot));
+	Vector3 scale(stream(LOCAL_SCALE_X, slot), stream(LOCAL_SCALE_Y, slot), stream(LOCAL_SCALE_Z, slot));
+
+	if (stream(INHERIT_ORIENTATION, slot) != 0.0f)
+	{
+		orientation = parentOrientation * orientation;
+	}
+	if (stream(INHERIT_SCALE, slot) != 0.0f)
+	{
+		scale = parentScale * scale;
+	}
+	position = parentOrientation * (parentScale * position) + parentPosition;
+
+	m_streams[WORLD_POSITION_X][slot] = position.x;
+	m_streams[WORLD_POSITION_Y][slot] = position.y;
+	m_streams[WORLD_POSITION_Z][slot] = position.z;
+	m_streams[WORLD_ORIENTATION_W][slot] = orientation.w;
+	m_streams[WORLD_ORIENTATION_X][slot] = orientation.x;
+	m_streams[WORLD_ORIENTATION_Y][slot] = orientation.y;
+	m_streams[WORLD_ORIENTATION_Z][slot] = orientation.z;
+	m_streams[WORLD_SCALE_X][slot] = scale.x;
+	m_streams[WORLD_SCALE_Y][slot] = scale.y;
+	m_streams[WORLD_SCALE_Z][slot] = scale.z;
+}
+
+void RenderTransformHierarchy::updateMatrices()
+{
+	IndexT slot = 0;
+	IndexT end = m_slotHandles.Size();
+
+#if PH_MATH_SIMD
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (; slot + 4 <= end; slot += 4)
+	{
+		__m128 qw = Simd::Load(&m_streams[WORLD_ORIENTATION_W][slot]);
+		__m128 qx = Simd::Load(&m_streams[WORLD_ORIENTATION_X][slot]);
+		__m128 qy = Simd::Load(&m_streams[WORLD_ORIENTATION_Y][slot]);
+		__m128 qz = Simd::Load(&m_streams[WORLD_ORIENTATION_Z][slot]);
+		__m128 sx = Simd::Load(&m_streams[WORLD_SCALE_X][slot]);
+		__m128 sy = Simd::Load(&m_streams[WORLD_SCALE_Y][slot]);
+		__m128 sz = Simd::Load(&m_streams[WORLD_SCALE_Z][slot]);
+
+		// rotation matrix as in Quaternion::ToRotationMatrix
+		__m128 tx = _mm_add_ps(qx, qx);
+		__m128 ty = _mm_add_ps(qy, qy);
+		__m128 tz = _mm_add_ps(qz, qz);
+		__m128 twx = _mm_mul_ps(tx, qw);
+		__m128 twy = _mm_mul_ps(ty, qw);
+		__m128 twz = _mm_mul_ps(tz, qw);
+		__m128 txx = _mm_mul_ps(tx, qx);
+		__m128 txy = _mm_mul_ps(ty, qx);
+		__m128 txz = _mm_mul_ps(tz, qx);
+		__m128 tyy = _mm_mul_ps(ty, qy);
+		__m128 tyz = _mm_mul_ps(tz, qy);
+		__m128 tzz = _mm_mul_ps(tz, qz);
+
+		// one row of 4 matrices in SoA form, transposed into a row per matrix
+		__m128 r0 = _mm_mul_ps(sx, _mm_sub_ps(one, _mm_add_ps(tyy, tzz)));
+		__m128 r1 = _mm_mul_ps(sx, _mm_add_ps(txy, twz));
+		__m128 r2 = _mm_mul_ps(sx, _mm_sub_ps(txz, twy));
+		__m128 r3 = Simd::Load(&m_streams[WORLD_POSITION_X][slot]);
+		__m128 c0 = _mm_mul_ps(sy, _mm_sub_ps(txy, twz));
+		__m128 c1 = _mm_mul_ps(sy, _mm_sub_ps(one, _mm_add_ps(txx, tzz)));
+		__m128 c2 = _mm_mul_ps(sy, _mm_add_ps(tyz, twx));
+		__m128 c3 = Simd::Load(&m_streams[WORLD_POSITION_Y][slot]);
+		__m128 d0 = _mm_mul_ps(sz, _mm_add_ps(txz, twy));
+		__m128 d1 = _mm_mul_ps(sz, _mm_sub_ps(tyz, twx));
+		__m128 d2 = _mm_mul_ps(sz, _mm_sub_ps(one, _mm_add_ps(txx, tyy)));
+		__m128 d3 = Simd::Load(&m_streams[WORLD_POSITION_Z][slot]);
+
+		// row 0 is (scale.x * rot[0][0], scale.y * rot[0][1], scale.z * rot[0][2], position.x)
+		__m128 row0a = r0, row0b = c0, row0c = d0, row0d = r3;
+		_MM_TRANSPOSE4_PS(row0a, row0b, row0c, row0d);
+		__m128 row1a = r1, row1b = c1, row1c = d1, row1d = c3;
+		_MM_TRANSPOSE4_PS(row1a, row1b, row1c, row1d);
+		__m128 row2a = r2, row2b = c2, row2c = d2, row2d = d3;
+		_MM_TRANSPOSE4_PS(row2a, row2b, row2c, row2d);
+
+		Matrix4* m = &m_worldMatrices[slot];
+		Simd::Store(m[0][0], row0a); Simd::Store(m[0][1], row1a); Simd::Store(m[0][2], row2a); Simd::Store(m[0][3], lastRow);
+		Simd::Store(m[1][0], row0b); Simd::Store(m[1][1], row1b); Simd::Store(m[1][2], row2b); Simd::Store(m[1][3], lastRow);
+		Simd::Store(m[2][0], row0c); Simd::Store(m[2][1], row1c); Simd::Store(m[2][2], row2c); Simd::Store(m[2][3], lastRow);
+		Simd::Store(m[3][0], row0d); Simd::Store(m[3][1], row1d); Simd::Store(m[3][2], row2d); Simd::Store(m[3][3], lastRow);
+	}
+#endif
+
+	for (; slot < end; ++slot)
+	{
+		m_worldMatrices[slot].makeTransform(
+			Vector3(stream(WORLD_POSITION_X, slot), stream(WORLD_POSITION_Y, slot), stream(WORLD_POSITION_Z, slot)),
+			Vector3(stream(WORLD_SCALE_X, slot), stream(WORLD_SCALE_Y, slot), stream(WORLD_SCALE_Z, slot)),
+			Quaternion(stream(WORLD_ORIENTATION_W, slot), stream(WORLD_ORIENTATION_X, slot),
+				stream(WORLD_ORIENTATION_Y, slot), stream(WORLD_ORIENTATION_Z, slot)));
+	}
+}
+
+void RenderTransformHierarchy::composeTransform( Handle handle, Vector3& position, Quaternion& orientation, Vector3& scale ) const
+{
+	IndexT slot = m_handleSlots[handle];
+	ph_assert(slot != InvalidIndex);
+
+	position = Vector3(stream(LOCAL_POSITION_X, slot), stream(LOCAL_POSITION_Y, slot), stream(LOCAL_POSITION_Z, slot));
+	orientation = Quaternion(stream(LOCAL_ORIENTATION_W, slot), stream(LOCAL_ORIENTATION_X, slot),
+		stream(LOCAL_ORIENTATION_Y, slot), stream(LOCAL_ORIENTATION_Z, slot));
+	scale = Vector3(stream(LOCAL_SCALE_X, slot), stream(LOCAL_SCALE_Y, slot), stream(LOCAL_SCALE_Z, slot));
+
+	Handle parent = m_parents[handle];
+	if (parent == INVALID_HANDLE)
+	{
+		return;
+	}
+
+	Vector3 parentPosition, parentScale;
+	Quaternion parentOrientation;
+	composeTransform(parent, parentPosition, parentOrientation, parentScale);
+
+	if (stream(INHERIT_ORIENTATION, slot) != 0.0f)
+	{
+		orientation = parentOrientation * orientation;
+	}
+	if (stream(INHERIT_SCALE, slot) != 0.0f)
+	{
+		scale = parentScale * scale;
+	}
+	position = parentOrientation * (parentScale * position) + parentPosition;
+}
+
+_NAMESPACE_END
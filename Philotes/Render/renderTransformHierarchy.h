@@ -0,0 +1,155 @@
+#pragma once
+
+_NAMESPACE_BEGIN
+
+/** Flat storage for the transforms of a node hierarchy.
+@remarks
+	The local and the derived (world) position, orientation and scale of
+	every node are kept in contiguous arrays of scalars, one array per
+	component, sorted by the depth of the node in the hierarchy. update()
+	walks the levels from the roots down: the nodes of one level only
+	depend on nodes of the levels above, so each level is a straight loop
+	which PH_MATH_SIMD runs 4 nodes at a time. The world matrices are built
+	in a second loop over all nodes.
+@par
+	Nodes are referred to by handles which stay valid until the node is
+	destroyed, creating, destroying or re-parenting nodes only marks the
+	order as out of date, it is sorted again by the next update().
+@par
+	The derived values and matrices are those of RenderNode: children
+	inherit the orientation and scale of their parent unless told not to,
+	and the position is always transformed by the parent.
+*/
+class RenderTransformHierarchy
+{
+	PH_DECLARE_HEAP_ALLOC(Memory::RenderHeap)
+
+public:
+
+	typedef uint32 Handle;
+
+	static const Handle INVALID_HANDLE = 0xffffffff;
+
+	RenderTransformHierarchy();
+
+	~RenderTransformHierarchy();
+
+public:
+
+	/** Creates an identity transform, a root if parent is INVALID_HANDLE. */
+	Handle			createTransform(Handle parent = INVALID_HANDLE);
+
+	/** Destroys a transform, it must not have children any more. */
+	void			destroyTransform(Handle handle);
+
+	/** Moves a transform under another parent, INVALID_HANDLE makes it a root. */
+	void			setParent(Handle handle, Handle parent);
+
+	Handle			getParent(Handle handle) const;
+
+	/** Sets the transform relative to the parent. */
+	void			setLocalTransform(Handle handle, const Vector3& position, const Quaternion& orientation, const Vector3& scale);
+
+	/** Sets whether the orientation and the scale of the parent are inherited. */
+	void			setInherit(Handle handle, bool inheritOrientation, bool inheritScale);
+
+	/** Sorts the transforms if needed and derives all world transforms, does nothing if nothing changed. */
+	void			update();
+
+	/** Returns true if a transform changed since the last update(). */
+	bool			isDirty() const { return m_transformsDirty; }
+
+	/** Returns the derived transform.
+	@remarks
+		If the hierarchy is dirty, the transform is derived from the local
+		transforms of the node and its ancestors, without updating the rest.
+	*/
+	void			getDerivedTransform(Handle handle, Vector3& position, Quaternion& orientation, Vector3& scale) const;
+
+	/** Returns the derived transform as a matrix, only valid while the hierarchy is not dirty. */
+	const Matrix4&	getFullTransform(Handle handle) const;
+
+	SizeT			size() const { return m_slotHandles.Size(); }
+
+	/** Returns the number of levels of the hierarchy as of the last update(). */
+	SizeT			getNumLevels() const { return m_levelStarts.IsEmpty() ? 0 : m_levelStarts.Size() - 1; }
+
+protected:
+
+	/// one array of scalars per component, indexed by slot
+	enum Stream
+	{
+		LOCAL_POSITION_X,
+		LOCAL_POSITION_Y,
+		LOCAL_POSITION_Z,
+		LOCAL_ORIENTATION_W,
+		LOCAL_ORIENTATION_X,
+		LOCAL_ORIENTATION_Y,
+		LOCAL_ORIENTATION_Z,
+		LOCAL_SCALE_X,
+		LOCAL_SCALE_Y,
+		LOCAL_SCALE_Z,
+		INHERIT_ORIENTATION,	// 1 or 0
+		INHERIT_SCALE,			// 1 or 0
+
+		WORLD_POSITION_X,
+		WORLD_POSITION_Y,
+		WORLD_POSITION_Z,
+		WORLD_ORIENTATION_W,
+		WORLD_ORIENTATION_X,
+		WORLD_ORIENTATION_Y,
+		WORLD_ORIENTATION_Z,
+		WORLD_SCALE_X,
+		WORLD_SCALE_Y,
+		WORLD_SCALE_Z,
+
+		NUM_STREAMS
+	};
+
+	/// reorders the slots by depth and rebuilds the level table
+	void			sortByDepth();
+
+	/// derives the world transforms of the slots [first, end), which belong to one level below the roots
+	void			updateLevel(IndexT first, IndexT end);
+
+	/// builds the world matrices of all slots
+	void			updateMatrices();
+
+	/// derives the world transform of a single slot from its parent slot
+	void			updateSlot(IndexT slot);
+
+	/// derives the world transform of a handle from its ancestors' local transforms
+	void			composeTransform(Handle handle, Vector3& position, Quaternion& orientation, Vector3& scale) const;
+
+	scalar			stream(Stream s, IndexT slot) const { return m_streams[s][slot]; }
+
+protected:
+
+	Array<scalar>	m_streams[NUM_STREAMS];
+
+	/// per slot
+	Array<Handle>	m_slotHandles;
+	Array<IndexT>	m_parentSlots;
+	Array<Matrix4>	m_worldMatrices;
+
+	/// per handle
+	Array<IndexT>	m_handleSlots;		// InvalidIndex for free handles
+	Array<Handle>	m_parents;
+	Array<SizeT>	m_childCounts;
+	Array<Handle>	m_freeHandles;
+
+	/// first slot of every level, and the number of slots as the last entry
+	Array<IndexT>	m_levelStarts;
+
+	/// scratch arrays of sortByDepth()
+	Array<IndexT>	m_depths;
+	Array<IndexT>	m_newSlots;
+	Array<Handle>	m_stack;
+	Array<scalar>	m_scratch;
+
+	bool			m_structureDirty;
+
+	bool			m_transformsDirty;
+};
+
+_NAMESPACE_END
@@ -62,7 +62,8 @@ RenderTerrain::RenderTerrain(RenderSceneManager* smg)
 	m_sceneMgr(smg),
 	m_materialAsset(NULL),
 	m_materialInstance(NULL),
-	m_indexBuffer(NULL)
+	m_indexBuffer(NULL),
+	m_cullTime(0)
 {
 
 }
@@ -280,21 +281,80 @@ const AxisAlignedBox& RenderTerrain::getBoundingBox( void ) const
 
 void RenderTerrain::visitRenderElement( RenderVisitor* visitor )
 {
-	Array<RenderElement*>::Iterator it;
-	Array<RenderElement*>::Iterator itend = m_nodesToRender.End();
+	FrameArray<RenderElement*>::Iterator it;
+	FrameArray<RenderElement*>::Iterator itend = m_nodesToRender.End();
 	for (it = m_nodesToRender.Begin(); it!=itend; ++it)
 	{
 		visitor->visit(*it);
 	}
 }
 
+// cullBranchJob()Ĳ
+struct TerrainCullData
+{
+	RenderCamera*					camera;
+	RenderTerrainNode**				branches;
+	FrameArray<RenderElement*>*		lists;		// ÿ֧һ
+};
+
 void RenderTerrain::cull( RenderCamera* camera )
 {
+	Timer timer;
 	m_nodesToRender.Reset();
 
 	if (m_quadTree)
 	{
-		m_quadTree->walkQuadTree(camera,m_nodesToRender);
+#if RENDERER_PARALLEL_VISIBILITY
+		JobSystem* jobSystem = GearApplication::getApp()->getJobSystem();
+		if (jobSystem && jobSystem->IsValid() && jobSystem->GetNumThreads() > 1)
+		{
+			cullParallel(camera, jobSystem);
+		}
+		else
+#endif
+		{
+			m_quadTree->walkQuadTree(camera,m_nodesToRender);
+		}
+	}
+
+	m_cullTime = timer.getElapsedSeconds();
+}
+
+void RenderTerrain::cullParallel( RenderCamera* camera, JobSystem* jobSystem )
+{
+	// ׶ƽ£ֻ֮
+	camera->getFrustumPlanes();
+
+	FrameArray<RenderTerrainNode*> branches;
+	m_quadTree->collectBranches(camera, RENDERER_TERRAIN_CULL_LEVELS, branches);
+	if (branches.IsEmpty())
+	{
+		return;
+	}
+
+	TerrainCullData data;
+	data.camera = camera;
+	data.branches = branches.Begin();
+	data.lists = ph_new_frame_array(FrameArray<RenderElement*>, branches.Size());
+	jobSystem->ParallelFor(branches.Size(), &RenderTerrain::cullBranchJob, &data, 1, "RenderTerrain::cull");
+
+	// ֧˳ϲ봮бͬ
+	for (IndexT b = 0; b < branches.Size(); ++b)
+	{
+		const FrameArray<RenderElement*>& list = data.lists[b];
+		for (IndexT i = 0; i < list.Size(); ++i)
+		{
+			m_nodesToRender.Append(list[i]);
+		}
+	}
+}
+
+void RenderTerrain::cullBranchJob( void* data, IndexT first, SizeT count )
+{
+	TerrainCullData* cullData = static_cast<TerrainCullData*>(data);
+	for (IndexT b = first; b < first + count; ++b)
+	{
+		cullData->branches[b]->walkQuadTree(cullData->camera, cullData->lists[b]);
 	}
 }
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "renderTransformElement.h"
+#include "util/timer.h"
 
 _NAMESPACE_BEGIN
 
@@ -114,6 +115,9 @@ public:
 	// ü
 	void					cull(RenderCamera* camera);
 
+	// һcullĺʱ룩
+	Timer::Second			getCullTime() const { return m_cullTime; }
+
 
 protected:
 
@@ -121,6 +125,11 @@ protected:
 
 	void					updateBaseScale();
 
+	// ķ֧Ϊһü֧˳ϲ
+	void					cullParallel(RenderCamera* camera, JobSystem* jobSystem);
+
+	static void				cullBranchJob(void* data, IndexT first, SizeT count);
+
 	void					createIndexBuffer();
 
 	void					destroyIndexBuffer();
@@ -149,7 +158,9 @@ protected:
 
 	RenderCellNode*			m_cellNode;
 
-	Array<RenderElement*>	m_nodesToRender;
+	FrameArray<RenderElement*>	m_nodesToRender;
+
+	Timer::Second			m_cullTime;
 
 	GearMaterialAsset*		m_materialAsset;
 
@@ -272,7 +272,7 @@ void RenderTerrainNode::destroyRenderData()
 	}
 }
 
-void RenderTerrainNode::walkQuadTree( RenderCamera* camera, Array<RenderElement*>& visible )
+void RenderTerrainNode::walkQuadTree( RenderCamera* camera, FrameArray<RenderElement*>& visible )
 {
 	bool vis = checkVisible(camera);
 
@@ -292,6 +292,26 @@ void RenderTerrainNode::walkQuadTree( RenderCamera* camera, Array<RenderElement*
 	}
 }
 
+void RenderTerrainNode::collectBranches( RenderCamera* camera, uint16 levels, FrameArray<RenderTerrainNode*>& branches )
+{
+	if (!checkVisible(camera))
+	{
+		return;
+	}
+
+	if (levels == 0 || isLeaf())
+	{
+		branches.Append(this);
+	}
+	else
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			m_children[i]->collectBranches(camera, levels - 1, branches);
+		}
+	}
+}
+
 bool RenderTerrainNode::checkVisible( const RenderCamera* camera )
 {
 	if (m_aabb.isNull())
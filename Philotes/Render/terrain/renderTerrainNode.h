@@ -35,7 +35,10 @@ public:
 
 	bool				pointIntersectsNode(long x, long y);
 
-	void				walkQuadTree(RenderCamera* camera, Array<RenderElement*>& visible);
+	void				walkQuadTree(RenderCamera* camera, FrameArray<RenderElement*>& visible);
+
+	// ռlevels¿ɼǳĿɼҶӣ̷ֱ߳walkQuadTree
+	void				collectBranches(RenderCamera* camera, uint16 levels, FrameArray<RenderTerrainNode*>& branches);
 
 protected:
 
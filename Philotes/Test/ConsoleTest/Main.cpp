@@ -1,5 +1,59 @@
 
-int main()
+#include "consoleTest.h"
+
+using namespace Philo;
+
+struct ConsoleTest
+{
+	const char*	name;
+	bool		(*function)();
+};
+
+static const ConsoleTest tests[] =
 {
-	return 0;
-}
\ No newline at end of file
+	{ "SpscQueue",	testSpscQueue },
+	{ "MpmcQueue",	testMpmcQueue },
+	{ "RefCounted",	testRefCounted },
+	{ "SimdMath",	testSimdMath },
+	{ "MathBatch",	testMathBatch },
+	{ "FastMath",	testFastMath },
+	{ "TransformHierarchy",	testTransformHierarchy },
+	{ "RenderOctree",	testRenderOctree },
+	{ "QuadTree",	testQuadTree },
+	{ "RenderBVH",	testRenderBVH },
+	{ "ShaderCache",	testShaderCache },
+	{ "TextureStream",	testTextureStream },
+	{ "BlockCompressor",	testBlockCompressor },
+	{ "HashTable",	testHashTable },
+	{ "FlatDictionary",	testFlatDictionary },
+	{ "Array",	testArray },
+	{ "StringAtom",	testStringAtom },
+	{ "Allocators",	testAllocators },
+	{ "MemoryStats",	testMemoryStats },
+	{ "JobSystem",	testJobSystem },
+	{ "RenderNode",	testRenderNode },
+	{ "CellUpdate",	testCellUpdate },
+	{ "CellVisibility",	testCellVisibility },
+	{ "CellSceneIndex",	testCellSceneIndex },
+};
+
+// runs all tests, or those whose names are given on the command line.
+int main(int argc, char* argv[])
+{
+	int numFailed = 0;
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+	{
+		bool selected = argc < 2;
+		for (int a = 1; a < argc && !selected; a++)
+		{
+			selected = !strcmp(argv[a], tests[i].name);
+		}
+		if (!selected) continue;
+
+		printf("%s\n", tests[i].name);
+		bool ok = tests[i].function();
+		printf("%s %s\n", tests[i].name, ok ? "passed" : "FAILED");
+		if (!ok) numFailed++;
+	}
+	return numFailed;
+}
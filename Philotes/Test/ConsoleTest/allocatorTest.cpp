@@ -0,0 +1,238 @@
+
+#include "consoleTest.h"
+#include "core/poolallocator.h"
+#include "core/frameallocator.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the subsystem heaps, a pooled class and a FrameAllocator: blocks are reused, aligned and
+// released as documented, and each is timed against new and delete on the CRT heap.
+namespace
+{
+	const int ALLOCATOR_NUM_OBJECTS		= 20000;
+	const int ALLOCATOR_TIMING_ROUNDS	= 20;
+	const SizeT ALLOCATOR_FRAME_SIZE	= 256 * 1024;
+
+	uint32 allocatorTestSeed = 17;
+
+	uint32 randomInt(uint32 range)
+	{
+		allocatorTestSeed = allocatorTestSeed * 1664525 + 1013904223;
+		return (allocatorTestSeed >> 8) % range;
+	}
+
+	// the size of a small scene object
+	struct PlainObject
+	{
+		PlainObject() : id(0) {}
+		int id;
+		float data[15];
+	};
+
+	struct HeapObject : public PlainObject
+	{
+		PH_DECLARE_HEAP_ALLOC(Memory::RenderHeap)
+	};
+
+	struct PooledObject : public PlainObject
+	{
+		PH_DECLARE_POOL_ALLOC(PooledObject, Memory::RenderHeap, 256)
+	};
+
+	// larger than the pool blocks, goes to the heap
+	struct PooledDerived : public PooledObject
+	{
+		float more[16];
+	};
+
+	// creates and destroys the objects in a shuffled order, as a scene does over a few frames
+	template<class TYPE> double timeObjects(Array<uint32>& order)
+	{
+		TYPE* objects[ALLOCATOR_NUM_OBJECTS];
+		Timer timer;
+		for (int round = 0; round < ALLOCATOR_TIMING_ROUNDS; round++)
+		{
+			int i;
+			for (i = 0; i < ALLOCATOR_NUM_OBJECTS; i++)
+			{
+				objects[i] = ph_new(TYPE);
+				objects[i]->id = i;
+			}
+			const uint32* index = order.Begin();
+			for (i = 0; i < ALLOCATOR_NUM_OBJECTS / 2; i++)
+			{
+				ph_delete(objects[index[i]]);
+				objects[index[i]] = ph_new(TYPE);
+			}
+			for (i = 0; i < ALLOCATOR_NUM_OBJECTS; i++)
+			{
+				ph_delete(objects[index[i]]);
+			}
+		}
+		return timer.getElapsedSeconds();
+	}
+}
+
+_NAMESPACE_END
+
+PH_IMPLEMENT_POOL_ALLOC(Philo::PooledObject)
+
+_NAMESPACE_BEGIN
+
+bool testAllocators()
+{
+	bool ok = true;
+
+	// a heap block keeps its content when it grows
+	int* block = (int*)Memory::Alloc(Memory::UtilHeap, 16 * sizeof(int));
+	int i;
+	for (i = 0; i < 16; i++)
+	{
+		block[i] = i;
+	}
+	block = (int*)Memory::Realloc(Memory::UtilHeap, block, 4096 * sizeof(int));
+	bool kept = true;
+	for (i = 0; i < 16; i++)
+	{
+		kept = kept && block[i] == i;
+	}
+	TEST_CHECK(kept);
+	Memory::Free(Memory::UtilHeap, block);
+
+	// freed blocks are handed out again before a new page is taken
+	PoolAllocator* pool = ph_new(PoolAllocator)(sizeof(PlainObject), 64, Memory::RenderHeap);
+	Array<void*> blocks;
+	for (i = 0; i < 200; i++)
+	{
+		blocks.Append(pool->Alloc());
+		memset(blocks.Back(), 0xcd, sizeof(PlainObject));
+	}
+	TEST_CHECK(pool->GetNumAllocatedBlocks() == 200 && pool->GetNumPages() == 4);
+	bool distinct = true;
+	blocks.Sort();
+	for (i = 1; i < 200; i++)
+	{
+		distinct = distinct && (char*)blocks[i] - (char*)blocks[i - 1] >= (int)sizeof(PlainObject);
+	}
+	TEST_CHECK(distinct && pool->Contains(blocks[0]) && pool->Contains(blocks[199]) && !pool->Contains(&distinct));
+	void* freed = blocks[77];
+	pool->Free(freed);
+	TEST_CHECK(pool->Alloc() == freed);
+	for (i = 0; i < 200; i++)
+	{
+		pool->Free(blocks[i]);
+	}
+	for (i = 0; i < 200; i++)
+	{
+		blocks[i] = pool->Alloc();
+	}
+	TEST_CHECK(pool->GetNumAllocatedBlocks() == 200 && pool->GetNumPages() == 4);
+	for (i = 0; i < 200; i++)
+	{
+		pool->Free(blocks[i]);
+	}
+	ph_delete(pool);
+
+	// a pooled class takes its blocks from the pool, a larger derived class from the heap
+	PooledObject* pooled = ph_new(PooledObject);
+	PooledDerived* derived = ph_new(PooledDerived);
+	pooled->id = 1;
+	derived->more[15] = 1.0f;
+	ph_delete(pooled);
+	TEST_CHECK(ph_new(PooledObject) == pooled);
+	ph_delete(pooled);
+	ph_delete(derived);
+
+	// frame blocks are aligned and separate, the overflow goes to the heap until the reset
+	FrameAllocator frame;
+	frame.Setup(ALLOCATOR_FRAME_SIZE, Memory::GearsHeap);
+	Array<uint8*> frameBlocks;
+	Array<SizeT> frameSizes;
+	bool aligned = true;
+	while (frame.GetUsedSize() < ALLOCATOR_FRAME_SIZE + ALLOCATOR_FRAME_SIZE / 4)
+	{
+		const SizeT size = 1 + randomInt(300);
+		const bool inBuffer = frame.GetUsedSize() + ((size + 15) & ~15) <= ALLOCATOR_FRAME_SIZE;
+		uint8* mem = (uint8*)frame.Alloc(size);
+		aligned = aligned && (!inBuffer || ((UINT_PTR)mem & 15) == 0);
+		memset(mem, (int)(frameBlocks.Size() & 255), size);
+		frameBlocks.Append(mem);
+		frameSizes.Append(size);
+	}
+	bool separate = true;
+	for (i = 0; i < (int)frameBlocks.Size(); i++)
+	{
+		for (SizeT k = 0; k < frameSizes[i]; k++)
+		{
+			separate = separate && frameBlocks[i][k] == (uint8)(i & 255);
+		}
+	}
+	TEST_CHECK(aligned && separate);
+	frame.Reset();
+	TEST_CHECK(frame.GetUsedSize() == 0 && frame.GetPeakSize() >= ALLOCATOR_FRAME_SIZE);
+	TEST_CHECK(frame.Alloc(16) == frameBlocks[0]);
+	frame.Reset();
+
+	// the global frame heaps take turns, the data of the last frame stays readable
+	PlainObject* transient = ph_new_frame(PlainObject);
+	transient->id = 5;
+	const SizeT frameIndex = Memory::GetFrameIndex();
+	FrameAllocator* current = Memory::GetFrameAllocator();
+	Memory::SwapFrameAllocators();
+	TEST_CHECK(Memory::GetFrameIndex() == frameIndex + 1 && Memory::GetFrameAllocator() != current);
+	TEST_CHECK(Memory::GetFrameAllocator()->GetUsedSize() == 0 && transient->id == 5);
+
+	// timing: objects created and destroyed in shuffled order, and per-frame objects
+	Array<uint32> order;
+	for (i = 0; i < ALLOCATOR_NUM_OBJECTS; i++)
+	{
+		order.Append((uint32)i);
+	}
+	for (i = ALLOCATOR_NUM_OBJECTS - 1; i > 0; i--)
+	{
+		const uint32 k = randomInt((uint32)i + 1);
+		const uint32 tmp = order[i];
+		order[i] = order[k];
+		order[k] = tmp;
+	}
+	const double crtSeconds = timeObjects<PlainObject>(order);
+	const double heapSeconds = timeObjects<HeapObject>(order);
+	const double poolSeconds = timeObjects<PooledObject>(order);
+	frame.Discard();
+	frame.Setup(ALLOCATOR_NUM_OBJECTS * sizeof(PlainObject), Memory::GearsHeap);
+	Timer timer;
+	int round;
+	for (round = 0; round < ALLOCATOR_TIMING_ROUNDS; round++)
+	{
+		for (i = 0; i < ALLOCATOR_NUM_OBJECTS; i++)
+		{
+			new(frame.Alloc(sizeof(PlainObject))) PlainObject;
+		}
+		frame.Reset();
+	}
+	const double frameSeconds = timer.getElapsedSeconds();
+	PlainObject* plain[ALLOCATOR_NUM_OBJECTS];
+	for (round = 0; round < ALLOCATOR_TIMING_ROUNDS; round++)
+	{
+		for (i = 0; i < ALLOCATOR_NUM_OBJECTS; i++)
+		{
+			plain[i] = ph_new(PlainObject);
+		}
+		for (i = 0; i < ALLOCATOR_NUM_OBJECTS; i++)
+		{
+			ph_delete(plain[i]);
+		}
+	}
+	const double frameCrtSeconds = timer.getElapsedSeconds();
+	frame.Discard();
+	const double numObjects = (double)ALLOCATOR_NUM_OBJECTS * ALLOCATOR_TIMING_ROUNDS;
+	printf("  per object of %d bytes: new/delete %.1f ns, subsystem heap %.1f ns, pool %.1f ns; "
+		"per transient object: frame %.1f ns, new/delete %.1f ns\n", (int)sizeof(PlainObject),
+		crtSeconds * 1e9 / (numObjects * 1.5), heapSeconds * 1e9 / (numObjects * 1.5), poolSeconds * 1e9 / (numObjects * 1.5),
+		frameSeconds * 1e9 / numObjects, frameCrtSeconds * 1e9 / numObjects);
+
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,382 @@
+
+#include "consoleTest.h"
+#include "util/timer.h"
+
+#include <vector>
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	int arrayTestLiveValues = 0;
+	int arrayTestLiveBuffers = 0;
+
+	/// copied element wise, counts its live instances
+	struct ArrayTestValue
+	{
+		ArrayTestValue() : value(0)								{ arrayTestLiveValues++; }
+		ArrayTestValue(const ArrayTestValue& rhs) : value(rhs.value) { arrayTestLiveValues++; }
+		~ArrayTestValue()										{ arrayTestLiveValues--; }
+		void operator=(const ArrayTestValue& rhs)				{ value = rhs.value; }
+		bool operator==(const ArrayTestValue& rhs) const		{ return value == rhs.value; }
+
+		int value;
+	};
+
+	/// owns a heap buffer and is relocated by Swap(), a buffer freed twice or lost shows in the count
+	struct ArrayTestBuffer
+	{
+		ArrayTestBuffer() : buffer(0)							{}
+		ArrayTestBuffer(const ArrayTestBuffer& rhs) : buffer(0)	{ *this = rhs; }
+		~ArrayTestBuffer()										{ set(0); }
+		void operator=(const ArrayTestBuffer& rhs)				{ if (this != &rhs) set(rhs.buffer ? *rhs.buffer : 0); }
+		bool operator==(const ArrayTestBuffer& rhs) const		{ return get() == rhs.get(); }
+		void Swap(ArrayTestBuffer& rhs)							{ int* tmp = buffer; buffer = rhs.buffer; rhs.buffer = tmp; }
+
+		int get() const											{ return buffer ? *buffer : 0; }
+		void set(int value)
+		{
+			if (buffer)
+			{
+				delete buffer;
+				arrayTestLiveBuffers--;
+			}
+			buffer = NULL;
+			if (value != 0)
+			{
+				buffer = new int(value);
+				arrayTestLiveBuffers++;
+			}
+		}
+
+		int* buffer;
+	};
+}
+
+_NAMESPACE_END
+
+PH_DECLARE_HAS_SWAP(Philo::ArrayTestBuffer)
+
+_NAMESPACE_BEGIN
+
+// the editing methods of Array against std::vector, for trivially copyable, copied and swapped
+// element types, and the speed of building mesh sized arrays.
+namespace
+{
+	const int ARRAY_NUM_OPERATIONS		= 4000;
+	const int ARRAY_MESH_VERTICES		= 65536;
+	const int ARRAY_MESH_INDICES		= ARRAY_MESH_VERTICES * 6;
+	const int ARRAY_MESH_SUBMESHES		= 64;
+	const int ARRAY_MESH_INSERTS		= 500;
+	const int ARRAY_TIMING_ROUNDS		= 10;
+
+	uint32 arrayTestSeed = 13;
+
+	uint32 randomInt(uint32 range)
+	{
+		arrayTestSeed = arrayTestSeed * 1664525 + 1013904223;
+		return (arrayTestSeed >> 8) % range;
+	}
+
+	// every element type maps to and from an int, a default element is 0
+	void setValue(int& elm, int value)					{ elm = value; }
+	int getValue(const int& elm)						{ return elm; }
+	void setValue(String& elm, int value)				{ elm = value ? String::FromInt(value) : String(); }
+	int getValue(const String& elm)						{ return elm.IsEmpty() ? 0 : elm.AsInt(); }
+	void setValue(Array<int>& elm, int value)			{ elm.Clear(); for (int i = 0; i <= value % 5 && value; i++) elm.Append(value); }
+	int getValue(const Array<int>& elm)					{ return elm.IsEmpty() ? 0 : elm.Back(); }
+	void setValue(ArrayTestValue& elm, int value)		{ elm.value = value; }
+	int getValue(const ArrayTestValue& elm)				{ return elm.value; }
+	void setValue(ArrayTestBuffer& elm, int value)		{ elm.set(value); }
+	int getValue(const ArrayTestBuffer& elm)			{ return elm.get(); }
+
+	template<class TYPE> TYPE makeValue(int value)
+	{
+		TYPE elm;
+		setValue(elm, value);
+		return elm;
+	}
+
+	template<class TYPE> bool equals(const Array<TYPE>& array, const std::vector<int>& reference)
+	{
+		if (array.Size() != (SizeT)reference.size()) return false;
+		for (SizeT i = 0; i < array.Size(); i++)
+		{
+			if (getValue(array[i]) != reference[i]) return false;
+		}
+		return true;
+	}
+
+	// the number of operations after which the array differs from the reference
+	template<class TYPE> int countEditErrors()
+	{
+		int numErrors = 0;
+		Array<TYPE> array;
+		std::vector<int> reference;
+		for (int op = 0; op < ARRAY_NUM_OPERATIONS; op++)
+		{
+			// most operations grow the array until it holds a few hundred elements
+			const int value = 1 + (int)randomInt(100000);
+			const SizeT size = array.Size();
+			const IndexT index = size > 0 ? (IndexT)randomInt(size) : 0;
+			switch (randomInt(size > 300 ? 14 : 10))
+			{
+			case 0:
+			case 1:
+				array.Append(makeValue<TYPE>(value));
+				reference.push_back(value);
+				break;
+			case 2:
+			case 3:
+				{
+					const IndexT at = (IndexT)randomInt(size + 1);
+					array.Insert(at, makeValue<TYPE>(value));
+					reference.insert(reference.begin() + at, value);
+				}
+				break;
+			case 4:
+				setValue(array.InsertDefault(index), value);
+				reference.insert(reference.begin() + index, value);
+				break;
+			case 5:
+				{
+					// resize up with default elements, over slots that held erased elements
+					const SizeT num = size + 1 + randomInt(40);
+					array.Resize(num);
+					reference.resize(num, 0);
+				}
+				break;
+			case 6:
+				{
+					// append a copy of a part of the array, reallocating for the larger ones
+					Array<TYPE> part;
+					for (SizeT i = 0; i < size && i < 50; i++)
+					{
+						part.Append(array[size - 1 - i]);
+						reference.push_back(reference[size - 1 - i]);
+					}
+					array.AppendArray(part);
+				}
+				break;
+			case 7:
+				{
+					// copies and swaps leave both sides intact
+					Array<TYPE> copy(array);
+					Array<TYPE> other;
+					other.Append(makeValue<TYPE>(value));
+					other.Swap(copy);
+					if (!equals(other, reference) || copy.Size() != 1 || getValue(copy[0]) != value) numErrors++;
+					copy = other;
+					array.Swap(copy);
+					if (!equals(copy, reference)) numErrors++;
+				}
+				break;
+			case 8:
+				if (size > 0)
+				{
+					array.AppendDefault();
+					reference.push_back(0);
+				}
+				break;
+			case 9:
+			case 10:
+				if (size > 0)
+				{
+					array.EraseIndex(index);
+					reference.erase(reference.begin() + index);
+				}
+				break;
+			case 11:
+				if (size > 0)
+				{
+					array.EraseIndexSwap(index);
+					reference[index] = reference.back();
+					reference.pop_back();
+				}
+				break;
+			case 12:
+				if (size > 0)
+				{
+					array.PopBack();
+					reference.pop_back();
+				}
+				break;
+			default:
+				if (size > 1)
+				{
+					// resize down, the slots keep their elements until they are overwritten
+					const SizeT num = 1 + randomInt(size - 1);
+					array.Resize(num);
+					reference.resize(num);
+				}
+				break;
+			}
+			if (!equals(array, reference)) numErrors++;
+		}
+		array.Clear();
+		reference.clear();
+		if (!array.IsEmpty() || array.Capacity() == 0) numErrors++;
+		return numErrors;
+	}
+
+	struct MeshVertex
+	{
+		Vector3 position;
+		Vector3 normal;
+		Vector2 uv;
+	};
+}
+
+_NAMESPACE_END
+
+PH_DECLARE_TRIVIALLY_COPYABLE(Philo::MeshVertex)
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	MeshVertex meshVertex(int i)
+	{
+		MeshVertex vertex;
+		vertex.position = Vector3((scalar)(i & 255), (scalar)(i >> 8), 0.0f);
+		vertex.normal = Vector3::UNIT_Z;
+		vertex.uv = Vector2((scalar)(i & 255) / 255.0f, (scalar)(i >> 8) / 255.0f);
+		return vertex;
+	}
+
+	// the vertices and indices of a grid, built submesh by submesh and merged as a mesh tool does
+	void timeMesh(bool& ok)
+	{
+		Timer timer;
+		scalar arraySum = 0.0f;
+		int round;
+		for (round = 0; round < ARRAY_TIMING_ROUNDS; round++)
+		{
+			Array<MeshVertex> vertices;
+			Array<uint32> indices;
+			for (int i = 0; i < ARRAY_MESH_VERTICES; i++)
+			{
+				vertices.Append(meshVertex(i));
+			}
+			for (int i = 0; i < ARRAY_MESH_INDICES; i++)
+			{
+				indices.Append((uint32)(i % ARRAY_MESH_VERTICES));
+			}
+			arraySum += vertices.Back().uv.x + (scalar)indices.Size();
+		}
+		const double appendSeconds = timer.getElapsedSeconds();
+		scalar vectorSum = 0.0f;
+		for (round = 0; round < ARRAY_TIMING_ROUNDS; round++)
+		{
+			std::vector<MeshVertex> vertices;
+			std::vector<uint32> indices;
+			for (int i = 0; i < ARRAY_MESH_VERTICES; i++)
+			{
+				vertices.push_back(meshVertex(i));
+			}
+			for (int i = 0; i < ARRAY_MESH_INDICES; i++)
+			{
+				indices.push_back((uint32)(i % ARRAY_MESH_VERTICES));
+			}
+			vectorSum += vertices.back().uv.x + (scalar)indices.size();
+		}
+		const double vectorAppendSeconds = timer.getElapsedSeconds();
+		TEST_CHECK(arraySum == vectorSum);
+
+		// merging the submeshes with AppendArray against appending their elements one by one
+		const int submeshVertices = ARRAY_MESH_VERTICES / ARRAY_MESH_SUBMESHES;
+		Array<MeshVertex> submesh;
+		for (int i = 0; i < submeshVertices; i++)
+		{
+			submesh.Append(meshVertex(i));
+		}
+		timer.getElapsedSeconds();
+		SizeT numMerged = 0;
+		for (round = 0; round < ARRAY_TIMING_ROUNDS; round++)
+		{
+			Array<MeshVertex> merged;
+			for (int s = 0; s < ARRAY_MESH_SUBMESHES; s++)
+			{
+				merged.AppendArray(submesh);
+			}
+			numMerged += merged.Size();
+		}
+		const double mergeSeconds = timer.getElapsedSeconds();
+		SizeT numAppended = 0;
+		for (round = 0; round < ARRAY_TIMING_ROUNDS; round++)
+		{
+			Array<MeshVertex> merged;
+			for (int s = 0; s < ARRAY_MESH_SUBMESHES; s++)
+			{
+				const MeshVertex* vertex = submesh.Begin();
+				for (int i = 0; i < submeshVertices; i++)
+				{
+					merged.Append(vertex[i]);
+				}
+			}
+			numAppended += merged.Size();
+		}
+		const double mergeByElementSeconds = timer.getElapsedSeconds();
+		TEST_CHECK(numMerged == numAppended && numMerged == (SizeT)(ARRAY_MESH_VERTICES * ARRAY_TIMING_ROUNDS));
+
+		// vertices inserted in the middle move the tail
+		Array<MeshVertex> vertices;
+		std::vector<MeshVertex> vectorVertices;
+		for (int i = 0; i < ARRAY_MESH_VERTICES; i++)
+		{
+			vertices.Append(meshVertex(i));
+			vectorVertices.push_back(meshVertex(i));
+		}
+		timer.getElapsedSeconds();
+		int i;
+		for (i = 0; i < ARRAY_MESH_INSERTS; i++)
+		{
+			vertices.Insert(vertices.Size() / 2, meshVertex(i));
+		}
+		const double insertSeconds = timer.getElapsedSeconds();
+		for (i = 0; i < ARRAY_MESH_INSERTS; i++)
+		{
+			vectorVertices.insert(vectorVertices.begin() + vectorVertices.size() / 2, meshVertex(i));
+		}
+		const double vectorInsertSeconds = timer.getElapsedSeconds();
+		TEST_CHECK(vertices.Size() == (SizeT)vectorVertices.size());
+		TEST_CHECK(memcmp(vertices.Begin(), &vectorVertices[0], vertices.Size() * sizeof(MeshVertex)) == 0);
+
+		printf("  %d vertices and %d indices x %d: append %.2f ms (std::vector %.2f ms), merge %d submeshes %.2f ms "
+			"(element by element %.2f ms), %d inserts in the middle %.2f ms (std::vector %.2f ms)\n",
+			ARRAY_MESH_VERTICES, ARRAY_MESH_INDICES, ARRAY_TIMING_ROUNDS, appendSeconds * 1000.0, vectorAppendSeconds * 1000.0,
+			ARRAY_MESH_SUBMESHES, mergeSeconds * 1000.0, mergeByElementSeconds * 1000.0,
+			ARRAY_MESH_INSERTS, insertSeconds * 1000.0, vectorInsertSeconds * 1000.0);
+	}
+}
+
+bool testArray()
+{
+	bool ok = true;
+
+	TEST_CHECK(countEditErrors<int>() == 0);
+	TEST_CHECK(countEditErrors<String>() == 0);
+	TEST_CHECK(countEditErrors< Array<int> >() == 0);
+
+	// every slot is constructed with the buffer and destroyed with it, never twice
+	TEST_CHECK(countEditErrors<ArrayTestValue>() == 0);
+	TEST_CHECK(arrayTestLiveValues == 0);
+	TEST_CHECK(countEditErrors<ArrayTestBuffer>() == 0);
+	TEST_CHECK(arrayTestLiveBuffers == 0);
+
+	// a shrunk array keeps its capacity, growing again reuses it
+	Array<ArrayTestValue> values;
+	values.Resize(100);
+	const SizeT capacity = values.Capacity();
+	values.Resize(10);
+	TEST_CHECK(values.Size() == 10 && values.Capacity() == capacity);
+	values.Resize(50);
+	TEST_CHECK(values.Size() == 50 && values.Capacity() == capacity && values[49].value == 0);
+	values.Realloc(0, 16);
+	TEST_CHECK(arrayTestLiveValues == 0);
+
+	timeMesh(ok);
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,243 @@
+
+#include "consoleTest.h"
+#include "gearsPch.h"
+#include "gearsBlockCompressor.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// GearBlockCompressor on known images: decoded again, the error against the source stays
+// under a bound for each image, and the encoder's speed in megapixels per second.
+namespace
+{
+	const uint32 BLOCK_TEST_WIDTH		= 130;	// not a multiple of 4, the last blocks repeat the edge
+	const uint32 BLOCK_TEST_HEIGHT		= 66;
+	const uint32 BLOCK_TIMING_SIZE		= 1024;
+	const int BLOCK_TIMING_ROUNDS		= 3;
+
+	uint32 blockTestSeed = 17;
+
+	int randomInt(int range)
+	{
+		blockTestSeed = blockTestSeed * 1664525 + 1013904223;
+		return (int)((blockTestSeed >> 8) % (uint32)range);
+	}
+
+	uint8 clampByte(int v)
+	{
+		return (uint8)(v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+
+	enum Image
+	{
+		IMAGE_GRADIENT,		// color and alpha ramps
+		IMAGE_SOLID_BLOCKS,	// one random color and alpha per 4x4 block
+		IMAGE_NATURAL,		// smooth waves with a little noise
+		NUM_IMAGES
+	};
+
+	const char* IMAGE_NAMES[NUM_IMAGES] = { "gradient", "solid blocks", "natural" };
+
+	// the largest RGB and alpha errors accepted for each image, in 8 bit steps
+	const double BC1_MAX_RMSE[NUM_IMAGES]	= { 3.0, 2.0, 6.0 };
+	const double ALPHA_MAX_RMSE[NUM_IMAGES]	= { 1.5, 1.0, 3.0 };
+
+	// B8G8R8A8, tightly packed
+	void buildImage(Image image, uint32 width, uint32 height, Array<uint8>& bgra)
+	{
+		bgra.Resize(width * height * 4);
+		Array<uint8> blockColors;
+		for (uint32 i = 0; i < ((width + 3) / 4) * ((height + 3) / 4) * 4; i++)
+		{
+			blockColors.Append((uint8)randomInt(256));
+		}
+
+		for (uint32 y = 0; y < height; y++)
+		{
+			for (uint32 x = 0; x < width; x++)
+			{
+				uint8* p = &bgra[(y * width + x) * 4];
+				if (image == IMAGE_GRADIENT)
+				{
+					p[2] = (uint8)(x * 255 / (width - 1));
+					p[1] = (uint8)(y * 255 / (height - 1));
+					p[0] = (uint8)((x + y) * 255 / (width + height - 2));
+					p[3] = (uint8)(255 - x * 255 / (width - 1));
+				}
+				else if (image == IMAGE_SOLID_BLOCKS)
+				{
+					const uint8* c = &blockColors[((y / 4) * ((width + 3) / 4) + x / 4) * 4];
+					p[0] = c[0]; p[1] = c[1]; p[2] = c[2]; p[3] = c[3];
+				}
+				else
+				{
+					const scalar u = (scalar)x * 0.09f, v = (scalar)y * 0.07f;
+					p[2] = clampByte((int)(128.0f + 90.0f * Math::Sin(u + v)) + randomInt(7) - 3);
+					p[1] = clampByte((int)(110.0f + 70.0f * Math::Cos(u * 0.7f - v)) + randomInt(7) - 3);
+					p[0] = clampByte((int)(90.0f + 60.0f * Math::Sin(v * 1.3f)) + randomInt(7) - 3);
+					p[3] = clampByte((int)(160.0f + 80.0f * Math::Cos(u + v * 0.5f)));
+				}
+			}
+		}
+	}
+
+	void unpack565(uint16 c, int* rgb)
+	{
+		const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// the 16 colors of a BC1 block as R,G,B; the 3 color mode only where it may be used
+	void decodeColorBlock(const uint8* src, bool allowThreeColors, int* rgb)
+	{
+		const uint16 c0 = (uint16)(src[0] | (src[1] << 8));
+		const uint16 c1 = (uint16)(src[2] | (src[3] << 8));
+		int palette[4][3];
+		unpack565(c0, palette[0]);
+		unpack565(c1, palette[1]);
+		for (int ch = 0; ch < 3; ch++)
+		{
+			if (c0 > c1 || !allowThreeColors)
+			{
+				palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+				palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+			}
+			else
+			{
+				palette[2][ch] = (palette[0][ch] + palette[1][ch]) / 2;
+				palette[3][ch] = 0;
+			}
+		}
+		const uint32 mask = src[4] | (src[5] << 8) | (src[6] << 16) | ((uint32)src[7] << 24);
+		for (int i = 0; i < 16; i++)
+		{
+			const int* c = palette[(mask >> (2 * i)) & 3];
+			rgb[i * 3 + 0] = c[0]; rgb[i * 3 + 1] = c[1]; rgb[i * 3 + 2] = c[2];
+		}
+	}
+
+	// the 16 alphas of a BC3 alpha block
+	void decodeAlphaBlock(const uint8* src, int* alpha)
+	{
+		int palette[8];
+		palette[0] = src[0];
+		palette[1] = src[1];
+		if (palette[0] > palette[1])
+		{
+			for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		uint64 bits = 0;
+		for (int i = 0; i < 6; i++) bits |= (uint64)src[2 + i] << (8 * i);
+		for (int i = 0; i < 16; i++) alpha[i] = palette[(bits >> (3 * i)) & 7];
+	}
+
+	// root mean square errors of the decoded image over the RGB channels and over alpha
+	void measureError(const Array<uint8>& bgra, uint32 width, uint32 height, RenderTexture2D::Format format,
+		const Array<uint8>& blocks, double& colorRmse, double& alphaRmse)
+	{
+		const uint32 blockSize = RenderTexture2D::getFormatBlockSize(format);
+		const uint32 blocksWide = RenderTexture2D::getFormatNumBlocks(width, format);
+		const bool bc3 = format == RenderTexture2D::FORMAT_DXT5;
+		double colorSum = 0, alphaSum = 0;
+		for (uint32 y = 0; y < height; y++)
+		{
+			for (uint32 x = 0; x < width; x++)
+			{
+				const uint8* block = &blocks[((y / 4) * blocksWide + x / 4) * blockSize];
+				int rgb[48], alpha[16];
+				decodeColorBlock(bc3 ? block + 8 : block, !bc3, rgb);
+				const int pixel = (y % 4) * 4 + x % 4;
+				const uint8* p = &bgra[(y * width + x) * 4];
+				for (int ch = 0; ch < 3; ch++)
+				{
+					const double d = (double)(rgb[pixel * 3 + ch] - p[2 - ch]);
+					colorSum += d * d;
+				}
+				if (bc3)
+				{
+					decodeAlphaBlock(block, alpha);
+					const double d = (double)(alpha[pixel] - p[3]);
+					alphaSum += d * d;
+				}
+			}
+		}
+		colorRmse = Math::Sqrt((scalar)(colorSum / (width * height * 3)));
+		alphaRmse = Math::Sqrt((scalar)(alphaSum / (width * height)));
+	}
+
+	uint32 compressedSize(uint32 width, uint32 height, RenderTexture2D::Format format)
+	{
+		return RenderTexture2D::getFormatNumBlocks(width, format) * RenderTexture2D::getFormatNumBlocks(height, format) *
+			RenderTexture2D::getFormatBlockSize(format);
+	}
+}
+
+bool testBlockCompressor()
+{
+	bool ok = true;
+
+	// every image in both formats, with one thread and with all cores
+	for (int image = 0; image < NUM_IMAGES; image++)
+	{
+		Array<uint8> bgra;
+		buildImage((Image)image, BLOCK_TEST_WIDTH, BLOCK_TEST_HEIGHT, bgra);
+		for (int bc3 = 0; bc3 < 2; bc3++)
+		{
+			const RenderTexture2D::Format format = bc3 ? RenderTexture2D::FORMAT_DXT5 : RenderTexture2D::FORMAT_DXT1;
+			Array<uint8> blocks, threaded;
+			blocks.Resize(compressedSize(BLOCK_TEST_WIDTH, BLOCK_TEST_HEIGHT, format));
+			threaded.Resize(blocks.Size());
+			TEST_CHECK(GearBlockCompressor::compressImage(&bgra[0], BLOCK_TEST_WIDTH, BLOCK_TEST_HEIGHT, BLOCK_TEST_WIDTH * 4, format, &blocks[0], 1));
+			TEST_CHECK(GearBlockCompressor::compressImage(&bgra[0], BLOCK_TEST_WIDTH, BLOCK_TEST_HEIGHT, BLOCK_TEST_WIDTH * 4, format, &threaded[0]));
+			TEST_CHECK(memcmp(&blocks[0], &threaded[0], blocks.Size()) == 0);
+
+			double colorRmse, alphaRmse;
+			measureError(bgra, BLOCK_TEST_WIDTH, BLOCK_TEST_HEIGHT, format, blocks, colorRmse, alphaRmse);
+			TEST_CHECK(colorRmse <= BC1_MAX_RMSE[image]);
+			if (bc3)
+			{
+				TEST_CHECK(alphaRmse <= ALPHA_MAX_RMSE[image]);
+				printf("  BC3 %s: RMSE %.2f, alpha %.2f\n", IMAGE_NAMES[image], colorRmse, alphaRmse);
+			}
+			else
+			{
+				printf("  BC1 %s: RMSE %.2f\n", IMAGE_NAMES[image], colorRmse);
+			}
+		}
+	}
+
+	// timing of a large natural image
+	Array<uint8> bgra, blocks;
+	buildImage(IMAGE_NATURAL, BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE, bgra);
+	blocks.Resize(compressedSize(BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE, RenderTexture2D::FORMAT_DXT5));
+	const double megapixels = (double)BLOCK_TIMING_SIZE * BLOCK_TIMING_SIZE * BLOCK_TIMING_ROUNDS / 1e6;
+	for (int bc3 = 0; bc3 < 2; bc3++)
+	{
+		const RenderTexture2D::Format format = bc3 ? RenderTexture2D::FORMAT_DXT5 : RenderTexture2D::FORMAT_DXT1;
+		Timer timer;
+		int round;
+		for (round = 0; round < BLOCK_TIMING_ROUNDS; round++)
+		{
+			GearBlockCompressor::compressImage(&bgra[0], BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE * 4, format, &blocks[0], 1);
+		}
+		const double singleSeconds = timer.getElapsedSeconds();
+		for (round = 0; round < BLOCK_TIMING_ROUNDS; round++)
+		{
+			GearBlockCompressor::compressImage(&bgra[0], BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE * 4, format, &blocks[0]);
+		}
+		const double threadedSeconds = timer.getElapsedSeconds();
+		printf("  %s %ux%u: %.2f MP/s on one thread, %.2f MP/s on %u threads\n", bc3 ? "BC3" : "BC1", BLOCK_TIMING_SIZE, BLOCK_TIMING_SIZE,
+			megapixels / singleSeconds, megapixels / threadedSeconds, GearBlockCompressor::getNumCores());
+	}
+	return ok;
+}
+
+_NAMESPACE_END
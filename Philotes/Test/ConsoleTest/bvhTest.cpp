@@ -0,0 +1,260 @@
+
+#include "consoleTest.h"
+#include "sceneTestElement.h"
+#include "renderBVH.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the queries of RenderBVH against testing every element, with static and dynamic elements,
+// and the structure of the tree after every refit and rebuild.
+namespace
+{
+	const int BVH_NUM_ELEMENTS		= 3000;
+	const int BVH_NUM_FRAMES		= 40;
+	const int BVH_NUM_QUERIES		= 20;
+	const int BVH_TIMING_QUERIES	= 1000;
+
+	uint32 bvhTestSeed = 11;
+
+	scalar randomUnit()
+	{
+		bvhTestSeed = bvhTestSeed * 1664525 + 1013904223;
+		return (scalar)(bvhTestSeed >> 8) / (scalar)(1 << 24);
+	}
+
+	Vector3 randomVector(scalar minimum, scalar maximum)
+	{
+		const scalar x = minimum + (maximum - minimum) * randomUnit();
+		const scalar y = minimum + (maximum - minimum) * randomUnit();
+		return Vector3(x, y, minimum + (maximum - minimum) * randomUnit());
+	}
+
+	// every third element is dynamic
+	bool isDynamic(int element)
+	{
+		return element % 3 == 0;
+	}
+
+	/// checks the nodes and items of the tree
+	class CheckedBVH : public RenderBVH
+	{
+	public:
+
+		/// the number of errors: items whose bounds are out of date or outside their node, children not splitting the range of their parent
+		int check() const { return checkNode(m_root); }
+
+	protected:
+
+		int checkNode(IndexT node) const
+		{
+			if (node == InvalidIndex) return 0;
+
+			int numErrors = 0;
+			const Node& n = m_nodes[node];
+			for (IndexT i = n.first; i < n.first + (IndexT)n.count; i++)
+			{
+				const Item& item = m_items[m_primitives[i]];
+				if (!item.element) continue;
+				const AxisAlignedBox& bounds = item.element->getWorldBoundingBox();
+				for (int axis = 0; axis < 3; axis++)
+				{
+					if (item.minimum[axis] != bounds.getMinimum()[axis] || item.maximum[axis] != bounds.getMaximum()[axis]) numErrors++;
+					if (item.minimum[axis] < n.minimum[axis] || item.maximum[axis] > n.maximum[axis]) numErrors++;
+				}
+			}
+			if (n.children[0] != InvalidIndex)
+			{
+				const Node& left = m_nodes[n.children[0]];
+				const Node& right = m_nodes[n.children[1]];
+				if (left.first != n.first || right.first != left.first + (IndexT)left.count || left.count + right.count != n.count) numErrors++;
+				numErrors += checkNode(n.children[0]) + checkNode(n.children[1]);
+			}
+			return numErrors;
+		}
+	};
+
+	// a convex volume of 5 to 8 planes around center, inside on the positive or the negative side
+	PlaneBoundedVolume randomVolume(const Vector3& center, bool positiveOutside)
+	{
+		PlaneBoundedVolume volume(positiveOutside ? Plane::POSITIVE_SIDE : Plane::NEGATIVE_SIDE);
+		const int numPlanes = 5 + (int)(randomUnit() * 4.0f) % 4;
+		for (int p = 0; p < numPlanes; p++)
+		{
+			Vector3 normal = randomVector(-0.5f, 0.5f);
+			normal.normalise();
+			const Vector3 point = center - normal * (30.0f + randomUnit() * 30.0f);
+			volume.planes.push_back(Plane(positiveOutside ? -normal : normal, point));
+		}
+		return volume;
+	}
+
+	// the number of queries whose results differ from testing every element in the tree
+	int countQueryErrors(const RenderBVH& bvh, Array<SceneTestElement*>& elements)
+	{
+		int numErrors = 0;
+		for (int query = 0; query < BVH_NUM_QUERIES; query++)
+		{
+			const Vector3 center = randomVector(-100.0f, 100.0f);
+			const PlaneBoundedVolume volume = randomVolume(center, query % 2 == 1);
+			// every fourth ray is parallel to the z = 0 plane
+			Vector3 direction(1.0f, randomUnit() - 0.5f, query % 4 == 3 ? 0.0f : randomUnit() - 0.5f);
+			direction.normalise();
+			const Ray ray(Vector3(-150.0f, center.y, center.z), direction);
+
+			Array<RenderTransformElement*> volumeResult;
+			Array<RenderBVH::RayHit> rayResult;
+			RenderBVH::RayHit nearest;
+			bvh.findIntersecting(volume, volumeResult);
+			bvh.findIntersecting(ray, rayResult);
+			const bool foundNearest = bvh.findNearest(ray, nearest);
+
+			SizeT numVolume = 0, numRay = 0;
+			scalar nearestDistance = FLT_MAX;
+			bool found = true;
+			for (SizeT i = 0; i < elements.Size(); i++)
+			{
+				SceneTestElement* element = elements[i];
+				if (!element->getBVH()) continue;
+				const AxisAlignedBox& bounds = element->getWorldBoundingBox();
+				const bool inVolume = volume.intersects(bounds);
+				const bool inResult = volumeResult.FindIndex(element) != InvalidIndex;
+				if (inVolume) numVolume++;
+				found = found && inVolume == inResult;
+
+				// infinite bounds are hit at distance 0, findNearest() leaves them out
+				const std::pair<bool, scalar> hit = bounds.isInfinite() ? std::pair<bool, scalar>(true, 0.0f) : Math::intersects(ray, bounds);
+				if (hit.first)
+				{
+					numRay++;
+					if (bounds.isFinite() && hit.second < nearestDistance) nearestDistance = hit.second;
+				}
+			}
+			bool sorted = true;
+			for (SizeT k = 1; k < rayResult.Size(); k++)
+			{
+				sorted = sorted && rayResult[k - 1].distance <= rayResult[k].distance;
+			}
+			const bool nearestCorrect = foundNearest == (nearestDistance < FLT_MAX) &&
+				(!foundNearest || Math::Abs(nearest.distance - nearestDistance) <= 1e-3f);
+			if (!found || !sorted || !nearestCorrect || numVolume != volumeResult.Size() || numRay != rayResult.Size())
+			{
+				numErrors++;
+			}
+		}
+		return numErrors;
+	}
+}
+
+bool testRenderBVH()
+{
+	bool ok = true;
+
+	CheckedBVH* bvh = ph_new(CheckedBVH);
+	RenderTransform* node = ph_new(RenderTransform)("bvhTest");
+	Array<SceneTestElement*> elements;
+	int i;
+
+	// every 50th element at the same place, some infinite or null
+	for (i = 0; i < BVH_NUM_ELEMENTS; i++)
+	{
+		SceneTestElement* element = ph_new(SceneTestElement)(String::FromInt(i));
+		const Vector3 center = i % 50 == 0 ? Vector3(5.0f, 5.0f, 5.0f) : randomVector(-130.0f, 130.0f);
+		const Vector3 halfSize(randomUnit() * randomUnit() * 20.0f, randomUnit() * randomUnit() * 20.0f, randomUnit() * randomUnit() * 20.0f);
+		AxisAlignedBox box(center - halfSize, center + halfSize);
+		if (i % 97 == 0) box.setInfinite();
+		if (i % 89 == 0) box.setNull();
+		element->setBox(box);
+		node->attachObject(element);
+		bvh->add(element, isDynamic(i));
+		elements.Append(element);
+	}
+	TEST_CHECK(bvh->size() == (SizeT)BVH_NUM_ELEMENTS);
+
+	int numTreeErrors = 0, numQueryErrors = 0;
+	for (int frame = 0; frame < BVH_NUM_FRAMES; frame++)
+	{
+		// half of the dynamic elements move, an infinite one becomes finite
+		for (i = 0; i < BVH_NUM_ELEMENTS; i++)
+		{
+			if (!isDynamic(i) || randomUnit() > 0.5f) continue;
+			const AxisAlignedBox& box = elements[i]->getWorldBoundingBox();
+			if (i % 97 == 0 && frame == 25)
+			{
+				elements[i]->setBox(AxisAlignedBox(-1, -1, -1, 1, 1, 1));
+				continue;
+			}
+			if (!box.isFinite()) continue;
+			const Vector3 offset = randomVector(-4.0f, 4.0f);
+			elements[i]->setBox(AxisAlignedBox(box.getMinimum() + offset, box.getMaximum() + offset));
+		}
+		if (frame == 10)
+		{
+			for (i = 0; i < BVH_NUM_ELEMENTS; i += 7)
+			{
+				bvh->remove(elements[i]->getBVHHandle());
+				TEST_CHECK(elements[i]->getBVH() == NULL);
+			}
+		}
+		if (frame == 20)
+		{
+			for (i = 0; i < BVH_NUM_ELEMENTS; i += 7)
+			{
+				bvh->add(elements[i], isDynamic(i));
+			}
+			TEST_CHECK(bvh->size() == (SizeT)BVH_NUM_ELEMENTS);
+		}
+		bvh->update();
+		numTreeErrors += bvh->check();
+		numQueryErrors += countQueryErrors(*bvh, elements);
+	}
+	TEST_CHECK(numTreeErrors == 0);
+	TEST_CHECK(numQueryErrors == 0);
+
+	// timing of nearest hits against testing every element
+	Array<Ray> rays;
+	for (i = 0; i < BVH_TIMING_QUERIES; i++)
+	{
+		const Vector3 origin = randomVector(-100.0f, 100.0f);
+		Vector3 direction = randomVector(-1.0f, 1.0f);
+		direction.normalise();
+		rays.Append(Ray(origin, direction));
+	}
+	Timer timer;
+	scalar bvhSum = 0;
+	for (i = 0; i < BVH_TIMING_QUERIES; i++)
+	{
+		RenderBVH::RayHit hit;
+		if (bvh->findNearest(rays[i], hit)) bvhSum += hit.distance;
+	}
+	const double bvhSeconds = timer.getElapsedSeconds();
+	scalar bruteForceSum = 0;
+	for (i = 0; i < BVH_TIMING_QUERIES; i++)
+	{
+		scalar nearestDistance = FLT_MAX;
+		for (int k = 0; k < BVH_NUM_ELEMENTS; k++)
+		{
+			const AxisAlignedBox& bounds = elements[k]->getWorldBoundingBox();
+			if (!bounds.isFinite()) continue;
+			const std::pair<bool, scalar> hit = Math::intersects(rays[i], bounds);
+			if (hit.first && hit.second < nearestDistance) nearestDistance = hit.second;
+		}
+		if (nearestDistance < FLT_MAX) bruteForceSum += nearestDistance;
+	}
+	const double bruteForceSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(Math::Abs(bvhSum - bruteForceSum) <= 1e-3f * (1.0f + bruteForceSum));
+	printf("  %d elements in %d nodes, cost %.2f: %d nearest hits %.2f ms, testing every element %.2f ms\n", BVH_NUM_ELEMENTS,
+		(int)bvh->getNumNodes(), bvh->getCost(), BVH_TIMING_QUERIES, bvhSeconds * 1000.0, bruteForceSeconds * 1000.0);
+
+	// the node lets go of the elements, the elements leave the tree
+	ph_delete(node);
+	for (i = 0; i < BVH_NUM_ELEMENTS; i++)
+	{
+		ph_delete(elements[i]);
+	}
+	TEST_CHECK(bvh->size() == 0);
+	ph_delete(bvh);
+	return ok;
+}
+
+_NAMESPACE_END
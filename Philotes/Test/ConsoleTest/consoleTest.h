@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.h"
+
+#include <stdio.h>
+
+// Every test is a function returning whether it passed. A failed TEST_CHECK prints
+// the condition and marks the test as failed but keeps it running, so one run shows
+// every broken check. Timings are printed for comparison, they never fail a test.
+#define TEST_CHECK(cond) \
+	do { if(!(cond)) { printf("  %s(%d): check failed: %s\n", __FILE__, __LINE__, #cond); ok = false; } } while(0)
+
+_NAMESPACE_BEGIN
+
+// queueTest.cpp
+bool testSpscQueue();
+bool testMpmcQueue();
+
+// refCountedTest.cpp
+bool testRefCounted();
+
+// simdMathTest.cpp
+bool testSimdMath();
+
+// mathBatchTest.cpp
+bool testMathBatch();
+
+// fastMathTest.cpp
+bool testFastMath();
+
+// transformHierarchyTest.cpp
+bool testTransformHierarchy();
+
+// octreeTest.cpp
+bool testRenderOctree();
+
+// quadTreeTest.cpp
+bool testQuadTree();
+
+// bvhTest.cpp
+bool testRenderBVH();
+
+// shaderCacheTest.cpp
+bool testShaderCache();
+
+// textureStreamTest.cpp
+bool testTextureStream();
+
+// blockCompressorTest.cpp
+bool testBlockCompressor();
+
+// hashTableTest.cpp
+bool testHashTable();
+
+// flatDictionaryTest.cpp
+bool testFlatDictionary();
+
+// arrayTest.cpp
+bool testArray();
+
+// stringAtomTest.cpp
+bool testStringAtom();
+
+// allocatorTest.cpp
+bool testAllocators();
+
+// memoryStatsTest.cpp
+bool testMemoryStats();
+
+// jobSystemTest.cpp
+bool testJobSystem();
+
+// renderNodeTest.cpp
+bool testRenderNode();
+
+// renderCellNodeTest.cpp
+bool testCellUpdate();
+bool testCellVisibility();
+bool testCellSceneIndex();
+
+_NAMESPACE_END
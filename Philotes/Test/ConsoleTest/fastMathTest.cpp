@@ -0,0 +1,205 @@
+
+#include "consoleTest.h"
+#include "math/fastMath.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the errors documented in math/fastMath.h, measured against the double precision C library.
+namespace
+{
+	const int FASTMATH_SWEEP_STEPS		= 200000;
+	const int FASTMATH_TIMING_COUNT		= 1000000;
+
+	enum FastMathFunction
+	{
+		FM_SIN,
+		FM_COS,
+		FM_ATAN2_X,		// atan2(0.7, x)
+		FM_ATAN2_Y,		// atan2(y, 0.7)
+		FM_ATAN2_NEG,	// atan2(-0.7, x)
+		FM_ACOS,
+		FM_RSQRT,
+		FM_EXP2,
+		FM_LOG2,
+	};
+
+	struct FastMathSweep
+	{
+		const char*			name;
+		FastMathFunction	function;
+		double				minimum;
+		double				maximum;
+		double				maxError;
+		bool				relative;
+	};
+
+	const FastMathSweep fastMathSweeps[] =
+	{
+		{ "Sin",	FM_SIN,			-8192.0,	8192.0,	8e-8,	false },
+		{ "Cos",	FM_COS,			-8192.0,	8192.0,	8e-8,	false },
+		{ "ATan2 x",	FM_ATAN2_X,		-50.0,		50.0,	3e-7,	false },
+		{ "ATan2 y",	FM_ATAN2_Y,		-50.0,		50.0,	3e-7,	false },
+		{ "ATan2 -y",	FM_ATAN2_NEG,	-2.0,		2.0,	3e-7,	false },
+		{ "ACos",	FM_ACOS,		-1.0,		1.0,	3e-7,	false },
+		{ "RSqrt",	FM_RSQRT,		1e-3,		1e4,	2.6e-7,	true },
+		{ "Exp2",	FM_EXP2,		-126.0,		127.0,	2.5e-7,	true },
+		{ "Log2",	FM_LOG2,		1e-3,		1e4,	6e-7,	false },
+	};
+
+	double fastMathReference(FastMathFunction function, double x)
+	{
+		switch (function)
+		{
+		case FM_SIN:		return sin(x);
+		case FM_COS:		return cos(x);
+		case FM_ATAN2_X:	return atan2(0.7, x);
+		case FM_ATAN2_Y:	return atan2(x, 0.7);
+		case FM_ATAN2_NEG:	return atan2(-0.7, x);
+		case FM_ACOS:		return acos(x);
+		case FM_RSQRT:		return 1.0 / sqrt(x);
+		case FM_EXP2:		return pow(2.0, x);
+		default:			return log(x) / log(2.0);
+		}
+	}
+
+	scalar fastMathScalar(FastMathFunction function, scalar x)
+	{
+		switch (function)
+		{
+		case FM_SIN:		return FastMath::Sin(x);
+		case FM_COS:		return FastMath::Cos(x);
+		case FM_ATAN2_X:	return FastMath::ATan2(0.7f, x);
+		case FM_ATAN2_Y:	return FastMath::ATan2(x, 0.7f);
+		case FM_ATAN2_NEG:	return FastMath::ATan2(-0.7f, x);
+		case FM_ACOS:		return FastMath::ACos(x);
+		case FM_RSQRT:		return FastMath::RSqrt(x);
+		case FM_EXP2:		return FastMath::Exp2(x);
+		default:			return FastMath::Log2(x);
+		}
+	}
+
+#if PH_MATH_SIMD
+	// x in every lane, the error is measured on the last one
+	scalar fastMathSimd(FastMathFunction function, scalar x)
+	{
+		const __m128 v = _mm_set1_ps(x);
+		__m128 r;
+		switch (function)
+		{
+		case FM_SIN:		r = FastMath::Sin(v); break;
+		case FM_COS:		r = FastMath::Cos(v); break;
+		case FM_ATAN2_X:	r = FastMath::ATan2(_mm_set1_ps(0.7f), v); break;
+		case FM_ATAN2_Y:	r = FastMath::ATan2(v, _mm_set1_ps(0.7f)); break;
+		case FM_ATAN2_NEG:	r = FastMath::ATan2(_mm_set1_ps(-0.7f), v); break;
+		case FM_ACOS:		r = FastMath::ACos(v); break;
+		case FM_RSQRT:		r = FastMath::RSqrt(v); break;
+		case FM_EXP2:		r = FastMath::Exp2(v); break;
+		default:			r = FastMath::Log2(v); break;
+		}
+		return _mm_cvtss_f32(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+	}
+#endif
+
+	// the largest error over the sweep, the ranges of RSqrt and Log2 are swept logarithmically
+	double fastMathMaxError(const FastMathSweep& sweep, bool simd, double& worstX)
+	{
+		const bool logarithmic = sweep.function == FM_RSQRT || sweep.function == FM_LOG2;
+		double maxError = 0;
+		for (int step = 0; step <= FASTMATH_SWEEP_STEPS; step++)
+		{
+			const double t = (double)step / FASTMATH_SWEEP_STEPS;
+			const scalar x = logarithmic ?
+				(scalar)(sweep.minimum * pow(sweep.maximum / sweep.minimum, t)) :
+				(scalar)(sweep.minimum + (sweep.maximum - sweep.minimum) * t);
+			const double reference = fastMathReference(sweep.function, x);
+#if PH_MATH_SIMD
+			const double value = simd ? fastMathSimd(sweep.function, x) : fastMathScalar(sweep.function, x);
+#else
+			(void)simd;
+			const double value = fastMathScalar(sweep.function, x);
+#endif
+			double error = fabs(value - reference);
+			if (sweep.relative) error /= fabs(reference);
+			if (error > maxError)
+			{
+				maxError = error;
+				worstX = x;
+			}
+		}
+		return maxError;
+	}
+}
+
+bool testFastMath()
+{
+	bool ok = true;
+
+	const int numSweeps = sizeof(fastMathSweeps) / sizeof(fastMathSweeps[0]);
+	for (int i = 0; i < numSweeps; i++)
+	{
+		const FastMathSweep& sweep = fastMathSweeps[i];
+		double worstX = 0;
+		const double error = fastMathMaxError(sweep, false, worstX);
+		printf("  %-8s [%g, %g]: %s error %.3g at %g\n", sweep.name, sweep.minimum, sweep.maximum,
+			sweep.relative ? "relative" : "absolute", error, worstX);
+		TEST_CHECK(error <= sweep.maxError);
+#if PH_MATH_SIMD
+		const double simdError = fastMathMaxError(sweep, true, worstX);
+		TEST_CHECK(simdError <= sweep.maxError);
+#endif
+	}
+
+	// signed zeros take the side of the sign
+	TEST_CHECK(FastMath::ATan2(0.0f, -1.0f) == Math::PI);
+	TEST_CHECK(FastMath::ATan2(-0.0f, -1.0f) == -Math::PI);
+	TEST_CHECK(FastMath::ATan2(0.0f, 0.0f) == 0.0f);
+	TEST_CHECK(FastMath::ACos(2.0f) == 0.0f);
+	TEST_CHECK(FastMath::Exp2(1000.0f) == FastMath::Exp2(127.0f));
+#if PH_MATH_SIMD
+	// halves round to even in both versions, so they reduce to the same argument
+	const scalar halves[] = { -2.5f, -1.5f, -0.5f, 0.5f, 1.5f, 2.5f };
+	for (int i = 0; i < (int)(sizeof(halves) / sizeof(halves[0])); i++)
+	{
+		TEST_CHECK(FastMath::Exp2(halves[i]) == fastMathSimd(FM_EXP2, halves[i]));
+		TEST_CHECK(FastMath::Sin(halves[i] * Math::HALF_PI) == fastMathSimd(FM_SIN, halves[i] * Math::HALF_PI));
+	}
+#endif
+
+	// timing against the C library, the sums keep the compiler from dropping the loops
+	Timer timer;
+	scalar fastSum = 0;
+	for (int i = 0; i < FASTMATH_TIMING_COUNT; i++)
+	{
+		fastSum += FastMath::Sin((scalar)i * 0.001f);
+	}
+	const double fastSeconds = timer.getElapsedSeconds();
+	scalar librarySum = 0;
+	for (int i = 0; i < FASTMATH_TIMING_COUNT; i++)
+	{
+		librarySum += (scalar)sin((scalar)i * 0.001f);
+	}
+	const double librarySeconds = timer.getElapsedSeconds();
+	TEST_CHECK(fabs(fastSum - librarySum) < 1.0f);
+#if PH_MATH_SIMD
+	__m128 simdSum = _mm_setzero_ps();
+	const __m128 offsets = _mm_set_ps(0.003f, 0.002f, 0.001f, 0.0f);
+	timer.getElapsedSeconds();
+	for (int i = 0; i < FASTMATH_TIMING_COUNT; i += 4)
+	{
+		simdSum = _mm_add_ps(simdSum, FastMath::Sin(_mm_add_ps(_mm_set1_ps((scalar)i * 0.001f), offsets)));
+	}
+	const double simdSeconds = timer.getElapsedSeconds();
+	float lanes[4];
+	_mm_storeu_ps(lanes, simdSum);
+	TEST_CHECK(fabs(lanes[0] + lanes[1] + lanes[2] + lanes[3] - fastSum) < 1.0f);
+	printf("  %d Sin: %.2f ms, 4 wide %.2f ms, C library %.2f ms\n", FASTMATH_TIMING_COUNT,
+		fastSeconds * 1000.0, simdSeconds * 1000.0, librarySeconds * 1000.0);
+#else
+	printf("  %d Sin: %.2f ms, C library %.2f ms\n", FASTMATH_TIMING_COUNT, fastSeconds * 1000.0, librarySeconds * 1000.0);
+#endif
+
+	return ok;
+}
+
+_NAMESPACE_END
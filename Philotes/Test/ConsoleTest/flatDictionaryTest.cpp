@@ -0,0 +1,236 @@
+
+#include "consoleTest.h"
+#include "util/flatdictionary.h"
+#include "util/dictionary.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// FlatDictionary with and without the Eytzinger layout against a plain list of the added pairs,
+// for radix sorted and STL sorted keys, and timed against Dictionary's binary search.
+namespace
+{
+	const SizeT FLATDICT_SIZES[]			= { 0, 1, 2, 3, 7, 100, 1000, 1023, 1025 };
+	const int FLATDICT_TIMING_KEYS			= 100000;
+	const int FLATDICT_TIMING_STRING_KEYS	= 5000;
+	const int FLATDICT_TIMING_ROUNDS		= 10;
+
+	uint32 flatDictTestSeed = 23;
+
+	uint32 randomUint()
+	{
+		flatDictTestSeed = flatDictTestSeed * 1664525 + 1013904223;
+		return flatDictTestSeed;
+	}
+
+	/// distinct keys spread over positive and negative values, odd so that even neighbours are missing
+	template<class KEY> KEY makeKey(int k);
+	template<> int32 makeKey<int32>(int k)		{ return (int32)(k * 2 + 1) * ((k & 1) ? -1 : 1); }
+	template<> uint16 makeKey<uint16>(int k)	{ return (uint16)(k * 2 + 1); }
+	template<> int64 makeKey<int64>(int k)		{ return (int64)(k * 2 + 1) * ((k & 1) ? -(int64)1 << 33 : 1); }
+	template<> String makeKey<String>(int k)	{ String s; s.Format("key%dx", k * 2 + 1); return s; }
+
+	/// a key that was never added and sorts next to the added one
+	template<class KEY> KEY makeMissingKey(int k);
+	template<> int32 makeMissingKey<int32>(int k)	{ return makeKey<int32>(k) + 1; }
+	template<> uint16 makeMissingKey<uint16>(int k)	{ return (uint16)(makeKey<uint16>(k) + 1); }
+	template<> int64 makeMissingKey<int64>(int k)	{ return makeKey<int64>(k) + 1; }
+	template<> String makeMissingKey<String>(int k)	{ String s = makeKey<String>(k); s.Append("_"); return s; }
+
+	/// the number of keys that are not sorted, found with the wrong value or found although missing
+	template<class KEY, bool EYTZINGER> int countErrors(const FlatDictionary<KEY, int, EYTZINGER>& dict, const Array<int>& added, SizeT numKeys)
+	{
+		int numErrors = 0;
+		SizeT i;
+		for (i = 1; i < dict.Size(); i++)
+		{
+			if (dict.KeyAtIndex(i) < dict.KeyAtIndex(i - 1)) numErrors++;
+		}
+		for (i = 0; i < numKeys; i++)
+		{
+			const KEY key = makeKey<KEY>((int)i);
+			const IndexT index = dict.FindIndex(key);
+			if (added[i] < 0)
+			{
+				if (index != InvalidIndex || dict.Contains(key)) numErrors++;
+			}
+			else if (index == InvalidIndex || dict.KeyAtIndex(index) != key || dict.ValueAtIndex(index) != added[i] || dict[key] != added[i])
+			{
+				numErrors++;
+			}
+			if (dict.Contains(makeMissingKey<KEY>((int)i))) numErrors++;
+		}
+		return numErrors;
+	}
+
+	/// bulk adds, single adds and erases at every size
+	template<class KEY, bool EYTZINGER> bool checkDictionary()
+	{
+		bool ok = true;
+		for (SizeT s = 0; s < sizeof(FLATDICT_SIZES) / sizeof(FLATDICT_SIZES[0]); s++)
+		{
+			const SizeT numKeys = FLATDICT_SIZES[s];
+			Array<int> added;
+			added.Fill(0, numKeys, -1);
+
+			// a shuffled bulk add of every other key
+			Array<int> order;
+			SizeT i;
+			for (i = 0; i < numKeys; i += 2) order.Append((int)i);
+			for (i = order.Size(); i > 1; i--)
+			{
+				const IndexT j = (IndexT)(randomUint() % i);
+				const int t = order[i - 1]; order[i - 1] = order[j]; order[j] = t;
+			}
+			FlatDictionary<KEY, int, EYTZINGER> dict;
+			dict.BeginBulkAdd();
+			for (i = 0; i < order.Size(); i++)
+			{
+				dict.Add(makeKey<KEY>(order[i]), order[i] * 3);
+				added[order[i]] = order[i] * 3;
+			}
+			dict.EndBulkAdd();
+			TEST_CHECK(dict.Size() == order.Size() && dict.IsEmpty() == order.IsEmpty());
+			TEST_CHECK(dict.HasSearchLayout() == EYTZINGER);
+			TEST_CHECK((countErrors<KEY, EYTZINGER>(dict, added, numKeys)) == 0);
+
+			// single adds of the others make the layout stale until it is rebuilt
+			for (i = 1; i < numKeys; i += 2)
+			{
+				dict.Add(makeKey<KEY>((int)i), (int)i * 3);
+				added[i] = (int)i * 3;
+			}
+			if (numKeys > 1) TEST_CHECK(!dict.HasSearchLayout());
+			TEST_CHECK((countErrors<KEY, EYTZINGER>(dict, added, numKeys)) == 0);
+			dict.BuildSearchLayout();
+			TEST_CHECK(dict.HasSearchLayout() == EYTZINGER);
+			TEST_CHECK((countErrors<KEY, EYTZINGER>(dict, added, numKeys)) == 0);
+
+			// erasing every third key by key and by index, a copy keeps the layout
+			for (i = 0; i < numKeys; i += 3)
+			{
+				if (i % 2) dict.Erase(makeKey<KEY>((int)i));
+				else dict.EraseAtIndex(dict.FindIndex(makeKey<KEY>((int)i)));
+				added[i] = -1;
+			}
+			dict.BuildSearchLayout();
+			FlatDictionary<KEY, int, EYTZINGER> copy(dict), assigned;
+			assigned = copy;
+			TEST_CHECK(assigned.HasSearchLayout() == EYTZINGER);
+			TEST_CHECK((countErrors<KEY, EYTZINGER>(assigned, added, numKeys)) == 0);
+			dict.Clear();
+			TEST_CHECK(dict.IsEmpty() && !dict.Contains(makeKey<KEY>(0)));
+		}
+		return ok;
+	}
+
+	/// duplicate keys: the bulk radix sort is stable, single adds go behind the equal keys, and a search finds the first
+	template<bool EYTZINGER> bool checkDuplicates()
+	{
+		bool ok = true;
+		FlatDictionary<int32, int, EYTZINGER> dict;
+		dict.BeginBulkAdd();
+		dict.Add(9, 0);
+		dict.Add(5, 1);
+		dict.Add(-5, 2);
+		dict.Add(5, 3);
+		dict.Add(9, 4);
+		dict.Add(5, 5);
+		dict.EndBulkAdd();
+		TEST_CHECK(dict.Size() == 6);
+		const IndexT first = dict.FindIndex(5);
+		TEST_CHECK(first == 1);
+		TEST_CHECK(dict.ValueAtIndex(1) == 1 && dict.ValueAtIndex(2) == 3 && dict.ValueAtIndex(3) == 5);
+		TEST_CHECK(dict.FindIndex(9) == 4 && dict.ValueAtIndex(4) == 0 && dict.ValueAtIndex(5) == 4);
+
+		dict.Add(5, 6);
+		TEST_CHECK(dict.KeyAtIndex(4) == 5 && dict.ValueAtIndex(4) == 6 && dict.FindIndex(5) == 1);
+		dict.BuildSearchLayout();
+		TEST_CHECK(dict.FindIndex(5) == 1 && dict.FindIndex(9) == 5 && dict.FindIndex(-5) == 0);
+		dict.Erase(5);
+		TEST_CHECK(dict.Size() == 6 && dict.FindIndex(5) == 1 && dict.ValueAtIndex(1) == 3);
+
+		// operator[] creates a missing key with a default value
+		FlatDictionary<int32, int, EYTZINGER> created;
+		created[7] = 70;
+		created[3] = 30;
+		TEST_CHECK(created.Size() == 2 && created.KeyAtIndex(0) == 3 && created[7] == 70);
+		return ok;
+	}
+
+	template<class KEY> void timeDictionaries(const char* name, int numKeys)
+	{
+		Array<KEY> keys, queries;
+		int k;
+		for (k = 0; k < numKeys; k++)
+		{
+			keys.Append(makeKey<KEY>((int)(randomUint() % 0x3fffffff)));
+		}
+		for (k = 0; k < numKeys; k++)
+		{
+			// half hits, half misses
+			queries.Append((k & 1) ? keys[randomUint() % numKeys] : makeMissingKey<KEY>((int)(randomUint() % 0x3fffffff)));
+		}
+
+		Timer timer;
+		Dictionary<KEY, int> dictionary;
+		FlatDictionary<KEY, int> flat;
+		FlatDictionary<KEY, int, true> eytzinger;
+		dictionary.BeginBulkAdd();
+		for (k = 0; k < numKeys; k++) dictionary.Add(keys[k], k);
+		dictionary.EndBulkAdd();
+		const double dictionaryAdd = timer.getElapsedSeconds();
+		flat.BeginBulkAdd();
+		for (k = 0; k < numKeys; k++) flat.Add(keys[k], k);
+		flat.EndBulkAdd();
+		const double flatAdd = timer.getElapsedSeconds();
+		eytzinger.BeginBulkAdd();
+		for (k = 0; k < numKeys; k++) eytzinger.Add(keys[k], k);
+		eytzinger.EndBulkAdd();
+		const double eytzingerAdd = timer.getElapsedSeconds();
+
+		int round, numDictionary = 0, numFlat = 0, numEytzinger = 0;
+		for (round = 0; round < FLATDICT_TIMING_ROUNDS; round++)
+		{
+			for (k = 0; k < numKeys; k++) numDictionary += dictionary.FindIndex(queries[k]) != InvalidIndex ? 1 : 0;
+		}
+		const double dictionaryFind = timer.getElapsedSeconds();
+		for (round = 0; round < FLATDICT_TIMING_ROUNDS; round++)
+		{
+			for (k = 0; k < numKeys; k++) numFlat += flat.FindIndex(queries[k]) != InvalidIndex ? 1 : 0;
+		}
+		const double flatFind = timer.getElapsedSeconds();
+		for (round = 0; round < FLATDICT_TIMING_ROUNDS; round++)
+		{
+			for (k = 0; k < numKeys; k++) numEytzinger += eytzinger.FindIndex(queries[k]) != InvalidIndex ? 1 : 0;
+		}
+		const double eytzingerFind = timer.getElapsedSeconds();
+
+		const double findScale = 1e9 / ((double)numKeys * FLATDICT_TIMING_ROUNDS);
+		printf("  %d %s keys, bulk add ms / ns per find: Dictionary %.2f / %.1f, flat %.2f / %.1f, Eytzinger %.2f / %.1f%s\n",
+			numKeys, name, dictionaryAdd * 1000.0, dictionaryFind * findScale, flatAdd * 1000.0, flatFind * findScale,
+			eytzingerAdd * 1000.0, eytzingerFind * findScale, (numDictionary == numFlat && numFlat == numEytzinger) ? "" : " (results differ)");
+	}
+}
+
+bool testFlatDictionary()
+{
+	bool ok = true;
+
+	TEST_CHECK((checkDictionary<int32, false>()));
+	TEST_CHECK((checkDictionary<int32, true>()));
+	TEST_CHECK((checkDictionary<uint16, true>()));
+	TEST_CHECK((checkDictionary<int64, false>()));
+	TEST_CHECK((checkDictionary<int64, true>()));
+	TEST_CHECK((checkDictionary<String, false>()));
+	TEST_CHECK((checkDictionary<String, true>()));
+	TEST_CHECK(checkDuplicates<false>());
+	TEST_CHECK(checkDuplicates<true>());
+
+	// timing against the binary search over the pairs of Dictionary
+	timeDictionaries<int32>("int32", FLATDICT_TIMING_KEYS);
+	timeDictionaries<String>("String", FLATDICT_TIMING_STRING_KEYS);
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,313 @@
+
+#include "consoleTest.h"
+#include "util/hashtable.h"
+#include "util/fixedarray.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// HashTable against a plain array of the expected values, with well spread, clustered and
+// colliding hash codes, and timed against the chained table it replaced.
+namespace
+{
+	const int HASHTABLE_NUM_KEYS		= 4000;
+	const int HASHTABLE_NUM_OPERATIONS	= 60000;
+	const int HASHTABLE_TIMING_KEYS		= 20000;
+	const int HASHTABLE_TIMING_ROUNDS	= 5;
+
+	uint32 hashTableTestSeed = 19;
+
+	int randomInt(int range)
+	{
+		hashTableTestSeed = hashTableTestSeed * 1664525 + 1013904223;
+		return (int)((hashTableTestSeed >> 8) % (uint32)range);
+	}
+
+	/// an integer key whose hash code keeps only the bits of a mask
+	template<uint32 MASK> struct MaskedKey
+	{
+		MaskedKey() : value(0) {}
+		MaskedKey(int v) : value(v) {}
+		IndexT HashCode() const { return (IndexT)((uint32)this->value & MASK); }
+		bool operator==(const MaskedKey& rhs) const { return this->value == rhs.value; }
+		bool operator!=(const MaskedKey& rhs) const { return this->value != rhs.value; }
+		bool operator<(const MaskedKey& rhs) const { return this->value < rhs.value; }
+		bool operator>(const MaskedKey& rhs) const { return this->value > rhs.value; }
+		int value;
+	};
+
+	typedef MaskedKey<0xffffffff> SpreadKey;	// every key its own hash code
+	typedef MaskedKey<7> ClusteredKey;			// 8 hash codes
+	typedef MaskedKey<0> CollidingKey;			// one hash code
+
+	struct MakeString
+	{
+		static String Make(int k) { return String::FromInt(k); }
+		static int Value(const String& key) { return key.AsInt(); }
+	};
+
+	template<class KEY> struct MakeMasked
+	{
+		static KEY Make(int k) { return KEY(k); }
+		static int Value(const KEY& key) { return key.value; }
+	};
+
+	/// random adds and erases by key and by iterator, checked against expected[key], -1 where absent
+	template<class TABLE, class MAKE> bool checkTable(TABLE& table, int numKeys)
+	{
+		bool ok = true;
+		typedef typename TABLE::Iterator Iterator;
+		Array<int> expected;
+		expected.Fill(0, numKeys, -1);
+		SizeT size = 0;
+		int op;
+		for (op = 0; op < HASHTABLE_NUM_OPERATIONS; op++)
+		{
+			const int k = randomInt(numKeys);
+			if (randomInt(3) < 2)
+			{
+				if (expected[k] >= 0) continue;
+				table.Add(MAKE::Make(k), k * 3);
+				expected[k] = k * 3;
+				size++;
+			}
+			else if (expected[k] >= 0)
+			{
+				if (randomInt(2)) table.Erase(MAKE::Make(k));
+				else
+				{
+					Iterator iter = table.Find(MAKE::Make(k));
+					table.Erase(iter);
+				}
+				expected[k] = -1;
+				size--;
+			}
+		}
+		TEST_CHECK(table.Size() == size);
+
+		// every key is found or missing as expected, through every lookup
+		int numWrong = 0, k;
+		for (k = 0; k < numKeys; k++)
+		{
+			const bool contained = table.Contains(MAKE::Make(k));
+			typename TABLE::KeyValueType* kvp = table.FindKV(MAKE::Make(k));
+			const bool found = table.Find(MAKE::Make(k)) != table.End();
+			if (contained != (expected[k] >= 0) || found != contained || (kvp != 0) != contained) numWrong++;
+			else if (contained && (table[MAKE::Make(k)] != expected[k] || kvp->Value() != expected[k])) numWrong++;
+		}
+		TEST_CHECK(numWrong == 0);
+
+		// iteration visits every element once, also while erasing every odd key on the way
+		Array<int> visits;
+		visits.Fill(0, numKeys, 0);
+		SizeT numVisited = 0;
+		Iterator iter;
+		for (iter = table.Begin(); iter != table.End(); ++iter)
+		{
+			visits[MAKE::Value(iter->Key())]++;
+			numVisited++;
+		}
+		TEST_CHECK(numVisited == size);
+		visits.Fill(0, numKeys, 0);
+		const Array<int> before = expected;
+		for (iter = table.Begin(); iter != table.End();)
+		{
+			const int key = MAKE::Value(iter->Key());
+			visits[key]++;
+			if (key & 1)
+			{
+				table.Erase(iter);
+				expected[key] = -1;
+				size--;
+			}
+			else ++iter;
+		}
+		numWrong = 0;
+		for (k = 0; k < numKeys; k++)
+		{
+			if (visits[k] != (before[k] >= 0 ? 1 : 0)) numWrong++;
+			if (table.Contains(MAKE::Make(k)) != (expected[k] >= 0)) numWrong++;
+		}
+		TEST_CHECK(numWrong == 0);
+		TEST_CHECK(table.Size() == size && table.Content().Size() == size);
+
+		// copies hold the same elements, Clear keeps the slots
+		TABLE copy(table), assigned;
+		assigned = copy;
+		TEST_CHECK(assigned.Size() == size && copy.Size() == size);
+		numWrong = 0;
+		for (k = 0; k < numKeys; k += 2)
+		{
+			if (expected[k] >= 0 && (!assigned.Contains(MAKE::Make(k)) || assigned[MAKE::Make(k)] != expected[k])) numWrong++;
+		}
+		TEST_CHECK(numWrong == 0);
+		const SizeT capacity = table.Capacity();
+		table.Clear();
+		TEST_CHECK(table.IsEmpty() && table.Begin() == table.End() && table.Capacity() == capacity);
+		TEST_CHECK(!table.Contains(MAKE::Make(0)));
+		return ok;
+	}
+
+	/// the chained table HashTable used to be: a fixed number of sorted buckets
+	template<class KEYTYPE, class VALUETYPE> class ChainedTable
+	{
+	public:
+		ChainedTable(SizeT capacity) : buckets(capacity), size(0) {}
+		void Add(const KEYTYPE& key, const VALUETYPE& value)
+		{
+			this->buckets[key.HashCode() % this->buckets.Size()].InsertSorted(KeyValuePair<KEYTYPE, VALUETYPE>(key, value));
+			this->size++;
+		}
+		bool Contains(const KEYTYPE& key) const
+		{
+			return this->size > 0 && InvalidIndex != this->buckets[key.HashCode() % this->buckets.Size()].BinarySearchIndex(key);
+		}
+		VALUETYPE& operator[](const KEYTYPE& key) const
+		{
+			Array<KeyValuePair<KEYTYPE, VALUETYPE> >& bucket = this->buckets[key.HashCode() % this->buckets.Size()];
+			return bucket.Size() == 1 ? bucket[0].Value() : bucket[bucket.BinarySearchIndex(key)].Value();
+		}
+		void Erase(const KEYTYPE& key)
+		{
+			Array<KeyValuePair<KEYTYPE, VALUETYPE> >& bucket = this->buckets[key.HashCode() % this->buckets.Size()];
+			bucket.EraseIndex(bucket.BinarySearchIndex(key));
+			this->size--;
+		}
+	private:
+		FixedArray<Array<KeyValuePair<KEYTYPE, VALUETYPE> > > buckets;
+		SizeT size;
+	};
+
+	/// seconds for adding all keys, finding them, missing as many and erasing them
+	template<class TABLE, class KEY> void timeTable(TABLE& table, const Array<KEY>& keys, const Array<KEY>& missing, double* seconds, int& checksum)
+	{
+		Timer timer;
+		SizeT i;
+		for (i = 0; i < keys.Size(); i++) table.Add(keys[i], (int)i);
+		seconds[0] += timer.getElapsedSeconds();
+		for (i = 0; i < keys.Size(); i++) checksum += table[keys[i]];
+		seconds[1] += timer.getElapsedSeconds();
+		for (i = 0; i < missing.Size(); i++) checksum += table.Contains(missing[i]) ? 1 : 0;
+		seconds[2] += timer.getElapsedSeconds();
+		for (i = 0; i < keys.Size(); i++) table.Erase(keys[i]);
+		seconds[3] += timer.getElapsedSeconds();
+	}
+
+	template<class KEY, class MAKE> void timeTables(const char* name)
+	{
+		Array<KEY> keys, missing;
+		for (int k = 0; k < HASHTABLE_TIMING_KEYS; k++)
+		{
+			keys.Append(MAKE::Make(k * 7));
+			missing.Append(MAKE::Make(k * 7 + 3));
+		}
+		double robinHood[4] = { 0, 0, 0, 0 }, chained[4] = { 0, 0, 0, 0 }, chainedSized[4] = { 0, 0, 0, 0 };
+		int robinHoodSum = 0, chainedSum = 0, chainedSizedSum = 0;
+		for (int round = 0; round < HASHTABLE_TIMING_ROUNDS; round++)
+		{
+			HashTable<KEY, int> table;
+			ChainedTable<KEY, int> old(128), oldSized(HASHTABLE_TIMING_KEYS);
+			timeTable(table, keys, missing, robinHood, robinHoodSum);
+			timeTable(old, keys, missing, chained, chainedSum);
+			timeTable(oldSized, keys, missing, chainedSized, chainedSizedSum);
+		}
+		const double scale = 1e9 / ((double)HASHTABLE_TIMING_KEYS * HASHTABLE_TIMING_ROUNDS);
+		printf("  %s keys, ns per add / find / miss / erase of %d:\n", name, HASHTABLE_TIMING_KEYS);
+		printf("    robin hood          %6.1f %6.1f %6.1f %6.1f\n", robinHood[0] * scale, robinHood[1] * scale, robinHood[2] * scale, robinHood[3] * scale);
+		printf("    chained, 128        %6.1f %6.1f %6.1f %6.1f\n", chained[0] * scale, chained[1] * scale, chained[2] * scale, chained[3] * scale);
+		printf("    chained, %-10d %6.1f %6.1f %6.1f %6.1f\n", HASHTABLE_TIMING_KEYS, chainedSized[0] * scale, chainedSized[1] * scale,
+			chainedSized[2] * scale, chainedSized[3] * scale);
+		if (robinHoodSum != chainedSum || chainedSum != chainedSizedSum) printf("    checksums differ\n");
+	}
+}
+
+bool testHashTable()
+{
+	bool ok = true;
+
+	// well spread, clustered and colliding hash codes, with and without cached hashes
+	{
+		HashTable<String, int> table;
+		TEST_CHECK((checkTable<HashTable<String, int>, MakeString>(table, HASHTABLE_NUM_KEYS)));
+	}
+	{
+		HashTable<SpreadKey, int, false> table;
+		TEST_CHECK((checkTable<HashTable<SpreadKey, int, false>, MakeMasked<SpreadKey> >(table, HASHTABLE_NUM_KEYS)));
+	}
+	{
+		HashTable<ClusteredKey, int> table;
+		TEST_CHECK((checkTable<HashTable<ClusteredKey, int>, MakeMasked<ClusteredKey> >(table, HASHTABLE_NUM_KEYS / 4)));
+	}
+	{
+		HashTable<CollidingKey, int, false> table;
+		TEST_CHECK((checkTable<HashTable<CollidingKey, int, false>, MakeMasked<CollidingKey> >(table, 300)));
+	}
+
+	// growth keeps every element, a reserved table does not grow until it is full
+	{
+		HashTable<SpreadKey, int> table;
+		TEST_CHECK(table.Capacity() == 0 && !table.Contains(SpreadKey(1)));
+		SizeT lastCapacity = 0;
+		int numGrowths = 0, numWrong = 0, k;
+		for (k = 0; k < HASHTABLE_NUM_KEYS; k++)
+		{
+			table.Add(SpreadKey(k), k);
+			if (table.Capacity() != lastCapacity)
+			{
+				numGrowths++;
+				lastCapacity = table.Capacity();
+				for (int i = 0; i <= k; i++)
+				{
+					if (!table.Contains(SpreadKey(i)) || table[SpreadKey(i)] != i) numWrong++;
+				}
+			}
+		}
+		TEST_CHECK(numWrong == 0 && numGrowths > 5);
+		TEST_CHECK(table.Size() * 8 <= table.Capacity() * 7);
+
+		HashTable<SpreadKey, int> reserved(HASHTABLE_NUM_KEYS);
+		const SizeT capacity = reserved.Capacity();
+		for (k = 0; k < HASHTABLE_NUM_KEYS; k++)
+		{
+			reserved.Add(SpreadKey(k), k);
+		}
+		TEST_CHECK(reserved.Capacity() == capacity);
+		reserved.Reserve(HASHTABLE_NUM_KEYS * 4);
+		TEST_CHECK(reserved.Capacity() > capacity && reserved.Size() == (SizeT)HASHTABLE_NUM_KEYS && reserved[SpreadKey(77)] == 77);
+	}
+
+	// backward shift deletion leaves no tombstones: erasing and adding at a constant size never grows the table
+	{
+		HashTable<ClusteredKey, int> table;
+		const int numLive = 200;
+		int k;
+		for (k = 0; k < numLive; k++)
+		{
+			table.Add(ClusteredKey(k), k);
+		}
+		const SizeT capacity = table.Capacity();
+		int numWrong = 0;
+		for (k = numLive; k < numLive * 50; k++)
+		{
+			table.Erase(ClusteredKey(k - numLive));
+			table.Add(ClusteredKey(k), k);
+			if (k % 97 == 0)
+			{
+				for (int i = k - numLive + 1; i <= k; i++)
+				{
+					if (!table.Contains(ClusteredKey(i))) numWrong++;
+				}
+				if (table.Contains(ClusteredKey(k - numLive))) numWrong++;
+			}
+		}
+		TEST_CHECK(numWrong == 0);
+		TEST_CHECK(table.Capacity() == capacity && table.Size() == (SizeT)numLive);
+	}
+
+	// timing against the chained table, with its default 128 buckets and with a bucket per key
+	timeTables<String, MakeString>("String");
+	timeTables<SpreadKey, MakeMasked<SpreadKey> >("integer");
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,218 @@
+
+#include "consoleTest.h"
+#include "core/jobsystem.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// JobSystem with worker threads: trees of child jobs created by running jobs, ParallelFor over
+// counts which don't split evenly, and Wait() called by jobs on worker threads.
+namespace
+{
+	const SizeT JOB_TEST_WORKERS		= 3;
+	const int JOB_TREE_DEPTH			= 4;
+	const int JOB_TREE_FANOUT			= 5;
+	const int JOB_TREE_NODES			= 1 + 5 + 25 + 125 + 625;
+	const int JOB_WORKER_WAITS			= 16;
+	const int JOB_TIMING_COUNT			= 200000;
+
+	/// a job which creates JOB_TREE_FANOUT children of its own until JOB_TREE_DEPTH
+	struct TreeNode
+	{
+		Job* job;
+		int depth;
+		volatile LONG numRuns;
+	};
+
+	struct TreeData
+	{
+		TreeNode nodes[JOB_TREE_NODES];
+		volatile LONG numNodes;
+	};
+
+	TreeData* treeData = 0;
+
+	void treeJob(void* data, IndexT, SizeT)
+	{
+		TreeNode* node = (TreeNode*)data;
+		InterlockedIncrement(&node->numRuns);
+		if (node->depth == JOB_TREE_DEPTH) return;
+
+		JobSystem* jobSystem = JobSystem::getSingleton();
+		for (int c = 0; c < JOB_TREE_FANOUT; c++)
+		{
+			TreeNode* child = &treeData->nodes[InterlockedIncrement(&treeData->numNodes) - 1];
+			child->depth = node->depth + 1;
+			child->job = jobSystem->CreateChildJob(node->job, treeJob, child, "treeJob");
+			jobSystem->Run(child->job);
+		}
+	}
+
+	// every index of a ParallelFor range is counted
+	void countJob(void* data, IndexT first, SizeT count)
+	{
+		volatile LONG* visits = (volatile LONG*)data;
+		for (IndexT i = first; i < first + count; i++)
+		{
+			InterlockedIncrement(&visits[i]);
+		}
+	}
+
+	void countElement(int& element, void*)
+	{
+		element++;
+	}
+
+	void emptyJob(void*, IndexT, SizeT)
+	{
+	}
+
+	/// a job which waits for jobs of its own on the thread it runs on
+	struct WaitData
+	{
+		IndexT threadIndex;
+		volatile LONG sum;
+		volatile LONG visits[100];
+	};
+
+	void sumJob(void* data, IndexT first, SizeT count)
+	{
+		WaitData* waitData = (WaitData*)data;
+		InterlockedExchangeAdd(&waitData->sum, (LONG)first);
+	}
+
+	void waitingJob(void* data, IndexT, SizeT)
+	{
+		WaitData* waitData = (WaitData*)data;
+		JobSystem* jobSystem = JobSystem::getSingleton();
+		waitData->threadIndex = jobSystem->GetThreadIndex();
+
+		// a job with children waited for explicitly, then a ParallelFor which waits inside
+		Job* parent = jobSystem->CreateJob(sumJob, waitData, 0, 1, "waitParent");
+		for (IndexT c = 1; c <= 10; c++)
+		{
+			jobSystem->Run(jobSystem->CreateChildJob(parent, sumJob, waitData, c, 1, "waitChild"));
+		}
+		jobSystem->Run(parent);
+		jobSystem->Wait(parent);
+		jobSystem->ParallelFor(100, countJob, (void*)waitData->visits, 7, "waitFor");
+	}
+
+	// enough work per index to be worth spreading
+	void workJob(void* data, IndexT first, SizeT count)
+	{
+		float* results = (float*)data;
+		for (IndexT i = first; i < first + count; i++)
+		{
+			float x = (float)i;
+			for (int k = 0; k < 50; k++)
+			{
+				x = x * 0.999f + 1.0f / (1.0f + x);
+			}
+			results[i] = x;
+		}
+	}
+}
+
+bool testJobSystem()
+{
+	bool ok = true;
+
+	JobSystem* jobSystem = ph_new(JobSystem);
+	jobSystem->Setup(JOB_TEST_WORKERS);
+	TEST_CHECK(jobSystem->GetNumThreads() == JOB_TEST_WORKERS + 1 && jobSystem->GetThreadIndex() == 0);
+
+	// a parent is only finished after all its descendants, each of them ran once
+	treeData = ph_new(TreeData);
+	memset(treeData, 0, sizeof(TreeData));
+	treeData->numNodes = 1;
+	TreeNode* root = &treeData->nodes[0];
+	root->job = jobSystem->CreateJob(treeJob, root, "treeJob");
+	jobSystem->Run(root->job);
+	jobSystem->Wait(root->job);
+	TEST_CHECK(treeData->numNodes == JOB_TREE_NODES);
+	int numTreeErrors = 0;
+	int i;
+	for (i = 0; i < JOB_TREE_NODES; i++)
+	{
+		const TreeNode& node = treeData->nodes[i];
+		if (node.numRuns != 1 || !jobSystem->IsFinished(node.job)) numTreeErrors++;
+	}
+	TEST_CHECK(numTreeErrors == 0);
+	ph_delete(treeData);
+	treeData = 0;
+
+	// counts and grain sizes which leave a short last piece, every index is visited exactly once
+	const SizeT counts[] = { 1, 2, 3, 7, 17, 1000, 4097, 100003 };
+	const SizeT grains[] = { 0, 1, 3, 64 };
+	volatile LONG* visits = (volatile LONG*)Memory::Alloc(Memory::DefaultHeap, 100003 * sizeof(LONG));
+	int numVisitErrors = 0;
+	for (int c = 0; c < (int)(sizeof(counts) / sizeof(counts[0])); c++)
+	{
+		for (int g = 0; g < (int)(sizeof(grains) / sizeof(grains[0])); g++)
+		{
+			memset((void*)visits, 0, counts[c] * sizeof(LONG));
+			jobSystem->ParallelFor(counts[c], countJob, (void*)visits, grains[g], "countJob");
+			for (i = 0; i < counts[c]; i++)
+			{
+				if (visits[i] != 1) numVisitErrors++;
+			}
+		}
+	}
+	TEST_CHECK(numVisitErrors == 0);
+	Memory::Free(Memory::DefaultHeap, (void*)visits);
+	Array<int> elements;
+	elements.Resize(1001);
+	jobSystem->ParallelFor(elements, countElement, 0, 0, "countElement");
+	int numElementErrors = 0;
+	for (i = 0; i < (int)elements.Size(); i++)
+	{
+		if (elements[i] != 1) numElementErrors++;
+	}
+	TEST_CHECK(numElementErrors == 0);
+
+	// the calling thread only watches, the jobs and everything they wait for run on the workers
+	WaitData* waitData = ph_new_array(WaitData, JOB_WORKER_WAITS);
+	memset(waitData, 0, JOB_WORKER_WAITS * sizeof(WaitData));
+	Job* waiters = jobSystem->CreateJob(emptyJob, 0, "waiters");
+	for (i = 0; i < JOB_WORKER_WAITS; i++)
+	{
+		jobSystem->Run(jobSystem->CreateChildJob(waiters, waitingJob, &waitData[i], "waitingJob"));
+	}
+	jobSystem->Run(waiters);
+	while (!jobSystem->IsFinished(waiters))
+	{
+		SwitchToThread();
+	}
+	int numWaitErrors = 0;
+	for (i = 0; i < JOB_WORKER_WAITS; i++)
+	{
+		if (waitData[i].threadIndex == 0 || waitData[i].sum != 10 * 11 / 2) numWaitErrors++;
+		for (int k = 0; k < 100; k++)
+		{
+			if (waitData[i].visits[k] != 1) numWaitErrors++;
+		}
+	}
+	TEST_CHECK(numWaitErrors == 0);
+	ph_delete_array(waitData);
+
+	// timing against the calling thread alone
+	float* results = (float*)Memory::Alloc(Memory::DefaultHeap, JOB_TIMING_COUNT * sizeof(float));
+	float* serialResults = (float*)Memory::Alloc(Memory::DefaultHeap, JOB_TIMING_COUNT * sizeof(float));
+	Timer timer;
+	jobSystem->ParallelFor(JOB_TIMING_COUNT, workJob, results, 0, "workJob");
+	const double parallelSeconds = timer.getElapsedSeconds();
+	workJob(serialResults, 0, JOB_TIMING_COUNT);
+	const double serialSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(memcmp(results, serialResults, JOB_TIMING_COUNT * sizeof(float)) == 0);
+	printf("  %d threads: ParallelFor over %d indices %.2f ms, one thread %.2f ms\n",
+		(int)jobSystem->GetNumThreads(), JOB_TIMING_COUNT, parallelSeconds * 1000.0, serialSeconds * 1000.0);
+	Memory::Free(Memory::DefaultHeap, results);
+	Memory::Free(Memory::DefaultHeap, serialResults);
+
+	jobSystem->Discard();
+	ph_delete(jobSystem);
+	return ok;
+}
+
+_NAMESPACE_END
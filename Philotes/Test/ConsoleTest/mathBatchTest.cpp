@@ -0,0 +1,209 @@
+
+#include "consoleTest.h"
+#include "math/mathBatch.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// every MathBatch kernel against the per-element loop it replaces.
+namespace
+{
+	const size_t BATCH_TEST_MAX_COUNT	= 37;		// covers every remainder of the 4-wide loops
+	const size_t BATCH_TIMING_COUNT		= 100000;
+	const int BATCH_TIMING_REPEAT		= 20;
+
+	uint32 batchTestSeed = 7;
+
+	scalar randomScalar()
+	{
+		batchTestSeed = batchTestSeed * 1664525 + 1013904223;
+		return (scalar)(batchTestSeed >> 8) / (scalar)(1 << 24) * 4.0f - 2.0f;
+	}
+
+	Vector3 randomVector()
+	{
+		const scalar x = randomScalar();
+		const scalar y = randomScalar();
+		return Vector3(x, y, randomScalar());
+	}
+
+	struct Vertex
+	{
+		Vector3	position;
+		Vector3	normal;
+		scalar	uv[2];
+	};
+
+	bool nearlyEqual(const Vector3& a, const Vector3& b)
+	{
+		return (a - b).length() <= 1e-5f * (1.0f + b.length());
+	}
+
+	Vector3 transformNormal(const Matrix4& m, const Vector3& v)
+	{
+		return Vector3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+					   m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+					   m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+	}
+
+	bool boxEquals(const AxisAlignedBox& a, const AxisAlignedBox& b)
+	{
+		if (a.isNull() || b.isNull()) return a.isNull() == b.isNull();
+		if (a.isInfinite() || b.isInfinite()) return a.isInfinite() == b.isInfinite();
+		return nearlyEqual(a.getMinimum(), b.getMinimum()) && nearlyEqual(a.getMaximum(), b.getMaximum());
+	}
+}
+
+bool testMathBatch()
+{
+	bool ok = true;
+
+	Matrix4 xform = Matrix4::IDENTITY;
+	for (int r = 0; r < 3; r++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			xform[r][c] = randomScalar();
+		}
+	}
+
+	int numPointErrors = 0, numNormalErrors = 0, numNormaliseErrors = 0, numBoundsErrors = 0, numBoxErrors = 0;
+	for (size_t count = 0; count <= BATCH_TEST_MAX_COUNT; count++)
+	{
+		Vector3 points[BATCH_TEST_MAX_COUNT], result[BATCH_TEST_MAX_COUNT];
+		Vertex vertices[BATCH_TEST_MAX_COUNT];
+		scalar x[BATCH_TEST_MAX_COUNT], y[BATCH_TEST_MAX_COUNT], z[BATCH_TEST_MAX_COUNT];
+		scalar rx[BATCH_TEST_MAX_COUNT], ry[BATCH_TEST_MAX_COUNT], rz[BATCH_TEST_MAX_COUNT];
+		size_t i;
+		for (i = 0; i < count; i++)
+		{
+			points[i] = randomVector();
+			vertices[i].position = points[i];
+			vertices[i].normal = randomVector();
+			x[i] = points[i].x;
+			y[i] = points[i].y;
+			z[i] = points[i].z;
+		}
+		// a zero vector, normalise() leaves it alone
+		if (count > 3) vertices[3].normal = Vector3::ZERO;
+
+		// packed and strided points
+		MathBatch::transformPoints(xform, points, result, count);
+		for (i = 0; i < count; i++)
+		{
+			if (!nearlyEqual(result[i], xform.transformAffine(points[i]))) numPointErrors++;
+		}
+		MathBatch::transformPoints(xform, &vertices[0].position, result, count, sizeof(Vertex));
+		for (i = 0; i < count; i++)
+		{
+			if (!nearlyEqual(result[i], xform.transformAffine(points[i]))) numPointErrors++;
+		}
+		MathBatch::transformPoints(xform, x, y, z, rx, ry, rz, count);
+		for (i = 0; i < count; i++)
+		{
+			if (!nearlyEqual(Vector3(rx[i], ry[i], rz[i]), xform.transformAffine(points[i]))) numPointErrors++;
+		}
+
+		// normals
+		MathBatch::transformNormals(xform, &vertices[0].normal, result, count, sizeof(Vertex));
+		for (i = 0; i < count; i++)
+		{
+			if (!nearlyEqual(result[i], transformNormal(xform, vertices[i].normal))) numNormalErrors++;
+		}
+		MathBatch::transformNormals(xform, x, y, z, rx, ry, rz, count);
+		for (i = 0; i < count; i++)
+		{
+			if (!nearlyEqual(Vector3(rx[i], ry[i], rz[i]), transformNormal(xform, points[i]))) numNormalErrors++;
+		}
+
+		// in place, every other vertex
+		Vertex normalised[BATCH_TEST_MAX_COUNT];
+		memcpy(normalised, vertices, sizeof(vertices));
+		MathBatch::normalise(&normalised[0].normal, (count + 1) / 2, 2 * sizeof(Vertex));
+		for (i = 0; i < count; i++)
+		{
+			Vector3 expected = vertices[i].normal;
+			if (i % 2 == 0) expected.normalise();
+			if (!nearlyEqual(normalised[i].normal, expected)) numNormaliseErrors++;
+		}
+
+		// bounds
+		AxisAlignedBox expectedBounds;
+		for (i = 0; i < count; i++)
+		{
+			expectedBounds.merge(points[i]);
+		}
+		if (!boxEquals(MathBatch::computeBounds(points, count), expectedBounds)) numBoundsErrors++;
+		if (!boxEquals(MathBatch::computeBounds(&vertices[0].position, count, sizeof(Vertex)), expectedBounds)) numBoundsErrors++;
+
+		// boxes, including null and infinite ones
+		AxisAlignedBox boxes[BATCH_TEST_MAX_COUNT], transformed[BATCH_TEST_MAX_COUNT];
+		for (i = 0; i < count; i++)
+		{
+			if (i % 7 == 1)			boxes[i].setNull();
+			else if (i % 7 == 2)	boxes[i].setInfinite();
+			else					boxes[i].setExtents(points[i], points[i] + Vector3(1.0f, 2.0f, 0.5f));
+		}
+		MathBatch::transformBoxes(xform, boxes, transformed, count);
+		for (i = 0; i < count; i++)
+		{
+			AxisAlignedBox expected = boxes[i];
+			expected.transformAffine(xform);
+			if (!boxEquals(transformed[i], expected)) numBoxErrors++;
+		}
+	}
+	TEST_CHECK(numPointErrors == 0);
+	TEST_CHECK(numNormalErrors == 0);
+	TEST_CHECK(numNormaliseErrors == 0);
+	TEST_CHECK(numBoundsErrors == 0);
+	TEST_CHECK(numBoxErrors == 0);
+
+	// timings against the loops
+	Array<Vector3> source, target;
+	source.Reserve(BATCH_TIMING_COUNT);
+	for (size_t i = 0; i < BATCH_TIMING_COUNT; i++)
+	{
+		source.Append(randomVector());
+	}
+	target.Resize(BATCH_TIMING_COUNT);
+
+	Timer timer;
+	for (int repeat = 0; repeat < BATCH_TIMING_REPEAT; repeat++)
+	{
+		MathBatch::transformPoints(xform, source.Begin(), target.Begin(), BATCH_TIMING_COUNT);
+	}
+	const double batchPoints = timer.getElapsedSeconds();
+	for (int repeat = 0; repeat < BATCH_TIMING_REPEAT; repeat++)
+	{
+		for (size_t i = 0; i < BATCH_TIMING_COUNT; i++)
+		{
+			target[i] = xform.transformAffine(source[i]);
+		}
+	}
+	const double loopPoints = timer.getElapsedSeconds();
+
+	AxisAlignedBox bounds;
+	for (int repeat = 0; repeat < BATCH_TIMING_REPEAT; repeat++)
+	{
+		bounds = MathBatch::computeBounds(source.Begin(), BATCH_TIMING_COUNT);
+	}
+	const double batchBounds = timer.getElapsedSeconds();
+	AxisAlignedBox loopBounds;
+	for (int repeat = 0; repeat < BATCH_TIMING_REPEAT; repeat++)
+	{
+		loopBounds.setNull();
+		for (size_t i = 0; i < BATCH_TIMING_COUNT; i++)
+		{
+			loopBounds.merge(source[i]);
+		}
+	}
+	const double loopBoundsTime = timer.getElapsedSeconds();
+	TEST_CHECK(boxEquals(bounds, loopBounds));
+
+	printf("  %d x %d points: transformPoints %.2f ms, loop %.2f ms\n", BATCH_TIMING_REPEAT, (int)BATCH_TIMING_COUNT, batchPoints * 1000.0, loopPoints * 1000.0);
+	printf("  %d x %d points: computeBounds %.2f ms, loop %.2f ms\n", BATCH_TIMING_REPEAT, (int)BATCH_TIMING_COUNT, batchBounds * 1000.0, loopBoundsTime * 1000.0);
+
+	return ok;
+}
+
+_NAMESPACE_END
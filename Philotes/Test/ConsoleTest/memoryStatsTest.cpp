@@ -0,0 +1,130 @@
+
+#include "consoleTest.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the counters, call sites and JSON snapshot of the tracked heaps, and what tracking costs per
+// allocation against calling the Win32 heap directly, which is all Memory::Alloc() does without it.
+namespace
+{
+	const int MEMORY_STATS_NUM_BLOCKS		= 20000;
+	const int MEMORY_STATS_TIMING_ROUNDS	= 20;
+
+	uint32 memoryStatsTestSeed = 19;
+
+	uint32 randomInt(uint32 range)
+	{
+		memoryStatsTestSeed = memoryStatsTestSeed * 1664525 + 1013904223;
+		return (memoryStatsTestSeed >> 8) % range;
+	}
+
+	// the JSON entry of a call site in this file
+	String siteJson(int line, SizeT count, SizeT bytes)
+	{
+		String json = "{\"file\":\"";
+		for (const char* c = __FILE__; *c; c++)
+		{
+			if ('\\' == *c || '"' == *c) json.AppendRange("\\", 1);
+			json.AppendRange(c, 1);
+		}
+		String counters;
+		counters.Format("\",\"line\":%d,\"count\":%d,\"bytes\":%d}", line, count, bytes);
+		json.Append(counters);
+		return json;
+	}
+}
+
+bool testMemoryStats()
+{
+	bool ok = true;
+
+#if PH_MEMORY_STATS
+	// live and peak bytes follow the blocks exactly, every heap call is counted for the frame
+	Memory::NewFrame();
+	const Memory::HeapStats before = Memory::GetHeapStats(Memory::GearsHeap);
+	void* blocks[3];
+	const int line = __LINE__ + 3;
+	for (int b = 0; b < 3; b++)
+	{
+		blocks[b] = ph_malloc(Memory::GearsHeap, 100 + b);
+	}
+	Memory::HeapStats stats = Memory::GetHeapStats(Memory::GearsHeap);
+	TEST_CHECK(stats.liveBytes == before.liveBytes + 303 && stats.liveAllocs == before.liveAllocs + 3);
+	TEST_CHECK(stats.totalAllocs == before.totalAllocs + 3 && stats.frameAllocs == before.frameAllocs + 3);
+	TEST_CHECK(stats.peakBytes >= stats.liveBytes);
+
+	// the blocks show up under their call site until they are freed
+	String json;
+	Memory::GetJsonSnapshot(json);
+	TEST_CHECK(json.FindStringIndex(siteJson(line, 3, 303)) != InvalidIndex);
+	blocks[1] = Memory::Realloc(Memory::GearsHeap, blocks[1], 1000);
+	Memory::GetJsonSnapshot(json);
+	TEST_CHECK(json.FindStringIndex(siteJson(line, 3, 1202)) != InvalidIndex);
+	const SizeT peak = Memory::GetHeapStats(Memory::GearsHeap).peakBytes;
+	for (int b = 0; b < 3; b++)
+	{
+		ph_free(Memory::GearsHeap, blocks[b]);
+	}
+	stats = Memory::GetHeapStats(Memory::GearsHeap);
+	TEST_CHECK(stats.liveBytes == before.liveBytes && stats.liveAllocs == before.liveAllocs && stats.peakBytes == peak);
+	Memory::GetJsonSnapshot(json);
+	TEST_CHECK(json.FindStringIndex(siteJson(line, 3, 1202)) == InvalidIndex);
+
+	// a new frame starts counting from zero and keeps the count of the last one
+	const SizeT frameAllocs = stats.frameAllocs;
+	Memory::NewFrame();
+	stats = Memory::GetHeapStats(Memory::GearsHeap);
+	TEST_CHECK(stats.lastFrameAllocs == frameAllocs && stats.frameAllocs == 0);
+
+	// timing: tracked allocations in mixed sizes against the heap calls alone
+	void** tracked = (void**)HeapAlloc(GetProcessHeap(), 0, MEMORY_STATS_NUM_BLOCKS * sizeof(void*));
+	SizeT* sizes = (SizeT*)HeapAlloc(GetProcessHeap(), 0, MEMORY_STATS_NUM_BLOCKS * sizeof(SizeT));
+	int i;
+	for (i = 0; i < MEMORY_STATS_NUM_BLOCKS; i++)
+	{
+		sizes[i] = 16 + randomInt(240);
+	}
+	HANDLE heap = HeapCreate(0, 0, 0);
+	Timer timer;
+	int round;
+	for (round = 0; round < MEMORY_STATS_TIMING_ROUNDS; round++)
+	{
+		for (i = 0; i < MEMORY_STATS_NUM_BLOCKS; i++)
+		{
+			tracked[i] = ph_malloc(Memory::GearsHeap, sizes[i]);
+		}
+		for (i = 0; i < MEMORY_STATS_NUM_BLOCKS; i++)
+		{
+			ph_free(Memory::GearsHeap, tracked[i]);
+		}
+	}
+	const double trackedSeconds = timer.getElapsedSeconds();
+	for (round = 0; round < MEMORY_STATS_TIMING_ROUNDS; round++)
+	{
+		for (i = 0; i < MEMORY_STATS_NUM_BLOCKS; i++)
+		{
+			tracked[i] = HeapAlloc(heap, 0, sizes[i]);
+		}
+		for (i = 0; i < MEMORY_STATS_NUM_BLOCKS; i++)
+		{
+			HeapFree(heap, 0, tracked[i]);
+		}
+	}
+	const double untrackedSeconds = timer.getElapsedSeconds();
+	HeapDestroy(heap);
+	HeapFree(GetProcessHeap(), 0, tracked);
+	HeapFree(GetProcessHeap(), 0, sizes);
+	stats = Memory::GetHeapStats(Memory::GearsHeap);
+	TEST_CHECK(stats.liveAllocs == before.liveAllocs && stats.frameAllocs == (SizeT)(MEMORY_STATS_NUM_BLOCKS * MEMORY_STATS_TIMING_ROUNDS));
+	const double numBlocks = (double)MEMORY_STATS_NUM_BLOCKS * MEMORY_STATS_TIMING_ROUNDS;
+	printf("  per alloc and free: tracked %.1f ns, heap alone %.1f ns, snapshot of %d bytes\n",
+		trackedSeconds * 1e9 / numBlocks, untrackedSeconds * 1e9 / numBlocks, json.Length());
+#else
+	printf("  PH_MEMORY_STATS is disabled, Memory::Alloc() calls the heap directly\n");
+#endif
+
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,211 @@
+
+#include "consoleTest.h"
+#include "sceneTestElement.h"
+#include "renderOctree.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the queries of RenderOctree against testing every element, while elements move, leave and come back.
+namespace
+{
+	const int OCTREE_NUM_ELEMENTS	= 3000;
+	const int OCTREE_NUM_FRAMES		= 30;
+	const int OCTREE_NUM_QUERIES	= 20;
+	const int OCTREE_TIMING_QUERIES	= 1000;
+
+	uint32 octreeTestSeed = 5;
+
+	scalar randomUnit()
+	{
+		octreeTestSeed = octreeTestSeed * 1664525 + 1013904223;
+		return (scalar)(octreeTestSeed >> 8) / (scalar)(1 << 24);
+	}
+
+	Vector3 randomVector(scalar minimum, scalar maximum)
+	{
+		const scalar x = minimum + (maximum - minimum) * randomUnit();
+		const scalar y = minimum + (maximum - minimum) * randomUnit();
+		return Vector3(x, y, minimum + (maximum - minimum) * randomUnit());
+	}
+
+	// the same box as 6 planes
+	PlaneBoundedVolume boxVolume(const AxisAlignedBox& box)
+	{
+		PlaneBoundedVolume volume(Plane::NEGATIVE_SIDE);
+		volume.planes.push_back(Plane(Vector3::UNIT_X, box.getMinimum()));
+		volume.planes.push_back(Plane(Vector3::NEGATIVE_UNIT_X, box.getMaximum()));
+		volume.planes.push_back(Plane(Vector3::UNIT_Y, box.getMinimum()));
+		volume.planes.push_back(Plane(Vector3::NEGATIVE_UNIT_Y, box.getMaximum()));
+		volume.planes.push_back(Plane(Vector3::UNIT_Z, box.getMinimum()));
+		volume.planes.push_back(Plane(Vector3::NEGATIVE_UNIT_Z, box.getMaximum()));
+		return volume;
+	}
+
+	bool contains(const Array<RenderTransformElement*>& result, RenderTransformElement* element)
+	{
+		return result.FindIndex(element) != InvalidIndex;
+	}
+
+	// the number of queries whose results differ from testing every element in the octree
+	int countQueryErrors(const RenderOctree& octree, Array<SceneTestElement*>& elements)
+	{
+		int numErrors = 0;
+		for (int query = 0; query < OCTREE_NUM_QUERIES; query++)
+		{
+			const Vector3 center = randomVector(-100.0f, 100.0f);
+			const Vector3 halfSize = randomVector(0.0f, 40.0f);
+			const AxisAlignedBox box(center - halfSize, center + halfSize);
+			const Sphere sphere(center, randomUnit() * 50.0f);
+			const PlaneBoundedVolume volume = boxVolume(box);
+			const Ray ray(Vector3(-150.0f, center.y, center.z), Vector3(1.0f, randomUnit() - 0.5f, randomUnit() - 0.5f).normalisedCopy());
+
+			Array<RenderTransformElement*> boxResult, sphereResult, volumeResult;
+			Array<RenderOctree::RayHit> rayResult;
+			octree.findIntersecting(box, boxResult);
+			octree.findIntersecting(sphere, sphereResult);
+			octree.findIntersecting(volume, volumeResult);
+			octree.findIntersecting(ray, rayResult);
+
+			SizeT numBox = 0, numSphere = 0, numRay = 0;
+			bool found = true;
+			for (SizeT i = 0; i < elements.Size(); i++)
+			{
+				SceneTestElement* element = elements[i];
+				if (!element->getOctree()) continue;
+				const AxisAlignedBox& bounds = element->getWorldBoundingBox();
+				if (bounds.intersects(box))
+				{
+					numBox++;
+					found = found && contains(boxResult, element) && contains(volumeResult, element);
+				}
+				if (!bounds.isNull() && Math::intersects(sphere, bounds))
+				{
+					numSphere++;
+					found = found && contains(sphereResult, element);
+				}
+				if (Math::intersects(ray, bounds).first) numRay++;
+			}
+			bool sorted = true;
+			for (SizeT k = 1; k < rayResult.Size(); k++)
+			{
+				sorted = sorted && rayResult[k - 1].distance <= rayResult[k].distance;
+			}
+			if (!found || !sorted || numBox != boxResult.Size() || numBox != volumeResult.Size() ||
+				numSphere != sphereResult.Size() || numRay != rayResult.Size())
+			{
+				numErrors++;
+			}
+		}
+		return numErrors;
+	}
+
+	bool testOctree(bool flat)
+	{
+		bool ok = true;
+
+		RenderOctree* octree = ph_new(RenderOctree)(AxisAlignedBox(-100, -100, -100, 100, 100, 100), 5, flat);
+		RenderTransform* node = ph_new(RenderTransform)("octreeTest");
+		Array<SceneTestElement*> elements;
+		int i;
+
+		// some elements lie outside the world bounds, some are infinite or null
+		for (i = 0; i < OCTREE_NUM_ELEMENTS; i++)
+		{
+			SceneTestElement* element = ph_new(SceneTestElement)(String::FromInt(i));
+			const Vector3 center = randomVector(-130.0f, 130.0f);
+			const Vector3 halfSize(randomUnit() * randomUnit() * 20.0f, randomUnit() * randomUnit() * 20.0f, randomUnit() * randomUnit() * 20.0f);
+			AxisAlignedBox box(center - halfSize, center + halfSize);
+			if (i % 97 == 0) box.setInfinite();
+			if (i % 89 == 0) box.setNull();
+			element->setBox(box);
+			node->attachObject(element);
+			octree->add(element);
+			elements.Append(element);
+		}
+		TEST_CHECK(octree->size() == (SizeT)OCTREE_NUM_ELEMENTS);
+
+		int numQueryErrors = 0;
+		for (int frame = 0; frame < OCTREE_NUM_FRAMES; frame++)
+		{
+			// a third of the finite elements move
+			for (i = 0; i < OCTREE_NUM_ELEMENTS; i++)
+			{
+				const AxisAlignedBox& box = elements[i]->getWorldBoundingBox();
+				if (randomUnit() > 0.33f || !box.isFinite()) continue;
+				const Vector3 offset = randomVector(-2.0f, 2.0f);
+				elements[i]->setBox(AxisAlignedBox(box.getMinimum() + offset, box.getMaximum() + offset));
+			}
+			if (frame == 10)
+			{
+				for (i = 0; i < OCTREE_NUM_ELEMENTS; i += 7)
+				{
+					octree->remove(elements[i]->getOctreeHandle());
+					TEST_CHECK(elements[i]->getOctree() == NULL);
+				}
+			}
+			if (frame == 20)
+			{
+				for (i = 0; i < OCTREE_NUM_ELEMENTS; i += 7)
+				{
+					octree->add(elements[i]);
+				}
+				TEST_CHECK(octree->size() == (SizeT)OCTREE_NUM_ELEMENTS);
+			}
+			octree->update();
+			numQueryErrors += countQueryErrors(*octree, elements);
+		}
+		TEST_CHECK(numQueryErrors == 0);
+
+		// timing of box queries against testing every element
+		Array<AxisAlignedBox> boxes;
+		for (i = 0; i < OCTREE_TIMING_QUERIES; i++)
+		{
+			const Vector3 center = randomVector(-100.0f, 100.0f);
+			const Vector3 halfSize = randomVector(0.0f, 20.0f);
+			boxes.Append(AxisAlignedBox(center - halfSize, center + halfSize));
+		}
+		Array<RenderTransformElement*> result;
+		Timer timer;
+		SizeT numOctree = 0;
+		for (i = 0; i < OCTREE_TIMING_QUERIES; i++)
+		{
+			result.Clear();
+			octree->findIntersecting(boxes[i], result);
+			numOctree += result.Size();
+		}
+		const double octreeSeconds = timer.getElapsedSeconds();
+		SizeT numBruteForce = 0;
+		for (i = 0; i < OCTREE_TIMING_QUERIES; i++)
+		{
+			for (int k = 0; k < OCTREE_NUM_ELEMENTS; k++)
+			{
+				if (elements[k]->getWorldBoundingBox().intersects(boxes[i])) numBruteForce++;
+			}
+		}
+		const double bruteForceSeconds = timer.getElapsedSeconds();
+		TEST_CHECK(numOctree == numBruteForce);
+		printf("  %s, %d elements in %d nodes: %d box queries %.2f ms, testing every element %.2f ms\n", flat ? "flat" : "octree",
+			OCTREE_NUM_ELEMENTS, (int)octree->getNumNodes(), OCTREE_TIMING_QUERIES, octreeSeconds * 1000.0, bruteForceSeconds * 1000.0);
+
+		// the node lets go of the elements, the elements leave the octree
+		ph_delete(node);
+		for (i = 0; i < OCTREE_NUM_ELEMENTS; i++)
+		{
+			ph_delete(elements[i]);
+		}
+		TEST_CHECK(octree->size() == 0);
+		ph_delete(octree);
+		return ok;
+	}
+}
+
+bool testRenderOctree()
+{
+	bool ok = true;
+	TEST_CHECK(testOctree(false));
+	TEST_CHECK(testOctree(true));
+	return ok;
+}
+
+_NAMESPACE_END
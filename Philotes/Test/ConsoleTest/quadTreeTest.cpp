@@ -0,0 +1,207 @@
+
+#include "consoleTest.h"
+#include "util/quadtree.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the single and batched queries of QuadTree against testing every element.
+namespace
+{
+	const int QUADTREE_NUM_ELEMENTS		= 3000;
+	const int QUADTREE_NUM_FRAMES		= 30;
+	const int QUADTREE_NUM_QUERIES		= (int)QuadTree<int>::MaxBatchSize + 8;
+	const int QUADTREE_TIMING_ROUNDS	= 50;
+
+	uint32 quadTreeTestSeed = 9;
+
+	scalar randomUnit()
+	{
+		quadTreeTestSeed = quadTreeTestSeed * 1664525 + 1013904223;
+		return (scalar)(quadTreeTestSeed >> 8) / (scalar)(1 << 24);
+	}
+
+	// boxes spread over x and z, flat in y
+	AxisAlignedBox randomBox(scalar range, scalar maxHalfSize)
+	{
+		const Vector3 center((randomUnit() * 2.0f - 1.0f) * range, (randomUnit() * 2.0f - 1.0f) * 12.0f, (randomUnit() * 2.0f - 1.0f) * range);
+		const Vector3 halfSize(randomUnit() * maxHalfSize, randomUnit() * maxHalfSize * 0.25f, randomUnit() * maxHalfSize);
+		return AxisAlignedBox(center - halfSize, center + halfSize);
+	}
+
+	// the same box as 6 planes
+	PlaneBoundedVolume boxVolume(const AxisAlignedBox& box)
+	{
+		PlaneBoundedVolume volume(Plane::NEGATIVE_SIDE);
+		volume.planes.push_back(Plane(Vector3::UNIT_X, box.getMinimum()));
+		volume.planes.push_back(Plane(Vector3::NEGATIVE_UNIT_X, box.getMaximum()));
+		volume.planes.push_back(Plane(Vector3::UNIT_Y, box.getMinimum()));
+		volume.planes.push_back(Plane(Vector3::NEGATIVE_UNIT_Y, box.getMaximum()));
+		volume.planes.push_back(Plane(Vector3::UNIT_Z, box.getMinimum()));
+		volume.planes.push_back(Plane(Vector3::NEGATIVE_UNIT_Z, box.getMaximum()));
+		return volume;
+	}
+}
+
+bool testQuadTree()
+{
+	bool ok = true;
+
+	QuadTree<int>* tree = ph_new(QuadTree<int>);
+	tree->Setup(AxisAlignedBox(-100, -10, -100, 100, 10, 100), 6);
+
+	// node addresses and indices map onto each other
+	bool addressesMatch = true;
+	IndexT node;
+	for (node = 0; node < (IndexT)tree->GetNumNodesInTree(); node++)
+	{
+		uchar level;
+		ushort col, row;
+		tree->GetNodeAddress(node, level, col, row);
+		addressesMatch = addressesMatch && tree->GetNodeIndex(level, col, row) == node;
+	}
+	TEST_CHECK(addressesMatch);
+
+	// some elements lie outside the tree or are higher than it
+	AxisAlignedBox boxes[QUADTREE_NUM_ELEMENTS];
+	IndexT handles[QUADTREE_NUM_ELEMENTS];
+	bool inserted[QUADTREE_NUM_ELEMENTS];
+	int i;
+	for (i = 0; i < QUADTREE_NUM_ELEMENTS; i++)
+	{
+		boxes[i] = randomBox(130.0f, 30.0f * randomUnit());
+		handles[i] = tree->Insert(i, boxes[i]);
+		inserted[i] = true;
+	}
+	TEST_CHECK(tree->GetNumElements() == (SizeT)QUADTREE_NUM_ELEMENTS);
+
+	int numPlacementErrors = 0, numQueryErrors = 0;
+	for (int frame = 0; frame < QUADTREE_NUM_FRAMES; frame++)
+	{
+		// a third of the elements move
+		for (i = 0; i < QUADTREE_NUM_ELEMENTS; i++)
+		{
+			if (!inserted[i] || randomUnit() > 0.33f) continue;
+			const Vector3 offset(randomUnit() * 4.0f - 2.0f, randomUnit() * 0.2f - 0.1f, randomUnit() * 4.0f - 2.0f);
+			boxes[i] = AxisAlignedBox(boxes[i].getMinimum() + offset, boxes[i].getMaximum() + offset);
+			tree->Move(handles[i], boxes[i]);
+		}
+		if (frame == 10)
+		{
+			for (i = 0; i < QUADTREE_NUM_ELEMENTS; i += 7)
+			{
+				tree->Remove(handles[i]);
+				inserted[i] = false;
+			}
+		}
+		if (frame == 20)
+		{
+			for (i = 0; i < QUADTREE_NUM_ELEMENTS; i += 7)
+			{
+				handles[i] = tree->Insert(i, boxes[i]);
+				inserted[i] = true;
+			}
+		}
+
+		// every element lies in the loose bounds of its node, the root takes the others
+		for (i = 0; i < QUADTREE_NUM_ELEMENTS; i++)
+		{
+			if (!inserted[i]) continue;
+			const IndexT elementNode = tree->GetElementNode(handles[i]);
+			if (tree->GetElement(handles[i]) != i) numPlacementErrors++;
+			if (elementNode != 0 && !tree->GetNodeLooseBoundingBox(elementNode).contains(boxes[i])) numPlacementErrors++;
+		}
+
+		// more queries than one batch takes
+		AxisAlignedBox queryBoxes[QUADTREE_NUM_QUERIES];
+		PlaneBoundedVolume queryVolumes[QUADTREE_NUM_QUERIES];
+		Array<int> boxResults[QUADTREE_NUM_QUERIES], volumeResults[QUADTREE_NUM_QUERIES];
+		int query;
+		for (query = 0; query < QUADTREE_NUM_QUERIES; query++)
+		{
+			queryBoxes[query] = randomBox(100.0f, 40.0f);
+			queryVolumes[query] = boxVolume(queryBoxes[query]);
+		}
+		tree->FindIntersecting(queryBoxes, QUADTREE_NUM_QUERIES, boxResults);
+		tree->FindIntersecting(queryVolumes, QUADTREE_NUM_QUERIES, volumeResults);
+		for (query = 0; query < QUADTREE_NUM_QUERIES; query++)
+		{
+			Array<int> boxResult, volumeResult;
+			tree->FindIntersecting(queryBoxes[query], boxResult);
+			tree->FindIntersecting(queryVolumes[query], volumeResult);
+
+			SizeT numIntersecting = 0;
+			bool found = true;
+			for (i = 0; i < QUADTREE_NUM_ELEMENTS; i++)
+			{
+				if (!inserted[i] || !boxes[i].intersects(queryBoxes[query])) continue;
+				numIntersecting++;
+				found = found && boxResult.FindIndex(i) != InvalidIndex && volumeResult.FindIndex(i) != InvalidIndex &&
+						boxResults[query].FindIndex(i) != InvalidIndex && volumeResults[query].FindIndex(i) != InvalidIndex;
+			}
+			if (!found || numIntersecting != boxResult.Size() || numIntersecting != volumeResult.Size() ||
+				numIntersecting != boxResults[query].Size() || numIntersecting != volumeResults[query].Size())
+			{
+				numQueryErrors++;
+			}
+		}
+	}
+	TEST_CHECK(numPlacementErrors == 0);
+	TEST_CHECK(numQueryErrors == 0);
+
+	// timing of a batch against single queries and against testing every element
+	AxisAlignedBox queryBoxes[QuadTree<int>::MaxBatchSize];
+	Array<int> results[QuadTree<int>::MaxBatchSize];
+	const int batchSize = (int)QuadTree<int>::MaxBatchSize;
+	int query;
+	for (query = 0; query < batchSize; query++)
+	{
+		queryBoxes[query] = randomBox(100.0f, 20.0f);
+	}
+	Timer timer;
+	SizeT numBatched = 0;
+	for (int round = 0; round < QUADTREE_TIMING_ROUNDS; round++)
+	{
+		for (query = 0; query < batchSize; query++)
+		{
+			results[query].Clear();
+		}
+		tree->FindIntersecting(queryBoxes, batchSize, results);
+		for (query = 0; query < batchSize; query++)
+		{
+			numBatched += results[query].Size();
+		}
+	}
+	const double batchedSeconds = timer.getElapsedSeconds();
+	SizeT numSingle = 0;
+	for (int round = 0; round < QUADTREE_TIMING_ROUNDS; round++)
+	{
+		for (query = 0; query < batchSize; query++)
+		{
+			results[query].Clear();
+			tree->FindIntersecting(queryBoxes[query], results[query]);
+			numSingle += results[query].Size();
+		}
+	}
+	const double singleSeconds = timer.getElapsedSeconds();
+	SizeT numBruteForce = 0;
+	for (int round = 0; round < QUADTREE_TIMING_ROUNDS; round++)
+	{
+		for (query = 0; query < batchSize; query++)
+		{
+			for (i = 0; i < QUADTREE_NUM_ELEMENTS; i++)
+			{
+				if (boxes[i].intersects(queryBoxes[query])) numBruteForce++;
+			}
+		}
+	}
+	const double bruteForceSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(numBatched == numSingle && numSingle == numBruteForce);
+	printf("  %d elements, %d x %d box queries: batched %.2f ms, single %.2f ms, testing every element %.2f ms\n",
+		QUADTREE_NUM_ELEMENTS, QUADTREE_TIMING_ROUNDS, batchSize, batchedSeconds * 1000.0, singleSeconds * 1000.0, bruteForceSeconds * 1000.0);
+
+	ph_delete(tree);
+	return ok;
+}
+
+_NAMESPACE_END
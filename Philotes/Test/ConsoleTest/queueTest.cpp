@@ -0,0 +1,234 @@
+
+#include "consoleTest.h"
+#include "util/spscqueue.h"
+#include "util/mpmcqueue.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	const LONG QUEUE_TEST_NUM_ITEMS	= 4000000;
+	const SizeT QUEUE_TEST_THREADS	= 4;
+
+	// a side that finds the queue full or empty yields, the other side may need the core.
+
+	struct SpscTestData
+	{
+		SpscQueue<LONG>		queue;
+	};
+
+	// pushes 0 .. QUEUE_TEST_NUM_ITEMS-1 in order, every third round as a batch.
+	DWORD WINAPI spscProducer(LPVOID param)
+	{
+		SpscTestData& data = *(SpscTestData*)param;
+		LONG batch[7];
+		LONG next = 0;
+		for (LONG round = 0; next < QUEUE_TEST_NUM_ITEMS; round++)
+		{
+			if (round % 3 == 0)
+			{
+				SizeT num = 0;
+				while (num < 7 && next + (LONG)num < QUEUE_TEST_NUM_ITEMS)
+				{
+					batch[num] = next + (LONG)num;
+					num++;
+				}
+				const SizeT pushed = data.queue.PushBatch(batch, num);
+				next += (LONG)pushed;
+				if (pushed == 0) SwitchToThread();
+			}
+			else if (data.queue.TryPush(next))
+			{
+				next++;
+			}
+			else
+			{
+				SwitchToThread();
+			}
+		}
+		return 0;
+	}
+
+	struct MpmcTestData
+	{
+		MpmcQueue<LONG>		queue;
+		volatile LONG		numPopped;
+		volatile LONG		nextProducer;
+		uint8*				seen;		// how often each value was popped
+		int64				sums[QUEUE_TEST_THREADS];
+	};
+
+	// producer i pushes i, i+P, i+2P, ... mixing single pushes and batches.
+	DWORD WINAPI mpmcProducer(LPVOID param)
+	{
+		MpmcTestData& data = *(MpmcTestData*)param;
+		const LONG id = InterlockedIncrement(&data.nextProducer) - 1;
+		const LONG count = QUEUE_TEST_NUM_ITEMS / (LONG)QUEUE_TEST_THREADS;
+		LONG i = 0;
+		for (LONG round = 0; i < count; round++)
+		{
+			if (round % 5 == 0)
+			{
+				LONG batch[3];
+				SizeT num = 0;
+				while (num < 3 && i + (LONG)num < count)
+				{
+					batch[num] = (i + (LONG)num) * (LONG)QUEUE_TEST_THREADS + id;
+					num++;
+				}
+				const SizeT pushed = data.queue.PushBatch(batch, num);
+				i += (LONG)pushed;
+				if (pushed == 0) SwitchToThread();
+			}
+			else if (data.queue.TryPush(i * (LONG)QUEUE_TEST_THREADS + id))
+			{
+				i++;
+			}
+			else
+			{
+				SwitchToThread();
+			}
+		}
+		return 0;
+	}
+
+	DWORD WINAPI mpmcConsumer(LPVOID param)
+	{
+		MpmcTestData& data = *(MpmcTestData*)param;
+		const LONG id = InterlockedIncrement(&data.nextProducer) - 1 - (LONG)QUEUE_TEST_THREADS;
+		int64 sum = 0;
+		LONG batch[5];
+		for (LONG round = 0; data.numPopped < QUEUE_TEST_NUM_ITEMS; round++)
+		{
+			SizeT num = 0;
+			if (round & 1)
+			{
+				num = data.queue.PopBatch(batch, 5);
+			}
+			else if (data.queue.TryPop(batch[0]))
+			{
+				num = 1;
+			}
+			for (SizeT k = 0; k < num; k++)
+			{
+				sum += batch[k];
+				data.seen[batch[k]]++;
+			}
+			if (num > 0)
+			{
+				InterlockedExchangeAdd(&data.numPopped, (LONG)num);
+			}
+			else
+			{
+				SwitchToThread();
+			}
+		}
+		data.sums[id] = sum;
+		return 0;
+	}
+}
+
+bool testSpscQueue()
+{
+	bool ok = true;
+
+	SpscTestData* data = ph_new(SpscTestData);
+	data->queue.SetCapacity(1000);
+	TEST_CHECK(data->queue.Capacity() == 1024);
+	TEST_CHECK(data->queue.IsEmpty());
+
+	Timer timer;
+	HANDLE thread = CreateThread(0, 0, spscProducer, data, 0, 0);
+
+	// pops in order, every other round as a batch
+	LONG expected = 0;
+	bool inOrder = true;
+	LONG batch[11];
+	for (LONG round = 0; expected < QUEUE_TEST_NUM_ITEMS; round++)
+	{
+		SizeT num = 0;
+		if (round & 1)
+		{
+			num = data->queue.PopBatch(batch, 11);
+		}
+		else if (data->queue.TryPop(batch[0]))
+		{
+			num = 1;
+		}
+		for (SizeT k = 0; k < num; k++)
+		{
+			inOrder = inOrder && batch[k] == expected;
+			expected++;
+		}
+		if (num == 0) SwitchToThread();
+	}
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+	const double seconds = timer.getElapsedSeconds();
+
+	TEST_CHECK(inOrder);
+	TEST_CHECK(data->queue.IsEmpty());
+	printf("  %d items, 1 producer, 1 consumer: %.1f M/s\n", QUEUE_TEST_NUM_ITEMS, QUEUE_TEST_NUM_ITEMS / seconds * 1e-6);
+
+	ph_delete(data);
+	return ok;
+}
+
+bool testMpmcQueue()
+{
+	bool ok = true;
+
+	MpmcTestData* data = ph_new(MpmcTestData);
+	data->queue.SetCapacity(256);
+	data->numPopped = 0;
+	data->nextProducer = 0;
+	data->seen = ph_new_array(uint8, QUEUE_TEST_NUM_ITEMS);
+	memset(data->seen, 0, QUEUE_TEST_NUM_ITEMS);
+
+	Timer timer;
+	HANDLE threads[2 * QUEUE_TEST_THREADS];
+	SizeT i;
+	for (i = 0; i < QUEUE_TEST_THREADS; i++)
+	{
+		threads[i] = CreateThread(0, 0, mpmcProducer, data, 0, 0);
+	}
+	// the producers take the first ids
+	while (data->nextProducer < (LONG)QUEUE_TEST_THREADS)
+	{
+		SwitchToThread();
+	}
+	for (i = 0; i < QUEUE_TEST_THREADS; i++)
+	{
+		threads[QUEUE_TEST_THREADS + i] = CreateThread(0, 0, mpmcConsumer, data, 0, 0);
+	}
+	for (i = 0; i < 2 * QUEUE_TEST_THREADS; i++)
+	{
+		WaitForSingleObject(threads[i], INFINITE);
+		CloseHandle(threads[i]);
+	}
+	const double seconds = timer.getElapsedSeconds();
+
+	int64 sum = 0;
+	for (i = 0; i < QUEUE_TEST_THREADS; i++)
+	{
+		sum += data->sums[i];
+	}
+	bool once = true;
+	for (LONG v = 0; v < QUEUE_TEST_NUM_ITEMS; v++)
+	{
+		once = once && data->seen[v] == 1;
+	}
+	TEST_CHECK(data->numPopped == QUEUE_TEST_NUM_ITEMS);
+	TEST_CHECK(sum == (int64)QUEUE_TEST_NUM_ITEMS * (QUEUE_TEST_NUM_ITEMS - 1) / 2);
+	TEST_CHECK(once);
+	TEST_CHECK(data->queue.IsEmpty());
+	printf("  %d items, %d producers, %d consumers: %.1f M/s\n", QUEUE_TEST_NUM_ITEMS,
+		(int)QUEUE_TEST_THREADS, (int)QUEUE_TEST_THREADS, QUEUE_TEST_NUM_ITEMS / seconds * 1e-6);
+
+	ph_delete_array(data->seen);
+	ph_delete(data);
+	return ok;
+}
+
+_NAMESPACE_END
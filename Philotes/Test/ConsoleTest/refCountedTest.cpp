@@ -0,0 +1,157 @@
+
+#include "consoleTest.h"
+#include "util/refcounted.h"
+
+_NAMESPACE_BEGIN
+
+namespace
+{
+	volatile LONG numAlive = 0;
+
+	class TestObject : public RefCounted
+	{
+		PH_DECLARE_HEAP_ALLOC(Memory::DefaultHeap)
+
+	public:
+
+		TestObject(int value) : m_value(value)	{ InterlockedIncrement(&numAlive); }
+
+		TestObject(const TestObject& rhs) : RefCounted(rhs), m_value(rhs.m_value) { InterlockedIncrement(&numAlive); }
+
+		int getValue() const					{ return m_value; }
+
+	protected:
+
+		virtual ~TestObject()					{ InterlockedDecrement(&numAlive); }
+
+		int m_value;
+	};
+
+	class DerivedTestObject : public TestObject
+	{
+		PH_DECLARE_HEAP_ALLOC(Memory::DefaultHeap)
+
+	public:
+
+		DerivedTestObject() : TestObject(2) {}
+	};
+
+	const int REFCOUNT_TEST_ITERATIONS = 200000;
+
+	struct RefCountThreadData
+	{
+		RefPtr<TestObject>		strong;
+		WeakRefPtr<TestObject>	weak;
+		volatile LONG			numLockFailed;
+	};
+
+	// copies and drops references while the main thread keeps one.
+	DWORD WINAPI refCountThread(LPVOID param)
+	{
+		RefCountThreadData& data = *(RefCountThreadData*)param;
+		for (int i = 0; i < REFCOUNT_TEST_ITERATIONS; i++)
+		{
+			RefPtr<TestObject> a(data.strong);
+			RefPtr<TestObject> b = a;
+			RefPtr<TestObject> locked = data.weak.lock();
+			if (locked.isNull())
+			{
+				InterlockedIncrement(&data.numLockFailed);
+			}
+		}
+		return 0;
+	}
+}
+
+bool testRefCounted()
+{
+	bool ok = true;
+
+	// counts of copies and assignments
+	{
+		RefPtr<TestObject> a(ph_new(TestObject)(1));
+		TEST_CHECK(numAlive == 1);
+		TEST_CHECK(a.unique() && a.useCount() == 1);
+		{
+			RefPtr<TestObject> b(a);
+			TEST_CHECK(a.useCount() == 2);
+			RefPtr<TestObject> c;
+			TEST_CHECK(c.isNull());
+			c = b;
+			TEST_CHECK(a.useCount() == 3 && c == a);
+			c = c;
+			TEST_CHECK(a.useCount() == 3);
+			c.setNull();
+			TEST_CHECK(c.isNull() && a.useCount() == 2);
+		}
+		TEST_CHECK(a.unique());
+
+		// swapping moves the reference without counting
+		RefPtr<TestObject> d;
+		d.swap(a);
+		TEST_CHECK(a.isNull() && d.unique() && d->getValue() == 1);
+
+		// the copy of an object starts without references
+		RefPtr<TestObject> e(ph_new(TestObject)(*d));
+		TEST_CHECK(e.unique() && d.unique() && numAlive == 2);
+
+		// assignment releases the old object
+		e = d;
+		TEST_CHECK(numAlive == 1 && d.useCount() == 2);
+	}
+	TEST_CHECK(numAlive == 0);
+
+	// references to a base class
+	{
+		RefPtr<DerivedTestObject> derived(ph_new(DerivedTestObject));
+		RefPtr<TestObject> base(derived);
+		TEST_CHECK(derived.useCount() == 2 && base->getValue() == 2);
+		derived.setNull();
+		TEST_CHECK(base.unique() && numAlive == 1);
+	}
+	TEST_CHECK(numAlive == 0);
+
+	// weak references don't keep the object alive
+	{
+		RefPtr<TestObject> a(ph_new(TestObject)(3));
+		WeakRefPtr<TestObject> weak(a);
+		TEST_CHECK(!weak.expired() && a.unique());
+		{
+			RefPtr<TestObject> locked = weak.lock();
+			TEST_CHECK(!locked.isNull() && a.useCount() == 2);
+		}
+		a.setNull();
+		TEST_CHECK(numAlive == 0);
+		TEST_CHECK(weak.expired() && weak.lock().isNull());
+	}
+
+	// references added and released on several threads at once
+	{
+		RefCountThreadData* data = ph_new(RefCountThreadData);
+		data->strong = RefPtr<TestObject>(ph_new(TestObject)(4));
+		data->weak = WeakRefPtr<TestObject>(data->strong);
+		data->numLockFailed = 0;
+
+		HANDLE threads[4];
+		int i;
+		for (i = 0; i < 4; i++)
+		{
+			threads[i] = CreateThread(0, 0, refCountThread, data, 0, 0);
+		}
+		for (i = 0; i < 4; i++)
+		{
+			WaitForSingleObject(threads[i], INFINITE);
+			CloseHandle(threads[i]);
+		}
+		TEST_CHECK(data->strong.unique());
+		TEST_CHECK(data->numLockFailed == 0);
+
+		data->strong.setNull();
+		TEST_CHECK(numAlive == 0 && data->weak.expired());
+		ph_delete(data);
+	}
+
+	return ok;
+}
+
+_NAMESPACE_END
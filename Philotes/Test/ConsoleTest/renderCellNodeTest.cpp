@@ -0,0 +1,462 @@
+
+#include "consoleTest.h"
+#include "renderCellNode.h"
+#include "renderSceneManager.h"
+#include "renderTransform.h"
+#include "renderTransformElement.h"
+#include "renderElement.h"
+#include "core/jobsystem.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// RenderCellNode::_updateParallel against the serial _update on the same cell tree: every node
+// derives the same transform and every cell and transform the same bounds, after a full update
+// and after changing a few nodes. tickVisibleParallel against tickVisible: the same elements
+// arrive in the same order. Elements enter and leave the scene indices with the subtree of
+// their node when it is parented under a cell or taken away from it.
+namespace
+{
+	const SizeT CELL_TEST_WORKERS		= 3;
+	const SizeT CELL_WIDE_CHILDREN		= RENDERER_PARALLEL_UPDATE_MIN_CHILDREN + 17;
+	const SizeT CELL_SMALL_CHILDREN		= 10;
+	const int CELL_NUM_CHANGES			= 60;
+	const int CELL_TIMING_SCALE			= 8;
+	const int CELL_TIMING_FRAMES		= 20;
+	const uint32 CELL_VIEWPORT_HEIGHT	= 720;
+
+	uint32 cellTestSeed = 29;
+
+	uint32 randomInt(uint32 range)
+	{
+		cellTestSeed = cellTestSeed * 1664525 + 1013904223;
+		return (cellTestSeed >> 8) % range;
+	}
+
+	scalar randomScalar(scalar minimum, scalar maximum)
+	{
+		return minimum + (maximum - minimum) * (scalar)randomInt(65536) / 65535.0f;
+	}
+
+	Vector3 randomVector(scalar minimum, scalar maximum)
+	{
+		return Vector3(randomScalar(minimum, maximum), randomScalar(minimum, maximum), randomScalar(minimum, maximum));
+	}
+
+	Quaternion randomOrientation()
+	{
+		Quaternion q(Radian(randomScalar(-Math::PI, Math::PI)), randomVector(-1, 1).normalisedCopy());
+		return q;
+	}
+
+	/// a render element with a local box, its world bounds follow the node it is attached to
+	class CellTestElement : public RenderElement, public RenderTransformElement
+	{
+		PH_DECLARE_HEAP_ALLOC(Memory::DefaultHeap)
+
+	public:
+
+		CellTestElement(const String& name, const AxisAlignedBox& box) : RenderTransformElement(name), m_box(box) {}
+
+		virtual void					visitRenderElement(RenderVisitor* visitor)	{ visitor->visit(this); }
+
+		virtual const AxisAlignedBox&	getBoundingBox(void) const					{ return m_box; }
+
+		virtual scalar					getBoundingRadius(void) const				{ return m_box.getHalfSize().length(); }
+
+		virtual void					getWorldTransforms(Matrix4* xform) const	{ xform[0] = getTransform(); }
+
+	private:
+
+		AxisAlignedBox					m_box;
+	};
+
+	/// the nodes and elements of one tree, in creation order
+	struct CellTestTree
+	{
+		RenderCellNode*				root;
+		Array<RenderNode*>			nodes;
+		Array<CellTestElement*>		elements;
+		Array<CellTestElement*>		cellElements;		// attached to transforms directly under a cell
+	};
+
+	void setRandomTransform(RenderNode* node)
+	{
+		node->setPosition(randomVector(-50, 50));
+		node->setOrientation(randomOrientation());
+		node->setScale(randomVector(0.5f, 2.0f));
+	}
+
+	// a transform with an element and up to two child transforms of its own
+	void addTransform(CellTestTree& tree, RenderNode* parent, int depth)
+	{
+		RenderNode* transform = parent->createChild();
+		setRandomTransform(transform);
+		tree.nodes.Append(transform);
+
+		const Vector3 center = randomVector(-5, 5);
+		const Vector3 halfSize = randomVector(0.1f, 3.0f);
+		CellTestElement* element = ph_new(CellTestElement)(String::FromInt((int)tree.elements.Size()), AxisAlignedBox(center - halfSize, center + halfSize));
+		static_cast<RenderTransform*>(transform)->attachObject(element);
+		tree.elements.Append(element);
+		if (depth == 0)
+		{
+			tree.cellElements.Append(element);
+		}
+
+		const uint32 numChildren = depth < 2 ? randomInt(3) : 0;
+		for (uint32 c = 0; c < numChildren; c++)
+		{
+			addTransform(tree, transform, depth + 1);
+		}
+	}
+
+	RenderCellNode* addCell(CellTestTree& tree, RenderCellNode* parent, SizeT numTransforms)
+	{
+		RenderCellNode* cell = ph_new(RenderCellNode)(NULL, "cell_" + String::FromInt((int)tree.nodes.Size()));
+		setRandomTransform(cell);
+		parent->addChild(cell);
+		tree.nodes.Append(cell);
+		for (SizeT t = 0; t < numTransforms; t++)
+		{
+			addTransform(tree, cell, 0);
+		}
+		return cell;
+	}
+
+	// the same tree for the same seed: wide cells which get jobs of their own, one of them
+	// inside another, a small cell which doesn't, and transforms directly under the root
+	void buildTree(CellTestTree& tree, uint32 seed, SizeT scale)
+	{
+		cellTestSeed = seed;
+		tree.root = ph_new(RenderCellNode)(NULL, "root");
+		tree.nodes.Append(tree.root);
+		for (int w = 0; w < 3; w++)
+		{
+			RenderCellNode* wide = addCell(tree, tree.root, CELL_WIDE_CHILDREN * scale);
+			if (w == 1)
+			{
+				addCell(tree, wide, CELL_WIDE_CHILDREN * scale);
+				addCell(tree, wide, CELL_SMALL_CHILDREN);
+			}
+			if (w == 0)
+			{
+				addCell(tree, tree.root, CELL_SMALL_CHILDREN * scale);
+			}
+		}
+		for (SizeT t = 0; t < 20 * scale; t++)
+		{
+			addTransform(tree, tree.root, 0);
+		}
+	}
+
+	void destroyTree(CellTestTree& tree)
+	{
+		// children before their parents
+		for (IndexT i = tree.nodes.Size(); i > 0; i--)
+		{
+			ph_delete(tree.nodes[i - 1]);
+		}
+		for (IndexT i = 0; i < tree.elements.Size(); i++)
+		{
+			ph_delete(tree.elements[i]);
+		}
+		tree.nodes.Clear();
+		tree.elements.Clear();
+		tree.cellElements.Clear();
+	}
+
+	struct CellVisible
+	{
+		RenderElement*	element;
+		scalar			screenSize;
+	};
+
+	/// remembers what tickVisible() and tickVisibleParallel() queue, in order
+	class CellRecordingQueue : public RenderVisibleQueue
+	{
+	public:
+
+		virtual void queueVisible(RenderElement& rend, scalar screenSize)
+		{
+			CellVisible visible;
+			visible.element = &rend;
+			visible.screenSize = screenSize;
+			m_visible.Append(visible);
+		}
+
+		Array<CellVisible> m_visible;
+	};
+
+	int countOrderMismatches(const Array<CellVisible>& serial, const Array<CellVisible>& parallel)
+	{
+		int numErrors = serial.Size() == parallel.Size() ? 0 : 1;
+		for (IndexT i = 0; i < serial.Size() && i < parallel.Size(); i++)
+		{
+			if (serial[i].element != parallel[i].element || serial[i].screenSize != parallel[i].screenSize) numErrors++;
+		}
+		return numErrors;
+	}
+
+	// the elements are in the index their static flag asks for, or in none
+	int countIndexErrors(const Array<CellTestElement*>& elements, RenderSceneManager* sm)
+	{
+		int numErrors = 0;
+		for (IndexT i = 0; i < elements.Size(); i++)
+		{
+			const CellTestElement* element = elements[i];
+			RenderOctree* octree = sm && !element->isStatic() ? sm->getOctree() : NULL;
+			RenderBVH* bvh = sm && element->isStatic() ? sm->getBVH() : NULL;
+			if (element->getOctree() != octree || element->getBVH() != bvh) numErrors++;
+		}
+		return numErrors;
+	}
+
+	int countMismatches(const CellTestTree& serial, const CellTestTree& parallel)
+	{
+		int numErrors = serial.nodes.Size() == parallel.nodes.Size() ? 0 : 1;
+		for (IndexT i = 0; i < serial.nodes.Size() && i < parallel.nodes.Size(); i++)
+		{
+			RenderNode* a = serial.nodes[i];
+			RenderNode* b = parallel.nodes[i];
+			if (a->_getDerivedPosition() != b->_getDerivedPosition()) numErrors++;
+			if (a->_getDerivedOrientation() != b->_getDerivedOrientation()) numErrors++;
+			if (a->_getDerivedScale() != b->_getDerivedScale()) numErrors++;
+			if (a->getNodeType() == NT_CULL_CELL)
+			{
+				const AxisAlignedBox& box = static_cast<RenderCellNode*>(a)->_getWorldAABB();
+				if (box.isNull() || box != static_cast<RenderCellNode*>(b)->_getWorldAABB()) numErrors++;
+			}
+			else
+			{
+				const AxisAlignedBox& box = static_cast<RenderTransform*>(a)->_getWorldAABB();
+				if (box.isNull() || box != static_cast<RenderTransform*>(b)->_getWorldAABB()) numErrors++;
+			}
+		}
+		return numErrors;
+	}
+}
+
+bool testCellUpdate()
+{
+	bool ok = true;
+
+	JobSystem* jobSystem = ph_new(JobSystem);
+	jobSystem->Setup(CELL_TEST_WORKERS);
+
+	// a full update of a new tree
+	CellTestTree serial;
+	CellTestTree parallel;
+	buildTree(serial, 31, 1);
+	buildTree(parallel, 31, 1);
+	serial.root->_update(true, false);
+	parallel.root->_updateParallel(jobSystem);
+	TEST_CHECK(countMismatches(serial, parallel) == 0);
+
+	// only the changed nodes and what is below them, cells included
+	int round;
+	for (round = 0; round < 4; round++)
+	{
+		cellTestSeed = 37 + round;
+		for (int c = 0; c < CELL_NUM_CHANGES; c++)
+		{
+			const IndexT n = 1 + randomInt((uint32)serial.nodes.Size() - 1);
+			const Vector3 position = randomVector(-50, 50);
+			serial.nodes[n]->setPosition(position);
+			parallel.nodes[n]->setPosition(position);
+		}
+		if (round & 1)
+		{
+			serial.root->yaw(Radian(0.1f));
+			parallel.root->yaw(Radian(0.1f));
+		}
+		serial.root->_update(true, false);
+		parallel.root->_updateParallel(jobSystem);
+		TEST_CHECK(countMismatches(serial, parallel) == 0);
+	}
+	destroyTree(serial);
+	destroyTree(parallel);
+
+	// timing: every node changes in every frame
+	buildTree(serial, 41, CELL_TIMING_SCALE);
+	buildTree(parallel, 41, CELL_TIMING_SCALE);
+	Timer timer;
+	for (round = 0; round < CELL_TIMING_FRAMES; round++)
+	{
+		serial.root->yaw(Radian(0.01f));
+		serial.root->_update(true, false);
+	}
+	const double serialSeconds = timer.getElapsedSeconds();
+	for (round = 0; round < CELL_TIMING_FRAMES; round++)
+	{
+		parallel.root->yaw(Radian(0.01f));
+		parallel.root->_updateParallel(jobSystem);
+	}
+	const double parallelSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(countMismatches(serial, parallel) == 0);
+	printf("  %d nodes, %d threads: _updateParallel %.2f ms, _update %.2f ms\n", (int)serial.nodes.Size(),
+		(int)jobSystem->GetNumThreads(), parallelSeconds * 1000.0 / CELL_TIMING_FRAMES, serialSeconds * 1000.0 / CELL_TIMING_FRAMES);
+	destroyTree(serial);
+	destroyTree(parallel);
+
+	jobSystem->Discard();
+	ph_delete(jobSystem);
+	return ok;
+}
+
+bool testCellVisibility()
+{
+	bool ok = true;
+
+	JobSystem* jobSystem = ph_new(JobSystem);
+	jobSystem->Setup(CELL_TEST_WORKERS);
+
+	// the cells collect without culling and only from their own transforms, each of those elements
+	// arrives once, in the order of the serial walk
+	CellTestTree tree;
+	buildTree(tree, 43, 1);
+	tree.root->_update(true, false);
+	CellRecordingQueue serial;
+	CellRecordingQueue parallel;
+	RenderVisibilityStats serialStats;
+	RenderVisibilityStats parallelStats;
+	tree.root->tickVisible(NULL, CELL_VIEWPORT_HEIGHT, serial, &serialStats);
+	tree.root->tickVisibleParallel(NULL, CELL_VIEWPORT_HEIGHT, jobSystem, parallel, &parallelStats);
+	Memory::SwapFrameAllocators();
+	TEST_CHECK(serial.m_visible.Size() == tree.cellElements.Size() && countOrderMismatches(serial.m_visible, parallel.m_visible) == 0);
+	TEST_CHECK(serialStats.numVisible == tree.cellElements.Size() && parallelStats.numVisible == tree.cellElements.Size());
+	TEST_CHECK(serialStats.numTasks == 0 && parallelStats.numTasks > CELL_TEST_WORKERS);
+	int numMissing = 0;
+	for (IndexT i = 0; i < tree.cellElements.Size(); i++)
+	{
+		bool found = false;
+		for (IndexT v = 0; v < serial.m_visible.Size() && !found; v++)
+		{
+			found = serial.m_visible[v].element == static_cast<RenderElement*>(tree.cellElements[i]);
+		}
+		if (!found) numMissing++;
+	}
+	TEST_CHECK(numMissing == 0);
+
+	// an empty cell gives no tasks and nothing to queue
+	RenderCellNode* empty = ph_new(RenderCellNode)(NULL, "empty");
+	CellRecordingQueue none;
+	empty->tickVisibleParallel(NULL, CELL_VIEWPORT_HEIGHT, jobSystem, none, &parallelStats);
+	Memory::SwapFrameAllocators();
+	TEST_CHECK(none.m_visible.IsEmpty() && parallelStats.numTasks == 0 && parallelStats.numVisible == 0);
+	ph_delete(empty);
+	destroyTree(tree);
+
+	// timing, the order is checked again on the larger tree
+	buildTree(tree, 47, CELL_TIMING_SCALE);
+	tree.root->_update(true, false);
+	Timer timer;
+	int round;
+	for (round = 0; round < CELL_TIMING_FRAMES; round++)
+	{
+		serial.m_visible.Reset();
+		tree.root->tickVisible(NULL, CELL_VIEWPORT_HEIGHT, serial, &serialStats);
+		Memory::SwapFrameAllocators();
+	}
+	const double serialSeconds = timer.getElapsedSeconds();
+	for (round = 0; round < CELL_TIMING_FRAMES; round++)
+	{
+		parallel.m_visible.Reset();
+		tree.root->tickVisibleParallel(NULL, CELL_VIEWPORT_HEIGHT, jobSystem, parallel, &parallelStats);
+		Memory::SwapFrameAllocators();
+	}
+	const double parallelSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(serial.m_visible.Size() == tree.cellElements.Size() && countOrderMismatches(serial.m_visible, parallel.m_visible) == 0);
+	printf("  %d elements, %d threads: tickVisibleParallel %.2f ms in %d tasks (merge %.2f ms), tickVisible %.2f ms\n",
+		(int)tree.cellElements.Size(), (int)jobSystem->GetNumThreads(), parallelSeconds * 1000.0 / CELL_TIMING_FRAMES,
+		(int)parallelStats.numTasks, parallelStats.mergeTime * 1000.0, serialSeconds * 1000.0 / CELL_TIMING_FRAMES);
+	destroyTree(tree);
+
+	jobSystem->Discard();
+	ph_delete(jobSystem);
+	return ok;
+}
+
+bool testCellSceneIndex()
+{
+	bool ok = true;
+
+	// a subtree of transforms built outside the scene, every third element static
+	cellTestSeed = 53;
+	RenderSceneManager* sm = ph_new(RenderSceneManager);
+	RenderCellNode* cell = sm->createCellNode("sceneIndexCell");
+	RenderCellNode* innerCell = sm->createCellNode("sceneIndexInnerCell");
+	RenderNode* top = ph_new(RenderTransform)("sceneIndexTop");
+	Array<RenderNode*> nodes;
+	Array<CellTestElement*> elements;
+	Array<CellTestElement*> branchElements;
+	nodes.Append(top);
+	int i;
+	for (i = 0; i < 40; i++)
+	{
+		RenderNode* parent = nodes[randomInt((uint32)nodes.Size())];
+		RenderNode* node = parent->createChild(randomVector(-50, 50));
+		nodes.Append(node);
+		const Vector3 center = randomVector(-5, 5);
+		CellTestElement* element = ph_new(CellTestElement)(String::FromInt(i), AxisAlignedBox(center - Vector3::UNIT_SCALE, center + Vector3::UNIT_SCALE));
+		element->setStatic(i % 3 == 0);
+		static_cast<RenderTransform*>(node)->attachObject(element);
+		elements.Append(element);
+	}
+	TEST_CHECK(countIndexErrors(elements, NULL) == 0 && sm->getOctree()->size() == 0 && sm->getBVH()->size() == 0);
+
+	// parented under a cell, the whole subtree enters the indices of its scene
+	cell->addChild(top);
+	TEST_CHECK(countIndexErrors(elements, sm) == 0);
+	TEST_CHECK(sm->getOctree()->size() + sm->getBVH()->size() == elements.Size() && sm->getBVH()->size() == 14);
+
+	// a branch taken out of it leaves them, the rest stays
+	RenderNode* branch = nodes[1];
+	for (i = 0; i < (int)elements.Size(); i++)
+	{
+		for (RenderNode* node = elements[i]->getParentNode(); node; node = node->getParent())
+		{
+			if (node == branch)
+			{
+				branchElements.Append(elements[i]);
+				break;
+			}
+		}
+	}
+	branch->getParent()->removeChild(branch);
+	TEST_CHECK(countIndexErrors(branchElements, NULL) == 0);
+	TEST_CHECK(sm->getOctree()->size() + sm->getBVH()->size() == elements.Size() - branchElements.Size());
+
+	// under a transform outside the scene it stays out, under a cell inside another one it is back
+	RenderNode* outside = ph_new(RenderTransform)("sceneIndexOutside");
+	outside->addChild(branch);
+	TEST_CHECK(countIndexErrors(branchElements, NULL) == 0);
+	outside->removeChild(branch);
+	cell->addChild(innerCell);
+	innerCell->addChild(branch);
+	TEST_CHECK(countIndexErrors(elements, sm) == 0 && sm->getOctree()->size() + sm->getBVH()->size() == elements.Size());
+
+	// a cell belongs to its scene wherever it is, the top transform takes the rest out
+	cell->removeChild(innerCell);
+	TEST_CHECK(countIndexErrors(elements, sm) == 0);
+	cell->removeChild(top);
+	TEST_CHECK(countIndexErrors(branchElements, sm) == 0);
+	innerCell->removeChild(branch);
+	TEST_CHECK(countIndexErrors(elements, NULL) == 0 && sm->getOctree()->size() == 0 && sm->getBVH()->size() == 0);
+
+	for (i = (int)nodes.Size() - 1; i >= 0; i--)
+	{
+		ph_delete(nodes[i]);
+	}
+	for (i = 0; i < (int)elements.Size(); i++)
+	{
+		ph_delete(elements[i]);
+	}
+	ph_delete(outside);
+	sm->destroyCellNode(innerCell);
+	sm->destroyCellNode(cell);
+	ph_delete(sm);
+	return ok;
+}
+
+_NAMESPACE_END
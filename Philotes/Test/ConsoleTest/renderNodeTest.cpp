@@ -0,0 +1,226 @@
+
+#include "consoleTest.h"
+#include "renderTransform.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the children of a RenderNode: adding, finding by index and by name, erasing with the last child
+// moving into the gap, names becoming free again, and the exceptions for duplicate and missing names.
+namespace
+{
+	const int RENDERNODE_NUM_EDITS			= 4000;
+	const int RENDERNODE_TIMING_CHILDREN	= 2000;
+
+	uint32 renderNodeTestSeed = 23;
+
+	uint32 randomInt(uint32 range)
+	{
+		renderNodeTestSeed = renderNodeTestSeed * 1664525 + 1013904223;
+		return (renderNodeTestSeed >> 8) % range;
+	}
+
+	// every third child is anonymous
+	RenderNode* createNode(int id)
+	{
+		if (id % 3 == 2)
+		{
+			return ph_new(RenderTransform);
+		}
+		String name;
+		name.Format("child_%d", id);
+		return ph_new(RenderTransform)(name);
+	}
+
+	bool addThrows(RenderNode* parent, RenderNode* child)
+	{
+		try
+		{
+			parent->addChild(child);
+		}
+		catch (Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	bool getThrows(RenderNode* parent, const String& name)
+	{
+		try
+		{
+			parent->getChild(name);
+		}
+		catch (Exception&)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	// the children are the expected ones in some order, each named one is found under its name
+	int countMismatches(RenderNode* parent, const Array<RenderNode*>& expected)
+	{
+		int numErrors = parent->numChildren() == expected.Size() ? 0 : 1;
+		for (IndexT i = 0; i < expected.Size(); i++)
+		{
+			RenderNode* child = expected[i];
+			if (child->getParent() != parent) numErrors++;
+			if (child->getName().IsValid() && parent->getChild(child->getName().AsString()) != child) numErrors++;
+		}
+		for (unsigned short c = 0; c < parent->numChildren(); c++)
+		{
+			if (expected.FindIndex(parent->getChild(c)) == InvalidIndex) numErrors++;
+		}
+		return numErrors;
+	}
+}
+
+bool testRenderNode()
+{
+	bool ok = true;
+
+	RenderNode* root = ph_new(RenderTransform)("root");
+	Array<RenderNode*> children;
+	int i;
+	for (i = 0; i < 9; i++)
+	{
+		children.Append(createNode(i));
+		root->addChild(children.Back());
+	}
+	TEST_CHECK(root->numChildren() == 9 && root->getChild(4) == children[4] && root->getChild(9) == 0);
+	TEST_CHECK(root->getChild("child_0") == children[0] && root->getChild("child_7") == children[7]);
+	TEST_CHECK(countMismatches(root, children) == 0);
+
+	// a duplicate name is refused and leaves the node and the parent as they were
+	RenderNode* duplicate = ph_new(RenderTransform)("child_4");
+	TEST_CHECK(addThrows(root, duplicate));
+	TEST_CHECK(duplicate->getParent() == 0 && root->numChildren() == 9 && root->getChild("child_4") == children[4]);
+
+	// so is a node which already has a parent, and a lookup of a name which isn't there
+	RenderNode* other = ph_new(RenderTransform)("other");
+	TEST_CHECK(addThrows(other, children[0]) && children[0]->getParent() == root && other->numChildren() == 0);
+	TEST_CHECK(getThrows(root, "child_2") && getThrows(root, "child_9") && getThrows(root, ""));
+
+	// the last child moves into the place of an erased one and is still found under its name
+	TEST_CHECK(root->removeChild("child_1") == children[1] && children[1]->getParent() == 0);
+	TEST_CHECK(root->getChild(1) == children[8] && root->getChild("child_7") == children[7]);
+	TEST_CHECK(root->removeChild(children[8]) == children[8] && root->getChild(1) == children[7]);
+	TEST_CHECK(root->getChild("child_7") == children[7] && root->removeChild((unsigned short)0) == children[0]);
+	TEST_CHECK(root->numChildren() == 6 && getThrows(root, "child_0") && getThrows(root, "child_1"));
+
+	// an erased name is free again, for a new node and for the old one under another parent
+	TEST_CHECK(root->removeChild("child_4") == children[4] && !addThrows(root, duplicate));
+	TEST_CHECK(root->getChild("child_4") == duplicate && !addThrows(other, children[4]));
+	TEST_CHECK(other->getChild("child_4") == children[4] && root->numChildren() == 6);
+	TEST_CHECK(!addThrows(other, children[1]) && other->getChild("child_1") == children[1]);
+	other->removeAllChildren();
+	TEST_CHECK(other->numChildren() == 0 && children[4]->getParent() == 0 && getThrows(other, "child_4"));
+	root->removeAllChildren();
+	for (i = 0; i < (int)children.Size(); i++)
+	{
+		ph_delete(children[i]);
+	}
+	ph_delete(duplicate);
+	children.Clear();
+
+	// random adds and removes by index, name and node against the list of children
+	Array<RenderNode*> detached;
+	for (i = 0; i < 64; i++)
+	{
+		detached.Append(createNode(i));
+	}
+	int numErrors = 0;
+	for (int edit = 0; edit < RENDERNODE_NUM_EDITS; edit++)
+	{
+		const uint32 action = randomInt(4);
+		if (children.IsEmpty() || (action == 0 && !detached.IsEmpty()) || detached.Size() > children.Size() * 2)
+		{
+			const IndexT d = randomInt((uint32)detached.Size());
+			root->addChild(detached[d]);
+			children.Append(detached[d]);
+			detached.EraseIndexSwap(d);
+		}
+		else
+		{
+			const IndexT c = randomInt((uint32)children.Size());
+			RenderNode* child = children[c];
+			RenderNode* removed = 0;
+			if (action == 1)
+			{
+				removed = root->removeChild(child);
+			}
+			else if (action == 2 && child->getName().IsValid())
+			{
+				removed = root->removeChild(child->getName().AsString());
+			}
+			else
+			{
+				for (unsigned short k = 0; k < root->numChildren(); k++)
+				{
+					if (root->getChild(k) == child)
+					{
+						removed = root->removeChild(k);
+						break;
+					}
+				}
+			}
+			if (removed != child || child->getParent() != 0) numErrors++;
+			children.EraseIndexSwap(c);
+			detached.Append(child);
+		}
+		numErrors += countMismatches(root, children);
+	}
+	TEST_CHECK(numErrors == 0);
+	root->removeAllChildren();
+	for (i = 0; i < (int)detached.Size(); i++)
+	{
+		ph_delete(detached[i]);
+	}
+	for (i = 0; i < (int)children.Size(); i++)
+	{
+		ph_delete(children[i]);
+	}
+
+	// timing: adding, looking up by name and removing by name
+	Array<RenderNode*> timed;
+	Array<String> names;
+	for (i = 0; i < RENDERNODE_TIMING_CHILDREN; i++)
+	{
+		String name;
+		name.Format("timed_%d", i);
+		names.Append(name);
+		timed.Append(ph_new(RenderTransform)(name));
+	}
+	Timer timer;
+	for (i = 0; i < RENDERNODE_TIMING_CHILDREN; i++)
+	{
+		root->addChild(timed[i]);
+	}
+	const double addSeconds = timer.getElapsedSeconds();
+	int numFound = 0;
+	for (i = 0; i < RENDERNODE_TIMING_CHILDREN; i++)
+	{
+		if (root->getChild(names[(i * 7919) % RENDERNODE_TIMING_CHILDREN]) == timed[(i * 7919) % RENDERNODE_TIMING_CHILDREN]) numFound++;
+	}
+	const double findSeconds = timer.getElapsedSeconds();
+	for (i = 0; i < RENDERNODE_TIMING_CHILDREN; i++)
+	{
+		root->removeChild(names[(i * 7919) % RENDERNODE_TIMING_CHILDREN]);
+	}
+	const double removeSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(numFound == RENDERNODE_TIMING_CHILDREN && root->numChildren() == 0);
+	printf("  %d named children: add %.3f us, find %.3f us, remove %.3f us\n", RENDERNODE_TIMING_CHILDREN,
+		addSeconds * 1e6 / RENDERNODE_TIMING_CHILDREN, findSeconds * 1e6 / RENDERNODE_TIMING_CHILDREN,
+		removeSeconds * 1e6 / RENDERNODE_TIMING_CHILDREN);
+	for (i = 0; i < RENDERNODE_TIMING_CHILDREN; i++)
+	{
+		ph_delete(timed[i]);
+	}
+
+	ph_delete(other);
+	ph_delete(root);
+	return ok;
+}
+
+_NAMESPACE_END
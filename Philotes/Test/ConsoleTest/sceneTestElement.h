@@ -0,0 +1,38 @@
+#pragma once
+
+#include "renderPch.h"
+#include "renderTransformElement.h"
+#include "renderTransform.h"
+
+_NAMESPACE_BEGIN
+
+/** An element whose world bounds are set directly, for the tests of the scene indices.
+@remarks
+	The scene indices only see elements attached to a node, attach the
+	elements to a RenderTransform which is not part of a scene, so that
+	they are not added to a scene index of their own.
+*/
+class SceneTestElement : public RenderTransformElement
+{
+	PH_DECLARE_HEAP_ALLOC(Memory::DefaultHeap)
+
+public:
+
+	SceneTestElement(const String& name) : RenderTransformElement(name)	{}
+
+	void							setBox(const AxisAlignedBox& box)	{ m_box = box; }
+
+	virtual void					visitRenderElement(RenderVisitor* visitor) {}
+
+	virtual const AxisAlignedBox&	getBoundingBox(void) const			{ return m_box; }
+
+	virtual scalar					getBoundingRadius(void) const		{ return m_box.isFinite() ? m_box.getHalfSize().length() : 0.0f; }
+
+	virtual const AxisAlignedBox&	getWorldBoundingBox(bool derive = false) const { return m_box; }
+
+protected:
+
+	AxisAlignedBox					m_box;
+};
+
+_NAMESPACE_END
@@ -0,0 +1,213 @@
+
+#include "consoleTest.h"
+#include "renderPch.h"
+#include "renderShaderCache.h"
+#include "util/fast_hash.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// RenderShaderCache with a compiler which expands includes itself, so no backend is needed.
+namespace
+{
+	const char* SHADER_CACHE_TEST_DIR		= "shaderCacheTest/";
+	const char* SHADER_CACHE_TEST_SOURCE	= "shaderCacheTest/test.cg";
+	const char* SHADER_CACHE_TEST_INCLUDE	= "shaderCacheTest/test.h";
+	const int SHADER_CACHE_TIMING_FETCHES	= 10000;
+	const int SHADER_CACHE_TIMING_RECORDS	= 200;
+
+	bool readTextFile(const char* path, String& text)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file) return false;
+		char buffer[1024];
+		size_t num;
+		text.Clear();
+		while ((num = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			text.AppendRange(buffer, (SizeT)num);
+		}
+		fclose(file);
+		return true;
+	}
+
+	bool writeTextFile(const char* path, const char* text)
+	{
+		FILE* file = fopen(path, "wb");
+		if (!file) return false;
+		const size_t length = strlen(text);
+		const bool written = fwrite(text, 1, length, file) == length;
+		fclose(file);
+		return written;
+	}
+
+	/// expands #include lines and drops // comment lines, the blob is the expanded text
+	class TestShaderCompiler : public RenderShaderCompiler
+	{
+	public:
+
+		TestShaderCompiler() : numPreprocessed(0), numCompiled(0) {}
+
+		virtual bool preprocessShader(const RenderShaderKey& key, Array<char>& outSource, Array<String>& outDependencies)
+		{
+			numPreprocessed++;
+			outSource.Clear();
+			outDependencies.Clear();
+			return expand(key.sourcePath, outSource, outDependencies);
+		}
+
+		virtual bool compileShader(const RenderShaderKey& key, Array<uint8>& outBlob)
+		{
+			numCompiled++;
+			Array<char> source;
+			Array<String> dependencies;
+			if (!expand(key.sourcePath, source, dependencies)) return false;
+			outBlob.Clear();
+			for (SizeT i = 0; i < source.Size(); i++)
+			{
+				outBlob.Append((uint8)source[i]);
+			}
+			return !outBlob.IsEmpty();
+		}
+
+		int numPreprocessed;
+		int numCompiled;
+
+	protected:
+
+		bool expand(const String& path, Array<char>& source, Array<String>& dependencies)
+		{
+			String text;
+			if (!readTextFile(path.c_str(), text)) return false;
+			dependencies.Append(path);
+
+			Array<String> lines = text.Tokenize("\n");
+			for (SizeT i = 0; i < lines.Size(); i++)
+			{
+				const String& line = lines[i];
+				if (String::StartsWith(line, "//")) continue;
+				if (String::StartsWith(line, "#include "))
+				{
+					String include = SHADER_CACHE_TEST_DIR;
+					include.Append(line.ExtractRange(9, line.Length() - 9));
+					if (!expand(include, source, dependencies)) return false;
+					continue;
+				}
+				for (SizeT c = 0; c < line.Length(); c++)
+				{
+					source.Append(line[c]);
+				}
+				source.Append('\n');
+			}
+			return true;
+		}
+	};
+
+	bool blobEquals(const Array<uint8>& blob, const char* text)
+	{
+		return blob.Size() == (SizeT)strlen(text) && memcmp(&blob[0], text, blob.Size()) == 0;
+	}
+
+	String recordPath(const RenderShaderKey& key)
+	{
+		const String description = key.getDescription();
+		String path;
+		path.Format("%s%08x.psc", SHADER_CACHE_TEST_DIR, FastHash::ComputeHash(description.c_str(), description.Length()));
+		return path;
+	}
+}
+
+bool testShaderCache()
+{
+	bool ok = true;
+
+	RenderShaderKey key;
+	key.sourcePath = SHADER_CACHE_TEST_SOURCE;
+	key.entry = "main";
+	key.profile = "vs_3_0";
+	key.defines.Append(ShaderDefines("SKINNED", "1"));
+
+	// a record left by an earlier run would turn the first fetch into a hit
+	RenderShaderCache* cache = ph_new(RenderShaderCache)(SHADER_CACHE_TEST_DIR);
+	remove(recordPath(key).c_str());
+	TEST_CHECK(writeTextFile(SHADER_CACHE_TEST_INCLUDE, "float4 tint;\n"));
+	TEST_CHECK(writeTextFile(SHADER_CACHE_TEST_SOURCE, "#include test.h\n// version 1\nfloat4 main() { return tint; }\n"));
+	const char* expanded = "float4 tint;\nfloat4 main() { return tint; }\n";
+
+	// the first fetch compiles and reports the include
+	TestShaderCompiler compiler;
+	Array<uint8> blob;
+	Array<String> dependencies;
+	TEST_CHECK(cache->fetch(key, compiler, blob, &dependencies));
+	TEST_CHECK(compiler.numCompiled == 1);
+	TEST_CHECK(blobEquals(blob, expanded));
+	TEST_CHECK(dependencies.Size() == 2 && dependencies.FindIndex(String(SHADER_CACHE_TEST_INCLUDE)) != InvalidIndex);
+
+	// the second is served from memory
+	blob.Clear();
+	TEST_CHECK(cache->fetch(key, compiler, blob));
+	TEST_CHECK(compiler.numCompiled == 1 && compiler.numPreprocessed == 1);
+	TEST_CHECK(blobEquals(blob, expanded));
+
+	// another permutation is another record
+	RenderShaderKey other = key;
+	other.defines[0].value = "0";
+	TEST_CHECK(cache->fetch(other, compiler, blob));
+	TEST_CHECK(compiler.numCompiled == 2);
+	remove(recordPath(other).c_str());
+
+	// a new session reads the record without preprocessing while no stamp changed
+	ph_delete(cache);
+	cache = ph_new(RenderShaderCache)(SHADER_CACHE_TEST_DIR);
+	blob.Clear();
+	TEST_CHECK(cache->fetch(key, compiler, blob));
+	TEST_CHECK(compiler.numCompiled == 2 && compiler.numPreprocessed == 2);
+	TEST_CHECK(blobEquals(blob, expanded) && cache->getNumHits() == 1);
+
+	// a changed comment changes the stamps but not the expanded source, the blob is reused
+	TEST_CHECK(writeTextFile(SHADER_CACHE_TEST_SOURCE, "#include test.h\n// version 2, longer\nfloat4 main() { return tint; }\n"));
+	cache->invalidate();
+	TEST_CHECK(cache->fetch(key, compiler, blob));
+	TEST_CHECK(compiler.numCompiled == 2 && compiler.numPreprocessed == 3);
+
+	// a changed include is compiled again
+	TEST_CHECK(writeTextFile(SHADER_CACHE_TEST_INCLUDE, "float4 tint;\nfloat4 shade;\n"));
+	cache->invalidate();
+	TEST_CHECK(cache->fetch(key, compiler, blob));
+	TEST_CHECK(compiler.numCompiled == 3);
+	TEST_CHECK(blobEquals(blob, "float4 tint;\nfloat4 shade;\nfloat4 main() { return tint; }\n"));
+
+	// timing of the hit paths against compiling
+	Timer timer;
+	int i;
+	for (i = 0; i < SHADER_CACHE_TIMING_FETCHES; i++)
+	{
+		cache->fetch(key, compiler, blob);
+	}
+	const double residentSeconds = timer.getElapsedSeconds();
+	for (i = 0; i < SHADER_CACHE_TIMING_RECORDS; i++)
+	{
+		cache->invalidate();
+		cache->fetch(key, compiler, blob);
+	}
+	const double recordSeconds = timer.getElapsedSeconds();
+	Array<char> source;
+	for (i = 0; i < SHADER_CACHE_TIMING_RECORDS; i++)
+	{
+		compiler.preprocessShader(key, source, dependencies);
+		compiler.compileShader(key, blob);
+	}
+	const double compileSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(compiler.numCompiled == 3 + SHADER_CACHE_TIMING_RECORDS);
+	printf("  per fetch: resident %.2f us, record on disk %.2f us, preprocess and compile %.2f us\n",
+		residentSeconds * 1e6 / SHADER_CACHE_TIMING_FETCHES, recordSeconds * 1e6 / SHADER_CACHE_TIMING_RECORDS,
+		compileSeconds * 1e6 / SHADER_CACHE_TIMING_RECORDS);
+
+	ph_delete(cache);
+	remove(recordPath(key).c_str());
+	remove(SHADER_CACHE_TEST_SOURCE);
+	remove(SHADER_CACHE_TEST_INCLUDE);
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,240 @@
+
+#include "consoleTest.h"
+#include "math/axisAlignedBox.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// Matrix4, Quaternion and AxisAlignedBox take their SSE paths when PH_MATH_SIMD is set,
+// the plain loops here in double precision are the reference.
+namespace
+{
+	const int SIMD_TEST_ITERATIONS	= 1000;
+	const int SIMD_TIMING_COUNT		= 1000000;
+
+	uint32 simdTestSeed = 1;
+
+	scalar randomScalar()
+	{
+		simdTestSeed = simdTestSeed * 1664525 + 1013904223;
+		return (scalar)(simdTestSeed >> 8) / (scalar)(1 << 24) * 4.0f - 2.0f;
+	}
+
+	Matrix4 randomMatrix(bool affine)
+	{
+		Matrix4 m;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				m[r][c] = randomScalar();
+			}
+			// keeps the matrices well conditioned for the inverse
+			m[r][r] += 4.0f;
+		}
+		if (affine)
+		{
+			m[3][0] = 0; m[3][1] = 0; m[3][2] = 0; m[3][3] = 1;
+		}
+		return m;
+	}
+
+	bool nearlyEqual(double a, double b)
+	{
+		return fabs(a - b) <= 1e-4 * (1.0 + fabs(b));
+	}
+
+	void multiplyReference(double r[4][4], const Matrix4& a, const Matrix4& b)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				r[i][j] = 0;
+				for (int k = 0; k < 4; k++)
+				{
+					r[i][j] += (double)a[i][k] * b[k][j];
+				}
+			}
+		}
+	}
+
+	void transformReference(double r[4], const Matrix4& m, const double v[4])
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			r[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2] + m[i][3] * v[3];
+		}
+	}
+
+	// the 8 corners of the box through the matrix, with the perspective divide
+	void transformBoxReference(double minimum[3], double maximum[3], const Matrix4& m, const Vector3& boxMin, const Vector3& boxMax)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			minimum[i] = 1e30;
+			maximum[i] = -1e30;
+		}
+		for (int corner = 0; corner < 8; corner++)
+		{
+			const double v[4] = { (corner & 1) ? boxMax.x : boxMin.x, (corner & 2) ? boxMax.y : boxMin.y, (corner & 4) ? boxMax.z : boxMin.z, 1.0 };
+			double t[4];
+			transformReference(t, m, v);
+			for (int i = 0; i < 3; i++)
+			{
+				const double p = t[i] / t[3];
+				if (p < minimum[i]) minimum[i] = p;
+				if (p > maximum[i]) maximum[i] = p;
+			}
+		}
+	}
+
+	bool boxEquals(const AxisAlignedBox& box, const double minimum[3], const double maximum[3])
+	{
+		return nearlyEqual(box.getMinimum().x, minimum[0]) && nearlyEqual(box.getMinimum().y, minimum[1]) && nearlyEqual(box.getMinimum().z, minimum[2]) &&
+			   nearlyEqual(box.getMaximum().x, maximum[0]) && nearlyEqual(box.getMaximum().y, maximum[1]) && nearlyEqual(box.getMaximum().z, maximum[2]);
+	}
+
+	// the scalar code of Matrix4::concatenate(), for the timing
+	void multiplyScalar(Matrix4& r, const Matrix4& a, const Matrix4& b)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+			}
+		}
+	}
+}
+
+bool testSimdMath()
+{
+	bool ok = true;
+	printf("  PH_MATH_SIMD = %d\n", PH_MATH_SIMD);
+
+	int numProductErrors = 0, numInverseErrors = 0, numTransformErrors = 0, numQuaternionErrors = 0, numBoxErrors = 0;
+	for (int iteration = 0; iteration < SIMD_TEST_ITERATIONS; iteration++)
+	{
+		const Matrix4 a = randomMatrix(false);
+		const Matrix4 b = randomMatrix(true);
+		const Matrix4 c = randomMatrix(true);
+
+		// products
+		double ref[4][4];
+		multiplyReference(ref, a, b);
+		const Matrix4 ab = a * b;
+		double refAffine[4][4];
+		multiplyReference(refAffine, b, c);
+		const Matrix4 bc = b.concatenateAffine(c);
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				if (!nearlyEqual(ab[i][j], ref[i][j]) || !nearlyEqual(bc[i][j], refAffine[i][j])) numProductErrors++;
+			}
+		}
+
+		// the inverse times the matrix is the identity
+		const Matrix4 inverse = a.inverse();
+		multiplyReference(ref, a, inverse);
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				if (fabs(ref[i][j] - (i == j ? 1.0 : 0.0)) > 1e-4) numInverseErrors++;
+			}
+		}
+
+		// vector transforms
+		const Vector4 v4(randomScalar(), randomScalar(), randomScalar(), randomScalar());
+		const double v[4] = { v4.x, v4.y, v4.z, v4.w };
+		double t[4];
+		transformReference(t, a, v);
+		const Vector4 av4 = a * v4;
+		if (!nearlyEqual(av4.x, t[0]) || !nearlyEqual(av4.y, t[1]) || !nearlyEqual(av4.z, t[2]) || !nearlyEqual(av4.w, t[3])) numTransformErrors++;
+
+		const Vector3 v3(v4.x, v4.y, v4.z);
+		const double p[4] = { v3.x, v3.y, v3.z, 1.0 };
+		transformReference(t, a, p);
+		const Vector3 av3 = a * v3;
+		if (!nearlyEqual(av3.x, t[0] / t[3]) || !nearlyEqual(av3.y, t[1] / t[3]) || !nearlyEqual(av3.z, t[2] / t[3])) numTransformErrors++;
+		transformReference(t, b, p);
+		const Vector3 bv3 = b.transformAffine(v3);
+		if (!nearlyEqual(bv3.x, t[0]) || !nearlyEqual(bv3.y, t[1]) || !nearlyEqual(bv3.z, t[2])) numTransformErrors++;
+
+		// quaternion product
+		const Quaternion q1(randomScalar(), randomScalar(), randomScalar(), randomScalar());
+		const Quaternion q2(randomScalar(), randomScalar(), randomScalar(), randomScalar());
+		const Quaternion q = q1 * q2;
+		const double qw = (double)q1.w * q2.w - (double)q1.x * q2.x - (double)q1.y * q2.y - (double)q1.z * q2.z;
+		const double qx = (double)q1.w * q2.x + (double)q1.x * q2.w + (double)q1.y * q2.z - (double)q1.z * q2.y;
+		const double qy = (double)q1.w * q2.y + (double)q1.y * q2.w + (double)q1.z * q2.x - (double)q1.x * q2.z;
+		const double qz = (double)q1.w * q2.z + (double)q1.z * q2.w + (double)q1.x * q2.y - (double)q1.y * q2.x;
+		if (!nearlyEqual(q.w, qw) || !nearlyEqual(q.x, qx) || !nearlyEqual(q.y, qy) || !nearlyEqual(q.z, qz)) numQuaternionErrors++;
+
+		// boxes through affine and projective matrices
+		const Vector3 boxMin(randomScalar(), randomScalar(), randomScalar());
+		const Vector3 boxMax = boxMin + Vector3(1, 2, 3);
+		double minimum[3], maximum[3];
+
+		AxisAlignedBox affineBox(boxMin, boxMax);
+		affineBox.transformAffine(b);
+		transformBoxReference(minimum, maximum, b, boxMin, boxMax);
+		if (!boxEquals(affineBox, minimum, maximum)) numBoxErrors++;
+
+		Matrix4 projection = Matrix4::IDENTITY;
+		projection[3][0] = randomScalar() * 0.05f;
+		projection[3][1] = randomScalar() * 0.05f;
+		projection[3][2] = randomScalar() * 0.05f;
+		projection[3][3] = 3.0f;
+		const Matrix4 projective = projection * b;
+		AxisAlignedBox projectedBox(boxMin, boxMax);
+		projectedBox.transform(projective);
+		transformBoxReference(minimum, maximum, projective, boxMin, boxMax);
+		if (!boxEquals(projectedBox, minimum, maximum)) numBoxErrors++;
+	}
+	TEST_CHECK(numProductErrors == 0);
+	TEST_CHECK(numInverseErrors == 0);
+	TEST_CHECK(numTransformErrors == 0);
+	TEST_CHECK(numQuaternionErrors == 0);
+	TEST_CHECK(numBoxErrors == 0);
+
+	// timing of the product against the scalar loop, the sums keep the compiler from dropping any
+	const int numMatrices = 256;
+	Array<Matrix4> left, right, products;
+	for (int i = 0; i < numMatrices; i++)
+	{
+		left.Append(randomMatrix(false));
+		right.Append(randomMatrix(true));
+		products.Append(Matrix4::IDENTITY);
+	}
+	Timer timer;
+	for (int i = 0; i < SIMD_TIMING_COUNT; i++)
+	{
+		products[i & (numMatrices - 1)] = left[i & (numMatrices - 1)] * right[(i * 7) & (numMatrices - 1)];
+	}
+	const double simdSeconds = timer.getElapsedSeconds();
+	double simdSum = 0;
+	for (int i = 0; i < numMatrices; i++)
+	{
+		simdSum += products[i][0][0];
+	}
+	timer.getElapsedSeconds();
+	for (int i = 0; i < SIMD_TIMING_COUNT; i++)
+	{
+		multiplyScalar(products[i & (numMatrices - 1)], left[i & (numMatrices - 1)], right[(i * 7) & (numMatrices - 1)]);
+	}
+	const double scalarSeconds = timer.getElapsedSeconds();
+	double scalarSum = 0;
+	for (int i = 0; i < numMatrices; i++)
+	{
+		scalarSum += products[i][0][0];
+	}
+	TEST_CHECK(nearlyEqual(simdSum, scalarSum));
+	printf("  %d Matrix4 products: %.2f ms, scalar loop %.2f ms\n", SIMD_TIMING_COUNT, simdSeconds * 1000.0, scalarSeconds * 1000.0);
+
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,155 @@
+
+#include "consoleTest.h"
+#include "util/stringatom.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// StringAtom pointer equality, threads interning the same strings at once while the table
+// grows, and the cost of interning and looking up against comparing strings.
+namespace
+{
+	const SizeT STRINGATOM_TEST_THREADS		= 4;
+	const int STRINGATOM_NUM_STRINGS		= 20000;
+	const int STRINGATOM_TIMING_LOOKUPS		= 200000;
+
+	struct AtomTestData
+	{
+		Array<String>		strings;
+		const char*			atoms[STRINGATOM_TEST_THREADS][STRINGATOM_NUM_STRINGS];
+		volatile LONG		nextThread;
+		volatile LONG		numWaiting;
+	};
+
+	// every thread interns all strings, each starting at another place and going its own way
+	DWORD WINAPI internStrings(LPVOID param)
+	{
+		AtomTestData& data = *(AtomTestData*)param;
+		const LONG id = InterlockedIncrement(&data.nextThread) - 1;
+
+		// start together so that the inserts overlap
+		InterlockedDecrement(&data.numWaiting);
+		while (data.numWaiting > 0)
+		{
+			SwitchToThread();
+		}
+
+		const int start = (int)id * STRINGATOM_NUM_STRINGS / (int)STRINGATOM_TEST_THREADS;
+		for (int k = 0; k < STRINGATOM_NUM_STRINGS; k++)
+		{
+			const int i = id % 2 == 0 ? (start + k) % STRINGATOM_NUM_STRINGS : (start + STRINGATOM_NUM_STRINGS - k) % STRINGATOM_NUM_STRINGS;
+			data.atoms[id][i] = StringAtom(data.strings[i]).Value();
+		}
+		return 0;
+	}
+
+	// strings no earlier run has interned
+	void makeStrings(Array<String>& strings, const char* prefix, int num)
+	{
+		static int run = 0;
+		run++;
+		strings.Clear();
+		for (int i = 0; i < num; i++)
+		{
+			String str;
+			str.Format("%s/%d/node_%d", prefix, run, i);
+			strings.Append(str);
+		}
+	}
+}
+
+bool testStringAtom()
+{
+	bool ok = true;
+
+	// equal content is one pointer, whatever it was made from
+	String name = "stringAtomTest/root";
+	StringAtom a(name);
+	StringAtom b("stringAtomTest/root");
+	StringAtom c;
+	c = name.AsCharPtr();
+	TEST_CHECK(a == b && b == c && a.Value() == c.Value());
+	TEST_CHECK(a.Value() != name.AsCharPtr() && a == "stringAtomTest/root");
+	TEST_CHECK(a.Length() == name.Length() && a.HashCode() == name.HashCode());
+	TEST_CHECK(a.AsString() == name);
+	StringAtom d("stringAtomTest/rooT");
+	TEST_CHECK(d != a && d.HashCode() == String("stringAtomTest/rooT").HashCode());
+	TEST_CHECK((a < d) != (d < a));
+
+	// empty strings are invalid atoms
+	TEST_CHECK(!StringAtom("").IsValid() && !StringAtom(String()).IsValid() && !StringAtom((const char*)0).IsValid());
+	TEST_CHECK(StringAtom("") == StringAtom() && StringAtom().Length() == 0 && *StringAtom().Value() == 0);
+
+	// threads interning the same new strings get the same pointers, every string is added once
+	AtomTestData* data = ph_new(AtomTestData);
+	makeStrings(data->strings, "stringAtomTest/threads", STRINGATOM_NUM_STRINGS);
+	data->nextThread = 0;
+	data->numWaiting = (LONG)STRINGATOM_TEST_THREADS;
+	const SizeT numBefore = GlobalStringAtomTable::Instance()->GetNumStrings();
+	HANDLE threads[STRINGATOM_TEST_THREADS];
+	SizeT t;
+	for (t = 0; t < STRINGATOM_TEST_THREADS; t++)
+	{
+		threads[t] = CreateThread(0, 0, internStrings, data, 0, 0);
+	}
+	for (t = 0; t < STRINGATOM_TEST_THREADS; t++)
+	{
+		WaitForSingleObject(threads[t], INFINITE);
+		CloseHandle(threads[t]);
+	}
+	TEST_CHECK(GlobalStringAtomTable::Instance()->GetNumStrings() == numBefore + STRINGATOM_NUM_STRINGS);
+	int numErrors = 0;
+	int i;
+	for (i = 0; i < STRINGATOM_NUM_STRINGS; i++)
+	{
+		const char* atom = data->atoms[0][i];
+		for (t = 1; t < STRINGATOM_TEST_THREADS; t++)
+		{
+			if (data->atoms[t][i] != atom) numErrors++;
+		}
+		const StringAtom again(data->strings[i]);
+		if (again.Value() != atom || again != data->strings[i].AsCharPtr() || again.HashCode() != data->strings[i].HashCode()) numErrors++;
+	}
+	TEST_CHECK(numErrors == 0);
+	ph_delete(data);
+
+	// timing of new and interned strings, and of atom against string compares
+	Array<String> strings;
+	makeStrings(strings, "stringAtomTest/timing", STRINGATOM_NUM_STRINGS);
+	Array<StringAtom> atoms;
+	atoms.Reserve(STRINGATOM_NUM_STRINGS);
+	Timer timer;
+	for (i = 0; i < STRINGATOM_NUM_STRINGS; i++)
+	{
+		atoms.Append(StringAtom(strings[i]));
+	}
+	const double internSeconds = timer.getElapsedSeconds();
+	int numFound = 0;
+	for (i = 0; i < STRINGATOM_TIMING_LOOKUPS; i++)
+	{
+		const String& str = strings[(i * 7919) % STRINGATOM_NUM_STRINGS];
+		if (StringAtom(str) == atoms[(i * 7919) % STRINGATOM_NUM_STRINGS]) numFound++;
+	}
+	const double lookupSeconds = timer.getElapsedSeconds();
+	int numAtomEqual = 0;
+	for (i = 0; i < STRINGATOM_TIMING_LOOKUPS; i++)
+	{
+		const StringAtom* atom = atoms.Begin();
+		if (atom[(i * 7919) % STRINGATOM_NUM_STRINGS] == atom[(i * 7907) % STRINGATOM_NUM_STRINGS]) numAtomEqual++;
+	}
+	const double atomCompareSeconds = timer.getElapsedSeconds();
+	int numStringEqual = 0;
+	for (i = 0; i < STRINGATOM_TIMING_LOOKUPS; i++)
+	{
+		const String* str = strings.Begin();
+		if (str[(i * 7919) % STRINGATOM_NUM_STRINGS] == str[(i * 7907) % STRINGATOM_NUM_STRINGS]) numStringEqual++;
+	}
+	const double stringCompareSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(numFound == STRINGATOM_TIMING_LOOKUPS && numAtomEqual == numStringEqual);
+	printf("  %d strings: intern new %.3f us, look up interned %.3f us, compare atoms %.4f us, compare strings %.4f us\n",
+		STRINGATOM_NUM_STRINGS, internSeconds * 1e6 / STRINGATOM_NUM_STRINGS, lookupSeconds * 1e6 / STRINGATOM_TIMING_LOOKUPS,
+		atomCompareSeconds * 1e6 / STRINGATOM_TIMING_LOOKUPS, stringCompareSeconds * 1e6 / STRINGATOM_TIMING_LOOKUPS);
+	return ok;
+}
+
+_NAMESPACE_END
@@ -0,0 +1,122 @@
+
+#include "consoleTest.h"
+#include "gearsPch.h"
+#include "gearsTextureStreamer.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// the reads of GearTextureStreamer's worker on a DDS file written for the test, and their throughput.
+namespace
+{
+	const char* TEXTURE_STREAM_TEST_FILE	= "textureStreamTest.dds";
+	const uint32 TEXTURE_STREAM_SIZE		= 2048;
+	const int TEXTURE_STREAM_TIMING_READS	= 20;
+
+	uint32 textureStreamTestSeed = 13;
+
+	uint8 randomByte()
+	{
+		textureStreamTestSeed = textureStreamTestSeed * 1664525 + 1013904223;
+		return (uint8)(textureStreamTestSeed >> 24);
+	}
+
+	// the bytes of a full DXT1 mip chain, level after level
+	void buildLevels(Array<uint8>& data, Array<GearDDSFile::Surface>& levels)
+	{
+		const RenderTexture2D::Format format = RenderTexture2D::FORMAT_DXT1;
+		uint32 total = 0, level;
+		for (level = 0; RenderTexture2D::getLevelDimension(TEXTURE_STREAM_SIZE, level) > 1; level++)
+		{
+			const uint32 dimension = RenderTexture2D::getLevelDimension(TEXTURE_STREAM_SIZE, level);
+			total += RenderTexture2D::computeImageByteSize(dimension, dimension, format);
+		}
+		total += RenderTexture2D::computeImageByteSize(1, 1, format);
+		data.Resize(total);
+		for (uint32 i = 0; i < total; i++)
+		{
+			data[i] = randomByte();
+		}
+
+		uint32 offset = 0;
+		for (level = 0; offset < total; level++)
+		{
+			GearDDSFile::Surface surface;
+			surface.width	= RenderTexture2D::getLevelDimension(TEXTURE_STREAM_SIZE, level);
+			surface.height	= surface.width;
+			surface.size	= RenderTexture2D::computeImageByteSize(surface.width, surface.height, format);
+			surface.rowSize	= RenderTexture2D::getFormatNumBlocks(surface.width, format) * RenderTexture2D::getFormatBlockSize(format);
+			surface.numRows	= RenderTexture2D::getFormatNumBlocks(surface.height, format);
+			surface.data	= &data[offset];
+			offset += surface.size;
+			levels.Append(surface);
+		}
+	}
+
+	// the levels read from firstLevel on hold the same bytes as the written ones
+	bool levelsMatch(const Array<GearDDSFile::Surface>& written, uint32 firstLevel, const Array<GearDDSFile::Surface>& read)
+	{
+		if (read.Size() != written.Size() - firstLevel) return false;
+		for (SizeT i = 0; i < read.Size(); i++)
+		{
+			const GearDDSFile::Surface& expected = written[firstLevel + i];
+			if (read[i].width != expected.width || read[i].height != expected.height || read[i].size != expected.size ||
+				memcmp(read[i].data, expected.data, expected.size) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool testTextureStream()
+{
+	bool ok = true;
+
+	Array<uint8> written;
+	Array<GearDDSFile::Surface> writtenLevels;
+	buildLevels(written, writtenLevels);
+	TEST_CHECK(GearDDSFile::write(TEXTURE_STREAM_TEST_FILE, RenderTexture2D::FORMAT_DXT1, writtenLevels));
+
+	// every level from the top, from the middle and only the last one
+	Array<uint8> data;
+	Array<GearDDSFile::Surface> levels;
+	RenderTexture2D::Format format = RenderTexture2D::NUM_FORMATS;
+	const uint32 numLevels = (uint32)writtenLevels.Size();
+	TEST_CHECK(GearTextureStreamer::readLevels(TEXTURE_STREAM_TEST_FILE, 0, data, levels, format));
+	TEST_CHECK(format == RenderTexture2D::FORMAT_DXT1);
+	TEST_CHECK(levelsMatch(writtenLevels, 0, levels) && data.Size() == written.Size());
+	TEST_CHECK(GearTextureStreamer::readLevels(TEXTURE_STREAM_TEST_FILE, 4, data, levels, format));
+	TEST_CHECK(levelsMatch(writtenLevels, 4, levels));
+	TEST_CHECK(GearTextureStreamer::readLevels(TEXTURE_STREAM_TEST_FILE, numLevels - 1, data, levels, format));
+	TEST_CHECK(levelsMatch(writtenLevels, numLevels - 1, levels));
+
+	// past the last level and a missing file leave nothing behind
+	TEST_CHECK(!GearTextureStreamer::readLevels(TEXTURE_STREAM_TEST_FILE, numLevels, data, levels, format));
+	TEST_CHECK(data.IsEmpty() && levels.IsEmpty());
+	TEST_CHECK(!GearTextureStreamer::readLevels("textureStreamTestMissing.dds", 0, data, levels, format));
+
+	// timing of the requests the streamer issues: the whole chain and upgrades by one and by two levels,
+	// the file is in the system cache after the first read so this is the copy rather than the disk
+	const uint32 firstLevels[] = { 0, 1, 2 };
+	for (int k = 0; k < 3; k++)
+	{
+		Timer timer;
+		uint64 numBytes = 0;
+		for (int i = 0; i < TEXTURE_STREAM_TIMING_READS; i++)
+		{
+			GearTextureStreamer::readLevels(TEXTURE_STREAM_TEST_FILE, firstLevels[k], data, levels, format);
+			numBytes += data.Size();
+		}
+		const double seconds = timer.getElapsedSeconds();
+		printf("  %ux%u DXT1 from level %u: %.2f ms per request, %.0f MB/s\n", TEXTURE_STREAM_SIZE >> firstLevels[k],
+			TEXTURE_STREAM_SIZE >> firstLevels[k], firstLevels[k], seconds * 1000.0 / TEXTURE_STREAM_TIMING_READS,
+			(double)numBytes / (1024.0 * 1024.0) / seconds);
+	}
+
+	remove(TEXTURE_STREAM_TEST_FILE);
+	return ok;
+}
+
+_NAMESPACE_END
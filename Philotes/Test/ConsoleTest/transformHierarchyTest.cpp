@@ -0,0 +1,234 @@
+
+#include "consoleTest.h"
+#include "renderPch.h"
+#include "renderTransformHierarchy.h"
+#include "util/timer.h"
+
+_NAMESPACE_BEGIN
+
+// RenderTransformHierarchy against heap allocated nodes updated recursively the way
+// RenderNode::_updateFromParent does it.
+namespace
+{
+	const int HIERARCHY_NUM_NODES		= 50000;
+	const int HIERARCHY_NUM_CHANGES		= 100;
+	const int HIERARCHY_TIMING_FRAMES	= 10;
+
+	uint32 hierarchyTestSeed = 3;
+
+	uint32 randomInt()
+	{
+		hierarchyTestSeed = hierarchyTestSeed * 1664525 + 1013904223;
+		return hierarchyTestSeed >> 8;
+	}
+
+	scalar randomScalar()
+	{
+		return (scalar)randomInt() / (scalar)(1 << 24) * 2.0f - 1.0f;
+	}
+
+	struct ReferenceNode
+	{
+		PH_DECLARE_HEAP_ALLOC(Memory::DefaultHeap)
+
+	public:
+
+		int						parent;		// -1 for roots
+		Array<ReferenceNode*>	children;
+		bool					alive;
+
+		Vector3					position;
+		Quaternion				orientation;
+		Vector3					scale;
+		bool					inheritOrientation;
+		bool					inheritScale;
+
+		Vector3					derivedPosition;
+		Quaternion				derivedOrientation;
+		Vector3					derivedScale;
+		Matrix4					fullTransform;
+	};
+
+	void updateReference(ReferenceNode* node, const ReferenceNode* parent)
+	{
+		if (parent)
+		{
+			node->derivedOrientation = node->inheritOrientation ? parent->derivedOrientation * node->orientation : node->orientation;
+			node->derivedScale = node->inheritScale ? parent->derivedScale * node->scale : node->scale;
+			node->derivedPosition = parent->derivedOrientation * (parent->derivedScale * node->position) + parent->derivedPosition;
+		}
+		else
+		{
+			node->derivedOrientation = node->orientation;
+			node->derivedScale = node->scale;
+			node->derivedPosition = node->position;
+		}
+		node->fullTransform.makeTransform(node->derivedPosition, node->derivedScale, node->derivedOrientation);
+		for (SizeT i = 0; i < node->children.Size(); i++)
+		{
+			updateReference(node->children[i], node);
+		}
+	}
+
+	void updateReferenceRoots(Array<ReferenceNode*>& nodes)
+	{
+		for (SizeT i = 0; i < nodes.Size(); i++)
+		{
+			if (nodes[i]->alive && nodes[i]->parent < 0) updateReference(nodes[i], 0);
+		}
+	}
+
+	void rebuildChildren(Array<ReferenceNode*>& nodes)
+	{
+		SizeT i;
+		for (i = 0; i < nodes.Size(); i++)
+		{
+			nodes[i]->children.Clear();
+		}
+		for (i = 0; i < nodes.Size(); i++)
+		{
+			if (nodes[i]->alive && nodes[i]->parent >= 0) nodes[nodes[i]->parent]->children.Append(nodes[i]);
+		}
+	}
+
+	bool nearlyEqual(scalar a, scalar b)
+	{
+		return fabs(a - b) <= 1e-4f * (1.0f + fabs(b));
+	}
+
+	// the number of live nodes whose derived transform differs from the reference
+	int countMismatches(const RenderTransformHierarchy& hierarchy, const Array<RenderTransformHierarchy::Handle>& handles, const Array<ReferenceNode*>& nodes)
+	{
+		int numMismatches = 0;
+		for (SizeT i = 0; i < nodes.Size(); i++)
+		{
+			const ReferenceNode& node = *nodes[i];
+			if (!node.alive) continue;
+
+			Vector3 position, scale;
+			Quaternion orientation;
+			hierarchy.getDerivedTransform(handles[i], position, orientation, scale);
+			const Matrix4& full = hierarchy.getFullTransform(handles[i]);
+			bool equal = nearlyEqual(position.x, node.derivedPosition.x) && nearlyEqual(position.y, node.derivedPosition.y) && nearlyEqual(position.z, node.derivedPosition.z) &&
+						 nearlyEqual(scale.x, node.derivedScale.x) && nearlyEqual(scale.y, node.derivedScale.y) && nearlyEqual(scale.z, node.derivedScale.z) &&
+						 nearlyEqual(orientation.w, node.derivedOrientation.w) && nearlyEqual(orientation.x, node.derivedOrientation.x) &&
+						 nearlyEqual(orientation.y, node.derivedOrientation.y) && nearlyEqual(orientation.z, node.derivedOrientation.z);
+			for (int r = 0; r < 4; r++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					equal = equal && nearlyEqual(full[r][c], node.fullTransform[r][c]);
+				}
+			}
+			if (!equal) numMismatches++;
+		}
+		return numMismatches;
+	}
+}
+
+bool testTransformHierarchy()
+{
+	bool ok = true;
+
+	RenderTransformHierarchy* hierarchy = ph_new(RenderTransformHierarchy);
+	Array<RenderTransformHierarchy::Handle> handles;
+	Array<ReferenceNode*> nodes;
+	int i;
+
+	// one root in 20, the others under an earlier node
+	for (i = 0; i < HIERARCHY_NUM_NODES; i++)
+	{
+		ReferenceNode* node = ph_new(ReferenceNode);
+		node->parent = (i == 0 || randomInt() % 20 == 0) ? -1 : (int)(randomInt() % i);
+		node->alive = true;
+		node->position = Vector3(randomScalar() * 10.0f, randomScalar() * 10.0f, randomScalar() * 10.0f);
+		node->orientation = Quaternion(randomScalar(), randomScalar(), randomScalar(), randomScalar());
+		node->orientation.normalise();
+		node->scale = Vector3(1.0f + randomScalar() * 0.5f, 1.0f + randomScalar() * 0.5f, 1.0f + randomScalar() * 0.5f);
+		node->inheritOrientation = randomInt() % 5 != 0;
+		node->inheritScale = randomInt() % 5 != 0;
+		nodes.Append(node);
+
+		handles.Append(hierarchy->createTransform(node->parent < 0 ? RenderTransformHierarchy::INVALID_HANDLE : handles[node->parent]));
+		hierarchy->setLocalTransform(handles[i], node->position, node->orientation, node->scale);
+		hierarchy->setInherit(handles[i], node->inheritOrientation, node->inheritScale);
+	}
+	rebuildChildren(nodes);
+	updateReferenceRoots(nodes);
+
+	// while dirty the transforms are composed from the ancestors
+	Vector3 position, scale;
+	Quaternion orientation;
+	const int last = HIERARCHY_NUM_NODES - 1;
+	hierarchy->getDerivedTransform(handles[last], position, orientation, scale);
+	TEST_CHECK(hierarchy->isDirty());
+	TEST_CHECK(nearlyEqual(position.x, nodes[last]->derivedPosition.x) && nearlyEqual(position.y, nodes[last]->derivedPosition.y) && nearlyEqual(position.z, nodes[last]->derivedPosition.z));
+
+	hierarchy->update();
+	TEST_CHECK(!hierarchy->isDirty());
+	TEST_CHECK(hierarchy->size() == (SizeT)HIERARCHY_NUM_NODES);
+	TEST_CHECK(countMismatches(*hierarchy, handles, nodes) == 0);
+	printf("  %d nodes in %d levels\n", HIERARCHY_NUM_NODES, (int)hierarchy->getNumLevels());
+
+	// re-parenting under an earlier node keeps the hierarchy free of cycles
+	for (i = 0; i < HIERARCHY_NUM_CHANGES; i++)
+	{
+		const int node = 1 + (int)(randomInt() % (HIERARCHY_NUM_NODES - 1));
+		const int parent = (int)(randomInt() % node);
+		nodes[node]->parent = parent;
+		hierarchy->setParent(handles[node], handles[parent]);
+		TEST_CHECK(hierarchy->getParent(handles[node]) == handles[parent]);
+	}
+	rebuildChildren(nodes);
+
+	// leaves are destroyed from the end
+	int numDestroyed = 0;
+	for (i = HIERARCHY_NUM_NODES - 1; i > 0 && numDestroyed < HIERARCHY_NUM_CHANGES; i--)
+	{
+		if (nodes[i]->children.IsEmpty())
+		{
+			hierarchy->destroyTransform(handles[i]);
+			nodes[i]->alive = false;
+			numDestroyed++;
+		}
+	}
+	rebuildChildren(nodes);
+	updateReferenceRoots(nodes);
+
+	hierarchy->update();
+	TEST_CHECK(hierarchy->size() == (SizeT)(HIERARCHY_NUM_NODES - numDestroyed));
+	TEST_CHECK(countMismatches(*hierarchy, handles, nodes) == 0);
+
+	// timing of frames that move every node, the reference nodes end up with the same positions
+	const Vector3 step(0.01f, 0.0f, 0.0f);
+	Timer timer;
+	int frame;
+	for (frame = 0; frame < HIERARCHY_TIMING_FRAMES; frame++)
+	{
+		for (i = 0; i < HIERARCHY_NUM_NODES; i++)
+		{
+			if (!nodes[i]->alive) continue;
+			nodes[i]->position += step;
+			hierarchy->setLocalTransform(handles[i], nodes[i]->position, nodes[i]->orientation, nodes[i]->scale);
+		}
+		hierarchy->update();
+	}
+	const double hierarchySeconds = timer.getElapsedSeconds();
+	for (frame = 0; frame < HIERARCHY_TIMING_FRAMES; frame++)
+	{
+		updateReferenceRoots(nodes);
+	}
+	const double referenceSeconds = timer.getElapsedSeconds();
+	TEST_CHECK(countMismatches(*hierarchy, handles, nodes) == 0);
+	printf("  %d nodes: update %.2f ms, recursive nodes %.2f ms per frame\n", HIERARCHY_NUM_NODES,
+		hierarchySeconds * 1000.0 / HIERARCHY_TIMING_FRAMES, referenceSeconds * 1000.0 / HIERARCHY_TIMING_FRAMES);
+
+	for (i = 0; i < HIERARCHY_NUM_NODES; i++)
+	{
+		ph_delete(nodes[i]);
+	}
+	ph_delete(hierarchy);
+	return ok;
+}
+
+_NAMESPACE_END
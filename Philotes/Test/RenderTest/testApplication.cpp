@@ -43,14 +43,17 @@ void TestApplication::onInit( void )
 
 	Vector3 ptLast(Math::RangeRandom(-30,30),Math::RangeRandom(-30,30),Math::RangeRandom(-30,30));
 
-	m_debugLine->clearLine();
+	Vector3 linePoints[200];
 	for (size_t i=0; i<100; i++)
 	{
 		Vector3 pt1(Math::RangeRandom(-30,30),Math::RangeRandom(-30,30),Math::RangeRandom(-30,30));
 		
-		m_debugLine->addLine(ptLast,pt1,Colour(1,0,0,1));
+		linePoints[i*2]   = ptLast;
+		linePoints[i*2+1] = pt1;
 		ptLast = pt1;
 	}
+	m_debugLine->clearLine();
+	m_debugLine->addLines(linePoints,200,Colour(1,0,0,1));
 
 	RenderCellNode* cell = m_sceneManager->createCellNode("_dbgCell");
 	m_sceneManager->getRootCellNode()->addChild(cell);